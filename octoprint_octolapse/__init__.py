@@ -2371,7 +2371,8 @@ class OctolapsePlugin(
                 self.on_render_end,
                 self.send_failed_renderings_changed_message,
                 self.send_in_process_renderings_changed_message,
-                self.send_unfinished_renderings_loaded_message
+                self.send_unfinished_renderings_loaded_message,
+                is_printing_callback=self._printer.is_printing
             )
             self._rendering_processor.daemon = True
             self._rendering_processor.start()
@@ -0,0 +1,519 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "bgcode_decoder.h"
+#include "logging.h"
+#include "utilities.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+  // "GCDE", read as a little endian 32 bit integer
+  const unsigned int bgcode_magic = 0x45444347;
+  const long long bgcode_file_header_size = 10;
+
+  const unsigned int bgcode_checksum_none = 0;
+  const unsigned int bgcode_checksum_crc32 = 1;
+
+  const unsigned int bgcode_block_gcode = 1;
+  const unsigned int bgcode_block_thumbnail = 5;
+
+  const unsigned int bgcode_compression_none = 0;
+  const unsigned int bgcode_compression_deflate = 1;
+  const unsigned int bgcode_compression_heatshrink_11_4 = 2;
+  const unsigned int bgcode_compression_heatshrink_12_4 = 3;
+
+  const unsigned int bgcode_encoding_none = 0;
+  const unsigned int bgcode_encoding_meatpack = 1;
+  const unsigned int bgcode_encoding_meatpack_comments = 2;
+
+  unsigned int read_uint16(const char* data)
+  {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    return bytes[0] | (bytes[1] << 8);
+  }
+
+  unsigned int read_uint32(const char* data)
+  {
+    const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+    return bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (static_cast<unsigned int>(bytes[3]) << 24);
+  }
+
+  /**
+   * \brief Decompresses heatshrink data, which is LZSS with the bits stored most significant first.  A 1 bit is
+   * followed by a literal byte, a 0 bit by a window_bits distance and a lookahead_bits length, both stored minus 1.
+   */
+  bool decode_heatshrink(const char* data, const long long length, const int window_bits, const int lookahead_bits,
+                         char* output, const long long output_length)
+  {
+    const unsigned char* input = reinterpret_cast<const unsigned char*>(data);
+    const unsigned char* const input_end = input + length;
+    unsigned long long bit_buffer = 0;
+    int bit_count = 0;
+    const int backref_bits = window_bits + lookahead_bits;
+    long long position = 0;
+    while (position < output_length)
+    {
+      // Enough bits for a literal or a back reference, unless the input ends first
+      while (bit_count < 1 + backref_bits && input < input_end)
+      {
+        bit_buffer = (bit_buffer << 8) | *input++;
+        bit_count += 8;
+      }
+      if (bit_count < 1)
+        return false;
+      bit_count--;
+      if ((bit_buffer >> bit_count) & 1)
+      {
+        if (bit_count < 8)
+          return false;
+        bit_count -= 8;
+        output[position++] = static_cast<char>((bit_buffer >> bit_count) & 0xFF);
+        continue;
+      }
+      if (bit_count < backref_bits)
+        return false;
+      bit_count -= window_bits;
+      const long long distance = static_cast<long long>((bit_buffer >> bit_count) & ((1u << window_bits) - 1)) + 1;
+      bit_count -= lookahead_bits;
+      long long count = static_cast<long long>((bit_buffer >> bit_count) & ((1u << lookahead_bits) - 1)) + 1;
+      if (distance > position)
+        return false;
+      count = std::min(count, output_length - position);
+      // The reference may overlap the bytes it produces
+      for (const long long end = position + count; position < end; position++)
+        output[position] = output[position - distance];
+    }
+    return true;
+  }
+
+  /**
+   * \brief Decodes MeatPack, which packs the 15 most common gcode characters into 4 bits, two to a byte.  A 4 bit
+   * code of 0b1111 means that character follows in a full byte.  Two 0xFF bytes start a command, which turns packing
+   * on or off, or replaces the space with 'E' when spaces are omitted.  This matches libbgcode, including putting the
+   * omitted spaces back in G lines, so the gcode is the same as the slicer's text output.
+   */
+  class meatpack_decoder
+  {
+  public:
+    explicit meatpack_decoder(std::vector<char>& output) : output_(output)
+    {
+      previous_ = '\0';
+      is_packing_ = false;
+      is_omitting_spaces_ = false;
+      is_command_pending_ = false;
+      signal_count_ = 0;
+      full_char_count_ = 0;
+      buffered_char_ = 0;
+      is_g_line_ = false;
+    }
+
+    void decode(const char* data, const long long length)
+    {
+      const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+      for (long long index = 0; index < length; index++)
+        handle_byte(bytes[index]);
+    }
+
+  private:
+    enum meatpack_command
+    {
+      meatpack_command_disable_no_spaces = 246,
+      meatpack_command_enable_no_spaces = 247,
+      meatpack_command_query_config = 248,
+      meatpack_command_reset_all = 249,
+      meatpack_command_disable_packing = 250,
+      meatpack_command_enable_packing = 251
+    };
+    static const unsigned char signal_byte = 0xFF;
+    static const unsigned int full_char_code = 0xF;
+
+    void handle_byte(const unsigned char value)
+    {
+      if (value == signal_byte)
+      {
+        if (signal_count_ > 0)
+        {
+          is_command_pending_ = true;
+          signal_count_ = 0;
+        }
+        else
+          signal_count_++;
+        return;
+      }
+      if (is_command_pending_)
+      {
+        handle_command(value);
+        is_command_pending_ = false;
+        return;
+      }
+      // A single 0xFF is data
+      if (signal_count_ > 0)
+      {
+        handle_data(signal_byte);
+        signal_count_ = 0;
+      }
+      handle_data(value);
+    }
+
+    void handle_command(const unsigned char command)
+    {
+      switch (command)
+      {
+      case meatpack_command_enable_packing:
+        is_packing_ = true;
+        break;
+      case meatpack_command_disable_packing:
+      case meatpack_command_reset_all:
+        is_packing_ = false;
+        break;
+      case meatpack_command_enable_no_spaces:
+        is_omitting_spaces_ = true;
+        break;
+      case meatpack_command_disable_no_spaces:
+        is_omitting_spaces_ = false;
+        break;
+      default:
+        break;
+      }
+    }
+
+    void handle_data(const unsigned char value)
+    {
+      if (!is_packing_)
+      {
+        output_char(static_cast<char>(value));
+        return;
+      }
+      if (full_char_count_ > 0)
+      {
+        output_char(static_cast<char>(value));
+        if (buffered_char_ != 0)
+        {
+          output_char(buffered_char_);
+          buffered_char_ = 0;
+        }
+        full_char_count_--;
+        return;
+      }
+      const unsigned int first = value & 0xF;
+      const unsigned int second = value >> 4;
+      if (first == full_char_code)
+      {
+        // The second character comes after the full one
+        full_char_count_++;
+        if (second == full_char_code)
+          full_char_count_++;
+        else
+          buffered_char_ = get_packed_char(second);
+        return;
+      }
+      const char first_char = get_packed_char(first);
+      output_char(first_char);
+      // A line ending in the first half ends the packed pair
+      if (first_char == '\n')
+        return;
+      if (second == full_char_code)
+        full_char_count_++;
+      else
+        output_char(get_packed_char(second));
+    }
+
+    char get_packed_char(const unsigned int code) const
+    {
+      static const char packed_chars[] = "0123456789. \nGX";
+      if (code == 11 && is_omitting_spaces_)
+        return 'E';
+      return packed_chars[code];
+    }
+
+    static bool is_g_line_parameter(const char c)
+    {
+      switch (c)
+      {
+      case 'X': case 'Y': case 'Z': case 'E': case 'F': case 'I': case 'J': case 'R': case 'P': case 'W': case 'H':
+      case 'C': case 'A':
+        return true;
+      default:
+        return false;
+      }
+    }
+
+    void output_char(const char c)
+    {
+      // previous_ is 0 at the start of the block
+      if (c == 'G' && (previous_ == '\0' || previous_ == '\n'))
+        is_g_line_ = true;
+      else if (c == '\n')
+        is_g_line_ = false;
+      if (is_g_line_ && previous_ != ' ' && is_g_line_parameter(c))
+        output_.push_back(' ');
+      // Empty lines are dropped
+      if (c != '\n' || previous_ != '\n')
+      {
+        output_.push_back(c);
+        previous_ = c;
+      }
+    }
+
+    std::vector<char>& output_;
+    char previous_;
+    bool is_packing_;
+    bool is_omitting_spaces_;
+    bool is_command_pending_;
+    int signal_count_;
+    int full_char_count_;
+    char buffered_char_;
+    bool is_g_line_;
+  };
+}
+
+#pragma region bgcode_decoder
+bgcode_decoder::bgcode_decoder()
+{
+  input_offset_ = 0;
+  checksum_type_ = bgcode_checksum_none;
+  is_input_finished_ = false;
+  is_block_full_[0] = false;
+  is_block_full_[1] = false;
+  next_block_index_ = 0;
+  held_block_index_ = -1;
+  is_decoding_finished_ = false;
+  is_stopping_ = false;
+  has_error_ = false;
+  compressed_position_ = 0;
+}
+
+bgcode_decoder::~bgcode_decoder()
+{
+  close();
+}
+
+bool bgcode_decoder::is_bgcode(const char* data, const long long length)
+{
+  return length >= 4 && read_uint32(data) == bgcode_magic;
+}
+
+bool bgcode_decoder::open(const std::string& file_path)
+{
+  close();
+  if (!input_.open(file_path, false))
+    return false;
+  const char* header = input_.get_range(0, bgcode_file_header_size);
+  if (header == NULL || !is_bgcode(header, bgcode_file_header_size))
+  {
+    input_.close();
+    return false;
+  }
+  const unsigned int version = read_uint32(header + 4);
+  checksum_type_ = read_uint16(header + 8);
+  if (version < 1 || version > BGCODE_DECODER_VERSION || checksum_type_ > bgcode_checksum_crc32)
+  {
+    std::stringstream stream;
+    stream << "bgcode_decoder.open: Unsupported binary gcode version " << version << " or checksum type " <<
+      checksum_type_ << ".";
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, stream.str());
+    input_.close();
+    return false;
+  }
+  input_offset_ = bgcode_file_header_size;
+  is_input_finished_ = false;
+  for (int index = 0; index < 2; index++)
+  {
+    blocks_[index].reserve(BGCODE_DECODER_BLOCK_SIZE * 2);
+    is_block_full_[index] = false;
+  }
+  next_block_index_ = 0;
+  held_block_index_ = -1;
+  is_decoding_finished_ = false;
+  is_stopping_ = false;
+  has_error_ = false;
+  thread_ = std::thread(&bgcode_decoder::run, this);
+  return true;
+}
+
+void bgcode_decoder::close()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  condition_.notify_all();
+  if (thread_.joinable())
+    thread_.join();
+  input_.close();
+  input_offset_ = 0;
+  compressed_position_ = 0;
+  std::vector<char>().swap(decompressed_);
+  for (int index = 0; index < 2; index++)
+  {
+    std::vector<char>().swap(blocks_[index]);
+    is_block_full_[index] = false;
+  }
+}
+
+bool bgcode_decoder::next_block(const char*& data, long long& length)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (held_block_index_ > -1)
+  {
+    // The reader is done with the last block, so it can be decoded into again.
+    is_block_full_[held_block_index_] = false;
+    held_block_index_ = -1;
+    condition_.notify_all();
+  }
+  const int index = next_block_index_;
+  condition_.wait(lock, [this, index] { return is_block_full_[index] || is_decoding_finished_; });
+  if (!is_block_full_[index])
+    return false;
+  next_block_index_ = index ^ 1;
+  held_block_index_ = index;
+  data = &blocks_[index][0];
+  length = static_cast<long long>(blocks_[index].size());
+  return true;
+}
+
+bool bgcode_decoder::has_error() const
+{
+  return has_error_;
+}
+
+long long bgcode_decoder::get_compressed_position() const
+{
+  return compressed_position_;
+}
+
+void bgcode_decoder::run()
+{
+  int index = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this, index] { return is_stopping_ || !is_block_full_[index]; });
+      if (is_stopping_)
+        return;
+    }
+    const bool success = decode(blocks_[index]);
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      is_block_full_[index] = !blocks_[index].empty();
+      if (!success)
+        has_error_ = true;
+      is_decoding_finished_ = !success || is_input_finished_;
+    }
+    condition_.notify_all();
+    if (!success || is_input_finished_)
+      return;
+    index ^= 1;
+  }
+}
+
+bool bgcode_decoder::decode(std::vector<char>& output)
+{
+  output.clear();
+  const long long file_size = input_.get_file_size();
+  while (output.size() < BGCODE_DECODER_BLOCK_SIZE)
+  {
+    if (input_offset_ == file_size)
+    {
+      is_input_finished_ = true;
+      return true;
+    }
+    // The block header, where the compressed size is only stored for compressed blocks
+    const char* header = input_.get_range(input_offset_, std::min<long long>(12, file_size - input_offset_));
+    if (header == NULL || file_size - input_offset_ < 8)
+      return fail("The file ends in a block header.");
+    const unsigned int type = read_uint16(header);
+    const unsigned int compression = read_uint16(header + 2);
+    long long data_size = read_uint32(header + 4);
+    long long header_size = 8;
+    if (compression != bgcode_compression_none)
+    {
+      if (file_size - input_offset_ < 12)
+        return fail("The file ends in a block header.");
+      data_size = read_uint32(header + 8);
+      header_size = 12;
+    }
+    if (type > bgcode_block_thumbnail)
+      return fail("The block type is unknown.");
+    const long long parameters_size = type == bgcode_block_thumbnail ? 6 : 2;
+    const long long checksum_size = checksum_type_ == bgcode_checksum_crc32 ? 4 : 0;
+    const long long block_size = header_size + parameters_size + data_size + checksum_size;
+    if (block_size > file_size - input_offset_)
+      return fail("The file ends in a block.");
+    if (type == bgcode_block_gcode)
+    {
+      const char* block = input_.get_range(input_offset_, block_size);
+      if (block == NULL)
+        return fail("The block could not be read.");
+      if (!decode_gcode_block(block, header_size, block_size, output))
+        return false;
+    }
+    input_offset_ += block_size;
+    compressed_position_ = input_offset_;
+  }
+  return true;
+}
+
+bool bgcode_decoder::decode_gcode_block(const char* block, const long long header_size, const long long block_size,
+                                        std::vector<char>& output)
+{
+  if (checksum_type_ == bgcode_checksum_crc32 &&
+    utilities::update_crc32(0, block, block_size - 4) != read_uint32(block + block_size - 4))
+    return fail("The block checksum does not match.");
+  const unsigned int compression = read_uint16(block + 2);
+  const long long size = read_uint32(block + 4);
+  const unsigned int encoding = read_uint16(block + header_size);
+  const char* data = block + header_size + 2;
+  if (compression == bgcode_compression_heatshrink_11_4 || compression == bgcode_compression_heatshrink_12_4)
+  {
+    decompressed_.resize(static_cast<size_t>(std::max(1LL, size)));
+    const long long data_size = read_uint32(block + 8);
+    const int window_bits = compression == bgcode_compression_heatshrink_11_4 ? 11 : 12;
+    if (!decode_heatshrink(data, data_size, window_bits, 4, &decompressed_[0], size))
+      return fail("The heatshrink compressed gcode is invalid.");
+    data = &decompressed_[0];
+  }
+  else if (compression == bgcode_compression_deflate)
+    return fail("Deflate compressed gcode blocks are not supported.");
+  else if (compression != bgcode_compression_none)
+    return fail("The block compression type is unknown.");
+
+  if (encoding == bgcode_encoding_none)
+    output.insert(output.end(), data, data + size);
+  else if (encoding == bgcode_encoding_meatpack || encoding == bgcode_encoding_meatpack_comments)
+    meatpack_decoder(output).decode(data, size);
+  else
+    return fail("The gcode encoding is unknown.");
+  return true;
+}
+
+bool bgcode_decoder::fail(const std::string& message) const
+{
+  std::stringstream stream;
+  stream << "bgcode_decoder.decode: " << message << "  Block offset: " << input_offset_ << ".";
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, stream.str());
+  return false;
+}
+#pragma endregion bgcode_decoder
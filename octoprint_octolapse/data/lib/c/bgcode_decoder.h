@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef BGCODE_DECODER_H
+#define BGCODE_DECODER_H
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "gcode_file_reader.h"
+
+// Gcode blocks are decoded until at least this many bytes are ready for the reader
+#define BGCODE_DECODER_BLOCK_SIZE 1048576
+// The newest binary gcode version that can be read
+#define BGCODE_DECODER_VERSION 1
+
+/**
+ * \brief Decodes a binary gcode file (the bgcode format written by PrusaSlicer) on its own thread.  Only the gcode
+ * blocks are decoded, heatshrink compressed and MeatPack encoded or not.  Metadata and thumbnail blocks are skipped
+ * without being read.  Two blocks of gcode are decoded into in turn, so the next is decoded while the reader parses
+ * the last one.
+ */
+class bgcode_decoder : public gcode_stream_decoder
+{
+public:
+  bgcode_decoder();
+  ~bgcode_decoder();
+  /**
+   * \brief Opens the file, reads the file header and starts decoding.
+   */
+  bool open(const std::string& file_path) override;
+  void close() override;
+  bool next_block(const char*& data, long long& length) override;
+  bool has_error() const override;
+  long long get_compressed_position() const override;
+  /**
+   * \brief Returns true if the data starts with the binary gcode magic number.
+   */
+  static bool is_bgcode(const char* data, long long length);
+private:
+  bgcode_decoder(const bgcode_decoder&);
+  bgcode_decoder& operator=(const bgcode_decoder&);
+  void run();
+  bool decode(std::vector<char>& output);
+  bool decode_gcode_block(const char* block, long long header_size, long long block_size, std::vector<char>& output);
+  bool fail(const std::string& message) const;
+  // Binary gcode input
+  gcode_file_reader input_;
+  // The offset of the next block header
+  long long input_offset_;
+  unsigned int checksum_type_;
+  bool is_input_finished_;
+  // Holds the decompressed data of a gcode block before it is decoded
+  std::vector<char> decompressed_;
+  // The decoding thread and the blocks of gcode it decodes into
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<char> blocks_[2];
+  bool is_block_full_[2];
+  int next_block_index_;
+  // The block the reader is parsing, or -1
+  int held_block_index_;
+  bool is_decoding_finished_;
+  bool is_stopping_;
+  std::atomic<bool> has_error_;
+  std::atomic<long long> compressed_position_;
+};
+#endif
@@ -1,11 +1,4 @@
 #pragma once
-#ifdef _DEBUG
-#undef _DEBUG
-#include <Python.h>
-#define _DEBUG
-#else
-#include <Python.h>
-#endif
 struct extruder
 {
   extruder();
@@ -30,7 +23,4 @@ struct extruder
   bool is_deretracting;
   bool is_deretracted;
   double get_offset_e() const;
-  PyObject* to_py_tuple() const;
-  PyObject* to_py_dict() const;
-  static PyObject* build_py_object(extruder* p_extruders, unsigned int num_extruders);
 };
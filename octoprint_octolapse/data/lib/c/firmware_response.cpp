@@ -0,0 +1,261 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "firmware_response.h"
+#include "gcode_parser.h"
+#include <cstring>
+#include <cstdlib>
+
+firmware_response::firmware_response()
+{
+  clear();
+}
+
+void firmware_response::clear()
+{
+  type = firmware_response_type_ignored;
+  has_ok = false;
+  x = 0;
+  y = 0;
+  z = 0;
+  e = 0;
+  has_e = false;
+  num_extruders = 0;
+  tool_temp = 0;
+  tool_target = 0;
+  bed_temp = 0;
+  bed_target = 0;
+  has_tool_temp = false;
+  has_tool_target = false;
+  has_bed_temp = false;
+  has_bed_target = false;
+  line_number = -1;
+}
+
+static bool starts_with(const char* p, const char* prefix)
+{
+  return std::strncmp(p, prefix, std::strlen(prefix)) == 0;
+}
+
+firmware_response_type firmware_response::parse(const char* line, int types, firmware_response& response)
+{
+  response.clear();
+  const char* p = line;
+  while (*p == ' ' || *p == '\t')
+    ++p;
+  if (p[0] == 'o' && p[1] == 'k' && (p[2] == '\0' || p[2] == ' ' || p[2] == '\r' || p[2] == '\n'))
+  {
+    // An ok can be followed by a line number, a temperature report or a position report
+    response.has_ok = true;
+    p += 2;
+    while (*p == ' ')
+      ++p;
+  }
+
+  firmware_response_type type = firmware_response_type_ignored;
+  switch (*p)
+  {
+  case 'E':
+  case 'e':
+    if (starts_with(p, "Error:") || starts_with(p, "error:"))
+      type = firmware_response_type_error;
+    else if (starts_with(p, "echo:busy:"))
+      type = firmware_response_type_busy;
+    break;
+  case '!':
+    if (p[1] == '!')
+      type = firmware_response_type_error;
+    break;
+  case 'b':
+    if (starts_with(p, "busy:"))
+      type = firmware_response_type_busy;
+    break;
+  case 'R':
+  case 'r':
+    if (starts_with(p, "Resend:") || starts_with(p, "resend:") || starts_with(p, "rs "))
+    {
+      type = firmware_response_type_resend;
+      if (types & FIRMWARE_RESPONSE_TYPE_FLAG(type))
+      {
+        p = std::strpbrk(p, ": ") + 1;
+        char* p_end;
+        const long line_number = std::strtol(p, &p_end, 10);
+        if (p_end != p)
+          response.line_number = line_number;
+      }
+    }
+    break;
+  case 'T':
+  case 'B':
+    if (p[1] == ':' || (p[0] == 'T' && p[1] == '0' && p[2] == ':'))
+    {
+      type = firmware_response_type_temperature;
+      if (types & FIRMWARE_RESPONSE_TYPE_FLAG(type))
+        parse_temperatures(p, response);
+    }
+    break;
+  default:
+    break;
+  }
+
+  if (type == firmware_response_type_ignored && (types & FIRMWARE_RESPONSE_TYPE_FLAG(firmware_response_type_position)))
+  {
+    // Like OctoPrint, look for a position report anywhere in the line
+    const char* p_x = std::strstr(p, "X:");
+    while (p_x != NULL)
+    {
+      if (try_parse_position(p_x, response))
+      {
+        type = firmware_response_type_position;
+        break;
+      }
+      p_x = std::strstr(p_x + 2, "X:");
+    }
+  }
+
+  if (type == firmware_response_type_ignored && response.has_ok)
+    type = firmware_response_type_ok;
+
+  if (!(types & FIRMWARE_RESPONSE_TYPE_FLAG(type)))
+    type = firmware_response_type_ignored;
+  response.type = type;
+  return type;
+}
+
+bool firmware_response::try_read_value(const char** p_p, char axis, double* p_value)
+{
+  const char* p = *p_p;
+  while (*p == ' ')
+    ++p;
+  if (p[0] != axis || p[1] != ':')
+    return false;
+  // The tokenizer doesn't change the text, it just moves the pointer
+  char* p_value_text = const_cast<char*>(p + 2);
+  if (!gcode_parser::try_extract_double(&p_value_text, p_value))
+    return false;
+  *p_p = p_value_text;
+  return true;
+}
+
+bool firmware_response::try_parse_position(const char* p, firmware_response& response)
+{
+  if (
+    !try_read_value(&p, 'X', &response.x) ||
+    !try_read_value(&p, 'Y', &response.y) ||
+    !try_read_value(&p, 'Z', &response.z)
+  )
+    return false;
+
+  // Read E:, E0:, E1:, etc, skipping any additional axes that come first
+  response.has_e = false;
+  response.num_extruders = 0;
+  while (true)
+  {
+    while (*p == ' ')
+      ++p;
+    double value;
+    if (p[0] == 'E' && p[1] == ':')
+    {
+      if (!try_read_value(&p, 'E', &value))
+        break;
+      response.e = value;
+      response.has_e = true;
+    }
+    else if (p[0] == 'E' && p[1] >= '0' && p[1] <= '9')
+    {
+      char* p_index_end;
+      const long index = std::strtol(p + 1, &p_index_end, 10);
+      if (*p_index_end != ':')
+        break;
+      char* p_value_text = p_index_end + 1;
+      if (!gcode_parser::try_extract_double(&p_value_text, &value))
+        break;
+      p = p_value_text;
+      if (index < FIRMWARE_RESPONSE_MAX_EXTRUDERS)
+      {
+        for (int extruder_index = response.num_extruders; extruder_index < index; extruder_index++)
+          response.extruder_e[extruder_index] = 0;
+        response.extruder_e[index] = value;
+        if (index >= response.num_extruders)
+          response.num_extruders = static_cast<int>(index) + 1;
+      }
+    }
+    else if (
+      !response.has_e && response.num_extruders == 0 && std::strchr("ABCUVW", p[0]) != NULL && p[0] != '\0' &&
+      p[1] == ':'
+    )
+    {
+      if (!try_read_value(&p, p[0], &value))
+        break;
+    }
+    else
+      break;
+  }
+  // A report without any E is not a position report.
+  return response.has_e || response.num_extruders > 0;
+}
+
+void firmware_response::parse_temperatures(const char* p, firmware_response& response)
+{
+  // For example ' T:210.00 /210.00 B:60.00 /60.00 @:127 B@:0' or 'T0:210.0 /210.0 T1:25.0 /0.0 B:60.0 /60.0'
+  while (*p != '\0')
+  {
+    const bool is_tool = p[0] == 'T' && (p[1] == ':' || (p[1] == '0' && p[2] == ':'));
+    const bool is_bed = p[0] == 'B' && p[1] == ':';
+    if ((is_tool && !response.has_tool_temp) || (is_bed && !response.has_bed_temp))
+    {
+      char* p_value_text = const_cast<char*>(std::strchr(p, ':') + 1);
+      double temp;
+      if (gcode_parser::try_extract_double(&p_value_text, &temp))
+      {
+        double target = 0;
+        bool has_target = false;
+        if (*p_value_text == '/')
+        {
+          ++p_value_text;
+          has_target = gcode_parser::try_extract_double(&p_value_text, &target);
+        }
+        if (is_tool)
+        {
+          response.tool_temp = temp;
+          response.has_tool_temp = true;
+          response.tool_target = target;
+          response.has_tool_target = has_target;
+        }
+        else
+        {
+          response.bed_temp = temp;
+          response.has_bed_temp = true;
+          response.bed_target = target;
+          response.has_bed_target = has_target;
+        }
+        p = p_value_text;
+        continue;
+      }
+    }
+    // Move to the next word
+    while (*p != '\0' && *p != ' ')
+      ++p;
+    while (*p == ' ')
+      ++p;
+  }
+}
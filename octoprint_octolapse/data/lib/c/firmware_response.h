@@ -0,0 +1,97 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FIRMWARE_RESPONSE_H
+#define FIRMWARE_RESPONSE_H
+
+// The number of individually reported extruder positions (E0:, E1:, ...) that are kept.
+#define FIRMWARE_RESPONSE_MAX_EXTRUDERS 16
+
+/**
+ * \brief The kinds of lines a printer sends that Octolapse can classify.
+ */
+enum firmware_response_type
+{
+  // A line Octolapse doesn't use, or a type that wasn't requested
+  firmware_response_type_ignored = 0,
+  firmware_response_type_ok = 1,
+  firmware_response_type_temperature = 2,
+  firmware_response_type_position = 3,
+  firmware_response_type_error = 4,
+  firmware_response_type_resend = 5,
+  firmware_response_type_busy = 6
+};
+
+// The flag for a firmware_response_type, used to select the types that firmware_response::parse looks for.
+#define FIRMWARE_RESPONSE_TYPE_FLAG(type) (1 << (type))
+#define FIRMWARE_RESPONSE_ALL_TYPES 0x7E
+
+/**
+ * \brief A line received from the printer, and the numbers read from it.
+ */
+struct firmware_response
+{
+  firmware_response();
+  void clear();
+
+  /**
+   * \brief Classifies a line received from the printer in one pass, and reads the numbers of the requested types.
+   *
+   * The prefix decides most types, so lines of any other type return quickly.  Position reports are found anywhere
+   * in the line like OctoPrint's M114 regex, and are only searched for when requested.  Count, Machine and
+   * additional axis values (for example the C axis of a tool changer) are skipped.
+   * \param line The line received from the printer.
+   * \param types The FIRMWARE_RESPONSE_TYPE_FLAG of each type to look for.
+   * \param response Receives the type and numbers.
+   * \return The type of the response, or firmware_response_type_ignored.
+   */
+  static firmware_response_type parse(const char* line, int types, firmware_response& response);
+
+  firmware_response_type type;
+  // True if the line starts with ok, for example 'ok T:210.0 /210.0' or 'ok X:0.00 Y:0.00 Z:0.00 E:0.00'
+  bool has_ok;
+  // Position reports
+  double x;
+  double y;
+  double z;
+  double e;
+  bool has_e;
+  // The number of E0:, E1:, ... values, which are reported by some multi-extruder firmware
+  int num_extruders;
+  double extruder_e[FIRMWARE_RESPONSE_MAX_EXTRUDERS];
+  // Temperature reports, for the first tool and the bed
+  double tool_temp;
+  double tool_target;
+  double bed_temp;
+  double bed_target;
+  bool has_tool_temp;
+  bool has_tool_target;
+  bool has_bed_temp;
+  bool has_bed_target;
+  // Resend requests
+  long line_number;
+private:
+  static bool try_parse_position(const char* p, firmware_response& response);
+  static void parse_temperatures(const char* p, firmware_response& response);
+  static bool try_read_value(const char** p_p, char axis, double* p_value);
+};
+#endif
@@ -0,0 +1,404 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "frame_preparer.h"
+#include "jpeg_image.h"
+#include "logging.h"
+#include <cmath>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <cerrno>
+#include <unistd.h>
+#endif
+
+// The number of prepared frames each thread may have waiting to be written, which bounds memory use.
+#define FRAME_PREPARER_FRAMES_PER_THREAD 2
+
+frame_glyph::frame_glyph()
+{
+  width = 0;
+  height = 0;
+  red = 0;
+  green = 0;
+  blue = 0;
+}
+
+frame_glyph_placement::frame_glyph_placement()
+{
+  glyph_index = 0;
+  x = 0;
+  y = 0;
+}
+
+frame_glyph_placement::frame_glyph_placement(const int glyph_index, const int x, const int y)
+{
+  this->glyph_index = glyph_index;
+  this->x = x;
+  this->y = y;
+}
+
+frame_source::frame_source()
+{
+  repeat_count = 1;
+  offset_x = 0;
+  offset_y = 0;
+}
+
+frame_preparer_args::frame_preparer_args()
+{
+  width = 0;
+  height = 0;
+  num_threads = 0;
+  output_handle = -1;
+}
+
+frame_preparer_results::frame_preparer_results()
+{
+  success = false;
+  frames_written = 0;
+  frames_failed = 0;
+}
+
+/**
+ * \brief Prepared frames waiting to be written.  Frame n uses slot n % size, and a worker may only start a frame once
+ * its slot has been written.
+ */
+struct frame_queue
+{
+  struct slot
+  {
+    slot()
+    {
+      is_ready = false;
+      is_valid = false;
+    }
+
+    std::vector<unsigned char> pixels;
+    bool is_ready;
+    bool is_valid;
+  };
+
+  frame_queue(const size_t num_slots, const size_t num_frames) : slots(num_slots)
+  {
+    this->num_frames = num_frames;
+    next_frame = 0;
+    next_write = 0;
+    is_cancelled = false;
+  }
+
+  std::mutex mutex;
+  std::condition_variable frame_ready;
+  std::condition_variable slot_free;
+  std::vector<slot> slots;
+  size_t num_frames;
+  size_t next_frame;
+  size_t next_write;
+  bool is_cancelled;
+};
+
+frame_preparer::frame_preparer(const frame_preparer_args& args)
+{
+  args_ = args;
+  frame_size_ = static_cast<size_t>(args_.width) * args_.height * 3;
+}
+
+bool frame_preparer::prepare_frame(const frame_source& source, std::vector<unsigned char>& decoded,
+                                   std::vector<unsigned char>& frame, std::string& error) const
+{
+  jpeg_image image;
+  if (!image.read_file(source.file_path) || !image.to_rgb(decoded))
+  {
+    error = image.get_error();
+    return false;
+  }
+  const int width = image.get_width();
+  const int height = image.get_height();
+  if (width == args_.width && height == args_.height)
+    frame.swap(decoded);
+  else
+  {
+    // Stretch to the output size by sampling the nearest pixel, which is what a camera that changed resolution mid
+    // print needs.
+    frame.resize(frame_size_);
+    std::vector<int> columns(args_.width);
+    for (int x = 0; x < args_.width; x++)
+      columns[x] = static_cast<int>(static_cast<long long>(x) * width / args_.width) * 3;
+    for (int y = 0; y < args_.height; y++)
+    {
+      const unsigned char* in = &decoded[static_cast<size_t>(static_cast<long long>(y) * height / args_.height) *
+        width * 3];
+      unsigned char* out = &frame[static_cast<size_t>(y) * args_.width * 3];
+      for (int x = 0; x < args_.width; x++, out += 3)
+        memcpy(out, in + columns[x], 3);
+    }
+  }
+  if (source.offset_x != 0 || source.offset_y != 0)
+    translate(source.offset_x, source.offset_y, frame, decoded);
+  draw_overlay(source.overlay, frame);
+  return true;
+}
+
+void frame_preparer::translate(const double offset_x, const double offset_y, std::vector<unsigned char>& frame,
+                               std::vector<unsigned char>& translated) const
+{
+  // Every output pixel is the same bilinear blend of four source pixels, so the weights are calculated once.  Pixels
+  // that would come from outside of the frame repeat its edge.
+  const double source_x = -offset_x;
+  const double source_y = -offset_y;
+  const int whole_x = static_cast<int>(std::floor(source_x));
+  const int whole_y = static_cast<int>(std::floor(source_y));
+  const int fraction_x = static_cast<int>((source_x - whole_x) * 256 + 0.5);
+  const int fraction_y = static_cast<int>((source_y - whole_y) * 256 + 0.5);
+  const int weights[4] = {
+    (256 - fraction_x) * (256 - fraction_y), fraction_x * (256 - fraction_y), (256 - fraction_x) * fraction_y,
+    fraction_x * fraction_y
+  };
+  std::vector<int> columns(static_cast<size_t>(args_.width) * 2);
+  for (int x = 0; x < args_.width; x++)
+  {
+    for (int tap = 0; tap < 2; tap++)
+    {
+      int column = x + whole_x + tap;
+      column = column < 0 ? 0 : (column >= args_.width ? args_.width - 1 : column);
+      columns[x * 2 + tap] = column * 3;
+    }
+  }
+  translated.resize(frame_size_);
+  for (int y = 0; y < args_.height; y++)
+  {
+    int row_0 = y + whole_y;
+    int row_1 = row_0 + 1;
+    row_0 = row_0 < 0 ? 0 : (row_0 >= args_.height ? args_.height - 1 : row_0);
+    row_1 = row_1 < 0 ? 0 : (row_1 >= args_.height ? args_.height - 1 : row_1);
+    const unsigned char* in_0 = &frame[static_cast<size_t>(row_0) * args_.width * 3];
+    const unsigned char* in_1 = &frame[static_cast<size_t>(row_1) * args_.width * 3];
+    unsigned char* out = &translated[static_cast<size_t>(y) * args_.width * 3];
+    for (int x = 0; x < args_.width; x++)
+    {
+      const int left = columns[x * 2];
+      const int right = columns[x * 2 + 1];
+      for (int channel = 0; channel < 3; channel++, out++)
+      {
+        *out = static_cast<unsigned char>((
+          in_0[left + channel] * weights[0] + in_0[right + channel] * weights[1] + in_1[left + channel] * weights[2] +
+          in_1[right + channel] * weights[3] + 32768) >> 16);
+      }
+    }
+  }
+  frame.swap(translated);
+}
+
+void frame_preparer::draw_overlay(const std::vector<frame_glyph_placement>& overlay,
+                                  std::vector<unsigned char>& frame) const
+{
+  for (std::vector<frame_glyph_placement>::const_iterator placement = overlay.begin(); placement != overlay.end();
+       ++placement)
+  {
+    if (placement->glyph_index < 0 || placement->glyph_index >= static_cast<int>(args_.glyphs.size()))
+      continue;
+    const frame_glyph& glyph = args_.glyphs[placement->glyph_index];
+    // Clip the glyph to the frame
+    const int start_x = placement->x < 0 ? -placement->x : 0;
+    const int start_y = placement->y < 0 ? -placement->y : 0;
+    const int end_x = placement->x + glyph.width > args_.width ? args_.width - placement->x : glyph.width;
+    const int end_y = placement->y + glyph.height > args_.height ? args_.height - placement->y : glyph.height;
+    for (int y = start_y; y < end_y; y++)
+    {
+      const unsigned char* alpha = &glyph.alpha[static_cast<size_t>(y) * glyph.width];
+      unsigned char* out = &frame[(static_cast<size_t>(placement->y + y) * args_.width + placement->x) * 3];
+      for (int x = start_x; x < end_x; x++)
+      {
+        const int coverage = alpha[x];
+        if (coverage == 0)
+          continue;
+        unsigned char* pixel = out + x * 3;
+        if (coverage == 255)
+        {
+          pixel[0] = glyph.red;
+          pixel[1] = glyph.green;
+          pixel[2] = glyph.blue;
+          continue;
+        }
+        const int inverse = 255 - coverage;
+        pixel[0] = static_cast<unsigned char>((pixel[0] * inverse + glyph.red * coverage + 127) / 255);
+        pixel[1] = static_cast<unsigned char>((pixel[1] * inverse + glyph.green * coverage + 127) / 255);
+        pixel[2] = static_cast<unsigned char>((pixel[2] * inverse + glyph.blue * coverage + 127) / 255);
+      }
+    }
+  }
+}
+
+bool frame_preparer::write_frame(const std::vector<unsigned char>& frame) const
+{
+  const unsigned char* data = &frame[0];
+  size_t remaining = frame.size();
+  while (remaining > 0)
+  {
+#ifdef _MSC_VER
+    DWORD written = 0;
+    const DWORD chunk = remaining > 0x40000000 ? 0x40000000 : static_cast<DWORD>(remaining);
+    if (!WriteFile(reinterpret_cast<HANDLE>(static_cast<intptr_t>(args_.output_handle)), data, chunk, &written, NULL))
+      return false;
+#else
+    const ssize_t written = write(static_cast<int>(args_.output_handle), data, remaining);
+    if (written < 0)
+    {
+      if (errno == EINTR)
+        continue;
+      return false;
+    }
+#endif
+    data += written;
+    remaining -= static_cast<size_t>(written);
+  }
+  return true;
+}
+
+static void prepare_frames_worker(const frame_preparer* preparer, const std::vector<frame_source>* frames,
+                                  frame_queue* queue)
+{
+  std::vector<unsigned char> decoded;
+  std::vector<unsigned char> frame;
+  std::string error;
+  for (;;)
+  {
+    size_t frame_index;
+    {
+      std::unique_lock<std::mutex> lock(queue->mutex);
+      while (
+        !queue->is_cancelled && queue->next_frame < queue->num_frames &&
+        queue->next_frame >= queue->next_write + queue->slots.size()
+      )
+        queue->slot_free.wait(lock);
+      if (queue->is_cancelled || queue->next_frame >= queue->num_frames)
+        return;
+      frame_index = queue->next_frame++;
+    }
+
+    const frame_source& source = (*frames)[frame_index];
+    const bool is_valid = preparer->prepare_frame(source, decoded, frame, error);
+    if (!is_valid)
+    {
+      std::stringstream stream;
+      stream << "Unable to decode the snapshot at " << source.file_path << ": " << error;
+      octolapse_log(octolapse_log::RENDER, octolapse_log::WARNING, stream.str());
+    }
+
+    std::lock_guard<std::mutex> lock(queue->mutex);
+    frame_queue::slot& slot = queue->slots[frame_index % queue->slots.size()];
+    slot.pixels.swap(frame);
+    slot.is_valid = is_valid;
+    slot.is_ready = true;
+    queue->frame_ready.notify_all();
+  }
+}
+
+bool frame_preparer::prepare(const std::vector<frame_source>& frames, const frameProgressCallback progress_callback,
+                             void* progress_context, frame_preparer_results& results) const
+{
+  results = frame_preparer_results();
+  if (args_.width < 1 || args_.height < 1)
+  {
+    results.error = "The output size is invalid.";
+    return false;
+  }
+  int total_frames = 0;
+  for (std::vector<frame_source>::const_iterator source = frames.begin(); source != frames.end(); ++source)
+    total_frames += source->repeat_count;
+
+  int num_threads = args_.num_threads;
+  if (num_threads < 1)
+    num_threads = static_cast<int>(std::thread::hardware_concurrency());
+  if (num_threads < 1)
+    num_threads = 1;
+  if (num_threads > static_cast<int>(frames.size()))
+    num_threads = frames.size() > 0 ? static_cast<int>(frames.size()) : 1;
+
+  std::stringstream stream;
+  stream << "Preparing " << frames.size() << " snapshots (" << total_frames << " frames) at " << args_.width << "x"
+    << args_.height << " with " << num_threads << " threads.";
+  octolapse_log(octolapse_log::RENDER, octolapse_log::INFO, stream.str());
+
+  frame_queue queue(static_cast<size_t>(num_threads) * FRAME_PREPARER_FRAMES_PER_THREAD, frames.size());
+  std::vector<std::thread> workers;
+  for (int index = 0; index < num_threads; index++)
+    workers.push_back(std::thread(prepare_frames_worker, this, &frames, &queue));
+
+  // Frames that can't be decoded are replaced with the last good one, or black if there isn't one yet.
+  std::vector<unsigned char> last_frame(frame_size_, 0);
+  std::vector<unsigned char> frame;
+  bool success = true;
+  for (size_t frame_index = 0; frame_index < frames.size() && success; frame_index++)
+  {
+    bool is_valid;
+    {
+      std::unique_lock<std::mutex> lock(queue.mutex);
+      frame_queue::slot& slot = queue.slots[frame_index % queue.slots.size()];
+      while (!slot.is_ready)
+        queue.frame_ready.wait(lock);
+      frame.swap(slot.pixels);
+      is_valid = slot.is_valid;
+      slot.is_ready = false;
+      queue.next_write = frame_index + 1;
+      queue.slot_free.notify_all();
+    }
+    if (is_valid)
+      last_frame.swap(frame);
+    else
+      results.frames_failed++;
+
+    for (int repeat = 0; repeat < frames[frame_index].repeat_count; repeat++)
+    {
+      if (!write_frame(last_frame))
+      {
+        results.error = "Unable to write a frame to the output.";
+        success = false;
+        break;
+      }
+      results.frames_written++;
+    }
+    if (success && progress_callback != NULL && !progress_callback(progress_context, results.frames_written,
+                                                                   total_frames))
+    {
+      results.error = "Frame preparation was cancelled.";
+      success = false;
+    }
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    queue.is_cancelled = true;
+    queue.slot_free.notify_all();
+  }
+  for (std::vector<std::thread>::iterator worker = workers.begin(); worker != workers.end(); ++worker)
+    worker->join();
+
+  results.success = success;
+  if (!success)
+    octolapse_log(octolapse_log::RENDER, octolapse_log::ERROR, results.error);
+  return success;
+}
@@ -0,0 +1,120 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FRAME_PREPARER_H
+#define FRAME_PREPARER_H
+#include <string>
+#include <vector>
+
+/**
+ * \brief A pre-rasterized character of the overlay text, drawn in a single color with the given coverage.
+ */
+struct frame_glyph
+{
+  frame_glyph();
+  int width;
+  int height;
+  unsigned char red;
+  unsigned char green;
+  unsigned char blue;
+  // width * height coverage values, 0 (transparent) to 255 (opaque)
+  std::vector<unsigned char> alpha;
+};
+
+struct frame_glyph_placement
+{
+  frame_glyph_placement();
+  frame_glyph_placement(int glyph_index, int x, int y);
+  int glyph_index;
+  // The position of the glyph's top left corner in the frame, which may be partially outside of it.
+  int x;
+  int y;
+};
+
+struct frame_source
+{
+  frame_source();
+  std::string file_path;
+  // The number of times the frame is written.  Pre and post roll repeat the first and last frames.
+  int repeat_count;
+  // Glyphs are drawn in order, so outlines should come before the text they surround.
+  std::vector<frame_glyph_placement> overlay;
+  // The sub-pixel translation applied to the frame before the overlay is drawn, usually from frame_registration.
+  double offset_x;
+  double offset_y;
+};
+
+struct frame_preparer_args
+{
+  frame_preparer_args();
+  // The size of the output frames.  Frames of a different size are scaled to fit.
+  int width;
+  int height;
+  // The number of decoding threads, 0 to use every core.
+  int num_threads;
+  // The file descriptor (a HANDLE on windows) that the raw RGB24 frames are written to, usually ffmpeg's stdin.
+  long long output_handle;
+  std::vector<frame_glyph> glyphs;
+};
+
+struct frame_preparer_results
+{
+  frame_preparer_results();
+  bool success;
+  // Frames written to the output, including repeats
+  int frames_written;
+  // Sources that could not be decoded.  The previous frame is written in their place to keep the timing intact.
+  int frames_failed;
+  std::string error;
+};
+
+typedef bool (*frameProgressCallback)(void* progress_context, int frames_written, int total_frames);
+
+/**
+ * \brief Decodes snapshots, scales them to the output size and draws their overlays on a pool of threads, and writes
+ * them in order to the output as raw video.  This replaces copying, overlaying and renaming every snapshot on disk
+ * before running ffmpeg.
+ */
+class frame_preparer
+{
+public:
+  frame_preparer(const frame_preparer_args& args);
+  /**
+   * \brief Prepares and writes every frame.  The progress callback is called on the calling thread after each frame is
+   * written, and processing stops if it returns false.  Returns false if writing failed or was cancelled.
+   */
+  bool prepare(const std::vector<frame_source>& frames, frameProgressCallback progress_callback,
+               void* progress_context, frame_preparer_results& results) const;
+  /**
+   * \brief Decodes, scales and overlays a single frame.  Returns false if the source could not be decoded.
+   */
+  bool prepare_frame(const frame_source& source, std::vector<unsigned char>& decoded,
+                     std::vector<unsigned char>& frame, std::string& error) const;
+private:
+  frame_preparer_args args_;
+  size_t frame_size_;
+  void translate(double offset_x, double offset_y, std::vector<unsigned char>& frame,
+                 std::vector<unsigned char>& translated) const;
+  void draw_overlay(const std::vector<frame_glyph_placement>& overlay, std::vector<unsigned char>& frame) const;
+  bool write_frame(const std::vector<unsigned char>& frame) const;
+};
+#endif
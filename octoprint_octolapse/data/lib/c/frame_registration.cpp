@@ -0,0 +1,630 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "frame_registration.h"
+#include "jpeg_image.h"
+#include "logging.h"
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <condition_variable>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#if defined(__SSE__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 1)
+#include <xmmintrin.h>
+#define FRAME_REGISTRATION_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FRAME_REGISTRATION_NEON
+#endif
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+// Added to the cross power before normalizing so that frequencies without any energy don't divide by zero.
+#define FRAME_REGISTRATION_EPSILON 1e-9f
+// The sub-pixel fit uses frequencies up to 1 / FRAME_REGISTRATION_BAND_DIVISOR of the sampling rate.
+#define FRAME_REGISTRATION_BAND_DIVISOR 4
+
+frame_registration_args::frame_registration_args()
+{
+  width = 0;
+  height = 0;
+  num_threads = 0;
+  analysis_width = 256;
+  smoothing_frames = 15;
+  max_offset_ratio = 0.05;
+  min_confidence = 0.1;
+}
+
+frame_offset::frame_offset()
+{
+  x = 0;
+  y = 0;
+  confidence = 0;
+}
+
+frame_registration_results::frame_registration_results()
+{
+  success = false;
+  frames_unmatched = 0;
+}
+
+#pragma region Fourier transform
+/**
+ * \brief An in place radix 2 complex FFT of a single size.  Real and imaginary parts are kept in separate arrays so
+ * that the element-wise loops around the transform can be vectorized.
+ */
+class fft_plan
+{
+public:
+  explicit fft_plan(const int size) : size_(size), reversed_(size), cos_(size / 2), sin_(size / 2)
+  {
+    int bits = 0;
+    while ((1 << bits) < size)
+      bits++;
+    for (int index = 0; index < size; index++)
+    {
+      int reversed = 0;
+      for (int bit = 0; bit < bits; bit++)
+        reversed |= ((index >> bit) & 1) << (bits - 1 - bit);
+      reversed_[index] = reversed;
+    }
+    for (int index = 0; index < size / 2; index++)
+    {
+      cos_[index] = static_cast<float>(std::cos(2 * M_PI * index / size));
+      sin_[index] = static_cast<float>(std::sin(2 * M_PI * index / size));
+    }
+  }
+
+  /**
+   * \brief Transforms size contiguous values.  The inverse transform is not scaled by 1 / size.
+   */
+  void transform(float* real, float* imaginary, const bool is_inverse) const
+  {
+    for (int index = 0; index < size_; index++)
+    {
+      const int reversed = reversed_[index];
+      if (reversed > index)
+      {
+        std::swap(real[index], real[reversed]);
+        std::swap(imaginary[index], imaginary[reversed]);
+      }
+    }
+    const float sign = is_inverse ? 1.0f : -1.0f;
+    for (int length = 2; length <= size_; length *= 2)
+    {
+      const int half = length / 2;
+      const int step = size_ / length;
+      for (int start = 0; start < size_; start += length)
+      {
+        float* real_even = real + start;
+        float* imaginary_even = imaginary + start;
+        float* real_odd = real_even + half;
+        float* imaginary_odd = imaginary_even + half;
+        for (int k = 0; k < half; k++)
+        {
+          const float twiddle_real = cos_[k * step];
+          const float twiddle_imaginary = sign * sin_[k * step];
+          const float odd_real = real_odd[k] * twiddle_real - imaginary_odd[k] * twiddle_imaginary;
+          const float odd_imaginary = real_odd[k] * twiddle_imaginary + imaginary_odd[k] * twiddle_real;
+          real_odd[k] = real_even[k] - odd_real;
+          imaginary_odd[k] = imaginary_even[k] - odd_imaginary;
+          real_even[k] += odd_real;
+          imaginary_even[k] += odd_imaginary;
+        }
+      }
+    }
+  }
+
+  int get_size() const
+  {
+    return size_;
+  }
+
+private:
+  int size_;
+  std::vector<int> reversed_;
+  std::vector<float> cos_;
+  std::vector<float> sin_;
+};
+
+/**
+ * \brief The analysis image size and everything that only depends on it, shared by every thread.
+ */
+struct registration_grid
+{
+  registration_grid(const int width, const int height) : rows(width), columns(height), window(
+                                                           static_cast<size_t>(width) * height)
+  {
+    this->width = width;
+    this->height = height;
+    // A Hann window keeps the edges of the frame, which don't wrap around, from dominating the correlation
+    for (int y = 0; y < height; y++)
+    {
+      const double window_y = 0.5 - 0.5 * std::cos(2 * M_PI * (y + 0.5) / height);
+      for (int x = 0; x < width; x++)
+      {
+        window[static_cast<size_t>(y) * width + x] = static_cast<float>(
+          window_y * (0.5 - 0.5 * std::cos(2 * M_PI * (x + 0.5) / width))
+        );
+      }
+    }
+  }
+
+  int width;
+  int height;
+  fft_plan rows;
+  fft_plan columns;
+  std::vector<float> window;
+};
+
+/**
+ * \brief The 2D spectrum of a frame, or of the cross power of two frames.
+ */
+struct frame_spectrum
+{
+  frame_spectrum()
+  {
+    is_valid = false;
+  }
+
+  std::vector<float> real;
+  std::vector<float> imaginary;
+  bool is_valid;
+};
+
+static void transform_2d(const registration_grid& grid, frame_spectrum& spectrum, const bool is_inverse,
+                         std::vector<float>& column_real, std::vector<float>& column_imaginary)
+{
+  for (int y = 0; y < grid.height; y++)
+  {
+    const size_t offset = static_cast<size_t>(y) * grid.width;
+    grid.rows.transform(&spectrum.real[offset], &spectrum.imaginary[offset], is_inverse);
+  }
+  column_real.resize(grid.height);
+  column_imaginary.resize(grid.height);
+  for (int x = 0; x < grid.width; x++)
+  {
+    for (int y = 0; y < grid.height; y++)
+    {
+      column_real[y] = spectrum.real[static_cast<size_t>(y) * grid.width + x];
+      column_imaginary[y] = spectrum.imaginary[static_cast<size_t>(y) * grid.width + x];
+    }
+    grid.columns.transform(&column_real[0], &column_imaginary[0], is_inverse);
+    for (int y = 0; y < grid.height; y++)
+    {
+      spectrum.real[static_cast<size_t>(y) * grid.width + x] = column_real[y];
+      spectrum.imaginary[static_cast<size_t>(y) * grid.width + x] = column_imaginary[y];
+    }
+  }
+}
+#pragma endregion
+
+#pragma region Phase correlation
+/**
+ * \brief Decodes the brightness of a snapshot at the smallest scale that is still at least the grid size, resamples it
+ * to the grid, and returns its windowed spectrum.
+ */
+static bool compute_spectrum(const std::string& file_path, const registration_grid& grid,
+                             std::vector<unsigned char>& luma, frame_spectrum& spectrum,
+                             std::vector<float>& column_real, std::vector<float>& column_imaginary)
+{
+  spectrum.is_valid = false;
+  jpeg_image image;
+  if (!image.read_file(file_path))
+    return false;
+  int scale = 1;
+  for (int candidate = 8; candidate > 1; candidate /= 2)
+  {
+    if (image.get_scaled_width(candidate) >= grid.width && image.get_scaled_height(candidate) >= grid.height)
+    {
+      scale = candidate;
+      break;
+    }
+  }
+  if (!image.to_luma(luma, scale))
+    return false;
+  const int width = image.get_scaled_width(scale);
+  const int height = image.get_scaled_height(scale);
+
+  // Bilinear resampling, which is at most a 2:1 reduction after the scaled decode
+  const size_t size = static_cast<size_t>(grid.width) * grid.height;
+  spectrum.real.resize(size);
+  spectrum.imaginary.assign(size, 0.0f);
+  const float scale_x = static_cast<float>(width) / grid.width;
+  const float scale_y = static_cast<float>(height) / grid.height;
+  double total = 0;
+  for (int y = 0; y < grid.height; y++)
+  {
+    float source_y = (y + 0.5f) * scale_y - 0.5f;
+    source_y = source_y < 0 ? 0 : source_y;
+    const int y0 = static_cast<int>(source_y);
+    const int y1 = y0 + 1 < height ? y0 + 1 : y0;
+    const float weight_y = source_y - y0;
+    const unsigned char* row0 = &luma[static_cast<size_t>(y0) * width];
+    const unsigned char* row1 = &luma[static_cast<size_t>(y1) * width];
+    float* out = &spectrum.real[static_cast<size_t>(y) * grid.width];
+    for (int x = 0; x < grid.width; x++)
+    {
+      float source_x = (x + 0.5f) * scale_x - 0.5f;
+      source_x = source_x < 0 ? 0 : source_x;
+      const int x0 = static_cast<int>(source_x);
+      const int x1 = x0 + 1 < width ? x0 + 1 : x0;
+      const float weight_x = source_x - x0;
+      const float top = row0[x0] + (row0[x1] - row0[x0]) * weight_x;
+      const float bottom = row1[x0] + (row1[x1] - row1[x0]) * weight_x;
+      out[x] = top + (bottom - top) * weight_y;
+      total += out[x];
+    }
+  }
+  // Remove the average brightness so that exposure changes don't matter, then window
+  const float mean = static_cast<float>(total / size);
+  for (size_t index = 0; index < size; index++)
+    spectrum.real[index] = (spectrum.real[index] - mean) * grid.window[index];
+  transform_2d(grid, spectrum, false, column_real, column_imaginary);
+  spectrum.is_valid = true;
+  return true;
+}
+
+/**
+ * \brief Sets cross to the normalized cross power spectrum conj(previous) * current, so that only the phase difference
+ * remains.
+ */
+static void normalized_cross_power(const frame_spectrum& previous, const frame_spectrum& current,
+                                   frame_spectrum& cross)
+{
+  const size_t size = previous.real.size();
+  cross.real.resize(size);
+  cross.imaginary.resize(size);
+  const float* previous_real = &previous.real[0];
+  const float* previous_imaginary = &previous.imaginary[0];
+  const float* current_real = &current.real[0];
+  const float* current_imaginary = &current.imaginary[0];
+  float* cross_real = &cross.real[0];
+  float* cross_imaginary = &cross.imaginary[0];
+  size_t index = 0;
+#if defined(FRAME_REGISTRATION_SSE)
+  const __m128 epsilon = _mm_set1_ps(FRAME_REGISTRATION_EPSILON);
+  const __m128 half = _mm_set1_ps(0.5f);
+  const __m128 three_halves = _mm_set1_ps(1.5f);
+  for (; index + 4 <= size; index += 4)
+  {
+    const __m128 a_real = _mm_loadu_ps(previous_real + index);
+    const __m128 a_imaginary = _mm_loadu_ps(previous_imaginary + index);
+    const __m128 b_real = _mm_loadu_ps(current_real + index);
+    const __m128 b_imaginary = _mm_loadu_ps(current_imaginary + index);
+    const __m128 real = _mm_add_ps(_mm_mul_ps(a_real, b_real), _mm_mul_ps(a_imaginary, b_imaginary));
+    const __m128 imaginary = _mm_sub_ps(_mm_mul_ps(a_real, b_imaginary), _mm_mul_ps(a_imaginary, b_real));
+    const __m128 magnitude = _mm_add_ps(_mm_add_ps(_mm_mul_ps(real, real), _mm_mul_ps(imaginary, imaginary)), epsilon);
+    // The reciprocal square root estimate, refined with one Newton step
+    __m128 inverse = _mm_rsqrt_ps(magnitude);
+    inverse = _mm_mul_ps(inverse, _mm_sub_ps(three_halves,
+                                             _mm_mul_ps(_mm_mul_ps(half, magnitude), _mm_mul_ps(inverse, inverse))));
+    _mm_storeu_ps(cross_real + index, _mm_mul_ps(real, inverse));
+    _mm_storeu_ps(cross_imaginary + index, _mm_mul_ps(imaginary, inverse));
+  }
+#elif defined(FRAME_REGISTRATION_NEON)
+  const float32x4_t epsilon = vdupq_n_f32(FRAME_REGISTRATION_EPSILON);
+  for (; index + 4 <= size; index += 4)
+  {
+    const float32x4_t a_real = vld1q_f32(previous_real + index);
+    const float32x4_t a_imaginary = vld1q_f32(previous_imaginary + index);
+    const float32x4_t b_real = vld1q_f32(current_real + index);
+    const float32x4_t b_imaginary = vld1q_f32(current_imaginary + index);
+    const float32x4_t real = vmlaq_f32(vmulq_f32(a_real, b_real), a_imaginary, b_imaginary);
+    const float32x4_t imaginary = vmlsq_f32(vmulq_f32(a_real, b_imaginary), a_imaginary, b_real);
+    const float32x4_t magnitude = vaddq_f32(vmlaq_f32(vmulq_f32(real, real), imaginary, imaginary), epsilon);
+    // The reciprocal square root estimate, refined with one Newton step
+    float32x4_t inverse = vrsqrteq_f32(magnitude);
+    inverse = vmulq_f32(inverse, vrsqrtsq_f32(vmulq_f32(magnitude, inverse), inverse));
+    vst1q_f32(cross_real + index, vmulq_f32(real, inverse));
+    vst1q_f32(cross_imaginary + index, vmulq_f32(imaginary, inverse));
+  }
+#endif
+  for (; index < size; index++)
+  {
+    const float real = previous_real[index] * current_real[index] + previous_imaginary[index] * current_imaginary[index];
+    const float imaginary = previous_real[index] * current_imaginary[index] -
+      previous_imaginary[index] * current_real[index];
+    const float inverse = 1.0f / std::sqrt(real * real + imaginary * imaginary + FRAME_REGISTRATION_EPSILON);
+    cross_real[index] = real * inverse;
+    cross_imaginary[index] = imaginary * inverse;
+  }
+  cross.is_valid = true;
+}
+
+/**
+ * \brief Refines a whole pixel shift by fitting a plane to the phase of the low frequencies of the cross power, where
+ * the signal is strong and the remaining phase difference is too small to wrap.  Each frequency is weighted by its
+ * energy, so noise and compression artifacts have little influence.  Returns false if the fit is degenerate.
+ */
+static bool refine_shift(const registration_grid& grid, const frame_spectrum& previous, const frame_spectrum& current,
+                         const int whole_x, const int whole_y, double& shift_x, double& shift_y)
+{
+  const int band_x = grid.width / FRAME_REGISTRATION_BAND_DIVISOR;
+  const int band_y = grid.height / FRAME_REGISTRATION_BAND_DIVISOR;
+  double sum_xx = 0, sum_xy = 0, sum_yy = 0, sum_x_phase = 0, sum_y_phase = 0;
+  for (int v = -band_y; v <= band_y; v++)
+  {
+    const double frequency_y = 2 * M_PI * v / grid.height;
+    const size_t row = static_cast<size_t>(v < 0 ? v + grid.height : v) * grid.width;
+    for (int u = -band_x; u <= band_x; u++)
+    {
+      if (u == 0 && v == 0)
+        continue;
+      const double frequency_x = 2 * M_PI * u / grid.width;
+      const size_t index = row + (u < 0 ? u + grid.width : u);
+      const double real = static_cast<double>(previous.real[index]) * current.real[index] +
+        static_cast<double>(previous.imaginary[index]) * current.imaginary[index];
+      const double imaginary = static_cast<double>(previous.real[index]) * current.imaginary[index] -
+        static_cast<double>(previous.imaginary[index]) * current.real[index];
+      // Remove the whole pixel shift, which leaves a phase of -(frequency * remaining shift)
+      const double phase = std::atan2(imaginary, real) + frequency_x * whole_x + frequency_y * whole_y;
+      const double wrapped = phase - 2 * M_PI * std::floor((phase + M_PI) / (2 * M_PI));
+      const double weight = std::sqrt(real * real + imaginary * imaginary);
+      sum_xx += weight * frequency_x * frequency_x;
+      sum_xy += weight * frequency_x * frequency_y;
+      sum_yy += weight * frequency_y * frequency_y;
+      sum_x_phase += weight * frequency_x * wrapped;
+      sum_y_phase += weight * frequency_y * wrapped;
+    }
+  }
+  const double determinant = sum_xx * sum_yy - sum_xy * sum_xy;
+  if (!(determinant > 0))
+    return false;
+  const double remaining_x = -(sum_yy * sum_x_phase - sum_xy * sum_y_phase) / determinant;
+  const double remaining_y = -(sum_xx * sum_y_phase - sum_xy * sum_x_phase) / determinant;
+  if (std::fabs(remaining_x) > 1 || std::fabs(remaining_y) > 1)
+    return false;
+  shift_x = whole_x + remaining_x;
+  shift_y = whole_y + remaining_y;
+  return true;
+}
+
+/**
+ * \brief Finds the shift of the current frame relative to the previous one in grid pixels.  A frame whose content
+ * moved right and down has a positive shift.  Returns the height of the correlation peak, from 0 to 1.
+ */
+static double measure_shift(const registration_grid& grid, const frame_spectrum& previous,
+                            const frame_spectrum& current, frame_spectrum& cross, std::vector<float>& column_real,
+                            std::vector<float>& column_imaginary, double& shift_x, double& shift_y)
+{
+  normalized_cross_power(previous, current, cross);
+  transform_2d(grid, cross, true, column_real, column_imaginary);
+  const float* surface = &cross.real[0];
+  size_t peak_index = 0;
+  const size_t size = cross.real.size();
+  for (size_t index = 1; index < size; index++)
+  {
+    if (surface[index] > surface[peak_index])
+      peak_index = index;
+  }
+  const int peak_x = static_cast<int>(peak_index % grid.width);
+  const int peak_y = static_cast<int>(peak_index / grid.width);
+  const float peak = surface[peak_index];
+  // The correlation surface wraps around
+  const int whole_x = peak_x > grid.width / 2 ? peak_x - grid.width : peak_x;
+  const int whole_y = peak_y > grid.height / 2 ? peak_y - grid.height : peak_y;
+  if (!refine_shift(grid, previous, current, whole_x, whole_y, shift_x, shift_y))
+  {
+    shift_x = whole_x;
+    shift_y = whole_y;
+  }
+  // A perfect match puts all of the energy, size after the unscaled inverse transform, into the peak
+  return peak / static_cast<double>(size);
+}
+#pragma endregion
+
+/**
+ * \brief The frame-to-frame shifts, filled in by the workers.  Each worker analyses a contiguous run of frames so that
+ * it only needs to keep the previous frame's spectrum.
+ */
+struct registration_state
+{
+  registration_state(const size_t num_frames) : shifts_x(num_frames, 0.0), shifts_y(num_frames, 0.0),
+                                                confidences(num_frames, 0.0)
+  {
+    frames_analysed = 0;
+    is_cancelled = false;
+  }
+
+  std::vector<double> shifts_x;
+  std::vector<double> shifts_y;
+  std::vector<double> confidences;
+  std::atomic<int> frames_analysed;
+  std::atomic<bool> is_cancelled;
+  std::mutex mutex;
+  std::condition_variable progress;
+};
+
+static void register_frames_worker(const registration_grid* grid, const std::vector<std::string>* file_paths,
+                                   const size_t start, const size_t end, registration_state* state)
+{
+  std::vector<unsigned char> luma;
+  std::vector<float> column_real;
+  std::vector<float> column_imaginary;
+  frame_spectrum previous;
+  frame_spectrum current;
+  frame_spectrum cross;
+  // The first frame of the run is compared with the last frame of the previous run
+  if (start > 0)
+    compute_spectrum((*file_paths)[start - 1], *grid, luma, previous, column_real, column_imaginary);
+  for (size_t index = start; index < end && !state->is_cancelled; index++)
+  {
+    const std::string& file_path = (*file_paths)[index];
+    if (!compute_spectrum(file_path, *grid, luma, current, column_real, column_imaginary))
+    {
+      std::stringstream stream;
+      stream << "Unable to decode the snapshot at " << file_path << " for alignment.";
+      octolapse_log(octolapse_log::RENDER, octolapse_log::WARNING, stream.str());
+    }
+    else if (previous.is_valid)
+    {
+      state->confidences[index] = measure_shift(*grid, previous, current, cross, column_real, column_imaginary,
+                                                state->shifts_x[index], state->shifts_y[index]);
+    }
+    std::swap(previous, current);
+    state->frames_analysed++;
+    std::lock_guard<std::mutex> lock(state->mutex);
+    state->progress.notify_all();
+  }
+}
+
+frame_registration::frame_registration(const frame_registration_args& args)
+{
+  args_ = args;
+}
+
+void frame_registration::calculate_offsets(const std::vector<double>& shifts_x, const std::vector<double>& shifts_y,
+                                           const int analysis_width, const int analysis_height,
+                                           std::vector<frame_offset>& offsets) const
+{
+  const size_t num_frames = shifts_x.size();
+  // The position of every frame relative to the first
+  std::vector<double> path_x(num_frames, 0.0);
+  std::vector<double> path_y(num_frames, 0.0);
+  for (size_t index = 1; index < num_frames; index++)
+  {
+    path_x[index] = path_x[index - 1] + shifts_x[index];
+    path_y[index] = path_y[index - 1] + shifts_y[index];
+  }
+  const int radius = args_.smoothing_frames > 1 ? args_.smoothing_frames / 2 : 0;
+  const double scale_x = static_cast<double>(args_.width) / analysis_width;
+  const double scale_y = static_cast<double>(args_.height) / analysis_height;
+  const double max_x = args_.width * args_.max_offset_ratio;
+  const double max_y = args_.height * args_.max_offset_ratio;
+  for (size_t index = 0; index < num_frames; index++)
+  {
+    // Move every frame onto the moving average of the path, which is shorter near the ends
+    const size_t first = index > static_cast<size_t>(radius) ? index - radius : 0;
+    const size_t last = index + radius < num_frames ? index + radius : num_frames - 1;
+    double average_x = 0;
+    double average_y = 0;
+    for (size_t other = first; other <= last; other++)
+    {
+      average_x += path_x[other];
+      average_y += path_y[other];
+    }
+    average_x /= static_cast<double>(last - first + 1);
+    average_y /= static_cast<double>(last - first + 1);
+    double offset_x = (average_x - path_x[index]) * scale_x;
+    double offset_y = (average_y - path_y[index]) * scale_y;
+    offsets[index].x = offset_x < -max_x ? -max_x : (offset_x > max_x ? max_x : offset_x);
+    offsets[index].y = offset_y < -max_y ? -max_y : (offset_y > max_y ? max_y : offset_y);
+  }
+}
+
+bool frame_registration::register_frames(const std::vector<std::string>& file_paths,
+                                         const frameProgressCallback progress_callback, void* progress_context,
+                                         frame_registration_results& results) const
+{
+  results = frame_registration_results();
+  results.offsets.resize(file_paths.size());
+  if (args_.width < 1 || args_.height < 1)
+  {
+    results.error = "The output size is invalid.";
+    return false;
+  }
+  int analysis_width = 16;
+  while (analysis_width * 2 <= args_.analysis_width)
+    analysis_width *= 2;
+  // The power of 2 closest to the frame's aspect ratio, which only needs to be roughly right
+  const double ideal_height = static_cast<double>(analysis_width) * args_.height / args_.width;
+  int analysis_height = 16;
+  while (analysis_height * 2 <= analysis_width * 4 && analysis_height * 1.5 < ideal_height)
+    analysis_height *= 2;
+
+  int num_threads = args_.num_threads;
+  if (num_threads < 1)
+    num_threads = static_cast<int>(std::thread::hardware_concurrency());
+  if (num_threads < 1)
+    num_threads = 1;
+  if (num_threads > static_cast<int>(file_paths.size()))
+    num_threads = file_paths.size() > 0 ? static_cast<int>(file_paths.size()) : 1;
+
+  std::stringstream stream;
+  stream << "Aligning " << file_paths.size() << " snapshots on a " << analysis_width << "x" << analysis_height
+    << " grid with " << num_threads << " threads.";
+  octolapse_log(octolapse_log::RENDER, octolapse_log::INFO, stream.str());
+
+  const registration_grid grid(analysis_width, analysis_height);
+  registration_state state(file_paths.size());
+  std::vector<std::thread> workers;
+  const size_t frames_per_thread = (file_paths.size() + num_threads - 1) / num_threads;
+  for (size_t start = 0; start < file_paths.size(); start += frames_per_thread)
+  {
+    const size_t end = start + frames_per_thread < file_paths.size() ? start + frames_per_thread : file_paths.size();
+    workers.push_back(std::thread(register_frames_worker, &grid, &file_paths, start, end, &state));
+  }
+
+  const int total_frames = static_cast<int>(file_paths.size());
+  bool success = true;
+  for (;;)
+  {
+    int frames_analysed;
+    {
+      std::unique_lock<std::mutex> lock(state.mutex);
+      state.progress.wait_for(lock, std::chrono::milliseconds(100));
+      frames_analysed = state.frames_analysed;
+    }
+    if (progress_callback != NULL && !progress_callback(progress_context, frames_analysed, total_frames))
+    {
+      results.error = "Frame alignment was cancelled.";
+      state.is_cancelled = true;
+      success = false;
+      break;
+    }
+    if (frames_analysed >= total_frames)
+      break;
+  }
+  for (std::vector<std::thread>::iterator worker = workers.begin(); worker != workers.end(); ++worker)
+    worker->join();
+
+  if (success)
+  {
+    // Shifts that can't be trusted are assumed to be 0
+    std::vector<double> shifts_x(state.shifts_x);
+    std::vector<double> shifts_y(state.shifts_y);
+    const double max_shift_x = analysis_width * args_.max_offset_ratio;
+    const double max_shift_y = analysis_height * args_.max_offset_ratio;
+    for (size_t index = 1; index < file_paths.size(); index++)
+    {
+      results.offsets[index].confidence = state.confidences[index];
+      if (
+        state.confidences[index] < args_.min_confidence || std::fabs(shifts_x[index]) > max_shift_x ||
+        std::fabs(shifts_y[index]) > max_shift_y
+      )
+      {
+        shifts_x[index] = 0;
+        shifts_y[index] = 0;
+        results.frames_unmatched++;
+      }
+    }
+    calculate_offsets(shifts_x, shifts_y, analysis_width, analysis_height, results.offsets);
+  }
+
+  results.success = success;
+  if (!success)
+    octolapse_log(octolapse_log::RENDER, octolapse_log::ERROR, results.error);
+  return success;
+}
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef FRAME_REGISTRATION_H
+#define FRAME_REGISTRATION_H
+#include "frame_preparer.h"
+#include <string>
+#include <vector>
+
+struct frame_registration_args
+{
+  frame_registration_args();
+  // The size of the rendered frames, which the offsets are measured in.
+  int width;
+  int height;
+  // The number of analysis threads, 0 to use every core.
+  int num_threads;
+  // The width of the brightness image that shifts are measured on, a power of 2.  Its height is the power of 2 closest
+  // to the frame's aspect ratio.  Larger sizes are more precise, but slower.
+  int analysis_width;
+  // Only the difference between each frame's position and the centered moving average of this many frames is
+  // corrected, so slow drift and deliberate camera moves are kept.
+  int smoothing_frames;
+  // Corrections are limited to this fraction of the frame's width and height.
+  double max_offset_ratio;
+  // The height of the correlation peak, from 0 to 1, below which a measured shift is not trusted.
+  double min_confidence;
+};
+
+struct frame_offset
+{
+  frame_offset();
+  // The translation to apply to the frame, in output pixels.
+  double x;
+  double y;
+  // The height of the correlation peak with the previous frame, or 0 if the shift could not be measured.
+  double confidence;
+};
+
+struct frame_registration_results
+{
+  frame_registration_results();
+  bool success;
+  // One offset per frame
+  std::vector<frame_offset> offsets;
+  // Frames that could not be decoded or matched with the previous frame.  They are assumed not to have moved.
+  int frames_unmatched;
+  std::string error;
+};
+
+/**
+ * \brief Measures the small shifts between consecutive snapshots with phase correlation, and calculates the sub-pixel
+ * offsets that remove them.  Frames are analysed on a pool of threads from a reduced scale decode of their brightness.
+ */
+class frame_registration
+{
+public:
+  frame_registration(const frame_registration_args& args);
+  /**
+   * \brief Calculates the offset of every frame.  The progress callback is called on the calling thread as frames are
+   * analysed, and processing stops if it returns false.  Returns false if the analysis was cancelled.
+   */
+  bool register_frames(const std::vector<std::string>& file_paths, frameProgressCallback progress_callback,
+                       void* progress_context, frame_registration_results& results) const;
+private:
+  frame_registration_args args_;
+  void calculate_offsets(const std::vector<double>& shifts_x, const std::vector<double>& shifts_y,
+                         int analysis_width, int analysis_height, std::vector<frame_offset>& offsets) const;
+};
+#endif
@@ -0,0 +1,294 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "gcode_arc.h"
+#include "utilities.h"
+#include <cmath>
+
+const double GCODE_ARC_PI = 3.14159265358979323846;
+const double GCODE_ARC_TWO_PI = 2.0 * GCODE_ARC_PI;
+const double GCODE_ARC_HALF_PI = 0.5 * GCODE_ARC_PI;
+
+gcode_arc::gcode_arc()
+{
+  start_x = 0;
+  start_y = 0;
+  start_z = 0;
+  end_x = 0;
+  end_y = 0;
+  end_z = 0;
+  center_x = 0;
+  center_y = 0;
+  radius = 0;
+  start_angle = 0;
+  sweep_angle = 0;
+  is_clockwise = false;
+}
+
+bool gcode_arc::is_arc_command(const parsed_command& command)
+{
+  return command.command == "G2" || command.command == "G3";
+}
+
+bool gcode_arc::try_create(
+  const double start_x, const double start_y, const double start_z, const double end_x, const double end_y,
+  const double end_z, const double i, const double j, const bool has_ij, const double r, const bool has_r,
+  const bool is_clockwise)
+{
+  this->start_x = start_x;
+  this->start_y = start_y;
+  this->start_z = start_z;
+  this->end_x = end_x;
+  this->end_y = end_y;
+  this->end_z = end_z;
+  this->is_clockwise = is_clockwise;
+  const bool is_full_circle = utilities::is_equal(start_x, end_x) && utilities::is_equal(start_y, end_y);
+
+  if (has_r && !has_ij)
+  {
+    // An R form arc cannot describe a full circle, since any circle through the start point would work.
+    if (is_full_circle || utilities::is_zero(r))
+      return false;
+    const double dx = end_x - start_x;
+    const double dy = end_y - start_y;
+    const double distance = sqrt(dx * dx + dy * dy);
+    // If the radius is too small to reach the end point, use the smallest possible radius (a half circle)
+    const double h_squared = (r - 0.5 * distance) * (r + 0.5 * distance);
+    const double h = h_squared > 0 ? sqrt(h_squared) : 0;
+    const double direction = (is_clockwise != (r < 0)) ? -1.0 : 1.0;
+    center_x = (start_x + end_x) * 0.5 + direction * h * (-dy / distance);
+    center_y = (start_y + end_y) * 0.5 + direction * h * (dx / distance);
+  }
+  else if (has_ij)
+  {
+    center_x = start_x + i;
+    center_y = start_y + j;
+  }
+  else
+    return false;
+
+  radius = utilities::get_cartesian_distance(start_x, start_y, center_x, center_y);
+  if (utilities::is_zero(radius))
+    return false;
+
+  start_angle = atan2(start_y - center_y, start_x - center_x);
+  if (is_full_circle)
+  {
+    sweep_angle = is_clockwise ? -GCODE_ARC_TWO_PI : GCODE_ARC_TWO_PI;
+    return true;
+  }
+  sweep_angle = atan2(end_y - center_y, end_x - center_x) - start_angle;
+  if (is_clockwise)
+  {
+    if (sweep_angle >= 0)
+      sweep_angle -= GCODE_ARC_TWO_PI;
+  }
+  else if (sweep_angle <= 0)
+    sweep_angle += GCODE_ARC_TWO_PI;
+  return true;
+}
+
+bool gcode_arc::try_create(const position& start, const position& end)
+{
+  if (!is_arc_command(end.command) || start.x_null || start.y_null || start.z_null || end.x_null || end.y_null ||
+    end.z_null)
+    return false;
+
+  double i = 0, j = 0, r = 0;
+  bool has_ij = false, has_r = false;
+  for (unsigned int index = 0; index < end.command.parameters.size(); index++)
+  {
+    const parsed_command_parameter& param = end.command.parameters[index];
+    if (param.name == "I")
+    {
+      has_ij = true;
+      i = param.double_value;
+    }
+    else if (param.name == "J")
+    {
+      has_ij = true;
+      j = param.double_value;
+    }
+    else if (param.name == "R")
+    {
+      has_r = true;
+      r = param.double_value;
+    }
+  }
+  return try_create(start.x, start.y, start.z, end.x, end.y, end.z, i, j, has_ij, r, has_r,
+                    end.command.command == "G2");
+}
+
+void gcode_arc::get_point(const double fraction, double& x, double& y, double& z) const
+{
+  if (fraction >= 1.0)
+  {
+    // Return the exact end point rather than accumulating rounding errors
+    x = end_x;
+    y = end_y;
+    z = end_z;
+    return;
+  }
+  const double angle = start_angle + sweep_angle * fraction;
+  x = center_x + radius * cos(angle);
+  y = center_y + radius * sin(angle);
+  z = start_z + (end_z - start_z) * fraction;
+}
+
+bool gcode_arc::contains_angle(const double angle) const
+{
+  // Get the angle travelled from the start angle in the direction of the arc
+  double travel = is_clockwise ? start_angle - angle : angle - start_angle;
+  travel = fmod(travel, GCODE_ARC_TWO_PI);
+  if (travel < 0)
+    travel += GCODE_ARC_TWO_PI;
+  return travel <= fabs(sweep_angle);
+}
+
+void gcode_arc::get_bounds(double& min_x, double& min_y, double& max_x, double& max_y) const
+{
+  min_x = start_x < end_x ? start_x : end_x;
+  max_x = start_x < end_x ? end_x : start_x;
+  min_y = start_y < end_y ? start_y : end_y;
+  max_y = start_y < end_y ? end_y : start_y;
+  // The arc can only extend past its end points where it crosses one of the axis through its center
+  if (contains_angle(0))
+    max_x = center_x + radius;
+  if (contains_angle(GCODE_ARC_HALF_PI))
+    max_y = center_y + radius;
+  if (contains_angle(GCODE_ARC_PI))
+    min_x = center_x - radius;
+  if (contains_angle(-GCODE_ARC_HALF_PI))
+    min_y = center_y - radius;
+}
+
+double gcode_arc::get_max_distance(const double x, const double y) const
+{
+  const double start_distance = utilities::get_cartesian_distance(start_x, start_y, x, y);
+  const double end_distance = utilities::get_cartesian_distance(end_x, end_y, x, y);
+  // The farthest point on the circle is directly opposite of the given point
+  const double center_distance = utilities::get_cartesian_distance(center_x, center_y, x, y);
+  if (!utilities::is_zero(center_distance) && contains_angle(atan2(center_y - y, center_x - x)))
+    return center_distance + radius;
+  return start_distance > end_distance ? start_distance : end_distance;
+}
+
+unsigned int gcode_arc::get_segment_count(const double chord_tolerance) const
+{
+  // The largest angle a chord can span while staying within the tolerance of the arc
+  const double cos_half_angle = 1.0 - chord_tolerance / radius;
+  if (cos_half_angle <= -1.0)
+    return 1;
+  const double max_segment_angle = 2.0 * acos(cos_half_angle);
+  if (max_segment_angle <= 0)
+    return GCODE_ARC_MAX_SEGMENTS;
+  const double segments = ceil(fabs(sweep_angle) / max_segment_angle);
+  if (segments >= GCODE_ARC_MAX_SEGMENTS)
+    return GCODE_ARC_MAX_SEGMENTS;
+  return segments < 1 ? 1 : static_cast<unsigned int>(segments);
+}
+
+void gcode_arc::split(const position& start, const position& end, const double fraction, parsed_command& first,
+                      parsed_command& second) const
+{
+  double split_x, split_y, split_z;
+  get_point(fraction, split_x, split_y, split_z);
+
+  bool has_z = false, has_e = false, has_f = false;
+  double f = 0;
+  for (unsigned int index = 0; index < end.command.parameters.size(); index++)
+  {
+    const parsed_command_parameter& param = end.command.parameters[index];
+    if (param.name == "Z")
+      has_z = true;
+    else if (param.name == "E")
+      has_e = true;
+    else if (param.name == "F")
+    {
+      has_f = true;
+      f = param.double_value;
+    }
+  }
+
+  const double start_e = start.get_extruder(end.current_tool).e;
+  const double end_e = end.get_current_extruder().e;
+  const double split_e = start_e + (end_e - start_e) * fraction;
+
+  double first_x, first_y, first_z, first_e, second_x, second_y, second_z, second_e;
+  if (end.is_relative)
+  {
+    first_x = split_x - start_x;
+    first_y = split_y - start_y;
+    first_z = split_z - start_z;
+    second_x = end_x - split_x;
+    second_y = end_y - split_y;
+    second_z = end_z - split_z;
+  }
+  else
+  {
+    first_x = split_x - end.x_offset + end.x_firmware_offset;
+    first_y = split_y - end.y_offset + end.y_firmware_offset;
+    first_z = split_z - end.z_offset + end.z_firmware_offset;
+    second_x = end_x - end.x_offset + end.x_firmware_offset;
+    second_y = end_y - end.y_offset + end.y_firmware_offset;
+    second_z = end_z - end.z_offset + end.z_firmware_offset;
+  }
+  if (end.is_extruder_relative)
+  {
+    first_e = split_e - start_e;
+    second_e = end_e - split_e;
+  }
+  else
+  {
+    first_e = split_e - end.get_current_extruder().e_offset;
+    second_e = end_e - end.get_current_extruder().e_offset;
+  }
+
+  first.clear();
+  first.command = end.command.command;
+  first.is_known_command = true;
+  first.is_empty = false;
+  first.parameters.push_back(parsed_command_parameter("X", first_x));
+  first.parameters.push_back(parsed_command_parameter("Y", first_y));
+  if (has_z)
+    first.parameters.push_back(parsed_command_parameter("Z", first_z));
+  first.parameters.push_back(parsed_command_parameter("I", center_x - start_x));
+  first.parameters.push_back(parsed_command_parameter("J", center_y - start_y));
+  if (has_e)
+    first.parameters.push_back(parsed_command_parameter("E", first_e));
+  if (has_f)
+    first.parameters.push_back(parsed_command_parameter("F", f));
+  first.update_gcode_string();
+
+  second.clear();
+  second.command = end.command.command;
+  second.is_known_command = true;
+  second.is_empty = false;
+  second.parameters.push_back(parsed_command_parameter("X", second_x));
+  second.parameters.push_back(parsed_command_parameter("Y", second_y));
+  if (has_z)
+    second.parameters.push_back(parsed_command_parameter("Z", second_z));
+  second.parameters.push_back(parsed_command_parameter("I", center_x - split_x));
+  second.parameters.push_back(parsed_command_parameter("J", center_y - split_y));
+  if (has_e)
+    second.parameters.push_back(parsed_command_parameter("E", second_e));
+  second.update_gcode_string();
+}
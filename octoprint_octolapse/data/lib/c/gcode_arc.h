@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef GCODE_ARC_H
+#define GCODE_ARC_H
+#include "position.h"
+#include "parsed_command.h"
+
+// The maximum number of segments an arc is divided into when sampling points along it
+const unsigned int GCODE_ARC_MAX_SEGMENTS = 1000;
+
+/**
+ * \brief The geometry of a G2/G3 arc in printer coordinates, including any helical Z travel.  Uses the same center
+ * resolution as Marlin:  I/J are offsets from the start position, and R selects the shorter arc when positive and
+ * the longer arc when negative.
+ */
+struct gcode_arc
+{
+  gcode_arc();
+  /**
+   * \brief Creates an arc from its start and end coordinates and the I/J or R parameters.
+   * \return false if the arc has no center (no I/J or R) or if an R form arc has no travel.
+   */
+  bool try_create(double start_x, double start_y, double start_z, double end_x, double end_y, double end_z, double i,
+                  double j, bool has_ij, double r, bool has_r, bool is_clockwise);
+  /**
+   * \brief Creates an arc from two positions, reading the I, J and R parameters from the end position's command.
+   * \return false if the end position is not a G2/G3, if any coordinate is null, or if the arc is invalid.
+   */
+  bool try_create(const position& start, const position& end);
+  /**
+   * \brief Gets the point at the given fraction (0 to 1) of the arc.
+   */
+  void get_point(double fraction, double& x, double& y, double& z) const;
+  /**
+   * \brief Gets the smallest rectangle that contains the entire arc.
+   */
+  void get_bounds(double& min_x, double& min_y, double& max_x, double& max_y) const;
+  /**
+   * \brief Gets the greatest distance between any point on the arc and the given point.
+   */
+  double get_max_distance(double x, double y) const;
+  /**
+   * \brief Gets the number of equal segments the arc must be divided into so that no chord deviates from the arc by
+   * more than the tolerance.
+   */
+  unsigned int get_segment_count(double chord_tolerance) const;
+  /**
+   * \brief Splits the arc command that moved from start to end into two arc commands that meet at the given fraction of
+   * the arc.  Both commands use I/J, even if the original used R, and preserve the axis modes and offsets of the end
+   * position.
+   */
+  void split(const position& start, const position& end, double fraction, parsed_command& first,
+             parsed_command& second) const;
+
+  static bool is_arc_command(const parsed_command& command);
+
+  double start_x;
+  double start_y;
+  double start_z;
+  double end_x;
+  double end_y;
+  double end_z;
+  double center_x;
+  double center_y;
+  double radius;
+  double start_angle;
+  // Positive for counter-clockwise (G3) arcs and negative for clockwise (G2) arcs
+  double sweep_angle;
+  bool is_clockwise;
+private:
+  bool contains_angle(double angle) const;
+};
+#endif
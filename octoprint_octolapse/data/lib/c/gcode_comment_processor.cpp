@@ -1,22 +1,272 @@
 #include "gcode_comment_processor.h"
-#include "utilities.h"
+#include <cctype>
+
+#define SECTION(text, dialects, section) \
+	{ text, comment_context_section, dialects, comment_marker_action_set_section, section, subsection_type_none, feature_type_unknown_feature, false }
+#define CLEAR_SECTION(text, dialects) \
+	{ text, comment_context_section, dialects, comment_marker_action_clear_section, section_type_no_section, subsection_type_none, feature_type_unknown_feature, true }
+#define SUBSECTION(text, dialects, subsection) \
+	{ text, comment_context_section, dialects, comment_marker_action_set_subsection, section_type_no_section, subsection, feature_type_unknown_feature, false }
+#define FEATURE(text, feature) \
+	{ text, comment_context_command, comment_dialect_slic3r_pe, comment_marker_action_set_feature, section_type_no_section, subsection_type_none, feature, false }
+
+// Every comment the processor understands.  Markers that differ only by case are listed once with all of their dialects.
+static const comment_marker COMMENT_MARKERS[] = {
+	// Shared by Cura, ideaMaker and Slic3r based slicers
+	SECTION("TYPE:SKIRT", comment_dialect_slic3r_pe | comment_dialect_cura | comment_dialect_idea_maker, section_type_skirt_section),
+	SECTION("TYPE:SUPPORT", comment_dialect_slic3r_pe | comment_dialect_cura | comment_dialect_idea_maker, section_type_support_section),
+	SECTION("TYPE:BRIM", comment_dialect_slic3r_pe | comment_dialect_idea_maker, section_type_skirt_section),
+	SECTION("TYPE:WALL-OUTER", comment_dialect_cura | comment_dialect_idea_maker, section_type_outer_perimeter_section),
+	SECTION("TYPE:WALL-INNER", comment_dialect_cura | comment_dialect_idea_maker, section_type_inner_perimeter_section),
+	SECTION("TYPE:FILL", comment_dialect_cura | comment_dialect_idea_maker, section_type_infill_section),
+	// Layer and mesh changes end the current section, but don't tell us which slicer we are using.
+	CLEAR_SECTION("LAYER:", comment_dialect_cura | comment_dialect_idea_maker),
+	CLEAR_SECTION("MESH:", comment_dialect_cura),
+
+	// Cura
+	SECTION("TYPE:SKIN", comment_dialect_cura, section_type_solid_infill_section),
+	SECTION("TYPE:SUPPORT-INTERFACE", comment_dialect_cura, section_type_support_section),
+	SECTION("TYPE:PRIME-TOWER", comment_dialect_cura, section_type_prime_pillar_section),
+
+	// ideaMaker
+	SECTION("TYPE:SOLID-FILL", comment_dialect_idea_maker, section_type_solid_infill_section),
+	SECTION("TYPE:RAFT", comment_dialect_idea_maker, section_type_support_section),
+
+	// Simplify 3D.  Apparently simplify 3d added the word 'feature' to the their feature comments
+	// at some point to make my life more difficult :P
+	SECTION("feature outer perimeter", comment_dialect_simplify_3d, section_type_outer_perimeter_section),
+	SECTION("feature inner perimeter", comment_dialect_simplify_3d, section_type_inner_perimeter_section),
+	SECTION("feature infill", comment_dialect_simplify_3d, section_type_infill_section),
+	SECTION("feature solid layer", comment_dialect_simplify_3d, section_type_solid_infill_section),
+	SECTION("feature skirt", comment_dialect_simplify_3d, section_type_skirt_section),
+	SECTION("feature ooze shield", comment_dialect_simplify_3d, section_type_ooze_shield_section),
+	SECTION("feature prime pillar", comment_dialect_simplify_3d, section_type_prime_pillar_section),
+	SECTION("feature gap fill", comment_dialect_simplify_3d, section_type_gap_fill_section),
+	SECTION("outer perimeter", comment_dialect_simplify_3d, section_type_outer_perimeter_section),
+	SECTION("inner perimeter", comment_dialect_simplify_3d, section_type_inner_perimeter_section),
+	SECTION("infill", comment_dialect_simplify_3d, section_type_infill_section),
+	SECTION("solid layer", comment_dialect_simplify_3d, section_type_solid_infill_section),
+	SECTION("skirt", comment_dialect_simplify_3d, section_type_skirt_section),
+	SECTION("ooze shield", comment_dialect_simplify_3d, section_type_ooze_shield_section),
+	SECTION("prime pillar", comment_dialect_simplify_3d, section_type_prime_pillar_section),
+	SECTION("gap fill", comment_dialect_simplify_3d, section_type_gap_fill_section),
+
+	// PrusaSlicer / SuperSlicer
+	SECTION("TYPE:Internal perimeter", comment_dialect_slic3r_pe, section_type_inner_perimeter_section),
+	SECTION("TYPE:Perimeter", comment_dialect_slic3r_pe, section_type_inner_perimeter_section),
+	SECTION("TYPE:External perimeter", comment_dialect_slic3r_pe, section_type_outer_perimeter_section),
+	SECTION("TYPE:Thin wall", comment_dialect_slic3r_pe, section_type_outer_perimeter_section),
+	SECTION("TYPE:Internal infill", comment_dialect_slic3r_pe, section_type_infill_section),
+	SECTION("TYPE:Solid infill", comment_dialect_slic3r_pe, section_type_solid_infill_section),
+	SECTION("TYPE:Top solid infill", comment_dialect_slic3r_pe, section_type_solid_infill_section),
+	SECTION("TYPE:Gap fill", comment_dialect_slic3r_pe, section_type_gap_fill_section),
+	SECTION("TYPE:Bridge infill", comment_dialect_slic3r_pe, section_type_bridge_section),
+	SECTION("TYPE:Internal bridge infill", comment_dialect_slic3r_pe, section_type_bridge_section),
+	SECTION("TYPE:Overhang perimeter", comment_dialect_slic3r_pe, section_type_bridge_section),
+	SECTION("TYPE:Skirt/Brim", comment_dialect_slic3r_pe, section_type_skirt_section),
+	// no "support" feature on octolapse. Maybe feature_type_prime_pillar_feature ?
+	// If we lable this feature as unknown, it will be absolutely last on the 'quality' order, which is what we want.
+	SECTION("TYPE:Support material", comment_dialect_slic3r_pe, section_type_support_section),
+	SECTION("TYPE:Support material interface", comment_dialect_slic3r_pe, section_type_support_section),
+	SECTION("TYPE:Wipe tower", comment_dialect_slic3r_pe, section_type_prime_pillar_section),
+	SECTION("CP TOOLCHANGE WIPE", comment_dialect_slic3r_pe, section_type_prime_pillar_section),
+	// OrcaSlicer / BambuStudio
+	SECTION("TYPE:Outer wall", comment_dialect_slic3r_pe, section_type_outer_perimeter_section),
+	SECTION("TYPE:Inner wall", comment_dialect_slic3r_pe, section_type_inner_perimeter_section),
+	SECTION("TYPE:Overhang wall", comment_dialect_slic3r_pe, section_type_bridge_section),
+	SECTION("TYPE:Sparse infill", comment_dialect_slic3r_pe, section_type_infill_section),
+	SECTION("TYPE:Internal solid infill", comment_dialect_slic3r_pe, section_type_solid_infill_section),
+	SECTION("TYPE:Top surface", comment_dialect_slic3r_pe, section_type_solid_infill_section),
+	SECTION("TYPE:Bottom surface", comment_dialect_slic3r_pe, section_type_solid_infill_section),
+	SECTION("TYPE:Gap infill", comment_dialect_slic3r_pe, section_type_gap_fill_section),
+	SECTION("TYPE:Bridge", comment_dialect_slic3r_pe, section_type_bridge_section),
+	SECTION("TYPE:Support interface", comment_dialect_slic3r_pe, section_type_support_section),
+	SECTION("TYPE:Support transition", comment_dialect_slic3r_pe, section_type_support_section),
+	SECTION("TYPE:Prime tower", comment_dialect_slic3r_pe, section_type_prime_pillar_section),
+	// Here are some features we want to just ignore.  Might want to think about ironing.
+	SECTION("TYPE:Mill", comment_dialect_slic3r_pe, section_type_no_section),
+	SECTION("TYPE:Unknown", comment_dialect_slic3r_pe, section_type_no_section),
+	SECTION("TYPE:Custom", comment_dialect_slic3r_pe, section_type_no_section),
+	SECTION("TYPE:Mixed", comment_dialect_slic3r_pe, section_type_no_section),
+	SECTION("TYPE:Ironing", comment_dialect_slic3r_pe, section_type_no_section),
+	// End section codes (we don't want to apply ANY features if we hit these comments)
+	SECTION("CP TOOLCHANGE END", comment_dialect_slic3r_pe, section_type_no_section),
+	SECTION("LAYER_CHANGE", comment_dialect_slic3r_pe, section_type_no_section),
+	SECTION("BEFORE_LAYER_CHANGE", comment_dialect_slic3r_pe, section_type_no_section),
+	SECTION("AFTER_LAYER_CHANGE", comment_dialect_slic3r_pe, section_type_no_section),
+	SECTION("CHANGE_LAYER", comment_dialect_slic3r_pe, section_type_no_section),
+	// Subsection codes (wipe so far)
+	SUBSECTION("WIPE_START", comment_dialect_slic3r_pe, subsection_type_wipe),
+	SUBSECTION("WIPE_END", comment_dialect_slic3r_pe, subsection_type_none),
+
+	// Slic3r PE verbose comments, which follow the command
+	// External Perimeter - SuperSlicer.  Also, adding overhang perimeter here too.
+	FEATURE("external perimeter", feature_type_outer_perimeter_feature),
+	FEATURE("overhang perimeter", feature_type_outer_perimeter_feature),
+	FEATURE("move to first external perimeter point", feature_type_outer_perimeter_feature),
+	// Internal Perimeter - SuperSlicer
+	FEATURE("internal perimeter", feature_type_inner_perimeter_feature),
+	FEATURE("move to first internal perimeter point", feature_type_inner_perimeter_feature),
+	FEATURE("perimeter", feature_type_unknown_perimeter_feature),
+	FEATURE("move to first perimeter point", feature_type_unknown_perimeter_feature),
+	FEATURE("infill", feature_type_infill_feature),
+	FEATURE("move to first infill point", feature_type_infill_feature),
+	// Solid Infill/Top Solid Infill - SuperSlicer
+	FEATURE("solid infill", feature_type_solid_infill_feature),
+	FEATURE("move to first solid infill point", feature_type_solid_infill_feature),
+	FEATURE("top solid infill", feature_type_solid_infill_feature),
+	FEATURE("move to first top solid infill point", feature_type_solid_infill_feature),
+	// Gap Fill - SuperSlicer
+	FEATURE("gap fill", feature_type_gap_fill_feature),
+	FEATURE("move to first gap fill point", feature_type_gap_fill_feature),
+	// bridge infill - SuperSlicer
+	FEATURE("infill(bridge)", feature_type_bridge_feature),
+	FEATURE("move to first infill(bridge) point", feature_type_bridge_feature),
+	FEATURE("internal bridge infill", feature_type_bridge_feature),
+	FEATURE("move to first internal bridge infill point", feature_type_bridge_feature),
+	FEATURE("skirt", feature_type_skirt_feature),
+	FEATURE("move to first skirt point", feature_type_skirt_feature)
+};
+
+#undef SECTION
+#undef CLEAR_SECTION
+#undef SUBSECTION
+#undef FEATURE
+
+static inline char fold_comment_char(char c)
+{
+	return static_cast<char>(std::tolower(static_cast<unsigned char>(c)));
+}
+
+static inline bool is_comment_whitespace(char c)
+{
+	return c == ' ' || c == '\t' || c == '\r' || c == '\n' || c == '\f' || c == '\v';
+}
+
+#pragma region comment_marker_trie
+comment_marker_trie::comment_marker_trie(const comment_marker* markers, int num_markers)
+{
+	markers_ = markers;
+	node root;
+	root.character = '\0';
+	root.first_child = -1;
+	root.next_sibling = -1;
+	nodes_.push_back(root);
+
+	for (int marker_index = 0; marker_index < num_markers; marker_index++)
+	{
+		int current = 0;
+		for (const char* p = markers[marker_index].text; *p != '\0'; p++)
+		{
+			const char c = fold_comment_char(*p);
+			int child = get_child(current, c);
+			if (child < 0)
+			{
+				node new_node;
+				new_node.character = c;
+				new_node.first_child = -1;
+				new_node.next_sibling = nodes_[current].first_child;
+				child = static_cast<int>(nodes_.size());
+				nodes_.push_back(new_node);
+				nodes_[current].first_child = child;
+			}
+			current = child;
+		}
+		nodes_[current].markers.push_back(marker_index);
+	}
+}
+
+int comment_marker_trie::get_child(int node_index, char character) const
+{
+	for (int child = nodes_[node_index].first_child; child >= 0; child = nodes_[child].next_sibling)
+	{
+		if (nodes_[child].character == character)
+			return child;
+	}
+	return -1;
+}
+
+const comment_marker* comment_marker_trie::find_marker(const node& current_node, comment_context context,
+	int dialects, bool is_prefix) const
+{
+	for (std::vector<int>::const_iterator it = current_node.markers.begin(); it != current_node.markers.end(); ++it)
+	{
+		const comment_marker& marker = markers_[*it];
+		if (marker.context == context && marker.is_prefix == is_prefix && (marker.dialects & dialects) != 0)
+			return &marker;
+	}
+	return NULL;
+}
+
+const comment_marker* comment_marker_trie::find(const std::string& comment, comment_context context,
+	int dialects) const
+{
+	std::string::size_type start = 0;
+	std::string::size_type end = comment.length();
+	while (start < end && is_comment_whitespace(comment[start]))
+		start++;
+	while (end > start && is_comment_whitespace(comment[end - 1]))
+		end--;
+	if (start == end)
+		return NULL;
+
+	const comment_marker* prefix_marker = NULL;
+	int current = 0;
+	for (std::string::size_type index = start; index < end; index++)
+	{
+		current = get_child(current, fold_comment_char(comment[index]));
+		if (current < 0)
+			return prefix_marker;
+		// Any prefix ending here is longer than the ones we've already seen
+		const comment_marker* marker = find_marker(nodes_[current], context, dialects, true);
+		if (marker != NULL)
+			prefix_marker = marker;
+	}
+	const comment_marker* exact_marker = find_marker(nodes_[current], context, dialects, false);
+	return exact_marker != NULL ? exact_marker : prefix_marker;
+}
+#pragma endregion
+
 gcode_comment_processor::gcode_comment_processor()
 {
 	current_section_ = section_type_no_section;
 	current_subsection_ = subsection_type_none;
 	processing_type_ = comment_process_type_unknown;
-	
+	dialects_ = comment_dialect_all;
 }
 
 gcode_comment_processor::~gcode_comment_processor()
 {
 }
 
+const comment_marker_trie& gcode_comment_processor::get_marker_trie()
+{
+	// Built once and shared by every processor
+	static const comment_marker_trie trie(COMMENT_MARKERS, sizeof(COMMENT_MARKERS) / sizeof(COMMENT_MARKERS[0]));
+	return trie;
+}
+
 comment_process_type gcode_comment_processor::get_comment_process_type()
 {
 	return processing_type_;
 }
 
+void gcode_comment_processor::set_dialects(int dialects)
+{
+	dialects_ &= dialects;
+	if (processing_type_ == comment_process_type_off || dialects_ == comment_dialect_all)
+		return;
+	// When the markers seen so far are shared by several slicers, prefer them in the order they were originally detected.
+	if ((dialects_ & comment_dialect_cura) != 0)
+		processing_type_ = comment_process_type_cura;
+	else if ((dialects_ & comment_dialect_simplify_3d) != 0)
+		processing_type_ = comment_process_type_simplify_3d;
+	else if ((dialects_ & comment_dialect_slic3r_pe) != 0)
+		processing_type_ = comment_process_type_slic3r_pe;
+	else
+		processing_type_ = comment_process_type_idea_maker;
+}
+
 void gcode_comment_processor::update(position& pos)
 {
 	if (processing_type_ == comment_process_type_off)
@@ -28,66 +278,15 @@ void gcode_comment_processor::update(position& pos)
 		return;
 	}
 
-	if (processing_type_ == comment_process_type_unknown || processing_type_ == comment_process_type_slic3r_pe)
+	if ((dialects_ & comment_dialect_slic3r_pe) != 0)
 	{
-		if (update_feature_for_slic3r_pe_comment(pos, pos.command.comment))
-			processing_type_ = comment_process_type_slic3r_pe;
-	}
-}
-
-bool gcode_comment_processor::update_feature_for_slic3r_pe_comment(position& pos, std::string& comment) const
-{
-	// External Perimeter - SuperSlicer
-	// Also, adding overhang perimeter here too.
-	if (utilities::is_in_caseless_trim(comment, SLICER_PE_OUTER_PERIMETER_COMMENTS))
-	{
-		pos.feature_type_tag = feature_type_outer_perimeter_feature;
-		return true;
-	}
-	// Internal Perimeter - SuperSlicer
-	if (utilities::is_in_caseless_trim(comment, SLICER_PE_INNER_PERIMETER_COMMENTS))
-	{
-		pos.feature_type_tag = feature_type_inner_perimeter_feature;
-		return true;
-	}
-	if (utilities::is_in_caseless_trim(comment, SLICER_PE_UNKNOWN_PERIMETER_COMMENTS))
-	{
-		pos.feature_type_tag = feature_type_unknown_perimeter_feature;
-		return true;
-	}
-
-	if (utilities::is_in_caseless_trim(comment, SLICER_PE_INFILL_COMMENTS))
-	{
-		pos.feature_type_tag = feature_type_infill_feature;
-		return true;
-	}
-	// Solid Infill/Top Solid Infill - SuperSlicer
-	if (utilities::is_in_caseless_trim(comment, SLICER_PE_SOLID_INFILL_COMMENTS))
-	{
-		pos.feature_type_tag = feature_type_solid_infill_feature;
-		return true;
-	}
-
-	// Gap Fill - SuperSlicer
-	if (utilities::is_in_caseless_trim(comment, SLICER_PE_GAP_FILL_COMMENTS))
-	{
-		pos.feature_type_tag = feature_type_gap_fill_feature;
-		return true;
-	}
-
-	// bridge infill - SuperSlicer
-	if (utilities::is_in_caseless_trim(comment, SLICER_PE_BRIDGE_COMMENTS))
-	{
-		pos.feature_type_tag = feature_type_bridge_feature;
-		return true;
-	}
-
-	if (utilities::is_in_caseless_trim(comment, SLICER_PE_SKIRT_COMMENTS))
-	{
-		pos.feature_type_tag = feature_type_skirt_feature;
-		return true;
+		const comment_marker* marker = get_marker_trie().find(pos.command.comment, comment_context_command, dialects_);
+		if (marker != NULL)
+		{
+			pos.feature_type_tag = marker->feature;
+			set_dialects(marker->dialects);
+		}
 	}
-	return false;
 }
 
 void gcode_comment_processor::update_feature_from_section(position& pos) const
@@ -132,281 +331,27 @@ void gcode_comment_processor::update_feature_from_section(position& pos) const
 
 void gcode_comment_processor::update(std::string& comment)
 {
-	switch (processing_type_)
-	{
-	case comment_process_type_off:
-		break;
-	case comment_process_type_unknown:
-		update_unknown_section(comment);
-		break;
-	case comment_process_type_cura:
-		update_cura_section(comment);
-		break;
-	case comment_process_type_slic3r_pe:
-		update_slic3r_pe_section(comment);
-		break;
-	case comment_process_type_simplify_3d:
-		update_simplify_3d_section(comment);
-		break;
-	}
-}
-
-void gcode_comment_processor::update_unknown_section(std::string& comment)
-{
-	if (comment.length() == 0)
+	if (processing_type_ == comment_process_type_off || comment.length() == 0)
 		return;
 
-	if (update_cura_section(comment))
-	{
-		processing_type_ = comment_process_type_cura;
+	const comment_marker* marker = get_marker_trie().find(comment, comment_context_section, dialects_);
+	if (marker == NULL)
 		return;
-	}
 
-	if (update_simplify_3d_section(comment))
-	{
-		processing_type_ = comment_process_type_simplify_3d;
-		return;
-	}
-	if (update_slic3r_pe_section(comment))
-	{
-		processing_type_ = comment_process_type_slic3r_pe;
-		return;
-	}
-}
-
-bool gcode_comment_processor::update_cura_section(std::string& comment)
-{
-	if (comment == "TYPE:WALL-OUTER")
-	{
-		current_section_ = section_type_outer_perimeter_section;
-		return true;
-	}
-	else if (comment == "TYPE:WALL-INNER")
-	{
-		current_section_ = section_type_inner_perimeter_section;
-		return true;
-	}
-	if (comment == "TYPE:FILL")
-	{
-		current_section_ = section_type_infill_section;
-		return true;
-	}
-	if (comment == "TYPE:SKIN")
-	{
-		current_section_ = section_type_solid_infill_section;
-		return true;
-	}
-	if (comment.rfind("LAYER:", 0) != std::string::npos || comment.rfind(";MESH:NONMESH", 0) != std::string::npos)
-	{
-		current_section_ = section_type_no_section;
-		return false;
-	}
-	if (comment == "TYPE:SKIRT")
-	{
-		current_section_ = section_type_skirt_section;
-		return true;
-	}
-	return false;
-}
-
-bool gcode_comment_processor::update_simplify_3d_section(std::string& comment)
-{
-	// Apparently simplify 3d added the word 'feature' to the their feature comments
-	// at some point to make my life more difficult :P
-	if (comment.rfind("feature", 0) != std::string::npos)
-	{
-		if (comment == "feature outer perimeter")
-		{
-			current_section_ = section_type_outer_perimeter_section;
-			return true;
-		}
-		if (comment == "feature inner perimeter")
-		{
-			current_section_ = section_type_inner_perimeter_section;
-			return true;
-		}
-		if (comment == "feature infill")
-		{
-			current_section_ = section_type_infill_section;
-			return true;
-		}
-		if (comment == "feature solid layer")
-		{
-			current_section_ = section_type_solid_infill_section;
-			return true;
-		}
-		if (comment == "feature skirt")
-		{
-			current_section_ = section_type_skirt_section;
-			return true;
-		}
-		if (comment == "feature ooze shield")
-		{
-			current_section_ = section_type_ooze_shield_section;
-			return true;
-		}
-		if (comment == "feature prime pillar")
-		{
-			current_section_ = section_type_prime_pillar_section;
-			return true;
-		}
-		if (comment == "feature gap fill")
-		{
-			current_section_ = section_type_gap_fill_section;
-			return true;
-		}
-	}
-	else
-	{
-		if (comment == "outer perimeter")
-		{
-			current_section_ = section_type_outer_perimeter_section;
-			return true;
-		}
-		if (comment == "inner perimeter")
-		{
-			current_section_ = section_type_inner_perimeter_section;
-			return true;
-		}
-		if (comment == "infill")
-		{
-			current_section_ = section_type_infill_section;
-			return true;
-		}
-		if (comment == "solid layer")
-		{
-			current_section_ = section_type_solid_infill_section;
-			return true;
-		}
-		if (comment == "skirt")
-		{
-			current_section_ = section_type_skirt_section;
-			return true;
-		}
-		if (comment == "ooze shield")
-		{
-			current_section_ = section_type_ooze_shield_section;
-			return true;
-		}
-
-		if (comment == "prime pillar")
-		{
-			current_section_ = section_type_prime_pillar_section;
-			return true;
-		}
-
-		if (comment == "gap fill")
-		{
-			current_section_ = section_type_gap_fill_section;
-			return true;
-		}
-	}
-
-
-	return false;
-}
-
-bool gcode_comment_processor::update_slic3r_pe_section(std::string& comment)
-{
-	// PrusaSlicer / SuperSlicer tags
-	if (comment == "TYPE:Internal perimeter"
-		|| comment == "TYPE:Perimeter")
-	{
-		current_section_ = section_type_inner_perimeter_section;
-		return true;
-	}
-	if (comment == "TYPE:External perimeter"
-		|| comment == "TYPE:Thin wall")
-	{
-		current_section_ = section_type_outer_perimeter_section;
-		return true;
-	}
-	if (comment == "TYPE:Internal infill")
-	{
-		current_section_ = section_type_infill_section;
-		return true;
-	}
-	if (comment == "TYPE:Solid infill"
-		|| comment == "TYPE:Top solid infill")
-	{
-		current_section_ = section_type_solid_infill_section;
-		
-		return true;
-	}
-	if (comment == "TYPE:Gap fill")
-	{
-		current_section_ = section_type_gap_fill_section;
-		return true;
-	}
-	if (comment == "TYPE:Bridge infill"
-		|| comment == "TYPE:Internal bridge infill"
-		|| comment == "TYPE:Overhang perimeter")
-	{
-		current_section_ = section_type_bridge_section;
-		return true;
-	}
-	if (comment == "TYPE:Skirt")
-	{
-		current_section_ = section_type_skirt_section;
-		return true;
-	}
-	if (comment == "TYPE:Support material"
-		|| comment == "TYPE:Support material interface")
-	{
-		// no "support" feature on octolapse. Maybe feature_type_prime_pillar_feature ?
-		// If we lable this feature as unknown, it will be absolutely last on the 'quality' order, which is what we want.
-		current_section_ = section_type_support_section;
-		return true;
-	}
-	if (comment == "TYPE:Wipe tower")
-	{
-		current_section_ = section_type_prime_pillar_section;
-		return true;
-	}
-
-	// Here are some features we want to just ignore.  Might want to think about ironing.
-	if (comment == "TYPE:Mill"
-		|| comment == "TYPE:Unknown"
-		|| comment == "TYPE:Custom"
-		|| comment == "TYPE:Mixed"
-		|| comment == "TYPE:Ironing")
-	{
-		current_section_ = section_type_no_section;
-		return true;
-	}
-
-
-	if (comment == "CP TOOLCHANGE WIPE")
-	{
-		current_section_ = section_type_prime_pillar_section;
-		return true;
-	}
-
-	// End section codes (we don't want to apply ANY features if we hit these comments)
-	
-	if (comment == "CP TOOLCHANGE END" // Reset section on end of tool change
-		|| comment == "LAYER_CHANGE" // Reset section on layer change
-		|| comment == "BEFORE_LAYER_CHANGE" // Reset section on layer change
-		|| comment == "AFTER_LAYER_CHANGE" // Reset section on layer change
-	)
+	switch (marker->action)
 	{
+	case comment_marker_action_set_section:
+		current_section_ = marker->section;
+		set_dialects(marker->dialects);
+		break;
+	case comment_marker_action_clear_section:
 		current_section_ = section_type_no_section;
-		return true;
-	}
-
-	// Now look for subsection codes (wipe so far)
-	if (comment == "WIPE_START")
-	{
-		current_subsection_ = subsection_type_wipe;
-		return true;
-	}
-
-	if (comment == "WIPE_END")
-	{
-		current_subsection_ = subsection_type_none;
-		return true;
+		break;
+	case comment_marker_action_set_subsection:
+		current_subsection_ = marker->subsection;
+		set_dialects(marker->dialects);
+		break;
+	case comment_marker_action_set_feature:
+		break;
 	}
-
-
-	return false;
 }
@@ -1,4 +1,6 @@
 #pragma once
+#include <string>
+#include <vector>
 #include "position.h"
 #define NUM_FEATURE_TYPES 12
 
@@ -30,7 +32,8 @@ enum comment_process_type
   comment_process_type_unknown,
   comment_process_type_slic3r_pe,
   comment_process_type_cura,
-  comment_process_type_simplify_3d
+  comment_process_type_simplify_3d,
+  comment_process_type_idea_maker
 };
 
 // used for marking slicer sections for cura and simplify 3d
@@ -56,25 +59,80 @@ enum subsection_type
 	subsection_type_wipe
 };
 
-// Static strings for slicer comment extraction
-// Note these must all be lower case, no beginning or trailing whitespace, and the arrays must be null terminated.
-static const char* SLICER_PE_OUTER_PERIMETER_COMMENTS[] = {
-  "external perimeter", "overhang perimeter", "move to first external perimeter point", NULL
+// The slicer dialects that can write a comment marker.  Slic3r PE includes PrusaSlicer, SuperSlicer and OrcaSlicer.
+enum comment_dialect
+{
+  comment_dialect_slic3r_pe = 1,
+  comment_dialect_cura = 2,
+  comment_dialect_simplify_3d = 4,
+  comment_dialect_idea_maker = 8,
+  comment_dialect_all = 15
+};
+
+// Where a comment marker can appear
+enum comment_context
+{
+  // A comment on its own line, which starts a section
+  comment_context_section,
+  // A comment following a command, like the ones Slic3r writes in verbose mode
+  comment_context_command
 };
-static const char* SLICER_PE_INNER_PERIMETER_COMMENTS[] = {
-  "internal perimeter", "move to first internal perimeter point", NULL
+
+enum comment_marker_action
+{
+  // Set the current section, which identifies the slicer
+  comment_marker_action_set_section,
+  // Clear the current section without identifying the slicer (layer changes, etc)
+  comment_marker_action_clear_section,
+  comment_marker_action_set_subsection,
+  // Set the feature of the current command
+  comment_marker_action_set_feature
 };
-static const char* SLICER_PE_UNKNOWN_PERIMETER_COMMENTS[] = {"perimeter", "move to first perimeter point", NULL};
-static const char* SLICER_PE_INFILL_COMMENTS[] = {"infill", "move to first infill point", NULL};
-static const char* SLICER_PE_SOLID_INFILL_COMMENTS[] = {
-  "solid infill", "move to first solid infill point", "top solid infill", "move to first top solid infill point", NULL
+
+/**
+ * \brief A known slicer comment.  Markers are matched without regard to case or surrounding whitespace.
+ */
+struct comment_marker
+{
+  const char* text;
+  comment_context context;
+  // A combination of comment_dialect flags
+  int dialects;
+  comment_marker_action action;
+  section_type section;
+  subsection_type subsection;
+  feature_type feature;
+  // If true the marker only needs to match the start of the comment
+  bool is_prefix;
 };
-static const char* SLICER_PE_GAP_FILL_COMMENTS[] = {"gap fill", "move to first gap fill point", NULL};
-static const char* SLICER_PE_BRIDGE_COMMENTS[] = {
-  "infill(bridge)", "move to first infill(bridge) point", "internal bridge infill",
-  "move to first internal bridge infill point", NULL
+
+/**
+ * \brief A trie over the case folded text of every comment marker, so that a comment is classified in a single pass.
+ */
+class comment_marker_trie
+{
+public:
+  comment_marker_trie(const comment_marker* markers, int num_markers);
+  /**
+   * \brief Finds the marker matching the comment in the given context and dialects, or NULL.  Exact matches take
+   * precedence over prefix matches, and longer prefixes over shorter ones.
+   */
+  const comment_marker* find(const std::string& comment, comment_context context, int dialects) const;
+private:
+  struct node
+  {
+    char character;
+    int first_child;
+    int next_sibling;
+    // Indexes into markers_ of the markers ending at this node
+    std::vector<int> markers;
+  };
+  std::vector<node> nodes_;
+  const comment_marker* markers_;
+  int get_child(int node_index, char character) const;
+  const comment_marker* find_marker(const node& current_node, comment_context context, int dialects,
+                                    bool is_prefix) const;
 };
-static const char* SLICER_PE_SKIRT_COMMENTS[] = {"skirt", "move to first skirt point", NULL};
 
 class gcode_comment_processor
 {
@@ -91,16 +149,10 @@ private:
   subsection_type current_subsection_;
 
   comment_process_type processing_type_;
+  // The comment_dialect flags of the slicers that could have written every marker seen so far
+  int dialects_;
   
   void update_feature_from_section(position& pos) const;
-  bool update_feature_from_section_from_section(position& pos) const;
-  bool update_feature_from_section_for_cura(position& pos) const;
-  bool update_feature_from_section_for_simplify_3d(position& pos) const;
-  bool update_feature_from_section_for_slice3r_pe(position& pos) const;
-  void update_feature_for_unknown_slicer_comment(position& pos, std::string& comment);
-  bool update_feature_for_slic3r_pe_comment(position& pos, std::string& comment) const;
-  void update_unknown_section(std::string& comment);
-  bool update_cura_section(std::string& comment);
-  bool update_simplify_3d_section(std::string& comment);
-  bool update_slic3r_pe_section(std::string& comment);
+  void set_dialects(int dialects);
+  static const comment_marker_trie& get_marker_trie();
 };
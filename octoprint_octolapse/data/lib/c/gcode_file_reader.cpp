@@ -0,0 +1,404 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Use 64 bit offsets for mmap, pread and fstat where long is 32 bits.  This must come before any include.
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+#include "gcode_file_reader.h"
+#include "gzip_decoder.h"
+#include "bgcode_decoder.h"
+#include "utilities.h"
+#include <algorithm>
+#include <cstring>
+#ifdef _MSC_VER
+#include <Windows.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/mman.h>
+#include <cerrno>
+#endif
+
+static long long get_allocation_granularity()
+{
+#ifdef _MSC_VER
+  SYSTEM_INFO system_info;
+  GetSystemInfo(&system_info);
+  return static_cast<long long>(system_info.dwAllocationGranularity);
+#else
+  const long page_size = sysconf(_SC_PAGESIZE);
+  return page_size > 0 ? static_cast<long long>(page_size) : 4096;
+#endif
+}
+
+gcode_file_reader::gcode_file_reader()
+{
+  window_size_ = GCODE_FILE_READER_WINDOW_SIZE;
+  file_size_ = 0;
+  position_ = 0;
+  window_offset_ = 0;
+  window_length_ = 0;
+  data_ = NULL;
+  view_ = NULL;
+  view_length_ = 0;
+  map_file_ = true;
+  is_mapped_ = true;
+  has_error_ = false;
+  decoder_ = NULL;
+#ifdef _MSC_VER
+  file_handle_ = INVALID_HANDLE_VALUE;
+  mapping_handle_ = NULL;
+#else
+  fd_ = -1;
+#endif
+}
+
+gcode_file_reader::gcode_file_reader(const long long window_size, const bool map_file) : gcode_file_reader()
+{
+  if (window_size > 0)
+    window_size_ = window_size;
+  map_file_ = map_file;
+  is_mapped_ = map_file;
+}
+
+gcode_file_reader::~gcode_file_reader()
+{
+  close();
+}
+
+bool gcode_file_reader::open(const std::string& file_path, const bool decompress)
+{
+  close();
+#ifdef _MSC_VER
+  std::wstring wpath = utilities::ToUtf16(file_path);
+  file_handle_ = CreateFileW(
+    wpath.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL
+  );
+  if (file_handle_ == INVALID_HANDLE_VALUE)
+    return false;
+  LARGE_INTEGER file_size;
+  if (!GetFileSizeEx(file_handle_, &file_size))
+  {
+    close();
+    return false;
+  }
+  file_size_ = static_cast<long long>(file_size.QuadPart);
+  // An empty file can't be mapped, but there is nothing to read either.
+  if (file_size_ > 0 && map_file_)
+  {
+    mapping_handle_ = CreateFileMappingW(file_handle_, NULL, PAGE_READONLY, 0, 0, NULL);
+    is_mapped_ = mapping_handle_ != NULL;
+  }
+#else
+  fd_ = ::open(file_path.c_str(), O_RDONLY);
+  if (fd_ < 0)
+    return false;
+  struct stat file_stat;
+  if (fstat(fd_, &file_stat) != 0)
+  {
+    close();
+    return false;
+  }
+  file_size_ = static_cast<long long>(file_stat.st_size);
+#endif
+  if (decompress)
+  {
+    const long long header_length = std::min<long long>(file_size_, 4);
+    const char* header = get_range(0, header_length);
+    if (header != NULL && gzip_decoder::is_gzip(header, header_length))
+      decoder_ = new gzip_decoder();
+    else if (header != NULL && bgcode_decoder::is_bgcode(header, header_length))
+      decoder_ = new bgcode_decoder();
+    if (decoder_ != NULL)
+    {
+      unmap_window();
+      if (!decoder_->open(file_path))
+      {
+        close();
+        return false;
+      }
+    }
+    unmap_window();
+    std::vector<char>().swap(buffer_);
+    window_offset_ = 0;
+    window_length_ = 0;
+    data_ = NULL;
+  }
+  return true;
+}
+
+void gcode_file_reader::close()
+{
+  if (decoder_ != NULL)
+  {
+    delete decoder_;
+    decoder_ = NULL;
+  }
+  unmap_window();
+#ifdef _MSC_VER
+  if (mapping_handle_ != NULL)
+    CloseHandle(mapping_handle_);
+  if (file_handle_ != INVALID_HANDLE_VALUE)
+    CloseHandle(file_handle_);
+  mapping_handle_ = NULL;
+  file_handle_ = INVALID_HANDLE_VALUE;
+#else
+  if (fd_ > -1)
+    ::close(fd_);
+  fd_ = -1;
+#endif
+  std::vector<char>().swap(buffer_);
+  file_size_ = 0;
+  position_ = 0;
+  window_offset_ = 0;
+  window_length_ = 0;
+  data_ = NULL;
+  is_mapped_ = map_file_;
+  has_error_ = false;
+}
+
+bool gcode_file_reader::is_open() const
+{
+#ifdef _MSC_VER
+  return file_handle_ != INVALID_HANDLE_VALUE;
+#else
+  return fd_ > -1;
+#endif
+}
+
+bool gcode_file_reader::read_line(std::string& line)
+{
+  line.clear();
+  bool has_line = false;
+  while (!has_error_)
+  {
+    if (position_ < window_offset_ || position_ >= window_offset_ + window_length_)
+    {
+      if (!load_next_window())
+        break;
+    }
+    const char* line_start = data_ + (position_ - window_offset_);
+    const long long available = window_offset_ + window_length_ - position_;
+    const char* line_end = static_cast<const char*>(std::memchr(line_start, '\n', static_cast<size_t>(available)));
+    if (line_end != NULL)
+    {
+      line.append(line_start, line_end - line_start);
+      position_ += (line_end - line_start) + 1;
+      return true;
+    }
+    // The line continues in the next window
+    line.append(line_start, static_cast<size_t>(available));
+    position_ += available;
+    has_line = true;
+  }
+  // The final line has no line ending
+  return has_line && !has_error_;
+}
+
+const char* gcode_file_reader::get_range(const long long offset, const long long length)
+{
+  if (!is_open() || offset < 0 || length < 0 || (decoder_ == NULL && offset + length > file_size_))
+    return NULL;
+  if (offset < window_offset_ || offset + length > window_offset_ + window_length_ || data_ == NULL)
+  {
+    if (length == 0)
+      return "";
+    if (decoder_ != NULL)
+      return NULL;
+    if (!load_window(offset, length))
+      return NULL;
+  }
+  return data_ + (offset - window_offset_);
+}
+
+long long gcode_file_reader::get_position() const
+{
+  return position_;
+}
+
+long long gcode_file_reader::get_file_size() const
+{
+  return file_size_;
+}
+
+double gcode_file_reader::get_fraction_read() const
+{
+  if (file_size_ <= 0)
+    return 1.0;
+  const long long position = decoder_ != NULL ? decoder_->get_compressed_position() : position_;
+  return static_cast<double>(position) / static_cast<double>(file_size_);
+}
+
+bool gcode_file_reader::is_compressed() const
+{
+  return decoder_ != NULL;
+}
+
+bool gcode_file_reader::has_error() const
+{
+  return has_error_;
+}
+
+long long gcode_file_reader::get_file_size(const std::string& file_path)
+{
+#ifdef _MSC_VER
+  std::wstring wpath = utilities::ToUtf16(file_path);
+  struct _stat64 file_stat;
+  if (_wstat64(wpath.c_str(), &file_stat) != 0)
+    return -1;
+#else
+  struct stat file_stat;
+  if (stat(file_path.c_str(), &file_stat) != 0)
+    return -1;
+#endif
+  return static_cast<long long>(file_stat.st_size);
+}
+
+bool gcode_file_reader::load_next_window()
+{
+  if (!is_open())
+    return false;
+  if (decoder_ != NULL)
+  {
+    // Decompressed blocks follow each other
+    const char* data;
+    long long length;
+    if (!decoder_->next_block(data, length))
+    {
+      has_error_ = decoder_->has_error();
+      return false;
+    }
+    window_offset_ = position_;
+    window_length_ = length;
+    data_ = data;
+    return true;
+  }
+  if (position_ >= file_size_)
+    return false;
+  return load_window(position_, window_size_);
+}
+
+bool gcode_file_reader::load_window(const long long offset, long long length)
+{
+  if (offset + length > file_size_)
+    length = file_size_ - offset;
+  if (is_mapped_ && map_window(offset, length))
+    return true;
+  // Once a window can't be mapped, the rest of the file is read into the buffer.
+  is_mapped_ = false;
+  unmap_window();
+  if (read_window(offset, length))
+    return true;
+  has_error_ = true;
+  return false;
+}
+
+bool gcode_file_reader::map_window(const long long offset, const long long length)
+{
+  unmap_window();
+  static const long long granularity = get_allocation_granularity();
+  const long long view_offset = offset - offset % granularity;
+  const long long view_length = offset + length - view_offset;
+#ifdef _MSC_VER
+  if (mapping_handle_ == NULL)
+    return false;
+  view_ = MapViewOfFile(
+    mapping_handle_, FILE_MAP_READ, static_cast<DWORD>(view_offset >> 32),
+    static_cast<DWORD>(view_offset & 0xFFFFFFFF), static_cast<SIZE_T>(view_length)
+  );
+  if (view_ == NULL)
+    return false;
+#else
+  void* view = mmap(NULL, static_cast<size_t>(view_length), PROT_READ, MAP_PRIVATE, fd_, static_cast<off_t>(view_offset));
+  if (view == MAP_FAILED)
+    return false;
+  view_ = view;
+#ifdef MADV_SEQUENTIAL
+  madvise(view_, static_cast<size_t>(view_length), MADV_SEQUENTIAL);
+#endif
+#endif
+  view_length_ = view_length;
+  window_offset_ = offset;
+  window_length_ = length;
+  data_ = static_cast<const char*>(view_) + (offset - view_offset);
+  return true;
+}
+
+bool gcode_file_reader::read_window(long long offset, const long long length)
+{
+  buffer_.resize(static_cast<size_t>(length));
+  char* buffer = buffer_.empty() ? NULL : &buffer_[0];
+  long long remaining = length;
+  window_offset_ = offset;
+  window_length_ = 0;
+  data_ = buffer;
+#ifdef _MSC_VER
+  LARGE_INTEGER distance;
+  distance.QuadPart = offset;
+  if (!SetFilePointerEx(file_handle_, distance, NULL, FILE_BEGIN))
+    return false;
+  while (remaining > 0)
+  {
+    DWORD bytes_read = 0;
+    const DWORD bytes_to_read = static_cast<DWORD>(remaining > 0x40000000 ? 0x40000000 : remaining);
+    if (!ReadFile(file_handle_, buffer, bytes_to_read, &bytes_read, NULL) || bytes_read == 0)
+      return false;
+    buffer += bytes_read;
+    remaining -= bytes_read;
+  }
+#else
+  while (remaining > 0)
+  {
+    const ssize_t bytes_read = pread(fd_, buffer, static_cast<size_t>(remaining), static_cast<off_t>(offset));
+    if (bytes_read < 0 && errno == EINTR)
+      continue;
+    if (bytes_read <= 0)
+      return false;
+    buffer += bytes_read;
+    offset += bytes_read;
+    remaining -= bytes_read;
+  }
+#endif
+  window_length_ = length;
+  return true;
+}
+
+void gcode_file_reader::unmap_window()
+{
+  if (view_ != NULL)
+  {
+#ifdef _MSC_VER
+    UnmapViewOfFile(view_);
+#else
+    munmap(view_, static_cast<size_t>(view_length_));
+#endif
+  }
+  view_ = NULL;
+  view_length_ = 0;
+  if (is_mapped_)
+  {
+    data_ = NULL;
+    window_offset_ = 0;
+    window_length_ = 0;
+  }
+}
@@ -0,0 +1,141 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef GCODE_FILE_READER_H
+#define GCODE_FILE_READER_H
+#include <string>
+#include <vector>
+
+// The default number of bytes mapped at once.  Small enough to always fit in a 32 bit address space.
+#define GCODE_FILE_READER_WINDOW_SIZE 8388608
+
+/**
+ * \brief Decodes a compressed gcode file into plain gcode, which gcode_file_reader reads a block at a time.
+ */
+class gcode_stream_decoder
+{
+public:
+  virtual ~gcode_stream_decoder()
+  {
+  }
+
+  /**
+   * \brief Opens the file and starts decoding.  Returns false if the file can't be read or isn't in the format.
+   */
+  virtual bool open(const std::string& file_path) = 0;
+  virtual void close() = 0;
+  /**
+   * \brief Waits for the next decoded block.  The data is valid until the next call.  Returns false once every block
+   * has been returned, or if the file could not be decoded.
+   */
+  virtual bool next_block(const char*& data, long long& length) = 0;
+  virtual bool has_error() const = 0;
+  /**
+   * \brief The number of bytes of the file decoded so far, for reporting progress.
+   */
+  virtual long long get_compressed_position() const = 0;
+};
+
+/**
+ * \brief Reads a gcode file through a memory mapped window that slides over the file, so files of any size can be
+ * read with constant memory, even where the address space is 32 bits.  If the file can't be mapped, the window is
+ * filled with ordinary reads instead.  All offsets are 64 bits.
+ *
+ * Gzip compressed and binary (bgcode) files are detected and decoded on another thread while the lines are read.
+ * Positions are then offsets into the decoded gcode, and the file can only be read forwards.
+ */
+class gcode_file_reader
+{
+public:
+  gcode_file_reader();
+  /**
+   * \brief Reads the file through windows of window_size bytes.  If map_file is false, the windows are always filled
+   * with ordinary reads.
+   */
+  explicit gcode_file_reader(long long window_size, bool map_file = true);
+  ~gcode_file_reader();
+  /**
+   * \brief Opens the file.  If decompress is true and the file is gzip compressed or binary gcode, the decoded gcode is
+   * read.
+   */
+  bool open(const std::string& file_path, bool decompress = true);
+  void close();
+  bool is_open() const;
+  /**
+   * \brief Reads the next line into line, without its line ending, like std::getline does.  Returns false at the end
+   * of the file, or if the file could not be read.
+   */
+  bool read_line(std::string& line);
+  /**
+   * \brief Returns a pointer to the bytes in [offset, offset + length), or NULL if they could not be read.  The
+   * pointer is valid until the next call to read_line or get_range.  For compressed files, only the bytes of the
+   * block holding the last line read are available.
+   */
+  const char* get_range(long long offset, long long length);
+  /**
+   * \brief The offset directly after the last line read.  Unlike tellg, this is also valid after the final line.
+   */
+  long long get_position() const;
+  /**
+   * \brief The size of the file on disk, which is the compressed size for compressed files.
+   */
+  long long get_file_size() const;
+  /**
+   * \brief The fraction of the file read so far, between 0 and 1, for reporting progress.
+   */
+  double get_fraction_read() const;
+  bool is_compressed() const;
+  bool has_error() const;
+  /**
+   * \brief Returns the size of the file at file_path in bytes, or -1 if it can't be found.
+   */
+  static long long get_file_size(const std::string& file_path);
+private:
+  gcode_file_reader(const gcode_file_reader&);
+  gcode_file_reader& operator=(const gcode_file_reader&);
+  bool load_next_window();
+  bool load_window(long long offset, long long length);
+  bool map_window(long long offset, long long length);
+  bool read_window(long long offset, long long length);
+  void unmap_window();
+  long long window_size_;
+  long long file_size_;
+  long long position_;
+  // The file offset and length of the bytes at data_
+  long long window_offset_;
+  long long window_length_;
+  const char* data_;
+  // The mapped view, which starts at an offset aligned to the allocation granularity
+  void* view_;
+  long long view_length_;
+  bool map_file_;
+  bool is_mapped_;
+  bool has_error_;
+  std::vector<char> buffer_;
+  gcode_stream_decoder* decoder_;
+#ifdef _MSC_VER
+  void* file_handle_;
+  void* mapping_handle_;
+#else
+  int fd_;
+#endif
+};
+#endif
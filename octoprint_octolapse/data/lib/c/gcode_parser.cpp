@@ -22,6 +22,7 @@
 #include "gcode_parser.h"
 #include "logging.h"
 #include "utilities.h"
+#include "instrumentation.h"
 
 gcode_parser::gcode_parser()
 {
@@ -112,6 +113,7 @@ bool gcode_parser::try_parse_gcode(const char* gcode, parsed_command& command)
 {
   // Create a command
   //octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::VERBOSE, gcode);
+  OCTOLAPSE_STATS_START(tokenize_timer, octolapse_stats::TOKENIZE);
   char* p_gcode = const_cast<char *>(gcode);
   char* p = const_cast<char *>(gcode);
   command.is_empty = true;
@@ -156,6 +158,8 @@ bool gcode_parser::try_parse_gcode(const char* gcode, parsed_command& command)
     p_gcode++;
   }
   command.gcode = utilities::rtrim(command.gcode);
+  OCTOLAPSE_STATS_STOP(tokenize_timer);
+  OCTOLAPSE_STATS_PHASE(octolapse_stats::PARSE);
 
   if (command.is_known_command)
   {
@@ -432,12 +436,18 @@ double gcode_parser::ten_pow(unsigned short n)
   return r;
 }
 
-bool gcode_parser::try_extract_double(char** p_p_gcode, double* p_double) const
+bool gcode_parser::try_extract_double(char** p_p_gcode, double* p_double, long long* p_mantissa,
+                                      short* p_decimal_places)
 {
   char* p = *p_p_gcode;
   bool neg = false;
   double r = 0;
   bool found_numbers = false;
+  // The exact decimal value, mantissa / 10^decimal_places, for fixed point positions.
+  long long mantissa = 0;
+  short significant_digits = 0;
+  short decimal_places = 0;
+  bool is_exact = true;
   // skip any leading whitespace
   while (*p == ' ')
     ++p;
@@ -465,6 +475,16 @@ bool gcode_parser::try_extract_double(char** p_p_gcode, double* p_double) const
     {
       found_numbers = true;
       r = (r * 10.0) + (*p - '0');
+      if (mantissa != 0 || *p != '0')
+      {
+        if (significant_digits < GCODE_PARSER_MAX_EXACT_DIGITS)
+        {
+          mantissa = (mantissa * 10) + (*p - '0');
+          ++significant_digits;
+        }
+        else
+          is_exact = false;
+      }
     }
     ++p;
   }
@@ -480,6 +500,17 @@ bool gcode_parser::try_extract_double(char** p_p_gcode, double* p_double) const
         found_numbers = true;
         f = (f * 10.0) + (*p - '0');
         ++n;
+        if (mantissa != 0 || *p != '0')
+        {
+          if (significant_digits < GCODE_PARSER_MAX_EXACT_DIGITS)
+          {
+            mantissa = (mantissa * 10) + (*p - '0');
+            ++significant_digits;
+          }
+          else
+            is_exact = false;
+        }
+        ++decimal_places;
       }
       ++p;
     }
@@ -494,6 +525,13 @@ bool gcode_parser::try_extract_double(char** p_p_gcode, double* p_double) const
   {
     *p_double = r;
     *p_p_gcode = p;
+    if (p_mantissa != NULL)
+    {
+      // A decimal_places value of -1 means the value has too many digits to be stored exactly.
+      is_exact = is_exact && decimal_places <= GCODE_PARSER_MAX_EXACT_DIGITS;
+      *p_mantissa = neg ? -mantissa : mantissa;
+      *p_decimal_places = is_exact ? decimal_places : -1;
+    }
   }
 
   return found_numbers;
@@ -598,7 +636,8 @@ bool gcode_parser::try_extract_parameter(char** p_p_gcode, parsed_command_parame
   // TODO:  See if unsigned long works....
 
   // Add all values, stop at end of string or when we hit a ';'
-  if (try_extract_double(&p, &(parameter->double_value)))
+  if (try_extract_double(&p, &(parameter->double_value), &(parameter->decimal_mantissa),
+                         &(parameter->decimal_places)))
   {
     parameter->value_type = 'F';
   }
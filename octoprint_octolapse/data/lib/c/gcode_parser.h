@@ -36,13 +36,15 @@ public:
   ~gcode_parser();
   bool try_parse_gcode(const char* gcode, parsed_command& command);
   parsed_command parse_gcode(const char* gcode);
+  // Also used to read the numbers in firmware responses.
+  static bool try_extract_double(char** p_p_gcode, double* p_double, long long* p_mantissa = NULL,
+                                 short* p_decimal_places = NULL);
 private:
   gcode_parser(const gcode_parser& source);
   // Variables and lookups
   std::set<std::string> text_only_functions_;
   std::set<std::string> parsable_commands_;
   // Functions
-  bool try_extract_double(char** p_p_gcode, double* p_double) const;
   static bool try_extract_gcode_command(char** p_p_gcode, std::string* p_command);
   static bool try_extract_text_parameter(char** p_p_gcode, std::string* p_parameter);
   bool try_extract_parameter(char** p_p_gcode, parsed_command_parameter* parameter) const;
@@ -22,8 +22,11 @@
 #include "gcode_position.h"
 #include "utilities.h"
 #include "logging.h"
+#include "gcode_arc.h"
+#include "instrumentation.h"
 #include <algorithm>
 #include <iterator>
+#include <cmath>
 
 gcode_position_args::gcode_position_args(const gcode_position_args& pos_args)
 {
@@ -82,7 +85,9 @@ gcode_position_args::gcode_position_args(const gcode_position_args& pos_args)
       y_firmware_offsets[index] = 0;
     }
   }
-  std::vector<std::string> location_detection_commands; // Final list of location detection commands
+  fixed_point_decimals = pos_args.fixed_point_decimals;
+  location_detection_commands = pos_args.location_detection_commands;
+  position_restrictions = pos_args.position_restrictions;
 }
 
 gcode_position_args& gcode_position_args::operator=(const gcode_position_args& pos_args)
@@ -142,7 +147,9 @@ gcode_position_args& gcode_position_args::operator=(const gcode_position_args& p
       y_firmware_offsets[index] = 0;
     }
   }
-  std::vector<std::string> location_detection_commands; // Final list of location detection commands
+  fixed_point_decimals = pos_args.fixed_point_decimals;
+  location_detection_commands = pos_args.location_detection_commands;
+  position_restrictions = pos_args.position_restrictions;
   return *this;
 }
 
@@ -241,6 +248,9 @@ gcode_position::gcode_position()
   z_min_ = 0;
   z_max_ = 0;
   is_circular_bed_ = false;
+  fixed_point_decimals_ = 0;
+  fixed_point_scale_ = 1;
+  update_state_ = get_update_state_function(num_extruders_, POSITION_BOUNDS_NONE, false);
 
   cur_pos_ = 0;
 
@@ -323,9 +333,25 @@ gcode_position::gcode_position(gcode_position_args args)
   z_max_ = args.z_max;
 
   is_circular_bed_ = args.is_circular_bed;
+  position_restrictions_ = position_restrictions(args.position_restrictions);
+
+  fixed_point_decimals_ = args.fixed_point_decimals;
+  if (fixed_point_decimals_ < 0)
+    fixed_point_decimals_ = 0;
+  else if (fixed_point_decimals_ > GCODE_POSITION_MAX_FIXED_POINT_DECIMALS)
+    fixed_point_decimals_ = GCODE_POSITION_MAX_FIXED_POINT_DECIMALS;
+  fixed_point_scale_ = 1;
+  for (int index = 0; index < fixed_point_decimals_; index++)
+  {
+    fixed_point_scale_ *= 10;
+  }
 
   cur_pos_ = -1;
   num_extruders_ = args.num_extruders;
+  int bounds_type = POSITION_BOUNDS_NONE;
+  if (is_bound_)
+    bounds_type = is_circular_bed_ ? POSITION_BOUNDS_CIRCULAR : POSITION_BOUNDS_RECTANGULAR;
+  update_state_ = get_update_state_function(num_extruders_, bounds_type, height_increment_ != 0);
 
   // Configure the initial position
   position initial_pos(num_extruders_);
@@ -390,6 +416,43 @@ void gcode_position::delete_z_lift_heights_()
   }
 }
 
+bool gcode_position::is_fixed_point() const
+{
+  return fixed_point_decimals_ > 0;
+}
+
+long long gcode_position::to_fixed(const double value) const
+{
+  return llround(value * fixed_point_scale_);
+}
+
+double gcode_position::from_fixed(const long long value) const
+{
+  return static_cast<double>(value) / fixed_point_scale_;
+}
+
+double gcode_position::add_coordinates(const double value_1, const double value_2) const
+{
+  // In fixed point mode the sum is exact, so relative moves never accumulate rounding errors.
+  if (is_fixed_point())
+    return from_fixed(to_fixed(value_1) + to_fixed(value_2));
+  return value_1 + value_2;
+}
+
+bool gcode_position::coordinates_equal(const double value_1, const double value_2) const
+{
+  if (is_fixed_point())
+    return to_fixed(value_1) == to_fixed(value_2);
+  return utilities::is_equal(value_1, value_2);
+}
+
+double gcode_position::get_coordinate(const parsed_command_parameter& parameter) const
+{
+  if (is_fixed_point())
+    return from_fixed(parameter.get_fixed_value(static_cast<short>(fixed_point_decimals_), fixed_point_scale_));
+  return parameter.double_value;
+}
+
 void gcode_position::add_position(position& pos)
 {
   cur_pos_ = (++cur_pos_) % NUM_POSITIONS;
@@ -426,12 +489,249 @@ position* gcode_position::get_previous_position_ptr()
   return &positions_[(cur_pos_ - 1 + NUM_POSITIONS) % NUM_POSITIONS];
 }
 
-void gcode_position::update(parsed_command& command, const long file_line_number, const long gcode_number,
-                            const long file_position)
+gcode_position::update_state_function_type gcode_position::get_update_state_function(
+  const int num_extruders, const int bounds_type, const bool use_height_increment)
+{
+  // Pick the specialized variant of update_state once, so the per command path doesn't need to check these options.
+  if (num_extruders < 2)
+  {
+    switch (bounds_type)
+    {
+    case POSITION_BOUNDS_RECTANGULAR:
+      return use_height_increment
+               ? &gcode_position::update_state<true, POSITION_BOUNDS_RECTANGULAR, true>
+               : &gcode_position::update_state<true, POSITION_BOUNDS_RECTANGULAR, false>;
+    case POSITION_BOUNDS_CIRCULAR:
+      return use_height_increment
+               ? &gcode_position::update_state<true, POSITION_BOUNDS_CIRCULAR, true>
+               : &gcode_position::update_state<true, POSITION_BOUNDS_CIRCULAR, false>;
+    default:
+      return use_height_increment
+               ? &gcode_position::update_state<true, POSITION_BOUNDS_NONE, true>
+               : &gcode_position::update_state<true, POSITION_BOUNDS_NONE, false>;
+    }
+  }
+  switch (bounds_type)
+  {
+  case POSITION_BOUNDS_RECTANGULAR:
+    return use_height_increment
+             ? &gcode_position::update_state<false, POSITION_BOUNDS_RECTANGULAR, true>
+             : &gcode_position::update_state<false, POSITION_BOUNDS_RECTANGULAR, false>;
+  case POSITION_BOUNDS_CIRCULAR:
+    return use_height_increment
+             ? &gcode_position::update_state<false, POSITION_BOUNDS_CIRCULAR, true>
+             : &gcode_position::update_state<false, POSITION_BOUNDS_CIRCULAR, false>;
+  default:
+    return use_height_increment
+             ? &gcode_position::update_state<false, POSITION_BOUNDS_NONE, true>
+             : &gcode_position::update_state<false, POSITION_BOUNDS_NONE, false>;
+  }
+}
+
+template <bool IsSingleExtruder, int BoundsType, bool UseHeightIncrement>
+void gcode_position::update_state(position* p_current_pos, position* p_previous_pos, const parsed_command& command)
 {
+  // With a single extruder every tool maps to the first extruder, so skip the tool lookups.
+  const int tool = IsSingleExtruder ? 0 : p_current_pos->current_tool;
+  extruder& current_extruder = IsSingleExtruder
+                                 ? p_current_pos->p_extruders[0]
+                                 : p_current_pos->get_current_extruder();
+  const extruder& previous_extruder = IsSingleExtruder
+                                        ? p_previous_pos->p_extruders[0]
+                                        : p_previous_pos->get_extruder(p_current_pos->current_tool);
+  const bool is_same_tool = IsSingleExtruder || p_previous_pos->current_tool == p_current_pos->current_tool;
+
+  current_extruder.extrusion_length_total = add_coordinates(
+    current_extruder.extrusion_length_total, current_extruder.e_relative);
+
+  if (
+    utilities::greater_than(current_extruder.e_relative, 0) &&
+    is_same_tool &&
+    // notice we can use the previous extruder since we've made sure they are using the same tool
+    previous_extruder.is_extruding &&
+    !previous_extruder.is_extruding_start)
+  {
+    // A little shortcut if we know we were extruding (not starting extruding) in the previous command
+    // This lets us skip a lot of the calculations for the extruder, including the state calculation
+    current_extruder.extrusion_length = current_extruder.e_relative;
+  }
+  else
+  {
+    // Update retraction_length and extrusion_length
+    current_extruder.retraction_length = add_coordinates(
+      current_extruder.retraction_length, -current_extruder.e_relative);
+    if (utilities::less_than_or_equal(current_extruder.retraction_length, 0))
+    {
+      // we can use the negative retraction length to calculate our extrusion length!
+      current_extruder.extrusion_length = -1.0 * current_extruder.retraction_length;
+      // set the retraction length to 0 since we are extruding
+      current_extruder.retraction_length = 0;
+    }
+    else
+      current_extruder.extrusion_length = 0;
+
+    // calculate deretraction length
+    if (utilities::greater_than(previous_extruder.retraction_length, current_extruder.retraction_length))
+    {
+      current_extruder.deretraction_length = add_coordinates(
+        previous_extruder.retraction_length, -current_extruder.retraction_length);
+    }
+    else
+      current_extruder.deretraction_length = 0;
+
+    // *************Calculate extruder state*************
+    // rounding should all be done by now
+    if (is_same_tool)
+    {
+      // On a toolchange some flags are not possible, so don't change them.
+      // these flags include like is_extruding, is_extruding_start, is_retracting_start, is_retracting, is_deretracting_start and is_deretracting
+      // Note that it's ok to use the previous extruder since we've  made sure the current tool is identical
+      current_extruder.is_extruding_start = utilities::greater_than(current_extruder.extrusion_length, 0) &&
+        !previous_extruder.is_extruding;
+      current_extruder.is_extruding = utilities::greater_than(current_extruder.extrusion_length, 0);
+      current_extruder.is_retracting_start = !previous_extruder.is_retracting &&
+        utilities::greater_than(current_extruder.retraction_length, 0);
+      current_extruder.is_retracting = utilities::greater_than(
+        current_extruder.retraction_length, previous_extruder.retraction_length);
+      current_extruder.is_deretracting = utilities::greater_than(
+        current_extruder.deretraction_length, previous_extruder.deretraction_length);
+      current_extruder.is_deretracting_start = utilities::greater_than(current_extruder.deretraction_length, 0) &&
+        !previous_extruder.is_deretracting;
+    }
+    else
+    {
+      current_extruder.is_extruding_start = false;
+      current_extruder.is_extruding = false;
+      current_extruder.is_retracting_start = false;
+      current_extruder.is_retracting = false;
+      current_extruder.is_deretracting = false;
+      current_extruder.is_deretracting_start = false;
+    }
+    current_extruder.is_primed = utilities::is_zero(current_extruder.extrusion_length) &&
+      utilities::is_zero(current_extruder.retraction_length);
+    current_extruder.is_partially_retracted = utilities::greater_than(current_extruder.retraction_length, 0) &&
+      utilities::less_than(current_extruder.retraction_length, retraction_lengths_[tool]);
+    current_extruder.is_retracted = utilities::greater_than_or_equal(
+      current_extruder.retraction_length, retraction_lengths_[tool]);
+    current_extruder.is_deretracted = utilities::greater_than(previous_extruder.retraction_length, 0) &&
+      utilities::is_zero(current_extruder.retraction_length);
+    // *************End Calculate extruder state*************
+  }
+
+  // Calcluate position restructions
+  if (position_restrictions_.has_restrictions() && p_current_pos->has_xy_position_changed)
+    update_position_restrictions(p_current_pos, p_previous_pos, command);
+
+  // Set is_in_bounds_ to false if we're not in bounds, it will be true at this point
+  bool is_in_bounds = true;
+  if (BoundsType != POSITION_BOUNDS_NONE)
+  {
+    // Arcs can leave the bounds between their end points, so check the entire arc.
+    gcode_arc arc;
+    const bool is_arc = arc.try_create(*p_previous_pos, *p_current_pos);
+    if (BoundsType == POSITION_BOUNDS_RECTANGULAR)
+    {
+      double min_x = p_current_pos->x, min_y = p_current_pos->y, max_x = p_current_pos->x, max_y = p_current_pos->y;
+      double min_z = p_current_pos->z, max_z = p_current_pos->z;
+      if (is_arc)
+      {
+        arc.get_bounds(min_x, min_y, max_x, max_y);
+        min_z = arc.start_z < arc.end_z ? arc.start_z : arc.end_z;
+        max_z = arc.start_z < arc.end_z ? arc.end_z : arc.start_z;
+      }
+      is_in_bounds = !(
+        utilities::less_than(min_x, snapshot_x_min_) ||
+        utilities::greater_than(max_x, snapshot_x_max_) ||
+        utilities::less_than(min_y, snapshot_y_min_) ||
+        utilities::greater_than(max_y, snapshot_y_max_) ||
+        utilities::less_than(min_z, snapshot_z_min_) ||
+        utilities::greater_than(max_z, snapshot_z_max_)
+      );
+    }
+    else
+    {
+      double r;
+      r = snapshot_x_max_; // good stand in for radius
+      const double dist = is_arc
+                            ? arc.get_max_distance(0, 0)
+                            : sqrt(p_current_pos->x * p_current_pos->x + p_current_pos->y * p_current_pos->y);
+      is_in_bounds = utilities::less_than_or_equal(dist, r);
+    }
+    p_current_pos->is_in_bounds = is_in_bounds;
+  }
+
+  // calculate last_extrusion_height and height
+  // If we are extruding on a higher level, or if retract is enabled and the nozzle is primed
+  // adjust the last extrusion height
+  if (utilities::greater_than(p_current_pos->z, p_current_pos->last_extrusion_height))
+  {
+    if (!p_current_pos->z_null)
+    {
+      // detect layer changes/ printer priming/last extrusion height and height 
+      // Normally we would only want to use is_extruding, but we can also use is_deretracted if the layer is greater than 0
+      if (current_extruder.is_extruding || (p_current_pos->layer > 0 && current_extruder.is_deretracted))
+      {
+        // Is Primed
+        if (!p_current_pos->is_printer_primed)
+        {
+          // We haven't primed yet, check to see if we have priming height restrictions
+          if (utilities::greater_than(priming_height_, 0))
+          {
+            // if a priming height is configured, see if we've extruded below the  height
+            if (utilities::less_than(p_current_pos->z, priming_height_))
+              p_current_pos->is_printer_primed = true;
+          }
+          else
+            // if we have no priming height set, just set is_printer_primed = true.
+            p_current_pos->is_printer_primed = true;
+        }
+
+        if (p_current_pos->is_printer_primed && is_in_bounds)
+        {
+          // Update the last extrusion height
+          p_current_pos->last_extrusion_height = p_current_pos->z;
+          p_current_pos->last_extrusion_height_null = false;
+
+          // Calculate current height
+          if (utilities::greater_than_or_equal(p_current_pos->z, p_previous_pos->height + minimum_layer_height_))
+          {
+            p_current_pos->height = p_current_pos->z;
+            p_current_pos->is_layer_change = true;
+            p_current_pos->layer++;
+            if (UseHeightIncrement)
+            {
+              const double increment_double = p_current_pos->height / height_increment_;
+              unsigned const int increment = utilities::round_up_to_int(increment_double);
+              if (increment > p_current_pos->height_increment && increment > 1)
+              {
+                p_current_pos->height_increment = increment;
+                p_current_pos->is_height_increment_change = true;
+                p_current_pos->height_increment_change_count++;
+              }
+            }
+          }
+        }
+      }
+
+      // calculate is_zhop
+      if (current_extruder.is_extruding || p_current_pos->z_null || p_current_pos->last_extrusion_height_null)
+        p_current_pos->is_zhop = false;
+      else
+        p_current_pos->is_zhop = utilities::greater_than_or_equal(
+          p_current_pos->z - p_current_pos->last_extrusion_height, z_lift_heights_[tool]);
+    }
+  }
+}
+
+void gcode_position::update(parsed_command& command, const long long file_line_number,
+                            const long long gcode_number, const long long file_position)
+{
+  OCTOLAPSE_STATS_PHASE(octolapse_stats::POSITION_UPDATE);
   if (command.is_empty)
   {
     // process any comment sections
+    OCTOLAPSE_STATS_PHASE(octolapse_stats::COMMENT_PROCESSING);
+    OCTOLAPSE_STATS_COUNT(octolapse_stats::COMMENTS_PROCESSED, 1);
     comment_processor_.update(command.comment);
     return;
   }
@@ -442,7 +742,13 @@ void gcode_position::update(parsed_command& command, const long file_line_number
   p_current_pos->file_line_number = file_line_number;
   p_current_pos->gcode_number = gcode_number;
   p_current_pos->file_position = file_position;
-  comment_processor_.update(*p_current_pos);
+  {
+    OCTOLAPSE_STATS_PHASE(octolapse_stats::COMMENT_PROCESSING);
+    comment_processor_.update(*p_current_pos);
+  }
+  // If we don't have restricted positions, we are always in position!
+  if (!position_restrictions_.has_restrictions())
+    p_current_pos->is_in_position = true;
 
   if (!command.is_known_command)
     return;
@@ -457,21 +763,19 @@ void gcode_position::update(parsed_command& command, const long file_line_number
     const pos_function_type func = gcode_functions_iterator_->second;
     (this->*func)(p_current_pos, command);
     // calculate z and e relative distances
-    p_current_pos->get_current_extruder().e_relative = (p_current_pos->get_current_extruder().e - p_previous_pos
-                                                                                                  ->get_extruder(
-                                                                                                    p_current_pos->
-                                                                                                    current_tool).e);
-    p_current_pos->z_relative = (p_current_pos->z - p_previous_pos->z);
+    p_current_pos->get_current_extruder().e_relative = add_coordinates(
+      p_current_pos->get_current_extruder().e, -p_previous_pos->get_extruder(p_current_pos->current_tool).e);
+    p_current_pos->z_relative = add_coordinates(p_current_pos->z, -p_previous_pos->z);
     // Have the XYZ positions changed after processing a command ?
 
     p_current_pos->has_xy_position_changed = (
-      !utilities::is_equal(p_current_pos->x, p_previous_pos->x) ||
-      !utilities::is_equal(p_current_pos->y, p_previous_pos->y)
+      !coordinates_equal(p_current_pos->x, p_previous_pos->x) ||
+      !coordinates_equal(p_current_pos->y, p_previous_pos->y)
     );
     p_current_pos->has_position_changed = (
       p_current_pos->has_xy_position_changed ||
-      !utilities::is_equal(p_current_pos->z, p_previous_pos->z) ||
-      !utilities::is_zero(p_current_pos->get_current_extruder().e_relative) ||
+      !coordinates_equal(p_current_pos->z, p_previous_pos->z) ||
+      !coordinates_equal(p_current_pos->get_current_extruder().e_relative, 0) ||
       p_current_pos->x_null != p_previous_pos->x_null ||
       p_current_pos->y_null != p_previous_pos->y_null ||
       p_current_pos->z_null != p_previous_pos->z_null);
@@ -494,188 +798,25 @@ void gcode_position::update(parsed_command& command, const long file_line_number
   }
 
   if (p_current_pos->has_position_changed)
-  {
-    p_current_pos->get_current_extruder().extrusion_length_total += p_current_pos->get_current_extruder().e_relative;
-
-    if (
-      utilities::greater_than(p_current_pos->get_current_extruder().e_relative, 0) &&
-      p_previous_pos->current_tool == p_current_pos->current_tool &&
-      // notice we can use the previous position's current extruder since we've made sure they are using the same tool
-      p_previous_pos->get_current_extruder().is_extruding &&
-      !p_previous_pos->get_current_extruder().is_extruding_start)
-    {
-      // A little shortcut if we know we were extruding (not starting extruding) in the previous command
-      // This lets us skip a lot of the calculations for the extruder, including the state calculation
-      p_current_pos->get_current_extruder().extrusion_length = p_current_pos->get_current_extruder().e_relative;
-    }
-    else
-    {
-      // Update retraction_length and extrusion_length
-      p_current_pos->get_current_extruder().retraction_length = p_current_pos->get_current_extruder().retraction_length
-        - p_current_pos->get_current_extruder().e_relative;
-      if (utilities::less_than_or_equal(p_current_pos->get_current_extruder().retraction_length, 0))
-      {
-        // we can use the negative retraction length to calculate our extrusion length!
-        p_current_pos->get_current_extruder().extrusion_length = -1.0 * p_current_pos
-                                                                        ->get_current_extruder().retraction_length;
-        // set the retraction length to 0 since we are extruding
-        p_current_pos->get_current_extruder().retraction_length = 0;
-      }
-      else
-        p_current_pos->get_current_extruder().extrusion_length = 0;
-
-      // calculate deretraction length
-      if (utilities::greater_than(p_previous_pos->get_extruder(p_current_pos->current_tool).retraction_length,
-                                  p_current_pos->get_current_extruder().retraction_length))
-      {
-        p_current_pos->get_current_extruder().deretraction_length = p_previous_pos
-                                                                    ->get_extruder(p_current_pos->current_tool).
-                                                                    retraction_length - p_current_pos
-                                                                                        ->get_current_extruder().
-                                                                                        retraction_length;
-      }
-      else
-        p_current_pos->get_current_extruder().deretraction_length = 0;
-
-      // *************Calculate extruder state*************
-      // rounding should all be done by now
-      if (p_current_pos->current_tool == p_previous_pos->current_tool)
-      {
-        // On a toolchange some flags are not possible, so don't change them.
-        // these flags include like is_extruding, is_extruding_start, is_retracting_start, is_retracting, is_deretracting_start and is_deretracting
-        // Note that it's ok to use the previous pos current extruder since we've  made sure the current tool is identical
-        p_current_pos->get_current_extruder().is_extruding_start = utilities::greater_than(
-            p_current_pos->get_current_extruder().extrusion_length, 0) && !p_previous_pos
-                                                                           ->get_current_extruder().is_extruding;
-        p_current_pos->get_current_extruder().is_extruding = utilities::greater_than(
-          p_current_pos->get_current_extruder().extrusion_length, 0);
-        p_current_pos->get_current_extruder().is_retracting_start = !p_previous_pos
-                                                                     ->get_current_extruder().is_retracting && utilities
-          ::greater_than(p_current_pos->get_current_extruder().retraction_length, 0);
-        p_current_pos->get_current_extruder().is_retracting = utilities::greater_than(
-          p_current_pos->get_current_extruder().retraction_length,
-          p_previous_pos->get_current_extruder().retraction_length);
-        p_current_pos->get_current_extruder().is_deretracting = utilities::greater_than(
-          p_current_pos->get_current_extruder().deretraction_length,
-          p_previous_pos->get_current_extruder().deretraction_length);
-        p_current_pos->get_current_extruder().is_deretracting_start = utilities::greater_than(
-            p_current_pos->get_current_extruder().deretraction_length, 0) && !p_previous_pos
-                                                                              ->get_current_extruder().is_deretracting;
-      }
-      else
-      {
-        p_current_pos->get_current_extruder().is_extruding_start = false;
-        p_current_pos->get_current_extruder().is_extruding = false;
-        p_current_pos->get_current_extruder().is_retracting_start = false;
-        p_current_pos->get_current_extruder().is_retracting = false;
-        p_current_pos->get_current_extruder().is_deretracting = false;
-        p_current_pos->get_current_extruder().is_deretracting_start = false;
-      }
-      p_current_pos->get_current_extruder().is_primed = utilities::
-        is_zero(p_current_pos->get_current_extruder().extrusion_length) && utilities::is_zero(
-          p_current_pos->get_current_extruder().retraction_length);
-      p_current_pos->get_current_extruder().is_partially_retracted = utilities::
-        greater_than(p_current_pos->get_current_extruder().retraction_length, 0) && utilities::less_than(
-          p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
-      p_current_pos->get_current_extruder().is_retracted = utilities::greater_than_or_equal(
-        p_current_pos->get_current_extruder().retraction_length, retraction_lengths_[p_current_pos->current_tool]);
-      p_current_pos->get_current_extruder().is_deretracted = utilities::greater_than(
-        p_previous_pos->get_extruder(p_current_pos->current_tool).retraction_length, 0) && utilities::is_zero(
-        p_current_pos->get_current_extruder().retraction_length);
-      // *************End Calculate extruder state*************
-    }
-
-    // Calcluate position restructions
-    // TODO:  INCLUDE POSITION RESTRICTION CALCULATIONS!
-    // Set is_in_bounds_ to false if we're not in bounds, it will be true at this point
-    bool is_in_bounds = true;
-    if (is_bound_)
-    {
-      if (!is_circular_bed_)
-      {
-        is_in_bounds = !(
-          utilities::less_than(p_current_pos->x, snapshot_x_min_) ||
-          utilities::greater_than(p_current_pos->x, snapshot_x_max_) ||
-          utilities::less_than(p_current_pos->y, snapshot_y_min_) ||
-          utilities::greater_than(p_current_pos->y, snapshot_y_max_) ||
-          utilities::less_than(p_current_pos->z, snapshot_z_min_) ||
-          utilities::greater_than(p_current_pos->z, snapshot_z_max_)
-        );
-      }
-      else
-      {
-        double r;
-        r = snapshot_x_max_; // good stand in for radius
-        const double dist = sqrt(p_current_pos->x * p_current_pos->x + p_current_pos->y * p_current_pos->y);
-        is_in_bounds = utilities::less_than_or_equal(dist, r);
-      }
-      p_current_pos->is_in_bounds = is_in_bounds;
-    }
-
-    // calculate last_extrusion_height and height
-    // If we are extruding on a higher level, or if retract is enabled and the nozzle is primed
-    // adjust the last extrusion height
-    if (utilities::greater_than(p_current_pos->z, p_current_pos->last_extrusion_height))
-    {
-      if (!p_current_pos->z_null)
-      {
-        // detect layer changes/ printer priming/last extrusion height and height 
-        // Normally we would only want to use is_extruding, but we can also use is_deretracted if the layer is greater than 0
-        if (p_current_pos->get_current_extruder().is_extruding || (p_current_pos->layer > 0 && p_current_pos
-                                                                                               ->get_current_extruder().
-                                                                                               is_deretracted))
-        {
-          // Is Primed
-          if (!p_current_pos->is_printer_primed)
-          {
-            // We haven't primed yet, check to see if we have priming height restrictions
-            if (utilities::greater_than(priming_height_, 0))
-            {
-              // if a priming height is configured, see if we've extruded below the  height
-              if (utilities::less_than(p_current_pos->z, priming_height_))
-                p_current_pos->is_printer_primed = true;
-            }
-            else
-              // if we have no priming height set, just set is_printer_primed = true.
-              p_current_pos->is_printer_primed = true;
-          }
-
-          if (p_current_pos->is_printer_primed && is_in_bounds)
-          {
-            // Update the last extrusion height
-            p_current_pos->last_extrusion_height = p_current_pos->z;
-            p_current_pos->last_extrusion_height_null = false;
-
-            // Calculate current height
-            if (utilities::greater_than_or_equal(p_current_pos->z, p_previous_pos->height + minimum_layer_height_))
-            {
-              p_current_pos->height = p_current_pos->z;
-              p_current_pos->is_layer_change = true;
-              p_current_pos->layer++;
-              if (height_increment_ != 0)
-              {
-                const double increment_double = p_current_pos->height / height_increment_;
-                unsigned const int increment = utilities::round_up_to_int(increment_double);
-                if (increment > p_current_pos->height_increment && increment > 1)
-                {
-                  p_current_pos->height_increment = increment;
-                  p_current_pos->is_height_increment_change = true;
-                  p_current_pos->height_increment_change_count++;
-                }
-              }
-            }
-          }
-        }
+    (this->*update_state_)(p_current_pos, p_previous_pos, command);
+}
 
-        // calculate is_zhop
-        if (p_current_pos->get_current_extruder().is_extruding || p_current_pos->z_null || p_current_pos->
-          last_extrusion_height_null)
-          p_current_pos->is_zhop = false;
-        else
-          p_current_pos->is_zhop = utilities::greater_than_or_equal(
-            p_current_pos->z - p_current_pos->last_extrusion_height, z_lift_heights_[p_current_pos->current_tool]);
-      }
-    }
+void gcode_position::update_position_restrictions(position* p_current_pos, const position* p_previous_pos,
+                                                  const parsed_command& command) const
+{
+  if (p_current_pos->x_null || p_current_pos->y_null || p_previous_pos->x_null || p_previous_pos->y_null)
+  {
+    p_current_pos->is_in_position = false;
+    return;
+  }
+  p_current_pos->is_in_position = position_restrictions_.is_in_position(p_current_pos->x, p_current_pos->y);
+  // Only G0 and G1 moves can be split at an intersection
+  if (!p_current_pos->is_in_position && (command.command == "G0" || command.command == "G1"))
+  {
+    p_current_pos->in_path_position = position_restrictions_.get_in_path_intersection(
+      p_current_pos->x, p_current_pos->y, p_previous_pos->x, p_previous_pos->y,
+      p_current_pos->in_path_x, p_current_pos->in_path_y
+    );
   }
 }
 
@@ -749,22 +890,22 @@ void gcode_position::update_position(
   {
     if (update_x)
     {
-      pos->x = x + pos->x_offset - pos->x_firmware_offset;
+      pos->x = add_coordinates(x, pos->x_offset - pos->x_firmware_offset);
       pos->x_null = false;
     }
     if (update_y)
     {
-      pos->y = y + pos->y_offset - pos->y_firmware_offset;
+      pos->y = add_coordinates(y, pos->y_offset - pos->y_firmware_offset);
       pos->y_null = false;
     }
     if (update_z)
     {
-      pos->z = z + pos->z_offset - pos->z_firmware_offset;
+      pos->z = add_coordinates(z, pos->z_offset - pos->z_firmware_offset);
       pos->z_null = false;
     }
     // note that e cannot be null and starts at 0
     if (update_e)
-      pos->get_current_extruder().e = e + pos->get_current_extruder().e_offset;
+      pos->get_current_extruder().e = add_coordinates(e, pos->get_current_extruder().e_offset);
     return;
   }
 
@@ -775,7 +916,7 @@ void gcode_position::update_position(
       if (update_x)
       {
         if (!pos->x_null)
-          pos->x = x + pos->x;
+          pos->x = add_coordinates(pos->x, x);
         else
         {
           octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR,
@@ -785,7 +926,7 @@ void gcode_position::update_position(
       if (update_y)
       {
         if (!pos->y_null)
-          pos->y = y + pos->y;
+          pos->y = add_coordinates(pos->y, y);
         else
         {
           octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR,
@@ -795,7 +936,7 @@ void gcode_position::update_position(
       if (update_z)
       {
         if (!pos->z_null)
-          pos->z = z + pos->z;
+          pos->z = add_coordinates(pos->z, z);
         else
         {
           octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR,
@@ -808,19 +949,19 @@ void gcode_position::update_position(
       if (update_x)
       {
         pos->x_firmware_offset = pos->get_current_extruder().x_firmware_offset;
-        pos->x = x + pos->x_offset - pos->x_firmware_offset;
+        pos->x = add_coordinates(x, pos->x_offset - pos->x_firmware_offset);
         pos->x_null = false;
       }
       if (update_y)
       {
         pos->y_firmware_offset = pos->get_current_extruder().y_firmware_offset;
-        pos->y = y + pos->y_offset - pos->y_firmware_offset;
+        pos->y = add_coordinates(y, pos->y_offset - pos->y_firmware_offset);
         pos->y_null = false;
       }
       if (update_z)
       {
         pos->z_firmware_offset = pos->get_current_extruder().z_firmware_offset;
-        pos->z = z + pos->z_offset - pos->z_firmware_offset;
+        pos->z = add_coordinates(z, pos->z_offset - pos->z_firmware_offset);
         pos->z_null = false;
       }
     }
@@ -837,11 +978,11 @@ void gcode_position::update_position(
     {
       if (pos->is_extruder_relative)
       {
-        pos->get_current_extruder().e = e + pos->get_current_extruder().e;
+        pos->get_current_extruder().e = add_coordinates(pos->get_current_extruder().e, e);
       }
       else
       {
-        pos->get_current_extruder().e = e + pos->get_current_extruder().e_offset;
+        pos->get_current_extruder().e = add_coordinates(e, pos->get_current_extruder().e_offset);
       }
     }
     else
@@ -870,22 +1011,22 @@ void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
     if (p_cur_param.name == "X")
     {
       update_x = true;
-      x = p_cur_param.double_value;
+      x = get_coordinate(p_cur_param);
     }
     else if (p_cur_param.name == "Y")
     {
       update_y = true;
-      y = p_cur_param.double_value;
+      y = get_coordinate(p_cur_param);
     }
     else if (p_cur_param.name == "E")
     {
       update_e = true;
-      e = p_cur_param.double_value;
+      e = get_coordinate(p_cur_param);
     }
     else if (p_cur_param.name == "Z")
     {
       update_z = true;
-      z = p_cur_param.double_value;
+      z = get_coordinate(p_cur_param);
     }
     else if (p_cur_param.name == "F")
     {
@@ -898,12 +1039,25 @@ void gcode_position::process_g0_g1(position* pos, parsed_command& cmd)
 
 void gcode_position::process_g2(position* pos, parsed_command& cmd)
 {
+  process_g2_g3(pos, cmd);
+}
+
+void gcode_position::process_g3(position* pos, parsed_command& cmd)
+{
+  process_g2_g3(pos, cmd);
+}
+
+void gcode_position::process_g2_g3(position* pos, parsed_command& cmd)
+{
+  // I, J and R only determine the path of the arc, which is calculated from the position when it is needed.
   bool update_x = false;
   bool update_y = false;
+  bool update_z = false;
   bool update_e = false;
   bool update_f = false;
   double x = 0;
   double y = 0;
+  double z = 0;
   double e = 0;
   double f = 0;
   for (unsigned int index = 0; index < cmd.parameters.size(); index++)
@@ -912,17 +1066,23 @@ void gcode_position::process_g2(position* pos, parsed_command& cmd)
     if (p_cur_param.name == "X")
     {
       update_x = true;
-      x = p_cur_param.double_value;
+      x = get_coordinate(p_cur_param);
     }
     else if (p_cur_param.name == "Y")
     {
       update_y = true;
-      y = p_cur_param.double_value;
+      y = get_coordinate(p_cur_param);
+    }
+    else if (p_cur_param.name == "Z")
+    {
+      // Helical arcs move Z linearly along the arc
+      update_z = true;
+      z = get_coordinate(p_cur_param);
     }
     else if (p_cur_param.name == "E")
     {
       update_e = true;
-      e = p_cur_param.double_value;
+      e = get_coordinate(p_cur_param);
     }
     else if (p_cur_param.name == "F")
     {
@@ -930,12 +1090,7 @@ void gcode_position::process_g2(position* pos, parsed_command& cmd)
       f = p_cur_param.double_value;
     }
   }
-  update_position(pos, x, update_x, y, update_y, 0, false, e, update_e, f, update_f, false, true);
-}
-
-void gcode_position::process_g3(position* pos, parsed_command& cmd)
-{
-  return process_g2(pos, cmd);
+  update_position(pos, x, update_x, y, update_y, z, update_z, e, update_e, f, update_f, false, true);
 }
 
 void gcode_position::process_g10(position* pos, parsed_command& cmd)
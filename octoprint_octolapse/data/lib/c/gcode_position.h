@@ -27,7 +27,11 @@
 #include "gcode_parser.h"
 #include "position.h"
 #include "gcode_comment_processor.h"
+#include "position_restrictions.h"
 #define NUM_POSITIONS 10
+#define GCODE_POSITION_MAX_FIXED_POINT_DECIMALS 9
+// The snapshot bounds check performed by the specialized position engines
+enum gcode_position_bounds_type { POSITION_BOUNDS_NONE = 0, POSITION_BOUNDS_RECTANGULAR = 1, POSITION_BOUNDS_CIRCULAR = 2 };
 
 struct gcode_position_args
 {
@@ -70,6 +74,7 @@ struct gcode_position_args
     num_extruders = 1;
     default_extruder = 0;
     zero_based_extruder = true;
+    fixed_point_decimals = 0;
     std::vector<std::string> location_detection_commands; // Final list of location detection commands
     set_num_extruders(num_extruders);
   }
@@ -120,7 +125,12 @@ struct gcode_position_args
   std::string xyz_axis_default_mode;
   std::string e_axis_default_mode;
   std::string units_default;
+  // When greater than 0, XYZ and E are tracked as integers with this many decimal places (see GCODE_POSITION_MAX_FIXED_POINT_DECIMALS).
+  // 0 tracks them as doubles.
+  int fixed_point_decimals;
   std::vector<std::string> location_detection_commands; // Final list of location detection commands
+  // Trigger position restrictions.  If there are none, every position is in position.
+  std::vector<position_restriction> position_restrictions;
   gcode_position_args& operator=(const gcode_position_args& pos_args);
   void set_num_extruders(int num_extruders);
   void delete_retraction_lengths();
@@ -133,11 +143,13 @@ class gcode_position
 {
 public:
   typedef void (gcode_position::*pos_function_type)(position*, parsed_command&);
+  typedef void (gcode_position::*update_state_function_type)(position*, position*, const parsed_command&);
   gcode_position(gcode_position_args args);
   gcode_position();
   virtual ~gcode_position();
 
-  void update(parsed_command& command, long file_line_number, long gcode_number, const long file_position);
+  void update(parsed_command& command, long long file_line_number, long long gcode_number,
+              long long file_position);
   void update_position(position* position, double x, bool update_x, double y, bool update_y, double z, bool update_z,
                        double e, bool update_e, double f, bool update_f, bool force, bool is_g1_g0) const;
   void undo_update();
@@ -185,15 +197,32 @@ private:
   int num_extruders_;
   bool shared_extruder_;
   bool zero_based_extruder_;
+  position_restrictions position_restrictions_;
+  // Fixed point mode.  XYZ and E are quantized to integer multiples of 1/fixed_point_scale_, so sums and comparisons are exact.
+  int fixed_point_decimals_;
+  double fixed_point_scale_;
+  bool is_fixed_point() const;
+  long long to_fixed(double value) const;
+  double from_fixed(long long value) const;
+  double add_coordinates(double value_1, double value_2) const;
+  bool coordinates_equal(double value_1, double value_2) const;
+  double get_coordinate(const parsed_command_parameter& parameter) const;
 
   std::map<std::string, pos_function_type> gcode_functions_;
   std::map<std::string, pos_function_type>::iterator gcode_functions_iterator_;
 
   std::map<std::string, pos_function_type> get_gcode_functions();
+  /// Extruder, bounds and layer state calculations, specialized for the printer configuration
+  update_state_function_type update_state_;
+  static update_state_function_type get_update_state_function(int num_extruders, int bounds_type,
+                                                              bool use_height_increment);
+  template <bool IsSingleExtruder, int BoundsType, bool UseHeightIncrement>
+  void update_state(position* p_current_pos, position* p_previous_pos, const parsed_command& command);
   /// Process Gcode Command Functions
   void process_g0_g1(position*, parsed_command&);
   void process_g2(position*, parsed_command&);
   void process_g3(position*, parsed_command&);
+  void process_g2_g3(position*, parsed_command&);
   void process_g10(position*, parsed_command&);
   void process_g11(position*, parsed_command&);
   void process_g20(position*, parsed_command&);
@@ -211,6 +240,8 @@ private:
   void process_t(position*, parsed_command&);
 
   gcode_comment_processor comment_processor_;
+  void update_position_restrictions(position* p_current_pos, const position* p_previous_pos,
+                                    const parsed_command& command) const;
   void delete_retraction_lengths_();
   void delete_z_lift_heights_();
   void set_num_extruders(int num_extruders);
@@ -24,16 +24,19 @@
 #include <iomanip>
 #include <sstream>
 #include <iostream>
+#include <cstring>
+#include <cstdlib>
 #include "utilities.h"
 #include "stabilization_smart_layer.h"
 #include "stabilization.h"
+#include "gcode_file_reader.h"
 #include "logging.h"
+#include "jpeg_image.h"
+#include "python_bindings.h"
 #include "python_helpers.h"
-#ifdef _DEBUG
-#include "test.h"
-#endif
-// Sometimes used to test performance in release mode.
-//#include "test.h"
+#include "python_logging.h"
+#include "instrumentation.h"
+// Use stabilization_cli.cpp to profile or benchmark the native code outside of python.
 
 #if PY_MAJOR_VERSION >= 3
 int main(int argc, char *argv[])
@@ -64,13 +67,6 @@ int main(int argc, char *argv[])
 
 int main(int argc, char* argv[])
 {
-#ifdef _DEBUG
-	run_tests(argc, argv);
-	return 0;
-#endif
-  // I use this sometimes to test performance in release mode
-  //run_tests(argc, argv);
-  //return 0;
   Py_SetProgramName(argv[0]);
   Py_Initialize();
   PyEval_InitThreads();
@@ -123,6 +119,98 @@ static PyMethodDef GcodePositionProcessorMethods[] = {
     "GetSnapshotPlans_SmartGcode", (PyCFunction)GetSnapshotPlans_SmartGcode, METH_VARARGS,
     "Parses a gcode file and returns snapshot plans for a 'SmartGcode' stabilization."
   },
+  {
+    "GetSnapshotPlansBatch", (PyCFunction)GetSnapshotPlansBatch, METH_VARARGS,
+    "Preprocesses a list of files on a thread pool, largest first, calling the completion callback as each finishes."
+  },
+  {
+    "InitializeSnapshotPlanCursor", (PyCFunction)InitializeSnapshotPlanCursor, METH_VARARGS,
+    "Creates a snapshot plan cursor from a list of (file_gcode_number, file_position) tuples."
+  },
+  {
+    "CheckSnapshotPlanCursor", (PyCFunction)CheckSnapshotPlanCursor, METH_VARARGS,
+    "Returns the index of the snapshot plan triggered by the supplied file gcode number, or -1."
+  },
+  {
+    "SeekSnapshotPlanCursor", (PyCFunction)SeekSnapshotPlanCursor, METH_VARARGS,
+    "Moves the snapshot plan cursor to the supplied file position and returns the next plan index, or -1."
+  },
+  {
+    "InitializeGcodeQueueFilter", (PyCFunction)InitializeGcodeQueueFilter, METH_VARARGS,
+    "Creates the per-line gcode queue filter, which uses the snapshot plan cursor with the same key."
+  },
+  {
+    "FilterQueuedGcode", (PyCFunction)FilterQueuedGcode, METH_VARARGS,
+    "Returns a verdict for a queued line and its tags.  Zero means the line can be sent without further processing."
+  },
+  {
+    "ParseFirmwareResponse", (PyCFunction)ParseFirmwareResponse, METH_VARARGS,
+    "Classifies a line received from the printer and returns (type, has_ok, values), or None if it was ignored."
+  },
+  {
+    "InitializeSnapshotTrigger", (PyCFunction)InitializeSnapshotTrigger, METH_VARARGS,
+    "Creates a native real-time snapshot trigger, which is updated by the gcode queue filter with the same key."
+  },
+  {
+    "GetSnapshotTriggerState", (PyCFunction)GetSnapshotTriggerState, METH_VARARGS,
+    "Returns the current state of the native snapshot trigger in tuple form."
+  },
+  {
+    "PauseSnapshotTrigger", (PyCFunction)PauseSnapshotTrigger, METH_VARARGS,
+    "Pauses the native snapshot trigger's timer."
+  },
+  {
+    "ResumeSnapshotTrigger", (PyCFunction)ResumeSnapshotTrigger, METH_VARARGS,
+    "Resumes the native snapshot trigger's timer."
+  },
+  {
+    "ExtractSlicerSettings", (PyCFunction)ExtractSlicerSettings, METH_VARARGS,
+    "Extracts slicer settings from the start and end of a gcode file, returning the matches for each settings format."
+  },
+  {
+    "ReadGcodeFileLines", (PyCFunction)ReadGcodeFileLines, METH_VARARGS,
+    "Reads a gcode file through windows of the given size and returns a (line, position) tuple for each line, or None "
+    "if the file could not be read to the end."
+  },
+  {
+    "RefreshLogLevels", (PyCFunction)RefreshLogLevels, METH_VARARGS,
+    "Reloads the cached log levels.  Call this whenever the python logging configuration changes."
+  },
+  {
+    "FlushLog", (PyCFunction)FlushLog, METH_VARARGS,
+    "Sends any buffered log messages to python."
+  },
+  {
+    "SetStatsEnabled", (PyCFunction)SetStatsEnabled, METH_VARARGS,
+    "Turns the collection of processing statistics on or off."
+  },
+  {"GetStats", (PyCFunction)GetStats, METH_VARARGS, "Returns the processing statistics in dict form."},
+  {"ResetStats", (PyCFunction)ResetStats, METH_VARARGS, "Clears the processing statistics."},
+  {
+    "WriteStatsTrace", (PyCFunction)WriteStatsTrace, METH_VARARGS,
+    "Writes the recorded calls and processing phases to a chrome trace-event JSON file."
+  },
+  {
+    "GetJpegSize", (PyCFunction)GetJpegSize, METH_VARARGS,
+    "Returns the (width, height) of a JPEG that PrepareFrames can decode, or None if it can't."
+  },
+  {
+    "PrepareFrames", (PyCFunction)PrepareFrames, METH_VARARGS,
+    "Decodes and overlays snapshots on every core, and writes them to a file descriptor as raw RGB24 video."
+  },
+  {
+    "TransformJpeg", (PyCFunction)TransformJpeg, METH_VARARGS,
+    "Losslessly flips, rotates or transposes a JPEG in place.  Returns False if the JPEG can't be transformed losslessly."
+  },
+  {
+    "DecodeJpegScaled", (PyCFunction)DecodeJpegScaled, METH_VARARGS,
+    "Decodes a JPEG at the smallest 1/1, 1/2, 1/4 or 1/8 scale that is at least the given size.  Returns "
+    "(width, height, rgb_bytes), or None if the JPEG is not supported."
+  },
+  {
+    "RegisterFrames", (PyCFunction)RegisterFrames, METH_VARARGS,
+    "Measures the jitter between consecutive snapshots and returns the sub-pixel offset that aligns each one."
+  },
   {NULL, NULL, 0, NULL}
 };
 
@@ -195,7 +283,7 @@ extern "C" {
 
 static PyObject* GetSnapshotPlans_SmartLayer(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  octolapse_log_flusher flush_log;
   octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Running smart layer stabilization preprocessing.");
   // TODO:  add error reporting and logging
   PyObject* py_position_args;
@@ -236,25 +324,33 @@ static PyObject* GetSnapshotPlans_SmartLayer(PyObject* self, PyObject* args)
   smart_layer_args mt_args;
   if (!ParseStabilizationArgs_SmartLayer(py_stabilization_type_args, &mt_args))
   {
+    Py_DECREF(py_snapshot_position_callback);
+    Py_DECREF(py_progress_received_callback);
     return NULL;
   }
   //std::cout << "Creating Stabilization.\r\n";
   // Create our stabilization object
-  set_internal_log_levels(false);
   stabilization_smart_layer stabilization(
     p_args,
     s_args,
     mt_args,
-    pythonGetCoordinatesCallback(ExecuteGetSnapshotPositionCallback),
+    ExecuteGetSnapshotPositionCallback,
     py_snapshot_position_callback,
-    pythonProgressCallback(ExecuteStabilizationProgressCallback),
+    ExecuteStabilizationProgressCallback,
     py_progress_received_callback
   );
-  stabilization_results results = stabilization.process_file();
-  set_internal_log_levels(true);
-
-
-  PyObject* py_results = results.to_py_object();
+  // Release the GIL while processing so that other python threads, including other preprocessing jobs, can run.
+  // The callbacks acquire it again when they call into python.
+  stabilization_results results;
+  Py_BEGIN_ALLOW_THREADS
+  results = stabilization.process_file();
+  Py_END_ALLOW_THREADS
+  // The stabilization doesn't own the callbacks
+  Py_DECREF(py_snapshot_position_callback);
+  Py_DECREF(py_progress_received_callback);
+
+
+  PyObject* py_results = to_py_object(results);
   if (py_results == NULL)
   {
     return NULL;
@@ -270,7 +366,7 @@ static PyObject* GetSnapshotPlans_SmartLayer(PyObject* self, PyObject* args)
 
 static PyObject* GetSnapshotPlans_SmartGcode(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  octolapse_log_flusher flush_log;
   octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Running smart gcode stabilization preprocessing.");
   // TODO:  add error reporting and logging
   PyObject* py_position_args;
@@ -311,25 +407,33 @@ static PyObject* GetSnapshotPlans_SmartGcode(PyObject* self, PyObject* args)
   smart_gcode_args mt_args;
   if (!ParseStabilizationArgs_SmartGcode(py_stabilization_type_args, &mt_args))
   {
+    Py_DECREF(py_snapshot_position_callback);
+    Py_DECREF(py_progress_received_callback);
     return NULL;
   }
   //std::cout << "Creating Stabilization.\r\n";
   // Create our stabilization object
-  set_internal_log_levels(false);
   stabilization_smart_gcode stabilization(
     p_args,
     s_args,
     mt_args,
-    pythonGetCoordinatesCallback(ExecuteGetSnapshotPositionCallback),
+    ExecuteGetSnapshotPositionCallback,
     py_snapshot_position_callback,
-    pythonProgressCallback(ExecuteStabilizationProgressCallback),
+    ExecuteStabilizationProgressCallback,
     py_progress_received_callback
   );
-  stabilization_results results = stabilization.process_file();
-  set_internal_log_levels(true);
-
-
-  PyObject* py_results = results.to_py_object();
+  // Release the GIL while processing so that other python threads, including other preprocessing jobs, can run.
+  // The callbacks acquire it again when they call into python.
+  stabilization_results results;
+  Py_BEGIN_ALLOW_THREADS
+  results = stabilization.process_file();
+  Py_END_ALLOW_THREADS
+  // The stabilization doesn't own the callbacks
+  Py_DECREF(py_snapshot_position_callback);
+  Py_DECREF(py_progress_received_callback);
+
+
+  PyObject* py_results = to_py_object(results);
   if (py_results == NULL)
   {
     return NULL;
@@ -338,9 +442,58 @@ static PyObject* GetSnapshotPlans_SmartGcode(PyObject* self, PyObject* args)
   return py_results;
 }
 
+static PyObject* GetSnapshotPlansBatch(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  PyObject* py_jobs;
+  PyObject* py_batch_args;
+  PyObject* py_completion_callback;
+  if (!PyArg_ParseTuple(args, "OOO", &py_jobs, &py_batch_args, &py_completion_callback))
+  {
+    std::string message = "GcodePositionProcessor.GetSnapshotPlansBatch - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  if (!PyList_Check(py_jobs) || !PyDict_Check(py_batch_args) || !PyCallable_Check(py_completion_callback))
+  {
+    std::string message =
+      "GcodePositionProcessor.GetSnapshotPlansBatch - Expected a list of jobs, a dict of batch args and a callable.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+
+  stabilization_batch_args batch_args;
+  PyObject* py_num_threads = PyDict_GetItemString(py_batch_args, "num_threads");
+  if (py_num_threads != NULL)
+    batch_args.num_threads = PyLong_AsLong(py_num_threads);
+
+  // Every job holds references to its own callbacks until the batch is complete
+  std::vector<PyObject*> callbacks;
+  const int num_jobs = static_cast<int>(PyList_Size(py_jobs));
+  std::vector<stabilization_batch_job> jobs(num_jobs);
+  bool success = true;
+  for (int index = 0; index < num_jobs && success; index++)
+    success = ParseStabilizationBatchJob(PyList_GetItem(py_jobs, index), &jobs[index], &callbacks);
+
+  int jobs_processed = 0;
+  if (success)
+  {
+    stabilization_batch batch(batch_args);
+    // The workers take the GIL only to call back into python
+    Py_BEGIN_ALLOW_THREADS
+    jobs_processed = batch.process(jobs, ExecuteStabilizationBatchCompletionCallback, py_completion_callback);
+    Py_END_ALLOW_THREADS
+  }
+  for (std::vector<PyObject*>::iterator callback = callbacks.begin(); callback != callbacks.end(); ++callback)
+    Py_DECREF(*callback);
+  if (!success)
+    return NULL;
+  return PyLong_FromLong(jobs_processed);
+}
+
 static PyObject* Initialize(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  octolapse_log_flusher flush_log;
   // Create the gcode position object 
   octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO, "Initializing gcode position processor.");
   const char* pKey;
@@ -388,13 +541,15 @@ static PyObject* Initialize(PyObject* self, PyObject* args)
   gcode_position* p_new_position = new gcode_position(positionArgs);
   // add the new gcode position to our list of objects
   gpp::gcode_positions.insert(std::pair<std::string, gcode_position*>(pKey, p_new_position));
+  // any queue filter with the same key must use the new position
+  UpdateGcodeQueueFilter(pKey);
   // Return True
   return Py_BuildValue("O", Py_True);
 }
 
 static PyObject* Undo(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  octolapse_log_flusher flush_log;
   octolapse_log(
     octolapse_log::GCODE_POSITION, octolapse_log::DEBUG,
     "Undoing the last gcode position update."
@@ -421,7 +576,8 @@ static PyObject* Undo(PyObject* self, PyObject* args)
 
 static PyObject* Update(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  OCTOLAPSE_STATS_CALL(octolapse_stats::UPDATE_CALL);
+  octolapse_log_flusher flush_log;
   octolapse_log(
     octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
     "Updating current position from gcode."
@@ -450,12 +606,13 @@ static PyObject* Update(PyObject* self, PyObject* args)
   gpp::parser->try_parse_gcode(gcode, command);
   p_gcode_position->update(command, -1, -1, -1);
 
-  return p_gcode_position->get_current_position_ptr()->to_py_tuple();
+  return to_py_tuple(*p_gcode_position->get_current_position_ptr());
 }
 
 static PyObject* UpdatePosition(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  OCTOLAPSE_STATS_CALL(octolapse_stats::UPDATE_POSITION_CALL);
+  octolapse_log_flusher flush_log;
   octolapse_log(
     octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
     "Manually updating current position."
@@ -517,12 +674,13 @@ static PyObject* UpdatePosition(PyObject* self, PyObject* args)
     true,
     false);
 
-  return p_gcode_position->get_current_position_ptr()->to_py_tuple();
+  return to_py_tuple(*p_gcode_position->get_current_position_ptr());
 }
 
 static PyObject* Parse(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  OCTOLAPSE_STATS_CALL(octolapse_stats::PARSE_CALL);
+  octolapse_log_flusher flush_log;
   octolapse_log(
     octolapse_log::GCODE_PARSER, octolapse_log::VERBOSE,
     "Parsing gcode."
@@ -536,12 +694,12 @@ static PyObject* Parse(PyObject* self, PyObject* args)
   }
   parsed_command command;
   gpp::parser->try_parse_gcode(gcode, command);
-  return command.to_py_object();
+  return to_py_object(command);
 }
 
 static PyObject* GetCurrentPositionTuple(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  octolapse_log_flusher flush_log;
   octolapse_log(
     octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
     "Getting current position tuple."
@@ -562,12 +720,12 @@ static PyObject* GetCurrentPositionTuple(PyObject* self, PyObject* args)
     return Py_BuildValue("O", Py_False);
   }
   gcode_position* p_gcode_position = gcode_position_iterator->second;
-  return p_gcode_position->get_current_position().to_py_tuple();
+  return to_py_tuple(p_gcode_position->get_current_position());
 }
 
 static PyObject* GetCurrentPositionDict(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  octolapse_log_flusher flush_log;
   octolapse_log(
     octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
     "Getting current position dict."
@@ -590,12 +748,12 @@ static PyObject* GetCurrentPositionDict(PyObject* self, PyObject* args)
   }
   gcode_position* p_gcode_position = gcode_position_iterator->second;
 
-  return p_gcode_position->get_current_position().to_py_dict();
+  return to_py_dict(p_gcode_position->get_current_position());
 }
 
 static PyObject* GetPreviousPositionTuple(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  octolapse_log_flusher flush_log;
   octolapse_log(
     octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
     "Getting previous position tuple."
@@ -616,12 +774,12 @@ static PyObject* GetPreviousPositionTuple(PyObject* self, PyObject* args)
     return Py_BuildValue("O", Py_False);
   }
   gcode_position* p_gcode_position = gcode_position_iterator->second;
-  return p_gcode_position->get_previous_position().to_py_tuple();
+  return to_py_tuple(p_gcode_position->get_previous_position());
 }
 
 static PyObject* GetPreviousPositionDict(PyObject* self, PyObject* args)
 {
-  set_internal_log_levels(true);
+  octolapse_log_flusher flush_log;
   octolapse_log(
     octolapse_log::GCODE_POSITION, octolapse_log::VERBOSE,
     "Getting previous position dict."
@@ -644,853 +802,2316 @@ static PyObject* GetPreviousPositionDict(PyObject* self, PyObject* args)
   }
   gcode_position* p_gcode_position = gcode_position_iterator->second;
 
-  return p_gcode_position->get_previous_position().to_py_dict();
-}
+  return to_py_dict(p_gcode_position->get_previous_position());
 }
 
-static bool ExecuteStabilizationProgressCallback(PyObject* progress_callback, const double percent_complete,
-                                                 const double seconds_elapsed, const double estimated_seconds_remaining,
-                                                 const int gcodes_processed, const int lines_processed)
+static PyObject* InitializeSnapshotPlanCursor(PyObject* self, PyObject* args)
 {
-  //octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::VERBOSE, "Executing the stabilization progress callback.");
-  PyObject* funcArgs = Py_BuildValue("(d,d,d,i,i)", percent_complete, seconds_elapsed, estimated_seconds_remaining,
-                                     gcodes_processed, lines_processed);
-  if (funcArgs == NULL)
+  octolapse_log_flusher flush_log;
+  octolapse_log(
+    octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO,
+    "Initializing the snapshot plan cursor."
+  );
+  const char* key;
+  PyObject* py_plan_locations;
+  if (!PyArg_ParseTuple(args, "sO", &key, &py_plan_locations))
   {
-    std::string message = "GcodePositionProcessor.ExecuteStabilizationProgressCallback - Error parsing parameters.";
+    std::string message = "GcodePositionProcessor.InitializeSnapshotPlanCursor - Error parsing parameters.";
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return false;
+    return NULL;
   }
-
-
-  PyGILState_STATE gstate = PyGILState_Ensure();
-  PyObject* pContinueProcessing = PyObject_CallObject(progress_callback, funcArgs);
-  PyGILState_Release(gstate);
-
-  Py_DECREF(funcArgs);
-
-  if (pContinueProcessing == NULL)
+  const int list_size = PyList_Size(py_plan_locations);
+  if (list_size < 0)
   {
     std::string message =
-      "GcodePositionProcessor.ExecuteStabilizationProgressCallback - Failed to call python progress callback.";
+      "GcodePositionProcessor.InitializeSnapshotPlanCursor - The plan locations argument must be a list.";
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return false;
+    return NULL;
+  }
+  std::vector<snapshot_plan_cursor_entry> entries;
+  entries.reserve(list_size);
+  for (int index = 0; index < list_size; index++)
+  {
+    PyObject* py_location = PyList_GetItem(py_plan_locations, index);
+    long long file_gcode_number;
+    long long file_position;
+    if (py_location == NULL || !PyArg_ParseTuple(py_location, "LL", &file_gcode_number, &file_position))
+    {
+      std::string message =
+        "GcodePositionProcessor.InitializeSnapshotPlanCursor - Each plan location must be a (file_gcode_number, file_position) tuple.";
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      return NULL;
+    }
+    entries.push_back(snapshot_plan_cursor_entry(file_gcode_number, file_position, index));
   }
 
-  bool continue_processing = PyLong_AsLong(pContinueProcessing) > 0;
-  Py_DECREF(pContinueProcessing);
-  return continue_processing;
+  std::map<std::string, snapshot_plan_cursor*>::iterator cursor_iterator = gpp::snapshot_plan_cursors.find(key);
+  if (cursor_iterator != gpp::snapshot_plan_cursors.end())
+  {
+    delete cursor_iterator->second;
+    gpp::snapshot_plan_cursors.erase(cursor_iterator);
+  }
+  snapshot_plan_cursor* p_cursor = new snapshot_plan_cursor(entries);
+  gpp::snapshot_plan_cursors.insert(std::pair<std::string, snapshot_plan_cursor*>(key, p_cursor));
+  // any queue filter with the same key must use the new cursor
+  UpdateGcodeQueueFilter(key);
+  return Py_BuildValue("O", Py_True);
 }
 
-static bool ExecuteGetSnapshotPositionCallback(PyObject* py_get_snapshot_position_callback, double x_initial,
-                                               double y_initial, double& x_result, double& y_result)
+static PyObject* CheckSnapshotPlanCursor(PyObject* self, PyObject* args)
 {
-  //octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::VERBOSE, "Executing the get_snapshot_position callback.");
-  PyObject* funcArgs = Py_BuildValue("(d,d)", x_initial, y_initial);
-  if (funcArgs == NULL)
+  // This is called for every line that is queued while printing, so don't log anything here.
+  const char* key;
+  long long file_gcode_number;
+  if (!PyArg_ParseTuple(args, "sL", &key, &file_gcode_number))
   {
-    std::string message = "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Error parsing parameters.";
+    std::string message = "GcodePositionProcessor.CheckSnapshotPlanCursor - Error parsing parameters.";
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return false;
+    return NULL;
   }
-
-
-  PyGILState_STATE gstate = PyGILState_Ensure();
-  PyObject* pyCoordinates = PyObject_CallObject(py_get_snapshot_position_callback, funcArgs);
-  PyGILState_Release(gstate);
-
-  Py_DECREF(funcArgs);
-
-  if (pyCoordinates == NULL)
+  std::map<std::string, snapshot_plan_cursor*>::iterator cursor_iterator = gpp::snapshot_plan_cursors.find(key);
+  if (cursor_iterator == gpp::snapshot_plan_cursors.end())
   {
-    std::string message =
-      "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Failed to call python get stabilization position callback.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return false;
+    return PyLong_FromLong(-1);
   }
-  PyObject* pyX = PyDict_GetItemString(pyCoordinates, "x");
-  if (pyX == NULL)
+  return PyLong_FromLong(cursor_iterator->second->check(file_gcode_number));
+}
+
+static PyObject* SeekSnapshotPlanCursor(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  const char* key;
+  long long file_position;
+  if (!PyArg_ParseTuple(args, "sL", &key, &file_position))
   {
-    std::string message =
-      "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Failed to parse the return x value.";
+    std::string message = "GcodePositionProcessor.SeekSnapshotPlanCursor - Error parsing parameters.";
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return false;
+    return NULL;
   }
-  x_result = PyFloatOrInt_AsDouble(pyX);
-  PyObject* pyY = PyDict_GetItemString(pyCoordinates, "y");
-  if (pyY == NULL)
+  std::map<std::string, snapshot_plan_cursor*>::iterator cursor_iterator = gpp::snapshot_plan_cursors.find(key);
+  if (cursor_iterator == gpp::snapshot_plan_cursors.end())
   {
-    std::string message =
-      "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Failed to parse the return y value.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return false;
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "GcodePositionProcessor.SeekSnapshotPlanCursor - Could not find a snapshot plan cursor with the given key.");
+    return PyLong_FromLong(-1);
   }
-  y_result = PyFloatOrInt_AsDouble(pyY);
-  Py_DECREF(pyCoordinates);
-  return true;
+  const int plan_index = cursor_iterator->second->seek_file_position(file_position);
+  std::stringstream stream;
+  stream << "Snapshot plan cursor moved to file position " << file_position << ", next plan index: " << plan_index << ".";
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
+  return PyLong_FromLong(plan_index);
 }
 
-/// Argument Parsing
-static bool ParsePositionArgs(PyObject* py_args, gcode_position_args* args)
+static PyObject* InitializeGcodeQueueFilter(PyObject* self, PyObject* args)
 {
+  octolapse_log_flusher flush_log;
   octolapse_log(
-    octolapse_log::GCODE_POSITION, octolapse_log::DEBUG,
-    "Parsing Position Args."
+    octolapse_log::GCODE_POSITION, octolapse_log::INFO,
+    "Initializing the gcode queue filter."
   );
-  // Here is the full structure of the position args:
-  // get the volume py object
-  PyObject* py_volume = PyDict_GetItemString(py_args, "volume");
-  if (py_volume == NULL)
+  const char* key;
+  PyObject* py_filter_args;
+  if (!PyArg_ParseTuple(args, "sO", &key, &py_filter_args))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve volume from the position args dict.";
+    std::string message = "GcodePositionProcessor.InitializeGcodeQueueFilter - Error parsing parameters.";
     octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    return NULL;
   }
-
-  // Here is the full structure of the position args:
-  // get the volume py object
-  PyObject* py_bed_type = PyDict_GetItemString(py_volume, "bed_type");
-  if (py_bed_type == NULL)
+  gcode_queue_filter_args filter_args;
+  if (!ParseGcodeQueueFilterArgs(py_filter_args, &filter_args))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve bed_type from the position args dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    return NULL; // ParseGcodeQueueFilterArgs has taken care of the error message
   }
-  // Extract the bed type string
-  args->is_circular_bed = strcmp(PyUnicode_SafeAsString(py_bed_type), "circular") == 0;
-  // Get Build Plate Area
-  PyObject* py_x_min = PyDict_GetItemString(py_volume, "min_x");
-  if (py_x_min == NULL)
+
+  std::map<std::string, gcode_queue_filter*>::iterator filter_iterator = gpp::gcode_queue_filters.find(key);
+  if (filter_iterator != gpp::gcode_queue_filters.end())
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_x from the position args dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    delete filter_iterator->second;
+    gpp::gcode_queue_filters.erase(filter_iterator);
   }
-  args->x_min = PyFloatOrInt_AsDouble(py_x_min);
+  gpp::gcode_queue_filters.insert(std::pair<std::string, gcode_queue_filter*>(key, new gcode_queue_filter(filter_args)));
+  UpdateGcodeQueueFilter(key);
+  return Py_BuildValue("O", Py_True);
+}
 
-  PyObject* py_x_max = PyDict_GetItemString(py_volume, "max_x");
-  if (py_x_max == NULL)
+static PyObject* InitializeSnapshotTrigger(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  octolapse_log(
+    octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO,
+    "Initializing the snapshot trigger."
+  );
+  const char* key;
+  PyObject* py_trigger_args;
+  if (!PyArg_ParseTuple(args, "sO", &key, &py_trigger_args))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_x from the position args dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    std::string message = "GcodePositionProcessor.InitializeSnapshotTrigger - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  snapshot_trigger_args trigger_args;
+  if (!ParseSnapshotTriggerArgs(py_trigger_args, &trigger_args))
+  {
+    return NULL; // ParseSnapshotTriggerArgs has taken care of the error message
   }
-  args->x_max = PyFloatOrInt_AsDouble(py_x_max);
 
-  PyObject* py_y_min = PyDict_GetItemString(py_volume, "min_y");
-  if (py_y_min == NULL)
+  std::map<std::string, snapshot_trigger*>::iterator trigger_iterator = gpp::snapshot_triggers.find(key);
+  if (trigger_iterator != gpp::snapshot_triggers.end())
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_y from the position args dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    delete trigger_iterator->second;
+    gpp::snapshot_triggers.erase(trigger_iterator);
   }
-  args->y_min = PyFloatOrInt_AsDouble(py_y_min);
+  gpp::snapshot_triggers.insert(std::pair<std::string, snapshot_trigger*>(key, new snapshot_trigger(trigger_args)));
+  UpdateGcodeQueueFilter(key);
+  return Py_BuildValue("O", Py_True);
+}
 
-  PyObject* py_y_max = PyDict_GetItemString(py_volume, "max_y");
-  if (py_y_max == NULL)
+static PyObject* GetSnapshotTriggerState(PyObject* self, PyObject* args)
+{
+  snapshot_trigger* p_trigger = GetSnapshotTrigger(args, "GetSnapshotTriggerState");
+  if (p_trigger == NULL)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_y from the position args dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    if (PyErr_Occurred())
+      return NULL;
+    return Py_BuildValue("O", Py_None);
   }
-  args->y_max = PyFloatOrInt_AsDouble(py_y_max);
+  return state_to_py_tuple(*p_trigger);
+}
 
-  PyObject* py_z_min = PyDict_GetItemString(py_volume, "min_z");
-  if (py_z_min == NULL)
+static PyObject* PauseSnapshotTrigger(PyObject* self, PyObject* args)
+{
+  snapshot_trigger* p_trigger = GetSnapshotTrigger(args, "PauseSnapshotTrigger");
+  if (p_trigger == NULL)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_z from the position args dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    if (PyErr_Occurred())
+      return NULL;
+    return Py_BuildValue("O", Py_False);
   }
-  args->z_min = PyFloatOrInt_AsDouble(py_z_min);
+  p_trigger->pause();
+  return Py_BuildValue("O", Py_True);
+}
 
-  PyObject* py_z_max = PyDict_GetItemString(py_volume, "max_z");
-  if (py_z_max == NULL)
+static PyObject* ResumeSnapshotTrigger(PyObject* self, PyObject* args)
+{
+  snapshot_trigger* p_trigger = GetSnapshotTrigger(args, "ResumeSnapshotTrigger");
+  if (p_trigger == NULL)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_z from the position args dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    if (PyErr_Occurred())
+      return NULL;
+    return Py_BuildValue("O", Py_False);
   }
-  args->z_max = PyFloatOrInt_AsDouble(py_z_max);
+  p_trigger->resume();
+  return Py_BuildValue("O", Py_True);
+}
 
-  // Get Bounds
-  PyObject* py_bounds = PyDict_GetItemString(py_volume, "bounds");
-  if (py_bounds == NULL)
+static PyObject* FilterQueuedGcode(PyObject* self, PyObject* args)
+{
+  OCTOLAPSE_STATS_CALL(octolapse_stats::FILTER_QUEUED_GCODE_CALL);
+  // This is called for every queued line, so don't log anything unless there is an error.
+  const char* key;
+  const char* gcode;
+  PyObject* py_tags;
+  long update_triggers = 0;
+  if (!PyArg_ParseTuple(args, "ssO|l", &key, &gcode, &py_tags, &update_triggers))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve bounds from the position args dict.";
+    std::string message = "GcodePositionProcessor.FilterQueuedGcode - Error parsing parameters.";
     octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    return NULL;
   }
-  // If py_bounds is a dict, we have no snapshot boundaries other than the printer volume
-  if (PyDict_Check(py_bounds) < 1)
+  std::map<std::string, gcode_queue_filter*>::iterator filter_iterator = gpp::gcode_queue_filters.find(key);
+  if (filter_iterator == gpp::gcode_queue_filters.end())
   {
-    octolapse_log(
-      octolapse_log::GCODE_PARSER, octolapse_log::DEBUG,
-      "No snapshot restrictions set."
-    );
-    args->is_bound_ = false;
+    return PyLong_FromLong(gcode_queue_filter_verdict_not_file_gcode);
   }
-  else
-  {
-    args->is_bound_ = true;
-    octolapse_log(
-      octolapse_log::GCODE_PARSER, octolapse_log::INFO,
-      "Snapshot restrictions set."
-    );
 
-    PyObject* py_snapshot_x_min = PyDict_GetItemString(py_bounds, "min_x");
-    if (py_snapshot_x_min == NULL)
-    {
-      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_x from the bounds dict.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
-    }
-    args->snapshot_x_min = PyFloatOrInt_AsDouble(py_snapshot_x_min);
-
-    PyObject* py_snapshot_x_max = PyDict_GetItemString(py_bounds, "max_x");
-    if (py_snapshot_x_max == NULL)
+  bool is_file_gcode = false;
+  bool is_octolapse_gcode = false;
+  bool is_snapshot_gcode = false;
+  long long file_line = -1;
+  PyObject* py_iterator = PyObject_GetIter(py_tags);
+  if (py_iterator == NULL)
+  {
+    // No tags, the line must still be filtered so that the position is updated.
+    PyErr_Clear();
+  }
+  PyObject* py_tag;
+  while (py_iterator != NULL && (py_tag = PyIter_Next(py_iterator)) != NULL)
+  {
+    const char* tag = PyUnicode_SafeAsString(py_tag);
+    if (tag == NULL)
     {
-      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_x from the bounds dict.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
+      PyErr_Clear();
     }
-    args->snapshot_x_max = PyFloatOrInt_AsDouble(py_snapshot_x_max);
-
-    PyObject* py_snapshot_y_min = PyDict_GetItemString(py_bounds, "min_y");
-    if (py_snapshot_y_min == NULL)
+    else if (tag[0] == 's' && std::strcmp(tag, "source:file") == 0)
     {
-      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_y from the bounds dict.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
+      is_file_gcode = true;
     }
-    args->snapshot_y_min = PyFloatOrInt_AsDouble(py_snapshot_y_min);
-
-    PyObject* py_snapshot_y_max = PyDict_GetItemString(py_bounds, "max_y");
-    if (py_snapshot_y_max == NULL)
+    else if (tag[0] == 'f' && std::strncmp(tag, "fileline:", 9) == 0)
     {
-      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_y from the bounds dict.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
+      file_line = std::strtoll(tag + 9, NULL, 10);
     }
-    args->snapshot_y_max = PyFloatOrInt_AsDouble(py_snapshot_y_max);
-
-    PyObject* py_snapshot_z_min = PyDict_GetItemString(py_bounds, "min_z");
-    if (py_snapshot_z_min == NULL)
+    else if (tag[0] == 'p' && std::strcmp(tag, "plugin:octolapse") == 0)
     {
-      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_z from the bounds dict.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
+      is_octolapse_gcode = true;
     }
-    args->snapshot_z_min = PyFloatOrInt_AsDouble(py_snapshot_z_min);
-
-    PyObject* py_snapshot_z_max = PyDict_GetItemString(py_bounds, "max_z");
-    if (py_snapshot_z_max == NULL)
+    else if (tag[0] == 's' && std::strcmp(tag, "snapshot_gcode") == 0)
     {
-      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_z from the bounds dict.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
+      is_snapshot_gcode = true;
     }
-    args->snapshot_z_max = PyFloatOrInt_AsDouble(py_snapshot_z_max);
-
-    std::stringstream stream;
-
-    stream << "Bounds - " <<
-      "X:(" << utilities::to_string(args->snapshot_x_min) << "," << utilities::to_string(args->snapshot_x_max) << ") "
-      <<
-      "Y:(" << utilities::to_string(args->snapshot_y_min) << "," << utilities::to_string(args->snapshot_y_max) << ") "
-      <<
-      "Z:(" << utilities::to_string(args->snapshot_z_min) << "," << utilities::to_string(args->snapshot_z_max) << ") ";
-    octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::DEBUG, stream.str());
+    Py_DECREF(py_tag);
   }
+  Py_XDECREF(py_iterator);
 
-#pragma region location_detection_commands
-  // Get LocationDetection Commands
-  PyObject* py_location_detection_commands = PyDict_GetItemString(py_args, "location_detection_commands");
-  if (py_location_detection_commands == NULL)
+  return PyLong_FromLong(
+    filter_iterator->second->filter(
+      gcode, is_file_gcode, file_line, is_octolapse_gcode, is_octolapse_gcode && is_snapshot_gcode, update_triggers > 0
+    )
+  );
+}
+
+static PyObject* ParseFirmwareResponse(PyObject* self, PyObject* args)
+{
+  OCTOLAPSE_STATS_CALL(octolapse_stats::PARSE_FIRMWARE_RESPONSE_CALL);
+  // This is called for every line the printer sends, so don't log anything unless there is an error.
+  const char* line;
+  long types = FIRMWARE_RESPONSE_ALL_TYPES;
+  if (!PyArg_ParseTuple(args, "s|l", &line, &types))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve location_detection_commands from the bounds dict.";
+    std::string message = "GcodePositionProcessor.ParseFirmwareResponse - Error parsing parameters.";
     octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    return NULL;
   }
-  // Extract the elements from  the location detection command list pyobject
-  const int listSize = PyList_Size(py_location_detection_commands);
-  if (listSize < 0)
+  firmware_response response;
+  if (firmware_response::parse(line, static_cast<int>(types), response) == firmware_response_type_ignored)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to build position arguments, LocationDetectionCommands is not a list.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    Py_RETURN_NONE;
   }
 
-  for (int index = 0; index < listSize; index++)
+  PyObject* py_values;
+  switch (response.type)
   {
-    PyObject* pyListItem = PyList_GetItem(py_location_detection_commands, index);
-    if (pyListItem == NULL)
+  case firmware_response_type_position:
     {
-      std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - Could not extract a list item from index from the location detection commands.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
+      PyObject* py_extruder_e = PyTuple_New(response.num_extruders);
+      if (py_extruder_e == NULL)
+        return NULL;
+      for (int index = 0; index < response.num_extruders; index++)
+      {
+        PyTuple_SET_ITEM(py_extruder_e, index, PyFloat_FromDouble(response.extruder_e[index]));
+      }
+      py_values = Py_BuildValue(
+        "(dddNN)", response.x, response.y, response.z, PyFloatOrNone(response.has_e, response.e), py_extruder_e
+      );
     }
-    if (!PyUnicode_SafeCheck(pyListItem))
+    break;
+  case firmware_response_type_temperature:
+    py_values = Py_BuildValue(
+      "(NNNN)",
+      PyFloatOrNone(response.has_tool_temp, response.tool_temp),
+      PyFloatOrNone(response.has_tool_target, response.tool_target),
+      PyFloatOrNone(response.has_bed_temp, response.bed_temp),
+      PyFloatOrNone(response.has_bed_target, response.bed_target)
+    );
+    break;
+  case firmware_response_type_resend:
+    if (response.line_number < 0)
     {
-      std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - Argument 16 (location_detection_commands) must be a list of strings.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
+      Py_INCREF(Py_None);
+      py_values = Py_None;
     }
-    std::string command = PyUnicode_SafeAsString(pyListItem);
-    args->location_detection_commands.push_back(command);
-  }
-#pragma endregion Parse the list of location detection commands
+    else
+      py_values = PyLong_FromLong(response.line_number);
+    break;
+  default:
+    Py_INCREF(Py_None);
+    py_values = Py_None;
+    break;
+  }
+  if (py_values == NULL)
+    return NULL;
+  return Py_BuildValue("(iNN)", static_cast<int>(response.type), PyBool_FromLong(response.has_ok), py_values);
+}
 
-  // xyz_axis_default_mode
-  PyObject* py_xyz_axis_default_mode = PyDict_GetItemString(py_args, "xyz_axis_default_mode");
-  if (py_xyz_axis_default_mode == NULL)
+static PyObject* ExtractSlicerSettings(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  const char* file_path;
+  PyObject* py_formats;
+  if (!PyArg_ParseTuple(args, "sO", &file_path, &py_formats))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve xyz_axis_default_mode from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    std::string message = "GcodePositionProcessor.ExtractSlicerSettings - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
   }
-  args->xyz_axis_default_mode = PyUnicode_SafeAsString(py_xyz_axis_default_mode);
-
-  // e_axis_default_mode
-  PyObject* py_e_axis_default_mode = PyDict_GetItemString(py_args, "e_axis_default_mode");
-  if (py_e_axis_default_mode == NULL)
+  const int num_formats = PyList_Size(py_formats);
+  if (num_formats < 0)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve e_axis_default_mode from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    std::string message = "GcodePositionProcessor.ExtractSlicerSettings - The settings formats must be a list.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
   }
-  args->e_axis_default_mode = PyUnicode_SafeAsString(py_e_axis_default_mode);
-
-  // units_default
-  PyObject* py_units_default = PyDict_GetItemString(py_args, "units_default");
-  if (py_units_default == NULL)
+  std::vector<slicer_settings_format> formats;
+  for (int index = 0; index < num_formats; index++)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve units_default from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    slicer_settings_format format;
+    if (!ParseSlicerSettingsFormat(PyList_GetItem(py_formats, index), &format))
+      return NULL; // ParseSlicerSettingsFormat has taken care of the error message
+    formats.push_back(format);
   }
-  args->units_default = PyUnicode_SafeAsString(py_units_default);
 
-  // autodetect_position
-  PyObject* py_autodetect_position = PyDict_GetItemString(py_args, "autodetect_position");
-  if (py_autodetect_position == NULL)
+  const clock_t start_clock = clock();
+  slicer_settings_extractor extractor(formats);
+  std::vector<slicer_settings_result> results;
+  if (!extractor.extract(file_path, results))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve autodetect_position from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    // The caller can fall back to reading the file itself
+    return Py_BuildValue("O", Py_None);
   }
-  args->autodetect_position = PyLong_AsLong(py_autodetect_position) > 0;
+  std::stringstream stream;
+  stream << "Slicer settings extracted in " << static_cast<double>(clock() - start_clock) / CLOCKS_PER_SEC
+    << " seconds.";
+  octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::INFO, stream.str());
 
-  // Here is the full structure of the position args:
-  // get the volume py object
-  PyObject* py_home = PyDict_GetItemString(py_args, "home_position");
-  if (py_home == NULL)
+  PyObject* py_results = PyDict_New();
+  if (py_results == NULL)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve home_position from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    std::string message = "GcodePositionProcessor.ExtractSlicerSettings - Unable to create the results dict.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
+  }
+  for (unsigned int index = 0; index < results.size(); index++)
+  {
+    PyObject* py_result = to_py_object(results[index]);
+    if (py_result == NULL)
+    {
+      Py_DECREF(py_results);
+      return NULL; // to_py_object has taken care of the error message
+    }
+    const int error = PyDict_SetItemString(py_results, results[index].name.c_str(), py_result);
+    Py_DECREF(py_result);
+    if (error != 0)
+    {
+      Py_DECREF(py_results);
+      std::string message = "GcodePositionProcessor.ExtractSlicerSettings - Unable to add a result to the results dict.";
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
   }
+  return py_results;
+}
 
-  // home_x
-  PyObject* py_home_x = PyDict_GetItemString(py_home, "home_x");
-  if (py_home_x == NULL)
+static PyObject* ReadGcodeFileLines(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  const char* file_path;
+  long long window_size;
+  PyObject* py_map_file;
+  if (!PyArg_ParseTuple(args, "sLO", &file_path, &window_size, &py_map_file))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve home_x from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    std::string message = "GcodePositionProcessor.ReadGcodeFileLines - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
   }
-  if (py_home_x == Py_None)
+  gcode_file_reader file(window_size, PyObject_IsTrue(py_map_file) > 0);
+  std::vector<std::string> lines;
+  std::vector<long long> positions;
+  bool is_read;
+  Py_BEGIN_ALLOW_THREADS
+  is_read = file.open(file_path);
+  std::string line;
+  while (is_read && file.read_line(line))
   {
-    args->home_x_none = true;
+    lines.push_back(line);
+    positions.push_back(file.get_position());
   }
-  else
+  is_read = is_read && !file.has_error();
+  Py_END_ALLOW_THREADS
+  if (!is_read)
+    Py_RETURN_NONE;
+
+  PyObject* py_lines = PyList_New(0);
+  if (py_lines == NULL)
   {
-    args->home_x = PyFloatOrInt_AsDouble(py_home_x);
+    std::string message = "GcodePositionProcessor.ReadGcodeFileLines - Unable to create the lines list.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
+  }
+  for (unsigned int index = 0; index < lines.size(); index++)
+  {
+    PyObject* py_line = Py_BuildValue(
+      "(N,L)", PyBytes_FromStringAndSize(lines[index].c_str(), lines[index].size()), positions[index]
+    );
+    if (py_line == NULL)
+    {
+      Py_DECREF(py_lines);
+      std::string message = "GcodePositionProcessor.ReadGcodeFileLines - Unable to create a line tuple.";
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
+    const int error = PyList_Append(py_lines, py_line);
+    Py_DECREF(py_line);
+    if (error != 0)
+    {
+      Py_DECREF(py_lines);
+      std::string message = "GcodePositionProcessor.ReadGcodeFileLines - Unable to add a line to the lines list.";
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
   }
+  return py_lines;
+}
 
-  // home_y
-  PyObject* py_home_y = PyDict_GetItemString(py_home, "home_y");
-  if (py_home_y == NULL)
+static PyObject* RefreshLogLevels(PyObject* self, PyObject* args)
+{
+  octolapse_refresh_log_levels();
+  return Py_BuildValue("O", Py_True);
+}
+
+static PyObject* FlushLog(PyObject* self, PyObject* args)
+{
+  octolapse_flush_log();
+  return Py_BuildValue("O", Py_True);
+}
+
+static PyObject* SetStatsEnabled(PyObject* self, PyObject* args)
+{
+  PyObject* py_enabled;
+  if (!PyArg_ParseTuple(args, "O", &py_enabled))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve home_y from the position dict.";
+    std::string message = "GcodePositionProcessor.SetStatsEnabled - Error parsing parameters.";
     octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    return NULL;
   }
-  if (py_home_y == Py_None)
+#ifndef OCTOLAPSE_DISABLE_STATS
+  octolapse_set_stats_enabled(PyObject_IsTrue(py_enabled) > 0);
+  return Py_BuildValue("O", Py_True);
+#else
+  // Statistics were compiled out
+  return Py_BuildValue("O", Py_False);
+#endif
+}
+
+static PyObject* GetStats(PyObject* self, PyObject* args)
+{
+#ifndef OCTOLAPSE_DISABLE_STATS
+  return octolapse_stats_to_py_object();
+#else
+  Py_RETURN_NONE;
+#endif
+}
+
+static PyObject* ResetStats(PyObject* self, PyObject* args)
+{
+#ifndef OCTOLAPSE_DISABLE_STATS
+  octolapse_reset_stats();
+  return Py_BuildValue("O", Py_True);
+#else
+  return Py_BuildValue("O", Py_False);
+#endif
+}
+
+static PyObject* WriteStatsTrace(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  const char* file_path;
+  if (!PyArg_ParseTuple(args, "s", &file_path))
   {
-    args->home_y_none = true;
+    std::string message = "GcodePositionProcessor.WriteStatsTrace - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return NULL;
   }
-  else
+#ifndef OCTOLAPSE_DISABLE_STATS
+  return Py_BuildValue("O", octolapse_write_stats_trace(file_path) ? Py_True : Py_False);
+#else
+  return Py_BuildValue("O", Py_False);
+#endif
+}
+
+static PyObject* GetJpegSize(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  const char* file_path;
+  if (!PyArg_ParseTuple(args, "s", &file_path))
   {
-    args->home_y = PyFloatOrInt_AsDouble(py_home_y);
+    std::string message = "GcodePositionProcessor.GetJpegSize - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return NULL;
   }
+  jpeg_image image;
+  bool is_supported;
+  Py_BEGIN_ALLOW_THREADS
+  is_supported = image.read_file(file_path, true);
+  Py_END_ALLOW_THREADS
+  if (!is_supported)
+    Py_RETURN_NONE;
+  return Py_BuildValue("(ii)", image.get_width(), image.get_height());
+}
 
-  // home_z
-  PyObject* py_home_z = PyDict_GetItemString(py_home, "home_z");
-  if (py_home_z == NULL)
+static PyObject* TransformJpeg(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  const char* file_path;
+  const char* transform_name;
+  if (!PyArg_ParseTuple(args, "ss", &file_path, &transform_name))
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve home_z from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    std::string message = "GcodePositionProcessor.TransformJpeg - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT, message);
+    return NULL;
   }
-  if (py_home_z == Py_None)
+  // These are the snapshot_transpose camera setting values
+  static const char* transform_names[] = {
+    "", "flip_left_right", "flip_top_bottom", "rotate_90", "rotate_180", "rotate_270", "transpose"
+  };
+  jpeg_transform transform = JPEG_TRANSFORM_NONE;
+  for (int index = 1; index <= JPEG_TRANSFORM_TRANSPOSE; index++)
   {
-    args->home_z_none = true;
+    if (strcmp(transform_name, transform_names[index]) == 0)
+      transform = static_cast<jpeg_transform>(index);
   }
-  else
+  if (transform == JPEG_TRANSFORM_NONE)
   {
-    args->home_z = PyFloatOrInt_AsDouble(py_home_z);
+    std::string message = "GcodePositionProcessor.TransformJpeg - Unknown transform: ";
+    message += transform_name;
+    octolapse_log(octolapse_log::SNAPSHOT, octolapse_log::ERROR, message);
+    Py_RETURN_FALSE;
   }
-
-  // num_extruders
-  PyObject* py_num_extruders = PyDict_GetItemString(py_args, "num_extruders");
-  if (py_num_extruders == NULL)
+  jpeg_image image;
+  bool is_transformed;
+  Py_BEGIN_ALLOW_THREADS
+  is_transformed = image.read_file(file_path) && image.transform(transform) && image.write_file(file_path);
+  Py_END_ALLOW_THREADS
+  if (!is_transformed)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve num_extruders from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return false;
+    std::string message = "GcodePositionProcessor.TransformJpeg - The snapshot was not transformed: ";
+    message += image.get_error();
+    octolapse_log(octolapse_log::SNAPSHOT, octolapse_log::VERBOSE, message);
+    Py_RETURN_FALSE;
   }
-  args->set_num_extruders(PyLong_AsLong(py_num_extruders));
+  Py_RETURN_TRUE;
+}
 
-  // py_shared_extruder
-  PyObject* py_shared_extruder = PyDict_GetItemString(py_args, "shared_extruder");
-  if (py_shared_extruder == NULL)
+static PyObject* DecodeJpegScaled(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  const char* file_path;
+  int min_width;
+  int min_height;
+  if (!PyArg_ParseTuple(args, "sii", &file_path, &min_width, &min_height))
+  {
+    std::string message = "GcodePositionProcessor.DecodeJpegScaled - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT, message);
+    return NULL;
+  }
+  jpeg_image image;
+  std::vector<unsigned char> pixels;
+  int scale = 1;
+  bool is_decoded;
+  Py_BEGIN_ALLOW_THREADS
+  is_decoded = image.read_file(file_path);
+  if (is_decoded)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve shared_extruder from the position dict.";
+    for (int candidate = 8; candidate > 1; candidate /= 2)
+    {
+      if (image.get_scaled_width(candidate) >= min_width && image.get_scaled_height(candidate) >= min_height)
+      {
+        scale = candidate;
+        break;
+      }
+    }
+    is_decoded = image.to_rgb(pixels, scale);
+  }
+  Py_END_ALLOW_THREADS
+  if (!is_decoded)
+    Py_RETURN_NONE;
+  PyObject* py_pixels = PyBytes_FromStringAndSize(
+    reinterpret_cast<const char*>(&pixels[0]), static_cast<Py_ssize_t>(pixels.size())
+  );
+  if (py_pixels == NULL)
+    return NULL;
+  return Py_BuildValue("(iiN)", image.get_scaled_width(scale), image.get_scaled_height(scale), py_pixels);
+}
+
+static PyObject* RegisterFrames(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  PyObject* py_frame_registration_args;
+  PyObject* py_file_paths;
+  PyObject* py_progress_callback;
+  if (!PyArg_ParseTuple(args, "OOO", &py_frame_registration_args, &py_file_paths, &py_progress_callback))
+  {
+    std::string message = "GcodePositionProcessor.RegisterFrames - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return NULL;
+  }
+  if (!PyCallable_Check(py_progress_callback))
+  {
+    std::string message = "GcodePositionProcessor.RegisterFrames - The progress callback is not callable.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return NULL;
+  }
+  frame_registration_args fr_args;
+  if (!ParseFrameRegistrationArgs(py_frame_registration_args, &fr_args))
+    return NULL;
+  const int num_frames = PyList_Size(py_file_paths);
+  if (num_frames < 0)
+  {
+    std::string message = "GcodePositionProcessor.RegisterFrames - The file paths must be a list.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return NULL;
+  }
+  std::vector<std::string> file_paths(num_frames);
+  for (int index = 0; index < num_frames; index++)
+  {
+    PyObject* py_file_path = PyList_GetItem(py_file_paths, index);
+    if (!PyUnicode_SafeCheck(py_file_path))
+    {
+      std::string message = "GcodePositionProcessor.RegisterFrames - The file paths must be strings.";
+      octolapse_log_exception(octolapse_log::RENDER, message);
+      return NULL;
+    }
+    file_paths[index] = PyUnicode_SafeAsString(py_file_path);
+  }
+
+  const frame_registration registration(fr_args);
+  frame_registration_results results;
+  Py_BEGIN_ALLOW_THREADS
+  registration.register_frames(file_paths, ExecuteFrameProgressCallback, py_progress_callback, results);
+  Py_END_ALLOW_THREADS
+  if (PyErr_Occurred())
+    return NULL;
+  return to_py_object(results);
+}
+
+static PyObject* PrepareFrames(PyObject* self, PyObject* args)
+{
+  octolapse_log_flusher flush_log;
+  PyObject* py_frame_preparer_args;
+  PyObject* py_frames;
+  PyObject* py_progress_callback;
+  if (!PyArg_ParseTuple(args, "OOO", &py_frame_preparer_args, &py_frames, &py_progress_callback))
+  {
+    std::string message = "GcodePositionProcessor.PrepareFrames - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return NULL;
+  }
+  if (!PyCallable_Check(py_progress_callback))
+  {
+    std::string message = "GcodePositionProcessor.PrepareFrames - The progress callback is not callable.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return NULL;
+  }
+  frame_preparer_args fp_args;
+  if (!ParseFramePreparerArgs(py_frame_preparer_args, &fp_args))
+    return NULL;
+  std::vector<frame_source> frames;
+  if (!ParseFrameSources(py_frames, &frames))
+    return NULL;
+
+  const frame_preparer preparer(fp_args);
+  frame_preparer_results results;
+  // Decoding and writing don't need python, the progress callback takes the GIL when it runs.
+  Py_BEGIN_ALLOW_THREADS
+  preparer.prepare(frames, ExecuteFrameProgressCallback, py_progress_callback, results);
+  Py_END_ALLOW_THREADS
+  if (PyErr_Occurred())
+    return NULL;
+  return to_py_object(results);
+}
+}
+
+static PyObject* PyFloatOrNone(bool has_value, double value)
+{
+  if (!has_value)
+  {
+    Py_INCREF(Py_None);
+    return Py_None;
+  }
+  return PyFloat_FromDouble(value);
+}
+
+static void UpdateGcodeQueueFilter(const std::string& key)
+{
+  // The filter uses the position, snapshot plan cursor and snapshot trigger with the same key, any of which may
+  // have been replaced.
+  std::map<std::string, gcode_queue_filter*>::iterator filter_iterator = gpp::gcode_queue_filters.find(key);
+  if (filter_iterator == gpp::gcode_queue_filters.end())
+    return;
+  gcode_queue_filter* p_filter = filter_iterator->second;
+
+  std::map<std::string, gcode_position*>::iterator position_iterator = gpp::gcode_positions.find(key);
+  p_filter->set_position(
+    gpp::parser, position_iterator == gpp::gcode_positions.end() ? NULL : position_iterator->second
+  );
+  std::map<std::string, snapshot_plan_cursor*>::iterator cursor_iterator = gpp::snapshot_plan_cursors.find(key);
+  p_filter->set_snapshot_plan_cursor(
+    cursor_iterator == gpp::snapshot_plan_cursors.end() ? NULL : cursor_iterator->second
+  );
+  std::map<std::string, snapshot_trigger*>::iterator trigger_iterator = gpp::snapshot_triggers.find(key);
+  p_filter->set_snapshot_trigger(trigger_iterator == gpp::snapshot_triggers.end() ? NULL : trigger_iterator->second);
+}
+
+static snapshot_trigger* GetSnapshotTrigger(PyObject* args, const char* function_name)
+{
+  const char* key;
+  if (!PyArg_ParseTuple(args, "s", &key))
+  {
+    std::string message = "GcodePositionProcessor.";
+    message.append(function_name).append(" - Error parsing parameters.");
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  std::map<std::string, snapshot_trigger*>::iterator trigger_iterator = gpp::snapshot_triggers.find(key);
+  if (trigger_iterator == gpp::snapshot_triggers.end())
+  {
+    std::string message = "GcodePositionProcessor.";
+    message.append(function_name).append(" - Could not find a snapshot trigger with the given key.");
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, message);
+    return NULL;
+  }
+  return trigger_iterator->second;
+}
+
+static bool ExecuteStabilizationProgressCallback(void* progress_callback, const double percent_complete,
+                                                 const double seconds_elapsed, const double estimated_seconds_remaining,
+                                                 const long long gcodes_processed,
+                                                 const long long lines_processed)
+{
+  //octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::VERBOSE, "Executing the stabilization progress callback.");
+  // Send anything logged during processing so far
+  octolapse_flush_log();
+  // The GIL is released while processing, so hold it for every python call below.
+  PyGILState_STATE gstate = PyGILState_Ensure();
+  PyObject* funcArgs = Py_BuildValue("(d,d,d,L,L)", percent_complete, seconds_elapsed, estimated_seconds_remaining,
+                                     gcodes_processed, lines_processed);
+  if (funcArgs == NULL)
+  {
+    PyGILState_Release(gstate);
+    std::string message = "GcodePositionProcessor.ExecuteStabilizationProgressCallback - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+
+  PyObject* pContinueProcessing = PyObject_CallObject(static_cast<PyObject*>(progress_callback), funcArgs);
+  Py_DECREF(funcArgs);
+
+  bool continue_processing = false;
+  if (pContinueProcessing != NULL)
+  {
+    continue_processing = PyLong_AsLong(pContinueProcessing) > 0;
+    Py_DECREF(pContinueProcessing);
+  }
+  PyGILState_Release(gstate);
+
+  if (pContinueProcessing == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ExecuteStabilizationProgressCallback - Failed to call python progress callback.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  return continue_processing;
+}
+
+static bool ExecuteGetSnapshotPositionCallback(void* py_get_snapshot_position_callback, double x_initial,
+                                               double y_initial, double& x_result, double& y_result)
+{
+  //octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::VERBOSE, "Executing the get_snapshot_position callback.");
+  // The GIL is released while processing, so hold it for every python call below.
+  PyGILState_STATE gstate = PyGILState_Ensure();
+  PyObject* funcArgs = Py_BuildValue("(d,d)", x_initial, y_initial);
+  if (funcArgs == NULL)
+  {
+    PyGILState_Release(gstate);
+    std::string message = "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Error parsing parameters.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+
+  PyObject* pyCoordinates = PyObject_CallObject(static_cast<PyObject*>(py_get_snapshot_position_callback), funcArgs);
+  Py_DECREF(funcArgs);
+
+  if (pyCoordinates == NULL)
+  {
+    PyGILState_Release(gstate);
+    std::string message =
+      "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Failed to call python get stabilization position callback.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  PyObject* pyX = PyDict_GetItemString(pyCoordinates, "x");
+  PyObject* pyY = PyDict_GetItemString(pyCoordinates, "y");
+  if (pyX != NULL)
+    x_result = PyFloatOrInt_AsDouble(pyX);
+  if (pyY != NULL)
+    y_result = PyFloatOrInt_AsDouble(pyY);
+  Py_DECREF(pyCoordinates);
+  PyGILState_Release(gstate);
+
+  if (pyX == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Failed to parse the return x value.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  if (pyY == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ExecuteGetSnapshotPositionCallback - Failed to parse the return y value.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  return true;
+}
+
+/// Argument Parsing
+static bool ParsePositionArgs(PyObject* py_args, gcode_position_args* args)
+{
+  octolapse_log(
+    octolapse_log::GCODE_POSITION, octolapse_log::DEBUG,
+    "Parsing Position Args."
+  );
+  // Here is the full structure of the position args:
+  // get the volume py object
+  PyObject* py_volume = PyDict_GetItemString(py_args, "volume");
+  if (py_volume == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve volume from the position args dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+
+  // Here is the full structure of the position args:
+  // get the volume py object
+  PyObject* py_bed_type = PyDict_GetItemString(py_volume, "bed_type");
+  if (py_bed_type == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve bed_type from the position args dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  // Extract the bed type string
+  args->is_circular_bed = strcmp(PyUnicode_SafeAsString(py_bed_type), "circular") == 0;
+  // Get Build Plate Area
+  PyObject* py_x_min = PyDict_GetItemString(py_volume, "min_x");
+  if (py_x_min == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_x from the position args dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->x_min = PyFloatOrInt_AsDouble(py_x_min);
+
+  PyObject* py_x_max = PyDict_GetItemString(py_volume, "max_x");
+  if (py_x_max == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_x from the position args dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->x_max = PyFloatOrInt_AsDouble(py_x_max);
+
+  PyObject* py_y_min = PyDict_GetItemString(py_volume, "min_y");
+  if (py_y_min == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_y from the position args dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->y_min = PyFloatOrInt_AsDouble(py_y_min);
+
+  PyObject* py_y_max = PyDict_GetItemString(py_volume, "max_y");
+  if (py_y_max == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_y from the position args dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->y_max = PyFloatOrInt_AsDouble(py_y_max);
+
+  PyObject* py_z_min = PyDict_GetItemString(py_volume, "min_z");
+  if (py_z_min == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_z from the position args dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->z_min = PyFloatOrInt_AsDouble(py_z_min);
+
+  PyObject* py_z_max = PyDict_GetItemString(py_volume, "max_z");
+  if (py_z_max == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_z from the position args dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->z_max = PyFloatOrInt_AsDouble(py_z_max);
+
+  // Get Bounds
+  PyObject* py_bounds = PyDict_GetItemString(py_volume, "bounds");
+  if (py_bounds == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve bounds from the position args dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  // If py_bounds is a dict, we have no snapshot boundaries other than the printer volume
+  if (PyDict_Check(py_bounds) < 1)
+  {
+    octolapse_log(
+      octolapse_log::GCODE_PARSER, octolapse_log::DEBUG,
+      "No snapshot restrictions set."
+    );
+    args->is_bound_ = false;
+  }
+  else
+  {
+    args->is_bound_ = true;
+    octolapse_log(
+      octolapse_log::GCODE_PARSER, octolapse_log::INFO,
+      "Snapshot restrictions set."
+    );
+
+    PyObject* py_snapshot_x_min = PyDict_GetItemString(py_bounds, "min_x");
+    if (py_snapshot_x_min == NULL)
+    {
+      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_x from the bounds dict.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    args->snapshot_x_min = PyFloatOrInt_AsDouble(py_snapshot_x_min);
+
+    PyObject* py_snapshot_x_max = PyDict_GetItemString(py_bounds, "max_x");
+    if (py_snapshot_x_max == NULL)
+    {
+      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_x from the bounds dict.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    args->snapshot_x_max = PyFloatOrInt_AsDouble(py_snapshot_x_max);
+
+    PyObject* py_snapshot_y_min = PyDict_GetItemString(py_bounds, "min_y");
+    if (py_snapshot_y_min == NULL)
+    {
+      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_y from the bounds dict.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    args->snapshot_y_min = PyFloatOrInt_AsDouble(py_snapshot_y_min);
+
+    PyObject* py_snapshot_y_max = PyDict_GetItemString(py_bounds, "max_y");
+    if (py_snapshot_y_max == NULL)
+    {
+      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_y from the bounds dict.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    args->snapshot_y_max = PyFloatOrInt_AsDouble(py_snapshot_y_max);
+
+    PyObject* py_snapshot_z_min = PyDict_GetItemString(py_bounds, "min_z");
+    if (py_snapshot_z_min == NULL)
+    {
+      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve min_z from the bounds dict.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    args->snapshot_z_min = PyFloatOrInt_AsDouble(py_snapshot_z_min);
+
+    PyObject* py_snapshot_z_max = PyDict_GetItemString(py_bounds, "max_z");
+    if (py_snapshot_z_max == NULL)
+    {
+      std::string message = "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve max_z from the bounds dict.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    args->snapshot_z_max = PyFloatOrInt_AsDouble(py_snapshot_z_max);
+
+    std::stringstream stream;
+
+    stream << "Bounds - " <<
+      "X:(" << utilities::to_string(args->snapshot_x_min) << "," << utilities::to_string(args->snapshot_x_max) << ") "
+      <<
+      "Y:(" << utilities::to_string(args->snapshot_y_min) << "," << utilities::to_string(args->snapshot_y_max) << ") "
+      <<
+      "Z:(" << utilities::to_string(args->snapshot_z_min) << "," << utilities::to_string(args->snapshot_z_max) << ") ";
+    octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::DEBUG, stream.str());
+  }
+
+#pragma region location_detection_commands
+  // Get LocationDetection Commands
+  PyObject* py_location_detection_commands = PyDict_GetItemString(py_args, "location_detection_commands");
+  if (py_location_detection_commands == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve location_detection_commands from the bounds dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  // Extract the elements from  the location detection command list pyobject
+  const int listSize = PyList_Size(py_location_detection_commands);
+  if (listSize < 0)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to build position arguments, LocationDetectionCommands is not a list.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+
+  for (int index = 0; index < listSize; index++)
+  {
+    PyObject* pyListItem = PyList_GetItem(py_location_detection_commands, index);
+    if (pyListItem == NULL)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Could not extract a list item from index from the location detection commands.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    if (!PyUnicode_SafeCheck(pyListItem))
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Argument 16 (location_detection_commands) must be a list of strings.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    std::string command = PyUnicode_SafeAsString(pyListItem);
+    args->location_detection_commands.push_back(command);
+  }
+#pragma endregion Parse the list of location detection commands
+
+#pragma region position_restrictions
+  // position_restrictions is optional, and only the live position tracker supplies it
+  PyObject* py_position_restrictions = PyDict_GetItemString(py_args, "position_restrictions");
+  if (py_position_restrictions != NULL && py_position_restrictions != Py_None)
+  {
+    const int num_restrictions = PyList_Size(py_position_restrictions);
+    if (num_restrictions < 0)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Unable to build position arguments, position_restrictions is not a list.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    for (int index = 0; index < num_restrictions; index++)
+    {
+      position_restriction restriction;
+      if (!ParsePositionRestriction(PyList_GetItem(py_position_restrictions, index), &restriction))
+        return false;
+      args->position_restrictions.push_back(restriction);
+    }
+  }
+#pragma endregion position_restrictions
+
+  // fixed_point_decimals is optional, and defaults to 0 (double precision positions)
+  PyObject* py_fixed_point_decimals = PyDict_GetItemString(py_args, "fixed_point_decimals");
+  if (py_fixed_point_decimals != NULL && py_fixed_point_decimals != Py_None)
+  {
+    const long fixed_point_decimals = PyLong_AsLong(py_fixed_point_decimals);
+    if (
+      (fixed_point_decimals == -1 && PyErr_Occurred()) ||
+      fixed_point_decimals < 0 ||
+      fixed_point_decimals > GCODE_POSITION_MAX_FIXED_POINT_DECIMALS)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - fixed_point_decimals must be an integer between 0 and 9.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    args->fixed_point_decimals = static_cast<int>(fixed_point_decimals);
+  }
+
+  // xyz_axis_default_mode
+  PyObject* py_xyz_axis_default_mode = PyDict_GetItemString(py_args, "xyz_axis_default_mode");
+  if (py_xyz_axis_default_mode == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve xyz_axis_default_mode from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->xyz_axis_default_mode = PyUnicode_SafeAsString(py_xyz_axis_default_mode);
+
+  // e_axis_default_mode
+  PyObject* py_e_axis_default_mode = PyDict_GetItemString(py_args, "e_axis_default_mode");
+  if (py_e_axis_default_mode == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve e_axis_default_mode from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->e_axis_default_mode = PyUnicode_SafeAsString(py_e_axis_default_mode);
+
+  // units_default
+  PyObject* py_units_default = PyDict_GetItemString(py_args, "units_default");
+  if (py_units_default == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve units_default from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->units_default = PyUnicode_SafeAsString(py_units_default);
+
+  // autodetect_position
+  PyObject* py_autodetect_position = PyDict_GetItemString(py_args, "autodetect_position");
+  if (py_autodetect_position == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve autodetect_position from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->autodetect_position = PyLong_AsLong(py_autodetect_position) > 0;
+
+  // Here is the full structure of the position args:
+  // get the volume py object
+  PyObject* py_home = PyDict_GetItemString(py_args, "home_position");
+  if (py_home == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve home_position from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+
+  // home_x
+  PyObject* py_home_x = PyDict_GetItemString(py_home, "home_x");
+  if (py_home_x == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve home_x from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  if (py_home_x == Py_None)
+  {
+    args->home_x_none = true;
+  }
+  else
+  {
+    args->home_x = PyFloatOrInt_AsDouble(py_home_x);
+  }
+
+  // home_y
+  PyObject* py_home_y = PyDict_GetItemString(py_home, "home_y");
+  if (py_home_y == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve home_y from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  if (py_home_y == Py_None)
+  {
+    args->home_y_none = true;
+  }
+  else
+  {
+    args->home_y = PyFloatOrInt_AsDouble(py_home_y);
+  }
+
+  // home_z
+  PyObject* py_home_z = PyDict_GetItemString(py_home, "home_z");
+  if (py_home_z == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve home_z from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  if (py_home_z == Py_None)
+  {
+    args->home_z_none = true;
+  }
+  else
+  {
+    args->home_z = PyFloatOrInt_AsDouble(py_home_z);
+  }
+
+  // num_extruders
+  PyObject* py_num_extruders = PyDict_GetItemString(py_args, "num_extruders");
+  if (py_num_extruders == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve num_extruders from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->set_num_extruders(PyLong_AsLong(py_num_extruders));
+
+  // py_shared_extruder
+  PyObject* py_shared_extruder = PyDict_GetItemString(py_args, "shared_extruder");
+  if (py_shared_extruder == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve shared_extruder from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->shared_extruder = PyLong_AsLong(py_shared_extruder) > 0;
+
+  // zero_based_extruder
+  PyObject* py_zero_based_extruder = PyDict_GetItemString(py_args, "zero_based_extruder");
+  if (py_zero_based_extruder == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve zero_based_extruder from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->zero_based_extruder = PyLong_AsLong(py_zero_based_extruder) > 0;
+
+  // default extruder
+  PyObject* py_default_extruder_index = PyDict_GetItemString(py_args, "default_extruder_index");
+  if (py_default_extruder_index == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve default_extruder_index from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  // The zero based default extruder
+  args->default_extruder = PyLong_AsLong(py_default_extruder_index);
+
+  // get the slicer settings dictionary
+  PyObject* py_slicer_settings_dict = PyDict_GetItemString(py_args, "slicer_settings");
+  if (py_slicer_settings_dict == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve slicer_settings from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+
+
+#pragma region Extract extruder objects
+  PyObject* py_extruders = PyDict_GetItemString(py_slicer_settings_dict, "extruders");
+  if (py_extruders == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve extruders list from the slicer settings dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  if (!PyList_Check(py_extruders))
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - The extruders object in the slicer settings dict is not a list.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  const int extruder_list_size = PyList_Size(py_extruders);
+  //std::cout << "Found " << extruder_list_size << " extruders.\r\n";
+  // make sure there is at lest one item in the list
+  if (extruder_list_size < 1)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to build a list of extruders from the slicer settings dict arguments.  There are no extruders in the list.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  if (extruder_list_size < args->num_extruders)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Too few extruders were detected.  There must be at least as many extruders in the list the num_extruders variable.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  for (int index = 0; index < extruder_list_size; index++)
+  {
+    //std::cout << "Extracting the current extruder #" << index << ".\r\n";
+    PyObject* py_extruder = PyList_GetItem(py_extruders, index);
+    if (py_extruder == NULL)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Could not extract an extruder from index from the extruders list.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    // Extract the z_lift_height from the current extruder
+    PyObject* py_z_lift_height = PyDict_GetItemString(py_extruder, "z_lift_height");
+    if (py_z_lift_height == NULL)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve z_lift_height list from the current extruder.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+
+    if (!(PyFloatLongOrInt_Check(py_z_lift_height) || py_z_lift_height == Py_None))
+    {
+      std::string message = "GcodePositionProcessor.ParsePositionArgs - The z_lift_height object must a float or int.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+
+    if (py_z_lift_height == Py_None)
+    {
+      args->z_lift_heights[index] = 0;
+    }
+    else
+    {
+      double height = PyFloatOrInt_AsDouble(py_z_lift_height);
+      args->z_lift_heights[index] = height;
+    }
+
+    // Extract the retraction_length from the current extruder
+    PyObject* py_retraction_length = PyDict_GetItemString(py_extruder, "retraction_length");
+    if (py_retraction_length == NULL)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve retraction_length list from the current extruder.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    if (!(PyFloatLongOrInt_Check(py_retraction_length) || py_retraction_length == Py_None))
+    {
+      std::string message = "GcodePositionProcessor.ParsePositionArgs - The z_lift_height object must a float or int.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    if (py_z_lift_height == Py_None)
+    {
+      args->retraction_lengths[index] = 0;
+    }
+    else
+    {
+      double length = PyFloatOrInt_AsDouble(py_retraction_length);
+      args->retraction_lengths[index] = length;
+    }
+  }
+
+#pragma endregion Parse extruder objects
+
+#pragma region Extract firmware extruder offsets from the printer settings
+  // Only extract extruder offsets if there is more than one extruder.
+  if (args->num_extruders > 1)
+  {
+    PyObject* py_extruder_offsets = PyDict_GetItemString(py_args, "extruder_offsets");
+    if (py_extruder_offsets == NULL)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve extruder_offsets from the position dict.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    if (!PyList_Check(py_extruder_offsets))
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - The extruder_offsets object in the position dict is not a list.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+
+    int extruder_offsets_list_size = PyList_Size(py_extruder_offsets);
+    //std::cout << "Found " << extruder_list_size << " extruders.\r\n";
+    // make sure there is at lest one item in the list
+    if (extruder_offsets_list_size < args->num_extruders && !args->shared_extruder)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Too few extruder offsets were detected.  There must be at least as many extruder offsets in the list as the num_extruders variable when not using a shared extruder.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    if (extruder_offsets_list_size > args->num_extruders && !args->shared_extruder)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Too many extruder offsets were detected.  There can only be as many extruder offsets in the list as the num_extruders variable when not using a shared extruder.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    if (extruder_offsets_list_size > 0 && args->shared_extruder)
+    {
+      std::string message =
+        "GcodePositionProcessor.ParsePositionArgs - Firmware extruder offset values are not allowed when using shared extruders.  Setting offsets to 0.";
+      octolapse_log(octolapse_log::WARNING, octolapse_log::GCODE_POSITION, message);
+      extruder_offsets_list_size = 0;
+    }
+
+    for (int index = 0; index < extruder_offsets_list_size; index++)
+    {
+      std::cout << "Extracting the current extruder offset#" << index << ".\r\n";
+      PyObject* py_extruder_offset = PyList_GetItem(py_extruder_offsets, index);
+      if (py_extruder_offset == NULL)
+      {
+        std::string message =
+          "GcodePositionProcessor.ParsePositionArgs - Could not extract an extruder offset by index from the extruder_offsets list.";
+        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+        return false;
+      }
+      // Extract the x_firmware_offset from the current extruder (called x)
+      PyObject* py_extruder_offset_x = PyDict_GetItemString(py_extruder_offset, "x");
+      if (py_extruder_offset_x == NULL)
+      {
+        std::string message =
+          "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve an x offset from a list item in the the extruder_offsets list.";
+        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+        return false;
+      }
+      std::cout << "Checking x offset value.\r\n";
+      if (!(PyFloatLongOrInt_Check(py_extruder_offset_x) || py_extruder_offset_x == Py_None))
+      {
+        std::string message =
+          "GcodePositionProcessor.ParsePositionArgs - The extruder_offset.x object must a float or int.";
+        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+        return false;
+      }
+      std::cout << "Assigning x offset value.\r\n";
+      if (py_extruder_offset_x == Py_None)
+      {
+        args->x_firmware_offsets[index] = 0;
+      }
+      else
+      {
+        double x = PyFloatOrInt_AsDouble(py_extruder_offset_x);
+        args->x_firmware_offsets[index] = x;
+      }
+      // Extract the x_firmware_offset from the current extruder (called x)
+      PyObject* py_extruder_offset_y = PyDict_GetItemString(py_extruder_offset, "y");
+      if (py_extruder_offset_y == NULL)
+      {
+        std::string message =
+          "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve an y offset from a list item in the the extruder_offsets list.";
+        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+        return false;
+      }
+      std::cout << "Checking y offset value.\r\n";
+      if (!(PyFloatLongOrInt_Check(py_extruder_offset_y) || py_extruder_offset_y == Py_None))
+      {
+        std::string message =
+          "GcodePositionProcessor.ParsePositionArgs - The extruder_offset.y object must a float or int.";
+        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+        return false;
+      }
+      std::cout << "Assigning y offset value.\r\n";
+      if (py_extruder_offset_y == Py_None)
+      {
+        args->y_firmware_offsets[index] = 0;
+      }
+      else
+      {
+        double y = PyFloatOrInt_AsDouble(py_extruder_offset_y);
+        args->y_firmware_offsets[index] = y;
+      }
+    }
+  }
+
+#pragma endregion Extract firmware extruder offsets from the printer settings
+  // priming_height
+  PyObject* py_priming_height = PyDict_GetItemString(py_args, "priming_height");
+  if (py_priming_height == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve priming_height from the position dict.";
     octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
     return false;
   }
-  args->shared_extruder = PyLong_AsLong(py_shared_extruder) > 0;
+  args->priming_height = PyFloatOrInt_AsDouble(py_priming_height);
 
-  // zero_based_extruder
-  PyObject* py_zero_based_extruder = PyDict_GetItemString(py_args, "zero_based_extruder");
-  if (py_zero_based_extruder == NULL)
+  // minimum_layer_height
+  PyObject* py_minimum_layer_height = PyDict_GetItemString(py_args, "minimum_layer_height");
+  if (py_minimum_layer_height == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve zero_based_extruder from the position dict.";
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve minimum_layer_height from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->minimum_layer_height = PyFloatOrInt_AsDouble(py_minimum_layer_height);
+
+  // g90_influences_extruder
+  PyObject* py_g90_influences_extruder = PyDict_GetItemString(py_args, "g90_influences_extruder");
+  if (py_g90_influences_extruder == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve g90_influences_extruder from the position dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->g90_influences_extruder = PyLong_AsLong(py_g90_influences_extruder) > 0;
+
+  return true;
+}
+
+static bool ParsePositionRestrictionDouble(PyObject* py_restriction, const char* name, double* value)
+{
+  // Unused values may be None
+  PyObject* py_value = PyDict_GetItemString(py_restriction, name);
+  if (py_value == NULL)
+  {
+    std::string message = "GcodePositionProcessor.ParsePositionRestriction - Unable to retrieve the ";
+    message.append(name).append(" parameter from the position restriction dict.");
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  *value = py_value == Py_None ? 0 : PyFloatOrInt_AsDouble(py_value);
+  return true;
+}
+
+static bool ParsePositionRestriction(PyObject* py_restriction, position_restriction* restriction)
+{
+  if (py_restriction == NULL || !PyDict_Check(py_restriction))
+  {
+    std::string message = "GcodePositionProcessor.ParsePositionRestriction - Each position restriction must be a dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+
+  // type
+  PyObject* py_type = PyDict_GetItemString(py_restriction, "type");
+  if (py_type == NULL || !PyUnicode_SafeCheck(py_type))
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionRestriction - Unable to retrieve the type parameter from the position restriction dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  const std::string type = PyUnicode_SafeAsString(py_type);
+  if (type == "required")
+    restriction->type = position_restriction_type_required;
+  else if (type == "forbidden")
+    restriction->type = position_restriction_type_forbidden;
+  else
+  {
+    std::string message = "GcodePositionProcessor.ParsePositionRestriction - Unknown position restriction type: ";
+    message.append(type);
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+
+  // shape
+  PyObject* py_shape = PyDict_GetItemString(py_restriction, "shape");
+  if (py_shape == NULL || !PyUnicode_SafeCheck(py_shape))
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionRestriction - Unable to retrieve the shape parameter from the position restriction dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  const std::string shape = PyUnicode_SafeAsString(py_shape);
+  if (shape == "rect")
+    restriction->shape = position_restriction_shape_rect;
+  else if (shape == "circle")
+    restriction->shape = position_restriction_shape_circle;
+  else if (shape == "polygon")
+    restriction->shape = position_restriction_shape_polygon;
+  else
+  {
+    std::string message = "GcodePositionProcessor.ParsePositionRestriction - Unknown position restriction shape: ";
+    message.append(shape);
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+
+  if (
+    !ParsePositionRestrictionDouble(py_restriction, "x", &restriction->x) ||
+    !ParsePositionRestrictionDouble(py_restriction, "y", &restriction->y) ||
+    !ParsePositionRestrictionDouble(py_restriction, "x2", &restriction->x2) ||
+    !ParsePositionRestrictionDouble(py_restriction, "y2", &restriction->y2) ||
+    !ParsePositionRestrictionDouble(py_restriction, "r", &restriction->r)
+  )
+    return false;
+
+  // calculate_intersections
+  PyObject* py_calculate_intersections = PyDict_GetItemString(py_restriction, "calculate_intersections");
+  if (py_calculate_intersections == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParsePositionRestriction - Unable to retrieve the calculate_intersections parameter from the position restriction dict.";
     octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
     return false;
   }
-  args->zero_based_extruder = PyLong_AsLong(py_zero_based_extruder) > 0;
-
-  // default extruder
-  PyObject* py_default_extruder_index = PyDict_GetItemString(py_args, "default_extruder_index");
-  if (py_default_extruder_index == NULL)
+  restriction->calculate_intersections = PyObject_IsTrue(py_calculate_intersections) > 0;
+
+  // points, a list of (x, y) pairs, only used by polygons
+  PyObject* py_points = PyDict_GetItemString(py_restriction, "points");
+  if (restriction->shape == position_restriction_shape_polygon && py_points != NULL && py_points != Py_None)
+  {
+    const int num_points = PyList_Size(py_points);
+    if (num_points < 0)
+    {
+      std::string message = "GcodePositionProcessor.ParsePositionRestriction - The points parameter must be a list.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    for (int index = 0; index < num_points; index++)
+    {
+      PyObject* py_point = PyList_GetItem(py_points, index);
+      if (py_point == NULL || PySequence_Size(py_point) != 2)
+      {
+        std::string message =
+          "GcodePositionProcessor.ParsePositionRestriction - Each polygon point must be a list of two numbers.";
+        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+        return false;
+      }
+      PyObject* py_x = PySequence_GetItem(py_point, 0);
+      PyObject* py_y = PySequence_GetItem(py_point, 1);
+      restriction->points.push_back(
+        position_restriction_point(PyFloatOrInt_AsDouble(py_x), PyFloatOrInt_AsDouble(py_y))
+      );
+      Py_DECREF(py_x);
+      Py_DECREF(py_y);
+    }
+  }
+  return true;
+}
+
+static bool ParseStabilizationArgs(PyObject* py_args, stabilization_args* args, PyObject** py_progress_callback,
+                                   PyObject** py_snapshot_position_callback)
+{
+  octolapse_log(
+    octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG,
+    "Parsing Stabilization Args."
+  );
+  //std::cout << "Parsing Stabilization Args.\r\n";
+  // gcode_generator
+  PyObject* py_gcode_generator = PyDict_GetItemString(py_args, "gcode_generator");
+  if (py_gcode_generator == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve gcode_generator from the smart layer stabilization args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  // Need to incref py_gcode_generator, borrowed ref and we're holding it!
+  // This should no longer be true...
+  //Py_INCREF(py_gcode_generator);
+  // extract the get_snapshot_position callback
+  PyObject* py_get_snapshot_position_callback = PyObject_GetAttrString(py_gcode_generator, "get_snapshot_position");
+  if (py_get_snapshot_position_callback == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve get_snapshot_position function from the gcode_generator object.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  // make sure it is callable
+  if (!PyCallable_Check(py_get_snapshot_position_callback))
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve get_snapshot_position function from the gcode_generator object.";
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, message);
+    return NULL;
+  }
+  // py_get_snapshot_position_callback is a new reference, no reason to incref
+  *py_snapshot_position_callback = py_get_snapshot_position_callback;
+  // on_progress_received
+  PyObject* py_on_progress_received = PyDict_GetItemString(py_args, "on_progress_received");
+  if (py_on_progress_received == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve on_progress_received from the stabilization args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  // need to incref this so it doesn't vanish later (borrowed reference we are saving)
+  Py_IncRef(py_on_progress_received);
+  *py_progress_callback = py_on_progress_received;
+
+
+  // height_increment
+  PyObject* py_height_increment = PyDict_GetItemString(py_args, "height_increment");
+  if (py_height_increment == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve height_increment from the stabilization args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  args->height_increment = PyFloatOrInt_AsDouble(py_height_increment);
+
+  // x_axis_stabilization_disabled
+  PyObject* py_x_stabilization_disabled = PyDict_GetItemString(py_args, "x_stabilization_disabled");
+  if (py_x_stabilization_disabled == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve x_stabilization_disabled from the stabilization args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  args->x_stabilization_disabled = PyLong_AsLong(py_x_stabilization_disabled) > 0;
+
+  // x_axis_stabilization_disabled
+  PyObject* py_y_stabilization_disabled = PyDict_GetItemString(py_args, "y_stabilization_disabled");
+  if (py_x_stabilization_disabled == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve y_stabilization_disabled from the stabilization args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  args->y_stabilization_disabled = PyLong_AsLong(py_y_stabilization_disabled) > 0;
+
+  // notification_period_seconds
+  PyObject* py_notification_period_seconds = PyDict_GetItemString(py_args, "notification_period_seconds");
+  if (py_notification_period_seconds == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve notification_period_seconds from the stabilization args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  args->notification_period_seconds = PyFloatOrInt_AsDouble(py_notification_period_seconds);
+
+
+  // file_path
+  PyObject* py_dict_key = PyString_SafeFromString("file_path");
+  PyObject* py_dict_item = PyDict_GetItem(py_args, py_dict_key);
+  if (py_dict_item == NULL)
+  {
+      std::string message =
+          "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve the file_path from the stabilization args dict.";
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      return false;
+  }
+  Py_DecRef(py_dict_key);
+  /*
+  Py_UNICODE* py_dict_item_unicode = PyUnicode_AsUnicode(py_dict_item);
+  //PyObject* py_file_path = PyDict_GetItemString(py_args, "file_path");
+  if (py_dict_item_unicode == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs - Unable to convert the file_path dict item to a Py_UNICODE .";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }*/
+  
+  args->file_path = PyUnicode_SafeAsString(py_dict_item);
+
+  // snapshot_gcode_args - optional.  If missing, the snapshot gcode will be created while printing.
+  PyObject* py_snapshot_gcode_args = PyDict_GetItemString(py_args, "snapshot_gcode_args");
+  if (py_snapshot_gcode_args != NULL && py_snapshot_gcode_args != Py_None)
+  {
+    if (!ParseSnapshotGcodeArgs(py_snapshot_gcode_args, &args->snapshot_gcode_args))
+    {
+      return false;
+    }
+  }
+
+  // stabilized_gcode_args - optional.  If missing, no stabilized gcode file will be written.
+  PyObject* py_stabilized_gcode_args = PyDict_GetItemString(py_args, "stabilized_gcode_args");
+  if (py_stabilized_gcode_args != NULL && py_stabilized_gcode_args != Py_None)
+  {
+    if (!ParseStabilizedGcodeArgs(py_stabilized_gcode_args, &args->stabilized_gcode))
+    {
+      return false;
+    }
+  }
+  
+  //std::cout << "Stabilization Args parsed successfully.\r\n";
+  return true;
+}
+
+static bool ParseSnapshotGcodeDouble(PyObject* py_extruder, const char* name, double* value, bool* value_null)
+{
+  PyObject* py_value = PyDict_GetItemString(py_extruder, name);
+  if (py_value == NULL)
+  {
+    std::string message = "GcodePositionProcessor.ParseSnapshotGcodeArgs - Unable to retrieve ";
+    message += name;
+    message += " from the current extruder.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  if (py_value == Py_None)
   {
-    std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve default_extruder_index from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    *value = 0;
+    *value_null = true;
+    return true;
+  }
+  if (!PyFloatLongOrInt_Check(py_value))
+  {
+    std::string message = "GcodePositionProcessor.ParseSnapshotGcodeArgs - The ";
+    message += name;
+    message += " object must be a float, int or None.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
-  // The zero based default extruder
-  args->default_extruder = PyLong_AsLong(py_default_extruder_index);
+  *value = PyFloatOrInt_AsDouble(py_value);
+  *value_null = false;
+  return true;
+}
 
-  // get the slicer settings dictionary
-  PyObject* py_slicer_settings_dict = PyDict_GetItemString(py_args, "slicer_settings");
-  if (py_slicer_settings_dict == NULL)
+static bool ParseSnapshotGcodeArgs(PyObject* py_args, snapshot_gcode_generator_args* args)
+{
+  octolapse_log(
+    octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG,
+    "Parsing Snapshot Gcode Args."
+  );
+  // axis_mode_compatibility
+  PyObject* py_axis_mode_compatibility = PyDict_GetItemString(py_args, "axis_mode_compatibility");
+  if (py_axis_mode_compatibility == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve slicer_settings from the position dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      "GcodePositionProcessor.ParseSnapshotGcodeArgs - Unable to retrieve axis_mode_compatibility from the snapshot gcode args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
+  args->axis_mode_compatibility = PyLong_AsLong(py_axis_mode_compatibility) > 0;
 
-
-#pragma region Extract extruder objects
-  PyObject* py_extruders = PyDict_GetItemString(py_slicer_settings_dict, "extruders");
-  if (py_extruders == NULL)
+  // wait_for_moves_to_finish
+  PyObject* py_wait_for_moves_to_finish = PyDict_GetItemString(py_args, "wait_for_moves_to_finish");
+  if (py_wait_for_moves_to_finish == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve extruders list from the slicer settings dict.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      "GcodePositionProcessor.ParseSnapshotGcodeArgs - Unable to retrieve wait_for_moves_to_finish from the snapshot gcode args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
-  if (!PyList_Check(py_extruders))
+  args->wait_for_moves_to_finish = PyLong_AsLong(py_wait_for_moves_to_finish) > 0;
+
+  // disable_z_lift
+  PyObject* py_disable_z_lift = PyDict_GetItemString(py_args, "disable_z_lift");
+  if (py_disable_z_lift == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - The extruders object in the slicer settings dict is not a list.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      "GcodePositionProcessor.ParseSnapshotGcodeArgs - Unable to retrieve disable_z_lift from the snapshot gcode args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
-  const int extruder_list_size = PyList_Size(py_extruders);
-  //std::cout << "Found " << extruder_list_size << " extruders.\r\n";
-  // make sure there is at lest one item in the list
-  if (extruder_list_size < 1)
+  args->disable_z_lift = PyLong_AsLong(py_disable_z_lift) > 0;
+
+  // snapshot_command
+  PyObject* py_snapshot_command = PyDict_GetItemString(py_args, "snapshot_command");
+  if (py_snapshot_command == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to build a list of extruders from the slicer settings dict arguments.  There are no extruders in the list.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      "GcodePositionProcessor.ParseSnapshotGcodeArgs - Unable to retrieve snapshot_command from the snapshot gcode args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
-  if (extruder_list_size < args->num_extruders)
+  args->snapshot_command = PyUnicode_SafeAsString(py_snapshot_command);
+
+  // extruders
+  PyObject* py_extruders = PyDict_GetItemString(py_args, "extruders");
+  if (py_extruders == NULL || !PyList_Check(py_extruders))
   {
     std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Too few extruders were detected.  There must be at least as many extruders in the list the num_extruders variable.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      "GcodePositionProcessor.ParseSnapshotGcodeArgs - Unable to retrieve the extruders list from the snapshot gcode args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
+  const int extruder_list_size = PyList_Size(py_extruders);
+  args->extruders.clear();
   for (int index = 0; index < extruder_list_size; index++)
   {
-    //std::cout << "Extracting the current extruder #" << index << ".\r\n";
     PyObject* py_extruder = PyList_GetItem(py_extruders, index);
     if (py_extruder == NULL)
     {
       std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - Could not extract an extruder from index from the extruders list.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+        "GcodePositionProcessor.ParseSnapshotGcodeArgs - Could not extract an extruder from index from the extruders list.";
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
       return false;
     }
-    // Extract the z_lift_height from the current extruder
-    PyObject* py_z_lift_height = PyDict_GetItemString(py_extruder, "z_lift_height");
-    if (py_z_lift_height == NULL)
+    snapshot_gcode_extruder_args extruder_args;
+    bool is_null;
+
+    PyObject* py_retract_before_move = PyDict_GetItemString(py_extruder, "retract_before_move");
+    PyObject* py_lift_when_retracted = PyDict_GetItemString(py_extruder, "lift_when_retracted");
+    if (py_retract_before_move == NULL || py_lift_when_retracted == NULL)
     {
       std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve z_lift_height list from the current extruder.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+        "GcodePositionProcessor.ParseSnapshotGcodeArgs - Unable to retrieve retract_before_move or lift_when_retracted from the current extruder.";
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
       return false;
     }
+    extruder_args.retract_before_move = PyObject_IsTrue(py_retract_before_move) > 0;
+    extruder_args.lift_when_retracted = PyObject_IsTrue(py_lift_when_retracted) > 0;
 
-    if (!(PyFloatLongOrInt_Check(py_z_lift_height) || py_z_lift_height == Py_None))
-    {
-      std::string message = "GcodePositionProcessor.ParsePositionArgs - The z_lift_height object must a float or int.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    // None lengths are treated as zero, just like the position args
+    if (!ParseSnapshotGcodeDouble(py_extruder, "retraction_length", &extruder_args.retraction_length, &is_null))
       return false;
-    }
-
-    if (py_z_lift_height == Py_None)
-    {
-      args->z_lift_heights[index] = 0;
-    }
-    else
-    {
-      double height = PyFloatOrInt_AsDouble(py_z_lift_height);
-      args->z_lift_heights[index] = height;
-    }
-
-    // Extract the retraction_length from the current extruder
-    PyObject* py_retraction_length = PyDict_GetItemString(py_extruder, "retraction_length");
-    if (py_retraction_length == NULL)
-    {
-      std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve retraction_length list from the current extruder.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    if (!ParseSnapshotGcodeDouble(py_extruder, "z_lift_height", &extruder_args.z_lift_height, &is_null))
       return false;
-    }
-    if (!(PyFloatLongOrInt_Check(py_retraction_length) || py_retraction_length == Py_None))
-    {
-      std::string message = "GcodePositionProcessor.ParsePositionArgs - The z_lift_height object must a float or int.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    if (!ParseSnapshotGcodeDouble(py_extruder, "retraction_speed", &extruder_args.retraction_speed,
+                                  &extruder_args.retraction_speed_null))
       return false;
-    }
-    if (py_z_lift_height == Py_None)
-    {
-      args->retraction_lengths[index] = 0;
-    }
-    else
-    {
-      double length = PyFloatOrInt_AsDouble(py_retraction_length);
-      args->retraction_lengths[index] = length;
-    }
+    if (!ParseSnapshotGcodeDouble(py_extruder, "deretraction_speed", &extruder_args.deretraction_speed,
+                                  &extruder_args.deretraction_speed_null))
+      return false;
+    if (!ParseSnapshotGcodeDouble(py_extruder, "x_y_travel_speed", &extruder_args.x_y_travel_speed,
+                                  &extruder_args.x_y_travel_speed_null))
+      return false;
+    if (!ParseSnapshotGcodeDouble(py_extruder, "z_lift_speed", &extruder_args.z_lift_speed,
+                                  &extruder_args.z_lift_speed_null))
+      return false;
+    args->extruders.push_back(extruder_args);
   }
+  args->enabled = !args->extruders.empty();
+  return true;
+}
 
-#pragma endregion Parse extruder objects
+static bool ParseStabilizedGcodeArgs(PyObject* py_args, stabilized_gcode_args* args)
+{
+  octolapse_log(
+    octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG,
+    "Parsing Stabilized Gcode Args."
+  );
+  // target_file_path
+  PyObject* py_target_file_path = PyDict_GetItemString(py_args, "target_file_path");
+  if (py_target_file_path == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizedGcodeArgs - Unable to retrieve target_file_path from the stabilized gcode args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  args->target_file_path = PyUnicode_SafeAsString(py_target_file_path);
 
-#pragma region Extract firmware extruder offsets from the printer settings
-  // Only extract extruder offsets if there is more than one extruder.
-  if (args->num_extruders > 1)
+  // snapshot_command - optional
+  PyObject* py_snapshot_command = PyDict_GetItemString(py_args, "snapshot_command");
+  if (py_snapshot_command != NULL && py_snapshot_command != Py_None)
   {
-    PyObject* py_extruder_offsets = PyDict_GetItemString(py_args, "extruder_offsets");
-    if (py_extruder_offsets == NULL)
-    {
-      std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve extruder_offsets from the position dict.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
-    }
-    if (!PyList_Check(py_extruder_offsets))
-    {
-      std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - The extruder_offsets object in the position dict is not a list.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
-    }
+    args->snapshot_command = PyUnicode_SafeAsString(py_snapshot_command);
+  }
 
-    int extruder_offsets_list_size = PyList_Size(py_extruder_offsets);
-    //std::cout << "Found " << extruder_list_size << " extruders.\r\n";
-    // make sure there is at lest one item in the list
-    if (extruder_offsets_list_size < args->num_extruders && !args->shared_extruder)
-    {
-      std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - Too few extruder offsets were detected.  There must be at least as many extruder offsets in the list as the num_extruders variable when not using a shared extruder.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
-    }
-    if (extruder_offsets_list_size > args->num_extruders && !args->shared_extruder)
-    {
-      std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - Too many extruder offsets were detected.  There can only be as many extruder offsets in the list as the num_extruders variable when not using a shared extruder.";
-      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-      return false;
-    }
-    if (extruder_offsets_list_size > 0 && args->shared_extruder)
-    {
-      std::string message =
-        "GcodePositionProcessor.ParsePositionArgs - Firmware extruder offset values are not allowed when using shared extruders.  Setting offsets to 0.";
-      octolapse_log(octolapse_log::WARNING, octolapse_log::GCODE_POSITION, message);
-      extruder_offsets_list_size = 0;
-    }
+  // wait_for_moves - optional
+  PyObject* py_wait_for_moves = PyDict_GetItemString(py_args, "wait_for_moves");
+  if (py_wait_for_moves != NULL)
+  {
+    args->wait_for_moves = PyObject_IsTrue(py_wait_for_moves) > 0;
+  }
 
-    for (int index = 0; index < extruder_offsets_list_size; index++)
-    {
-      std::cout << "Extracting the current extruder offset#" << index << ".\r\n";
-      PyObject* py_extruder_offset = PyList_GetItem(py_extruder_offsets, index);
-      if (py_extruder_offset == NULL)
-      {
-        std::string message =
-          "GcodePositionProcessor.ParsePositionArgs - Could not extract an extruder offset by index from the extruder_offsets list.";
-        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-        return false;
-      }
-      // Extract the x_firmware_offset from the current extruder (called x)
-      PyObject* py_extruder_offset_x = PyDict_GetItemString(py_extruder_offset, "x");
-      if (py_extruder_offset_x == NULL)
-      {
-        std::string message =
-          "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve an x offset from a list item in the the extruder_offsets list.";
-        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-        return false;
-      }
-      std::cout << "Checking x offset value.\r\n";
-      if (!(PyFloatLongOrInt_Check(py_extruder_offset_x) || py_extruder_offset_x == Py_None))
-      {
-        std::string message =
-          "GcodePositionProcessor.ParsePositionArgs - The extruder_offset.x object must a float or int.";
-        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-        return false;
-      }
-      std::cout << "Assigning x offset value.\r\n";
-      if (py_extruder_offset_x == Py_None)
-      {
-        args->x_firmware_offsets[index] = 0;
-      }
-      else
-      {
-        double x = PyFloatOrInt_AsDouble(py_extruder_offset_x);
-        args->x_firmware_offsets[index] = x;
-      }
-      // Extract the x_firmware_offset from the current extruder (called x)
-      PyObject* py_extruder_offset_y = PyDict_GetItemString(py_extruder_offset, "y");
-      if (py_extruder_offset_y == NULL)
-      {
-        std::string message =
-          "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve an y offset from a list item in the the extruder_offsets list.";
-        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-        return false;
-      }
-      std::cout << "Checking y offset value.\r\n";
-      if (!(PyFloatLongOrInt_Check(py_extruder_offset_y) || py_extruder_offset_y == Py_None))
-      {
-        std::string message =
-          "GcodePositionProcessor.ParsePositionArgs - The extruder_offset.y object must a float or int.";
-        octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-        return false;
-      }
-      std::cout << "Assigning y offset value.\r\n";
-      if (py_extruder_offset_y == Py_None)
-      {
-        args->y_firmware_offsets[index] = 0;
-      }
-      else
-      {
-        double y = PyFloatOrInt_AsDouble(py_extruder_offset_y);
-        args->y_firmware_offsets[index] = y;
-      }
-    }
+  // verify - optional
+  PyObject* py_verify = PyDict_GetItemString(py_args, "verify");
+  if (py_verify != NULL)
+  {
+    args->verify = PyObject_IsTrue(py_verify) > 0;
   }
+  return true;
+}
 
-#pragma endregion Extract firmware extruder offsets from the printer settings
-  // priming_height
-  PyObject* py_priming_height = PyDict_GetItemString(py_args, "priming_height");
-  if (py_priming_height == NULL)
+static bool ParseGcodeQueueFilterArgs(PyObject* py_args, gcode_queue_filter_args* args)
+{
+  octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::INFO,
+                "Parsing gcode queue filter args.");
+
+  // snapshot_command
+  PyObject* py_snapshot_command = PyDict_GetItemString(py_args, "snapshot_command");
+  if (py_snapshot_command == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseGcodeQueueFilterArgs - Unable to retrieve the snapshot_command parameter from the gcode queue filter dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  if (py_snapshot_command != Py_None)
+  {
+    args->snapshot_command = PyUnicode_SafeAsString(py_snapshot_command);
+  }
+
+  // state_message_interval_seconds
+  PyObject* py_state_message_interval_seconds = PyDict_GetItemString(py_args, "state_message_interval_seconds");
+  if (py_state_message_interval_seconds == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseGcodeQueueFilterArgs - Unable to retrieve the state_message_interval_seconds parameter from the gcode queue filter dict.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return false;
+  }
+  args->state_message_interval_seconds = PyFloatOrInt_AsDouble(py_state_message_interval_seconds);
+
+  // update_position
+  PyObject* py_update_position = PyDict_GetItemString(py_args, "update_position");
+  if (py_update_position == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve priming_height from the position dict.";
+      "GcodePositionProcessor.ParseGcodeQueueFilterArgs - Unable to retrieve the update_position parameter from the gcode queue filter dict.";
     octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
     return false;
   }
-  args->priming_height = PyFloatOrInt_AsDouble(py_priming_height);
+  args->update_position = PyLong_AsLong(py_update_position) > 0;
 
-  // minimum_layer_height
-  PyObject* py_minimum_layer_height = PyDict_GetItemString(py_args, "minimum_layer_height");
-  if (py_minimum_layer_height == NULL)
+  // location_detection_commands
+  PyObject* py_location_detection_commands = PyDict_GetItemString(py_args, "location_detection_commands");
+  if (py_location_detection_commands == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve minimum_layer_height from the position dict.";
+      "GcodePositionProcessor.ParseGcodeQueueFilterArgs - Unable to retrieve the location_detection_commands parameter from the gcode queue filter dict.";
     octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
     return false;
   }
-  args->minimum_layer_height = PyFloatOrInt_AsDouble(py_minimum_layer_height);
-
-  // g90_influences_extruder
-  PyObject* py_g90_influences_extruder = PyDict_GetItemString(py_args, "g90_influences_extruder");
-  if (py_g90_influences_extruder == NULL)
+  const int list_size = PyList_Size(py_location_detection_commands);
+  if (list_size < 0)
   {
     std::string message =
-      "GcodePositionProcessor.ParsePositionArgs - Unable to retrieve g90_influences_extruder from the position dict.";
+      "GcodePositionProcessor.ParseGcodeQueueFilterArgs - The location_detection_commands parameter must be a list.";
     octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
     return false;
   }
-  args->g90_influences_extruder = PyLong_AsLong(py_g90_influences_extruder) > 0;
+  for (int index = 0; index < list_size; index++)
+  {
+    PyObject* py_command = PyList_GetItem(py_location_detection_commands, index);
+    if (py_command == NULL || !PyUnicode_SafeCheck(py_command))
+    {
+      std::string message =
+        "GcodePositionProcessor.ParseGcodeQueueFilterArgs - The location_detection_commands parameter must be a list of strings.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return false;
+    }
+    args->location_detection_commands.push_back(PyUnicode_SafeAsString(py_command));
+  }
+  return true;
+}
 
+static bool ParseSnapshotTriggerDouble(PyObject* py_args, const char* name, double* value)
+{
+  PyObject* py_value = PyDict_GetItemString(py_args, name);
+  if (py_value == NULL)
+  {
+    std::string message = "GcodePositionProcessor.ParseSnapshotTriggerArgs - Unable to retrieve the ";
+    message.append(name).append(" parameter from the snapshot trigger dict.");
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  *value = PyFloatOrInt_AsDouble(py_value);
   return true;
 }
 
-static bool ParseStabilizationArgs(PyObject* py_args, stabilization_args* args, PyObject** py_progress_callback,
-                                   PyObject** py_snapshot_position_callback)
+static bool ParseExtruderTriggerOption(PyObject* py_extruder_triggers, const char* name,
+                                       extruder_trigger_option* option)
 {
-  octolapse_log(
-    octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG,
-    "Parsing Stabilization Args."
-  );
-  //std::cout << "Parsing Stabilization Args.\r\n";
-  // gcode_generator
-  PyObject* py_gcode_generator = PyDict_GetItemString(py_args, "gcode_generator");
-  if (py_gcode_generator == NULL)
+  // None ignores the state, True requires it and False forbids it, like ExtruderTriggers
+  PyObject* py_option = PyDict_GetItemString(py_extruder_triggers, name);
+  if (py_option == NULL)
   {
-    std::string message =
-      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve gcode_generator from the smart layer stabilization args.";
+    std::string message = "GcodePositionProcessor.ParseSnapshotTriggerArgs - Unable to retrieve the ";
+    message.append(name).append(" extruder trigger option.");
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
-  // Need to incref py_gcode_generator, borrowed ref and we're holding it!
-  // This should no longer be true...
-  //Py_INCREF(py_gcode_generator);
-  // extract the get_snapshot_position callback
-  PyObject* py_get_snapshot_position_callback = PyObject_GetAttrString(py_gcode_generator, "get_snapshot_position");
-  if (py_get_snapshot_position_callback == NULL)
+  if (py_option == Py_None)
+    *option = extruder_trigger_option_ignore;
+  else if (PyObject_IsTrue(py_option))
+    *option = extruder_trigger_option_required;
+  else
+    *option = extruder_trigger_option_forbidden;
+  return true;
+}
+
+static bool ParseSnapshotTriggerArgs(PyObject* py_args, snapshot_trigger_args* args)
+{
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO,
+                "Parsing snapshot trigger args.");
+
+  // type
+  PyObject* py_type = PyDict_GetItemString(py_args, "type");
+  if (py_type == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve get_snapshot_position function from the gcode_generator object.";
+      "GcodePositionProcessor.ParseSnapshotTriggerArgs - Unable to retrieve the type parameter from the snapshot trigger dict.";
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
-  // make sure it is callable
-  if (!PyCallable_Check(py_get_snapshot_position_callback))
+  const long type = PyLong_AsLong(py_type);
+  if (type < snapshot_trigger_type_gcode || type > snapshot_trigger_type_timer)
   {
-    std::string message =
-      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve get_snapshot_position function from the gcode_generator object.";
-    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, message);
-    return NULL;
+    std::string message = "GcodePositionProcessor.ParseSnapshotTriggerArgs - Unknown snapshot trigger type.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
   }
-  // py_get_snapshot_position_callback is a new reference, no reason to incref
-  *py_snapshot_position_callback = py_get_snapshot_position_callback;
-  // on_progress_received
-  PyObject* py_on_progress_received = PyDict_GetItemString(py_args, "on_progress_received");
-  if (py_on_progress_received == NULL)
+  args->type = static_cast<snapshot_trigger_type>(type);
+
+  // require_zhop
+  PyObject* py_require_zhop = PyDict_GetItemString(py_args, "require_zhop");
+  if (py_require_zhop == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve on_progress_received from the stabilization args.";
+      "GcodePositionProcessor.ParseSnapshotTriggerArgs - Unable to retrieve the require_zhop parameter from the snapshot trigger dict.";
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
-  // need to incref this so it doesn't vanish later (borrowed reference we are saving)
-  Py_IncRef(py_on_progress_received);
-  *py_progress_callback = py_on_progress_received;
+  args->require_zhop = PyLong_AsLong(py_require_zhop) > 0;
 
+  if (!ParseSnapshotTriggerDouble(py_args, "height_increment", &args->height_increment))
+    return false;
+  if (!ParseSnapshotTriggerDouble(py_args, "interval_seconds", &args->interval_seconds))
+    return false;
 
-  // height_increment
-  PyObject* py_height_increment = PyDict_GetItemString(py_args, "height_increment");
-  if (py_height_increment == NULL)
+  // snapshot_command
+  PyObject* py_snapshot_command = PyDict_GetItemString(py_args, "snapshot_command");
+  if (py_snapshot_command == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve height_increment from the stabilization args.";
+      "GcodePositionProcessor.ParseSnapshotTriggerArgs - Unable to retrieve the snapshot_command parameter from the snapshot trigger dict.";
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
-  args->height_increment = PyFloatOrInt_AsDouble(py_height_increment);
+  if (py_snapshot_command != Py_None)
+    args->snapshot_command = PyUnicode_SafeAsString(py_snapshot_command);
 
-  // x_axis_stabilization_disabled
-  PyObject* py_x_stabilization_disabled = PyDict_GetItemString(py_args, "x_stabilization_disabled");
-  if (py_x_stabilization_disabled == NULL)
+  // extruder_triggers, None if the extruder state requirements are disabled
+  PyObject* py_extruder_triggers = PyDict_GetItemString(py_args, "extruder_triggers");
+  if (py_extruder_triggers == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve x_stabilization_disabled from the stabilization args.";
+      "GcodePositionProcessor.ParseSnapshotTriggerArgs - Unable to retrieve the extruder_triggers parameter from the snapshot trigger dict.";
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
   }
-  args->x_stabilization_disabled = PyLong_AsLong(py_x_stabilization_disabled) > 0;
+  if (py_extruder_triggers != Py_None)
+  {
+    extruder_trigger_options& options = args->extruder_triggers;
+    options.enabled = true;
+    if (
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_extruding_start", &options.on_extruding_start) ||
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_extruding", &options.on_extruding) ||
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_primed", &options.on_primed) ||
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_retracting_start", &options.on_retracting_start) ||
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_retracting", &options.on_retracting) ||
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_partially_retracted", &options.on_partially_retracted) ||
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_retracted", &options.on_retracted) ||
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_deretracting_start", &options.on_deretracting_start) ||
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_deretracting", &options.on_deretracting) ||
+      !ParseExtruderTriggerOption(py_extruder_triggers, "on_deretracted", &options.on_deretracted)
+    )
+    {
+      return false;
+    }
+  }
+  return true;
+}
 
-  // x_axis_stabilization_disabled
-  PyObject* py_y_stabilization_disabled = PyDict_GetItemString(py_args, "y_stabilization_disabled");
-  if (py_x_stabilization_disabled == NULL)
+static bool ParseStringList(PyObject* py_list, const char* name, std::vector<std::string>* values)
+{
+  const int num_values = PyList_Size(py_list);
+  if (num_values < 0)
+  {
+    std::string message = "GcodePositionProcessor.ParseStringList - ";
+    message.append(name).append(" must be a list of strings.");
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return false;
+  }
+  for (int index = 0; index < num_values; index++)
+  {
+    const char* value = PyUnicode_SafeAsString(PyList_GetItem(py_list, index));
+    if (value == NULL)
+    {
+      std::string message = "GcodePositionProcessor.ParseStringList - ";
+      message.append(name).append(" must be a list of strings.");
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return false;
+    }
+    values->push_back(value);
+  }
+  return true;
+}
+
+static bool ParseSlicerSettingsFormat(PyObject* py_format, slicer_settings_format* format)
+{
+  const char* string_names[] = {"name", "setting_prefix", "setting_separator", "key_excluded_characters"};
+  std::string* string_values[] = {
+    &format->name, &format->setting_prefix, &format->setting_separator, &format->key_excluded_characters
+  };
+  for (int index = 0; index < 4; index++)
+  {
+    PyObject* py_value = PyDict_GetItemString(py_format, string_names[index]);
+    const char* value = py_value == NULL ? NULL : PyUnicode_SafeAsString(py_value);
+    if (value == NULL)
+    {
+      std::string message = "GcodePositionProcessor.ParseSlicerSettingsFormat - Unable to retrieve ";
+      message.append(string_names[index]).append(" from the settings format.");
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return false;
+    }
+    *string_values[index] = value;
+  }
+
+  PyObject* py_keys = PyDict_GetItemString(py_format, "keys");
+  if (py_keys == NULL || !ParseStringList(py_keys, "keys", &format->keys))
+  {
+    std::string message = "GcodePositionProcessor.ParseSlicerSettingsFormat - Unable to retrieve keys from the settings format.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return false;
+  }
+  PyObject* py_line_prefixes = PyDict_GetItemString(py_format, "line_prefixes");
+  if (py_line_prefixes == NULL || !ParseStringList(py_line_prefixes, "line_prefixes", &format->line_prefixes))
   {
     std::string message =
-      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve y_stabilization_disabled from the stabilization args.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      "GcodePositionProcessor.ParseSlicerSettingsFormat - Unable to retrieve line_prefixes from the settings format.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
     return false;
   }
-  args->y_stabilization_disabled = PyLong_AsLong(py_y_stabilization_disabled) > 0;
 
-  // notification_period_seconds
-  PyObject* py_notification_period_seconds = PyDict_GetItemString(py_args, "notification_period_seconds");
-  if (py_notification_period_seconds == NULL)
+  PyObject* py_max_forward_lines = PyDict_GetItemString(py_format, "max_forward_lines");
+  PyObject* py_max_reverse_lines = PyDict_GetItemString(py_format, "max_reverse_lines");
+  if (py_max_forward_lines == NULL || py_max_reverse_lines == NULL)
   {
     std::string message =
-      "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve notification_period_seconds from the stabilization args.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      "GcodePositionProcessor.ParseSlicerSettingsFormat - Unable to retrieve the search line limits from the settings format.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
     return false;
   }
-  args->notification_period_seconds = PyFloatOrInt_AsDouble(py_notification_period_seconds);
+  format->max_forward_lines = PyIntOrLong_AsLong(py_max_forward_lines);
+  format->max_reverse_lines = PyIntOrLong_AsLong(py_max_reverse_lines);
+  return true;
+}
 
+static bool ParseStabilizationBatchJob(PyObject* py_job, stabilization_batch_job* job, std::vector<PyObject*>* callbacks)
+{
+  if (py_job == NULL || !PyDict_Check(py_job))
+  {
+    std::string message = "GcodePositionProcessor.ParseStabilizationBatchJob - Each batch job must be a dict.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  PyObject* py_stabilization_type = PyDict_GetItemString(py_job, "stabilization_type");
+  PyObject* py_position_args = PyDict_GetItemString(py_job, "position_args");
+  PyObject* py_stabilization_args = PyDict_GetItemString(py_job, "stabilization_args");
+  PyObject* py_stabilization_type_args = PyDict_GetItemString(py_job, "stabilization_type_args");
+  if (py_stabilization_type == NULL || py_position_args == NULL || py_stabilization_args == NULL ||
+    py_stabilization_type_args == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationBatchJob - A batch job requires a stabilization_type, position_args, stabilization_args and stabilization_type_args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
 
-  // file_path
-  PyObject* py_dict_key = PyString_SafeFromString("file_path");
-  PyObject* py_dict_item = PyDict_GetItem(py_args, py_dict_key);
-  if (py_dict_item == NULL)
+  const std::string stabilization_type = PyUnicode_SafeAsString(py_stabilization_type);
+  if (stabilization_type == SMART_LAYER_STABILIZATION)
   {
-      std::string message =
-          "GcodePositionProcessor.ParseStabilizationArgs - Unable to retrieve the file_path from the stabilization args dict.";
-      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    job->type = stabilization_batch_job_type_smart_layer;
+    if (!ParseStabilizationArgs_SmartLayer(py_stabilization_type_args, &job->layer_args))
       return false;
   }
-  Py_DecRef(py_dict_key);
-  /*
-  Py_UNICODE* py_dict_item_unicode = PyUnicode_AsUnicode(py_dict_item);
-  //PyObject* py_file_path = PyDict_GetItemString(py_args, "file_path");
-  if (py_dict_item_unicode == NULL)
+  else if (stabilization_type == SMART_GCODE_STABILIZATION)
   {
-    std::string message =
-      "GcodePositionProcessor.ParseStabilizationArgs - Unable to convert the file_path dict item to a Py_UNICODE .";
+    job->type = stabilization_batch_job_type_smart_gcode;
+    if (!ParseStabilizationArgs_SmartGcode(py_stabilization_type_args, &job->gcode_args))
+      return false;
+  }
+  else
+  {
+    std::string message = "GcodePositionProcessor.ParseStabilizationBatchJob - Unknown stabilization_type: ";
+    message += stabilization_type;
     octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
     return false;
-  }*/
-  
-  args->file_path = PyUnicode_SafeAsString(py_dict_item);
-  
-  //std::cout << "Stabilization Args parsed successfully.\r\n";
+  }
+
+  if (!ParsePositionArgs(py_position_args, &job->position_args))
+    return false;
+  PyObject* py_progress_received_callback = NULL;
+  PyObject* py_snapshot_position_callback = NULL;
+  if (!ParseStabilizationArgs(py_stabilization_args, &job->stab_args, &py_progress_received_callback,
+                              &py_snapshot_position_callback))
+    return false;
+  callbacks->push_back(py_progress_received_callback);
+  callbacks->push_back(py_snapshot_position_callback);
+  job->get_coordinates = ExecuteGetSnapshotPositionCallback;
+  job->get_coordinates_context = py_snapshot_position_callback;
+  job->progress = ExecuteStabilizationProgressCallback;
+  job->progress_context = py_progress_received_callback;
   return true;
 }
 
@@ -1532,6 +3153,16 @@ static bool ParseStabilizationArgs_SmartLayer(PyObject* py_args, smart_layer_arg
   }
   args->snap_to_print_smooth = PyLong_AsLong(py_snap_to_print_smooth) > 0;
 
+  PyObject* py_arc_chord_tolerance = PyDict_GetItemString(py_args, "arc_chord_tolerance");
+  if (py_arc_chord_tolerance == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseStabilizationArgs_SmartLayer - Unable to retrieve arc_chord_tolerance from the smart layer trigger stabilization args.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return false;
+  }
+  args->arc_chord_tolerance = PyFloatOrInt_AsDouble(py_arc_chord_tolerance);
+
   return true;
 }
 
@@ -1574,3 +3205,203 @@ static bool ParseStabilizationArgs_SmartGcode(PyObject* py_args, smart_gcode_arg
 
   return true;
 }
+
+static bool ParseFramePreparerArgs(PyObject* py_args, frame_preparer_args* args)
+{
+  const char* int_names[] = {"width", "height", "num_threads"};
+  int* int_values[] = {&args->width, &args->height, &args->num_threads};
+  for (int index = 0; index < 3; index++)
+  {
+    PyObject* py_value = PyDict_GetItemString(py_args, int_names[index]);
+    if (py_value == NULL)
+    {
+      std::string message = "GcodePositionProcessor.ParseFramePreparerArgs - Unable to retrieve ";
+      message.append(int_names[index]).append(" from the frame preparer args.");
+      octolapse_log_exception(octolapse_log::RENDER, message);
+      return false;
+    }
+    *int_values[index] = static_cast<int>(PyIntOrLong_AsLong(py_value));
+  }
+
+  // output_handle
+  PyObject* py_output_handle = PyDict_GetItemString(py_args, "output_handle");
+  if (py_output_handle == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ParseFramePreparerArgs - Unable to retrieve output_handle from the frame preparer args.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return false;
+  }
+  args->output_handle = PyLong_AsLongLong(py_output_handle);
+
+  // glyphs, a list of (width, height, (red, green, blue), alpha bytes)
+  PyObject* py_glyphs = PyDict_GetItemString(py_args, "glyphs");
+  const int num_glyphs = py_glyphs == NULL ? -1 : PyList_Size(py_glyphs);
+  if (num_glyphs < 0)
+  {
+    std::string message = "GcodePositionProcessor.ParseFramePreparerArgs - The glyphs must be a list.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return false;
+  }
+  args->glyphs.resize(num_glyphs);
+  for (int index = 0; index < num_glyphs; index++)
+  {
+    frame_glyph& glyph = args->glyphs[index];
+    int red, green, blue;
+    PyObject* py_alpha;
+    char* alpha;
+    Py_ssize_t alpha_size;
+    if (
+      !PyArg_ParseTuple(PyList_GetItem(py_glyphs, index), "ii(iii)O", &glyph.width, &glyph.height, &red, &green, &blue,
+                        &py_alpha) ||
+      PyBytes_AsStringAndSize(py_alpha, &alpha, &alpha_size) != 0 ||
+      glyph.width < 0 || glyph.height < 0 || alpha_size != static_cast<Py_ssize_t>(glyph.width) * glyph.height
+    )
+    {
+      std::string message = "GcodePositionProcessor.ParseFramePreparerArgs - A glyph is invalid.";
+      octolapse_log_exception(octolapse_log::RENDER, message);
+      return false;
+    }
+    glyph.red = static_cast<unsigned char>(red);
+    glyph.green = static_cast<unsigned char>(green);
+    glyph.blue = static_cast<unsigned char>(blue);
+    glyph.alpha.assign(alpha, alpha + alpha_size);
+  }
+  return true;
+}
+
+static bool ParseFrameSources(PyObject* py_frames, std::vector<frame_source>* frames)
+{
+  // A list of (file_path, repeat_count, overlay[, (offset_x, offset_y)]), where the overlay is a list of
+  // (glyph_index, x, y)
+  const int num_frames = PyList_Size(py_frames);
+  if (num_frames < 0)
+  {
+    std::string message = "GcodePositionProcessor.ParseFrameSources - The frames must be a list.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return false;
+  }
+  frames->resize(num_frames);
+  for (int index = 0; index < num_frames; index++)
+  {
+    frame_source& frame = (*frames)[index];
+    const char* file_path;
+    PyObject* py_overlay;
+    if (!PyArg_ParseTuple(PyList_GetItem(py_frames, index), "siO|(dd)", &file_path, &frame.repeat_count, &py_overlay,
+                          &frame.offset_x, &frame.offset_y))
+    {
+      std::string message = "GcodePositionProcessor.ParseFrameSources - A frame is invalid.";
+      octolapse_log_exception(octolapse_log::RENDER, message);
+      return false;
+    }
+    frame.file_path = file_path;
+    if (py_overlay == Py_None)
+      continue;
+    const int num_placements = PyList_Size(py_overlay);
+    if (num_placements < 0)
+    {
+      std::string message = "GcodePositionProcessor.ParseFrameSources - A frame's overlay must be a list.";
+      octolapse_log_exception(octolapse_log::RENDER, message);
+      return false;
+    }
+    frame.overlay.resize(num_placements);
+    for (int placement_index = 0; placement_index < num_placements; placement_index++)
+    {
+      frame_glyph_placement& placement = frame.overlay[placement_index];
+      if (!PyArg_ParseTuple(PyList_GetItem(py_overlay, placement_index), "iii", &placement.glyph_index, &placement.x,
+                            &placement.y))
+      {
+        std::string message = "GcodePositionProcessor.ParseFrameSources - A glyph placement is invalid.";
+        octolapse_log_exception(octolapse_log::RENDER, message);
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+static bool ParseFrameRegistrationArgs(PyObject* py_args, frame_registration_args* args)
+{
+  const char* int_names[] = {"width", "height", "num_threads", "analysis_width", "smoothing_frames"};
+  int* int_values[] = {
+    &args->width, &args->height, &args->num_threads, &args->analysis_width, &args->smoothing_frames
+  };
+  for (int index = 0; index < 5; index++)
+  {
+    PyObject* py_value = PyDict_GetItemString(py_args, int_names[index]);
+    if (py_value == NULL)
+    {
+      // Everything but the size has a default
+      if (index < 2)
+      {
+        std::string message = "GcodePositionProcessor.ParseFrameRegistrationArgs - Unable to retrieve ";
+        message.append(int_names[index]).append(" from the frame registration args.");
+        octolapse_log_exception(octolapse_log::RENDER, message);
+        return false;
+      }
+      continue;
+    }
+    *int_values[index] = static_cast<int>(PyIntOrLong_AsLong(py_value));
+  }
+  const char* double_names[] = {"max_offset_ratio", "min_confidence"};
+  double* double_values[] = {&args->max_offset_ratio, &args->min_confidence};
+  for (int index = 0; index < 2; index++)
+  {
+    PyObject* py_value = PyDict_GetItemString(py_args, double_names[index]);
+    if (py_value != NULL)
+      *double_values[index] = PyFloatOrInt_AsDouble(py_value);
+  }
+  return true;
+}
+
+static bool ExecuteFrameProgressCallback(void* progress_callback, const int frames_written, const int total_frames)
+{
+  // Send anything logged by the decoding threads so far
+  octolapse_flush_log();
+  PyGILState_STATE gstate = PyGILState_Ensure();
+  PyObject* py_continue_processing = PyObject_CallFunction(static_cast<PyObject*>(progress_callback), (char*)"ii",
+                                                           frames_written, total_frames);
+  bool continue_processing = false;
+  if (py_continue_processing != NULL)
+  {
+    continue_processing = PyObject_IsTrue(py_continue_processing) > 0;
+    Py_DECREF(py_continue_processing);
+  }
+  PyGILState_Release(gstate);
+  if (py_continue_processing == NULL)
+  {
+    std::string message = "GcodePositionProcessor.ExecuteFrameProgressCallback - Failed to call python progress callback.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+  }
+  return continue_processing;
+}
+
+static bool ExecuteStabilizationBatchCompletionCallback(void* completion_callback, const int job_index,
+                                                        const stabilization_results& results)
+{
+  // Send anything logged by the batch so far
+  octolapse_flush_log();
+  PyGILState_STATE gstate = PyGILState_Ensure();
+  bool continue_processing = false;
+  PyObject* py_results = to_py_object(results);
+  PyObject* py_continue_processing = NULL;
+  if (py_results != NULL)
+  {
+    py_continue_processing = PyObject_CallFunction(static_cast<PyObject*>(completion_callback), (char*)"iO",
+                                                   job_index, py_results);
+    Py_DECREF(py_results);
+  }
+  if (py_continue_processing != NULL)
+  {
+    continue_processing = PyObject_IsTrue(py_continue_processing) > 0;
+    Py_DECREF(py_continue_processing);
+  }
+  PyGILState_Release(gstate);
+  if (py_continue_processing == NULL)
+  {
+    std::string message =
+      "GcodePositionProcessor.ExecuteStabilizationBatchCompletionCallback - Failed to call python completion callback.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+  }
+  return continue_processing;
+}
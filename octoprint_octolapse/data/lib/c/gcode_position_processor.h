@@ -35,11 +35,22 @@
 #include "stabilization.h"
 #include "stabilization_smart_layer.h"
 #include "stabilization_smart_gcode.h"
+#include "stabilization_batch.h"
+#include "snapshot_plan_cursor.h"
+#include "gcode_queue_filter.h"
+#include "firmware_response.h"
+#include "snapshot_trigger.h"
+#include "slicer_settings_extractor.h"
+#include "frame_preparer.h"
+#include "frame_registration.h"
 
 namespace gpp
 {
   static std::map<std::string, gcode_position*> gcode_positions;
   static gcode_parser* parser;
+  static std::map<std::string, snapshot_plan_cursor*> snapshot_plan_cursors;
+  static std::map<std::string, gcode_queue_filter*> gcode_queue_filters;
+  static std::map<std::string, snapshot_trigger*> snapshot_triggers;
 }
 
 extern "C" {
@@ -59,16 +70,58 @@ static PyObject* GetPreviousPositionTuple(PyObject* self, PyObject* args);
 static PyObject* GetPreviousPositionDict(PyObject* self, PyObject* args);
 static PyObject* GetSnapshotPlans_SmartLayer(PyObject* self, PyObject* args);
 static PyObject* GetSnapshotPlans_SmartGcode(PyObject* self, PyObject* args);
+static PyObject* GetSnapshotPlansBatch(PyObject* self, PyObject* args);
+static PyObject* InitializeSnapshotPlanCursor(PyObject* self, PyObject* args);
+static PyObject* CheckSnapshotPlanCursor(PyObject* self, PyObject* args);
+static PyObject* SeekSnapshotPlanCursor(PyObject* self, PyObject* args);
+static PyObject* InitializeGcodeQueueFilter(PyObject* self, PyObject* args);
+static PyObject* FilterQueuedGcode(PyObject* self, PyObject* args);
+static PyObject* ParseFirmwareResponse(PyObject* self, PyObject* args);
+static PyObject* InitializeSnapshotTrigger(PyObject* self, PyObject* args);
+static PyObject* GetSnapshotTriggerState(PyObject* self, PyObject* args);
+static PyObject* PauseSnapshotTrigger(PyObject* self, PyObject* args);
+static PyObject* ResumeSnapshotTrigger(PyObject* self, PyObject* args);
+static PyObject* ExtractSlicerSettings(PyObject* self, PyObject* args);
+static PyObject* ReadGcodeFileLines(PyObject* self, PyObject* args);
+static PyObject* RefreshLogLevels(PyObject* self, PyObject* args);
+static PyObject* FlushLog(PyObject* self, PyObject* args);
+static PyObject* SetStatsEnabled(PyObject* self, PyObject* args);
+static PyObject* GetStats(PyObject* self, PyObject* args);
+static PyObject* ResetStats(PyObject* self, PyObject* args);
+static PyObject* WriteStatsTrace(PyObject* self, PyObject* args);
+static PyObject* GetJpegSize(PyObject* self, PyObject* args);
+static PyObject* PrepareFrames(PyObject* self, PyObject* args);
+static PyObject* TransformJpeg(PyObject* self, PyObject* args);
+static PyObject* DecodeJpegScaled(PyObject* self, PyObject* args);
+static PyObject* RegisterFrames(PyObject* self, PyObject* args);
 }
 
 static bool ParsePositionArgs(PyObject* py_args, gcode_position_args* args);
+static bool ParsePositionRestriction(PyObject* py_restriction, position_restriction* restriction);
+static bool ParsePositionRestrictionDouble(PyObject* py_restriction, const char* name, double* value);
 static bool ParseStabilizationArgs(PyObject* py_args, stabilization_args* args, PyObject** p_py_progress_callback,
                                    PyObject** p_py_snapshot_position_callback);
+static bool ParseSnapshotGcodeArgs(PyObject* py_args, snapshot_gcode_generator_args* args);
+static bool ParseStabilizedGcodeArgs(PyObject* py_args, stabilized_gcode_args* args);
+static bool ParseGcodeQueueFilterArgs(PyObject* py_args, gcode_queue_filter_args* args);
+static bool ParseSnapshotTriggerArgs(PyObject* py_args, snapshot_trigger_args* args);
+static void UpdateGcodeQueueFilter(const std::string& key);
+static PyObject* PyFloatOrNone(bool has_value, double value);
+static snapshot_trigger* GetSnapshotTrigger(PyObject* args, const char* function_name);
+static bool ParseSlicerSettingsFormat(PyObject* py_format, slicer_settings_format* format);
+static bool ParseStringList(PyObject* py_list, const char* name, std::vector<std::string>* values);
 static bool ParseStabilizationArgs_SmartLayer(PyObject* py_args, smart_layer_args* args);
 static bool ParseStabilizationArgs_SmartGcode(PyObject* py_args, smart_gcode_args* args);
-static bool ExecuteStabilizationProgressCallback(PyObject* progress_callback, const double percent_complete,
+static bool ParseFramePreparerArgs(PyObject* py_args, frame_preparer_args* args);
+static bool ParseFrameSources(PyObject* py_frames, std::vector<frame_source>* frames);
+static bool ParseFrameRegistrationArgs(PyObject* py_args, frame_registration_args* args);
+static bool ParseStabilizationBatchJob(PyObject* py_job, stabilization_batch_job* job, std::vector<PyObject*>* callbacks);
+static bool ExecuteFrameProgressCallback(void* progress_callback, int frames_written, int total_frames);
+static bool ExecuteStabilizationBatchCompletionCallback(void* completion_callback, int job_index,
+                                                        const stabilization_results& results);
+static bool ExecuteStabilizationProgressCallback(void* progress_callback, const double percent_complete,
                                                  const double seconds_elapsed, const double estimated_seconds_remaining,
-                                                 const int gcodes_processed, const int lines_processed);
-static bool ExecuteGetSnapshotPositionCallback(PyObject* py_get_snapshot_position_callback, double x_initial,
+                                                 long long gcodes_processed, long long lines_processed);
+static bool ExecuteGetSnapshotPositionCallback(void* py_get_snapshot_position_callback, double x_initial,
                                                double y_initial, double& x_result, double& y_result);
 #endif
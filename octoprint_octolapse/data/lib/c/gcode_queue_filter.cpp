@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "gcode_queue_filter.h"
+#include <cstring>
+
+gcode_queue_filter_args::gcode_queue_filter_args()
+{
+  snapshot_command = "";
+  state_message_interval_seconds = 1;
+  update_position = false;
+}
+
+gcode_queue_filter::gcode_queue_filter()
+{
+  p_cursor_ = NULL;
+  p_parser_ = NULL;
+  p_position_ = NULL;
+  p_trigger_ = NULL;
+  file_line_ = 0;
+  lines_filtered_ = 0;
+  lines_passed_through_ = 0;
+  state_message_interval_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(args_.state_message_interval_seconds)
+  );
+  next_state_message_time_ = std::chrono::steady_clock::now() + state_message_interval_;
+}
+
+gcode_queue_filter::gcode_queue_filter(const gcode_queue_filter_args& args) : args_(args)
+{
+  p_cursor_ = NULL;
+  p_parser_ = NULL;
+  p_position_ = NULL;
+  p_trigger_ = NULL;
+  file_line_ = 0;
+  lines_filtered_ = 0;
+  lines_passed_through_ = 0;
+  state_message_interval_ = std::chrono::duration_cast<std::chrono::steady_clock::duration>(
+    std::chrono::duration<double>(args_.state_message_interval_seconds)
+  );
+  next_state_message_time_ = std::chrono::steady_clock::now() + state_message_interval_;
+}
+
+void gcode_queue_filter::set_snapshot_plan_cursor(snapshot_plan_cursor* p_cursor)
+{
+  p_cursor_ = p_cursor;
+}
+
+void gcode_queue_filter::set_position(gcode_parser* p_parser, gcode_position* p_position)
+{
+  p_parser_ = p_parser;
+  p_position_ = p_position;
+}
+
+void gcode_queue_filter::set_snapshot_trigger(snapshot_trigger* p_trigger)
+{
+  p_trigger_ = p_trigger;
+}
+
+gcode_queue_filter_verdict gcode_queue_filter::filter(const char* gcode, const bool is_file_gcode,
+                                                      const long long file_line, const bool is_octolapse_gcode,
+                                                      const bool is_snapshot_gcode, const bool update_triggers)
+{
+  lines_filtered_++;
+  // Mirror Timelapse.check_current_line_number, which increments for every file line.
+  bool is_file_line_mismatch = false;
+  if (is_file_gcode)
+  {
+    file_line_++;
+    is_file_line_mismatch = file_line != file_line_;
+  }
+
+  // Every line must update the position, even if the handler is going to run.
+  gcode_queue_filter_verdict position_verdict = gcode_queue_filter_verdict_pass_through;
+  if (args_.update_position && p_position_ != NULL)
+    position_verdict = update_position(gcode, is_file_gcode ? file_line : -1, is_snapshot_gcode, update_triggers);
+
+  // Only lines read from the print file can pass through.  Scripts, plugin gcode and our own gcode are rare.
+  if (!is_file_gcode || is_octolapse_gcode)
+    return gcode_queue_filter_verdict_not_file_gcode;
+
+  if (is_file_line_mismatch)
+    return gcode_queue_filter_verdict_file_line_mismatch;
+
+  if (position_verdict != gcode_queue_filter_verdict_pass_through)
+    return position_verdict;
+
+  if (p_cursor_ != NULL && !p_cursor_->is_in_window(file_line))
+    return gcode_queue_filter_verdict_snapshot_plan;
+
+  // skip any leading whitespace
+  while (*gcode == ' ' || *gcode == '\t')
+    gcode++;
+
+  if (*gcode == '@')
+    return gcode_queue_filter_verdict_octolapse_command;
+
+  if (is_snapshot_command(gcode))
+    return gcode_queue_filter_verdict_snapshot_command;
+
+  if (is_fake_home_command(gcode))
+    return gcode_queue_filter_verdict_fake_home;
+
+  if (is_state_message_due())
+    return gcode_queue_filter_verdict_state_message;
+
+  lines_passed_through_++;
+  return gcode_queue_filter_verdict_pass_through;
+}
+
+gcode_queue_filter_verdict gcode_queue_filter::update_position(const char* gcode, const long long file_line,
+                                                               const bool is_snapshot_gcode, const bool update_triggers)
+{
+  // This mirrors Position.update and Timelapse.process_realtime_gcode
+  command_.clear();
+  p_parser_->try_parse_gcode(gcode, command_);
+  p_position_->update(command_, file_line, -1, -1);
+  const position* p_current_pos = p_position_->get_current_position_ptr();
+
+  // snapshot gcode only updates the position
+  if (is_snapshot_gcode)
+    return gcode_queue_filter_verdict_pass_through;
+
+  if (p_current_pos->is_metric_null || !p_current_pos->is_metric)
+    return gcode_queue_filter_verdict_not_metric;
+
+  if (!update_triggers || p_trigger_ == NULL)
+    return gcode_queue_filter_verdict_pass_through;
+
+  position* p_previous_pos = p_position_->get_previous_position_ptr();
+  if (requires_location_detection(p_previous_pos->command.command))
+    return gcode_queue_filter_verdict_location_detection;
+
+  if (p_trigger_->update(*p_current_pos, *p_previous_pos) || p_trigger_->get_state().is_triggered)
+    return gcode_queue_filter_verdict_trigger_state_changed;
+
+  return gcode_queue_filter_verdict_pass_through;
+}
+
+bool gcode_queue_filter::requires_location_detection(const std::string& command) const
+{
+  for (unsigned int index = 0; index < args_.location_detection_commands.size(); index++)
+  {
+    if (args_.location_detection_commands[index] == command)
+      return true;
+  }
+  return false;
+}
+
+bool gcode_queue_filter::is_snapshot_command(const char* gcode) const
+{
+  // PrinterProfile.is_snapshot_command compares the entire command string
+  if (*gcode == 'S' && std::strcmp(gcode, "SNAP") == 0)
+    return true;
+  return !args_.snapshot_command.empty() && *gcode == args_.snapshot_command[0] &&
+    std::strcmp(gcode, args_.snapshot_command.c_str()) == 0;
+}
+
+bool gcode_queue_filter::is_fake_home_command(const char* gcode)
+{
+  // Any G92 might contain the O (fake home) parameter, which must be removed before it is sent.
+  if (*gcode != 'G' && *gcode != 'g')
+    return false;
+  gcode++;
+  while (*gcode == '0')
+    gcode++;
+  return gcode[0] == '9' && gcode[1] == '2' && !(gcode[2] >= '0' && gcode[2] <= '9') && gcode[2] != '.';
+}
+
+bool gcode_queue_filter::is_state_message_due()
+{
+  if (state_message_interval_ == std::chrono::steady_clock::duration::zero())
+    return false;
+  const std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+  if (now < next_state_message_time_)
+    return false;
+  next_state_message_time_ = now + state_message_interval_;
+  return true;
+}
+
+long long gcode_queue_filter::get_file_line() const
+{
+  return file_line_;
+}
+
+long gcode_queue_filter::get_lines_filtered() const
+{
+  return lines_filtered_;
+}
+
+long gcode_queue_filter::get_lines_passed_through() const
+{
+  return lines_passed_through_;
+}
@@ -0,0 +1,109 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef GCODE_QUEUE_FILTER_H
+#define GCODE_QUEUE_FILTER_H
+#include <string>
+#include <vector>
+#include <chrono>
+#include "snapshot_plan_cursor.h"
+#include "snapshot_trigger.h"
+#include "gcode_position.h"
+#include "gcode_parser.h"
+
+/**
+ * \brief The result of filtering a single queued line.  Anything other than pass_through means that
+ * the full on_gcode_queuing handler must run.
+ */
+enum gcode_queue_filter_verdict
+{
+  gcode_queue_filter_verdict_pass_through = 0,
+  gcode_queue_filter_verdict_not_file_gcode = 1,
+  gcode_queue_filter_verdict_file_line_mismatch = 2,
+  gcode_queue_filter_verdict_snapshot_plan = 3,
+  gcode_queue_filter_verdict_octolapse_command = 4,
+  gcode_queue_filter_verdict_snapshot_command = 5,
+  gcode_queue_filter_verdict_fake_home = 6,
+  gcode_queue_filter_verdict_state_message = 7,
+  gcode_queue_filter_verdict_location_detection = 8,
+  gcode_queue_filter_verdict_not_metric = 9,
+  gcode_queue_filter_verdict_trigger_state_changed = 10
+};
+
+struct gcode_queue_filter_args
+{
+  gcode_queue_filter_args();
+  // The printer's snapshot command, if any.  '@' commands and the legacy SNAP command are always detected.
+  std::string snapshot_command;
+  // How often to wake up the full handler so that it can send state change messages.  Zero disables.
+  double state_message_interval_seconds;
+  // Real-time prints only.  Update the position and the snapshot trigger for every line.
+  bool update_position;
+  // Commands that require location detection.  Empty if position auto detection is disabled.
+  std::vector<std::string> location_detection_commands;
+};
+
+/**
+ * \brief Decides, without parsing, whether a line queued from the print file needs the full python handler.
+ *
+ * Most queued lines are plain moves that Octolapse does not change.  The filter keeps its own copy of the
+ * expected file line so that it can validate line numbers the same way Timelapse.check_current_line_number
+ * does, and consults the snapshot plan cursor (without moving it) so that the handler only runs when a plan
+ * could fire.
+ *
+ * For real-time prints the filter also updates the position and the snapshot trigger for every line, so the
+ * handler only runs when the trigger state changes.  In that case the handler must read the position instead of
+ * updating it.
+ */
+class gcode_queue_filter
+{
+public:
+  gcode_queue_filter();
+  explicit gcode_queue_filter(const gcode_queue_filter_args& args);
+  void set_snapshot_plan_cursor(snapshot_plan_cursor* p_cursor);
+  void set_position(gcode_parser* p_parser, gcode_position* p_position);
+  void set_snapshot_trigger(snapshot_trigger* p_trigger);
+  gcode_queue_filter_verdict filter(const char* gcode, bool is_file_gcode, long long file_line, bool is_octolapse_gcode,
+                                    bool is_snapshot_gcode, bool update_triggers);
+  long long get_file_line() const;
+  long get_lines_filtered() const;
+  long get_lines_passed_through() const;
+private:
+  gcode_queue_filter_verdict update_position(const char* gcode, long long file_line, bool is_snapshot_gcode,
+                                             bool update_triggers);
+  bool requires_location_detection(const std::string& command) const;
+  bool is_snapshot_command(const char* gcode) const;
+  static bool is_fake_home_command(const char* gcode);
+  bool is_state_message_due();
+  gcode_queue_filter_args args_;
+  snapshot_plan_cursor* p_cursor_;
+  gcode_parser* p_parser_;
+  gcode_position* p_position_;
+  snapshot_trigger* p_trigger_;
+  parsed_command command_;
+  long long file_line_;
+  long lines_filtered_;
+  long lines_passed_through_;
+  std::chrono::steady_clock::duration state_message_interval_;
+  std::chrono::steady_clock::time_point next_state_message_time_;
+};
+#endif
@@ -0,0 +1,686 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "gzip_decoder.h"
+#include "logging.h"
+#include "utilities.h"
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+namespace
+{
+  const unsigned short length_base[29] = {
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31, 35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258
+  };
+  const unsigned char length_extra_bits[29] = {
+    0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0
+  };
+  const unsigned short distance_base[30] = {
+    1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193, 257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+    8193, 12289, 16385, 24577
+  };
+  const unsigned char distance_extra_bits[30] = {
+    0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6, 7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13
+  };
+  // The order the code length code lengths are stored in a dynamic block header
+  const unsigned char code_length_order[19] = {16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15};
+
+  // Flags in the gzip member header
+  const unsigned int gzip_flag_header_crc = 2;
+  const unsigned int gzip_flag_extra = 4;
+  const unsigned int gzip_flag_name = 8;
+  const unsigned int gzip_flag_comment = 16;
+  const unsigned int gzip_flags_reserved = 0xE0;
+
+  struct fixed_tables
+  {
+    fixed_tables()
+    {
+      unsigned char lengths[288];
+      std::memset(lengths, 8, 144);
+      std::memset(lengths + 144, 9, 112);
+      std::memset(lengths + 256, 7, 24);
+      std::memset(lengths + 280, 8, 8);
+      literals.build(lengths, 288);
+      std::memset(lengths, 5, 30);
+      distances.build(lengths, 30);
+    }
+    gzip_huffman_table literals;
+    gzip_huffman_table distances;
+  };
+
+  const fixed_tables& get_fixed_tables()
+  {
+    static const fixed_tables tables;
+    return tables;
+  }
+}
+
+#pragma region gzip_huffman_table
+bool gzip_huffman_table::build(const unsigned char* lengths, const int num_symbols)
+{
+  std::memset(fast, 0, sizeof(fast));
+  std::memset(count, 0, sizeof(count));
+  for (int index = 0; index < num_symbols; index++)
+    count[lengths[index]]++;
+  count[0] = 0;
+  // Over subscribed codes are invalid.  Incomplete codes are allowed, and fail when a missing code is read.
+  int left = 1;
+  for (int length = 1; length < 16; length++)
+  {
+    left <<= 1;
+    left -= count[length];
+    if (left < 0)
+      return false;
+  }
+  short offsets[16];
+  offsets[1] = 0;
+  for (int length = 1; length < 15; length++)
+    offsets[length + 1] = static_cast<short>(offsets[length] + count[length]);
+  for (int index = 0; index < num_symbols; index++)
+  {
+    if (lengths[index] != 0)
+      symbol[offsets[lengths[index]]++] = static_cast<short>(index);
+  }
+  // Deflate stores codes starting with the most significant bit, but the bits are read least significant first, so
+  // the fast table is indexed by the reversed code.
+  int next_code[16];
+  int code = 0;
+  next_code[0] = 0;
+  for (int length = 1; length < 16; length++)
+  {
+    code = (code + count[length - 1]) << 1;
+    next_code[length] = code;
+  }
+  for (int index = 0; index < num_symbols; index++)
+  {
+    const int length = lengths[index];
+    if (length == 0)
+      continue;
+    code = next_code[length]++;
+    if (length > GZIP_DECODER_FAST_BITS)
+      continue;
+    int reversed = 0;
+    for (int bit = 0; bit < length; bit++)
+      reversed = (reversed << 1) | ((code >> bit) & 1);
+    for (int entry = reversed; entry < (1 << GZIP_DECODER_FAST_BITS); entry += 1 << length)
+      fast[entry] = static_cast<unsigned short>((index << 4) | length);
+  }
+  return true;
+}
+#pragma endregion gzip_huffman_table
+
+#pragma region gzip_decoder
+gzip_decoder::gzip_decoder()
+{
+  input_offset_ = 0;
+  input_data_ = NULL;
+  input_end_ = NULL;
+  bit_buffer_ = 0;
+  bit_count_ = 0;
+  state_ = decoder_state_finished;
+  is_final_block_ = false;
+  stored_remaining_ = 0;
+  literal_table_ = NULL;
+  distance_table_ = NULL;
+  crc_ = 0;
+  member_size_ = 0;
+  block_lengths_[0] = 0;
+  block_lengths_[1] = 0;
+  is_block_full_[0] = false;
+  is_block_full_[1] = false;
+  next_block_index_ = 0;
+  held_block_index_ = -1;
+  is_decoding_finished_ = false;
+  is_stopping_ = false;
+  has_error_ = false;
+  compressed_position_ = 0;
+}
+
+gzip_decoder::~gzip_decoder()
+{
+  close();
+}
+
+bool gzip_decoder::is_gzip(const char* data, const long long length)
+{
+  return length >= 2 && static_cast<unsigned char>(data[0]) == 0x1F && static_cast<unsigned char>(data[1]) == 0x8B;
+}
+
+bool gzip_decoder::open(const std::string& file_path)
+{
+  close();
+  if (!input_.open(file_path, false))
+    return false;
+  if (!read_member_header())
+  {
+    input_.close();
+    return false;
+  }
+  for (int index = 0; index < 2; index++)
+  {
+    blocks_[index].resize(GZIP_DECODER_HISTORY_SIZE + GZIP_DECODER_BLOCK_SIZE);
+    block_lengths_[index] = 0;
+    is_block_full_[index] = false;
+  }
+  next_block_index_ = 0;
+  held_block_index_ = -1;
+  is_decoding_finished_ = false;
+  is_stopping_ = false;
+  has_error_ = false;
+  thread_ = std::thread(&gzip_decoder::run, this);
+  return true;
+}
+
+void gzip_decoder::close()
+{
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    is_stopping_ = true;
+  }
+  condition_.notify_all();
+  if (thread_.joinable())
+    thread_.join();
+  input_.close();
+  input_offset_ = 0;
+  input_data_ = NULL;
+  input_end_ = NULL;
+  bit_buffer_ = 0;
+  bit_count_ = 0;
+  state_ = decoder_state_finished;
+  compressed_position_ = 0;
+  for (int index = 0; index < 2; index++)
+  {
+    std::vector<char>().swap(blocks_[index]);
+    is_block_full_[index] = false;
+  }
+}
+
+bool gzip_decoder::next_block(const char*& data, long long& length)
+{
+  std::unique_lock<std::mutex> lock(mutex_);
+  if (held_block_index_ > -1)
+  {
+    // The reader is done with the last block, so it can be decoded into again.
+    is_block_full_[held_block_index_] = false;
+    held_block_index_ = -1;
+    condition_.notify_all();
+  }
+  const int index = next_block_index_;
+  condition_.wait(lock, [this, index] { return is_block_full_[index] || is_decoding_finished_; });
+  if (!is_block_full_[index])
+    return false;
+  next_block_index_ = index ^ 1;
+  held_block_index_ = index;
+  data = &blocks_[index][GZIP_DECODER_HISTORY_SIZE];
+  length = block_lengths_[index];
+  return true;
+}
+
+bool gzip_decoder::has_error() const
+{
+  return has_error_;
+}
+
+long long gzip_decoder::get_compressed_position() const
+{
+  return compressed_position_;
+}
+
+void gzip_decoder::run()
+{
+  int index = 0;
+  // The number of valid bytes in the last block, including its history
+  long long previous_length = 0;
+  while (true)
+  {
+    {
+      std::unique_lock<std::mutex> lock(mutex_);
+      condition_.wait(lock, [this, index] { return is_stopping_ || !is_block_full_[index]; });
+      if (is_stopping_)
+        return;
+    }
+    // The reader may still be parsing the other block, but neither thread writes to it, so its end can be copied.
+    char* block = &blocks_[index][0];
+    const long long history_length = std::min<long long>(previous_length, GZIP_DECODER_HISTORY_SIZE);
+    if (history_length > 0)
+    {
+      const char* previous_end = &blocks_[index ^ 1][0] + GZIP_DECODER_HISTORY_SIZE + block_lengths_[index ^ 1];
+      std::memcpy(block + GZIP_DECODER_HISTORY_SIZE - history_length, previous_end - history_length,
+                  static_cast<size_t>(history_length));
+    }
+    long long length = 0;
+    const bool success = decode(block, history_length, length);
+    compressed_position_ = input_offset_ - (input_end_ - input_data_) - bit_count_ / 8;
+    previous_length = history_length + length;
+    if (!success)
+    {
+      std::stringstream stream;
+      stream << "gzip_decoder.run: The compressed data is invalid near byte " << compressed_position_ << ".";
+      octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, stream.str());
+    }
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      block_lengths_[index] = length;
+      is_block_full_[index] = length > 0;
+      if (!success)
+        has_error_ = true;
+      is_decoding_finished_ = !success || state_ == decoder_state_finished;
+    }
+    condition_.notify_all();
+    if (!success || state_ == decoder_state_finished)
+      return;
+    index ^= 1;
+  }
+}
+
+bool gzip_decoder::decode(char* buffer, const long long history_length, long long& length)
+{
+  char* const output_start = buffer + GZIP_DECODER_HISTORY_SIZE;
+  char* const output_end = output_start + GZIP_DECODER_BLOCK_SIZE;
+  const char* const history_start = output_start - history_length;
+  char* output = output_start;
+  // The start of the bytes that have not been added to the member's crc yet
+  const char* crc_start = output_start;
+  bool is_full = false;
+  bool success = true;
+  while (success && !is_full && state_ != decoder_state_finished)
+  {
+    bool is_block_end = false;
+    if (state_ == decoder_state_block_header)
+    {
+      success = read_block_header();
+    }
+    else if (state_ == decoder_state_stored)
+    {
+      while (stored_remaining_ > 0 && output < output_end)
+      {
+        // Whole bytes left in the bit buffer come first
+        if (bit_count_ >= 8)
+        {
+          *output++ = static_cast<char>(get_bits(8));
+          stored_remaining_--;
+          continue;
+        }
+        if (input_data_ == input_end_ && !next_input())
+        {
+          success = false;
+          break;
+        }
+        const long long count = std::min(
+          stored_remaining_, std::min<long long>(output_end - output, input_end_ - input_data_)
+        );
+        std::memcpy(output, input_data_, static_cast<size_t>(count));
+        output += count;
+        input_data_ += count;
+        stored_remaining_ -= count;
+      }
+      is_full = stored_remaining_ > 0;
+      is_block_end = success && !is_full;
+    }
+    else
+    {
+      // Stop while there is still room for the longest match, so a match never has to be split between blocks.
+      while (output_end - output >= 258)
+      {
+        const int symbol = decode_symbol(*literal_table_);
+        if (symbol < 256)
+        {
+          if (symbol < 0)
+          {
+            success = false;
+            break;
+          }
+          *output++ = static_cast<char>(symbol);
+          continue;
+        }
+        if (symbol == 256)
+        {
+          is_block_end = true;
+          break;
+        }
+        const int length_symbol = symbol - 257;
+        if (length_symbol >= 29 || !need_bits(length_extra_bits[length_symbol]))
+        {
+          success = false;
+          break;
+        }
+        const int match_length = length_base[length_symbol] + get_bits(length_extra_bits[length_symbol]);
+        const int distance_symbol = decode_symbol(*distance_table_);
+        if (distance_symbol < 0 || distance_symbol >= 30 || !need_bits(distance_extra_bits[distance_symbol]))
+        {
+          success = false;
+          break;
+        }
+        const int distance = distance_base[distance_symbol] + get_bits(distance_extra_bits[distance_symbol]);
+        if (distance > output - history_start)
+        {
+          success = false;
+          break;
+        }
+        const char* match = output - distance;
+        if (distance >= match_length)
+        {
+          std::memcpy(output, match, match_length);
+          output += match_length;
+        }
+        else
+        {
+          // The match overlaps the bytes it produces
+          for (int index = 0; index < match_length; index++)
+            *output++ = *match++;
+        }
+      }
+      is_full = success && !is_block_end;
+    }
+    if (is_block_end)
+    {
+      if (!is_final_block_)
+      {
+        state_ = decoder_state_block_header;
+        continue;
+      }
+      crc_ = utilities::update_crc32(crc_, crc_start, output - crc_start);
+      member_size_ += static_cast<unsigned int>(output - crc_start);
+      crc_start = output;
+      success = read_member_trailer();
+    }
+  }
+  crc_ = utilities::update_crc32(crc_, crc_start, output - crc_start);
+  member_size_ += static_cast<unsigned int>(output - crc_start);
+  length = output - output_start;
+  return success;
+}
+
+bool gzip_decoder::read_member_header()
+{
+  unsigned int id_1, id_2, method, flags, value;
+  if (!read_byte(id_1) || !read_byte(id_2) || !read_byte(method) || !read_byte(flags))
+    return false;
+  if (id_1 != 0x1F || id_2 != 0x8B || method != 8 || (flags & gzip_flags_reserved) != 0)
+    return false;
+  // The modification time, extra flags and operating system
+  for (int index = 0; index < 6; index++)
+  {
+    if (!read_byte(value))
+      return false;
+  }
+  if (flags & gzip_flag_extra)
+  {
+    unsigned int low, high;
+    if (!read_byte(low) || !read_byte(high))
+      return false;
+    for (unsigned int index = 0; index < (low | (high << 8)); index++)
+    {
+      if (!read_byte(value))
+        return false;
+    }
+  }
+  // The file name and comment are zero terminated
+  for (int field = 0; field < 2; field++)
+  {
+    if (flags & (field == 0 ? gzip_flag_name : gzip_flag_comment))
+    {
+      do
+      {
+        if (!read_byte(value))
+          return false;
+      } while (value != 0);
+    }
+  }
+  if (flags & gzip_flag_header_crc)
+  {
+    if (!read_byte(value) || !read_byte(value))
+      return false;
+  }
+  crc_ = 0;
+  member_size_ = 0;
+  state_ = decoder_state_block_header;
+  return true;
+}
+
+bool gzip_decoder::read_member_trailer()
+{
+  get_bits(bit_count_ % 8);
+  unsigned int crc = 0;
+  unsigned int size = 0;
+  unsigned int value;
+  for (int index = 0; index < 4; index++)
+  {
+    if (!read_byte(value))
+      return false;
+    crc |= value << (index * 8);
+  }
+  for (int index = 0; index < 4; index++)
+  {
+    if (!read_byte(value))
+      return false;
+    size |= value << (index * 8);
+  }
+  if (crc != crc_ || size != member_size_)
+    return false;
+  // Another member may follow.  Anything else after the member is ignored, like gzip does.
+  state_ = decoder_state_finished;
+  if (!need_bits(16) || !is_gzip_magic())
+    return !has_error_;
+  return read_member_header();
+}
+
+bool gzip_decoder::is_gzip_magic() const
+{
+  return (bit_buffer_ & 0xFFFF) == 0x8B1F;
+}
+
+bool gzip_decoder::read_block_header()
+{
+  if (!need_bits(3))
+    return false;
+  is_final_block_ = get_bits(1) == 1;
+  const unsigned int type = get_bits(2);
+  if (type == 0)
+  {
+    get_bits(bit_count_ % 8);
+    if (!need_bits(32))
+      return false;
+    const unsigned int length = get_bits(16);
+    const unsigned int complement = get_bits(16);
+    if (length != (~complement & 0xFFFF))
+      return false;
+    stored_remaining_ = length;
+    state_ = decoder_state_stored;
+    return true;
+  }
+  if (type == 1)
+  {
+    literal_table_ = &get_fixed_tables().literals;
+    distance_table_ = &get_fixed_tables().distances;
+    state_ = decoder_state_huffman;
+    return true;
+  }
+  if (type == 2 && read_dynamic_tables())
+  {
+    literal_table_ = &dynamic_literal_table_;
+    distance_table_ = &dynamic_distance_table_;
+    state_ = decoder_state_huffman;
+    return true;
+  }
+  return false;
+}
+
+bool gzip_decoder::read_dynamic_tables()
+{
+  if (!need_bits(14))
+    return false;
+  const int num_literals = static_cast<int>(get_bits(5)) + 257;
+  const int num_distances = static_cast<int>(get_bits(5)) + 1;
+  const int num_code_lengths = static_cast<int>(get_bits(4)) + 4;
+  if (num_literals > 286 || num_distances > 30)
+    return false;
+  unsigned char code_lengths[19];
+  std::memset(code_lengths, 0, sizeof(code_lengths));
+  for (int index = 0; index < num_code_lengths; index++)
+  {
+    if (!need_bits(3))
+      return false;
+    code_lengths[code_length_order[index]] = static_cast<unsigned char>(get_bits(3));
+  }
+  gzip_huffman_table code_length_table;
+  if (!code_length_table.build(code_lengths, 19))
+    return false;
+
+  unsigned char lengths[286 + 30];
+  const int num_lengths = num_literals + num_distances;
+  int index = 0;
+  while (index < num_lengths)
+  {
+    const int symbol = decode_symbol(code_length_table);
+    if (symbol < 0)
+      return false;
+    if (symbol < 16)
+    {
+      lengths[index++] = static_cast<unsigned char>(symbol);
+      continue;
+    }
+    unsigned char value = 0;
+    int repeat;
+    if (symbol == 16)
+    {
+      // Repeat the previous length
+      if (index == 0 || !need_bits(2))
+        return false;
+      value = lengths[index - 1];
+      repeat = 3 + static_cast<int>(get_bits(2));
+    }
+    else if (symbol == 17)
+    {
+      if (!need_bits(3))
+        return false;
+      repeat = 3 + static_cast<int>(get_bits(3));
+    }
+    else
+    {
+      if (!need_bits(7))
+        return false;
+      repeat = 11 + static_cast<int>(get_bits(7));
+    }
+    if (index + repeat > num_lengths)
+      return false;
+    while (repeat-- > 0)
+      lengths[index++] = value;
+  }
+  // Every block has to be able to end
+  if (lengths[256] == 0)
+    return false;
+  return dynamic_literal_table_.build(lengths, num_literals) &&
+    dynamic_distance_table_.build(lengths + num_literals, num_distances);
+}
+
+int gzip_decoder::decode_symbol(const gzip_huffman_table& table)
+{
+  if (bit_count_ < 15)
+    refill();
+  const unsigned short entry = table.fast[bit_buffer_ & ((1 << GZIP_DECODER_FAST_BITS) - 1)];
+  if (entry != 0 && static_cast<int>(entry & 15) <= bit_count_)
+  {
+    bit_buffer_ >>= entry & 15;
+    bit_count_ -= entry & 15;
+    return entry >> 4;
+  }
+  // Longer codes are decoded a bit at a time
+  int code = 0;
+  int first = 0;
+  int index = 0;
+  for (int length = 1; length < 16 && length <= bit_count_; length++)
+  {
+    code |= static_cast<int>((bit_buffer_ >> (length - 1)) & 1);
+    const int count = table.count[length];
+    if (code - count < first)
+    {
+      bit_buffer_ >>= length;
+      bit_count_ -= length;
+      return table.symbol[index + (code - first)];
+    }
+    index += count;
+    first += count;
+    first <<= 1;
+    code <<= 1;
+  }
+  return -1;
+}
+
+bool gzip_decoder::next_input()
+{
+  const long long file_size = input_.get_file_size();
+  if (input_offset_ >= file_size)
+    return false;
+  const long long length = std::min<long long>(GZIP_DECODER_INPUT_SIZE, file_size - input_offset_);
+  const char* data = input_.get_range(input_offset_, length);
+  if (data == NULL)
+  {
+    has_error_ = true;
+    return false;
+  }
+  input_data_ = reinterpret_cast<const unsigned char*>(data);
+  input_end_ = input_data_ + length;
+  input_offset_ += length;
+  return true;
+}
+
+void gzip_decoder::refill()
+{
+  while (bit_count_ <= 56)
+  {
+    if (input_data_ == input_end_ && !next_input())
+      return;
+    bit_buffer_ |= static_cast<unsigned long long>(*input_data_++) << bit_count_;
+    bit_count_ += 8;
+  }
+}
+
+bool gzip_decoder::need_bits(const int count)
+{
+  while (bit_count_ < count)
+  {
+    if (input_data_ == input_end_ && !next_input())
+      return false;
+    bit_buffer_ |= static_cast<unsigned long long>(*input_data_++) << bit_count_;
+    bit_count_ += 8;
+  }
+  return true;
+}
+
+unsigned int gzip_decoder::get_bits(const int count)
+{
+  const unsigned int value = static_cast<unsigned int>(bit_buffer_ & ((1ULL << count) - 1));
+  bit_buffer_ >>= count;
+  bit_count_ -= count;
+  return value;
+}
+
+bool gzip_decoder::read_byte(unsigned int& value)
+{
+  if (!need_bits(8))
+    return false;
+  value = get_bits(8);
+  return true;
+}
+#pragma endregion gzip_decoder
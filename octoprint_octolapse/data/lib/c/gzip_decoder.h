@@ -0,0 +1,133 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef GZIP_DECODER_H
+#define GZIP_DECODER_H
+#include <string>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include "gcode_file_reader.h"
+
+// The number of decoded bytes handed to the reader at once
+#define GZIP_DECODER_BLOCK_SIZE 1048576
+// The largest distance a deflate match can reach back
+#define GZIP_DECODER_HISTORY_SIZE 32768
+// The number of compressed bytes read at once
+#define GZIP_DECODER_INPUT_SIZE 1048576
+// Codes up to this length are decoded with a single table lookup
+#define GZIP_DECODER_FAST_BITS 10
+
+/**
+ * \brief A canonical huffman code.  Codes up to GZIP_DECODER_FAST_BITS long are found with one lookup in fast,
+ * the rest are decoded a bit at a time from count and symbol.
+ */
+struct gzip_huffman_table
+{
+  bool build(const unsigned char* lengths, int num_symbols);
+  // symbol << 4 | code length, or 0 if the code is longer than GZIP_DECODER_FAST_BITS
+  unsigned short fast[1 << GZIP_DECODER_FAST_BITS];
+  short count[16];
+  short symbol[288];
+};
+
+/**
+ * \brief Decompresses a gzip file (RFC 1952, deflate data per RFC 1951) on its own thread.  Two blocks are decoded
+ * into in turn, so the next block is decompressed while the reader parses the last one.  Members are concatenated,
+ * and every member's CRC and size are checked.
+ */
+class gzip_decoder : public gcode_stream_decoder
+{
+public:
+  gzip_decoder();
+  ~gzip_decoder();
+  /**
+   * \brief Opens the file, reads the first member header and starts decoding.
+   */
+  bool open(const std::string& file_path) override;
+  void close() override;
+  bool next_block(const char*& data, long long& length) override;
+  bool has_error() const override;
+  long long get_compressed_position() const override;
+  /**
+   * \brief Returns true if the data starts with the gzip magic number.
+   */
+  static bool is_gzip(const char* data, long long length);
+private:
+  gzip_decoder(const gzip_decoder&);
+  gzip_decoder& operator=(const gzip_decoder&);
+  enum decoder_state
+  {
+    decoder_state_block_header,
+    decoder_state_stored,
+    decoder_state_huffman,
+    decoder_state_finished
+  };
+  void run();
+  bool decode(char* buffer, long long history_length, long long& length);
+  bool read_member_header();
+  bool read_member_trailer();
+  bool read_block_header();
+  bool read_dynamic_tables();
+  bool is_gzip_magic() const;
+  int decode_symbol(const gzip_huffman_table& table);
+  bool next_input();
+  void refill();
+  bool need_bits(int count);
+  unsigned int get_bits(int count);
+  bool read_byte(unsigned int& value);
+  // Compressed input
+  gcode_file_reader input_;
+  long long input_offset_;
+  const unsigned char* input_data_;
+  const unsigned char* input_end_;
+  unsigned long long bit_buffer_;
+  int bit_count_;
+  // Inflate state
+  decoder_state state_;
+  bool is_final_block_;
+  long long stored_remaining_;
+  // Point to either the fixed tables or the dynamic tables of the current block
+  const gzip_huffman_table* literal_table_;
+  const gzip_huffman_table* distance_table_;
+  gzip_huffman_table dynamic_literal_table_;
+  gzip_huffman_table dynamic_distance_table_;
+  unsigned int crc_;
+  unsigned int member_size_;
+  // The decoding thread and the blocks it decodes into.  Each block starts with GZIP_DECODER_HISTORY_SIZE bytes
+  // holding the end of the previous block, so matches can reach back into it.
+  std::thread thread_;
+  std::mutex mutex_;
+  std::condition_variable condition_;
+  std::vector<char> blocks_[2];
+  long long block_lengths_[2];
+  bool is_block_full_[2];
+  int next_block_index_;
+  // The block the reader is parsing, or -1
+  int held_block_index_;
+  bool is_decoding_finished_;
+  bool is_stopping_;
+  std::atomic<bool> has_error_;
+  std::atomic<long long> compressed_position_;
+};
+#endif
@@ -0,0 +1,266 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "instrumentation.h"
+#ifndef OCTOLAPSE_DISABLE_STATS
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "logging.h"
+
+static const char* phase_names[octolapse_stats::NUM_PHASES] = {
+  "read", "tokenize", "parse", "position_update", "comment_processing", "trigger_evaluation", "plan_building", "write",
+  "process_file"
+};
+static const char* call_names[octolapse_stats::NUM_CALLS] = {
+  "update", "update_position", "parse", "filter_queued_gcode", "parse_firmware_response"
+};
+static const char* counter_names[octolapse_stats::NUM_COUNTERS] = {
+  "lines_read", "bytes_read", "gcodes_processed", "comments_processed", "snapshot_plans"
+};
+
+struct phase_stats
+{
+  std::atomic<long long> count;
+  std::atomic<long long> nanoseconds;
+};
+
+struct call_stats
+{
+  std::atomic<long long> count;
+  std::atomic<long long> nanoseconds;
+  std::atomic<long long> min_nanoseconds;
+  std::atomic<long long> max_nanoseconds;
+  std::atomic<long long> histogram[OCTOLAPSE_STATS_HISTOGRAM_BUCKETS];
+};
+
+struct trace_event
+{
+  const char* name;
+  const char* category;
+  long long start_nanoseconds;
+  long long duration_nanoseconds;
+  size_t thread_id;
+};
+
+static std::atomic<bool> stats_enabled(false);
+static phase_stats phases[octolapse_stats::NUM_PHASES];
+static call_stats calls[octolapse_stats::NUM_CALLS];
+static std::atomic<long long> counters[octolapse_stats::NUM_COUNTERS];
+// Trace events are rare (calls and coarse phases), so a mutex is fine here.
+static std::mutex trace_mutex;
+static std::vector<trace_event> trace_events;
+static long long dropped_trace_events = 0;
+static std::atomic<long long> epoch_nanoseconds(0);
+
+static long long get_nanoseconds()
+{
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+    std::chrono::steady_clock::now().time_since_epoch()
+  ).count();
+}
+
+static int get_histogram_bucket(long long nanoseconds)
+{
+  int bucket = 0;
+  while (nanoseconds > 1 && bucket < OCTOLAPSE_STATS_HISTOGRAM_BUCKETS - 1)
+  {
+    nanoseconds >>= 1;
+    bucket++;
+  }
+  return bucket;
+}
+
+static void add_trace_event(const char* name, const char* category, long long start_nanoseconds,
+                            long long duration_nanoseconds)
+{
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  if (trace_events.size() >= OCTOLAPSE_STATS_MAX_TRACE_EVENTS)
+  {
+    dropped_trace_events++;
+    return;
+  }
+  trace_event event;
+  event.name = name;
+  event.category = category;
+  event.start_nanoseconds = start_nanoseconds;
+  event.duration_nanoseconds = duration_nanoseconds;
+  event.thread_id = std::hash<std::thread::id>()(std::this_thread::get_id());
+  trace_events.push_back(event);
+}
+
+bool octolapse_stats_enabled()
+{
+  return stats_enabled.load(std::memory_order_relaxed);
+}
+
+void octolapse_set_stats_enabled(bool enabled)
+{
+  if (enabled && epoch_nanoseconds.load() == 0)
+    epoch_nanoseconds.store(get_nanoseconds());
+  stats_enabled.store(enabled);
+}
+
+void octolapse_reset_stats()
+{
+  for (int index = 0; index < octolapse_stats::NUM_PHASES; index++)
+  {
+    phases[index].count.store(0);
+    phases[index].nanoseconds.store(0);
+  }
+  for (int index = 0; index < octolapse_stats::NUM_CALLS; index++)
+  {
+    calls[index].count.store(0);
+    calls[index].nanoseconds.store(0);
+    calls[index].min_nanoseconds.store(0);
+    calls[index].max_nanoseconds.store(0);
+    for (int bucket = 0; bucket < OCTOLAPSE_STATS_HISTOGRAM_BUCKETS; bucket++)
+      calls[index].histogram[bucket].store(0);
+  }
+  for (int index = 0; index < octolapse_stats::NUM_COUNTERS; index++)
+    counters[index].store(0);
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  trace_events.clear();
+  dropped_trace_events = 0;
+  epoch_nanoseconds.store(get_nanoseconds());
+}
+
+void octolapse_add_stats_count(int counter, long long amount)
+{
+  if (stats_enabled.load(std::memory_order_relaxed))
+    counters[counter].fetch_add(amount, std::memory_order_relaxed);
+}
+
+#pragma region octolapse_stats_timer
+octolapse_stats_timer::octolapse_stats_timer(timer_type type, int id)
+{
+  type_ = type;
+  id_ = id;
+  is_running_ = stats_enabled.load(std::memory_order_relaxed);
+  start_nanoseconds_ = is_running_ ? get_nanoseconds() : 0;
+}
+
+octolapse_stats_timer::~octolapse_stats_timer()
+{
+  stop();
+}
+
+void octolapse_stats_timer::stop()
+{
+  if (!is_running_)
+    return;
+  is_running_ = false;
+  const long long duration = get_nanoseconds() - start_nanoseconds_;
+  if (type_ == CALL)
+  {
+    call_stats& stats = calls[id_];
+    const long long count = stats.count.fetch_add(1, std::memory_order_relaxed);
+    stats.nanoseconds.fetch_add(duration, std::memory_order_relaxed);
+    long long current = stats.min_nanoseconds.load(std::memory_order_relaxed);
+    while ((count == 0 || duration < current)
+      && !stats.min_nanoseconds.compare_exchange_weak(current, duration, std::memory_order_relaxed))
+    {
+    }
+    current = stats.max_nanoseconds.load(std::memory_order_relaxed);
+    while (duration > current
+      && !stats.max_nanoseconds.compare_exchange_weak(current, duration, std::memory_order_relaxed))
+    {
+    }
+    stats.histogram[get_histogram_bucket(duration)].fetch_add(1, std::memory_order_relaxed);
+    add_trace_event(call_names[id_], "call", start_nanoseconds_, duration);
+    return;
+  }
+  phases[id_].count.fetch_add(1, std::memory_order_relaxed);
+  phases[id_].nanoseconds.fetch_add(duration, std::memory_order_relaxed);
+  if (type_ == TRACED_PHASE)
+    add_trace_event(phase_names[id_], "phase", start_nanoseconds_, duration);
+}
+#pragma endregion
+
+void octolapse_get_stats(octolapse_stats_snapshot& stats)
+{
+  stats.enabled = octolapse_stats_enabled();
+  for (int index = 0; index < octolapse_stats::NUM_PHASES; index++)
+  {
+    stats.phases[index].count = phases[index].count.load();
+    stats.phases[index].nanoseconds = phases[index].nanoseconds.load();
+  }
+  for (int index = 0; index < octolapse_stats::NUM_CALLS; index++)
+  {
+    stats.calls[index].count = calls[index].count.load();
+    stats.calls[index].nanoseconds = calls[index].nanoseconds.load();
+    stats.calls[index].min_nanoseconds = calls[index].min_nanoseconds.load();
+    stats.calls[index].max_nanoseconds = calls[index].max_nanoseconds.load();
+    for (int bucket = 0; bucket < OCTOLAPSE_STATS_HISTOGRAM_BUCKETS; bucket++)
+      stats.calls[index].histogram[bucket] = calls[index].histogram[bucket].load();
+  }
+  for (int index = 0; index < octolapse_stats::NUM_COUNTERS; index++)
+    stats.counters[index] = counters[index].load();
+}
+
+const char* octolapse_stats_phase_name(const int phase)
+{
+  return phase >= 0 && phase < octolapse_stats::NUM_PHASES ? phase_names[phase] : "";
+}
+
+const char* octolapse_stats_call_name(const int call)
+{
+  return call >= 0 && call < octolapse_stats::NUM_CALLS ? call_names[call] : "";
+}
+
+const char* octolapse_stats_counter_name(const int counter)
+{
+  return counter >= 0 && counter < octolapse_stats::NUM_COUNTERS ? counter_names[counter] : "";
+}
+
+bool octolapse_write_stats_trace(const std::string& file_path)
+{
+  std::ofstream trace_file(file_path.c_str(), std::ios::out | std::ios::trunc);
+  if (!trace_file.is_open())
+  {
+    octolapse_log(octolapse_log::GCODE_POSITION, octolapse_log::ERROR,
+                  "Instrumentation.octolapse_write_stats_trace - Unable to open the trace file: " + file_path);
+    return false;
+  }
+  const long long epoch = epoch_nanoseconds.load();
+  std::lock_guard<std::mutex> lock(trace_mutex);
+  // Timestamps are in microseconds, the format's native unit
+  trace_file << "{\"displayTimeUnit\":\"ns\",\"otherData\":{\"dropped_events\":" << dropped_trace_events
+    << "},\"traceEvents\":[";
+  trace_file.precision(3);
+  trace_file << std::fixed;
+  for (std::vector<trace_event>::const_iterator it = trace_events.begin(); it != trace_events.end(); ++it)
+  {
+    if (it != trace_events.begin())
+      trace_file << ",";
+    trace_file << "\n{\"name\":\"" << it->name << "\",\"cat\":\"" << it->category << "\",\"ph\":\"X\",\"pid\":1"
+      << ",\"tid\":" << (it->thread_id % 1000000)
+      << ",\"ts\":" << static_cast<double>(it->start_nanoseconds - epoch) / 1000.0
+      << ",\"dur\":" << static_cast<double>(it->duration_nanoseconds) / 1000.0 << "}";
+  }
+  trace_file << "\n]}\n";
+  trace_file.close();
+  return !trace_file.fail();
+}
+#endif
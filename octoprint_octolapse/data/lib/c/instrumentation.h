@@ -0,0 +1,139 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+#include <string>
+
+struct octolapse_stats
+{
+  // Time spent in each part of processing.  Phases can nest, position_update includes comment_processing.
+  enum phases
+  {
+    READ, TOKENIZE, PARSE, POSITION_UPDATE, COMMENT_PROCESSING, TRIGGER_EVALUATION, PLAN_BUILDING, WRITE,
+    PROCESS_FILE, NUM_PHASES
+  };
+
+  // Calls from python whose latency is recorded in a histogram
+  enum calls
+  {
+    UPDATE_CALL, UPDATE_POSITION_CALL, PARSE_CALL, FILTER_QUEUED_GCODE_CALL, PARSE_FIRMWARE_RESPONSE_CALL, NUM_CALLS
+  };
+
+  enum counters { LINES_READ, BYTES_READ, GCODES_PROCESSED, COMMENTS_PROCESSED, SNAPSHOT_PLANS, NUM_COUNTERS };
+};
+
+// The number of power of 2 latency buckets, the last of which holds everything longer than about 2 seconds.
+#define OCTOLAPSE_STATS_HISTOGRAM_BUCKETS 32
+// The maximum number of trace events kept for the chrome trace.  Later events are counted but not kept.
+#define OCTOLAPSE_STATS_MAX_TRACE_EVENTS 100000
+
+#ifndef OCTOLAPSE_DISABLE_STATS
+
+/**
+ * \brief A copy of the statistics at one point in time.
+ */
+struct octolapse_stats_snapshot
+{
+  struct phase
+  {
+    long long count;
+    long long nanoseconds;
+  };
+
+  struct call
+  {
+    long long count;
+    long long nanoseconds;
+    long long min_nanoseconds;
+    long long max_nanoseconds;
+    // Bucket n holds the calls shorter than 2^(n+1) nanoseconds, and at least as long as the previous bucket's bound.
+    long long histogram[OCTOLAPSE_STATS_HISTOGRAM_BUCKETS];
+  };
+
+  bool enabled;
+  phase phases[octolapse_stats::NUM_PHASES];
+  call calls[octolapse_stats::NUM_CALLS];
+  long long counters[octolapse_stats::NUM_COUNTERS];
+};
+
+/**
+ * \brief Returns true if statistics are being collected.  Collection is off until enabled from python, since timing
+ * every line of a file isn't free.
+ */
+bool octolapse_stats_enabled();
+void octolapse_set_stats_enabled(bool enabled);
+void octolapse_reset_stats();
+void octolapse_add_stats_count(int counter, long long amount);
+void octolapse_get_stats(octolapse_stats_snapshot& stats);
+const char* octolapse_stats_phase_name(int phase);
+const char* octolapse_stats_call_name(int call);
+const char* octolapse_stats_counter_name(int counter);
+/**
+ * \brief Writes the recorded calls and coarse phases as a chrome trace-event JSON file (chrome://tracing).
+ */
+bool octolapse_write_stats_trace(const std::string& file_path);
+
+/**
+ * \brief Times a phase or a call from construction until stop() is called or the timer goes out of scope.
+ */
+class octolapse_stats_timer
+{
+public:
+  enum timer_type { PHASE, TRACED_PHASE, CALL };
+  octolapse_stats_timer(timer_type type, int id);
+  ~octolapse_stats_timer();
+  void stop();
+private:
+  timer_type type_;
+  int id_;
+  bool is_running_;
+  long long start_nanoseconds_;
+};
+
+#define OCTOLAPSE_STATS_CONCAT_INNER(a, b) a##b
+#define OCTOLAPSE_STATS_CONCAT(a, b) OCTOLAPSE_STATS_CONCAT_INNER(a, b)
+// Time the rest of the current scope as the given phase.
+#define OCTOLAPSE_STATS_PHASE(phase) \
+  octolapse_stats_timer OCTOLAPSE_STATS_CONCAT(octolapse_stats_timer_, __LINE__)(octolapse_stats_timer::PHASE, phase)
+// Time the rest of the current scope as the given phase, and record it in the chrome trace.  Use for coarse phases.
+#define OCTOLAPSE_STATS_TRACED_PHASE(phase) \
+  octolapse_stats_timer OCTOLAPSE_STATS_CONCAT(octolapse_stats_timer_, __LINE__)(octolapse_stats_timer::TRACED_PHASE, phase)
+// Time the rest of the current scope as the given call from python.
+#define OCTOLAPSE_STATS_CALL(call) \
+  octolapse_stats_timer OCTOLAPSE_STATS_CONCAT(octolapse_stats_timer_, __LINE__)(octolapse_stats_timer::CALL, call)
+// Start a named phase timer that is stopped with OCTOLAPSE_STATS_STOP, or at the end of the scope.
+#define OCTOLAPSE_STATS_START(name, phase) octolapse_stats_timer name(octolapse_stats_timer::PHASE, phase)
+#define OCTOLAPSE_STATS_STOP(name) name.stop()
+#define OCTOLAPSE_STATS_COUNT(counter, amount) octolapse_add_stats_count(counter, amount)
+
+#else
+
+#define OCTOLAPSE_STATS_PHASE(phase)
+#define OCTOLAPSE_STATS_TRACED_PHASE(phase)
+#define OCTOLAPSE_STATS_CALL(call)
+#define OCTOLAPSE_STATS_START(name, phase)
+#define OCTOLAPSE_STATS_STOP(name)
+#define OCTOLAPSE_STATS_COUNT(counter, amount)
+
+#endif
+#endif
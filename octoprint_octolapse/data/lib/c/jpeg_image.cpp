@@ -0,0 +1,1772 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "jpeg_image.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+// The index of each zigzag ordered coefficient in the natural (row major) order.  The extra entries catch corrupt
+// run lengths without a bounds check.
+static const int jpeg_natural_order[64 + 16] = {
+  0, 1, 8, 16, 9, 2, 3, 10, 17, 24, 32, 25, 18, 11, 4, 5,
+  12, 19, 26, 33, 40, 48, 41, 34, 27, 20, 13, 6, 7, 14, 21, 28,
+  35, 42, 49, 56, 57, 50, 43, 36, 29, 22, 15, 23, 30, 37, 44, 51,
+  58, 59, 52, 45, 38, 31, 39, 46, 53, 60, 61, 54, 47, 55, 62, 63,
+  63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63, 63
+};
+
+// Only this much of a file is read to find the frame header.  Larger headers (huge exif data) cause a full read.
+#define JPEG_HEADER_READ_SIZE 262144
+// Refuse to allocate the coefficients for absurdly large images, which are almost certainly corrupt.
+#define JPEG_MAX_PIXELS 268435456LL
+
+jpeg_component::jpeg_component()
+{
+  id = 0;
+  h_samp = 1;
+  v_samp = 1;
+  quant_table = 0;
+  dc_table = 0;
+  ac_table = 0;
+  width = 0;
+  height = 0;
+  blocks_wide = 0;
+  blocks_high = 0;
+}
+
+jpeg_huffman_table::jpeg_huffman_table()
+{
+  is_defined = false;
+  memset(lookup, 0, sizeof(lookup));
+  memset(max_code, 0, sizeof(max_code));
+  memset(value_offset, 0, sizeof(value_offset));
+  memset(values, 0, sizeof(values));
+  memset(counts, 0, sizeof(counts));
+  num_values = 0;
+}
+
+bool jpeg_huffman_table::build(const unsigned char* counts, const unsigned char* symbols, const int num_symbols)
+{
+  memset(lookup, 0, sizeof(lookup));
+  unsigned int code = 0;
+  int symbol_index = 0;
+  for (int length = 1; length <= 16; length++)
+  {
+    value_offset[length] = symbol_index - static_cast<int>(code);
+    for (int count = 0; count < counts[length - 1]; count++)
+    {
+      if (length <= 9)
+      {
+        // Every 9 bit value starting with this code decodes to the symbol
+        const int shift = 9 - length;
+        const unsigned int first = code << shift;
+        for (unsigned int index = 0; index < (1u << shift); index++)
+          lookup[first + index] = static_cast<unsigned short>((length << 8) | symbols[symbol_index]);
+      }
+      code++;
+      symbol_index++;
+    }
+    // The codes of a length must fit in that many bits
+    if (code > (1u << length))
+      return false;
+    max_code[length] = code << (16 - length);
+    code <<= 1;
+  }
+  max_code[17] = 0xFFFFFFFF;
+  if (symbol_index != num_symbols)
+    return false;
+  memset(values, 0, sizeof(values));
+  memcpy(values, symbols, num_symbols);
+  memcpy(this->counts, counts, sizeof(this->counts));
+  num_values = num_symbols;
+  is_defined = true;
+  return true;
+}
+
+#pragma region Entropy decoding
+/**
+ * \brief Reads the entropy coded segment of a scan.  Stuffed zero bytes are removed, and zero bits are returned once
+ * a marker is reached.
+ */
+struct jpeg_bit_reader
+{
+  jpeg_bit_reader(const unsigned char* data, const size_t size, const size_t position)
+  {
+    this->data = data;
+    this->size = size;
+    this->position = position;
+    buffer = 0;
+    bits = 0;
+    hit_marker = false;
+  }
+
+  const unsigned char* data;
+  size_t size;
+  size_t position;
+  // The next bits of the stream, left aligned
+  unsigned int buffer;
+  int bits;
+  bool hit_marker;
+
+  inline void fill()
+  {
+    while (bits <= 24)
+    {
+      unsigned int byte = 0;
+      if (!hit_marker && position < size)
+      {
+        byte = data[position];
+        if (byte == 0xFF)
+        {
+          const unsigned int next = position + 1 < size ? data[position + 1] : 0xD9;
+          if (next == 0x00)
+            position += 2;
+          else
+          {
+            // Leave the position on the marker so that it can be read after the scan
+            hit_marker = true;
+            byte = 0;
+          }
+        }
+        else
+          position++;
+      }
+      buffer |= byte << (24 - bits);
+      bits += 8;
+    }
+  }
+
+  /**
+   * \brief Returns the next huffman coded symbol, or -1 if the code is not in the table.
+   */
+  inline int decode(const jpeg_huffman_table& table)
+  {
+    if (bits < 16)
+      fill();
+    const unsigned int entry = table.lookup[buffer >> 23];
+    if (entry != 0)
+    {
+      const int length = static_cast<int>(entry >> 8);
+      buffer <<= length;
+      bits -= length;
+      return static_cast<int>(entry & 0xFF);
+    }
+    const unsigned int code = buffer >> 16;
+    int length = 10;
+    while (code >= table.max_code[length])
+      length++;
+    if (length > 16)
+      return -1;
+    const int index = static_cast<int>(code >> (16 - length)) + table.value_offset[length];
+    if (index < 0 || index > 255)
+      return -1;
+    buffer <<= length;
+    bits -= length;
+    return table.values[index];
+  }
+
+  /**
+   * \brief Reads a length bit value and extends its sign, as described in F.2.2.1 of the JPEG spec.
+   */
+  inline int receive_extend(const int length)
+  {
+    if (bits < length)
+      fill();
+    const int value = static_cast<int>(buffer >> (32 - length));
+    buffer <<= length;
+    bits -= length;
+    return value < (1 << (length - 1)) ? value - (1 << length) + 1 : value;
+  }
+
+  /**
+   * \brief Discards the remaining bits of the interval, and skips the restart marker.
+   */
+  void restart()
+  {
+    buffer = 0;
+    bits = 0;
+    hit_marker = false;
+    while (position + 1 < size)
+    {
+      if (data[position] == 0xFF)
+      {
+        const unsigned char marker = data[position + 1];
+        if (marker >= 0xD0 && marker <= 0xD7)
+        {
+          position += 2;
+          return;
+        }
+        if (marker != 0x00 && marker != 0xFF)
+          // Some other marker, the data is missing
+          return;
+      }
+      position++;
+    }
+  }
+};
+
+static inline bool decode_block(jpeg_bit_reader& reader, const jpeg_huffman_table& dc_table,
+                                const jpeg_huffman_table& ac_table, short* block, int& dc_prediction)
+{
+  const int category = reader.decode(dc_table);
+  if (category < 0 || category > 16)
+    return false;
+  if (category > 0)
+  {
+    dc_prediction += reader.receive_extend(category);
+    // Only corrupt data leaves the range of a coefficient
+    if (dc_prediction > 32767)
+      dc_prediction = 32767;
+    else if (dc_prediction < -32768)
+      dc_prediction = -32768;
+  }
+  block[0] = static_cast<short>(dc_prediction);
+  for (int k = 1; k < 64;)
+  {
+    const int symbol = reader.decode(ac_table);
+    if (symbol < 0)
+      return false;
+    const int run = symbol >> 4;
+    const int length = symbol & 15;
+    if (length == 0)
+    {
+      // End of block, or a run of 16 zeros
+      if (run != 15)
+        break;
+      k += 16;
+      continue;
+    }
+    k += run;
+    if (k > 63)
+      return false;
+    block[jpeg_natural_order[k]] = static_cast<short>(reader.receive_extend(length));
+    k++;
+  }
+  return true;
+}
+#pragma endregion
+
+#pragma region Inverse DCT and color conversion
+// An integer IDCT with 12 bits of fractional precision, equivalent to the accurate integer IDCT of the IJG library.
+#define JPEG_FIX(x) static_cast<int>((x) * 4096 + 0.5)
+
+struct jpeg_idct_terms
+{
+  int x0, x1, x2, x3, t0, t1, t2, t3;
+};
+
+static inline void idct_1d(const int s0, const int s1, const int s2, const int s3, const int s4, const int s5,
+                           const int s6, const int s7, jpeg_idct_terms& terms)
+{
+  // Even part
+  int p2 = s2;
+  int p3 = s6;
+  int p1 = (p2 + p3) * JPEG_FIX(0.5411961);
+  int t2 = p1 + p3 * JPEG_FIX(-1.847759065);
+  int t3 = p1 + p2 * JPEG_FIX(0.765366865);
+  p2 = s0;
+  p3 = s4;
+  int t0 = (p2 + p3) * 4096;
+  int t1 = (p2 - p3) * 4096;
+  terms.x0 = t0 + t3;
+  terms.x3 = t0 - t3;
+  terms.x1 = t1 + t2;
+  terms.x2 = t1 - t2;
+  // Odd part
+  t0 = s7;
+  t1 = s5;
+  t2 = s3;
+  t3 = s1;
+  p3 = t0 + t2;
+  int p4 = t1 + t3;
+  p1 = t0 + t3;
+  p2 = t1 + t2;
+  const int p5 = (p3 + p4) * JPEG_FIX(1.175875602);
+  t0 *= JPEG_FIX(0.298631336);
+  t1 *= JPEG_FIX(2.053119869);
+  t2 *= JPEG_FIX(3.072711026);
+  t3 *= JPEG_FIX(1.501321110);
+  p1 = p5 + p1 * JPEG_FIX(-0.899976223);
+  p2 = p5 + p2 * JPEG_FIX(-2.562915447);
+  p3 *= JPEG_FIX(-1.961570560);
+  p4 *= JPEG_FIX(-0.390180644);
+  terms.t3 = t3 + p1 + p4;
+  terms.t2 = t2 + p2 + p3;
+  terms.t1 = t1 + p2 + p4;
+  terms.t0 = t0 + p1 + p3;
+}
+
+/**
+ * \brief Limits the inputs and intermediate values of the IDCT so that it cannot overflow, whatever the coefficients.
+ * Valid images never come close to the limit.
+ */
+static inline int clamp_idct_value(const int value)
+{
+  return value > 32767 ? 32767 : (value < -32767 ? -32767 : value);
+}
+
+static inline unsigned char clamp_sample(const int value)
+{
+  if (static_cast<unsigned int>(value) > 255)
+    return value < 0 ? 0 : 255;
+  return static_cast<unsigned char>(value);
+}
+
+/**
+ * \brief Dequantizes a block and writes its 8x8 samples to output, with stride bytes between rows.
+ */
+static void idct_block(const short* block, const unsigned short* quant_table, unsigned char* output, const int stride)
+{
+  bool has_ac = false;
+  for (int index = 1; index < 64; index++)
+  {
+    if (block[index] != 0)
+    {
+      has_ac = true;
+      break;
+    }
+  }
+  if (!has_ac)
+  {
+    // Flat blocks are very common, and are just the rounded DC value
+    const unsigned char value = clamp_sample(((clamp_idct_value(block[0] * quant_table[0]) + 4) >> 3) + 128);
+    for (int row = 0; row < 8; row++)
+      memset(output + row * stride, value, 8);
+    return;
+  }
+
+  int values[64];
+  jpeg_idct_terms terms;
+  // Columns, keeping 2 extra bits of precision
+  for (int column = 0; column < 8; column++)
+  {
+    const short* in = block + column;
+    const unsigned short* q = quant_table + column;
+    int* out = values + column;
+    if (in[8] == 0 && in[16] == 0 && in[24] == 0 && in[32] == 0 && in[40] == 0 && in[48] == 0 && in[56] == 0)
+    {
+      const int dc = clamp_idct_value(in[0] * q[0] * 4);
+      for (int row = 0; row < 8; row++)
+        out[row * 8] = dc;
+      continue;
+    }
+    idct_1d(clamp_idct_value(in[0] * q[0]), clamp_idct_value(in[8] * q[8]), clamp_idct_value(in[16] * q[16]),
+            clamp_idct_value(in[24] * q[24]), clamp_idct_value(in[32] * q[32]), clamp_idct_value(in[40] * q[40]),
+            clamp_idct_value(in[48] * q[48]), clamp_idct_value(in[56] * q[56]), terms);
+    terms.x0 += 512;
+    terms.x1 += 512;
+    terms.x2 += 512;
+    terms.x3 += 512;
+    out[0] = clamp_idct_value((terms.x0 + terms.t3) >> 10);
+    out[56] = clamp_idct_value((terms.x0 - terms.t3) >> 10);
+    out[8] = clamp_idct_value((terms.x1 + terms.t2) >> 10);
+    out[48] = clamp_idct_value((terms.x1 - terms.t2) >> 10);
+    out[16] = clamp_idct_value((terms.x2 + terms.t1) >> 10);
+    out[40] = clamp_idct_value((terms.x2 - terms.t1) >> 10);
+    out[24] = clamp_idct_value((terms.x3 + terms.t0) >> 10);
+    out[32] = clamp_idct_value((terms.x3 - terms.t0) >> 10);
+  }
+  // Rows, removing the extra precision and the level shift
+  for (int row = 0; row < 8; row++)
+  {
+    const int* in = values + row * 8;
+    unsigned char* out = output + row * stride;
+    idct_1d(in[0], in[1], in[2], in[3], in[4], in[5], in[6], in[7], terms);
+    const int bias = 65536 + (128 << 17);
+    terms.x0 += bias;
+    terms.x1 += bias;
+    terms.x2 += bias;
+    terms.x3 += bias;
+    out[0] = clamp_sample((terms.x0 + terms.t3) >> 17);
+    out[7] = clamp_sample((terms.x0 - terms.t3) >> 17);
+    out[1] = clamp_sample((terms.x1 + terms.t2) >> 17);
+    out[6] = clamp_sample((terms.x1 - terms.t2) >> 17);
+    out[2] = clamp_sample((terms.x2 + terms.t1) >> 17);
+    out[5] = clamp_sample((terms.x2 - terms.t1) >> 17);
+    out[3] = clamp_sample((terms.x3 + terms.t0) >> 17);
+    out[4] = clamp_sample((terms.x3 - terms.t0) >> 17);
+  }
+}
+
+/**
+ * \brief The weights of the reduced IDCTs, which compute 4x4, 2x2 or 1x1 samples from the lowest frequencies of a
+ * block like the IJG library does when decoding at a reduced scale.  weights[size][x * size + u] is the weight of
+ * frequency u for sample x.
+ */
+struct jpeg_reduced_idct_tables
+{
+  jpeg_reduced_idct_tables()
+  {
+    const double pi = 3.14159265358979323846;
+    for (int size = 1; size <= 4; size *= 2)
+    {
+      for (int x = 0; x < size; x++)
+      {
+        for (int u = 0; u < size; u++)
+        {
+          const double scale = u == 0 ? 0.5 / sqrt(2.0) : 0.5;
+          weights[size][x * size + u] = static_cast<float>(scale * cos((2 * x + 1) * u * pi / (2 * size)));
+        }
+      }
+    }
+  }
+
+  float weights[5][16];
+};
+
+static const jpeg_reduced_idct_tables& get_reduced_idct_tables()
+{
+  static const jpeg_reduced_idct_tables tables;
+  return tables;
+}
+
+/**
+ * \brief Dequantizes the lowest size x size frequencies of a block and writes size x size samples to output.
+ */
+static void reduced_idct_block(const short* block, const unsigned short* quant_table, unsigned char* output,
+                               const int stride, const int size)
+{
+  if (size == 1)
+  {
+    output[0] = clamp_sample(((clamp_idct_value(block[0] * quant_table[0]) + 4) >> 3) + 128);
+    return;
+  }
+  const float* weights = get_reduced_idct_tables().weights[size];
+  float rows[16];
+  for (int v = 0; v < size; v++)
+  {
+    for (int x = 0; x < size; x++)
+    {
+      float sum = 0;
+      for (int u = 0; u < size; u++)
+        sum += weights[x * size + u] * static_cast<float>(block[v * 8 + u] * quant_table[v * 8 + u]);
+      rows[v * size + x] = sum;
+    }
+  }
+  for (int y = 0; y < size; y++)
+  {
+    for (int x = 0; x < size; x++)
+    {
+      float sum = 128.5f;
+      for (int v = 0; v < size; v++)
+        sum += weights[y * size + v] * rows[v * size + x];
+      output[y * stride + x] = sum <= 0 ? 0 : (sum >= 255 ? 255 : static_cast<unsigned char>(sum));
+    }
+  }
+}
+
+/**
+ * \brief Fixed point YCbCr to RGB tables, as defined by JFIF.
+ */
+struct jpeg_color_tables
+{
+  jpeg_color_tables()
+  {
+    for (int index = 0; index < 256; index++)
+    {
+      const int value = index - 128;
+      cr_red[index] = static_cast<int>(1.40200 * 65536 * value + 32768) >> 16;
+      cb_blue[index] = static_cast<int>(1.77200 * 65536 * value + 32768) >> 16;
+      cr_green[index] = static_cast<int>(-0.71414 * 65536 * value);
+      cb_green[index] = static_cast<int>(-0.34414 * 65536 * value) + 32768;
+    }
+  }
+
+  int cr_red[256];
+  int cb_blue[256];
+  int cr_green[256];
+  int cb_green[256];
+};
+
+static const jpeg_color_tables& get_color_tables()
+{
+  static const jpeg_color_tables tables;
+  return tables;
+}
+#pragma endregion
+
+jpeg_image::jpeg_image()
+{
+  width_ = 0;
+  height_ = 0;
+  num_components_ = 0;
+  memset(quant_tables_, 0, sizeof(quant_tables_));
+  restart_interval_ = 0;
+  max_h_samp_ = 1;
+  max_v_samp_ = 1;
+  mcus_wide_ = 0;
+  mcus_high_ = 0;
+  has_frame_ = false;
+  has_adobe_marker_ = false;
+  adobe_transform_ = 0;
+}
+
+int jpeg_image::get_width() const
+{
+  return width_;
+}
+
+int jpeg_image::get_height() const
+{
+  return height_;
+}
+
+int jpeg_image::get_scaled_width(const int scale) const
+{
+  return (width_ + scale - 1) / scale;
+}
+
+int jpeg_image::get_scaled_height(const int scale) const
+{
+  return (height_ + scale - 1) / scale;
+}
+
+int jpeg_image::get_num_components() const
+{
+  return num_components_;
+}
+
+const std::string& jpeg_image::get_error() const
+{
+  return error_;
+}
+
+bool jpeg_image::set_error(const std::string& error)
+{
+  error_ = error;
+  return false;
+}
+
+bool jpeg_image::read_file(const std::string& file_path, const bool header_only)
+{
+  FILE* file = fopen(file_path.c_str(), "rb");
+  if (file == NULL)
+    return set_error("Unable to open the file.");
+  std::vector<unsigned char> data;
+  bool is_partial = false;
+  if (fseek(file, 0, SEEK_END) == 0)
+  {
+    const long size = ftell(file);
+    fseek(file, 0, SEEK_SET);
+    if (size > 0)
+    {
+      is_partial = header_only && size > JPEG_HEADER_READ_SIZE;
+      data.resize(is_partial ? JPEG_HEADER_READ_SIZE : static_cast<size_t>(size));
+      data.resize(fread(&data[0], 1, data.size(), file));
+    }
+  }
+  fclose(file);
+  if (data.empty())
+    return set_error("The file is empty.");
+  if (read(&data[0], data.size(), header_only))
+    return true;
+  if (is_partial && !has_frame_)
+    return read_file(file_path, false);
+  return false;
+}
+
+bool jpeg_image::read(const unsigned char* data, const size_t size, const bool header_only)
+{
+  width_ = 0;
+  height_ = 0;
+  num_components_ = 0;
+  restart_interval_ = 0;
+  has_frame_ = false;
+  has_adobe_marker_ = false;
+  adobe_transform_ = 0;
+  error_.clear();
+  for (int index = 0; index < JPEG_NUM_TABLES; index++)
+  {
+    dc_tables_[index].is_defined = false;
+    ac_tables_[index].is_defined = false;
+  }
+
+  if (size < 4 || data[0] != 0xFF || data[1] != 0xD8)
+    return set_error("The file is not a JPEG.");
+
+  size_t position = 2;
+  bool has_scan = false;
+  while (true)
+  {
+    // Find the next marker, skipping any fill bytes
+    while (position < size && data[position] != 0xFF)
+      position++;
+    while (position < size && data[position] == 0xFF)
+      position++;
+    if (position >= size)
+      break;
+    const unsigned char marker = data[position++];
+    if (marker == 0xD9)
+      break;
+    if (marker == 0x00 || marker == 0x01 || (marker >= 0xD0 && marker <= 0xD7))
+      // Stuffed bytes and markers without a segment
+      continue;
+    if (position + 2 > size)
+      return set_error("A marker segment is truncated.");
+    const int length = (data[position] << 8) | data[position + 1];
+    if (length < 2 || position + length > size)
+      return set_error("A marker segment is truncated.");
+    const unsigned char* segment = data + position + 2;
+    const int segment_length = length - 2;
+    position += length;
+
+    switch (marker)
+    {
+    case 0xC0:
+    case 0xC1:
+      if (has_frame_)
+        return set_error("The JPEG has more than one frame.");
+      if (!read_frame_header(segment, segment_length))
+        return false;
+      if (header_only)
+        return true;
+      for (int index = 0; index < num_components_; index++)
+      {
+        jpeg_component& component = components_[index];
+        component.coefficients.assign(static_cast<size_t>(component.blocks_wide) * component.blocks_high * 64, 0);
+      }
+      break;
+    case 0xC2:
+    case 0xC6:
+    case 0xCA:
+    case 0xCE:
+      return set_error("Progressive JPEGs are not supported.");
+    case 0xC3:
+    case 0xC5:
+    case 0xC7:
+    case 0xC9:
+    case 0xCB:
+    case 0xCD:
+    case 0xCF:
+      return set_error("Lossless, hierarchical and arithmetic coded JPEGs are not supported.");
+    case 0xC4:
+      if (!read_huffman_tables(segment, segment_length))
+        return false;
+      break;
+    case 0xDB:
+      if (!read_quant_tables(segment, segment_length))
+        return false;
+      break;
+    case 0xDD:
+      if (segment_length < 2)
+        return set_error("The restart interval is truncated.");
+      restart_interval_ = (segment[0] << 8) | segment[1];
+      break;
+    case 0xDA:
+      if (!has_frame_)
+        return set_error("A scan appears before the frame header.");
+      // The scan moves the position past its entropy coded segment
+      if (!read_scan(segment, segment_length, data, size, position))
+        return false;
+      has_scan = true;
+      break;
+    case 0xEE:
+      if (segment_length >= 12 && memcmp(segment, "Adobe", 5) == 0)
+      {
+        has_adobe_marker_ = true;
+        adobe_transform_ = segment[11];
+      }
+      break;
+    default:
+      // Application data and comments
+      break;
+    }
+  }
+  if (!has_frame_)
+    return set_error("The JPEG has no frame header.");
+  if (!has_scan)
+    return set_error("The JPEG has no image data.");
+  return true;
+}
+
+bool jpeg_image::read_frame_header(const unsigned char* segment, const int length)
+{
+  if (length < 6)
+    return set_error("The frame header is truncated.");
+  if (segment[0] != 8)
+    return set_error("Only 8 bit JPEGs are supported.");
+  height_ = (segment[1] << 8) | segment[2];
+  width_ = (segment[3] << 8) | segment[4];
+  num_components_ = segment[5];
+  if (width_ == 0 || height_ == 0)
+    return set_error("The JPEG has no size.");
+  if (static_cast<long long>(width_) * height_ > JPEG_MAX_PIXELS)
+    return set_error("The JPEG is too large.");
+  if (num_components_ != 1 && num_components_ != 3)
+    return set_error("Only grayscale and three component JPEGs are supported.");
+  if (length < 6 + num_components_ * 3)
+    return set_error("The frame header is truncated.");
+
+  max_h_samp_ = 1;
+  max_v_samp_ = 1;
+  for (int index = 0; index < num_components_; index++)
+  {
+    jpeg_component& component = components_[index];
+    const unsigned char* info = segment + 6 + index * 3;
+    component.id = info[0];
+    component.h_samp = info[1] >> 4;
+    component.v_samp = info[1] & 15;
+    component.quant_table = info[2];
+    if (component.h_samp < 1 || component.h_samp > 4 || component.v_samp < 1 || component.v_samp > 4)
+      return set_error("The JPEG has invalid sampling factors.");
+    if (component.quant_table >= JPEG_NUM_TABLES)
+      return set_error("The JPEG has an invalid quantization table.");
+    if (component.h_samp > max_h_samp_)
+      max_h_samp_ = component.h_samp;
+    if (component.v_samp > max_v_samp_)
+      max_v_samp_ = component.v_samp;
+  }
+  if (num_components_ == 1)
+  {
+    // A single component is never interleaved, so its sampling factors don't matter
+    components_[0].h_samp = 1;
+    components_[0].v_samp = 1;
+    max_h_samp_ = 1;
+    max_v_samp_ = 1;
+  }
+  mcus_wide_ = (width_ + 8 * max_h_samp_ - 1) / (8 * max_h_samp_);
+  mcus_high_ = (height_ + 8 * max_v_samp_ - 1) / (8 * max_v_samp_);
+  for (int index = 0; index < num_components_; index++)
+  {
+    jpeg_component& component = components_[index];
+    component.width = (width_ * component.h_samp + max_h_samp_ - 1) / max_h_samp_;
+    component.height = (height_ * component.v_samp + max_v_samp_ - 1) / max_v_samp_;
+    component.blocks_wide = mcus_wide_ * component.h_samp;
+    component.blocks_high = mcus_high_ * component.v_samp;
+  }
+  has_frame_ = true;
+  return true;
+}
+
+bool jpeg_image::read_quant_tables(const unsigned char* segment, int length)
+{
+  while (length > 0)
+  {
+    const int precision = segment[0] >> 4;
+    const int table = segment[0] & 15;
+    const int table_length = precision ? 129 : 65;
+    if (table >= JPEG_NUM_TABLES || precision > 1)
+      return set_error("The JPEG has an invalid quantization table.");
+    if (length < table_length)
+      return set_error("A quantization table is truncated.");
+    for (int k = 0; k < 64; k++)
+    {
+      quant_tables_[table][jpeg_natural_order[k]] = static_cast<unsigned short>(
+        precision ? (segment[1 + k * 2] << 8) | segment[2 + k * 2] : segment[1 + k]
+      );
+    }
+    segment += table_length;
+    length -= table_length;
+  }
+  return true;
+}
+
+bool jpeg_image::read_huffman_tables(const unsigned char* segment, int length)
+{
+  while (length > 0)
+  {
+    if (length < 17)
+      return set_error("A huffman table is truncated.");
+    const int table_class = segment[0] >> 4;
+    const int table = segment[0] & 15;
+    if (table_class > 1 || table >= JPEG_NUM_TABLES)
+      return set_error("The JPEG has an invalid huffman table.");
+    int num_symbols = 0;
+    for (int index = 0; index < 16; index++)
+      num_symbols += segment[1 + index];
+    if (num_symbols > 256 || length < 17 + num_symbols)
+      return set_error("A huffman table is truncated.");
+    jpeg_huffman_table& huffman_table = table_class ? ac_tables_[table] : dc_tables_[table];
+    if (!huffman_table.build(segment + 1, segment + 17, num_symbols))
+      return set_error("The JPEG has an invalid huffman table.");
+    segment += 17 + num_symbols;
+    length -= 17 + num_symbols;
+  }
+  return true;
+}
+
+bool jpeg_image::read_scan(const unsigned char* segment, const int length, const unsigned char* data,
+                           const size_t size, size_t& position)
+{
+  if (length < 1)
+    return set_error("The scan header is truncated.");
+  const int num_scan_components = segment[0];
+  if (num_scan_components < 1 || num_scan_components > num_components_ || length < 4 + num_scan_components * 2)
+    return set_error("The scan header is invalid.");
+  jpeg_component* scan_components[JPEG_MAX_COMPONENTS];
+  int scan_indexes[JPEG_MAX_COMPONENTS];
+  for (int scan_index = 0; scan_index < num_scan_components; scan_index++)
+  {
+    const int id = segment[1 + scan_index * 2];
+    const int tables = segment[2 + scan_index * 2];
+    scan_components[scan_index] = NULL;
+    for (int index = 0; index < num_components_; index++)
+    {
+      if (components_[index].id == id)
+      {
+        scan_components[scan_index] = &components_[index];
+        scan_indexes[scan_index] = index;
+      }
+    }
+    jpeg_component* component = scan_components[scan_index];
+    if (component == NULL)
+      return set_error("A scan references an unknown component.");
+    component->dc_table = tables >> 4;
+    component->ac_table = tables & 15;
+    if (
+      component->dc_table >= JPEG_NUM_TABLES || component->ac_table >= JPEG_NUM_TABLES ||
+      !dc_tables_[component->dc_table].is_defined || !ac_tables_[component->ac_table].is_defined
+    )
+      return set_error("A scan references an undefined huffman table.");
+  }
+  const unsigned char* spectral = segment + 1 + num_scan_components * 2;
+  if (spectral[0] != 0 || spectral[1] != 63 || spectral[2] != 0)
+    return set_error("Only baseline scans are supported.");
+
+  jpeg_bit_reader reader(data, size, position);
+  int dc_predictions[JPEG_MAX_COMPONENTS] = {0};
+  int mcu_count = 0;
+  bool is_valid = true;
+  if (num_scan_components == 1)
+  {
+    // A non-interleaved scan has one block per MCU, and covers only the blocks inside the component
+    jpeg_component& component = *scan_components[0];
+    const jpeg_huffman_table& dc_table = dc_tables_[component.dc_table];
+    const jpeg_huffman_table& ac_table = ac_tables_[component.ac_table];
+    const int blocks_wide = (component.width + 7) / 8;
+    const int blocks_high = (component.height + 7) / 8;
+    for (int block_y = 0; block_y < blocks_high && is_valid; block_y++)
+    {
+      for (int block_x = 0; block_x < blocks_wide && is_valid; block_x++)
+      {
+        if (restart_interval_ > 0 && mcu_count > 0 && mcu_count % restart_interval_ == 0)
+        {
+          reader.restart();
+          dc_predictions[0] = 0;
+        }
+        short* block = &component.coefficients[(static_cast<size_t>(block_y) * component.blocks_wide + block_x) * 64];
+        is_valid = decode_block(reader, dc_table, ac_table, block, dc_predictions[0]);
+        mcu_count++;
+      }
+    }
+  }
+  else
+  {
+    for (int mcu_y = 0; mcu_y < mcus_high_ && is_valid; mcu_y++)
+    {
+      for (int mcu_x = 0; mcu_x < mcus_wide_ && is_valid; mcu_x++)
+      {
+        if (restart_interval_ > 0 && mcu_count > 0 && mcu_count % restart_interval_ == 0)
+        {
+          reader.restart();
+          for (int index = 0; index < JPEG_MAX_COMPONENTS; index++)
+            dc_predictions[index] = 0;
+        }
+        for (int scan_index = 0; scan_index < num_scan_components && is_valid; scan_index++)
+        {
+          jpeg_component& component = *scan_components[scan_index];
+          const jpeg_huffman_table& dc_table = dc_tables_[component.dc_table];
+          const jpeg_huffman_table& ac_table = ac_tables_[component.ac_table];
+          for (int v = 0; v < component.v_samp && is_valid; v++)
+          {
+            const size_t block_y = static_cast<size_t>(mcu_y) * component.v_samp + v;
+            for (int h = 0; h < component.h_samp && is_valid; h++)
+            {
+              const size_t block_x = static_cast<size_t>(mcu_x) * component.h_samp + h;
+              short* block = &component.coefficients[(block_y * component.blocks_wide + block_x) * 64];
+              is_valid = decode_block(reader, dc_table, ac_table, block, dc_predictions[scan_indexes[scan_index]]);
+            }
+          }
+        }
+        mcu_count++;
+      }
+    }
+  }
+  position = reader.position;
+  if (!is_valid)
+    return set_error("The JPEG's image data is corrupt.");
+  return true;
+}
+
+bool jpeg_image::is_rgb() const
+{
+  if (num_components_ != 3)
+    return false;
+  if (has_adobe_marker_)
+    return adobe_transform_ == 0;
+  return components_[0].id == 'R' && components_[1].id == 'G' && components_[2].id == 'B';
+}
+
+void jpeg_image::decode_plane(const jpeg_component& component, const int scale, std::vector<unsigned char>& plane) const
+{
+  const int block_size = 8 / scale;
+  const int stride = component.blocks_wide * block_size;
+  plane.resize(static_cast<size_t>(stride) * component.blocks_high * block_size);
+  const unsigned short* quant_table = quant_tables_[component.quant_table];
+  // Only the blocks covering the image are needed
+  const int blocks_wide = (component.width + 7) / 8;
+  const int blocks_high = (component.height + 7) / 8;
+  for (int block_y = 0; block_y < blocks_high; block_y++)
+  {
+    for (int block_x = 0; block_x < blocks_wide; block_x++)
+    {
+      const short* block = &component.coefficients[(static_cast<size_t>(block_y) * component.blocks_wide + block_x) *
+        64];
+      unsigned char* output = &plane[static_cast<size_t>(block_y) * block_size * stride + block_x * block_size];
+      if (scale == 1)
+        idct_block(block, quant_table, output, stride);
+      else
+        reduced_idct_block(block, quant_table, output, stride, block_size);
+    }
+  }
+}
+
+/**
+ * \brief Upsamples a plane that is subsampled 2:1 horizontally and optionally vertically using the triangle filter of
+ * the IJG library's 'fancy' upsampling.  The output has 2 * width columns and 2 * height (or height) rows.
+ */
+static void upsample_fancy(const unsigned char* input, const int input_stride, const int width, const int height,
+                           const bool is_vertical, unsigned char* output, const int output_stride,
+                           const int output_height)
+{
+  for (int y = 0; y < output_height; y++)
+  {
+    unsigned char* out = output + static_cast<size_t>(y) * output_stride;
+    if (!is_vertical)
+    {
+      const unsigned char* in = input + static_cast<size_t>(y) * input_stride;
+      if (width == 1)
+      {
+        out[0] = out[1] = in[0];
+        continue;
+      }
+      out[0] = in[0];
+      out[1] = static_cast<unsigned char>((in[0] * 3 + in[1] + 2) >> 2);
+      for (int x = 1; x < width - 1; x++)
+      {
+        out[x * 2] = static_cast<unsigned char>((in[x] * 3 + in[x - 1] + 1) >> 2);
+        out[x * 2 + 1] = static_cast<unsigned char>((in[x] * 3 + in[x + 1] + 2) >> 2);
+      }
+      out[width * 2 - 2] = static_cast<unsigned char>((in[width - 1] * 3 + in[width - 2] + 1) >> 2);
+      out[width * 2 - 1] = in[width - 1];
+      continue;
+    }
+    // Each output row is weighted 3:1 between its input row and the nearest other input row
+    const int row = y / 2;
+    int neighbor_row = (y & 1) ? row + 1 : row - 1;
+    if (neighbor_row < 0)
+      neighbor_row = 0;
+    else if (neighbor_row >= height)
+      neighbor_row = height - 1;
+    const unsigned char* in = input + static_cast<size_t>(row) * input_stride;
+    const unsigned char* neighbor = input + static_cast<size_t>(neighbor_row) * input_stride;
+    int this_sum = in[0] * 3 + neighbor[0];
+    if (width == 1)
+    {
+      out[0] = static_cast<unsigned char>((this_sum * 4 + 8) >> 4);
+      out[1] = static_cast<unsigned char>((this_sum * 4 + 7) >> 4);
+      continue;
+    }
+    int next_sum = in[1] * 3 + neighbor[1];
+    out[0] = static_cast<unsigned char>((this_sum * 4 + 8) >> 4);
+    out[1] = static_cast<unsigned char>((this_sum * 3 + next_sum + 7) >> 4);
+    int last_sum = this_sum;
+    this_sum = next_sum;
+    for (int x = 1; x < width - 1; x++)
+    {
+      next_sum = in[x + 1] * 3 + neighbor[x + 1];
+      out[x * 2] = static_cast<unsigned char>((this_sum * 3 + last_sum + 8) >> 4);
+      out[x * 2 + 1] = static_cast<unsigned char>((this_sum * 3 + next_sum + 7) >> 4);
+      last_sum = this_sum;
+      this_sum = next_sum;
+    }
+    out[width * 2 - 2] = static_cast<unsigned char>((this_sum * 3 + last_sum + 8) >> 4);
+    out[width * 2 - 1] = static_cast<unsigned char>((this_sum * 4 + 7) >> 4);
+  }
+}
+
+bool jpeg_image::to_rgb(std::vector<unsigned char>& pixels, const int scale) const
+{
+  if (!has_frame_ || components_[0].coefficients.empty())
+    return false;
+  if (scale != 1 && scale != 2 && scale != 4 && scale != 8)
+    return false;
+  const int width = get_scaled_width(scale);
+  const int height = get_scaled_height(scale);
+  pixels.resize(static_cast<size_t>(width) * height * 3);
+  std::vector<unsigned char> planes[JPEG_MAX_COMPONENTS];
+  int strides[JPEG_MAX_COMPONENTS];
+  std::vector<unsigned char> subsampled_plane;
+  for (int index = 0; index < num_components_; index++)
+  {
+    const jpeg_component& component = components_[index];
+    if (component.h_samp == max_h_samp_ && component.v_samp == max_v_samp_)
+    {
+      decode_plane(component, scale, planes[index]);
+      strides[index] = component.blocks_wide * 8 / scale;
+      continue;
+    }
+    // Bring subsampled components up to the full resolution
+    decode_plane(component, scale, subsampled_plane);
+    const int input_stride = component.blocks_wide * 8 / scale;
+    const int component_width = (component.width + scale - 1) / scale;
+    const int component_height = (component.height + scale - 1) / scale;
+    const int h_ratio = max_h_samp_ / component.h_samp;
+    const int v_ratio = max_v_samp_ / component.v_samp;
+    // Like the IJG library, very narrow components are replicated
+    if (
+      h_ratio == 2 && (v_ratio == 1 || v_ratio == 2) && component_width > 2 &&
+      max_h_samp_ % component.h_samp == 0 && max_v_samp_ % component.v_samp == 0
+    )
+    {
+      strides[index] = component_width * 2;
+      planes[index].resize(static_cast<size_t>(strides[index]) * height);
+      upsample_fancy(&subsampled_plane[0], input_stride, component_width, component_height, v_ratio == 2,
+                     &planes[index][0], strides[index], height);
+      continue;
+    }
+    // Any other sampling is replicated
+    strides[index] = width;
+    planes[index].resize(static_cast<size_t>(width) * height);
+    std::vector<int> columns(width);
+    for (int x = 0; x < width; x++)
+      columns[x] = x * component.h_samp / max_h_samp_;
+    for (int y = 0; y < height; y++)
+    {
+      const unsigned char* in = &subsampled_plane[static_cast<size_t>(y * component.v_samp / max_v_samp_) *
+        input_stride];
+      unsigned char* out = &planes[index][static_cast<size_t>(y) * width];
+      for (int x = 0; x < width; x++)
+        out[x] = in[columns[x]];
+    }
+  }
+
+  if (num_components_ == 1)
+  {
+    for (int y = 0; y < height; y++)
+    {
+      const unsigned char* in = &planes[0][static_cast<size_t>(y) * strides[0]];
+      unsigned char* out = &pixels[static_cast<size_t>(y) * width * 3];
+      for (int x = 0; x < width; x++, out += 3)
+        out[0] = out[1] = out[2] = in[x];
+    }
+    return true;
+  }
+
+  const jpeg_color_tables& tables = get_color_tables();
+  const bool rgb = is_rgb();
+  for (int y = 0; y < height; y++)
+  {
+    const unsigned char* in_0 = &planes[0][static_cast<size_t>(y) * strides[0]];
+    const unsigned char* in_1 = &planes[1][static_cast<size_t>(y) * strides[1]];
+    const unsigned char* in_2 = &planes[2][static_cast<size_t>(y) * strides[2]];
+    unsigned char* out = &pixels[static_cast<size_t>(y) * width * 3];
+    if (rgb)
+    {
+      for (int x = 0; x < width; x++, out += 3)
+      {
+        out[0] = in_0[x];
+        out[1] = in_1[x];
+        out[2] = in_2[x];
+      }
+      continue;
+    }
+    for (int x = 0; x < width; x++, out += 3)
+    {
+      const int luma = in_0[x];
+      const int cb = in_1[x];
+      const int cr = in_2[x];
+      out[0] = clamp_sample(luma + tables.cr_red[cr]);
+      out[1] = clamp_sample(luma + ((tables.cb_green[cb] + tables.cr_green[cr]) >> 16));
+      out[2] = clamp_sample(luma + tables.cb_blue[cb]);
+    }
+  }
+  return true;
+}
+
+bool jpeg_image::to_luma(std::vector<unsigned char>& pixels, const int scale) const
+{
+  if (!has_frame_ || components_[0].coefficients.empty())
+    return false;
+  if (scale != 1 && scale != 2 && scale != 4 && scale != 8)
+    return false;
+  const int width = get_scaled_width(scale);
+  const int height = get_scaled_height(scale);
+  const jpeg_component& component = components_[0];
+  if (is_rgb() || component.h_samp != max_h_samp_ || component.v_samp != max_v_samp_)
+  {
+    // The first component isn't the full resolution brightness, so convert from RGB
+    std::vector<unsigned char> rgb;
+    if (!to_rgb(rgb, scale))
+      return false;
+    pixels.resize(static_cast<size_t>(width) * height);
+    for (size_t index = 0; index < pixels.size(); index++)
+    {
+      const unsigned char* pixel = &rgb[index * 3];
+      pixels[index] = static_cast<unsigned char>((pixel[0] * 77 + pixel[1] * 150 + pixel[2] * 29 + 128) >> 8);
+    }
+    return true;
+  }
+  std::vector<unsigned char> plane;
+  decode_plane(component, scale, plane);
+  const int stride = component.blocks_wide * 8 / scale;
+  pixels.resize(static_cast<size_t>(width) * height);
+  for (int y = 0; y < height; y++)
+    memcpy(&pixels[static_cast<size_t>(y) * width], &plane[static_cast<size_t>(y) * stride], width);
+  return true;
+}
+
+#pragma region Lossless transforms
+bool jpeg_image::can_mirror(const bool is_horizontal) const
+{
+  if (is_horizontal)
+    return width_ % (8 * max_h_samp_) == 0;
+  return height_ % (8 * max_v_samp_) == 0;
+}
+
+void jpeg_image::mirror(const bool is_horizontal)
+{
+  for (int index = 0; index < num_components_; index++)
+  {
+    jpeg_component& component = components_[index];
+    std::vector<short> mirrored(component.coefficients.size());
+    for (int block_y = 0; block_y < component.blocks_high; block_y++)
+    {
+      for (int block_x = 0; block_x < component.blocks_wide; block_x++)
+      {
+        const int target_x = is_horizontal ? component.blocks_wide - 1 - block_x : block_x;
+        const int target_y = is_horizontal ? block_y : component.blocks_high - 1 - block_y;
+        const short* in = &component.coefficients[(static_cast<size_t>(block_y) * component.blocks_wide + block_x) *
+          64];
+        short* out = &mirrored[(static_cast<size_t>(target_y) * component.blocks_wide + target_x) * 64];
+        // Mirroring a block negates its odd frequencies in that direction
+        for (int k = 0; k < 64; k++)
+        {
+          const bool is_odd = ((is_horizontal ? k : k >> 3) & 1) != 0;
+          out[k] = is_odd ? static_cast<short>(-in[k]) : in[k];
+        }
+      }
+    }
+    component.coefficients.swap(mirrored);
+  }
+}
+
+void jpeg_image::transpose()
+{
+  for (int index = 0; index < num_components_; index++)
+  {
+    jpeg_component& component = components_[index];
+    std::vector<short> transposed(component.coefficients.size());
+    for (int block_y = 0; block_y < component.blocks_high; block_y++)
+    {
+      for (int block_x = 0; block_x < component.blocks_wide; block_x++)
+      {
+        const short* in = &component.coefficients[(static_cast<size_t>(block_y) * component.blocks_wide + block_x) *
+          64];
+        short* out = &transposed[(static_cast<size_t>(block_x) * component.blocks_high + block_y) * 64];
+        for (int v = 0; v < 8; v++)
+        {
+          for (int u = 0; u < 8; u++)
+            out[u * 8 + v] = in[v * 8 + u];
+        }
+      }
+    }
+    component.coefficients.swap(transposed);
+    std::swap(component.width, component.height);
+    std::swap(component.h_samp, component.v_samp);
+    std::swap(component.blocks_wide, component.blocks_high);
+  }
+  for (int table = 0; table < JPEG_NUM_TABLES; table++)
+  {
+    for (int v = 0; v < 8; v++)
+    {
+      for (int u = v + 1; u < 8; u++)
+        std::swap(quant_tables_[table][v * 8 + u], quant_tables_[table][u * 8 + v]);
+    }
+  }
+  std::swap(width_, height_);
+  std::swap(max_h_samp_, max_v_samp_);
+  std::swap(mcus_wide_, mcus_high_);
+}
+
+bool jpeg_image::transform(const jpeg_transform transform)
+{
+  if (!has_frame_ || components_[0].coefficients.empty())
+    return set_error("The JPEG has not been read.");
+  // Check the edges before changing anything so that a failed transform leaves the image as it was
+  const bool mirrors_columns = transform == JPEG_TRANSFORM_FLIP_LEFT_RIGHT || transform == JPEG_TRANSFORM_ROTATE_90 ||
+    transform == JPEG_TRANSFORM_ROTATE_180;
+  const bool mirrors_rows = transform == JPEG_TRANSFORM_FLIP_TOP_BOTTOM || transform == JPEG_TRANSFORM_ROTATE_270 ||
+    transform == JPEG_TRANSFORM_ROTATE_180;
+  if (mirrors_columns && !can_mirror(true))
+    return set_error("The width of the JPEG is not a whole number of MCUs, so it cannot be transformed losslessly.");
+  if (mirrors_rows && !can_mirror(false))
+    return set_error("The height of the JPEG is not a whole number of MCUs, so it cannot be transformed losslessly.");
+
+  switch (transform)
+  {
+  case JPEG_TRANSFORM_NONE:
+    break;
+  case JPEG_TRANSFORM_FLIP_LEFT_RIGHT:
+    mirror(true);
+    break;
+  case JPEG_TRANSFORM_FLIP_TOP_BOTTOM:
+    mirror(false);
+    break;
+  case JPEG_TRANSFORM_ROTATE_90:
+    // The original columns become rows, and the left edge ends up at the bottom
+    transpose();
+    mirror(false);
+    break;
+  case JPEG_TRANSFORM_ROTATE_180:
+    mirror(true);
+    mirror(false);
+    break;
+  case JPEG_TRANSFORM_ROTATE_270:
+    transpose();
+    mirror(true);
+    break;
+  case JPEG_TRANSFORM_TRANSPOSE:
+    transpose();
+    break;
+  default:
+    return set_error("Unknown transform.");
+  }
+  return true;
+}
+#pragma endregion
+
+#pragma region Entropy encoding
+/**
+ * \brief Writes huffman codes and raw bits, stuffing a zero byte after every 0xFF.
+ */
+struct jpeg_bit_writer
+{
+  explicit jpeg_bit_writer(std::vector<unsigned char>& data) : data(data)
+  {
+    buffer = 0;
+    bits = 0;
+    position = data.size();
+  }
+
+  std::vector<unsigned char>& data;
+  unsigned long long buffer;
+  int bits;
+  size_t position;
+
+  /**
+   * \brief Makes room for at least size more bytes, which must be done before writing each block.
+   */
+  inline void reserve(const size_t size)
+  {
+    if (position + size > data.size())
+      data.resize((position + size) * 2);
+  }
+
+  inline void write(const unsigned int value, const int length)
+  {
+    buffer = (buffer << length) | (value & ((1u << length) - 1));
+    bits += length;
+    while (bits >= 8)
+    {
+      const unsigned char byte = static_cast<unsigned char>(buffer >> (bits - 8));
+      data[position++] = byte;
+      if (byte == 0xFF)
+        data[position++] = 0;
+      bits -= 8;
+    }
+  }
+
+  void flush()
+  {
+    reserve(2);
+    // Pad the final byte with ones
+    if (bits > 0)
+      write(0xFF, 8 - bits);
+    data.resize(position);
+  }
+};
+
+/**
+ * \brief Counts the symbols of a scan when writer is NULL, otherwise writes them.  Table 0 is used by the first
+ * (luma) component, and table 1 by the others.
+ */
+struct jpeg_entropy_encoder
+{
+  jpeg_entropy_encoder()
+  {
+    writer = NULL;
+    is_valid = true;
+    memset(dc_frequencies, 0, sizeof(dc_frequencies));
+    memset(ac_frequencies, 0, sizeof(ac_frequencies));
+    memset(dc_codes, 0, sizeof(dc_codes));
+    memset(ac_codes, 0, sizeof(ac_codes));
+    memset(dc_lengths, 0, sizeof(dc_lengths));
+    memset(ac_lengths, 0, sizeof(ac_lengths));
+  }
+
+  jpeg_bit_writer* writer;
+  // False if a coefficient is too large for a baseline JPEG, or if a table has no code for a symbol
+  bool is_valid;
+  long dc_frequencies[2][257];
+  long ac_frequencies[2][257];
+  unsigned short dc_codes[2][256];
+  unsigned short ac_codes[2][256];
+  unsigned char dc_lengths[2][256];
+  unsigned char ac_lengths[2][256];
+
+  /**
+   * \brief Writes a symbol followed by length extra bits from value.
+   */
+  inline void write(const bool is_dc, const int table, const int symbol, const int value, const int length)
+  {
+    if (writer == NULL)
+    {
+      if (is_dc)
+        dc_frequencies[table][symbol]++;
+      else
+        ac_frequencies[table][symbol]++;
+      return;
+    }
+    const int code_length = is_dc ? dc_lengths[table][symbol] : ac_lengths[table][symbol];
+    if (code_length == 0)
+    {
+      is_valid = false;
+      return;
+    }
+    const unsigned int code = is_dc ? dc_codes[table][symbol] : ac_codes[table][symbol];
+    writer->write((code << length) | (static_cast<unsigned int>(value) & ((1u << length) - 1)), code_length + length);
+  }
+};
+
+static inline int get_magnitude_category(int value)
+{
+  if (value < 0)
+    value = -value;
+  int category = 0;
+  while (value != 0)
+  {
+    category++;
+    value >>= 1;
+  }
+  return category;
+}
+
+/**
+ * \brief Returns the index of the lowest set bit of a non zero value, using a de Bruijn sequence.
+ */
+static inline int get_lowest_bit_index(const unsigned long long value)
+{
+  static const int bit_indexes[64] = {
+    0, 1, 48, 2, 57, 49, 28, 3, 61, 58, 50, 42, 38, 29, 17, 4,
+    62, 55, 59, 36, 53, 51, 43, 22, 45, 39, 33, 30, 24, 18, 12, 5,
+    63, 47, 56, 27, 60, 41, 37, 16, 54, 35, 52, 21, 44, 32, 23, 11,
+    46, 26, 40, 15, 34, 20, 31, 10, 25, 14, 19, 9, 13, 8, 7, 6
+  };
+  return bit_indexes[((value & (~value + 1)) * 0x03f79d71b4cb0a89ULL) >> 58];
+}
+
+static void encode_block(const short* block, int& previous_dc, const int table, jpeg_entropy_encoder& encoder)
+{
+  // A block is at most 64 codes of 27 bits, which byte stuffing could double
+  if (encoder.writer != NULL)
+    encoder.writer->reserve(512);
+  const int difference = block[0] - previous_dc;
+  previous_dc = block[0];
+  int category = get_magnitude_category(difference);
+  if (category > 11)
+  {
+    encoder.is_valid = false;
+    return;
+  }
+  // Negative values are sent as their one's complement
+  encoder.write(true, table, category, difference < 0 ? difference - 1 : difference, category);
+
+  // Most coefficients are zero, so only visit the others
+  short zigzag[64];
+  unsigned long long nonzero = 0;
+  for (int k = 1; k < 64; k++)
+  {
+    zigzag[k] = block[jpeg_natural_order[k]];
+    nonzero |= static_cast<unsigned long long>(zigzag[k] != 0) << k;
+  }
+  int previous_k = 0;
+  while (nonzero != 0)
+  {
+    const int k = get_lowest_bit_index(nonzero);
+    nonzero &= nonzero - 1;
+    int run = k - previous_k - 1;
+    previous_k = k;
+    while (run > 15)
+    {
+      encoder.write(false, table, 0xF0, 0, 0);
+      run -= 16;
+    }
+    const int value = zigzag[k];
+    category = get_magnitude_category(value);
+    if (category > 10)
+    {
+      encoder.is_valid = false;
+      return;
+    }
+    encoder.write(false, table, (run << 4) | category, value < 0 ? value - 1 : value, category);
+  }
+  if (previous_k < 63)
+    encoder.write(false, table, 0x00, 0, 0);
+}
+
+/**
+ * \brief Builds a length limited huffman table from symbol frequencies, following section K.2 of the JPEG standard
+ * as the IJG library does.  counts receives the number of codes of each length (1 to 16), symbols the symbols in
+ * code order.
+ */
+static int build_optimal_table(const long* symbol_frequencies, unsigned char* counts, unsigned char* symbols)
+{
+  long frequencies[257];
+  int code_sizes[257];
+  int others[257];
+  int bits[33];
+  memcpy(frequencies, symbol_frequencies, sizeof(frequencies));
+  memset(code_sizes, 0, sizeof(code_sizes));
+  memset(bits, 0, sizeof(bits));
+  for (int index = 0; index < 257; index++)
+    others[index] = -1;
+  // A reserved symbol guarantees that no code is all ones
+  frequencies[256] = 1;
+
+  while (true)
+  {
+    // Find the two least frequent symbols, preferring the larger symbol on ties
+    int c1 = -1;
+    long v = 1000000000L;
+    for (int index = 0; index < 257; index++)
+    {
+      if (frequencies[index] != 0 && frequencies[index] <= v)
+      {
+        v = frequencies[index];
+        c1 = index;
+      }
+    }
+    int c2 = -1;
+    v = 1000000000L;
+    for (int index = 0; index < 257; index++)
+    {
+      if (frequencies[index] != 0 && frequencies[index] <= v && index != c1)
+      {
+        v = frequencies[index];
+        c2 = index;
+      }
+    }
+    if (c2 < 0)
+      break;
+    frequencies[c1] += frequencies[c2];
+    frequencies[c2] = 0;
+    code_sizes[c1]++;
+    while (others[c1] >= 0)
+    {
+      c1 = others[c1];
+      code_sizes[c1]++;
+    }
+    others[c1] = c2;
+    code_sizes[c2]++;
+    while (others[c2] >= 0)
+    {
+      c2 = others[c2];
+      code_sizes[c2]++;
+    }
+  }
+
+  for (int index = 0; index < 257; index++)
+  {
+    if (code_sizes[index] != 0)
+      bits[code_sizes[index] > 32 ? 32 : code_sizes[index]]++;
+  }
+  // Move codes longer than 16 bits up the tree
+  for (int length = 32; length > 16; length--)
+  {
+    while (bits[length] > 0)
+    {
+      int shorter = length - 2;
+      while (bits[shorter] == 0)
+        shorter--;
+      bits[length] -= 2;
+      bits[length - 1]++;
+      bits[shorter + 1] += 2;
+      bits[shorter]--;
+    }
+  }
+  // Remove the reserved symbol's code, which is one of the longest
+  int longest = 16;
+  while (bits[longest] == 0)
+    longest--;
+  bits[longest]--;
+
+  for (int length = 1; length <= 16; length++)
+    counts[length - 1] = static_cast<unsigned char>(bits[length]);
+  int num_symbols = 0;
+  for (int length = 1; length <= 32; length++)
+  {
+    for (int symbol = 0; symbol < 256; symbol++)
+    {
+      if (code_sizes[symbol] == length)
+        symbols[num_symbols++] = static_cast<unsigned char>(symbol);
+    }
+  }
+  return num_symbols;
+}
+
+/**
+ * \brief Assigns the canonical code of each symbol in a table built by build_optimal_table.
+ */
+static void build_codes(const unsigned char* counts, const unsigned char* symbols, unsigned short* codes,
+                        unsigned char* lengths)
+{
+  unsigned int code = 0;
+  int symbol_index = 0;
+  for (int length = 1; length <= 16; length++)
+  {
+    for (int count = 0; count < counts[length - 1]; count++)
+    {
+      codes[symbols[symbol_index]] = static_cast<unsigned short>(code++);
+      lengths[symbols[symbol_index]] = static_cast<unsigned char>(length);
+      symbol_index++;
+    }
+    code <<= 1;
+  }
+}
+
+static void write_marker(std::vector<unsigned char>& data, const unsigned char marker, const int length)
+{
+  data.push_back(0xFF);
+  data.push_back(marker);
+  if (length > 0)
+  {
+    data.push_back(static_cast<unsigned char>(length >> 8));
+    data.push_back(static_cast<unsigned char>(length & 0xFF));
+  }
+}
+
+void jpeg_image::encode_scan(jpeg_entropy_encoder& encoder) const
+{
+  int previous_dc[JPEG_MAX_COMPONENTS] = {0, 0, 0};
+  if (num_components_ == 1)
+  {
+    // A single component scan is not interleaved, and only covers the blocks within the image
+    const jpeg_component& component = components_[0];
+    const int blocks_wide = (component.width + 7) / 8;
+    const int blocks_high = (component.height + 7) / 8;
+    for (int block_y = 0; block_y < blocks_high && encoder.is_valid; block_y++)
+    {
+      for (int block_x = 0; block_x < blocks_wide; block_x++)
+      {
+        encode_block(&component.coefficients[(static_cast<size_t>(block_y) * component.blocks_wide + block_x) * 64],
+                     previous_dc[0], 0, encoder);
+      }
+    }
+    return;
+  }
+  for (int mcu_y = 0; mcu_y < mcus_high_ && encoder.is_valid; mcu_y++)
+  {
+    for (int mcu_x = 0; mcu_x < mcus_wide_; mcu_x++)
+    {
+      for (int index = 0; index < num_components_; index++)
+      {
+        const jpeg_component& component = components_[index];
+        for (int v = 0; v < component.v_samp; v++)
+        {
+          const size_t row = static_cast<size_t>(mcu_y * component.v_samp + v) * component.blocks_wide;
+          for (int h = 0; h < component.h_samp; h++)
+          {
+            encode_block(&component.coefficients[(row + mcu_x * component.h_samp + h) * 64], previous_dc[index],
+                         index == 0 ? 0 : 1, encoder);
+          }
+        }
+      }
+    }
+  }
+}
+
+bool jpeg_image::write(std::vector<unsigned char>& data) const
+{
+  data.clear();
+  if (!has_frame_ || components_[0].coefficients.empty())
+    return false;
+  const int num_tables = num_components_ == 1 ? 1 : 2;
+  unsigned char dc_counts[2][16];
+  unsigned char ac_counts[2][16];
+  unsigned char dc_symbols[2][257];
+  unsigned char ac_symbols[2][257];
+  int num_dc_symbols[2];
+  int num_ac_symbols[2];
+  jpeg_entropy_encoder encoder;
+  // The entropy coded data is usually a bit smaller than the coefficients of the luma component
+  std::vector<unsigned char> scan;
+  scan.reserve(components_[0].coefficients.size() / 4);
+
+  // Flips don't change which symbols are used, and cameras usually use the standard tables, which have a code for
+  // every symbol, so the tables of the original image can usually be reused.  That saves a pass over the image.
+  bool can_reuse_tables = num_tables == 1 || (
+    components_[1].dc_table == components_[2].dc_table && components_[1].ac_table == components_[2].ac_table
+  );
+  for (int table = 0; table < num_tables && can_reuse_tables; table++)
+  {
+    const jpeg_huffman_table& dc_table = dc_tables_[components_[table].dc_table];
+    const jpeg_huffman_table& ac_table = ac_tables_[components_[table].ac_table];
+    can_reuse_tables = dc_table.is_defined && ac_table.is_defined;
+    if (!can_reuse_tables)
+      break;
+    memcpy(dc_counts[table], dc_table.counts, 16);
+    memcpy(ac_counts[table], ac_table.counts, 16);
+    num_dc_symbols[table] = dc_table.num_values;
+    num_ac_symbols[table] = ac_table.num_values;
+    memcpy(dc_symbols[table], dc_table.values, dc_table.num_values);
+    memcpy(ac_symbols[table], ac_table.values, ac_table.num_values);
+    build_codes(dc_counts[table], dc_symbols[table], encoder.dc_codes[table], encoder.dc_lengths[table]);
+    build_codes(ac_counts[table], ac_symbols[table], encoder.ac_codes[table], encoder.ac_lengths[table]);
+  }
+  if (can_reuse_tables)
+  {
+    jpeg_bit_writer writer(scan);
+    encoder.writer = &writer;
+    encode_scan(encoder);
+    writer.flush();
+  }
+  if (!can_reuse_tables || !encoder.is_valid)
+  {
+    // Gather the symbol statistics to build optimal tables
+    encoder = jpeg_entropy_encoder();
+    encode_scan(encoder);
+    if (!encoder.is_valid)
+      return false;
+    for (int table = 0; table < num_tables; table++)
+    {
+      num_dc_symbols[table] = build_optimal_table(encoder.dc_frequencies[table], dc_counts[table], dc_symbols[table]);
+      num_ac_symbols[table] = build_optimal_table(encoder.ac_frequencies[table], ac_counts[table], ac_symbols[table]);
+      build_codes(dc_counts[table], dc_symbols[table], encoder.dc_codes[table], encoder.dc_lengths[table]);
+      build_codes(ac_counts[table], ac_symbols[table], encoder.ac_codes[table], encoder.ac_lengths[table]);
+    }
+    scan.clear();
+    jpeg_bit_writer writer(scan);
+    encoder.writer = &writer;
+    encode_scan(encoder);
+    writer.flush();
+    if (!encoder.is_valid)
+      return false;
+  }
+
+  data.reserve(scan.size() + 1024);
+  write_marker(data, 0xD8, 0);
+  if (has_adobe_marker_)
+  {
+    static const unsigned char adobe[11] = {'A', 'd', 'o', 'b', 'e', 0, 100, 0, 0, 0, 0};
+    write_marker(data, 0xEE, 14);
+    data.insert(data.end(), adobe, adobe + 11);
+    data.push_back(static_cast<unsigned char>(adobe_transform_));
+  }
+  else if (!is_rgb())
+  {
+    static const unsigned char jfif[14] = {'J', 'F', 'I', 'F', 0, 1, 1, 0, 0, 1, 0, 1, 0, 0};
+    write_marker(data, 0xE0, 16);
+    data.insert(data.end(), jfif, jfif + 14);
+  }
+
+  // Quantization tables
+  bool is_table_written[JPEG_NUM_TABLES] = {false, false, false, false};
+  for (int index = 0; index < num_components_; index++)
+  {
+    const int table = components_[index].quant_table;
+    if (is_table_written[table])
+      continue;
+    is_table_written[table] = true;
+    bool is_16_bit = false;
+    for (int k = 0; k < 64; k++)
+      is_16_bit = is_16_bit || quant_tables_[table][k] > 255;
+    write_marker(data, 0xDB, is_16_bit ? 131 : 67);
+    data.push_back(static_cast<unsigned char>((is_16_bit ? 0x10 : 0) | table));
+    for (int k = 0; k < 64; k++)
+    {
+      const unsigned short value = quant_tables_[table][jpeg_natural_order[k]];
+      if (is_16_bit)
+        data.push_back(static_cast<unsigned char>(value >> 8));
+      data.push_back(static_cast<unsigned char>(value & 0xFF));
+    }
+  }
+
+  // Frame header
+  write_marker(data, 0xC0, 8 + num_components_ * 3);
+  data.push_back(8);
+  data.push_back(static_cast<unsigned char>(height_ >> 8));
+  data.push_back(static_cast<unsigned char>(height_ & 0xFF));
+  data.push_back(static_cast<unsigned char>(width_ >> 8));
+  data.push_back(static_cast<unsigned char>(width_ & 0xFF));
+  data.push_back(static_cast<unsigned char>(num_components_));
+  for (int index = 0; index < num_components_; index++)
+  {
+    const jpeg_component& component = components_[index];
+    data.push_back(static_cast<unsigned char>(component.id));
+    data.push_back(static_cast<unsigned char>((component.h_samp << 4) | component.v_samp));
+    data.push_back(static_cast<unsigned char>(component.quant_table));
+  }
+
+  // Huffman tables
+  for (int table = 0; table < num_tables; table++)
+  {
+    write_marker(data, 0xC4, 2 + 17 + num_dc_symbols[table] + 17 + num_ac_symbols[table]);
+    data.push_back(static_cast<unsigned char>(table));
+    data.insert(data.end(), dc_counts[table], dc_counts[table] + 16);
+    data.insert(data.end(), dc_symbols[table], dc_symbols[table] + num_dc_symbols[table]);
+    data.push_back(static_cast<unsigned char>(0x10 | table));
+    data.insert(data.end(), ac_counts[table], ac_counts[table] + 16);
+    data.insert(data.end(), ac_symbols[table], ac_symbols[table] + num_ac_symbols[table]);
+  }
+
+  // A single scan with every component
+  write_marker(data, 0xDA, 6 + num_components_ * 2);
+  data.push_back(static_cast<unsigned char>(num_components_));
+  for (int index = 0; index < num_components_; index++)
+  {
+    const int table = index == 0 ? 0 : 1;
+    data.push_back(static_cast<unsigned char>(components_[index].id));
+    data.push_back(static_cast<unsigned char>((table << 4) | table));
+  }
+  data.push_back(0);
+  data.push_back(63);
+  data.push_back(0);
+  data.insert(data.end(), scan.begin(), scan.end());
+  write_marker(data, 0xD9, 0);
+  return true;
+}
+
+bool jpeg_image::write_file(const std::string& file_path) const
+{
+  std::vector<unsigned char> data;
+  if (!write(data))
+    return false;
+  FILE* file = fopen(file_path.c_str(), "wb");
+  if (file == NULL)
+    return false;
+  const size_t written = fwrite(&data[0], 1, data.size(), file);
+  const bool is_closed = fclose(file) == 0;
+  return is_closed && written == data.size();
+}
+#pragma endregion
@@ -0,0 +1,161 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef JPEG_IMAGE_H
+#define JPEG_IMAGE_H
+#include <string>
+#include <vector>
+
+#define JPEG_MAX_COMPONENTS 3
+#define JPEG_NUM_TABLES 4
+
+/**
+ * \brief The lossless transforms, named after the PIL transpose methods they match.  The rotations are counter
+ * clockwise.
+ */
+enum jpeg_transform
+{
+  JPEG_TRANSFORM_NONE = 0,
+  JPEG_TRANSFORM_FLIP_LEFT_RIGHT = 1,
+  JPEG_TRANSFORM_FLIP_TOP_BOTTOM = 2,
+  JPEG_TRANSFORM_ROTATE_90 = 3,
+  JPEG_TRANSFORM_ROTATE_180 = 4,
+  JPEG_TRANSFORM_ROTATE_270 = 5,
+  JPEG_TRANSFORM_TRANSPOSE = 6
+};
+
+struct jpeg_component
+{
+  jpeg_component();
+  int id;
+  int h_samp;
+  int v_samp;
+  int quant_table;
+  // The entropy tables used by the current scan
+  int dc_table;
+  int ac_table;
+  // The size of the component in samples, before padding to whole blocks.
+  int width;
+  int height;
+  // The size of the component in blocks, padded to whole MCUs.
+  int blocks_wide;
+  int blocks_high;
+  // The quantized coefficients of each block in natural (not zigzag) order, 64 per block, one row of blocks after
+  // another.
+  std::vector<short> coefficients;
+};
+
+struct jpeg_entropy_encoder;
+
+struct jpeg_huffman_table
+{
+  jpeg_huffman_table();
+  bool is_defined;
+  // Indexed by the next 9 bits of the stream.  The high byte is the code length and the low byte the symbol, or 0
+  // if the code is longer than 9 bits.
+  unsigned short lookup[512];
+  // The first code of each length that is too large, left aligned to 16 bits.
+  unsigned int max_code[18];
+  // Added to a code of each length to get the index of its symbol.
+  int value_offset[17];
+  unsigned char values[256];
+  // The number of codes of each length, kept so that the table can be used to encode
+  unsigned char counts[16];
+  int num_values;
+  bool build(const unsigned char* counts, const unsigned char* symbols, int num_symbols);
+};
+
+/**
+ * \brief A baseline (sequential huffman) JPEG, decoded into its quantized DCT coefficients.  Progressive, arithmetic
+ * coded, 12 bit and CMYK images are not supported, and read returns false for them so that the caller can fall back
+ * to another decoder.
+ */
+class jpeg_image
+{
+public:
+  jpeg_image();
+  /**
+   * \brief Reads and entropy decodes a JPEG.  If header_only is true, reading stops at the frame header, which is
+   * enough to get the size and to know if the image is supported.
+   */
+  bool read(const unsigned char* data, size_t size, bool header_only = false);
+  bool read_file(const std::string& file_path, bool header_only = false);
+  /**
+   * \brief Converts the image to interleaved 8 bit RGB, get_scaled_width(scale) * get_scaled_height(scale) * 3 bytes.
+   * A scale of 2, 4 or 8 decodes a reduced image directly from the lowest frequencies of each block, which is much
+   * faster than decoding the full image and resizing it.
+   */
+  bool to_rgb(std::vector<unsigned char>& pixels, int scale = 1) const;
+  /**
+   * \brief Decodes only the brightness of the image, get_scaled_width(scale) * get_scaled_height(scale) bytes.  For
+   * YCbCr and grayscale images this skips the color components entirely.
+   */
+  bool to_luma(std::vector<unsigned char>& pixels, int scale = 1) const;
+  /**
+   * \brief Flips, rotates or transposes the coefficients without decoding them, so no quality is lost.  Mirroring an
+   * edge that is not a whole number of MCUs would require moving the partial MCU to the other side of the image, which
+   * JPEG cannot represent, so those transforms fail and leave the image unchanged.
+   */
+  bool transform(jpeg_transform transform);
+  /**
+   * \brief Writes the coefficients as a baseline JPEG.  The huffman tables of the original image are reused when they
+   * can code every symbol, otherwise optimized tables are built.
+   */
+  bool write(std::vector<unsigned char>& data) const;
+  bool write_file(const std::string& file_path) const;
+  int get_width() const;
+  int get_height() const;
+  int get_scaled_width(int scale) const;
+  int get_scaled_height(int scale) const;
+  int get_num_components() const;
+  const std::string& get_error() const;
+private:
+  int width_;
+  int height_;
+  int num_components_;
+  jpeg_component components_[JPEG_MAX_COMPONENTS];
+  // Quantization tables in natural order
+  unsigned short quant_tables_[JPEG_NUM_TABLES][64];
+  jpeg_huffman_table dc_tables_[JPEG_NUM_TABLES];
+  jpeg_huffman_table ac_tables_[JPEG_NUM_TABLES];
+  int restart_interval_;
+  int max_h_samp_;
+  int max_v_samp_;
+  int mcus_wide_;
+  int mcus_high_;
+  bool has_frame_;
+  bool has_adobe_marker_;
+  int adobe_transform_;
+  std::string error_;
+  bool set_error(const std::string& error);
+  bool read_frame_header(const unsigned char* segment, int length);
+  bool read_quant_tables(const unsigned char* segment, int length);
+  bool read_huffman_tables(const unsigned char* segment, int length);
+  bool read_scan(const unsigned char* segment, int length, const unsigned char* data, size_t size, size_t& position);
+  bool is_rgb() const;
+  void decode_plane(const jpeg_component& component, int scale, std::vector<unsigned char>& plane) const;
+  bool can_mirror(bool is_horizontal) const;
+  void mirror(bool is_horizontal);
+  void transpose();
+  void encode_scan(jpeg_entropy_encoder& encoder) const;
+};
+#endif
@@ -1,171 +1,156 @@
 // Todo:  Convert to C++
-#ifdef _DEBUG
-#undef _DEBUG
-#include <Python.h>
-#define _DEBUG
-#else
-#include <Python.h>
-#endif
 #include "logging.h"
 #include <string>
-#include "python_helpers.h"
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
 
-static bool octolapse_loggers_created = false;
-static bool check_log_levels_real_time = true;
-static PyObject* py_logging_module = NULL;
-static PyObject* py_logging_configurator_name = NULL;
-static PyObject* py_logging_configurator = NULL;
-static PyObject* py_octolapse_gcode_parser_logger = NULL;
-static long gcode_parser_log_level = 0;
-static PyObject* py_octolapse_gcode_position_logger = NULL;
-static long gcode_position_log_level = 0;
-static PyObject* py_octolapse_snapshot_plan_logger = NULL;
-static long snapshot_plan_log_level = 0;
-static PyObject* py_info_function_name = NULL;
-static PyObject* py_warn_function_name = NULL;
-static PyObject* py_error_function_name = NULL;
-static PyObject* py_debug_function_name = NULL;
-static PyObject* py_verbose_function_name = NULL;
-static PyObject* py_critical_function_name = NULL;
-static PyObject* py_get_effective_level_function_name = NULL;
+static octolapse_log_handler* p_log_handler = NULL;
+// The effective level of each logger, indexed by octolapse_log::octolapse_loggers.
+static std::atomic<int> log_levels[OCTOLAPSE_NUM_LOGGERS];
 
-void octolapse_initialize_loggers()
+void octolapse_set_log_handler(octolapse_log_handler* handler)
 {
-  // Create all of the objects necessary for logging
-  // Import the octolapse.log module
-  py_logging_module = PyImport_ImportModuleNoBlock("octoprint_octolapse.log");
-  if (py_logging_module == NULL)
-  {
-    PyErr_SetString(PyExc_ImportError, "Could not import module 'octolapse.log'.");
-    return;
-  }
+  octolapse_flush_log();
+  p_log_handler = handler;
+}
 
-  // Get the logging configurator attribute string
-  py_logging_configurator_name = PyObject_GetAttrString(py_logging_module, "LoggingConfigurator");
-  if (py_logging_configurator_name == NULL)
-  {
-    PyErr_SetString(PyExc_ImportError, "Could not acquire the LoggingConfigurator attribute string.");
+void octolapse_set_log_level(const int logger_type, const int log_level)
+{
+  if (logger_type < 0 || logger_type >= OCTOLAPSE_NUM_LOGGERS)
     return;
-  }
-
-  // Create a logging configurator
-  PyGILState_STATE gstate = PyGILState_Ensure();
-  py_logging_configurator = PyObject_CallObject(py_logging_configurator_name, NULL);
-  PyGILState_Release(gstate);
+  log_levels[logger_type].store(log_level, std::memory_order_relaxed);
+}
 
-  if (py_logging_configurator == NULL)
+#pragma region Log Buffer
+struct log_record
+{
+  int logger_type;
+  int log_level;
+  std::string message;
+};
+
+/**
+ * \brief A bounded, lock free, multiple producer queue of log records (see Dmitry Vyukov's bounded MPMC queue).
+ * Each cell's sequence number tells producers and the consumer whose turn it is to use the cell.
+ */
+class log_record_buffer
+{
+public:
+  log_record_buffer()
   {
-    PyErr_SetString(PyExc_ImportError, "Could not create a new instance of LoggingConfigurator.");
-    return;
+    for (size_t index = 0; index < OCTOLAPSE_LOG_BUFFER_SIZE; index++)
+      cells_[index].sequence.store(index, std::memory_order_relaxed);
+    enqueue_position_.store(0, std::memory_order_relaxed);
+    dequeue_position_.store(0, std::memory_order_relaxed);
   }
 
-  // Create the gcode_parser logging object
-  py_octolapse_gcode_parser_logger = PyObject_CallMethod(py_logging_configurator, (char*)"get_logger", (char *)"s",
-                                                         "octoprint_octolapse.gcode_parser");
-  if (py_octolapse_gcode_parser_logger == NULL)
+  bool try_push(const int logger_type, const int log_level, const std::string& message)
   {
-    PyErr_SetString(PyExc_ImportError, "Could not create the octolapse.gcode_parser child logger.");
-    return;
+    cell* p_cell;
+    size_t position = enqueue_position_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      p_cell = &cells_[position & mask];
+      const size_t sequence = p_cell->sequence.load(std::memory_order_acquire);
+      const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position);
+      if (difference == 0)
+      {
+        if (enqueue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (difference < 0)
+        return false;
+      else
+        position = enqueue_position_.load(std::memory_order_relaxed);
+    }
+    p_cell->record.logger_type = logger_type;
+    p_cell->record.log_level = log_level;
+    p_cell->record.message = message;
+    p_cell->sequence.store(position + 1, std::memory_order_release);
+    return true;
   }
 
-  // Create the gcode_position logging object
-  py_octolapse_gcode_position_logger = PyObject_CallMethod(py_logging_configurator, (char*)"get_logger", (char *)"s",
-                                                           "octoprint_octolapse.gcode_position");
-  if (py_octolapse_gcode_position_logger == NULL)
+  bool try_pop(log_record& record)
   {
-    PyErr_SetString(PyExc_ImportError, "Could not create the octolapse.gcode_position child logger.");
-    return;
+    cell* p_cell;
+    size_t position = dequeue_position_.load(std::memory_order_relaxed);
+    for (;;)
+    {
+      p_cell = &cells_[position & mask];
+      const size_t sequence = p_cell->sequence.load(std::memory_order_acquire);
+      const intptr_t difference = static_cast<intptr_t>(sequence) - static_cast<intptr_t>(position + 1);
+      if (difference == 0)
+      {
+        if (dequeue_position_.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+          break;
+      }
+      else if (difference < 0)
+        return false;
+      else
+        position = dequeue_position_.load(std::memory_order_relaxed);
+    }
+    record.logger_type = p_cell->record.logger_type;
+    record.log_level = p_cell->record.log_level;
+    record.message.swap(p_cell->record.message);
+    p_cell->sequence.store(position + mask + 1, std::memory_order_release);
+    return true;
   }
 
-  // Create the stabilization logging object
-  py_octolapse_snapshot_plan_logger = PyObject_CallMethod(py_logging_configurator, (char*)"get_logger", (char *)"s",
-                                                          "octoprint_octolapse.snapshot_plan");
-  if (py_octolapse_snapshot_plan_logger == NULL)
+  bool is_empty() const
   {
-    PyErr_SetString(PyExc_ImportError, "Could not create the octolapse.snapshot_plan child logger.");
-    return;
+    return dequeue_position_.load(std::memory_order_acquire) == enqueue_position_.load(std::memory_order_acquire);
   }
 
-  // create the function name py objects
-  py_info_function_name = PyString_SafeFromString("info");
-  py_warn_function_name = PyString_SafeFromString("warn");
-  py_error_function_name = PyString_SafeFromString("error");
-  py_debug_function_name = PyString_SafeFromString("debug");
-  py_verbose_function_name = PyString_SafeFromString("verbose");
-  py_critical_function_name = PyString_SafeFromString("critical");
-  py_get_effective_level_function_name = PyString_SafeFromString("getEffectiveLevel");
-  octolapse_loggers_created = true;
-}
-
-void set_internal_log_levels(bool check_real_time)
-{
-  check_log_levels_real_time = check_real_time;
-  if (!check_log_levels_real_time)
+private:
+  static const size_t mask = OCTOLAPSE_LOG_BUFFER_SIZE - 1;
+  struct cell
   {
-    PyObject* py_gcode_parser_log_level = PyObject_CallMethodObjArgs(py_octolapse_gcode_parser_logger,
-                                                                     py_get_effective_level_function_name, NULL);
-    if (py_gcode_parser_log_level == NULL)
-    {
-      PyErr_Print();
-      PyErr_SetString(PyExc_ValueError,
-                      "Logging.octolapse_log - Could not retrieve the log level for the gcode parser logger.");
-    }
-    gcode_parser_log_level = PyIntOrLong_AsLong(py_gcode_parser_log_level);
+    std::atomic<size_t> sequence;
+    log_record record;
+  };
+  cell cells_[OCTOLAPSE_LOG_BUFFER_SIZE];
+  std::atomic<size_t> enqueue_position_;
+  std::atomic<size_t> dequeue_position_;
+};
 
-    PyObject* py_gcode_position_log_level = PyObject_CallMethodObjArgs(py_octolapse_gcode_position_logger,
-                                                                       py_get_effective_level_function_name, NULL);
-    if (py_gcode_position_log_level == NULL)
-    {
-      PyErr_Print();
-      PyErr_SetString(PyExc_ValueError,
-                      "Logging.octolapse_log - Could not retrieve the log level for the gcode position logger.");
-    }
-    gcode_position_log_level = PyIntOrLong_AsLong(py_gcode_position_log_level);
-
-    PyObject* py_snapshot_plan_log_level = PyObject_CallMethodObjArgs(py_octolapse_snapshot_plan_logger,
-                                                                      py_get_effective_level_function_name, NULL);
-    if (py_snapshot_plan_log_level == NULL)
-    {
-      PyErr_Print();
-      PyErr_SetString(PyExc_ValueError,
-                      "Logging.octolapse_log - Could not retrieve the log level for the snapshot plan logger.");
-    }
-    snapshot_plan_log_level = PyIntOrLong_AsLong(py_snapshot_plan_log_level);
-
-    Py_XDECREF(py_gcode_parser_log_level);
-    Py_XDECREF(py_gcode_position_log_level);
-    Py_XDECREF(py_snapshot_plan_log_level);
-  }
-}
+static log_record_buffer log_buffer;
+// Only one thread may drain the buffer at a time
+static std::atomic_flag is_flushing_log = ATOMIC_FLAG_INIT;
+// The number of records discarded because the buffer was full and could not be flushed
+static std::atomic<long> dropped_log_records(0);
+#pragma endregion
 
 bool octolapse_may_be_logged(const int logger_type, const int log_level)
 {
-  int current_log_level;
-  switch (logger_type)
-  {
-  case octolapse_log::GCODE_PARSER:
-    current_log_level = gcode_parser_log_level;
-    break;
-  case octolapse_log::GCODE_POSITION:
-    current_log_level = gcode_position_log_level;
-    break;
-  case octolapse_log::SNAPSHOT_PLAN:
-    current_log_level = snapshot_plan_log_level;
-    break;
-  default:
+  if (logger_type < 0 || logger_type >= OCTOLAPSE_NUM_LOGGERS)
     return false;
-  }
+  // For speed we are going to check the log levels here before buffering any messages.
+  return log_level >= log_levels[logger_type].load(std::memory_order_relaxed);
+}
 
-  if (!check_log_levels_real_time)
+void octolapse_flush_log()
+{
+  if (p_log_handler == NULL || (log_buffer.is_empty() && dropped_log_records.load(std::memory_order_relaxed) == 0))
+    return;
+  if (is_flushing_log.test_and_set(std::memory_order_acquire))
+    return;
+
+  p_log_handler->begin_flush();
+  const long dropped = dropped_log_records.exchange(0, std::memory_order_relaxed);
+  if (dropped > 0)
   {
-    //std::cout << "Current Log Level: " << current_log_level << " requested:" << log_level;
-    // For speed we are going to check the log levels here before attempting to send any logging info to Python.
-    if (current_log_level > log_level)
-    {
-      return false;
-    }
+    std::string message = "Logging.octolapse_flush_log - The log buffer was full, ";
+    message.append(std::to_string(dropped)).append(" messages were dropped.");
+    p_log_handler->write(octolapse_log::GCODE_POSITION, octolapse_log::WARNING, message);
   }
-  return true;
+
+  log_record record;
+  while (log_buffer.try_pop(record))
+    p_log_handler->write(record.logger_type, record.log_level, record.message);
+
+  p_log_handler->end_flush();
+  is_flushing_log.clear(std::memory_order_release);
 }
 
 void octolapse_log_exception(const int logger_type, const std::string& message)
@@ -178,121 +163,34 @@ void octolapse_log(const int logger_type, const int log_level, const std::string
   octolapse_log(logger_type, log_level, message, false);
 }
 
-void octolapse_log(const int logger_type, const int log_level, const std::string& message, bool is_exception)
+void octolapse_log(const int logger_type, const int log_level, const char* message)
 {
-  if (!octolapse_loggers_created)
+  // Avoid creating a string for messages that will be filtered out.
+  if (p_log_handler == NULL || !octolapse_may_be_logged(logger_type, log_level))
     return;
+  octolapse_log(logger_type, log_level, std::string(message), false);
+}
 
-  // Get the appropriate logger
-  PyObject* py_logger;
-  long current_log_level = 0;
-  switch (logger_type)
-  {
-  case octolapse_log::GCODE_PARSER:
-    py_logger = py_octolapse_gcode_parser_logger;
-    current_log_level = gcode_parser_log_level;
-    break;
-  case octolapse_log::GCODE_POSITION:
-    py_logger = py_octolapse_gcode_position_logger;
-    current_log_level = gcode_position_log_level;
-    break;
-  case octolapse_log::SNAPSHOT_PLAN:
-    py_logger = py_octolapse_snapshot_plan_logger;
-    current_log_level = snapshot_plan_log_level;
-    break;
-  default:
-    PyErr_SetString(PyExc_ValueError, "Logging.octolapse_log - unknown logger_type.");
+void octolapse_log(const int logger_type, const int log_level, const std::string& message, bool is_exception)
+{
+  if (p_log_handler == NULL)
     return;
-  }
 
-  if (!check_log_levels_real_time)
+  if (!is_exception)
   {
-    //std::cout << "Current Log Level: " << current_log_level << " requested:" << log_level;
-    // For speed we are going to check the log levels here before attempting to send any logging info to Python.
-    if (current_log_level > log_level)
-    {
+    if (!octolapse_may_be_logged(logger_type, log_level))
       return;
-    }
-  }
-
-  PyObject* pyFunctionName = NULL;
-
-  PyObject* error_type = NULL;
-  PyObject* error_value = NULL;
-  PyObject* error_traceback = NULL;
-  bool error_occurred = false;
-  if (is_exception)
-  {
-    // if an error has occurred, use the exception function to log the entire error
-    pyFunctionName = py_error_function_name;
-    if (PyErr_Occurred())
-    {
-      error_occurred = true;
-      PyErr_Fetch(&error_type, &error_value, &error_traceback);
-      PyErr_NormalizeException(&error_type, &error_value, &error_traceback);
-    }
-  }
-  else
-  {
-    switch (log_level)
-    {
-    case octolapse_log::INFO:
-      pyFunctionName = py_info_function_name;
-      break;
-    case octolapse_log::WARNING:
-      pyFunctionName = py_warn_function_name;
-      break;
-    case octolapse_log::ERROR:
-      pyFunctionName = py_error_function_name;
-      break;
-    case octolapse_log::DEBUG:
-      pyFunctionName = py_debug_function_name;
-      break;
-    case octolapse_log::VERBOSE:
-      pyFunctionName = py_verbose_function_name;
-      break;
-    case octolapse_log::CRITICAL:
-      pyFunctionName = py_critical_function_name;
-      break;
-    default:
+    if (log_buffer.try_push(logger_type, log_level, message))
       return;
-    }
-  }
-  PyObject* pyMessage = PyUnicode_SafeFromString(message);
-  if (pyMessage == NULL)
-  {
-    PyErr_Format(PyExc_ValueError,
-                 "Unable to convert the log message '%s' to a PyString/Unicode message.", message.c_str());
+    // The buffer is full, send what we have and try again.
+    octolapse_flush_log();
+    if (!log_buffer.try_push(logger_type, log_level, message))
+      dropped_log_records.fetch_add(1, std::memory_order_relaxed);
     return;
   }
-  PyGILState_STATE state = PyGILState_Ensure();
-  PyObject* ret_val = PyObject_CallMethodObjArgs(py_logger, pyFunctionName, pyMessage, NULL);
-  // We need to decref our message so that the GC can remove it.  Maybe?
-  Py_DECREF(pyMessage);
-  PyGILState_Release(state);
-  if (ret_val == NULL)
-  {
-    if (!PyErr_Occurred())
-      PyErr_SetString(PyExc_ValueError, "Logging.octolapse_log - unknown logger_type.");
-    else
-    {
-      // I'm not sure what else to do here since I can't log the error.  I will print it 
-      // so that it shows up in the console, but I can't log it, and there is no way to 
-      // return an error.
-      PyErr_Print();
-      PyErr_Clear();
-    }
-  }
-  else
-  {
-    // Set the exception if we are doing exception logging.
-    if (is_exception)
-    {
-      if (error_occurred)
-        PyErr_Restore(error_type, error_value, error_traceback);
-      else
-        PyErr_SetString(PyExc_Exception, message.c_str());
-    }
-  }
-  Py_XDECREF(ret_val);
+
+  // Exceptions are sent immediately, since the handler must report the error before we return to the caller.  Send
+  // the buffered messages first to keep the messages in order.
+  octolapse_flush_log();
+  p_log_handler->write_exception(logger_type, message);
 }
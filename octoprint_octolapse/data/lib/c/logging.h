@@ -4,14 +4,81 @@
 
 struct octolapse_log
 {
-  enum octolapse_loggers { GCODE_PARSER, GCODE_POSITION, SNAPSHOT_PLAN };
+  enum octolapse_loggers { GCODE_PARSER, GCODE_POSITION, SNAPSHOT_PLAN, RENDER, SNAPSHOT };
 
   enum octolapse_log_levels { NOSET = 0, VERBOSE = 5, DEBUG = 10, INFO=20, WARNING=30, ERROR=40, CRITICAL=50 };
 };
 
-void octolapse_initialize_loggers();
+#define OCTOLAPSE_NUM_LOGGERS 5
+// The number of records that can be waiting to be sent to the handler.  Must be a power of 2.
+#define OCTOLAPSE_LOG_BUFFER_SIZE 1024
+
+/**
+ * \brief Receives the messages logged by the gcode engine.  The python extension installs a handler that forwards
+ * them to the python loggers.  Without a handler nothing is logged.
+ */
+class octolapse_log_handler
+{
+public:
+  virtual ~octolapse_log_handler()
+  {
+  }
+
+  /**
+   * \brief Called before and after each batch of buffered messages is written.  Only one batch is written at a time.
+   */
+  virtual void begin_flush()
+  {
+  }
+
+  virtual void end_flush()
+  {
+  }
+
+  virtual void write(int logger_type, int log_level, const std::string& message) = 0;
+  /**
+   * \brief Writes an error immediately, and reports it to the caller of the gcode engine (sets the python exception).
+   */
+  virtual void write_exception(int logger_type, const std::string& message) = 0;
+};
+
+/**
+ * \brief Installs the log handler, which must outlive its use.  Pass NULL to stop logging.
+ */
+void octolapse_set_log_handler(octolapse_log_handler* handler);
+/**
+ * \brief Sets the minimum level that will be sent to the handler for a logger.  Everything is sent by default.
+ */
+void octolapse_set_log_level(int logger_type, int log_level);
+/**
+ * \brief Returns true if a message of the given level would be logged.  This only reads a cached level, and never
+ * calls the handler.
+ */
 bool octolapse_may_be_logged(const int logger_type, const int log_level);
+/**
+ * \brief Log a message.  Messages are buffered and sent to the handler by octolapse_flush_log.
+ */
 void octolapse_log(const int logger_type, const int log_level, const std::string& message);
+void octolapse_log(const int logger_type, const int log_level, const char* message);
 void octolapse_log(const int logger_type, const int log_level, const std::string& message, bool is_exception);
+/**
+ * \brief Log an error that must be reported to the caller, see octolapse_log_handler::write_exception.  Any buffered
+ * messages are flushed first, and the error is sent to the handler immediately.
+ */
 void octolapse_log_exception(const int logger_type, const std::string& message);
-void set_internal_log_levels(bool check_real_time);
+/**
+ * \brief Sends all buffered messages to the handler.  This is cheap when nothing has been logged.
+ */
+void octolapse_flush_log();
+
+/**
+ * \brief Flushes the log when it goes out of scope.  Create one at the start of each function called from python
+ * so that messages are sent before control returns.
+ */
+struct octolapse_log_flusher
+{
+  ~octolapse_log_flusher()
+  {
+    octolapse_flush_log();
+  }
+};
@@ -21,8 +21,8 @@
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
 #include "parsed_command.h"
-#include "python_helpers.h"
 #include "logging.h"
+#include "utilities.h"
 #include <sstream>
 
 parsed_command::parsed_command()
@@ -45,134 +45,32 @@ void parsed_command::clear()
   is_empty = true;
 }
 
-PyObject* parsed_command::to_py_object()
+void parsed_command::update_gcode_string()
 {
-  PyObject* ret_val;
-  PyObject* pyCommandName = PyUnicode_SafeFromString(command.c_str());
-
-  if (pyCommandName == NULL)
-  {
-    std::string message = "Unable to convert the parameter name to unicode: ";
-    message += command;
-    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-    return NULL;
-  }
-  PyObject* pyGcode = PyUnicode_SafeFromString(gcode.c_str());
-  if (pyGcode == NULL)
-  {
-    std::string message = "Unable to convert the gcode to unicode: ";
-    message += gcode;
-    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-    return NULL;
-  }
-
-  PyObject* pyComment = PyUnicode_SafeFromString(comment.c_str());
-  if (pyComment == NULL)
-  {
-    std::string message = "Unable to convert the gocde comment to unicode: ";
-    message += comment;
-    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-    return NULL;
-  }
-
-  if (parameters.empty())
-  {
-    ret_val = PyTuple_Pack(4, pyCommandName, Py_None, pyGcode, pyComment);
-    if (ret_val == NULL)
-    {
-      std::string message = "Unable to convert the parsed_command (no parameters) to a tuple.  Command: ";
-      message += command;
-      message += " Gcode: ";
-      message += gcode;
-      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-      return NULL;
-    }
-    // We will need to decref pyCommandName and pyGcode later
-  }
-  else
+  gcode = command;
+  for (unsigned int index = 0; index < parameters.size(); index++)
   {
-    PyObject* pyParametersDict = PyDict_New();
-
-    // Create the parameters dictionary
-    if (pyParametersDict == NULL)
+    const parsed_command_parameter& param = parameters[index];
+    gcode += " ";
+    gcode += param.name;
+    switch (param.value_type)
     {
-      std::string message = "ParsedCommand.to_py_object: Unable to create the parameters dict.";
-      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-      return NULL;
-    }
-    // Loop through our parameters vector and create and add PyDict items
-    for (unsigned int index = 0; index < parameters.size(); index++)
-    {
-      parsed_command_parameter param = parameters[index];
-      PyObject* param_value = param.value_to_py_object();
-      // Errors here will be handled by value_to_py_object, just return NULL
-      if (param_value == NULL)
+    case 'F':
+      // Extrusion values get extra precision, all other floats use 3 decimals
+      gcode += utilities::to_fixed_string(param.double_value, param.name == "E" ? 5 : 3);
+      break;
+    case 'U':
       {
-        return NULL;
+        std::ostringstream unsigned_str;
+        unsigned_str << param.unsigned_long_value;
+        gcode += unsigned_str.str();
       }
-      if (PyDict_SetItemString(pyParametersDict, param.name.c_str(), param_value) != 0)
-      {
-        // Handle error here, display detailed message
-        std::string message = "Unable to add the command parameter to the parameters dictionary.  Parameter Name: ";
-        message += param.name;
-        message += " Value Type: ";
-        message += param.value_type;
-        message += " Value: ";
-
-        switch (param.value_type)
-        {
-        case 'S':
-          message += param.string_value;
-          break;
-        case 'N':
-          message += "None";
-          break;
-        case 'F':
-          {
-            std::ostringstream doubld_str;
-            doubld_str << param.double_value;
-            message += doubld_str.str();
-            message += param.string_value;
-          }
-          break;
-        case 'U':
-          {
-            std::ostringstream unsigned_strs;
-            unsigned_strs << param.unsigned_long_value;
-            message += unsigned_strs.str();
-            message += param.string_value;
-          }
-          break;
-        default:
-          break;
-        }
-        octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-        return NULL;
-      }
-      // Todo: evaluate the effects of this
-      Py_DECREF(param_value);
-    }
-
-    ret_val = PyTuple_Pack(4, pyCommandName, pyParametersDict, pyGcode, pyComment);
-    if (ret_val == NULL)
-    {
-      std::string message = "Unable to convert the parsed_command (with parameters) to a tuple.  Command: ";
-      message += command;
-      message += " Gcode: ";
-      message += gcode;
-      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-      return NULL;
+      break;
+    case 'S':
+      gcode += param.string_value;
+      break;
+    default:
+      break;
     }
-    // PyTuple_Pack makes a reference of its own, decref pyParametersDict.  
-    // We will need to decref pyCommandName and pyGcode later
-    // Todo: evaluate the effects of this
-    Py_DECREF(pyParametersDict);
   }
-  // If we're here, we need to decref pyCommandName and pyGcode.
-  // Todo: evaluate the effects of this
-  Py_DECREF(pyCommandName);
-  // Todo: evaluate the effects of this
-  Py_DECREF(pyGcode);
-  Py_DECREF(pyComment);
-  return ret_val;
 }
@@ -22,13 +22,6 @@
 
 #ifndef PARSED_COMMAND_H
 #define PARSED_COMMAND_H
-#ifdef _DEBUG
-#undef _DEBUG
-#include <Python.h>
-#define _DEBUG
-#else
-#include <Python.h>
-#endif
 #include <string>
 #include <vector>
 #include "parsed_command_parameter.h"
@@ -43,8 +36,9 @@ public:
   bool is_empty;
   bool is_known_command;
   std::vector<parsed_command_parameter> parameters;
-  PyObject* to_py_object();
   void clear();
+  // Rebuilds the gcode string from the command and parameters, like ParsedCommand.to_string
+  void update_gcode_string();
 };
 
 #endif
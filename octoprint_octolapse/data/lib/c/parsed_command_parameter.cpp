@@ -23,85 +23,70 @@
 #include "parsed_command_parameter.h"
 #include "parsed_command.h"
 #include "logging.h"
-#include "python_helpers.h"
+#include <cmath>
+
+static const long long POWERS_OF_TEN[GCODE_PARSER_MAX_EXACT_DIGITS + 1] = {
+  1LL, 10LL, 100LL, 1000LL, 10000LL, 100000LL, 1000000LL, 10000000LL, 100000000LL, 1000000000LL, 10000000000LL,
+  100000000000LL, 1000000000000LL, 10000000000000LL, 100000000000000LL, 1000000000000000LL, 10000000000000000LL,
+  100000000000000000LL, 1000000000000000000LL
+};
 
 parsed_command_parameter::parsed_command_parameter()
 {
   value_type = 'N';
   name.reserve(1);
+  decimal_mantissa = 0;
+  decimal_places = -1;
 }
 
 parsed_command_parameter::
 parsed_command_parameter(const std::string name, double value) : name(name), double_value(value)
 {
   value_type = 'F';
+  decimal_mantissa = 0;
+  decimal_places = -1;
 }
 
 parsed_command_parameter::
 parsed_command_parameter(const std::string name, const std::string value) : name(name), string_value(value)
 {
   value_type = 'S';
+  decimal_mantissa = 0;
+  decimal_places = -1;
 }
 
 parsed_command_parameter::
 parsed_command_parameter(const std::string name, const unsigned long value) : name(name), unsigned_long_value(value)
 {
   value_type = 'U';
+  decimal_mantissa = 0;
+  decimal_places = -1;
 }
 
-parsed_command_parameter::~parsed_command_parameter()
-{
-}
-
-PyObject* parsed_command_parameter::value_to_py_object()
+long long parsed_command_parameter::get_fixed_value(const short decimals, const double scale) const
 {
-  PyObject* ret_val;
-  // check the parameter type
-  if (value_type == 'F')
-  {
-    ret_val = PyFloat_FromDouble(double_value);
-    if (ret_val == NULL)
-    {
-      std::string message = "parsedCommandParameter.value_to_py_object: Unable to convert double value to a PyObject.";
-      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-      return NULL;
-    }
-  }
-  else if (value_type == 'N')
-  {
-    // None Type
-    Py_INCREF(Py_None);
-    ret_val = Py_None;
-  }
-  else if (value_type == 'S')
-  {
-    ret_val = PyUnicode_SafeFromString(string_value.c_str());
-    if (ret_val == NULL)
-    {
-      std::string message = "parsedCommandParameter.value_to_py_object: Unable to convert string value to a PyObject.";
-      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-      return NULL;
-    }
-  }
-  else if (value_type == 'U')
-  {
-    ret_val = PyLong_FromUnsignedLong(unsigned_long_value);
-    if (ret_val == NULL)
-    {
-      std::string message =
-        "parsedCommandParameter.value_to_py_object: Unable to convert unsigned long value to a PyObject.";
-      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
-      return NULL;
-    }
-  }
-  else
+  if (decimal_places < 0)
+    return llround(double_value * scale);
+  if (decimal_places <= decimals)
   {
-    std::string message = "The command parameter value type does not exist.  Value Type: ";
-    message += value_type;
-    octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::ERROR, message);
-    // There has been an error, we don't support this value_type!
-    return NULL;
+    const long long multiplier = POWERS_OF_TEN[decimals - decimal_places];
+    const long long limit = POWERS_OF_TEN[GCODE_PARSER_MAX_EXACT_DIGITS] / multiplier;
+    // Fall back to the double value if the result would overflow
+    if (decimal_mantissa >= limit || decimal_mantissa <= -limit)
+      return llround(double_value * scale);
+    return decimal_mantissa * multiplier;
   }
+  // There are more decimal places than units, so round half away from zero
+  const long long divisor = POWERS_OF_TEN[decimal_places - decimals];
+  long long value = decimal_mantissa / divisor;
+  const long long remainder = decimal_mantissa % divisor;
+  if (remainder * 2 >= divisor)
+    ++value;
+  else if (remainder * 2 <= -divisor)
+    --value;
+  return value;
+}
 
-  return ret_val;
+parsed_command_parameter::~parsed_command_parameter()
+{
 }
@@ -23,13 +23,9 @@
 #ifndef PARSED_COMMAND_PARAMETER_H
 #define PARSED_COMMAND_PARAMETER_H
 #include <string>
-#ifdef _DEBUG
-#undef _DEBUG
-#include <Python.h>
-#define _DEBUG
-#else
-#include <Python.h>
-#endif
+// The most decimal digits that fit in a 64 bit integer mantissa
+const short GCODE_PARSER_MAX_EXACT_DIGITS = 18;
+
 struct parsed_command_parameter
 {
 public:
@@ -38,13 +34,21 @@ public:
   parsed_command_parameter(std::string name, double value);
   parsed_command_parameter(std::string name, std::string value);
   parsed_command_parameter(std::string name, unsigned long value);
-  PyObject* value_to_py_object();
+  /**
+   * \brief Gets a float parameter as an integer number of 10^-decimals units, rounding half away from zero.  Uses the
+   * exact decimal value that was parsed if it is available.
+   */
+  long long get_fixed_value(short decimals, double scale) const;
 
   std::string name;
   char value_type;
   double double_value;
   unsigned long unsigned_long_value;
   std::string string_value;
+  // The exact parsed value of a float parameter is decimal_mantissa / 10^decimal_places.  decimal_places is -1 if
+  // the value was not parsed, or if it had too many digits to store exactly.
+  long long decimal_mantissa;
+  short decimal_places;
 };
 
 #endif
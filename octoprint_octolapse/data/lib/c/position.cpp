@@ -115,6 +115,8 @@ position::position()
   z_relative = 0;
   is_in_position = false;
   in_path_position = false;
+  in_path_x = 0;
+  in_path_y = 0;
   is_zhop = false;
   is_layer_change = false;
   is_height_change = false;
@@ -172,6 +174,8 @@ position::position(int extruder_count)
   z_relative = 0;
   is_in_position = false;
   in_path_position = false;
+  in_path_x = 0;
+  in_path_y = 0;
   is_zhop = false;
   is_layer_change = false;
   is_height_change = false;
@@ -229,6 +233,8 @@ position::position(const position& pos)
   z_relative = pos.z_relative;
   is_in_position = pos.is_in_position;
   in_path_position = pos.in_path_position;
+  in_path_x = pos.in_path_x;
+  in_path_y = pos.in_path_y;
   is_zhop = pos.is_zhop;
   is_layer_change = pos.is_layer_change;
   is_height_change = pos.is_height_change;
@@ -296,6 +302,8 @@ position& position::operator=(const position& pos)
   z_relative = pos.z_relative;
   is_in_position = pos.is_in_position;
   in_path_position = pos.in_path_position;
+  in_path_x = pos.in_path_x;
+  in_path_y = pos.in_path_y;
   is_zhop = pos.is_zhop;
   is_layer_change = pos.is_layer_change;
   is_height_change = pos.is_height_change;
@@ -386,6 +394,8 @@ void position::reset_state()
   has_position_changed = false;
   has_received_home_command = false;
   gcode_ignored = true;
+  // the in path position only applies to a single command
+  in_path_position = false;
 
   //is_in_bounds = true; // I dont' think we want to reset this every time since it's only calculated if the current position
   // changes.
@@ -393,270 +403,3 @@ void position::reset_state()
   z_relative = 0;
   feature_type_tag = 0;
 }
-
-PyObject* position::to_py_tuple()
-{
-  //std::cout << "Building position py_object.\r\n";
-  PyObject* py_command;
-  if (command.is_empty)
-  {
-    py_command = Py_None;
-  }
-  else
-  {
-    py_command = command.to_py_object();
-    if (py_command == NULL)
-    {
-      return NULL;
-    }
-  }
-  PyObject* py_extruders = extruder::build_py_object(p_extruders, num_extruders);
-  if (py_extruders == NULL)
-  {
-    return NULL;
-  }
-  //std::cout << "Building position py_tuple.\r\n";
-  PyObject* pyPosition = Py_BuildValue(
-    // ReSharper disable once StringLiteralTypo
-    "ddddddddddddddddddlllllllllllllllllllllllllllllllllllllllllOO",
-    // Floats
-    x, // 0
-    y, // 1
-    z, // 2
-    f, // 3
-    x_offset, // 4
-    y_offset, // 5
-    z_offset, // 6
-    x_firmware_offset, // 7
-    y_firmware_offset, // 8
-    z_firmware_offset, // 9
-    z_relative, // 10
-    last_extrusion_height, // 11
-    height, // 12
-    0.0, // 13 - Firmware Retraction Length
-    0.0, // 14 - Firmware Unretraction Additional Length
-    0.0, // 15 - Firmware Retraction Feedrate
-    0.0, // 16 - Firmware Unretraction Feedrate
-    0.0, // 17 - Firmware Unretraction ZLift
-    // Int
-    layer, // 18
-    height_increment, // 19 !!!!!!!!!
-    height_increment_change_count, // 20 !!!!!!
-    current_tool, // 21
-    num_extruders, // 22
-    // Bool (represented as an integer)
-    (long int)(x_homed ? 1 : 0), // 23
-    (long int)(y_homed ? 1 : 0), // 24
-    (long int)(z_homed ? 1 : 0), // 25
-    (long int)(is_relative ? 1 : 0), // 26
-    (long int)(is_extruder_relative ? 1 : 0), // 27
-    (long int)(is_metric ? 1 : 0), // 28
-    (long int)(is_printer_primed ? 1 : 0), // 29
-    (long int)(has_definite_position ? 1 : 0), // 30
-    (long int)(is_layer_change ? 1 : 0), // 31
-    (long int)(is_height_change ? 1 : 0), // 32
-    (long int)(is_height_increment_change ? 1 : 0), // 33
-    (long int)(is_xy_travel ? 1 : 0), // 34
-    (long int)(is_xyz_travel ? 1 : 0), // 35
-    (long int)(is_zhop ? 1 : 0), // 36
-    (long int)(has_xy_position_changed ? 1 : 0), // 37
-    (long int)(has_position_changed ? 1 : 0), // 38
-    (long int)(has_received_home_command ? 1 : 0), // 39
-    (long int)(is_in_position ? 1 : 0), // 40
-    (long int)(in_path_position ? 1 : 0), // 41
-    (long int)(is_in_bounds ? 1 : 0), // 42
-    // Null bool, represented as integers
-    (long int)(x_null ? 1 : 0), // 43
-    (long int)(y_null ? 1 : 0), // 44
-    (long int)(z_null ? 1 : 0), // 45
-    (long int)(f_null ? 1 : 0), // 46
-    (long int)(is_relative_null ? 1 : 0), // 47
-    (long int)(is_extruder_relative_null ? 1 : 0), // 48
-    (long int)(last_extrusion_height_null ? 1 : 0), // 49
-    (long int)(is_metric_null ? 1 : 0), // 50
-    (long int)(true ? 1 : 0), // 51 - Firmware retraction length null
-    (long int)(true ? 1 : 0), // 52 - Firmware unretraction additional length null
-    (long int)(true ? 1 : 0), // 53 - Firmware retraction feedrate null
-    (long int)(true ? 1 : 0), // 54 - Firmware unretraction feedrate null
-    (long int)(true ? 1 : 0), // 55 - Firmware ZLift Null
-    // file statistics
-    file_line_number, // 56
-    gcode_number, // 57
-    file_position, // 58
-    // Objects
-    py_command, // 59
-    py_extruders // 60
-
-  );
-  if (pyPosition == NULL)
-  {
-    //std::cout << "No py_object returned for position!\r\n";
-    std::string message =
-      "position.to_py_tuple: Unable to convert position value to a PyObject tuple via Py_BuildValue.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return NULL;
-  }
-  //std::cout << "Finished building pyPosition.\r\n";
-  Py_DECREF(py_command);
-  Py_DECREF(py_extruders);
-  //std::cout << "Returning pyPosition.\r\n";
-  return pyPosition;
-}
-
-PyObject* position::to_py_dict()
-{
-  PyObject* py_command;
-  if (command.command.length() == 0)
-  {
-    py_command = Py_None;
-  }
-  else
-  {
-    py_command = command.to_py_object();
-  }
-  PyObject* py_extruders = extruder::build_py_object(p_extruders, num_extruders);
-  if (py_extruders == NULL)
-  {
-    return NULL;
-  }
-  PyObject* p_position = Py_BuildValue(
-    "{s:O,s:O,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i}",
-    "parsed_command",
-    py_command,
-    "extruders",
-    py_extruders,
-    // FLOATS
-    "x_firmware_offset",
-    x_firmware_offset,
-    "y_firmware_offset",
-    y_firmware_offset,
-    "z_firmware_offset",
-    z_firmware_offset,
-    "x",
-    x,
-    "y",
-    y,
-    "z",
-    z,
-    "f",
-    f,
-    "e",
-    x_offset,
-    "y_offset",
-    y_offset,
-    "z_offset",
-    z_offset,
-    "last_extrusion_height",
-    last_extrusion_height,
-    "height",
-    height,
-    "firmware_retraction_length",
-    0.0,
-    "firmware_unretraction_additional_length",
-    0.0,
-    "firmware_retraction_feedrate",
-    0.0,
-    "firmware_unretraction_feedrate",
-    0.0,
-    "firmware_z_lift",
-    0.0,
-    "z_relative",
-    z_relative,
-    // Ints
-    "layer",
-    layer,
-    "height_increment",
-    height_increment,
-    "height_increment_change_count",
-    height_increment_change_count,
-    "current_tool",
-    current_tool,
-    "num_extruders",
-    num_extruders,
-    // Bools
-    "x_null",
-    (long int)(x_null ? 1 : 0),
-    "y_null",
-    (long int)(y_null ? 1 : 0),
-    "z_null",
-    (long int)(z_null ? 1 : 0),
-    "f_null",
-    (long int)(f_null ? 1 : 0),
-    "x_homed",
-    (long int)(x_homed ? 1 : 0),
-    "y_homed",
-    (long int)(y_homed ? 1 : 0),
-    "z_homed",
-    (long int)(z_homed ? 1 : 0),
-    "is_relative",
-    (long int)(is_relative ? 1 : 0),
-    "is_relative_null",
-    (long int)(is_relative_null ? 1 : 0),
-    "is_extruder_relative",
-    (long int)(is_extruder_relative ? 1 : 0),
-    "is_extruder_relative_null",
-    (long int)(is_extruder_relative_null ? 1 : 0),
-    "is_metric",
-    (long int)(is_metric ? 1 : 0),
-    "is_metric_null",
-    (long int)(is_metric_null ? 1 : 0),
-    "is_printer_primed",
-    (long int)(is_printer_primed ? 1 : 0),
-    "last_extrusion_height_null",
-    (long int)(last_extrusion_height_null ? 1 : 0),
-    "firmware_retraction_length_null",
-    (long int)(false ? 1 : 0),
-    "firmware_unretraction_additional_length_null",
-    (long int)(false ? 1 : 0),
-    "firmware_retraction_feedrate_null",
-    (long int)(false ? 1 : 0),
-    "firmware_unretraction_feedrate_null",
-    (long int)(false ? 1 : 0),
-    "firmware_z_lift_null",
-    (long int)(false ? 1 : 0),
-    "has_position_error",
-    (long int)(false ? 1 : 0),
-    "has_definite_position",
-    (long int)(has_definite_position ? 1 : 0),
-    "is_layer_change",
-    (long int)(is_layer_change ? 1 : 0),
-    "is_height_change",
-    (long int)(is_height_change ? 1 : 0),
-    "is_height_increment_change",
-    (long int)(is_height_increment_change ? 1 : 0),
-    "is_xy_travel",
-    (long int)(is_xy_travel ? 1 : 0),
-    "is_xyz_travel",
-    (long int)(is_xyz_travel ? 1 : 0),
-    "is_zhop",
-    (long int)(is_zhop ? 1 : 0),
-    "has_xy_position_changed",
-    (long int)(has_xy_position_changed ? 1 : 0),
-    "has_position_changed",
-    (long int)(has_position_changed ? 1 : 0),
-    "has_received_home_command",
-    (long int)(has_received_home_command ? 1 : 0),
-    "is_in_position",
-    (long int)(is_in_position ? 1 : 0),
-    "in_path_position",
-    (long int)(in_path_position ? 1 : 0),
-    "file_line_number",
-    file_line_number,
-    "file_position",
-    file_position,
-    "gcode_number",
-    gcode_number,
-    "is_in_bounds",
-    (long int)(is_in_bounds ? 1 : 0)
-  );
-  if (p_position == NULL)
-  {
-    std::string message = "position.to_py_dict: Unable to convert position value to a dict PyObject via Py_BuildValue.";
-    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
-    return NULL;
-  }
-  Py_DECREF(py_command);
-  Py_DECREF(py_extruders);
-
-  return p_position;
-}
@@ -25,13 +25,6 @@
 #include <string>
 #include "parsed_command.h"
 #include "extruder.h"
-#ifdef _DEBUG
-#undef _DEBUG
-#include <Python.h>
-#define _DEBUG
-#else
-#include <Python.h>
-#endif
 
 struct position
 {
@@ -41,8 +34,6 @@ struct position
   virtual ~position();
   position& operator=(const position& pos);
   void reset_state();
-  PyObject* to_py_tuple();
-  PyObject* to_py_dict();
   parsed_command command;
   int feature_type_tag;
   double f;
@@ -88,9 +79,12 @@ struct position
   bool has_received_home_command;
   bool is_in_position;
   bool in_path_position;
-  long file_line_number;
-  long gcode_number;
-  long file_position;
+  // The first in-position intersection of the current move, valid if in_path_position is true
+  double in_path_x;
+  double in_path_y;
+  long long file_line_number;
+  long long gcode_number;
+  long long file_position;
   bool gcode_ignored;
   bool is_in_bounds;
   bool is_empty;
@@ -0,0 +1,467 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "position_restrictions.h"
+#include <algorithm>
+#include <cmath>
+#include <utility>
+
+// Matches utility.FLOAT_MATH_EQUALITY_RANGE, which position.py used for restrictions
+const double POSITION_RESTRICTION_TOLERANCE = 0.0000001;
+// The number of grid cells along each axis
+const unsigned int POSITION_RESTRICTION_GRID_CELLS = 16;
+
+position_restriction_point::position_restriction_point()
+{
+  x = 0;
+  y = 0;
+}
+
+position_restriction_point::position_restriction_point(const double x_value, const double y_value)
+{
+  x = x_value;
+  y = y_value;
+}
+
+position_restriction::position_restriction()
+{
+  type = position_restriction_type_required;
+  shape = position_restriction_shape_rect;
+  x = 0;
+  y = 0;
+  x2 = 0;
+  y2 = 0;
+  r = 0;
+  calculate_intersections = false;
+  min_x = 0;
+  min_y = 0;
+  max_x = 0;
+  max_y = 0;
+}
+
+void position_restriction::update_bounds()
+{
+  switch (shape)
+  {
+  case position_restriction_shape_rect:
+    if (x2 < x)
+      std::swap(x, x2);
+    if (y2 < y)
+      std::swap(y, y2);
+    min_x = x;
+    min_y = y;
+    max_x = x2;
+    max_y = y2;
+    break;
+  case position_restriction_shape_circle:
+    min_x = x - r;
+    min_y = y - r;
+    max_x = x + r;
+    max_y = y + r;
+    break;
+  case position_restriction_shape_polygon:
+    min_x = 0;
+    min_y = 0;
+    max_x = 0;
+    max_y = 0;
+    for (unsigned int index = 0; index < points.size(); index++)
+    {
+      const position_restriction_point& point = points[index];
+      if (index == 0 || point.x < min_x)
+        min_x = point.x;
+      if (index == 0 || point.y < min_y)
+        min_y = point.y;
+      if (index == 0 || point.x > max_x)
+        max_x = point.x;
+      if (index == 0 || point.y > max_y)
+        max_y = point.y;
+    }
+    break;
+  }
+  // make sure points on the edge are within the bounds
+  min_x -= POSITION_RESTRICTION_TOLERANCE;
+  min_y -= POSITION_RESTRICTION_TOLERANCE;
+  max_x += POSITION_RESTRICTION_TOLERANCE;
+  max_y += POSITION_RESTRICTION_TOLERANCE;
+}
+
+bool position_restriction::is_in_position(const double point_x, const double point_y) const
+{
+  switch (shape)
+  {
+  case position_restriction_shape_rect:
+    // intersections are on the edge, so allow for rounding
+    return x - POSITION_RESTRICTION_TOLERANCE <= point_x && point_x <= x2 + POSITION_RESTRICTION_TOLERANCE &&
+      y - POSITION_RESTRICTION_TOLERANCE <= point_y && point_y <= y2 + POSITION_RESTRICTION_TOLERANCE;
+  case position_restriction_shape_circle:
+    {
+      const double lsq = (point_x - x) * (point_x - x) + (point_y - y) * (point_y - y);
+      const double rsq = r * r;
+      return std::fabs(lsq - rsq) <= POSITION_RESTRICTION_TOLERANCE || lsq < rsq;
+    }
+  case position_restriction_shape_polygon:
+    return is_in_polygon(point_x, point_y);
+  }
+  return false;
+}
+
+bool position_restriction::is_in_polygon(const double point_x, const double point_y) const
+{
+  const unsigned int num_points = points.size();
+  if (num_points < 3)
+    return false;
+
+  bool is_inside = false;
+  for (unsigned int index = 0, previous_index = num_points - 1; index < num_points; previous_index = index++)
+  {
+    const position_restriction_point& a = points[previous_index];
+    const position_restriction_point& b = points[index];
+    // Points on an edge are in position, like the other shapes
+    const double edge_x = b.x - a.x;
+    const double edge_y = b.y - a.y;
+    const double edge_length_sq = edge_x * edge_x + edge_y * edge_y;
+    double t = 0;
+    if (edge_length_sq > 0)
+      t = std::max(0.0, std::min(1.0, ((point_x - a.x) * edge_x + (point_y - a.y) * edge_y) / edge_length_sq));
+    const double distance_x = a.x + t * edge_x - point_x;
+    const double distance_y = a.y + t * edge_y - point_y;
+    if (distance_x * distance_x + distance_y * distance_y <= POSITION_RESTRICTION_TOLERANCE * POSITION_RESTRICTION_TOLERANCE)
+      return true;
+    // even-odd rule
+    if ((a.y > point_y) != (b.y > point_y) && point_x < edge_x * (point_y - a.y) / edge_y + a.x)
+      is_inside = !is_inside;
+  }
+  return is_inside;
+}
+
+void position_restriction::get_intersections(const double x1, const double y1, const double x2, const double y2,
+                                             std::vector<position_restriction_point>& intersections) const
+{
+  switch (shape)
+  {
+  case position_restriction_shape_rect:
+    get_rect_intersections(x1, y1, x2, y2, intersections);
+    break;
+  case position_restriction_shape_circle:
+    get_circle_intersections(x1, y1, x2, y2, intersections);
+    break;
+  case position_restriction_shape_polygon:
+    get_polygon_intersections(x1, y1, x2, y2, intersections);
+    break;
+  }
+}
+
+void position_restriction::get_rect_intersections(const double x1, const double y1, const double x2, const double y2,
+                                                  std::vector<position_restriction_point>& intersections) const
+{
+  // This is a port of utility.get_intersections_rectangle (Liang-Barsky)
+  const double left = x;
+  const double right = x2;
+  const double bottom = y;
+  const double top = y2;
+
+  // if the points are both inside of the rect, there are no intersections
+  if (
+    left < x1 && x1 < right &&
+    left < x2 && x2 < right &&
+    bottom < y1 && y1 < top &&
+    bottom < y2 && y2 < top
+  )
+    return;
+
+  double t0 = 0.0;
+  double t1 = 1.0;
+  const double dx = x2 - x1;
+  const double dy = y2 - y1;
+  const double p[4] = {-dx, dx, -dy, dy};
+  const double q[4] = {-(left - x1), right - x1, -(bottom - y1), top - y1};
+  for (int edge = 0; edge < 4; edge++)
+  {
+    if (p[edge] == 0)
+    {
+      if (q[edge] < 0)
+        return;
+      continue;
+    }
+    const double r = q[edge] / p[edge];
+    if (p[edge] < 0)
+    {
+      if (r > t1)
+        return;
+      if (r > t0)
+        t0 = r;
+    }
+    else
+    {
+      if (r < t0)
+        return;
+      if (r < t1)
+        t1 = r;
+    }
+  }
+
+  const double intersection_x1 = x1 + t0 * dx;
+  const double intersection_y1 = y1 + t0 * dy;
+  const double intersection_x2 = x1 + t1 * dx;
+  const double intersection_y2 = y1 + t1 * dy;
+  if (!(left < intersection_x1 && intersection_x1 < right && bottom < intersection_y1 && intersection_y1 < top))
+    intersections.push_back(position_restriction_point(intersection_x1, intersection_y1));
+  if (!(left < intersection_x2 && intersection_x2 < right && bottom < intersection_y2 && intersection_y2 < top))
+    intersections.push_back(position_restriction_point(intersection_x2, intersection_y2));
+}
+
+void position_restriction::get_circle_intersections(const double x1, const double y1, const double x2, const double y2,
+                                                    std::vector<position_restriction_point>& intersections) const
+{
+  // This is a port of utility.get_intersections_circle
+  const double segment_length = std::sqrt((x2 - x1) * (x2 - x1) + (y2 - y1) * (y2 - y1));
+  if (segment_length == 0)
+    return;
+  const double vector_x = (x2 - x1) / segment_length;
+  const double vector_y = (y2 - y1) / segment_length;
+
+  // the distance along the segment of the point closest to the circle center
+  const double t = vector_x * (x - x1) + vector_y * (y - y1);
+  const double closest_x = t * vector_x + x1;
+  const double closest_y = t * vector_y + y1;
+  const double closest_to_center = std::sqrt((closest_x - x) * (closest_x - x) + (closest_y - y) * (closest_y - y));
+
+  const unsigned int num_intersections = intersections.size();
+  if (closest_to_center < r)
+  {
+    const double intersect_distance = std::sqrt(r * r - closest_to_center * closest_to_center);
+    const double t_1 = t - intersect_distance;
+    if (t_1 >= 0 && t_1 <= segment_length)
+      intersections.push_back(position_restriction_point(t_1 * vector_x + x1, t_1 * vector_y + y1));
+    const double t_2 = t + intersect_distance;
+    if (t_2 >= 0 && t_2 <= segment_length)
+      intersections.push_back(position_restriction_point(t_2 * vector_x + x1, t_2 * vector_y + y1));
+  }
+
+  // a tangent segment touches the circle at the closest point
+  if (
+    intersections.size() == num_intersections &&
+    std::fabs(closest_to_center - r) <= POSITION_RESTRICTION_TOLERANCE &&
+    t >= 0 && t <= segment_length
+  )
+    intersections.push_back(position_restriction_point(closest_x, closest_y));
+}
+
+void position_restriction::get_polygon_intersections(const double x1, const double y1, const double x2,
+                                                     const double y2,
+                                                     std::vector<position_restriction_point>& intersections) const
+{
+  const unsigned int num_points = points.size();
+  if (num_points < 3)
+    return;
+
+  const double dx = x2 - x1;
+  const double dy = y2 - y1;
+  // the distance along the segment (0-1) and the intersection
+  std::vector<std::pair<double, unsigned int> > edge_intersections;
+  std::vector<position_restriction_point> edge_points;
+  for (unsigned int index = 0, previous_index = num_points - 1; index < num_points; previous_index = index++)
+  {
+    const position_restriction_point& a = points[previous_index];
+    const position_restriction_point& b = points[index];
+    const double edge_x = b.x - a.x;
+    const double edge_y = b.y - a.y;
+    const double denominator = dx * edge_y - dy * edge_x;
+    // skip parallel edges, any overlap will be found at the ends of the adjacent edges
+    if (std::fabs(denominator) < POSITION_RESTRICTION_TOLERANCE)
+      continue;
+    const double offset_x = a.x - x1;
+    const double offset_y = a.y - y1;
+    const double t = (offset_x * edge_y - offset_y * edge_x) / denominator;
+    const double u = (offset_x * dy - offset_y * dx) / denominator;
+    if (t < 0 || t > 1 || u < 0 || u > 1)
+      continue;
+    edge_intersections.push_back(std::make_pair(t, static_cast<unsigned int>(edge_points.size())));
+    edge_points.push_back(position_restriction_point(x1 + t * dx, y1 + t * dy));
+  }
+  std::sort(edge_intersections.begin(), edge_intersections.end());
+  for (unsigned int index = 0; index < edge_intersections.size(); index++)
+    intersections.push_back(edge_points[edge_intersections[index].second]);
+}
+
+position_restrictions::position_restrictions()
+{
+  has_required_ = false;
+  grid_min_x_ = 0;
+  grid_min_y_ = 0;
+  grid_max_x_ = 0;
+  grid_max_y_ = 0;
+  cell_width_ = 1;
+  cell_height_ = 1;
+}
+
+position_restrictions::position_restrictions(const std::vector<position_restriction>& restrictions)
+{
+  restrictions_ = restrictions;
+  has_required_ = false;
+  grid_min_x_ = 0;
+  grid_min_y_ = 0;
+  grid_max_x_ = 0;
+  grid_max_y_ = 0;
+  cell_width_ = 1;
+  cell_height_ = 1;
+  for (unsigned int index = 0; index < restrictions_.size(); index++)
+  {
+    restrictions_[index].update_bounds();
+    if (restrictions_[index].type == position_restriction_type_required)
+      has_required_ = true;
+  }
+  build_grid();
+}
+
+bool position_restrictions::has_restrictions() const
+{
+  return !restrictions_.empty();
+}
+
+void position_restrictions::build_grid()
+{
+  cell_starts_.clear();
+  cell_restrictions_.clear();
+  if (restrictions_.empty())
+    return;
+
+  grid_min_x_ = restrictions_[0].min_x;
+  grid_min_y_ = restrictions_[0].min_y;
+  grid_max_x_ = restrictions_[0].max_x;
+  grid_max_y_ = restrictions_[0].max_y;
+  for (unsigned int index = 1; index < restrictions_.size(); index++)
+  {
+    grid_min_x_ = std::min(grid_min_x_, restrictions_[index].min_x);
+    grid_min_y_ = std::min(grid_min_y_, restrictions_[index].min_y);
+    grid_max_x_ = std::max(grid_max_x_, restrictions_[index].max_x);
+    grid_max_y_ = std::max(grid_max_y_, restrictions_[index].max_y);
+  }
+  cell_width_ = (grid_max_x_ - grid_min_x_) / POSITION_RESTRICTION_GRID_CELLS;
+  cell_height_ = (grid_max_y_ - grid_min_y_) / POSITION_RESTRICTION_GRID_CELLS;
+
+  // Count the restrictions in each cell, then fill them in
+  const unsigned int num_cells = POSITION_RESTRICTION_GRID_CELLS * POSITION_RESTRICTION_GRID_CELLS;
+  cell_starts_.assign(num_cells + 1, 0);
+  for (int pass = 0; pass < 2; pass++)
+  {
+    std::vector<unsigned int> cell_positions;
+    if (pass == 1)
+    {
+      for (unsigned int cell = 0; cell < num_cells; cell++)
+        cell_starts_[cell + 1] += cell_starts_[cell];
+      cell_restrictions_.resize(cell_starts_[num_cells]);
+      cell_positions.assign(cell_starts_.begin(), cell_starts_.end() - 1);
+    }
+    for (unsigned int index = 0; index < restrictions_.size(); index++)
+    {
+      const position_restriction& restriction = restrictions_[index];
+      const unsigned int column_start = get_column(restriction.min_x);
+      const unsigned int column_end = get_column(restriction.max_x);
+      const unsigned int row_start = get_row(restriction.min_y);
+      const unsigned int row_end = get_row(restriction.max_y);
+      for (unsigned int row = row_start; row <= row_end; row++)
+      {
+        for (unsigned int column = column_start; column <= column_end; column++)
+        {
+          const unsigned int cell = row * POSITION_RESTRICTION_GRID_CELLS + column;
+          if (pass == 0)
+            cell_starts_[cell + 1]++;
+          else
+            cell_restrictions_[cell_positions[cell]++] = index;
+        }
+      }
+    }
+  }
+}
+
+unsigned int position_restrictions::get_column(const double x) const
+{
+  if (cell_width_ <= 0 || x <= grid_min_x_)
+    return 0;
+  const unsigned int column = static_cast<unsigned int>((x - grid_min_x_) / cell_width_);
+  return std::min(column, POSITION_RESTRICTION_GRID_CELLS - 1);
+}
+
+unsigned int position_restrictions::get_row(const double y) const
+{
+  if (cell_height_ <= 0 || y <= grid_min_y_)
+    return 0;
+  const unsigned int row = static_cast<unsigned int>((y - grid_min_y_) / cell_height_);
+  return std::min(row, POSITION_RESTRICTION_GRID_CELLS - 1);
+}
+
+bool position_restrictions::is_in_position(const double x, const double y) const
+{
+  if (restrictions_.empty())
+    return true;
+  // Outside of the grid we can't be in any restriction
+  if (x < grid_min_x_ || x > grid_max_x_ || y < grid_min_y_ || y > grid_max_y_)
+    return !has_required_;
+
+  const unsigned int cell = get_row(y) * POSITION_RESTRICTION_GRID_CELLS + get_column(x);
+  bool is_in_required = false;
+  for (unsigned int index = cell_starts_[cell]; index < cell_starts_[cell + 1]; index++)
+  {
+    const position_restriction& restriction = restrictions_[cell_restrictions_[index]];
+    if (!restriction.is_in_position(x, y))
+      continue;
+    // if we're in a forbidden position, return false now
+    if (restriction.type == position_restriction_type_forbidden)
+      return false;
+    is_in_required = true;
+  }
+  // if we only have forbidden restrictions, the point was not within any of them
+  return !has_required_ || is_in_required;
+}
+
+bool position_restrictions::get_in_path_intersection(const double x, const double y, const double previous_x,
+                                                     const double previous_y, double& intersection_x,
+                                                     double& intersection_y) const
+{
+  intersections_.clear();
+  const double segment_min_x = std::min(x, previous_x);
+  const double segment_max_x = std::max(x, previous_x);
+  const double segment_min_y = std::min(y, previous_y);
+  const double segment_max_y = std::max(y, previous_y);
+  for (unsigned int index = 0; index < restrictions_.size(); index++)
+  {
+    const position_restriction& restriction = restrictions_[index];
+    if (
+      !restriction.calculate_intersections ||
+      segment_max_x < restriction.min_x || segment_min_x > restriction.max_x ||
+      segment_max_y < restriction.min_y || segment_min_y > restriction.max_y
+    )
+      continue;
+    restriction.get_intersections(previous_x, previous_y, x, y, intersections_);
+  }
+
+  for (unsigned int index = 0; index < intersections_.size(); index++)
+  {
+    if (is_in_position(intersections_[index].x, intersections_[index].y))
+    {
+      intersection_x = intersections_[index].x;
+      intersection_y = intersections_[index].y;
+      return true;
+    }
+  }
+  return false;
+}
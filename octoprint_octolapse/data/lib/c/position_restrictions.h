@@ -0,0 +1,130 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef POSITION_RESTRICTIONS_H
+#define POSITION_RESTRICTIONS_H
+#include <vector>
+
+// These must match SnapshotPositionRestrictions in settings.py
+enum position_restriction_type
+{
+  position_restriction_type_required = 0,
+  position_restriction_type_forbidden = 1
+};
+
+enum position_restriction_shape
+{
+  position_restriction_shape_rect = 0,
+  position_restriction_shape_circle = 1,
+  position_restriction_shape_polygon = 2
+};
+
+struct position_restriction_point
+{
+  position_restriction_point();
+  position_restriction_point(double x_value, double y_value);
+  double x;
+  double y;
+};
+
+/**
+ * \brief A required or forbidden rectangle, circle or polygon.
+ */
+struct position_restriction
+{
+  position_restriction();
+  position_restriction_type type;
+  position_restriction_shape shape;
+  // rect corners (x, y) and (x2, y2), or the circle center (x, y) and radius r
+  double x;
+  double y;
+  double x2;
+  double y2;
+  double r;
+  std::vector<position_restriction_point> points;
+  bool calculate_intersections;
+  // the bounding box, calculated by update_bounds
+  double min_x;
+  double min_y;
+  double max_x;
+  double max_y;
+  /**
+   * \brief Normalizes the rect corners and calculates the bounding box.  This must be called after the shape is set.
+   */
+  void update_bounds();
+  bool is_in_position(double point_x, double point_y) const;
+  /**
+   * \brief Adds any intersections of the segment (x1, y1) - (x2, y2) with the edge of the restriction, ordered from
+   * the start of the segment.
+   */
+  void get_intersections(double x1, double y1, double x2, double y2,
+                         std::vector<position_restriction_point>& intersections) const;
+private:
+  bool is_in_polygon(double point_x, double point_y) const;
+  void get_rect_intersections(double x1, double y1, double x2, double y2,
+                              std::vector<position_restriction_point>& intersections) const;
+  void get_circle_intersections(double x1, double y1, double x2, double y2,
+                                std::vector<position_restriction_point>& intersections) const;
+  void get_polygon_intersections(double x1, double y1, double x2, double y2,
+                                 std::vector<position_restriction_point>& intersections) const;
+};
+
+/**
+ * \brief Calculates is_in_position and in_path_position for the position restrictions of a trigger profile.
+ *
+ * The restrictions are binned into a uniform grid by bounding box, so a point only needs to be compared against the
+ * restrictions whose bounds overlap its cell, and a point outside of the grid can't be in any restriction.
+ */
+class position_restrictions
+{
+public:
+  position_restrictions();
+  explicit position_restrictions(const std::vector<position_restriction>& restrictions);
+  bool has_restrictions() const;
+  /**
+   * \brief Returns true if the point is in no forbidden restriction, and in at least one required restriction if
+   * there are any.
+   */
+  bool is_in_position(double x, double y) const;
+  /**
+   * \brief Finds the first intersection of the move from (previous_x, previous_y) to (x, y) that is in position.
+   * Returns false if there is none.
+   */
+  bool get_in_path_intersection(double x, double y, double previous_x, double previous_y, double& intersection_x,
+                                double& intersection_y) const;
+private:
+  void build_grid();
+  unsigned int get_column(double x) const;
+  unsigned int get_row(double y) const;
+  std::vector<position_restriction> restrictions_;
+  bool has_required_;
+  double grid_min_x_;
+  double grid_min_y_;
+  double grid_max_x_;
+  double grid_max_y_;
+  double cell_width_;
+  double cell_height_;
+  // cell_starts_[cell] to cell_starts_[cell + 1] are the indexes into cell_restrictions_ for the cell
+  std::vector<unsigned int> cell_starts_;
+  std::vector<unsigned int> cell_restrictions_;
+  mutable std::vector<position_restriction_point> intersections_;
+};
+#endif
@@ -0,0 +1,1374 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "python_bindings.h"
+#include <sstream>
+#include "instrumentation.h"
+#include "logging.h"
+#include "python_helpers.h"
+
+PyObject* to_py_tuple(const extruder& source)
+{
+  //std::cout << "Building extruder py_tuple.\r\n";
+  PyObject* py_extruder = Py_BuildValue(
+    // ReSharper disable once StringLiteralTypo
+    "ddddddddddllllllllll",
+    // Floats
+    source.x_firmware_offset, // 0
+    source.y_firmware_offset, // 1
+    source.z_firmware_offset, // 2
+    source.e, // 3
+    source.e_offset, // 4
+    source.e_relative, // 5
+    source.extrusion_length, // 6
+    source.extrusion_length_total, // 7
+    source.retraction_length, // 8
+    source.deretraction_length, // 9
+    // Bool (represented as an integer)
+    (long int)(source.is_extruding_start ? 1 : 0), // 10
+    (long int)(source.is_extruding ? 1 : 0), // 11
+    (long int)(source.is_primed ? 1 : 0), // 12
+    (long int)(source.is_retracting_start ? 1 : 0), // 13
+    (long int)(source.is_retracting ? 1 : 0), // 14
+    (long int)(source.is_retracted ? 1 : 0), // 15
+    (long int)(source.is_partially_retracted ? 1 : 0), // 16
+    (long int)(source.is_deretracting_start ? 1 : 0), // 17
+    (long int)(source.is_deretracting ? 1 : 0), // 18
+    (long int)(source.is_deretracted ? 1 : 0) // 19
+  );
+  if (py_extruder == NULL)
+  {
+    std::string message =
+      "extruder.to_py_tuple: Unable to convert extruder value to a PyObject tuple via Py_BuildValue.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return NULL;
+  }
+  return py_extruder;
+}
+
+PyObject* to_py_dict(const extruder& source)
+{
+  PyObject* p_extruder = Py_BuildValue(
+    "{s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i}",
+    // FLOATS
+    "x_firmware_offset",
+    source.x_firmware_offset,
+    "y_firmware_offset",
+    source.y_firmware_offset,
+    "z_firmware_offset",
+    source.z_firmware_offset,
+    "e",
+    source.e,
+    "e_offset",
+    source.e_offset,
+    "e_relative",
+    source.e_relative,
+    "extrusion_length",
+    source.extrusion_length,
+    "extrusion_length_total",
+    source.extrusion_length_total,
+    "retraction_length",
+    source.retraction_length,
+    "deretraction_length",
+    source.deretraction_length,
+    // Bool (represented as an integer)
+    "is_extruding_start",
+    (long int)(source.is_extruding_start ? 1 : 0),
+    "is_extruding",
+    (long int)(source.is_extruding ? 1 : 0),
+    "is_primed",
+    (long int)(source.is_primed ? 1 : 0),
+    "is_retracting_start",
+    (long int)(source.is_retracting_start ? 1 : 0),
+    "is_retracting",
+    (long int)(source.is_retracting ? 1 : 0),
+    "is_retracted",
+    (long int)(source.is_retracted ? 1 : 0),
+    "is_partially_retracted",
+    (long int)(source.is_partially_retracted ? 1 : 0),
+    "is_deretracting_start",
+    (long int)(source.is_deretracting_start ? 1 : 0),
+    "is_deretracting",
+    (long int)(source.is_deretracting ? 1 : 0),
+    "is_deretracted",
+    (long int)(source.is_deretracted ? 1 : 0)
+  );
+  if (p_extruder == NULL)
+  {
+    std::string message = "extruder.to_py_dict: Unable to convert extruder value to a dict PyObject via Py_BuildValue.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return NULL;
+  }
+  return p_extruder;
+}
+
+PyObject* extruders_to_py_list(const extruder* p_extruders, const unsigned int num_extruders)
+{
+  //std::cout << "Building extruders py_object.\r\n";
+  PyObject* py_extruders = PyList_New(0);
+  if (py_extruders == NULL)
+  {
+    std::string message = "Error executing Extruder.build_py_object: Unable to create Extruder PyList object.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return NULL;
+  }
+
+  // Create each snapshot plan
+  for (unsigned int index = 0; index < num_extruders; index++)
+  {
+    PyObject* py_extruder = to_py_tuple(p_extruders[index]);
+    if (py_extruder == NULL)
+    {
+      return NULL;
+    }
+    bool success = !(PyList_Append(py_extruders, py_extruder) < 0); // reference to pSnapshotPlan stolen
+    if (!success)
+    {
+      std::string message =
+        "Error executing Extruder.build_py_object Unable to append the extruder to the extruders list.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return NULL;
+    }
+    // Need to decref after PyList_Append, since it increfs the PyObject
+    Py_DECREF(py_extruder);
+  }
+
+  return py_extruders;
+}
+
+PyObject* value_to_py_object(const parsed_command_parameter& source)
+{
+  PyObject* ret_val;
+  // check the parameter type
+  if (source.value_type == 'F')
+  {
+    ret_val = PyFloat_FromDouble(source.double_value);
+    if (ret_val == NULL)
+    {
+      std::string message = "parsedCommandParameter.value_to_py_object: Unable to convert double value to a PyObject.";
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
+  }
+  else if (source.value_type == 'N')
+  {
+    // None Type
+    Py_INCREF(Py_None);
+    ret_val = Py_None;
+  }
+  else if (source.value_type == 'S')
+  {
+    ret_val = PyUnicode_SafeFromString(source.string_value.c_str());
+    if (ret_val == NULL)
+    {
+      std::string message = "parsedCommandParameter.value_to_py_object: Unable to convert string value to a PyObject.";
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
+  }
+  else if (source.value_type == 'U')
+  {
+    ret_val = PyLong_FromUnsignedLong(source.unsigned_long_value);
+    if (ret_val == NULL)
+    {
+      std::string message =
+        "parsedCommandParameter.value_to_py_object: Unable to convert unsigned long value to a PyObject.";
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
+  }
+  else
+  {
+    std::string message = "The command parameter value type does not exist.  Value Type: ";
+    message += source.value_type;
+    octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::ERROR, message);
+    // There has been an error, we don't support this value_type!
+    return NULL;
+  }
+
+  return ret_val;
+}
+
+PyObject* to_py_object(const parsed_command& source)
+{
+  PyObject* ret_val;
+  PyObject* pyCommandName = PyUnicode_SafeFromString(source.command.c_str());
+
+  if (pyCommandName == NULL)
+  {
+    std::string message = "Unable to convert the parameter name to unicode: ";
+    message += source.command;
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
+  }
+  PyObject* pyGcode = PyUnicode_SafeFromString(source.gcode.c_str());
+  if (pyGcode == NULL)
+  {
+    std::string message = "Unable to convert the gcode to unicode: ";
+    message += source.gcode;
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
+  }
+
+  PyObject* pyComment = PyUnicode_SafeFromString(source.comment.c_str());
+  if (pyComment == NULL)
+  {
+    std::string message = "Unable to convert the gocde comment to unicode: ";
+    message += source.comment;
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
+  }
+
+  if (source.parameters.empty())
+  {
+    ret_val = PyTuple_Pack(4, pyCommandName, Py_None, pyGcode, pyComment);
+    if (ret_val == NULL)
+    {
+      std::string message = "Unable to convert the parsed_command (no parameters) to a tuple.  Command: ";
+      message += source.command;
+      message += " Gcode: ";
+      message += source.gcode;
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
+    // We will need to decref pyCommandName and pyGcode later
+  }
+  else
+  {
+    PyObject* pyParametersDict = PyDict_New();
+
+    // Create the parameters dictionary
+    if (pyParametersDict == NULL)
+    {
+      std::string message = "ParsedCommand.to_py_object: Unable to create the parameters dict.";
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
+    // Loop through our parameters vector and create and add PyDict items
+    for (unsigned int index = 0; index < source.parameters.size(); index++)
+    {
+      parsed_command_parameter param = source.parameters[index];
+      PyObject* param_value = value_to_py_object(param);
+      // Errors here will be handled by value_to_py_object, just return NULL
+      if (param_value == NULL)
+      {
+        return NULL;
+      }
+      if (PyDict_SetItemString(pyParametersDict, param.name.c_str(), param_value) != 0)
+      {
+        // Handle error here, display detailed message
+        std::string message = "Unable to add the command parameter to the parameters dictionary.  Parameter Name: ";
+        message += param.name;
+        message += " Value Type: ";
+        message += param.value_type;
+        message += " Value: ";
+
+        switch (param.value_type)
+        {
+        case 'S':
+          message += param.string_value;
+          break;
+        case 'N':
+          message += "None";
+          break;
+        case 'F':
+          {
+            std::ostringstream doubld_str;
+            doubld_str << param.double_value;
+            message += doubld_str.str();
+            message += param.string_value;
+          }
+          break;
+        case 'U':
+          {
+            std::ostringstream unsigned_strs;
+            unsigned_strs << param.unsigned_long_value;
+            message += unsigned_strs.str();
+            message += param.string_value;
+          }
+          break;
+        default:
+          break;
+        }
+        octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+        return NULL;
+      }
+      // Todo: evaluate the effects of this
+      Py_DECREF(param_value);
+    }
+
+    ret_val = PyTuple_Pack(4, pyCommandName, pyParametersDict, pyGcode, pyComment);
+    if (ret_val == NULL)
+    {
+      std::string message = "Unable to convert the parsed_command (with parameters) to a tuple.  Command: ";
+      message += source.command;
+      message += " Gcode: ";
+      message += source.gcode;
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
+    // PyTuple_Pack makes a reference of its own, decref pyParametersDict.  
+    // We will need to decref pyCommandName and pyGcode later
+    // Todo: evaluate the effects of this
+    Py_DECREF(pyParametersDict);
+  }
+  // If we're here, we need to decref pyCommandName and pyGcode.
+  // Todo: evaluate the effects of this
+  Py_DECREF(pyCommandName);
+  // Todo: evaluate the effects of this
+  Py_DECREF(pyGcode);
+  Py_DECREF(pyComment);
+  return ret_val;
+}
+
+PyObject* to_py_tuple(const position& source)
+{
+  //std::cout << "Building position py_object.\r\n";
+  PyObject* py_command;
+  if (source.command.is_empty)
+  {
+    py_command = Py_None;
+  }
+  else
+  {
+    py_command = to_py_object(source.command);
+    if (py_command == NULL)
+    {
+      return NULL;
+    }
+  }
+  PyObject* py_extruders = extruders_to_py_list(source.p_extruders, source.num_extruders);
+  if (py_extruders == NULL)
+  {
+    return NULL;
+  }
+  //std::cout << "Building position py_tuple.\r\n";
+  PyObject* pyPosition = Py_BuildValue(
+    // ReSharper disable once StringLiteralTypo
+    "ddddddddddddddddddllllllllllllllllllllllllllllllllllllllLLLOOdd",
+    // Floats
+    source.x, // 0
+    source.y, // 1
+    source.z, // 2
+    source.f, // 3
+    source.x_offset, // 4
+    source.y_offset, // 5
+    source.z_offset, // 6
+    source.x_firmware_offset, // 7
+    source.y_firmware_offset, // 8
+    source.z_firmware_offset, // 9
+    source.z_relative, // 10
+    source.last_extrusion_height, // 11
+    source.height, // 12
+    0.0, // 13 - Firmware Retraction Length
+    0.0, // 14 - Firmware Unretraction Additional Length
+    0.0, // 15 - Firmware Retraction Feedrate
+    0.0, // 16 - Firmware Unretraction Feedrate
+    0.0, // 17 - Firmware Unretraction ZLift
+    // Int
+    source.layer, // 18
+    source.height_increment, // 19 !!!!!!!!!
+    source.height_increment_change_count, // 20 !!!!!!
+    source.current_tool, // 21
+    source.num_extruders, // 22
+    // Bool (represented as an integer)
+    (long int)(source.x_homed ? 1 : 0), // 23
+    (long int)(source.y_homed ? 1 : 0), // 24
+    (long int)(source.z_homed ? 1 : 0), // 25
+    (long int)(source.is_relative ? 1 : 0), // 26
+    (long int)(source.is_extruder_relative ? 1 : 0), // 27
+    (long int)(source.is_metric ? 1 : 0), // 28
+    (long int)(source.is_printer_primed ? 1 : 0), // 29
+    (long int)(source.has_definite_position ? 1 : 0), // 30
+    (long int)(source.is_layer_change ? 1 : 0), // 31
+    (long int)(source.is_height_change ? 1 : 0), // 32
+    (long int)(source.is_height_increment_change ? 1 : 0), // 33
+    (long int)(source.is_xy_travel ? 1 : 0), // 34
+    (long int)(source.is_xyz_travel ? 1 : 0), // 35
+    (long int)(source.is_zhop ? 1 : 0), // 36
+    (long int)(source.has_xy_position_changed ? 1 : 0), // 37
+    (long int)(source.has_position_changed ? 1 : 0), // 38
+    (long int)(source.has_received_home_command ? 1 : 0), // 39
+    (long int)(source.is_in_position ? 1 : 0), // 40
+    (long int)(source.in_path_position ? 1 : 0), // 41
+    (long int)(source.is_in_bounds ? 1 : 0), // 42
+    // Null bool, represented as integers
+    (long int)(source.x_null ? 1 : 0), // 43
+    (long int)(source.y_null ? 1 : 0), // 44
+    (long int)(source.z_null ? 1 : 0), // 45
+    (long int)(source.f_null ? 1 : 0), // 46
+    (long int)(source.is_relative_null ? 1 : 0), // 47
+    (long int)(source.is_extruder_relative_null ? 1 : 0), // 48
+    (long int)(source.last_extrusion_height_null ? 1 : 0), // 49
+    (long int)(source.is_metric_null ? 1 : 0), // 50
+    (long int)(true ? 1 : 0), // 51 - Firmware retraction length null
+    (long int)(true ? 1 : 0), // 52 - Firmware unretraction additional length null
+    (long int)(true ? 1 : 0), // 53 - Firmware retraction feedrate null
+    (long int)(true ? 1 : 0), // 54 - Firmware unretraction feedrate null
+    (long int)(true ? 1 : 0), // 55 - Firmware ZLift Null
+    // file statistics
+    source.file_line_number, // 56
+    source.gcode_number, // 57
+    source.file_position, // 58
+    // Objects
+    py_command, // 59
+    py_extruders, // 60
+    // In path intersection
+    source.in_path_x, // 61
+    source.in_path_y // 62
+
+  );
+  if (pyPosition == NULL)
+  {
+    //std::cout << "No py_object returned for position!\r\n";
+    std::string message =
+      "position.to_py_tuple: Unable to convert position value to a PyObject tuple via Py_BuildValue.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return NULL;
+  }
+  //std::cout << "Finished building pyPosition.\r\n";
+  Py_DECREF(py_command);
+  Py_DECREF(py_extruders);
+  //std::cout << "Returning pyPosition.\r\n";
+  return pyPosition;
+}
+
+PyObject* to_py_dict(const position& source)
+{
+  PyObject* py_command;
+  if (source.command.command.length() == 0)
+  {
+    py_command = Py_None;
+  }
+  else
+  {
+    py_command = to_py_object(source.command);
+  }
+  PyObject* py_extruders = extruders_to_py_list(source.p_extruders, source.num_extruders);
+  if (py_extruders == NULL)
+  {
+    return NULL;
+  }
+  PyObject* p_position = Py_BuildValue(
+    "{s:O,s:O,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:d,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:i,s:L,s:L,s:L,s:i,s:d,s:d}",
+    "parsed_command",
+    py_command,
+    "extruders",
+    py_extruders,
+    // FLOATS
+    "x_firmware_offset",
+    source.x_firmware_offset,
+    "y_firmware_offset",
+    source.y_firmware_offset,
+    "z_firmware_offset",
+    source.z_firmware_offset,
+    "x",
+    source.x,
+    "y",
+    source.y,
+    "z",
+    source.z,
+    "f",
+    source.f,
+    "e",
+    source.x_offset,
+    "y_offset",
+    source.y_offset,
+    "z_offset",
+    source.z_offset,
+    "last_extrusion_height",
+    source.last_extrusion_height,
+    "height",
+    source.height,
+    "firmware_retraction_length",
+    0.0,
+    "firmware_unretraction_additional_length",
+    0.0,
+    "firmware_retraction_feedrate",
+    0.0,
+    "firmware_unretraction_feedrate",
+    0.0,
+    "firmware_z_lift",
+    0.0,
+    "z_relative",
+    source.z_relative,
+    // Ints
+    "layer",
+    source.layer,
+    "height_increment",
+    source.height_increment,
+    "height_increment_change_count",
+    source.height_increment_change_count,
+    "current_tool",
+    source.current_tool,
+    "num_extruders",
+    source.num_extruders,
+    "feature_type_tag",
+    source.feature_type_tag,
+    // Bools
+    "x_null",
+    (long int)(source.x_null ? 1 : 0),
+    "y_null",
+    (long int)(source.y_null ? 1 : 0),
+    "z_null",
+    (long int)(source.z_null ? 1 : 0),
+    "f_null",
+    (long int)(source.f_null ? 1 : 0),
+    "x_homed",
+    (long int)(source.x_homed ? 1 : 0),
+    "y_homed",
+    (long int)(source.y_homed ? 1 : 0),
+    "z_homed",
+    (long int)(source.z_homed ? 1 : 0),
+    "is_relative",
+    (long int)(source.is_relative ? 1 : 0),
+    "is_relative_null",
+    (long int)(source.is_relative_null ? 1 : 0),
+    "is_extruder_relative",
+    (long int)(source.is_extruder_relative ? 1 : 0),
+    "is_extruder_relative_null",
+    (long int)(source.is_extruder_relative_null ? 1 : 0),
+    "is_metric",
+    (long int)(source.is_metric ? 1 : 0),
+    "is_metric_null",
+    (long int)(source.is_metric_null ? 1 : 0),
+    "is_printer_primed",
+    (long int)(source.is_printer_primed ? 1 : 0),
+    "last_extrusion_height_null",
+    (long int)(source.last_extrusion_height_null ? 1 : 0),
+    "firmware_retraction_length_null",
+    (long int)(false ? 1 : 0),
+    "firmware_unretraction_additional_length_null",
+    (long int)(false ? 1 : 0),
+    "firmware_retraction_feedrate_null",
+    (long int)(false ? 1 : 0),
+    "firmware_unretraction_feedrate_null",
+    (long int)(false ? 1 : 0),
+    "firmware_z_lift_null",
+    (long int)(false ? 1 : 0),
+    "has_position_error",
+    (long int)(false ? 1 : 0),
+    "has_definite_position",
+    (long int)(source.has_definite_position ? 1 : 0),
+    "is_layer_change",
+    (long int)(source.is_layer_change ? 1 : 0),
+    "is_height_change",
+    (long int)(source.is_height_change ? 1 : 0),
+    "is_height_increment_change",
+    (long int)(source.is_height_increment_change ? 1 : 0),
+    "is_xy_travel",
+    (long int)(source.is_xy_travel ? 1 : 0),
+    "is_xyz_travel",
+    (long int)(source.is_xyz_travel ? 1 : 0),
+    "is_zhop",
+    (long int)(source.is_zhop ? 1 : 0),
+    "has_xy_position_changed",
+    (long int)(source.has_xy_position_changed ? 1 : 0),
+    "has_position_changed",
+    (long int)(source.has_position_changed ? 1 : 0),
+    "has_received_home_command",
+    (long int)(source.has_received_home_command ? 1 : 0),
+    "is_in_position",
+    (long int)(source.is_in_position ? 1 : 0),
+    "in_path_position",
+    (long int)(source.in_path_position ? 1 : 0),
+    "file_line_number",
+    source.file_line_number,
+    "file_position",
+    source.file_position,
+    "gcode_number",
+    source.gcode_number,
+    "is_in_bounds",
+    (long int)(source.is_in_bounds ? 1 : 0),
+    "in_path_x",
+    source.in_path_x,
+    "in_path_y",
+    source.in_path_y
+  );
+  if (p_position == NULL)
+  {
+    std::string message = "position.to_py_dict: Unable to convert position value to a dict PyObject via Py_BuildValue.";
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+    return NULL;
+  }
+  Py_DECREF(py_command);
+  Py_DECREF(py_extruders);
+
+  return p_position;
+}
+
+PyObject* to_py_object(const snapshot_plan_step& source)
+{
+  PyObject* py_x;
+  if (source.p_x == NULL)
+  {
+    py_x = Py_None;
+    Py_IncRef(py_x);
+  }
+  else
+  {
+    py_x = PyFloat_FromDouble(*source.p_x);
+  }
+  if (py_x == NULL)
+  {
+    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the X value to a python object.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+
+  PyObject* py_y;
+  if (source.p_y == NULL)
+  {
+    py_y = Py_None;
+    Py_IncRef(py_y);
+  }
+  else
+  {
+    py_y = PyFloat_FromDouble(*source.p_y);
+  }
+  if (py_y == NULL)
+  {
+    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the Y value to a python object.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+
+  PyObject* py_z;
+  if (source.p_z == NULL)
+  {
+    py_z = Py_None;
+    Py_IncRef(py_z);
+  }
+  else
+  {
+    py_z = PyFloat_FromDouble(*source.p_z);
+  }
+  if (py_z == NULL)
+  {
+    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the Z value to a python object.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+
+  PyObject* py_e;
+  if (source.p_e == NULL)
+  {
+    py_e = Py_None;
+    Py_IncRef(py_e);
+  }
+  else
+  {
+    py_e = PyFloat_FromDouble(*source.p_e);
+  }
+  if (py_e == NULL)
+  {
+    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the E value to a python object.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+
+  PyObject* py_f;
+  if (source.p_f == NULL)
+  {
+    py_f = Py_None;
+    Py_IncRef(py_f);
+  }
+  else
+  {
+    py_f = PyFloat_FromDouble(*source.p_f);
+  }
+  if (py_f == NULL)
+  {
+    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the F value to a python object.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+
+  PyObject* py_step = Py_BuildValue("sOOOOO", source.action.c_str(), py_x, py_y, py_z, py_e, py_f);
+  if (py_step == NULL)
+  {
+    std::string message = "snapshot_plan_step.to_py_object: Unable to create the snapshot plan step PyObject.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  Py_DecRef(py_x);
+  Py_DecRef(py_y);
+  Py_DecRef(py_z);
+  Py_DecRef(py_e);
+  Py_DecRef(py_f);
+  return py_step;
+}
+
+PyObject* gcodes_to_py_list(const std::vector<std::string>& gcodes)
+{
+  PyObject* py_gcodes = PyList_New(0);
+  if (py_gcodes == NULL)
+  {
+    std::string message = "snapshot_gcode.build_py_list: Unable to create the gcode PyList object.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  for (unsigned int index = 0; index < gcodes.size(); index++)
+  {
+    PyObject* py_gcode = PyUnicode_SafeFromString(gcodes[index]);
+    if (py_gcode == NULL)
+    {
+      std::string message = "snapshot_gcode.build_py_list: Unable to convert the gcode to unicode: ";
+      message += gcodes[index];
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      Py_DECREF(py_gcodes);
+      return NULL;
+    }
+    bool success = !(PyList_Append(py_gcodes, py_gcode) < 0);
+    // Need to decref after PyList_Append, since it increfs the PyObject
+    Py_DECREF(py_gcode);
+    if (!success)
+    {
+      std::string message = "snapshot_gcode.build_py_list: Unable to append the gcode to the gcode list.";
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      Py_DECREF(py_gcodes);
+      return NULL;
+    }
+  }
+  return py_gcodes;
+}
+
+PyObject* to_py_object(const snapshot_gcode& source)
+{
+  PyObject* py_initialization_gcode = gcodes_to_py_list(source.initialization_gcode);
+  if (py_initialization_gcode == NULL)
+  {
+    return NULL;
+  }
+  PyObject* py_start_gcode = gcodes_to_py_list(source.start_gcode);
+  if (py_start_gcode == NULL)
+  {
+    Py_DECREF(py_initialization_gcode);
+    return NULL;
+  }
+  PyObject* py_snapshot_commands = gcodes_to_py_list(source.snapshot_commands);
+  if (py_snapshot_commands == NULL)
+  {
+    Py_DECREF(py_initialization_gcode);
+    Py_DECREF(py_start_gcode);
+    return NULL;
+  }
+  PyObject* py_return_commands = gcodes_to_py_list(source.return_commands);
+  if (py_return_commands == NULL)
+  {
+    Py_DECREF(py_initialization_gcode);
+    Py_DECREF(py_start_gcode);
+    Py_DECREF(py_snapshot_commands);
+    return NULL;
+  }
+  PyObject* py_end_gcode = gcodes_to_py_list(source.end_gcode);
+  if (py_end_gcode == NULL)
+  {
+    Py_DECREF(py_initialization_gcode);
+    Py_DECREF(py_start_gcode);
+    Py_DECREF(py_snapshot_commands);
+    Py_DECREF(py_return_commands);
+    return NULL;
+  }
+
+  // The N format code steals the list references
+  PyObject* py_snapshot_gcode = Py_BuildValue(
+    "NNNNN",
+    py_initialization_gcode,
+    py_start_gcode,
+    py_snapshot_commands,
+    py_return_commands,
+    py_end_gcode
+  );
+  if (py_snapshot_gcode == NULL)
+  {
+    std::string message =
+      "Error executing snapshot_gcode.to_py_object: Unable to create the snapshot gcode PyObject with the Py_BuildValue function.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  return py_snapshot_gcode;
+}
+
+PyObject* snapshot_plans_to_py_list(const std::vector<snapshot_plan>& p_plans)
+{
+  PyObject* py_snapshot_plans = PyList_New(0);
+  if (py_snapshot_plans == NULL)
+  {
+    PyErr_SetString(PyExc_ValueError,
+                    "Error executing SnapshotPlan.build_py_object: Unable to create SnapshotPlans PyList object.");
+    return NULL;
+  }
+
+  // Create each snapshot plan
+  for (unsigned int plan_index = 0; plan_index < p_plans.size(); plan_index++)
+  {
+    PyObject* py_snapshot_plan = to_py_object(p_plans[plan_index]);
+    if (py_snapshot_plan == NULL)
+    {
+      //PyErr_SetString(PyExc_ValueError, "Error executing SnapshotPlan.build_py_object: Unable to convert the snapshot plan to a PyObject.");
+      return NULL;
+    }
+    bool success = !(PyList_Append(py_snapshot_plans, py_snapshot_plan) < 0); // reference to pSnapshotPlan stolen
+    if (!success)
+    {
+      PyErr_SetString(PyExc_ValueError,
+                      "Error executing SnapshotPlan.build_py_object: Unable to append the snapshot plan to the snapshot plan list.");
+      return NULL;
+    }
+    // Need to decref after PyList_Append, since it increfs the PyObject
+    Py_DECREF(py_snapshot_plan);
+    //std::cout << "py_snapshot_plan refcount = " << py_snapshot_plan->ob_refcnt << "\r\n";
+  }
+
+  return py_snapshot_plans;
+}
+
+PyObject* to_py_object(const snapshot_plan& source)
+{
+  //std::cout << "Building Snapshot Plan Pyobject.\r\n";
+  PyObject* py_triggering_command;
+
+  if (source.triggering_command.is_empty)
+  {
+    py_triggering_command = Py_None;
+    Py_IncRef(py_triggering_command);
+  }
+  else
+  {
+    py_triggering_command = to_py_object(source.triggering_command);
+    if (py_triggering_command == NULL)
+    {
+      return NULL;
+    }
+  }
+
+
+  PyObject* py_start_command = NULL;
+  if (source.start_command.is_empty)
+  {
+    py_start_command = Py_None;
+    Py_IncRef(Py_None);
+  }
+  else
+  {
+    py_start_command = to_py_object(source.start_command);
+    if (py_start_command == NULL)
+    {
+      return NULL;
+    }
+  }
+  //std::cout << "Building initial position..\r\n";
+  PyObject* py_initial_position;
+  if (!source.has_initial_position)
+  {
+    py_initial_position = Py_None;
+    Py_IncRef(py_initial_position);
+  }
+  else
+  {
+    py_initial_position = to_py_tuple(source.initial_position);
+    if (py_initial_position == NULL)
+    {
+      return NULL;
+    }
+  }
+  //std::cout << "Building snapshot plan steps.\r\n";
+  PyObject* py_steps = PyList_New(0);
+  if (py_steps == NULL)
+  {
+    return NULL;
+  }
+  for (unsigned int step_index = 0; step_index < source.steps.size(); step_index++)
+  {
+    // create the snapshot step object with build
+    PyObject* py_step = to_py_object(source.steps[step_index]);
+    if (py_step == NULL)
+    {
+      return NULL;
+    }
+    bool success = !(PyList_Append(py_steps, py_step) < 0); // reference to pSnapshotPlan stolen
+    if (!success)
+    {
+      std::string message =
+        "Error executing SnapshotPlan.to_py_object: Unable to append the snapshot plan step to the snapshot plan step list via the PyList_Append method.";
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      return NULL;
+    }
+    // Need to decref after PyList_Append, since it increfs the PyObject
+    Py_DECREF(py_step);
+  }
+
+  PyObject* py_return_position;
+  if (source.return_position.is_empty)
+  {
+    py_return_position = Py_None;
+    Py_IncRef(py_return_position);
+  }
+  else
+  {
+    py_return_position = to_py_tuple(source.return_position);
+    if (py_return_position == NULL)
+    {
+      return NULL;
+    }
+  }
+
+  PyObject* py_end_command;
+  if (source.end_command.is_empty)
+  {
+    py_end_command = Py_None;
+    Py_IncRef(py_end_command);
+  }
+  else
+  {
+    py_end_command = to_py_object(source.end_command);
+    if (py_end_command == NULL)
+    {
+      return NULL;
+    }
+  }
+  PyObject* py_gcode;
+  if (source.gcode.is_empty())
+  {
+    py_gcode = Py_None;
+    Py_IncRef(py_gcode);
+  }
+  else
+  {
+    py_gcode = to_py_object(source.gcode);
+    if (py_gcode == NULL)
+    {
+      return NULL;
+    }
+  }
+  PyObject* py_snapshot_plan = Py_BuildValue(
+    "LLLddOOOOOOO",
+    source.file_line,
+    source.file_gcode_number,
+    source.file_position,
+    source.total_travel_distance,
+    source.saved_travel_distance,
+    py_triggering_command,
+    py_start_command,
+    py_initial_position,
+    py_steps,
+    py_return_position,
+    py_end_command,
+    py_gcode
+  );
+  if (py_snapshot_plan == NULL)
+  {
+    std::string message =
+      "Error executing SnapshotPlan.to_py_object: Unable to create SnapshotPlan PyObject with the Py_BuildValue function.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+
+  Py_DECREF(py_triggering_command);
+  Py_DECREF(py_initial_position);
+  Py_DECREF(py_return_position);
+  Py_DECREF(py_steps);
+  Py_DECREF(py_start_command);
+  Py_DECREF(py_end_command);
+  Py_DECREF(py_gcode);
+
+  return py_snapshot_plan;
+}
+
+PyObject* to_py_object(const stabilization_quality_issue& source)
+{
+  PyObject* py_results = Py_BuildValue("(l,s)", static_cast<int>(source.issue_type), source.description.c_str());
+  if (py_results == NULL)
+  {
+    std::string message =
+      "stabilization_quality_issue.to_py_object - Unable to create a Tuple from a stabilization_quality_issue.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  return py_results;
+}
+
+PyObject* to_py_object(const stabilization_processing_issue& source)
+{
+  PyObject* py_replacement_tokens_dict = PyDict_New();
+  if (py_replacement_tokens_dict == NULL)
+  {
+    std::string message =
+      "Error executing stabilization_processing_issue.build_py_object: Unable to create issue replacement token PyDict object.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  // Create each replacement token
+  for (std::vector<replacement_token>::const_iterator it = source.replacement_tokens.begin(); it != source.replacement_tokens.end();
+       ++it)
+  {
+    PyObject* py_replacement_value = PyString_SafeFromString((*it).value.c_str());
+    if (py_replacement_value == NULL)
+    {
+      std::string message =
+        "Error executing stabilization_processing_issue.build_py_object: Unable to create issue replacement token value PyString object from the token value string.";
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      return NULL;
+    }
+
+    bool success = !(PyDict_SetItemString(py_replacement_tokens_dict, (*it).key.c_str(), py_replacement_value) < 0);
+    // reference to pSnapshotPlan stolen
+    if (!success)
+    {
+      std::string message =
+        "Error executing stabilization_processing_issue.build_py_object: Unable to append the issue replacement token to the to the replacement tokens dict.";
+      octolapse_log_exception(octolapse_log::GCODE_POSITION, message);
+      return NULL;
+    }
+    // Need to decref after PyList_Append, since it increfs the PyObject
+    Py_DECREF(py_replacement_value);
+  }
+  PyObject* py_results = Py_BuildValue("(l,s,O)", static_cast<int>(source.issue_type), source.description.c_str(),
+                                       py_replacement_tokens_dict);
+  if (py_results == NULL)
+  {
+    std::string message =
+      "stabilization_processing_issue.to_py_object - Unable to create a Tuple from a stabilization_processing_issue.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  return py_results;
+}
+
+PyObject* to_py_object(const stabilization_results& source)
+{
+  PyObject* py_snapshot_plans = snapshot_plans_to_py_list(source.snapshot_plans);
+  if (py_snapshot_plans == NULL)
+  {
+    return NULL;
+  }
+
+  // Create stabilization quality issues list
+  PyObject* py_quality_issues = PyList_New(0);
+  if (py_quality_issues == NULL)
+  {
+    std::string message = "stabilization_results.to_py_object - Unable to create py_issues PyList object.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+
+  // Create each quality issue and append to list
+  for (unsigned int issue_index = 0; issue_index < source.quality_issues.size(); issue_index++)
+  {
+    PyObject* py_issue = to_py_object(source.quality_issues[issue_index]);
+    if (py_issue == NULL)
+    {
+      return NULL;
+    }
+    bool success = !(PyList_Append(py_quality_issues, py_issue) < 0); // reference to pSnapshotPlan stolen
+    if (!success)
+    {
+      std::string message =
+        "stabilization_results.to_py_object - Unable to append the quality issue to the quality issues list.";
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      return NULL;
+    }
+    // Need to decref after PyList_Append, since it increfs the PyObject
+    Py_DECREF(py_issue);
+  }
+
+  // Create each processing issue and append to list
+  PyObject* py_processing_issues = PyList_New(0);
+  for (unsigned int issue_index = 0; issue_index < source.processing_issues.size(); issue_index++)
+  {
+    PyObject* py_issue = to_py_object(source.processing_issues[issue_index]);
+    if (py_issue == NULL)
+    {
+      return NULL;
+    }
+    bool success = !(PyList_Append(py_processing_issues, py_issue) < 0); // reference to pSnapshotPlan stolen
+    if (!success)
+    {
+      std::string message =
+        "stabilization_results.to_py_object - Unable to append the processing issue to the quality issues list.";
+      octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+      return NULL;
+    }
+    // Need to decref after PyList_Append, since it increfs the PyObject
+    Py_DECREF(py_issue);
+  }
+
+  PyObject* py_results = Py_BuildValue("(O,d,L,L,i,O,O)", py_snapshot_plans, source.seconds_elapsed, source.gcodes_processed,
+                                       source.lines_processed, source.missed_layer_count, py_quality_issues, py_processing_issues);
+  if (py_results == NULL)
+  {
+    std::string message = "stabilization_results.to_py_object - Unable to create a Tuple from the snapshot plan list.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  Py_DECREF(py_snapshot_plans);
+  Py_DECREF(py_quality_issues);
+  Py_DECREF(py_processing_issues);
+
+  return py_results;
+}
+
+PyObject* to_py_object(const slicer_settings_result& source)
+{
+  PyObject* py_settings = PyList_New(0);
+  if (py_settings == NULL)
+  {
+    std::string message = "slicer_settings_result.to_py_object: Unable to create the settings list.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
+  }
+  for (unsigned int index = 0; index < source.settings.size(); index++)
+  {
+    // Slicers don't always write utf-8, so replace anything that can't be decoded.
+    PyObject* py_setting = Py_BuildValue(
+      "(NN)",
+      PyUnicode_DecodeUTF8(source.settings[index].first.c_str(), source.settings[index].first.size(), "replace"),
+      PyUnicode_DecodeUTF8(source.settings[index].second.c_str(), source.settings[index].second.size(), "replace")
+    );
+    if (py_setting == NULL || PyList_Append(py_settings, py_setting) != 0)
+    {
+      Py_XDECREF(py_setting);
+      Py_DECREF(py_settings);
+      std::string message = "slicer_settings_result.to_py_object: Unable to add a setting to the settings list.";
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
+    Py_DECREF(py_setting);
+  }
+
+  PyObject* py_lines = PyList_New(0);
+  if (py_lines == NULL)
+  {
+    Py_DECREF(py_settings);
+    std::string message = "slicer_settings_result.to_py_object: Unable to create the lines list.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
+  }
+  for (unsigned int index = 0; index < source.lines.size(); index++)
+  {
+    PyObject* py_line = PyUnicode_DecodeUTF8(source.lines[index].c_str(), source.lines[index].size(), "replace");
+    if (py_line == NULL || PyList_Append(py_lines, py_line) != 0)
+    {
+      Py_XDECREF(py_line);
+      Py_DECREF(py_settings);
+      Py_DECREF(py_lines);
+      std::string message = "slicer_settings_result.to_py_object: Unable to add a line to the lines list.";
+      octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+      return NULL;
+    }
+    Py_DECREF(py_line);
+  }
+
+  PyObject* py_result = Py_BuildValue("{s:N,s:N}", "settings", py_settings, "lines", py_lines);
+  if (py_result == NULL)
+  {
+    std::string message = "slicer_settings_result.to_py_object: Unable to create the result dict.";
+    octolapse_log_exception(octolapse_log::GCODE_PARSER, message);
+    return NULL;
+  }
+  return py_result;
+}
+
+PyObject* to_py_tuple(const snapshot_trigger_state& source, const int trigger_count, const bool snapshots_enabled)
+{
+  PyObject* py_state = Py_BuildValue(
+    "llllllllllllllllldldldl",
+    (long int)(source.is_triggered ? 1 : 0), // 0
+    (long int)source.trigger_type, // 1
+    (long int)(source.is_in_position ? 1 : 0), // 2
+    (long int)(source.in_path_position ? 1 : 0), // 3
+    (long int)(source.is_waiting ? 1 : 0), // 4
+    (long int)(source.is_home_position_wait ? 1 : 0), // 5
+    (long int)(source.is_waiting_on_zhop ? 1 : 0), // 6
+    (long int)(source.is_waiting_on_extruder ? 1 : 0), // 7
+    (long int)(source.has_changed ? 1 : 0), // 8
+    (long int)(source.has_definite_position ? 1 : 0), // 9
+    (long int)trigger_count, // 10
+    (long int)(snapshots_enabled ? 1 : 0), // 11
+    (long int)source.current_increment, // 12
+    (long int)(source.is_layer_change_wait ? 1 : 0), // 13
+    (long int)(source.is_height_change ? 1 : 0), // 14
+    (long int)(source.is_height_change_wait ? 1 : 0), // 15
+    source.layer, // 16
+    source.seconds_to_trigger, // 17
+    (long int)(source.seconds_to_trigger_null ? 1 : 0), // 18
+    source.trigger_start_time, // 19
+    (long int)(source.trigger_start_time_null ? 1 : 0), // 20
+    source.pause_time, // 21
+    (long int)(source.pause_time_null ? 1 : 0) // 22
+  );
+  if (py_state == NULL)
+  {
+    std::string message =
+      "snapshot_trigger_state.to_py_tuple: Unable to convert the trigger state to a PyObject tuple via Py_BuildValue.";
+    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
+    return NULL;
+  }
+  return py_state;
+}
+PyObject* state_to_py_tuple(const snapshot_trigger& source)
+{
+  return to_py_tuple(source.get_state(), source.get_trigger_count(), source.get_snapshots_enabled());
+}
+
+PyObject* to_py_object(const frame_preparer_results& source)
+{
+  PyObject* py_results = Py_BuildValue(
+    "{s:O,s:i,s:i,s:s}",
+    "success", source.success ? Py_True : Py_False,
+    "frames_written", source.frames_written,
+    "frames_failed", source.frames_failed,
+    "error", source.error.c_str()
+  );
+  if (py_results == NULL)
+  {
+    std::string message = "frame_preparer_results.to_py_object - Unable to create the results dict.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+  }
+  return py_results;
+}
+
+PyObject* to_py_object(const frame_registration_results& source)
+{
+  // offsets is a list of (x, y, confidence), one per frame
+  PyObject* py_offsets = PyList_New(static_cast<Py_ssize_t>(source.offsets.size()));
+  if (py_offsets == NULL)
+  {
+    std::string message = "frame_registration_results.to_py_object - Unable to create the offsets list.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+    return NULL;
+  }
+  for (size_t index = 0; index < source.offsets.size(); index++)
+  {
+    const frame_offset& offset = source.offsets[index];
+    PyObject* py_offset = Py_BuildValue("(ddd)", offset.x, offset.y, offset.confidence);
+    if (py_offset == NULL)
+    {
+      std::string message = "frame_registration_results.to_py_object - Unable to create an offset.";
+      octolapse_log_exception(octolapse_log::RENDER, message);
+      Py_DECREF(py_offsets);
+      return NULL;
+    }
+    // Steals the reference
+    PyList_SetItem(py_offsets, static_cast<Py_ssize_t>(index), py_offset);
+  }
+  PyObject* py_results = Py_BuildValue(
+    "{s:O,s:N,s:i,s:s}",
+    "success", source.success ? Py_True : Py_False,
+    "offsets", py_offsets,
+    "frames_unmatched", source.frames_unmatched,
+    "error", source.error.c_str()
+  );
+  if (py_results == NULL)
+  {
+    std::string message = "frame_registration_results.to_py_object - Unable to create the results dict.";
+    octolapse_log_exception(octolapse_log::RENDER, message);
+  }
+  return py_results;
+}
+
+#ifndef OCTOLAPSE_DISABLE_STATS
+static double to_seconds(long long nanoseconds)
+{
+  return static_cast<double>(nanoseconds) / 1000000000.0;
+}
+
+static bool set_dict_item(PyObject* py_dict, const char* key, PyObject* py_value)
+{
+  if (py_value == NULL)
+    return false;
+  const int error = PyDict_SetItemString(py_dict, key, py_value);
+  Py_DECREF(py_value);
+  return error == 0;
+}
+
+static PyObject* call_stats_to_py_object(const octolapse_stats_snapshot::call& stats)
+{
+  PyObject* py_histogram = PyList_New(0);
+  if (py_histogram == NULL)
+    return NULL;
+  for (int bucket = 0; bucket < OCTOLAPSE_STATS_HISTOGRAM_BUCKETS; bucket++)
+  {
+    const long long count = stats.histogram[bucket];
+    if (count == 0)
+      continue;
+    // Each bucket holds the calls shorter than its upper bound, and at least as long as the previous bound.
+    PyObject* py_bucket = Py_BuildValue("(dL)", to_seconds(2LL << bucket), count);
+    if (py_bucket == NULL || PyList_Append(py_histogram, py_bucket) != 0)
+    {
+      Py_XDECREF(py_bucket);
+      Py_DECREF(py_histogram);
+      return NULL;
+    }
+    Py_DECREF(py_bucket);
+  }
+  PyObject* py_stats = Py_BuildValue(
+    "{s:L,s:d,s:d,s:d,s:O}",
+    "count", stats.count,
+    "seconds", to_seconds(stats.nanoseconds),
+    "min_seconds", to_seconds(stats.min_nanoseconds),
+    "max_seconds", to_seconds(stats.max_nanoseconds),
+    "histogram", py_histogram
+  );
+  Py_DECREF(py_histogram);
+  return py_stats;
+}
+
+PyObject* octolapse_stats_to_py_object()
+{
+  octolapse_stats_snapshot stats;
+  octolapse_get_stats(stats);
+  PyObject* py_phases = PyDict_New();
+  PyObject* py_calls = PyDict_New();
+  PyObject* py_counters = PyDict_New();
+  PyObject* py_stats = NULL;
+  bool failed = py_phases == NULL || py_calls == NULL || py_counters == NULL;
+
+  for (int index = 0; !failed && index < octolapse_stats::NUM_PHASES; index++)
+  {
+    failed = !set_dict_item(py_phases, octolapse_stats_phase_name(index), Py_BuildValue(
+      "{s:L,s:d}", "count", stats.phases[index].count, "seconds", to_seconds(stats.phases[index].nanoseconds)
+    ));
+  }
+  for (int index = 0; !failed && index < octolapse_stats::NUM_CALLS; index++)
+    failed = !set_dict_item(py_calls, octolapse_stats_call_name(index), call_stats_to_py_object(stats.calls[index]));
+  for (int index = 0; !failed && index < octolapse_stats::NUM_COUNTERS; index++)
+    failed = !set_dict_item(py_counters, octolapse_stats_counter_name(index), PyLong_FromLongLong(stats.counters[index]));
+
+  if (!failed)
+  {
+    py_stats = Py_BuildValue(
+      "{s:O,s:O,s:O,s:O}",
+      "enabled", stats.enabled ? Py_True : Py_False,
+      "phases", py_phases,
+      "calls", py_calls,
+      "counters", py_counters
+    );
+  }
+  Py_XDECREF(py_phases);
+  Py_XDECREF(py_calls);
+  Py_XDECREF(py_counters);
+  if (py_stats == NULL)
+    octolapse_log_exception(octolapse_log::GCODE_POSITION, "PythonBindings.octolapse_stats_to_py_object - Unable to build the stats dict.");
+  return py_stats;
+}
+#endif
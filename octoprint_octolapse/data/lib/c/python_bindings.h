@@ -0,0 +1,82 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef PYTHON_BINDINGS_H
+#define PYTHON_BINDINGS_H
+#ifdef _DEBUG
+#undef _DEBUG
+#include <Python.h>
+#define _DEBUG
+#else
+#include <Python.h>
+#endif
+#include <string>
+#include <vector>
+#include "extruder.h"
+#include "frame_preparer.h"
+#include "frame_registration.h"
+#include "parsed_command.h"
+#include "position.h"
+#include "slicer_settings_extractor.h"
+#include "snapshot_gcode.h"
+#include "snapshot_plan.h"
+#include "snapshot_plan_step.h"
+#include "snapshot_trigger.h"
+#include "stabilization_results.h"
+
+// Conversions from the native types to the python objects expected by gcode_processor.py.  These are the only
+// functions that build python objects from the gcode engine's types, so the engine itself does not depend on Python.h.
+// Each returns a new reference, or NULL with the python error set.
+
+PyObject* to_py_tuple(const extruder& source);
+PyObject* to_py_dict(const extruder& source);
+PyObject* extruders_to_py_list(const extruder* p_extruders, unsigned int num_extruders);
+/**
+ * \brief Converts the parameter's value, the name is not included.
+ */
+PyObject* value_to_py_object(const parsed_command_parameter& source);
+PyObject* to_py_object(const parsed_command& source);
+PyObject* to_py_tuple(const position& source);
+PyObject* to_py_dict(const position& source);
+PyObject* to_py_object(const snapshot_plan_step& source);
+PyObject* gcodes_to_py_list(const std::vector<std::string>& gcodes);
+PyObject* to_py_object(const snapshot_gcode& source);
+PyObject* snapshot_plans_to_py_list(const std::vector<snapshot_plan>& p_plans);
+PyObject* to_py_object(const snapshot_plan& source);
+PyObject* to_py_object(const stabilization_quality_issue& source);
+PyObject* to_py_object(const stabilization_processing_issue& source);
+PyObject* to_py_object(const stabilization_results& source);
+PyObject* to_py_object(const slicer_settings_result& source);
+PyObject* to_py_tuple(const snapshot_trigger_state& source, int trigger_count, bool snapshots_enabled);
+/**
+ * \brief Converts the trigger's state, along with its trigger count and whether snapshots are enabled.
+ */
+PyObject* state_to_py_tuple(const snapshot_trigger& source);
+PyObject* to_py_object(const frame_preparer_results& source);
+PyObject* to_py_object(const frame_registration_results& source);
+#ifndef OCTOLAPSE_DISABLE_STATS
+/**
+ * \brief Returns a dict containing the phase times, counters and call latency histograms.
+ */
+PyObject* octolapse_stats_to_py_object();
+#endif
+#endif
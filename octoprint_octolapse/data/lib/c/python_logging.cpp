@@ -0,0 +1,309 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "python_logging.h"
+#include <string>
+#include "logging.h"
+#include "python_helpers.h"
+
+static bool octolapse_loggers_created = false;
+static PyObject* py_logging_module = NULL;
+static PyObject* py_logging_configurator_name = NULL;
+static PyObject* py_logging_configurator = NULL;
+static PyObject* py_octolapse_gcode_parser_logger = NULL;
+static PyObject* py_octolapse_gcode_position_logger = NULL;
+static PyObject* py_octolapse_snapshot_plan_logger = NULL;
+static PyObject* py_octolapse_render_logger = NULL;
+static PyObject* py_octolapse_snapshot_logger = NULL;
+static PyObject* py_info_function_name = NULL;
+static PyObject* py_warn_function_name = NULL;
+static PyObject* py_error_function_name = NULL;
+static PyObject* py_debug_function_name = NULL;
+static PyObject* py_verbose_function_name = NULL;
+static PyObject* py_critical_function_name = NULL;
+static PyObject* py_get_effective_level_function_name = NULL;
+
+
+static PyObject* get_py_logger(const int logger_type)
+{
+  switch (logger_type)
+  {
+  case octolapse_log::GCODE_PARSER:
+    return py_octolapse_gcode_parser_logger;
+  case octolapse_log::GCODE_POSITION:
+    return py_octolapse_gcode_position_logger;
+  case octolapse_log::SNAPSHOT_PLAN:
+    return py_octolapse_snapshot_plan_logger;
+  case octolapse_log::RENDER:
+    return py_octolapse_render_logger;
+  case octolapse_log::SNAPSHOT:
+    return py_octolapse_snapshot_logger;
+  default:
+    return NULL;
+  }
+}
+
+static PyObject* get_py_log_function_name(const int log_level)
+{
+  switch (log_level)
+  {
+  case octolapse_log::INFO:
+    return py_info_function_name;
+  case octolapse_log::WARNING:
+    return py_warn_function_name;
+  case octolapse_log::ERROR:
+    return py_error_function_name;
+  case octolapse_log::DEBUG:
+    return py_debug_function_name;
+  case octolapse_log::VERBOSE:
+    return py_verbose_function_name;
+  case octolapse_log::CRITICAL:
+    return py_critical_function_name;
+  default:
+    return NULL;
+  }
+}
+
+/**
+ * \brief Calls the python logger.  The GIL must be held, and no python error may be set.
+ */
+static bool send_to_python(PyObject* py_logger, PyObject* py_function_name, const std::string& message)
+{
+  PyObject* pyMessage = PyUnicode_SafeFromString(message);
+  if (pyMessage == NULL)
+  {
+    PyErr_Format(PyExc_ValueError,
+                 "Unable to convert the log message '%s' to a PyString/Unicode message.", message.c_str());
+    return false;
+  }
+  PyObject* ret_val = PyObject_CallMethodObjArgs(py_logger, py_function_name, pyMessage, NULL);
+  // We need to decref our message so that the GC can remove it.  Maybe?
+  Py_DECREF(pyMessage);
+  if (ret_val == NULL)
+  {
+    if (!PyErr_Occurred())
+      PyErr_SetString(PyExc_ValueError, "Logging.octolapse_log - unknown logger_type.");
+    return false;
+  }
+  Py_DECREF(ret_val);
+  return true;
+}
+
+/**
+ * \brief Sends the gcode engine's messages to the python loggers.
+ */
+class python_log_handler : public octolapse_log_handler
+{
+public:
+  python_log_handler()
+  {
+    error_type_ = NULL;
+    error_value_ = NULL;
+    error_traceback_ = NULL;
+  }
+
+  void begin_flush() override
+  {
+    gil_state_ = PyGILState_Ensure();
+    // Don't disturb any error that is about to be returned to python
+    PyErr_Fetch(&error_type_, &error_value_, &error_traceback_);
+  }
+
+  void end_flush() override
+  {
+    PyErr_Restore(error_type_, error_value_, error_traceback_);
+    error_type_ = NULL;
+    error_value_ = NULL;
+    error_traceback_ = NULL;
+    PyGILState_Release(gil_state_);
+  }
+
+  void write(const int logger_type, const int log_level, const std::string& message) override
+  {
+    PyObject* py_logger = get_py_logger(logger_type);
+    PyObject* py_function_name = get_py_log_function_name(log_level);
+    if (py_logger == NULL || py_function_name == NULL)
+      return;
+    if (!send_to_python(py_logger, py_function_name, message))
+    {
+      // I'm not sure what else to do here since I can't log the error.  I will print it 
+      // so that it shows up in the console, but I can't log it, and there is no way to 
+      // return an error.
+      PyErr_Print();
+      PyErr_Clear();
+    }
+  }
+
+  void write_exception(const int logger_type, const std::string& message) override
+  {
+    PyObject* py_logger = get_py_logger(logger_type);
+    if (py_logger == NULL)
+    {
+      PyErr_SetString(PyExc_ValueError, "Logging.octolapse_log - unknown logger_type.");
+      return;
+    }
+
+    PyObject* error_type = NULL;
+    PyObject* error_value = NULL;
+    PyObject* error_traceback = NULL;
+    bool error_occurred = false;
+    PyGILState_STATE state = PyGILState_Ensure();
+    // if an error has occurred, use the exception function to log the entire error
+    if (PyErr_Occurred())
+    {
+      error_occurred = true;
+      PyErr_Fetch(&error_type, &error_value, &error_traceback);
+      PyErr_NormalizeException(&error_type, &error_value, &error_traceback);
+    }
+    if (!send_to_python(py_logger, py_error_function_name, message))
+    {
+      // We can't log the logging error, so print it to the console.
+      PyErr_Print();
+      PyErr_Clear();
+    }
+    // Set the exception, since we are doing exception logging.
+    if (error_occurred)
+      PyErr_Restore(error_type, error_value, error_traceback);
+    else
+      PyErr_SetString(PyExc_Exception, message.c_str());
+    PyGILState_Release(state);
+  }
+
+private:
+  PyGILState_STATE gil_state_;
+  PyObject* error_type_;
+  PyObject* error_value_;
+  PyObject* error_traceback_;
+};
+
+static python_log_handler python_handler;
+
+void octolapse_initialize_loggers()
+{
+  // Create all of the objects necessary for logging
+  // Import the octolapse.log module
+  py_logging_module = PyImport_ImportModuleNoBlock("octoprint_octolapse.log");
+  if (py_logging_module == NULL)
+  {
+    PyErr_SetString(PyExc_ImportError, "Could not import module 'octolapse.log'.");
+    return;
+  }
+
+  // Get the logging configurator attribute string
+  py_logging_configurator_name = PyObject_GetAttrString(py_logging_module, "LoggingConfigurator");
+  if (py_logging_configurator_name == NULL)
+  {
+    PyErr_SetString(PyExc_ImportError, "Could not acquire the LoggingConfigurator attribute string.");
+    return;
+  }
+
+  // Create a logging configurator
+  PyGILState_STATE gstate = PyGILState_Ensure();
+  py_logging_configurator = PyObject_CallObject(py_logging_configurator_name, NULL);
+  PyGILState_Release(gstate);
+
+  if (py_logging_configurator == NULL)
+  {
+    PyErr_SetString(PyExc_ImportError, "Could not create a new instance of LoggingConfigurator.");
+    return;
+  }
+
+  // Create the gcode_parser logging object
+  py_octolapse_gcode_parser_logger = PyObject_CallMethod(py_logging_configurator, (char*)"get_logger", (char *)"s",
+                                                         "octoprint_octolapse.gcode_parser");
+  if (py_octolapse_gcode_parser_logger == NULL)
+  {
+    PyErr_SetString(PyExc_ImportError, "Could not create the octolapse.gcode_parser child logger.");
+    return;
+  }
+
+  // Create the gcode_position logging object
+  py_octolapse_gcode_position_logger = PyObject_CallMethod(py_logging_configurator, (char*)"get_logger", (char *)"s",
+                                                           "octoprint_octolapse.gcode_position");
+  if (py_octolapse_gcode_position_logger == NULL)
+  {
+    PyErr_SetString(PyExc_ImportError, "Could not create the octolapse.gcode_position child logger.");
+    return;
+  }
+
+  // Create the stabilization logging object
+  py_octolapse_snapshot_plan_logger = PyObject_CallMethod(py_logging_configurator, (char*)"get_logger", (char *)"s",
+                                                          "octoprint_octolapse.snapshot_plan");
+  if (py_octolapse_snapshot_plan_logger == NULL)
+  {
+    PyErr_SetString(PyExc_ImportError, "Could not create the octolapse.snapshot_plan child logger.");
+    return;
+  }
+
+  // Create the rendering logging object, which is shared with render.py
+  py_octolapse_render_logger = PyObject_CallMethod(py_logging_configurator, (char*)"get_logger", (char *)"s",
+                                                   "octoprint_octolapse.render");
+  if (py_octolapse_render_logger == NULL)
+  {
+    PyErr_SetString(PyExc_ImportError, "Could not create the octolapse.render child logger.");
+    return;
+  }
+
+  // Create the snapshot logging object, which is shared with snapshot.py
+  py_octolapse_snapshot_logger = PyObject_CallMethod(py_logging_configurator, (char*)"get_logger", (char *)"s",
+                                                     "octoprint_octolapse.snapshot");
+  if (py_octolapse_snapshot_logger == NULL)
+  {
+    PyErr_SetString(PyExc_ImportError, "Could not create the octolapse.snapshot child logger.");
+    return;
+  }
+
+  // create the function name py objects
+  py_info_function_name = PyString_SafeFromString("info");
+  py_warn_function_name = PyString_SafeFromString("warn");
+  py_error_function_name = PyString_SafeFromString("error");
+  py_debug_function_name = PyString_SafeFromString("debug");
+  py_verbose_function_name = PyString_SafeFromString("verbose");
+  py_critical_function_name = PyString_SafeFromString("critical");
+  py_get_effective_level_function_name = PyString_SafeFromString("getEffectiveLevel");
+  octolapse_loggers_created = true;
+  octolapse_set_log_handler(&python_handler);
+  octolapse_refresh_log_levels();
+}
+
+void octolapse_refresh_log_levels()
+{
+  if (!octolapse_loggers_created)
+    return;
+  PyGILState_STATE gstate = PyGILState_Ensure();
+  for (int logger_type = 0; logger_type < OCTOLAPSE_NUM_LOGGERS; logger_type++)
+  {
+    PyObject* py_log_level = PyObject_CallMethodObjArgs(get_py_logger(logger_type),
+                                                        py_get_effective_level_function_name, NULL);
+    if (py_log_level == NULL)
+    {
+      // Log everything rather than losing messages, python will do the filtering.
+      PyErr_Print();
+      PyErr_Clear();
+      octolapse_set_log_level(logger_type, octolapse_log::NOSET);
+      continue;
+    }
+    octolapse_set_log_level(logger_type, static_cast<int>(PyIntOrLong_AsLong(py_log_level)));
+    Py_DECREF(py_log_level);
+  }
+  PyGILState_Release(gstate);
+}
+
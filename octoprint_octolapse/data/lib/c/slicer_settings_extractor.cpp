@@ -0,0 +1,217 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "slicer_settings_extractor.h"
+#include "logging.h"
+#include <cstring>
+#include <deque>
+#include <sstream>
+
+// The number of bytes at the end of the file mapped at first when searching for the tail lines.  The window doubles
+// whenever a single line does not fit.
+#define SLICER_SETTINGS_TAIL_WINDOW_SIZE 65536
+
+#pragma region slicer_settings_format
+slicer_settings_format::slicer_settings_format()
+{
+  max_forward_lines = 0;
+  max_reverse_lines = 0;
+}
+#pragma endregion slicer_settings_format
+
+#pragma region slicer_settings_result
+#pragma endregion slicer_settings_result
+
+#pragma region slicer_settings_extractor
+slicer_settings_extractor::slicer_settings_extractor(const std::vector<slicer_settings_format>& formats) :
+  formats_(formats)
+{
+  max_forward_lines_ = 0;
+  max_reverse_lines_ = 0;
+  for (unsigned int format_index = 0; format_index < formats_.size(); format_index++)
+  {
+    const slicer_settings_format& format = formats_[format_index];
+    std::map<std::string, int> keyword_table;
+    for (unsigned int key_index = 0; key_index < format.keys.size(); key_index++)
+    {
+      keyword_table.insert(std::pair<std::string, int>(format.keys[key_index], key_index));
+    }
+    keyword_tables_.push_back(keyword_table);
+    if (format.max_forward_lines > max_forward_lines_)
+      max_forward_lines_ = format.max_forward_lines;
+    if (format.max_reverse_lines > max_reverse_lines_)
+      max_reverse_lines_ = format.max_reverse_lines;
+  }
+}
+
+bool slicer_settings_extractor::extract(const std::string& file_path,
+                                        std::vector<slicer_settings_result>& results) const
+{
+  gcode_file_reader file;
+  if (!file.open(file_path))
+  {
+    std::string message = "slicer_settings_extractor.extract: Unable to open the gcode file at ";
+    message.append(file_path).append(".");
+    octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::ERROR, message);
+    return false;
+  }
+  scan(file, results);
+  if (file.has_error())
+  {
+    std::string message = "slicer_settings_extractor.extract: Unable to read the gcode file at ";
+    message.append(file_path).append(".");
+    octolapse_log(octolapse_log::GCODE_PARSER, octolapse_log::ERROR, message);
+    return false;
+  }
+  return true;
+}
+
+void slicer_settings_extractor::scan(gcode_file_reader& file, std::vector<slicer_settings_result>& results) const
+{
+  results.clear();
+  std::vector<std::vector<bool> > keys_found;
+  for (unsigned int index = 0; index < formats_.size(); index++)
+  {
+    slicer_settings_result result;
+    result.name = formats_[index].name;
+    results.push_back(result);
+    keys_found.push_back(std::vector<bool>(formats_[index].keys.size(), false));
+  }
+  const long long size = file.get_file_size();
+  if (size == 0)
+    return;
+
+  // Header window.  A compressed file can only be read forwards, so it is read to the end, keeping the tail lines.
+  const bool is_compressed = file.is_compressed();
+  std::deque<std::string> tail_lines;
+  std::string line;
+  long line_number = 0;
+  while ((line_number < max_forward_lines_ || (is_compressed && max_reverse_lines_ > 0)) && file.read_line(line))
+  {
+    if (line_number < max_forward_lines_)
+      process_line(line.c_str(), line.c_str() + line.length(), ++line_number, true, results, keys_found);
+    if (is_compressed)
+    {
+      tail_lines.push_back(line);
+      if (static_cast<long>(tail_lines.size()) > max_reverse_lines_)
+        tail_lines.pop_front();
+    }
+  }
+  if (is_compressed)
+  {
+    line_number = 0;
+    for (std::deque<std::string>::reverse_iterator it = tail_lines.rbegin(); it != tail_lines.rend(); ++it)
+      process_line(it->c_str(), it->c_str() + it->length(), ++line_number, false, results, keys_found);
+    return;
+  }
+
+  // Tail window, read backwards.  A trailing newline does not start another line.  line_end is the file offset
+  // directly after the current line.
+  const char* last_byte = file.get_range(size - 1, 1);
+  if (last_byte == NULL)
+    return;
+  long long line_end = *last_byte == '\n' ? size - 1 : size;
+  long long window_size = SLICER_SETTINGS_TAIL_WINDOW_SIZE;
+  line_number = 0;
+  while (line_end > 0 && line_number < max_reverse_lines_)
+  {
+    const long long window_start = line_end > window_size ? line_end - window_size : 0;
+    const char* data = file.get_range(window_start, line_end - window_start);
+    if (data == NULL)
+      return;
+    const char* end = data + (line_end - window_start);
+    while (end > data && line_number < max_reverse_lines_)
+    {
+      const char* start = end;
+      while (start > data && *(start - 1) != '\n')
+        --start;
+      // The line may begin before the window
+      if (start == data && window_start > 0)
+        break;
+      process_line(start, end, ++line_number, false, results, keys_found);
+      end = start == data ? data : start - 1;
+    }
+    const long long next_line_end = window_start + (end - data);
+    if (next_line_end == line_end)
+      window_size *= 2;
+    line_end = next_line_end;
+  }
+  // A file that starts with a newline has an empty first line, which can never be a setting, so it is not processed.
+}
+
+void slicer_settings_extractor::process_line(const char* line_start, const char* line_end, const long line_number,
+                                             const bool is_forward, std::vector<slicer_settings_result>& results,
+                                             std::vector<std::vector<bool> >& keys_found) const
+{
+  // Strip the line like str.strip() does
+  while (line_start < line_end && (*line_start == ' ' || *line_start == '\t' || *line_start == '\r'))
+    ++line_start;
+  while (line_end > line_start && (*(line_end - 1) == ' ' || *(line_end - 1) == '\t' || *(line_end - 1) == '\r'))
+    --line_end;
+  // Every slicer writes its settings into comments
+  if (line_start == line_end || *line_start != ';')
+    return;
+  const size_t length = line_end - line_start;
+
+  for (unsigned int format_index = 0; format_index < formats_.size(); format_index++)
+  {
+    const slicer_settings_format& format = formats_[format_index];
+    if (line_number > (is_forward ? format.max_forward_lines : format.max_reverse_lines))
+      continue;
+
+    // Try to match a setting first, just like the general_setting regex is tried first in python
+    const size_t prefix_length = format.setting_prefix.size();
+    if (
+      !format.setting_separator.empty() && length > prefix_length &&
+      std::memcmp(line_start, format.setting_prefix.c_str(), prefix_length) == 0)
+    {
+      const std::string line(line_start, length);
+      const size_t separator_position = line.find(format.setting_separator, prefix_length);
+      if (separator_position != std::string::npos)
+      {
+        const std::string key = line.substr(prefix_length, separator_position - prefix_length);
+        if (format.key_excluded_characters.empty() || key.find_first_of(format.key_excluded_characters) == std::string::npos)
+        {
+          const std::map<std::string, int>::const_iterator key_iterator = keyword_tables_[format_index].find(key);
+          if (key_iterator != keyword_tables_[format_index].end() && !keys_found[format_index][key_iterator->second])
+          {
+            keys_found[format_index][key_iterator->second] = true;
+            results[format_index].settings.push_back(
+              std::pair<std::string, std::string>(key, line.substr(separator_position + format.setting_separator.size()))
+            );
+          }
+          continue;
+        }
+      }
+    }
+
+    for (unsigned int prefix_index = 0; prefix_index < format.line_prefixes.size(); prefix_index++)
+    {
+      const std::string& prefix = format.line_prefixes[prefix_index];
+      if (length >= prefix.size() && std::memcmp(line_start, prefix.c_str(), prefix.size()) == 0)
+      {
+        results[format_index].lines.push_back(std::string(line_start, length));
+        break;
+      }
+    }
+  }
+}
+#pragma endregion slicer_settings_extractor
@@ -0,0 +1,87 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SLICER_SETTINGS_EXTRACTOR_H
+#define SLICER_SETTINGS_EXTRACTOR_H
+#include <string>
+#include <vector>
+#include <map>
+#include "gcode_file_reader.h"
+
+/**
+ * \brief Describes how one slicer writes its settings into the gcode comments, and which of them to extract.  This is
+ * the native equivalent of the general_setting regex of a GcodeSettingsProcessor in settings_preprocessor.py.
+ */
+struct slicer_settings_format
+{
+  slicer_settings_format();
+  std::string name;
+  // A setting line is setting_prefix + key + setting_separator + value, where the key is ended by the first separator.
+  std::string setting_prefix;
+  std::string setting_separator;
+  // Keys containing any of these characters are not settings.
+  std::string key_excluded_characters;
+  std::vector<std::string> keys;
+  // Other lines that the settings processor wants to see, like the slicer version.
+  std::vector<std::string> line_prefixes;
+  // The number of lines to search from the start and from the end of the file.
+  long max_forward_lines;
+  long max_reverse_lines;
+};
+
+struct slicer_settings_result
+{
+  std::string name;
+  // Matched keys and their raw values, in the order they were found.
+  std::vector<std::pair<std::string, std::string> > settings;
+  std::vector<std::string> lines;
+};
+
+/**
+ * \brief Extracts slicer settings from the comments at the start and end of a gcode file.  Only windows at the start
+ * and end of the file are mapped and scanned, so the cost does not depend on the size of the file.  Compressed files
+ * can only be read forwards, so the end of those is found by decompressing the whole file.
+ */
+class slicer_settings_extractor
+{
+public:
+  slicer_settings_extractor(const std::vector<slicer_settings_format>& formats);
+  /**
+   * \brief Scans the file and fills one result per format.  Settings found in the header take precedence over those
+   * found in the tail.  Returns false if the file could not be read.
+   */
+  bool extract(const std::string& file_path, std::vector<slicer_settings_result>& results) const;
+  /**
+   * \brief Processes a single line of text.  line_number is 1 based, counted from the start of the file when
+   * is_forward is true, and from the end otherwise.
+   */
+  void process_line(const char* line_start, const char* line_end, long line_number, bool is_forward,
+                    std::vector<slicer_settings_result>& results, std::vector<std::vector<bool> >& keys_found) const;
+private:
+  std::vector<slicer_settings_format> formats_;
+  // The keyword table, one per format, mapping each key to its index in the format's keys.
+  std::vector<std::map<std::string, int> > keyword_tables_;
+  long max_forward_lines_;
+  long max_reverse_lines_;
+  void scan(gcode_file_reader& file, std::vector<slicer_settings_result>& results) const;
+};
+#endif
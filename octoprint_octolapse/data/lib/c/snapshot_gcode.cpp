@@ -0,0 +1,42 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "snapshot_gcode.h"
+#include "logging.h"
+
+snapshot_gcode::snapshot_gcode()
+{
+}
+
+void snapshot_gcode::clear()
+{
+  initialization_gcode.clear();
+  start_gcode.clear();
+  snapshot_commands.clear();
+  return_commands.clear();
+  end_gcode.clear();
+}
+
+bool snapshot_gcode::is_empty() const
+{
+  return initialization_gcode.empty() && start_gcode.empty() && snapshot_commands.empty() &&
+    return_commands.empty() && end_gcode.empty();
+}
@@ -0,0 +1,43 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef SNAPSHOT_GCODE_H
+#define SNAPSHOT_GCODE_H
+#include <string>
+#include <vector>
+
+/**
+ * \brief The final, formatted gcode for a single snapshot plan, split into the same sections that
+ * SnapshotGcode uses in stabilization_gcode.py so the plugin can send each group separately.
+ */
+struct snapshot_gcode
+{
+  snapshot_gcode();
+  void clear();
+  bool is_empty() const;
+  // commands executed here are not involved in timing calculations
+  std::vector<std::string> initialization_gcode;
+  std::vector<std::string> start_gcode;
+  std::vector<std::string> snapshot_commands;
+  std::vector<std::string> return_commands;
+  std::vector<std::string> end_gcode;
+};
+#endif
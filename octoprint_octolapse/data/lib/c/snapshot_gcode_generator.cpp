@@ -0,0 +1,832 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "snapshot_gcode_generator.h"
+#include "stabilization.h"
+#include "utilities.h"
+#include "logging.h"
+#include <sstream>
+#include <cmath>
+
+// The minimum length to retract.  Any shorter retractions could cause quality issues.
+static const double MIN_LENGTH_TO_RETRACT = 0.0001;
+// Matches utility.FLOAT_MATH_EQUALITY_RANGE
+static const double FLOAT_MATH_EQUALITY_RANGE = 0.0000001;
+
+snapshot_gcode_generator::snapshot_gcode_generator()
+{
+  p_plan_ = NULL;
+  p_gcode_ = NULL;
+  p_return_position_ = NULL;
+  x_current_ = 0;
+  y_current_ = 0;
+  z_current_ = 0;
+  e_current_ = 0;
+  f_current_ = 0;
+  f_current_null_ = true;
+  is_relative_current_ = false;
+  is_extruder_relative_current_ = false;
+  f_altered_ = 0;
+  length_to_retract_ = 0;
+  distance_to_lift_ = 0;
+  retracted_by_start_gcode_ = false;
+  lifted_by_start_gcode_ = false;
+}
+
+snapshot_gcode_generator::snapshot_gcode_generator(snapshot_gcode_generator_args args) :
+  snapshot_gcode_generator()
+{
+  args_ = args;
+}
+
+snapshot_gcode_generator::~snapshot_gcode_generator()
+{
+}
+
+bool snapshot_gcode_generator::create_gcode(snapshot_plan& plan, snapshot_gcode& gcode)
+{
+  gcode.clear();
+  if (!initialize_for_snapshot_plan_processing(plan, gcode))
+  {
+    p_plan_ = NULL;
+    p_gcode_ = NULL;
+    p_return_position_ = NULL;
+    return false;
+  }
+
+  // create the start command if it exists
+  send_start_command();
+
+  // There is no need to stabilize the extruder if we aren't waiting for moves to finish
+  if (args_.wait_for_moves_to_finish)
+  {
+    // retract if necessary
+    retract();
+    // lift if necessary
+    lift_z();
+  }
+
+  for (unsigned int step_index = 0; step_index < plan.steps.size(); step_index++)
+  {
+    const snapshot_plan_step& step = plan.steps[step_index];
+    if (step.action == travel_action)
+    {
+      if (args_.wait_for_moves_to_finish)
+      {
+        add_travel_action(step);
+      }
+    }
+    else if (step.action == snapshot_action)
+    {
+      add_snapshot_action();
+    }
+  }
+
+  if (args_.wait_for_moves_to_finish)
+  {
+    // Create Return Gcode
+    return_to_original_position();
+    // If we zhopped in the beginning, lower z
+    delift_z();
+    // deretract if necessary
+    deretract();
+    // reset the coordinate systems for the extruder and axis
+    return_to_original_coordinate_systems();
+    return_to_original_feedrate();
+  }
+
+  send_end_command();
+
+  p_plan_ = NULL;
+  p_gcode_ = NULL;
+  p_return_position_ = NULL;
+  return true;
+}
+
+bool snapshot_gcode_generator::initialize_for_snapshot_plan_processing(snapshot_plan& plan, snapshot_gcode& gcode)
+{
+  if (!plan.has_initial_position)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "Unable to create snapshot gcode, the snapshot plan has no initial position.");
+    return false;
+  }
+  const position& initial_position = plan.initial_position;
+  // check the units, only metric works.
+  if (initial_position.is_metric_null || !initial_position.is_metric)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "No unit of measurement has been set and the current printer profile is set to require explicit "
+                  "G20/G21, or the unit of measurement is inches.");
+    return false;
+  }
+  if (args_.extruders.empty())
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "Unable to create snapshot gcode, no extruder gcode settings were supplied.");
+    return false;
+  }
+
+  p_plan_ = &plan;
+  p_gcode_ = &gcode;
+  p_return_position_ = plan.return_position.is_empty ? NULL : &plan.return_position;
+
+  x_current_ = initial_position.x;
+  y_current_ = initial_position.y;
+  z_current_ = initial_position.z;
+  e_current_ = initial_position.get_current_extruder().e;
+  f_current_ = initial_position.f;
+  f_current_null_ = initial_position.f_null;
+  is_relative_current_ = initial_position.is_relative;
+  is_extruder_relative_current_ = initial_position.is_extruder_relative;
+
+  int current_tool = initial_position.current_tool;
+  const int num_extruders = static_cast<int>(args_.extruders.size());
+  if (current_tool > num_extruders - 1)
+  {
+    std::stringstream stream;
+    stream << "The requested tool index of " << current_tool << " is greater than the number of extruders (" <<
+      num_extruders << ").";
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, stream.str());
+    current_tool = num_extruders - 1;
+  }
+  if (current_tool < 0)
+  {
+    std::stringstream stream;
+    stream << "The requested tool index was less than zero.  Index: " << current_tool << ".";
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, stream.str());
+    current_tool = 0;
+  }
+  current_extruder_ = args_.extruders[current_tool];
+
+  if (args_.disable_z_lift)
+  {
+    distance_to_lift_ = 0;
+  }
+  else
+  {
+    distance_to_lift_ = get_distance_to_zlift(initial_position);
+  }
+  length_to_retract_ = get_length_to_retract(initial_position);
+
+  retracted_by_start_gcode_ = false;
+  lifted_by_start_gcode_ = false;
+  return true;
+}
+
+double snapshot_gcode_generator::get_distance_to_zlift(const position& pos) const
+{
+  if (pos.z_null || pos.last_extrusion_height_null)
+  {
+    return 0;
+  }
+  const double z_hop = current_extruder_.z_lift_height;
+  const double amount_to_lift = z_hop - (pos.z - pos.last_extrusion_height);
+  if (amount_to_lift < FLOAT_MATH_EQUALITY_RANGE)
+  {
+    return 0;
+  }
+  if (amount_to_lift > z_hop)
+  {
+    return z_hop;
+  }
+  // round to the float equality range
+  return static_cast<long long>(amount_to_lift / FLOAT_MATH_EQUALITY_RANGE + 0.5) * FLOAT_MATH_EQUALITY_RANGE;
+}
+
+double snapshot_gcode_generator::get_length_to_retract(const position& pos) const
+{
+  const double amount_to_retract = current_extruder_.retraction_length;
+  // truncate to the float equality range
+  double retract_length = std::floor(
+    (amount_to_retract - pos.get_current_extruder().retraction_length) * 10000000.0 + 0.00000005
+  ) / 10000000.0;
+  if (retract_length < 0)
+  {
+    retract_length = 0;
+  }
+  else if (retract_length > amount_to_retract)
+  {
+    retract_length = amount_to_retract;
+  }
+  else if (retract_length < MIN_LENGTH_TO_RETRACT)
+  {
+    // we don't want to retract less than the MIN_LENGTH_TO_RETRACT, else we might have quality issues!
+    retract_length = 0;
+  }
+  return retract_length;
+}
+
+double snapshot_gcode_generator::get_gcode_x(const position& pos, double x)
+{
+  return x - pos.x_offset + pos.x_firmware_offset;
+}
+
+double snapshot_gcode_generator::get_gcode_y(const position& pos, double y)
+{
+  return y - pos.y_offset + pos.y_firmware_offset;
+}
+
+double snapshot_gcode_generator::get_gcode_e(const position& pos, double e)
+{
+  return e - pos.get_current_extruder().e_offset;
+}
+
+void snapshot_gcode_generator::set_e_to_relative(std::vector<std::string>& gcodes)
+{
+  if (!is_extruder_relative_current_)
+  {
+    gcodes.push_back("M83");
+    is_extruder_relative_current_ = true;
+  }
+}
+
+void snapshot_gcode_generator::set_e_to_absolute(std::vector<std::string>& gcodes)
+{
+  if (is_extruder_relative_current_)
+  {
+    gcodes.push_back("M82");
+    is_extruder_relative_current_ = false;
+  }
+}
+
+void snapshot_gcode_generator::set_xyz_to_relative(std::vector<std::string>& gcodes)
+{
+  if (!is_relative_current_)
+  {
+    gcodes.push_back("G91");
+    is_relative_current_ = true;
+    // this may also influence the extruder
+    if (args_.g90_influences_extruder)
+    {
+      is_extruder_relative_current_ = true;
+    }
+  }
+}
+
+void snapshot_gcode_generator::set_xyz_to_absolute(std::vector<std::string>& gcodes)
+{
+  if (is_relative_current_)
+  {
+    gcodes.push_back("G90");
+    is_relative_current_ = false;
+    // this may also influence the extruder
+    if (args_.g90_influences_extruder)
+    {
+      is_extruder_relative_current_ = false;
+    }
+  }
+}
+
+const double* snapshot_gcode_generator::get_altered_feedrate(double feedrate, bool feedrate_null)
+{
+  const bool is_same = feedrate_null ? f_current_null_ : !f_current_null_ && feedrate == f_current_;
+  if (is_same)
+  {
+    return NULL;
+  }
+  f_current_ = feedrate;
+  f_current_null_ = feedrate_null;
+  if (feedrate_null)
+  {
+    return NULL;
+  }
+  f_altered_ = feedrate;
+  return &f_altered_;
+}
+
+bool snapshot_gcode_generator::can_retract() const
+{
+  return current_extruder_.retract_before_move && length_to_retract_ > 0;
+}
+
+bool snapshot_gcode_generator::can_zhop() const
+{
+  if (!(current_extruder_.retract_before_move && current_extruder_.lift_when_retracted && distance_to_lift_ > 0))
+  {
+    return false;
+  }
+  return utilities::less_than_or_equal(p_plan_->initial_position.z + distance_to_lift_, args_.z_max);
+}
+
+#pragma region Relative retract/lift/travel functions
+void snapshot_gcode_generator::retract_relative()
+{
+  set_e_to_relative(p_gcode_->start_gcode);
+  const double length_to_retract = -1 * length_to_retract_;
+  e_current_ += length_to_retract;
+  p_gcode_->start_gcode.push_back(
+    get_gcode_retract(
+      length_to_retract,
+      get_altered_feedrate(current_extruder_.retraction_speed, current_extruder_.retraction_speed_null)
+    )
+  );
+  retracted_by_start_gcode_ = true;
+}
+
+void snapshot_gcode_generator::deretract_relative()
+{
+  if (retracted_by_start_gcode_)
+  {
+    const double length_to_deretract = length_to_retract_;
+    e_current_ += length_to_deretract;
+    set_e_to_relative(p_gcode_->end_gcode);
+    p_gcode_->end_gcode.push_back(
+      get_gcode_retract(
+        length_to_deretract,
+        get_altered_feedrate(current_extruder_.deretraction_speed, current_extruder_.deretraction_speed_null)
+      )
+    );
+  }
+}
+
+void snapshot_gcode_generator::lift_z_relative()
+{
+  const double distance_to_lift = distance_to_lift_;
+  z_current_ += distance_to_lift;
+  set_xyz_to_relative(p_gcode_->start_gcode);
+  p_gcode_->start_gcode.push_back(
+    get_gcode_z_lift(
+      distance_to_lift,
+      get_altered_feedrate(current_extruder_.z_lift_speed, current_extruder_.z_lift_speed_null)
+    )
+  );
+  lifted_by_start_gcode_ = true;
+}
+
+void snapshot_gcode_generator::delift_z_relative()
+{
+  if (lifted_by_start_gcode_)
+  {
+    const double distance_to_delift = -1 * distance_to_lift_;
+    z_current_ += distance_to_delift;
+    set_xyz_to_relative(p_gcode_->end_gcode);
+    p_gcode_->end_gcode.push_back(
+      get_gcode_z_lift(
+        distance_to_delift,
+        get_altered_feedrate(current_extruder_.z_lift_speed, current_extruder_.z_lift_speed_null)
+      )
+    );
+  }
+}
+
+void snapshot_gcode_generator::add_travel_action_relative(const snapshot_plan_step& step)
+{
+  if (step.p_x == NULL || step.p_y == NULL)
+  {
+    return;
+  }
+  if (x_current_ != *step.p_x && y_current_ != *step.p_y)
+  {
+    set_xyz_to_relative(p_gcode_->snapshot_commands);
+    const double x_relative = *step.p_x - x_current_;
+    const double y_relative = *step.p_y - y_current_;
+    x_current_ = *step.p_x;
+    y_current_ = *step.p_y;
+    p_gcode_->snapshot_commands.push_back(
+      get_gcode_travel(
+        x_relative,
+        y_relative,
+        get_altered_feedrate(current_extruder_.x_y_travel_speed, current_extruder_.x_y_travel_speed_null)
+      )
+    );
+  }
+}
+
+void snapshot_gcode_generator::return_to_original_position_relative()
+{
+  if (
+    p_return_position_ != NULL &&
+    x_current_ != p_return_position_->x &&
+    y_current_ != p_return_position_->y
+  )
+  {
+    set_xyz_to_relative(p_gcode_->snapshot_commands);
+    const double x_relative = p_return_position_->x - x_current_;
+    const double y_relative = p_return_position_->y - y_current_;
+    x_current_ = p_return_position_->x;
+    y_current_ = p_return_position_->y;
+    p_gcode_->return_commands.push_back(
+      get_gcode_travel(
+        x_relative,
+        y_relative,
+        get_altered_feedrate(current_extruder_.x_y_travel_speed, current_extruder_.x_y_travel_speed_null)
+      )
+    );
+  }
+}
+#pragma endregion Relative retract/lift/travel functions
+
+#pragma region Absolute retract/lift/travel functions
+void snapshot_gcode_generator::retract_absolute()
+{
+  set_e_to_absolute(p_gcode_->start_gcode);
+  const double length_to_retract = -1 * length_to_retract_;
+  e_current_ += length_to_retract;
+  retracted_by_start_gcode_ = true;
+  p_gcode_->start_gcode.push_back(
+    get_gcode_retract(
+      get_gcode_e(p_plan_->initial_position, e_current_),
+      get_altered_feedrate(current_extruder_.retraction_speed, current_extruder_.retraction_speed_null)
+    )
+  );
+}
+
+void snapshot_gcode_generator::deretract_absolute()
+{
+  if (retracted_by_start_gcode_)
+  {
+    set_e_to_absolute(p_gcode_->end_gcode);
+    const double length_to_deretract = length_to_retract_;
+    e_current_ += length_to_deretract;
+    p_gcode_->end_gcode.push_back(
+      get_gcode_retract(
+        get_gcode_e(p_plan_->initial_position, e_current_),
+        get_altered_feedrate(current_extruder_.deretraction_speed, current_extruder_.deretraction_speed_null)
+      )
+    );
+  }
+}
+
+void snapshot_gcode_generator::lift_z_absolute()
+{
+  set_xyz_to_absolute(p_gcode_->start_gcode);
+  const double distance_to_lift = distance_to_lift_;
+  z_current_ += distance_to_lift;
+  lifted_by_start_gcode_ = true;
+  p_gcode_->start_gcode.push_back(
+    get_gcode_z_lift(
+      z_current_ - p_plan_->initial_position.z_offset,
+      get_altered_feedrate(current_extruder_.z_lift_speed, current_extruder_.z_lift_speed_null)
+    )
+  );
+}
+
+void snapshot_gcode_generator::delift_z_absolute()
+{
+  set_xyz_to_absolute(p_gcode_->end_gcode);
+  const double distance_to_delift = -1 * distance_to_lift_;
+  z_current_ += distance_to_delift;
+  p_gcode_->end_gcode.push_back(
+    get_gcode_z_lift(
+      z_current_ - p_plan_->initial_position.z_offset,
+      get_altered_feedrate(current_extruder_.z_lift_speed, current_extruder_.z_lift_speed_null)
+    )
+  );
+}
+
+void snapshot_gcode_generator::add_travel_action_absolute(const snapshot_plan_step& step)
+{
+  if (step.p_x == NULL || step.p_y == NULL)
+  {
+    return;
+  }
+  if (!(x_current_ == *step.p_x && y_current_ == *step.p_y))
+  {
+    // Move to Snapshot Position
+    set_xyz_to_absolute(p_gcode_->snapshot_commands);
+    x_current_ = *step.p_x;
+    y_current_ = *step.p_y;
+    p_gcode_->snapshot_commands.push_back(
+      get_gcode_travel(
+        get_gcode_x(p_plan_->initial_position, *step.p_x),
+        get_gcode_y(p_plan_->initial_position, *step.p_y),
+        get_altered_feedrate(current_extruder_.x_y_travel_speed, current_extruder_.x_y_travel_speed_null)
+      )
+    );
+  }
+}
+
+void snapshot_gcode_generator::return_to_original_position_absolute()
+{
+  if (p_return_position_ == NULL)
+  {
+    return;
+  }
+  // Only return to the previous coordinates if we need to (which will be most cases,
+  // except when the triggering command is a travel only (moves both X and Y, but not Z)
+  if (p_return_position_->x != x_current_ || p_return_position_->y != y_current_)
+  {
+    x_current_ = p_return_position_->x;
+    y_current_ = p_return_position_->y;
+    // Move back to previous position - make sure we're in absolute mode for this
+    set_xyz_to_absolute(p_gcode_->return_commands);
+    p_gcode_->return_commands.push_back(
+      get_gcode_travel(
+        get_gcode_x(*p_return_position_, p_return_position_->x),
+        get_gcode_y(*p_return_position_, p_return_position_->y),
+        get_altered_feedrate(current_extruder_.x_y_travel_speed, current_extruder_.x_y_travel_speed_null)
+      )
+    );
+  }
+}
+#pragma endregion Absolute retract/lift/travel functions
+
+#pragma region Current axis mode retract/lift/travel functions
+void snapshot_gcode_generator::retract_current_mode()
+{
+  if (is_extruder_relative_current_)
+  {
+    retract_relative();
+  }
+  else
+  {
+    retract_absolute();
+  }
+}
+
+void snapshot_gcode_generator::deretract_current_mode()
+{
+  if (is_extruder_relative_current_)
+  {
+    deretract_relative();
+  }
+  else
+  {
+    deretract_absolute();
+  }
+}
+
+void snapshot_gcode_generator::lift_z_current_mode()
+{
+  if (is_relative_current_)
+  {
+    lift_z_relative();
+  }
+  else
+  {
+    lift_z_absolute();
+  }
+}
+
+void snapshot_gcode_generator::delift_z_current_mode()
+{
+  if (is_relative_current_)
+  {
+    delift_z_relative();
+  }
+  else
+  {
+    delift_z_absolute();
+  }
+}
+
+void snapshot_gcode_generator::add_travel_action_current_mode(const snapshot_plan_step& step)
+{
+  if (is_relative_current_)
+  {
+    add_travel_action_relative(step);
+  }
+  else
+  {
+    add_travel_action_absolute(step);
+  }
+}
+
+void snapshot_gcode_generator::return_to_original_position_current_mode()
+{
+  if (is_relative_current_)
+  {
+    return_to_original_position_relative();
+  }
+  else
+  {
+    return_to_original_position_absolute();
+  }
+}
+#pragma endregion Current axis mode retract/lift/travel functions
+
+#pragma region Common functions, calls the appropriate function based on the axis_mode_compatibility setting
+void snapshot_gcode_generator::retract()
+{
+  if (can_retract())
+  {
+    if (args_.axis_mode_compatibility)
+    {
+      retract_relative();
+    }
+    else
+    {
+      retract_current_mode();
+    }
+  }
+}
+
+void snapshot_gcode_generator::deretract()
+{
+  if (retracted_by_start_gcode_)
+  {
+    if (args_.axis_mode_compatibility)
+    {
+      deretract_relative();
+    }
+    else
+    {
+      deretract_current_mode();
+    }
+  }
+}
+
+void snapshot_gcode_generator::lift_z()
+{
+  if (can_zhop())
+  {
+    if (args_.axis_mode_compatibility)
+    {
+      lift_z_relative();
+    }
+    else
+    {
+      lift_z_current_mode();
+    }
+  }
+}
+
+void snapshot_gcode_generator::delift_z()
+{
+  if (lifted_by_start_gcode_)
+  {
+    if (args_.axis_mode_compatibility)
+    {
+      delift_z_relative();
+    }
+    else
+    {
+      delift_z_current_mode();
+    }
+  }
+}
+
+void snapshot_gcode_generator::add_travel_action(const snapshot_plan_step& step)
+{
+  if (args_.axis_mode_compatibility)
+  {
+    add_travel_action_absolute(step);
+  }
+  else
+  {
+    add_travel_action_current_mode(step);
+  }
+}
+
+void snapshot_gcode_generator::return_to_original_position()
+{
+  if (args_.axis_mode_compatibility)
+  {
+    return_to_original_position_absolute();
+  }
+  else
+  {
+    return_to_original_position_current_mode();
+  }
+}
+#pragma endregion Common functions, calls the appropriate function based on the axis_mode_compatibility setting
+
+void snapshot_gcode_generator::add_snapshot_action()
+{
+  p_gcode_->snapshot_commands.push_back(args_.snapshot_command);
+}
+
+void snapshot_gcode_generator::return_to_original_coordinate_systems()
+{
+  const position& return_position = p_return_position_ != NULL ? *p_return_position_ : p_plan_->initial_position;
+
+  const bool is_relative_return = return_position.is_relative;
+  if (is_relative_return != is_relative_current_)
+  {
+    p_gcode_->end_gcode.push_back(is_relative_current_ ? "G90" : "G91");
+    is_relative_current_ = is_relative_return;
+    if (args_.g90_influences_extruder)
+    {
+      is_extruder_relative_current_ = is_relative_return;
+    }
+  }
+
+  const bool is_extruder_relative_return = return_position.is_extruder_relative;
+  if (is_extruder_relative_return != is_extruder_relative_current_)
+  {
+    p_gcode_->end_gcode.push_back(is_extruder_relative_return ? "M83" : "M82");
+    is_extruder_relative_current_ = is_extruder_relative_return;
+  }
+}
+
+// Note that this command may alter the end_command's feedrate if it exists in order to reduce the number of gcodes
+// sent
+void snapshot_gcode_generator::return_to_original_feedrate()
+{
+  parsed_command& end_command = p_plan_->end_command;
+  bool feedrate_set_in_end_command = false;
+  if (!end_command.is_empty)
+  {
+    for (unsigned int index = 0; index < end_command.parameters.size(); index++)
+    {
+      if (end_command.parameters[index].name == "F")
+      {
+        feedrate_set_in_end_command = true;
+        break;
+      }
+    }
+  }
+
+  const position& return_position = p_return_position_ != NULL ? *p_return_position_ : p_plan_->initial_position;
+  // We have no feedrate to return to, so there is nothing to do.
+  if (feedrate_set_in_end_command || return_position.f_null)
+  {
+    return;
+  }
+  const double f_return = return_position.f;
+  if (!f_current_null_ && f_return == f_current_)
+  {
+    return;
+  }
+  // see if we can alter the end_command feedrate
+  if (!end_command.is_empty && (end_command.command == "G0" || end_command.command == "G1"))
+  {
+    end_command.parameters.push_back(parsed_command_parameter("F", f_return));
+    end_command.update_gcode_string();
+  }
+  else
+  {
+    // we can't count on the end gcode to set f, set it here
+    p_gcode_->end_gcode.push_back(get_gcode_feedrate(f_return));
+  }
+}
+
+void snapshot_gcode_generator::send_start_command()
+{
+  if (!p_plan_->start_command.is_empty)
+  {
+    p_gcode_->initialization_gcode.push_back(p_plan_->start_command.gcode);
+  }
+}
+
+void snapshot_gcode_generator::send_end_command()
+{
+  if (!p_plan_->end_command.is_empty)
+  {
+    p_gcode_->end_gcode.push_back(p_plan_->end_command.gcode);
+  }
+}
+
+std::string snapshot_gcode_generator::get_gcode_travel(double x, double y, const double* f)
+{
+  std::string gcode = "G0 X";
+  gcode += utilities::to_fixed_string(x, 3);
+  gcode += " Y";
+  gcode += utilities::to_fixed_string(y, 3);
+  if (f != NULL)
+  {
+    gcode += " F";
+    gcode += utilities::to_fixed_string(*f, 3);
+  }
+  return gcode;
+}
+
+std::string snapshot_gcode_generator::get_gcode_z_lift(double distance, const double* f)
+{
+  std::string gcode = "G1 Z";
+  gcode += utilities::to_fixed_string(distance, 3);
+  if (f != NULL)
+  {
+    gcode += " F";
+    gcode += utilities::to_fixed_string(*f, 3);
+  }
+  return gcode;
+}
+
+std::string snapshot_gcode_generator::get_gcode_retract(double distance, const double* f)
+{
+  std::string gcode = "G1 E";
+  gcode += utilities::to_fixed_string(distance, 5);
+  if (f != NULL)
+  {
+    gcode += " F";
+    gcode += utilities::to_fixed_string(*f, 3);
+  }
+  return gcode;
+}
+
+std::string snapshot_gcode_generator::get_gcode_feedrate(double f)
+{
+  std::string gcode = "G1 F";
+  gcode += utilities::to_fixed_string(f, 3);
+  return gcode;
+}
@@ -0,0 +1,186 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef SNAPSHOT_GCODE_GENERATOR_H
+#define SNAPSHOT_GCODE_GENERATOR_H
+#include <string>
+#include <vector>
+#include "snapshot_plan.h"
+#include "snapshot_gcode.h"
+
+/**
+ * \brief The per extruder gcode generation settings (see OctolapseExtruderGcodeSettings).
+ */
+struct snapshot_gcode_extruder_args
+{
+  snapshot_gcode_extruder_args()
+  {
+    retract_before_move = false;
+    retraction_length = 0;
+    retraction_speed = 0;
+    retraction_speed_null = true;
+    deretraction_speed = 0;
+    deretraction_speed_null = true;
+    lift_when_retracted = false;
+    z_lift_height = 0;
+    x_y_travel_speed = 0;
+    x_y_travel_speed_null = true;
+    z_lift_speed = 0;
+    z_lift_speed_null = true;
+  }
+
+  bool retract_before_move;
+  double retraction_length;
+  double retraction_speed;
+  bool retraction_speed_null;
+  double deretraction_speed;
+  bool deretraction_speed_null;
+  bool lift_when_retracted;
+  double z_lift_height;
+  double x_y_travel_speed;
+  bool x_y_travel_speed_null;
+  double z_lift_speed;
+  bool z_lift_speed_null;
+};
+
+struct snapshot_gcode_generator_args
+{
+  snapshot_gcode_generator_args()
+  {
+    enabled = false;
+    axis_mode_compatibility = true;
+    wait_for_moves_to_finish = true;
+    disable_z_lift = false;
+    g90_influences_extruder = false;
+    z_max = 0;
+    snapshot_command = "@OCTOLAPSE TAKE-SNAPSHOT";
+  }
+
+  /**
+   * \brief If false, no gcode will be generated during preprocessing, and the plugin will generate it when printing.
+   */
+  bool enabled;
+  bool axis_mode_compatibility;
+  bool wait_for_moves_to_finish;
+  bool disable_z_lift;
+  bool g90_influences_extruder;
+  double z_max;
+  std::string snapshot_command;
+  std::vector<snapshot_gcode_extruder_args> extruders;
+};
+
+/**
+ * \brief A port of SnapshotGcodeGenerator.create_gcode_for_snapshot_plan from stabilization_gcode.py.  Converts
+ * a snapshot plan into the final gcode so that it can be created while preprocessing instead of while printing.
+ */
+class snapshot_gcode_generator
+{
+public:
+  snapshot_gcode_generator();
+  snapshot_gcode_generator(snapshot_gcode_generator_args args);
+  ~snapshot_gcode_generator();
+  /**
+   * \brief Creates the gcode for the snapshot plan.  The plan's end command may have its feedrate altered.
+   * \param plan The snapshot plan to create gcode for.
+   * \param gcode The generated gcode.  Will be cleared before generation.
+   * \return false if the gcode could not be created.
+   */
+  bool create_gcode(snapshot_plan& plan, snapshot_gcode& gcode);
+
+  static std::string get_gcode_travel(double x, double y, const double* f);
+  static std::string get_gcode_z_lift(double distance, const double* f);
+  static std::string get_gcode_retract(double distance, const double* f);
+  static std::string get_gcode_feedrate(double f);
+
+private:
+  bool initialize_for_snapshot_plan_processing(snapshot_plan& plan, snapshot_gcode& gcode);
+  double get_distance_to_zlift(const position& pos) const;
+  double get_length_to_retract(const position& pos) const;
+  static double get_gcode_x(const position& pos, double x);
+  static double get_gcode_y(const position& pos, double y);
+  static double get_gcode_e(const position& pos, double e);
+
+  void set_e_to_relative(std::vector<std::string>& gcodes);
+  void set_e_to_absolute(std::vector<std::string>& gcodes);
+  void set_xyz_to_relative(std::vector<std::string>& gcodes);
+  void set_xyz_to_absolute(std::vector<std::string>& gcodes);
+  const double* get_altered_feedrate(double feedrate, bool feedrate_null);
+  bool can_retract() const;
+  bool can_zhop() const;
+
+  void retract_relative();
+  void deretract_relative();
+  void lift_z_relative();
+  void delift_z_relative();
+  void add_travel_action_relative(const snapshot_plan_step& step);
+  void return_to_original_position_relative();
+
+  void retract_absolute();
+  void deretract_absolute();
+  void lift_z_absolute();
+  void delift_z_absolute();
+  void add_travel_action_absolute(const snapshot_plan_step& step);
+  void return_to_original_position_absolute();
+
+  void retract_current_mode();
+  void deretract_current_mode();
+  void lift_z_current_mode();
+  void delift_z_current_mode();
+  void add_travel_action_current_mode(const snapshot_plan_step& step);
+  void return_to_original_position_current_mode();
+
+  void retract();
+  void deretract();
+  void lift_z();
+  void delift_z();
+  void add_travel_action(const snapshot_plan_step& step);
+  void return_to_original_position();
+  void add_snapshot_action();
+  void return_to_original_coordinate_systems();
+  void return_to_original_feedrate();
+  void send_start_command();
+  void send_end_command();
+
+  snapshot_gcode_generator_args args_;
+  // The plan and gcode currently being processed
+  snapshot_plan* p_plan_;
+  snapshot_gcode* p_gcode_;
+  const position* p_return_position_;
+  // current values
+  double x_current_;
+  double y_current_;
+  double z_current_;
+  double e_current_;
+  double f_current_;
+  bool f_current_null_;
+  bool is_relative_current_;
+  bool is_extruder_relative_current_;
+  // the feedrate returned by get_altered_feedrate
+  double f_altered_;
+  // calculated values
+  double length_to_retract_;
+  double distance_to_lift_;
+  snapshot_gcode_extruder_args current_extruder_;
+  // state flags
+  bool retracted_by_start_gcode_;
+  bool lifted_by_start_gcode_;
+};
+#endif
@@ -22,6 +22,7 @@
 #ifndef SNAPSHOT_PLAN_H
 #define SNAPSHOT_PLAN_H
 #include "snapshot_plan_step.h"
+#include "snapshot_gcode.h"
 #include "parsed_command.h"
 #include "position.h"
 #include "trigger_position.h"
@@ -31,11 +32,9 @@
 struct snapshot_plan
 {
   snapshot_plan();
-  PyObject* to_py_object();
-  static PyObject* build_py_object(std::vector<snapshot_plan>& plans);
-  long file_line;
-  long file_gcode_number;
-  long file_position;
+  long long file_line;
+  long long file_gcode_number;
+  long long file_position;
   position_type triggering_command_type;
   feature_type triggering_command_feature_type;
   parsed_command triggering_command;
@@ -48,6 +47,8 @@ struct snapshot_plan
   double distance_from_stabilization_point;
   double total_travel_distance;
   double saved_travel_distance;
+  // The final gcode for this plan, empty unless it was created during preprocessing
+  snapshot_gcode gcode;
 };
 
 #endif
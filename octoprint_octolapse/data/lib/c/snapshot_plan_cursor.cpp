@@ -0,0 +1,185 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "snapshot_plan_cursor.h"
+#include <algorithm>
+#include <limits>
+
+namespace
+{
+  bool compare_gcode_number(const snapshot_plan_cursor_entry& lhs, const snapshot_plan_cursor_entry& rhs)
+  {
+    if (lhs.file_gcode_number != rhs.file_gcode_number)
+      return lhs.file_gcode_number < rhs.file_gcode_number;
+    return lhs.plan_index < rhs.plan_index;
+  }
+
+  bool entry_before_gcode_number(const snapshot_plan_cursor_entry& entry, long long gcode_number)
+  {
+    return entry.file_gcode_number < gcode_number;
+  }
+
+  bool position_before_entry(long long file_position, const snapshot_plan_cursor_entry& entry)
+  {
+    return file_position < entry.file_position;
+  }
+}
+
+snapshot_plan_cursor_entry::snapshot_plan_cursor_entry()
+{
+  file_gcode_number = 0;
+  file_position = 0;
+  plan_index = -1;
+}
+
+snapshot_plan_cursor_entry::snapshot_plan_cursor_entry(long long gcode_number, long long position, int index)
+{
+  file_gcode_number = gcode_number;
+  file_position = position;
+  plan_index = index;
+}
+
+snapshot_plan_cursor::snapshot_plan_cursor()
+{
+  reset();
+}
+
+snapshot_plan_cursor::snapshot_plan_cursor(const std::vector<snapshot_plan>& plans)
+{
+  entries_.reserve(plans.size());
+  for (unsigned int index = 0; index < plans.size(); index++)
+  {
+    entries_.push_back(
+      snapshot_plan_cursor_entry(plans[index].file_gcode_number, plans[index].file_position, static_cast<int>(index))
+    );
+  }
+  std::sort(entries_.begin(), entries_.end(), compare_gcode_number);
+  reset();
+}
+
+snapshot_plan_cursor::snapshot_plan_cursor(const std::vector<snapshot_plan_cursor_entry>& entries)
+{
+  entries_ = entries;
+  std::sort(entries_.begin(), entries_.end(), compare_gcode_number);
+  reset();
+}
+
+void snapshot_plan_cursor::reset()
+{
+  plans_triggered_ = 0;
+  plans_skipped_ = 0;
+  current_ = 0;
+  update_window();
+}
+
+void snapshot_plan_cursor::update_window()
+{
+  // The window is [previous trigger, next trigger).  Repeating the previous trigger (a resend) stays inside
+  // of the window so that a plan can never fire twice in a row.
+  long long start = std::numeric_limits<long long>::min();
+  long long end = std::numeric_limits<long long>::max();
+  if (current_ > 0)
+    start = entries_[current_ - 1].file_gcode_number;
+  if (current_ < entries_.size())
+    end = entries_[current_].file_gcode_number;
+  window_start_ = static_cast<unsigned long long>(start);
+  window_length_ = static_cast<unsigned long long>(end) - window_start_;
+}
+
+void snapshot_plan_cursor::move_to(const unsigned int entry_index)
+{
+  if (entry_index > current_)
+    plans_skipped_ += static_cast<int>(entry_index - current_);
+  current_ = entry_index;
+  update_window();
+}
+
+int snapshot_plan_cursor::check_slow(const long long gcode_number)
+{
+  if (current_ >= entries_.size() || gcode_number != entries_[current_].file_gcode_number)
+  {
+    // We either missed one or more plans or the file was rewound.  Find the first plan at or after the current
+    // gcode number.
+    const unsigned int entry_index = static_cast<unsigned int>(
+      std::lower_bound(entries_.begin(), entries_.end(), gcode_number, entry_before_gcode_number) - entries_.begin()
+    );
+    move_to(entry_index);
+    if (current_ >= entries_.size() || entries_[current_].file_gcode_number != gcode_number)
+      return -1;
+  }
+  // This is a trigger, advance past it.
+  const int plan_index = entries_[current_].plan_index;
+  plans_triggered_++;
+  current_++;
+  update_window();
+  return plan_index;
+}
+
+int snapshot_plan_cursor::seek_gcode_number(const long long gcode_number)
+{
+  current_ = static_cast<unsigned int>(
+    std::lower_bound(entries_.begin(), entries_.end(), gcode_number, entry_before_gcode_number) - entries_.begin()
+  );
+  update_window();
+  return get_next_plan_index();
+}
+
+int snapshot_plan_cursor::seek_file_position(const long long file_position)
+{
+  // file_position is the position directly after the triggering line, so any plan with a position at or before
+  // the supplied position has already been read.  Plans are sorted by gcode number, which is ascending in the
+  // file, so they are sorted by position as well.
+  current_ = static_cast<unsigned int>(
+    std::upper_bound(entries_.begin(), entries_.end(), file_position, position_before_entry) - entries_.begin()
+  );
+  update_window();
+  return get_next_plan_index();
+}
+
+int snapshot_plan_cursor::get_next_plan_index() const
+{
+  if (current_ < entries_.size())
+    return entries_[current_].plan_index;
+  return -1;
+}
+
+long long snapshot_plan_cursor::get_next_gcode_number() const
+{
+  if (current_ < entries_.size())
+    return entries_[current_].file_gcode_number;
+  return -1;
+}
+
+int snapshot_plan_cursor::get_plans_remaining() const
+{
+  return static_cast<int>(entries_.size() - current_);
+}
+
+int snapshot_plan_cursor::get_plans_triggered() const
+{
+  return plans_triggered_;
+}
+
+int snapshot_plan_cursor::get_plans_skipped() const
+{
+  return plans_skipped_;
+}
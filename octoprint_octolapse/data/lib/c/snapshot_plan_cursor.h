@@ -0,0 +1,99 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SNAPSHOT_PLAN_CURSOR_H
+#define SNAPSHOT_PLAN_CURSOR_H
+#include <vector>
+#include "snapshot_plan.h"
+
+/**
+ * \brief The location of a single snapshot plan within the source gcode file.
+ */
+struct snapshot_plan_cursor_entry
+{
+  snapshot_plan_cursor_entry();
+  snapshot_plan_cursor_entry(long long gcode_number, long long position, int index);
+  long long file_gcode_number;
+  long long file_position;
+  int plan_index;
+};
+
+/**
+ * \brief Tracks the next snapshot plan to trigger while a preprocessed file is printing.
+ *
+ * Plans are kept sorted by file_gcode_number.  The cursor keeps a window that runs from the most
+ * recently passed trigger up to (but not including) the next one.  Any gcode number inside that
+ * window, including a duplicate of the last trigger, is rejected with a single unsigned compare.
+ * Anything outside of the window (a trigger, a skipped plan or a backwards seek) falls back to a
+ * binary search.
+ */
+class snapshot_plan_cursor
+{
+public:
+  snapshot_plan_cursor();
+  explicit snapshot_plan_cursor(const std::vector<snapshot_plan>& plans);
+  explicit snapshot_plan_cursor(const std::vector<snapshot_plan_cursor_entry>& entries);
+  /**
+   * \brief Returns the index of the plan that triggers on the supplied gcode number, or -1.
+   */
+  int check(long long gcode_number)
+  {
+    if (is_in_window(gcode_number))
+      return -1;
+    return check_slow(gcode_number);
+  }
+  /**
+   * \brief Returns true if the supplied gcode number can not trigger a plan or move the cursor.  This does
+   * not change the cursor, so it can be used to decide if check() needs to be called at all.
+   */
+  bool is_in_window(long long gcode_number) const
+  {
+    return static_cast<unsigned long long>(gcode_number) - window_start_ < window_length_;
+  }
+  /**
+   * \brief Moves the cursor to the first plan triggering on or after the supplied gcode number.
+   * Returns the index of that plan, or -1 if there are no more plans.
+   */
+  int seek_gcode_number(long long gcode_number);
+  /**
+   * \brief Moves the cursor to the first plan whose trigger has not been read once the file has
+   * been read up to the supplied byte position.  Returns the index of that plan, or -1.
+   */
+  int seek_file_position(long long file_position);
+  void reset();
+  int get_next_plan_index() const;
+  long long get_next_gcode_number() const;
+  int get_plans_remaining() const;
+  int get_plans_triggered() const;
+  int get_plans_skipped() const;
+private:
+  int check_slow(long long gcode_number);
+  void move_to(unsigned int entry_index);
+  void update_window();
+  std::vector<snapshot_plan_cursor_entry> entries_;
+  unsigned int current_;
+  unsigned long long window_start_;
+  unsigned long long window_length_;
+  int plans_triggered_;
+  int plans_skipped_;
+};
+#endif
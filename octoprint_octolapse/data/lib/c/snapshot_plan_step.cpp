@@ -20,7 +20,6 @@
 // following email address : FormerLurker@pm.me
 ////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 #include "snapshot_plan_step.h"
-#include "python_helpers.h"
 #include "logging.h"
 
 snapshot_plan_step::snapshot_plan_step()
@@ -173,105 +172,3 @@ snapshot_plan_step::~snapshot_plan_step()
     p_f = NULL;
   }
 }
-
-PyObject* snapshot_plan_step::to_py_object() const
-{
-  PyObject* py_x;
-  if (p_x == NULL)
-  {
-    py_x = Py_None;
-    Py_IncRef(py_x);
-  }
-  else
-  {
-    py_x = PyFloat_FromDouble(*p_x);
-  }
-  if (py_x == NULL)
-  {
-    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the X value to a python object.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return NULL;
-  }
-
-  PyObject* py_y;
-  if (p_y == NULL)
-  {
-    py_y = Py_None;
-    Py_IncRef(py_y);
-  }
-  else
-  {
-    py_y = PyFloat_FromDouble(*p_y);
-  }
-  if (py_y == NULL)
-  {
-    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the Y value to a python object.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return NULL;
-  }
-
-  PyObject* py_z;
-  if (p_z == NULL)
-  {
-    py_z = Py_None;
-    Py_IncRef(py_z);
-  }
-  else
-  {
-    py_z = PyFloat_FromDouble(*p_z);
-  }
-  if (py_z == NULL)
-  {
-    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the Z value to a python object.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return NULL;
-  }
-
-  PyObject* py_e;
-  if (p_e == NULL)
-  {
-    py_e = Py_None;
-    Py_IncRef(py_e);
-  }
-  else
-  {
-    py_e = PyFloat_FromDouble(*p_e);
-  }
-  if (py_e == NULL)
-  {
-    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the E value to a python object.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return NULL;
-  }
-
-  PyObject* py_f;
-  if (p_f == NULL)
-  {
-    py_f = Py_None;
-    Py_IncRef(py_f);
-  }
-  else
-  {
-    py_f = PyFloat_FromDouble(*p_f);
-  }
-  if (py_f == NULL)
-  {
-    std::string message = "snapshot_plan_step.to_py_object: Unable to convert the F value to a python object.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return NULL;
-  }
-
-  PyObject* py_step = Py_BuildValue("sOOOOO", action.c_str(), py_x, py_y, py_z, py_e, py_f);
-  if (py_step == NULL)
-  {
-    std::string message = "snapshot_plan_step.to_py_object: Unable to create the snapshot plan step PyObject.";
-    octolapse_log_exception(octolapse_log::SNAPSHOT_PLAN, message);
-    return NULL;
-  }
-  Py_DecRef(py_x);
-  Py_DecRef(py_y);
-  Py_DecRef(py_z);
-  Py_DecRef(py_e);
-  Py_DecRef(py_f);
-  return py_step;
-}
@@ -22,20 +22,12 @@
 #ifndef SNAPSHOT_PLAN_STEP_H
 #define SNAPSHOT_PLAN_STEP_H
 #include <string>
-#ifdef _DEBUG
-#undef _DEBUG
-#include <Python.h>
-#define _DEBUG
-#else
-#include <Python.h>
-#endif
 struct snapshot_plan_step
 {
   snapshot_plan_step();
   snapshot_plan_step(double* x, double* y, double* z, double* e, double* f, std::string action_type);
   snapshot_plan_step(const snapshot_plan_step& source);
   ~snapshot_plan_step();
-  PyObject* to_py_object() const;
   double* p_x;
   double* p_y;
   double* p_z;
@@ -0,0 +1,488 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#include "snapshot_trigger.h"
+#include "utilities.h"
+#include "logging.h"
+#include <chrono>
+#include <cmath>
+
+#pragma region extruder_trigger_options
+extruder_trigger_options::extruder_trigger_options()
+{
+  enabled = false;
+  on_extruding_start = extruder_trigger_option_ignore;
+  on_extruding = extruder_trigger_option_ignore;
+  on_primed = extruder_trigger_option_ignore;
+  on_retracting_start = extruder_trigger_option_ignore;
+  on_retracting = extruder_trigger_option_ignore;
+  on_partially_retracted = extruder_trigger_option_ignore;
+  on_retracted = extruder_trigger_option_ignore;
+  on_deretracting_start = extruder_trigger_option_ignore;
+  on_deretracting = extruder_trigger_option_ignore;
+  on_deretracted = extruder_trigger_option_ignore;
+}
+
+bool extruder_trigger_options::are_all_triggers_ignored() const
+{
+  return on_extruding_start == extruder_trigger_option_ignore
+    && on_extruding == extruder_trigger_option_ignore
+    && on_primed == extruder_trigger_option_ignore
+    && on_retracting_start == extruder_trigger_option_ignore
+    && on_retracting == extruder_trigger_option_ignore
+    && on_partially_retracted == extruder_trigger_option_ignore
+    && on_retracted == extruder_trigger_option_ignore
+    && on_deretracting_start == extruder_trigger_option_ignore
+    && on_deretracting == extruder_trigger_option_ignore
+    && on_deretracted == extruder_trigger_option_ignore;
+}
+
+namespace
+{
+  // Adds the result of a single extruder state check.  An option only has an effect when the state is active.
+  void check_extruder_state(const extruder_trigger_option option, const bool state, bool& is_prevented,
+                            bool& is_triggered)
+  {
+    if (option == extruder_trigger_option_ignore || !state)
+      return;
+    if (option == extruder_trigger_option_required)
+      is_triggered = true;
+    else
+      is_prevented = true;
+  }
+}
+
+bool extruder_trigger_options::is_triggered(const position& pos) const
+{
+  // if there are no extruder trigger options, return true.
+  if (!enabled)
+    return true;
+
+  const extruder& current_extruder = pos.get_current_extruder();
+  bool is_prevented = false;
+  bool is_triggered = false;
+  check_extruder_state(on_extruding_start, current_extruder.is_extruding_start, is_prevented, is_triggered);
+  check_extruder_state(on_extruding, current_extruder.is_extruding, is_prevented, is_triggered);
+  check_extruder_state(on_primed, current_extruder.is_primed, is_prevented, is_triggered);
+  check_extruder_state(on_retracting_start, current_extruder.is_retracting_start, is_prevented, is_triggered);
+  check_extruder_state(on_retracting, current_extruder.is_retracting, is_prevented, is_triggered);
+  check_extruder_state(on_partially_retracted, current_extruder.is_partially_retracted, is_prevented, is_triggered);
+  check_extruder_state(on_retracted, current_extruder.is_retracted, is_prevented, is_triggered);
+  check_extruder_state(on_deretracting_start, current_extruder.is_deretracting_start, is_prevented, is_triggered);
+  check_extruder_state(on_deretracting, current_extruder.is_deretracting, is_prevented, is_triggered);
+  check_extruder_state(on_deretracted, current_extruder.is_deretracted, is_prevented, is_triggered);
+
+  return !is_prevented && (is_triggered || are_all_triggers_ignored());
+}
+#pragma endregion extruder_trigger_options
+
+#pragma region snapshot_trigger_args
+snapshot_trigger_args::snapshot_trigger_args()
+{
+  type = snapshot_trigger_type_layer;
+  require_zhop = false;
+  height_increment = 0;
+  interval_seconds = 0;
+  snapshot_command = "";
+}
+#pragma endregion snapshot_trigger_args
+
+#pragma region snapshot_trigger_state
+snapshot_trigger_state::snapshot_trigger_state()
+{
+  is_triggered = false;
+  trigger_type = snapshot_trigger_position_type_none;
+  is_in_position = false;
+  in_path_position = false;
+  is_waiting = false;
+  is_home_position_wait = false;
+  is_waiting_on_zhop = false;
+  is_waiting_on_extruder = false;
+  has_changed = false;
+  has_definite_position = false;
+  current_increment = 0;
+  is_layer_change_wait = false;
+  is_height_change = false;
+  is_height_change_wait = false;
+  is_layer_change = false;
+  layer = 0;
+  seconds_to_trigger = 0;
+  seconds_to_trigger_null = true;
+  trigger_start_time = 0;
+  trigger_start_time_null = true;
+  pause_time = 0;
+  pause_time_null = true;
+}
+
+void snapshot_trigger_state::reset_state()
+{
+  is_triggered = false;
+  in_path_position = false;
+  is_in_position = false;
+  trigger_type = snapshot_trigger_position_type_none;
+  has_changed = false;
+  is_height_change = false;
+  is_layer_change = false;
+}
+
+bool snapshot_trigger_state::is_equal(const snapshot_trigger_state& state, const snapshot_trigger_type type) const
+{
+  if (!(is_triggered == state.is_triggered
+    && trigger_type == state.trigger_type
+    && is_in_position == state.is_in_position
+    && in_path_position == state.in_path_position
+    && is_waiting == state.is_waiting
+    && is_home_position_wait == state.is_home_position_wait
+    && is_waiting_on_zhop == state.is_waiting_on_zhop
+    && is_waiting_on_extruder == state.is_waiting_on_extruder
+    && has_definite_position == state.has_definite_position))
+    return false;
+
+  if (type == snapshot_trigger_type_layer)
+  {
+    return current_increment == state.current_increment
+      && is_layer_change_wait == state.is_layer_change_wait
+      && is_height_change == state.is_height_change
+      && is_height_change_wait == state.is_height_change_wait
+      && layer == state.layer;
+  }
+  if (type == snapshot_trigger_type_timer)
+  {
+    return seconds_to_trigger_null == state.seconds_to_trigger_null
+      && seconds_to_trigger == state.seconds_to_trigger
+      && trigger_start_time_null == state.trigger_start_time_null
+      && trigger_start_time == state.trigger_start_time
+      && pause_time_null == state.pause_time_null
+      && pause_time == state.pause_time;
+  }
+  return true;
+}
+
+#pragma endregion snapshot_trigger_state
+
+#pragma region snapshot_trigger
+snapshot_trigger::snapshot_trigger()
+{
+  trigger_count_ = 0;
+  snapshots_enabled_ = true;
+}
+
+snapshot_trigger::snapshot_trigger(const snapshot_trigger_args& args) : args_(args)
+{
+  trigger_count_ = 0;
+  snapshots_enabled_ = true;
+}
+
+double snapshot_trigger::get_current_time()
+{
+  // seconds since the epoch, like time.time()
+  return std::chrono::duration<double>(std::chrono::system_clock::now().time_since_epoch()).count();
+}
+
+bool snapshot_trigger::update(const position& current, const position& previous)
+{
+  update_snapshots_enabled(current.command);
+  const snapshot_trigger_state previous_state = state_;
+  state_.reset_state();
+  switch (args_.type)
+  {
+  case snapshot_trigger_type_gcode:
+    update_gcode(current, previous);
+    break;
+  case snapshot_trigger_type_layer:
+    update_layer(current, previous);
+    break;
+  case snapshot_trigger_type_timer:
+    update_timer(current, previous);
+    break;
+  }
+  state_.has_changed = !state_.is_equal(previous_state, args_.type);
+  return state_.has_changed;
+}
+
+void snapshot_trigger::update_snapshots_enabled(const parsed_command& command)
+{
+  if (command.command != "@OCTOLAPSE")
+    return;
+  for (unsigned int index = 0; index < command.parameters.size(); index++)
+  {
+    if (command.parameters[index].name == "STOP-SNAPSHOTS")
+    {
+      snapshots_enabled_ = false;
+      return;
+    }
+    if (command.parameters[index].name == "START-SNAPSHOTS")
+    {
+      snapshots_enabled_ = true;
+      return;
+    }
+  }
+}
+
+bool snapshot_trigger::is_snapshot_command(const parsed_command& command) const
+{
+  // Matches PrinterProfile.is_snapshot_command
+  if (command.gcode.empty())
+    return false;
+  return (!args_.snapshot_command.empty() && command.gcode == args_.snapshot_command)
+    || command.gcode.compare(0, 24, "@OCTOLAPSE TAKE-SNAPSHOT") == 0
+    || command.gcode == "SNAP";
+}
+
+bool snapshot_trigger::is_waiting_for_position(const position& trigger_position)
+{
+  if (args_.require_zhop && !trigger_position.is_zhop)
+  {
+    state_.is_waiting_on_zhop = true;
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG, "Trigger - Waiting on ZHop.");
+    return true;
+  }
+  if (!trigger_position.is_in_bounds)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG, "Trigger - Waiting for in-bounds position.");
+    return true;
+  }
+  if (!state_.is_in_position && !state_.in_path_position)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG, "Trigger - Waiting on Position.");
+    return true;
+  }
+  if (trigger_position.last_extrusion_height_null || trigger_position.last_extrusion_height == 0)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG,
+                  "Trigger - Waiting for at least one extrusion on a previous layer.");
+    return true;
+  }
+  if (!utilities::greater_than_or_equal(trigger_position.z, trigger_position.last_extrusion_height))
+  {
+    // The extruder is below the last extrusion height, do not take a snapshot else we might run into the part!
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG,
+                  "Trigger - Waiting for extruder to move above the highest extrusion point.");
+    return true;
+  }
+  if (!snapshots_enabled_)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::DEBUG,
+                  "Trigger - Waiting for snapshots to be enabled via @Octolapse start-snapshots command.");
+    return true;
+  }
+  return false;
+}
+
+void snapshot_trigger::set_triggered()
+{
+  trigger_count_++;
+  if (state_.is_in_position)
+    state_.trigger_type = snapshot_trigger_position_type_default;
+  else if (state_.in_path_position)
+    state_.trigger_type = snapshot_trigger_position_type_in_path;
+  else
+    state_.trigger_type = snapshot_trigger_position_type_none;
+  state_.is_triggered = true;
+  state_.is_waiting = false;
+  state_.is_waiting_on_zhop = false;
+  state_.is_waiting_on_extruder = false;
+  state_.is_layer_change_wait = false;
+  state_.is_layer_change = false;
+  state_.is_height_change_wait = false;
+  if (args_.type == snapshot_trigger_type_timer)
+  {
+    state_.trigger_start_time_null = true;
+    state_.trigger_start_time = 0;
+  }
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Trigger - Triggering.");
+}
+
+void snapshot_trigger::update_gcode(const position& current, const position& previous)
+{
+  // The trigger position is the previous position, not the current
+  if (!previous.has_definite_position)
+  {
+    state_.is_triggered = false;
+    state_.has_definite_position = false;
+    return;
+  }
+  state_.has_definite_position = true;
+  state_.is_in_position = previous.is_in_position && previous.is_in_bounds;
+  state_.in_path_position = current.in_path_position;
+
+  if (is_snapshot_command(current.command))
+  {
+    if (snapshots_enabled_)
+      state_.is_waiting = true;
+    else
+      octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO,
+                    "GcodeTrigger - A snapshot was detected, but snapshots were disabled via @Octolapse stop-snapshots.");
+  }
+  if (!state_.is_waiting)
+    return;
+
+  if (!args_.extruder_triggers.is_triggered(previous))
+  {
+    state_.is_waiting_on_extruder = true;
+    return;
+  }
+  if (!is_waiting_for_position(previous))
+    set_triggered();
+}
+
+void snapshot_trigger::update_layer(const position& current, const position& previous)
+{
+  if (!previous.has_definite_position)
+  {
+    state_.is_triggered = false;
+    state_.has_definite_position = false;
+    return;
+  }
+  state_.has_definite_position = true;
+  state_.is_in_position = previous.is_in_position && previous.is_in_bounds;
+  // the in path position will be our CURRENT POSITION not the trigger position
+  state_.in_path_position = current.in_path_position;
+
+  const bool use_height_increment = args_.height_increment > 0;
+  // calculate height increment changed
+  if (
+    use_height_increment && current.is_layer_change && (
+      state_.current_increment * args_.height_increment < previous.height || state_.current_increment == 0
+    )
+  )
+  {
+    const int new_increment = static_cast<int>(std::ceil(previous.height / args_.height_increment));
+    if (new_increment <= state_.current_increment)
+    {
+      octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING,
+                    "Layer Trigger - Warning - The height increment was expected to increase, but it did not.");
+    }
+    else
+    {
+      // if the current increment is below one here, set it to one.  This is not normal, but can happen
+      // if extrusion is detected at height 0.
+      state_.current_increment = new_increment < 1 ? 1 : new_increment;
+      state_.is_height_change = true;
+    }
+  }
+
+  // see if we've encountered a layer or height change
+  if (use_height_increment)
+  {
+    if (state_.is_height_change)
+    {
+      state_.is_height_change_wait = true;
+      state_.is_waiting = true;
+    }
+  }
+  else if (current.is_layer_change)
+  {
+    state_.layer = previous.layer;
+    state_.is_layer_change_wait = true;
+    state_.is_layer_change = true;
+    state_.is_waiting = true;
+  }
+
+  if (!(state_.is_height_change_wait || state_.is_layer_change_wait || state_.is_waiting))
+    return;
+
+  state_.is_waiting = true;
+  if (!args_.extruder_triggers.is_triggered(previous))
+  {
+    state_.is_waiting_on_extruder = true;
+    return;
+  }
+  if (!is_waiting_for_position(previous))
+    set_triggered();
+}
+
+void snapshot_trigger::update_timer(const position& current, const position& previous)
+{
+  state_.is_triggered = false;
+  if (!previous.has_definite_position)
+  {
+    state_.has_definite_position = false;
+    return;
+  }
+  state_.has_definite_position = true;
+  // record the current time to keep things consistent
+  const double current_time = get_current_time();
+  state_.is_in_position = previous.is_in_position && previous.is_in_bounds;
+  state_.in_path_position = current.in_path_position;
+
+  // if the trigger start time is null, set it now.
+  if (state_.trigger_start_time_null)
+  {
+    state_.trigger_start_time = current_time;
+    state_.trigger_start_time_null = false;
+  }
+  // how many seconds to trigger, rounded like utility.round_to(seconds, 1)
+  const double seconds_to_trigger = args_.interval_seconds - (current_time - state_.trigger_start_time);
+  state_.seconds_to_trigger = static_cast<double>(
+    static_cast<long>(seconds_to_trigger + (seconds_to_trigger >= 0 ? 0.5 : -0.5))
+  );
+  state_.seconds_to_trigger_null = false;
+
+  // see if enough time has elapsed since the last trigger
+  if (state_.seconds_to_trigger > 0)
+    return;
+
+  state_.is_waiting = true;
+  if (!args_.extruder_triggers.is_triggered(previous))
+  {
+    state_.is_waiting_on_extruder = true;
+    return;
+  }
+  if (!is_waiting_for_position(previous))
+    set_triggered();
+}
+
+void snapshot_trigger::pause()
+{
+  state_.pause_time = get_current_time();
+  state_.pause_time_null = false;
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Timer trigger paused.");
+}
+
+void snapshot_trigger::resume()
+{
+  if (state_.pause_time_null || state_.trigger_start_time_null)
+    return;
+  // Keep the proper interval if the print is paused
+  state_.trigger_start_time = get_current_time() - (state_.pause_time - state_.trigger_start_time);
+  state_.pause_time_null = true;
+  state_.pause_time = 0;
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Timer trigger resumed.");
+}
+
+const snapshot_trigger_state& snapshot_trigger::get_state() const
+{
+  return state_;
+}
+
+int snapshot_trigger::get_trigger_count() const
+{
+  return trigger_count_;
+}
+
+bool snapshot_trigger::get_snapshots_enabled() const
+{
+  return snapshots_enabled_;
+}
+
+#pragma endregion snapshot_trigger
@@ -0,0 +1,158 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef SNAPSHOT_TRIGGER_H
+#define SNAPSHOT_TRIGGER_H
+#include <string>
+#include "position.h"
+
+// These must match the real-time trigger subtypes in trigger.py
+enum snapshot_trigger_type
+{
+  snapshot_trigger_type_gcode = 0,
+  snapshot_trigger_type_layer = 1,
+  snapshot_trigger_type_timer = 2
+};
+
+// Triggers.TRIGGER_TYPE_DEFAULT and Triggers.TRIGGER_TYPE_IN_PATH
+enum snapshot_trigger_position_type
+{
+  snapshot_trigger_position_type_none = 0,
+  snapshot_trigger_position_type_default = 1,
+  snapshot_trigger_position_type_in_path = 2
+};
+
+enum extruder_trigger_option
+{
+  extruder_trigger_option_ignore = 0,
+  extruder_trigger_option_required = 1,
+  extruder_trigger_option_forbidden = 2
+};
+
+/**
+ * \brief The native equivalent of ExtruderTriggers in position.py.
+ */
+struct extruder_trigger_options
+{
+  extruder_trigger_options();
+  bool enabled;
+  extruder_trigger_option on_extruding_start;
+  extruder_trigger_option on_extruding;
+  extruder_trigger_option on_primed;
+  extruder_trigger_option on_retracting_start;
+  extruder_trigger_option on_retracting;
+  extruder_trigger_option on_partially_retracted;
+  extruder_trigger_option on_retracted;
+  extruder_trigger_option on_deretracting_start;
+  extruder_trigger_option on_deretracting;
+  extruder_trigger_option on_deretracted;
+  bool are_all_triggers_ignored() const;
+  /**
+   * \brief Matches the options against the state of the current extruder, like Position._is_extruder_triggered.
+   */
+  bool is_triggered(const position& pos) const;
+};
+
+struct snapshot_trigger_args
+{
+  snapshot_trigger_args();
+  snapshot_trigger_type type;
+  bool require_zhop;
+  // Layer trigger height.  Zero to trigger on every layer change.
+  double height_increment;
+  double interval_seconds;
+  // The printer's snapshot command gcode, if any.
+  std::string snapshot_command;
+  extruder_trigger_options extruder_triggers;
+};
+
+/**
+ * \brief The union of TriggerState, LayerTriggerState and TimerTriggerState.
+ */
+struct snapshot_trigger_state
+{
+  snapshot_trigger_state();
+  void reset_state();
+  bool is_equal(const snapshot_trigger_state& state, snapshot_trigger_type type) const;
+  bool is_triggered;
+  snapshot_trigger_position_type trigger_type;
+  bool is_in_position;
+  bool in_path_position;
+  bool is_waiting;
+  bool is_home_position_wait;
+  bool is_waiting_on_zhop;
+  bool is_waiting_on_extruder;
+  bool has_changed;
+  bool has_definite_position;
+  // layer trigger
+  int current_increment;
+  bool is_layer_change_wait;
+  bool is_height_change;
+  bool is_height_change_wait;
+  bool is_layer_change;
+  long layer;
+  // timer trigger, times are in seconds since the epoch to match time.time()
+  double seconds_to_trigger;
+  bool seconds_to_trigger_null;
+  double trigger_start_time;
+  bool trigger_start_time_null;
+  double pause_time;
+  bool pause_time_null;
+};
+
+/**
+ * \brief Evaluates a real-time Gcode, Layer or Timer trigger against the native position ring.
+ *
+ * This is a port of GcodeTrigger.update, LayerTrigger.update and TimerTrigger.update from trigger.py.  It is
+ * updated for every queued line, and update returns true only when the state has changed so that python only
+ * needs to be involved when something happens.
+ */
+class snapshot_trigger
+{
+public:
+  snapshot_trigger();
+  explicit snapshot_trigger(const snapshot_trigger_args& args);
+  /**
+   * \brief Updates the trigger with the most recent position.  The trigger position is the previous position.
+   * Returns true if the state has changed.
+   */
+  bool update(const position& current, const position& previous);
+  void pause();
+  void resume();
+  const snapshot_trigger_state& get_state() const;
+  int get_trigger_count() const;
+  bool get_snapshots_enabled() const;
+  static double get_current_time();
+private:
+  bool is_snapshot_command(const parsed_command& command) const;
+  void update_snapshots_enabled(const parsed_command& command);
+  bool is_waiting_for_position(const position& trigger_position);
+  void set_triggered();
+  void update_gcode(const position& current, const position& previous);
+  void update_layer(const position& current, const position& previous);
+  void update_timer(const position& current, const position& previous);
+  snapshot_trigger_args args_;
+  snapshot_trigger_state state_;
+  int trigger_count_;
+  bool snapshots_enabled_;
+};
+#endif
@@ -25,27 +25,27 @@
 #include <sstream>
 #include "logging.h"
 #include "utilities.h"
+#include "instrumentation.h"
+#include "gcode_file_reader.h"
 #include <iostream>
-#include <fstream>
 
 stabilization::stabilization(gcode_position_args position_args, stabilization_args stab_args,
-                             pythonGetCoordinatesCallback get_coordinates_callback,
-                             PyObject* py_get_coordinates_callback, pythonProgressCallback progress_callback,
-                             PyObject* py_progress_callback)
+                             getCoordinatesCallback get_coordinates_callback, void* get_coordinates_context,
+                             contextProgressCallback progress_callback, void* progress_context)
 {
   std::string errors_;
-  if (py_get_coordinates_callback != NULL && py_progress_callback != NULL)
+  if (get_coordinates_context != NULL && progress_context != NULL)
   {
-    has_python_callbacks_ = true;
+    has_context_callbacks_ = true;
   }
   else
   {
-    has_python_callbacks_ = false;
+    has_context_callbacks_ = false;
   }
   progress_callback_ = progress_callback;
   _get_coordinates_callback = get_coordinates_callback;
-  py_on_progress_received = py_progress_callback;
-  py_get_snapshot_position_callback = py_get_coordinates_callback;
+  progress_context_ = progress_context;
+  get_coordinates_context_ = get_coordinates_context;
   native_progress_callback_ = NULL;
   stabilization_args_ = stab_args;
   gcode_position_args_ = position_args;
@@ -60,12 +60,14 @@ stabilization::stabilization(gcode_position_args position_args, stabilization_ar
   stabilization_x_ = 0;
   stabilization_y_ = 0;
   snapshots_enabled_ = true;
+  gcode_read_failed_ = false;
+  stabilized_gcode_failed_ = false;
 }
 
 stabilization::stabilization()
 {
   std::string errors_;
-  has_python_callbacks_ = false;
+  has_context_callbacks_ = false;
   native_progress_callback_ = NULL;
   progress_callback_ = NULL;
   stabilization_args_ = stabilization_args();
@@ -81,15 +83,17 @@ stabilization::stabilization()
   stabilization_x_ = 0;
   stabilization_y_ = 0;
   _get_coordinates_callback = NULL;
-  py_on_progress_received = NULL;
-  py_get_snapshot_position_callback = NULL;
+  progress_context_ = NULL;
+  get_coordinates_context_ = NULL;
   snapshots_enabled_ = true;
+  gcode_read_failed_ = false;
+  stabilized_gcode_failed_ = false;
 }
 
 stabilization::stabilization(gcode_position_args position_args, stabilization_args args, progressCallback progress)
 {
   std::string errors_;
-  has_python_callbacks_ = false;
+  has_context_callbacks_ = false;
   native_progress_callback_ = progress;
   progress_callback_ = NULL;
   stabilization_args_ = args;
@@ -105,9 +109,11 @@ stabilization::stabilization(gcode_position_args position_args, stabilization_ar
   stabilization_x_ = 0;
   stabilization_y_ = 0;
   _get_coordinates_callback = NULL;
-  py_on_progress_received = NULL;
-  py_get_snapshot_position_callback = NULL;
+  progress_context_ = NULL;
+  get_coordinates_context_ = NULL;
   snapshots_enabled_ = true;
+  gcode_read_failed_ = false;
+  stabilized_gcode_failed_ = false;
 }
 
 stabilization::stabilization(const stabilization& source)
@@ -126,10 +132,6 @@ stabilization::~stabilization()
     delete gcode_position_;
     gcode_position_ = NULL;
   }
-  if (py_on_progress_received != NULL)
-    Py_XDECREF(py_on_progress_received);
-  if (py_get_snapshot_position_callback != NULL)
-    Py_XDECREF(py_get_snapshot_position_callback);
 }
 
 void stabilization::delete_gcode_parser()
@@ -150,17 +152,6 @@ void stabilization::delete_gcode_position()
   }
 }
 
-long stabilization::get_file_size(const std::string& file_path)
-{
-  // Todo:  Fix this function.  This is a pretty weak implementation :(
-  std::ifstream file(file_path.c_str(), std::ios::in | std::ios::binary);
-  const long l = (long)file.tellg();
-  file.seekg(0, std::ios::end);
-  const long m = (long)file.tellg();
-  file.close();
-  return (m - l);
-}
-
 double stabilization::get_next_update_time() const
 {
   return clock() + (stabilization_args_.notification_period_seconds * CLOCKS_PER_SEC);
@@ -173,6 +164,7 @@ double stabilization::get_time_elapsed(double start_clock, double end_clock)
 
 stabilization_results stabilization::process_file()
 {
+  OCTOLAPSE_STATS_TRACED_PHASE(octolapse_stats::PROCESS_FILE);
   if (gcode_parser_ != NULL)
   {
     delete gcode_parser_;
@@ -191,48 +183,42 @@ stabilization_results stabilization::process_file()
   std::stringstream stream;
   // Make sure snapshots are enabled at the start of the process.
   snapshots_enabled_ = true;
+  gcode_read_failed_ = false;
+  stabilized_gcode_failed_ = false;
   int read_lines_before_clock_check = 2000;
-  std::cout << "stabilization::process_file - Processing file.\r\n";
+  //std::cout << "stabilization::process_file - Processing file.\r\n";
   stream << "Stabilizing file at: " << stabilization_args_.file_path;
   octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
   is_running_ = true;
 
   double next_update_time = get_next_update_time();
   const clock_t start_clock = clock();
-  file_size_ = get_file_size(stabilization_args_.file_path);
-
-  std::string path = stabilization_args_.file_path;
-
-  
-#ifdef _MSC_VER
-  
-  
-  std::wstring wpath = utilities::ToUtf16(path);
-  stream << "Windows detected, encoding file as UTF16";
-  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
-  std::ifstream gcodeFile(wpath.c_str());
-  
-  
-#else
-  std::ifstream gcodeFile(path.c_str());
-#endif
-
-
+  gcode_file_reader gcode_file;
+  gcode_file.open(stabilization_args_.file_path);
+  file_size_ = gcode_file.get_file_size();
 
   std::string line;
   int lines_with_no_commands = 0;
-  if (gcodeFile.is_open())
+  if (gcode_file.is_open())
   {
     stream.clear();
     stream.str("");
-    stream << "Opened file for reading.  File Size: " << utilities::to_string(file_size_);
+    stream << "Opened file for reading.  File Size: " << file_size_;
+    if (gcode_file.is_compressed())
+      stream << ", compressed";
     octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
     parsed_command cmd;
     // Communicate every second
-    while (std::getline(gcodeFile, line) && is_running_)
+    while (is_running_)
     {
-      file_position_ = static_cast<long>(gcodeFile.tellg());
+      OCTOLAPSE_STATS_START(read_timer, octolapse_stats::READ);
+      if (!gcode_file.read_line(line))
+        break;
+      OCTOLAPSE_STATS_STOP(read_timer);
+      file_position_ = gcode_file.get_position();
       lines_processed_++;
+      OCTOLAPSE_STATS_COUNT(octolapse_stats::LINES_READ, 1);
+      OCTOLAPSE_STATS_COUNT(octolapse_stats::BYTES_READ, static_cast<long long>(line.length()) + 1);
 
       cmd.clear();
       bool found_command = gcode_parser_->try_parse_gcode(line.c_str(), cmd);
@@ -241,6 +227,7 @@ stabilization_results stabilization::process_file()
       {
         has_gcode = true;
         gcodes_processed_++;
+        OCTOLAPSE_STATS_COUNT(octolapse_stats::GCODES_PROCESSED, 1);
       }
       else
       {
@@ -293,18 +280,19 @@ stabilization_results stabilization::process_file()
       {
         if (snapshots_enabled_)
         {
+          OCTOLAPSE_STATS_PHASE(octolapse_stats::TRIGGER_EVALUATION);
           process_pos(gcode_position_->get_current_position_ptr(), gcode_position_->get_previous_position_ptr(),
                       found_command);
         }
 
         if ((lines_processed_ % read_lines_before_clock_check) == 0 && next_update_time < clock())
         {
-          // ToDo: tellg does not do what I think it does, but why?
-          long bytesRemaining = file_size_ - file_position_;
-          double percentProgress = static_cast<double>(file_position_) / static_cast<double>(file_size_) * 100.0;
+          // Progress is measured in bytes on disk, since the decompressed size of a compressed file isn't known.
+          double fractionRead = gcode_file.get_fraction_read();
+          long long bytesRemaining = file_size_ - static_cast<long long>(fractionRead * static_cast<double>(file_size_));
+          double percentProgress = fractionRead * 100.0;
           double secondsElapsed = get_time_elapsed(start_clock, clock());
-          double bytesPerSecond = static_cast<double>(file_position_) / secondsElapsed;
-          double secondsToComplete = bytesRemaining / bytesPerSecond;
+          double secondsToComplete = fractionRead > 0 ? secondsElapsed * (1.0 - fractionRead) / fractionRead : 0;
           //std::cout << "stabilization::process_file - notifying progress...";
 
           stream.clear();
@@ -320,10 +308,21 @@ stabilization_results stabilization::process_file()
         }
       }
     }
-    // deallocate the parsed_command object
-
-    gcodeFile.close();
-    on_processing_complete();
+    if (gcode_file.has_error())
+    {
+      octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, "Unable to read the gcode file.");
+      gcode_read_failed_ = true;
+    }
+    gcode_file.close();
+    {
+      OCTOLAPSE_STATS_TRACED_PHASE(octolapse_stats::PLAN_BUILDING);
+      on_processing_complete();
+      create_snapshot_gcode();
+    }
+    {
+      OCTOLAPSE_STATS_TRACED_PHASE(octolapse_stats::WRITE);
+      write_stabilized_gcode();
+    }
     //std::cout << "stabilization::process_file - Completed Processing file.\r\n";
   }
   else
@@ -341,6 +340,7 @@ stabilization_results stabilization::process_file()
   results.processing_issues = get_processing_issues();
   // Calculate number of missed layers
   results.missed_layer_count = missed_snapshots_;
+  OCTOLAPSE_STATS_COUNT(octolapse_stats::SNAPSHOT_PLANS, static_cast<long long>(results.snapshot_plans.size()));
   stream.clear();
   stream.str("");
   stream << "Completed file processing\r\n";
@@ -391,11 +391,11 @@ stabilization_results stabilization::process_file()
 
 void stabilization::notify_progress(const double percent_progress, const double seconds_elapsed,
                                     const double seconds_to_complete,
-                                    const int gcodes_processed, const int lines_processed)
+                                    const long long gcodes_processed, const long long lines_processed)
 {
-  if (has_python_callbacks_)
+  if (has_context_callbacks_)
   {
-    is_running_ = progress_callback_(py_on_progress_received, percent_progress, seconds_elapsed, seconds_to_complete,
+    is_running_ = progress_callback_(progress_context_, percent_progress, seconds_elapsed, seconds_to_complete,
                                      gcodes_processed, lines_processed);
   }
   else if (native_progress_callback_ != NULL)
@@ -415,6 +415,52 @@ void stabilization::on_processing_start()
   // empty by default
 }
 
+void stabilization::create_snapshot_gcode()
+{
+  if (!stabilization_args_.snapshot_gcode_args.enabled)
+  {
+    return;
+  }
+  snapshot_gcode_generator_args generator_args = stabilization_args_.snapshot_gcode_args;
+  // The printer volume and g90 settings come from the position args.
+  generator_args.z_max = gcode_position_args_.z_max;
+  generator_args.g90_influences_extruder = gcode_position_args_.g90_influences_extruder;
+  snapshot_gcode_generator generator(generator_args);
+  int failed_plans = 0;
+  for (unsigned int plan_index = 0; plan_index < p_snapshot_plans_.size(); plan_index++)
+  {
+    snapshot_plan& plan = p_snapshot_plans_[plan_index];
+    if (!generator.create_gcode(plan, plan.gcode))
+    {
+      // The plugin will generate the gcode for this plan when printing.
+      plan.gcode.clear();
+      failed_plans++;
+    }
+  }
+  std::stringstream stream;
+  stream << "Created snapshot gcode for " << (p_snapshot_plans_.size() - failed_plans) << " of " <<
+    p_snapshot_plans_.size() << " snapshot plans.";
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
+}
+
+void stabilization::write_stabilized_gcode()
+{
+  stabilized_gcode_failed_ = false;
+  if (stabilization_args_.stabilized_gcode.target_file_path.empty())
+  {
+    return;
+  }
+  if (!stabilization_args_.snapshot_gcode_args.enabled)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "Unable to write the stabilized gcode file, snapshot gcode generation is not enabled.");
+    stabilized_gcode_failed_ = true;
+    return;
+  }
+  stabilized_gcode_writer writer(gcode_position_args_, stabilization_args_.stabilized_gcode);
+  stabilized_gcode_failed_ = !writer.write(stabilization_args_.file_path, p_snapshot_plans_);
+}
+
 void stabilization::on_processing_complete()
 {
   throw std::exception();
@@ -482,6 +528,22 @@ std::vector<stabilization_processing_issue> stabilization::get_processing_issues
     issues.push_back(issue);
   }
 
+  if (gcode_read_failed_)
+  {
+    stabilization_processing_issue issue;
+    issue.description = "The gcode file could not be read to the end.";
+    issue.issue_type = stabilization_processing_issue_type_gcode_not_read;
+    issues.push_back(issue);
+  }
+
+  if (stabilized_gcode_failed_)
+  {
+    stabilization_processing_issue issue;
+    issue.description = "The stabilized gcode file could not be written.";
+    issue.issue_type = stabilization_processing_issue_type_stabilized_gcode_not_written;
+    issues.push_back(issue);
+  }
+
   // Get all internal issues of any override classes
   std::vector<stabilization_processing_issue> internal_issues = get_internal_processing_issues();
   // Add these issues to the master list
@@ -499,10 +561,10 @@ void stabilization::get_next_xy_coordinates(double& x, double& y) const
   //octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Getting stabilization coordinates.");
   //std::cout << "Getting XY stabilization coordinates...";
   double x_ret, y_ret;
-  if (has_python_callbacks_)
+  if (has_context_callbacks_)
   {
     //std::cout << "calling python...";
-    if (!_get_coordinates_callback(py_get_snapshot_position_callback, stabilization_args_.x_coordinate,
+    if (!_get_coordinates_callback(get_coordinates_context_, stabilization_args_.x_coordinate,
                                    stabilization_args_.y_coordinate, x_ret, y_ret))
       octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Failed dto get snapshot coordinates.");
   }
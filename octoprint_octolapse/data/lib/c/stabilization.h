@@ -27,15 +27,10 @@
 #include "position.h"
 #include "gcode_position.h"
 #include "snapshot_plan.h"
+#include "snapshot_gcode_generator.h"
+#include "stabilized_gcode_writer.h"
 #include "stabilization_results.h"
 #include <vector>
-#ifdef _DEBUG
-#undef _DEBUG
-#include <Python.h>
-#define _DEBUG
-#else
-#include <Python.h>
-#endif
 
 static const char* travel_action = "travel";
 static const char* snapshot_action = "snapshot";
@@ -76,15 +71,25 @@ public:
 
   double x_coordinate;
   double y_coordinate;
+  /**
+   * \brief Settings used to create the final snapshot gcode for each plan after processing is complete.
+   */
+  snapshot_gcode_generator_args snapshot_gcode_args;
+  /**
+   * \brief Settings used to write a copy of the gcode file with the snapshot gcode inlined.
+   */
+  stabilized_gcode_args stabilized_gcode;
 };
 
 typedef bool (*progressCallback)(double percentComplete, double seconds_elapsed, double estimatedSecondsRemaining,
-                                 long gcodesProcessed, long linesProcessed);
-typedef bool (*pythonProgressCallback)(PyObject* python_progress_callback, double percentComplete,
-                                       double seconds_elapsed, double estimatedSecondsRemaining, int gcodesProcessed,
-                                       int linesProcessed);
-typedef bool (*pythonGetCoordinatesCallback)(PyObject* py_get_snapshot_position_callback, double x_initial,
-                                             double y_initial, double& x_result, double& y_result);
+                                 long long gcodesProcessed, long long linesProcessed);
+// Callbacks that receive an opaque context pointer, which the python bindings use to call back into python.  The
+// stabilization does not own the contexts.
+typedef bool (*contextProgressCallback)(void* progress_context, double percentComplete, double seconds_elapsed,
+                                        double estimatedSecondsRemaining, long long gcodesProcessed,
+                                        long long linesProcessed);
+typedef bool (*getCoordinatesCallback)(void* get_coordinates_context, double x_initial, double y_initial,
+                                       double& x_result, double& y_result);
 
 class stabilization
 {
@@ -93,10 +98,10 @@ public:
   stabilization();
   // constructor for use when running natively
   stabilization(gcode_position_args position_args, stabilization_args args, progressCallback progress);
-  // constructor for use when being called from python
+  // constructor for use when the stabilization points come from the caller, like when being called from python
   stabilization(gcode_position_args position_args, stabilization_args args,
-                pythonGetCoordinatesCallback get_coordinates, PyObject* py_get_coordinates_callback,
-                pythonProgressCallback progress, PyObject* py_progress_callback);
+                getCoordinatesCallback get_coordinates, void* get_coordinates_context,
+                contextProgressCallback progress, void* progress_context);
   virtual ~stabilization();
   stabilization_results process_file();
 
@@ -104,19 +109,19 @@ private:
   stabilization(const stabilization& source); // don't copy me!
   double get_next_update_time() const;
   static double get_time_elapsed(double start_clock, double end_clock);
-  bool has_python_callbacks_;
+  bool has_context_callbacks_;
   // False if return < 0, else true
-  pythonGetCoordinatesCallback _get_coordinates_callback;
+  getCoordinatesCallback _get_coordinates_callback;
   void notify_progress(double percent_progress, double seconds_elapsed, double seconds_to_complete,
-                       int gcodes_processed, int lines_processed);
+                       long long gcodes_processed, long long lines_processed);
 
   // current stabilization point
 
   double stabilization_x_;
   double stabilization_y_;
 
-  PyObject* py_on_progress_received;
-  PyObject* py_get_snapshot_position_callback;
+  void* progress_context_;
+  void* get_coordinates_context_;
 
 protected:
   /**
@@ -133,20 +138,24 @@ protected:
   virtual std::vector<stabilization_processing_issue> get_internal_processing_issues();
   virtual std::vector<stabilization_quality_issue> get_quality_issues();
   virtual std::vector<stabilization_processing_issue> get_processing_issues();
+  void create_snapshot_gcode();
+  void write_stabilized_gcode();
   std::vector<snapshot_plan> p_snapshot_plans_;
   bool is_running_;
   gcode_position_args gcode_position_args_;
   stabilization_args stabilization_args_;
   progressCallback native_progress_callback_;
-  pythonProgressCallback progress_callback_;
+  contextProgressCallback progress_callback_;
   gcode_position* gcode_position_;
   gcode_parser* gcode_parser_;
-  long get_file_size(const std::string& file_path);
-  long file_size_;
-  int lines_processed_;
-  int gcodes_processed_;
-  long file_position_;
+  // Offsets and counts are 64 bits so files over 2GB can be processed where long is 32 bits.
+  long long file_size_;
+  long long lines_processed_;
+  long long gcodes_processed_;
+  long long file_position_;
   int missed_snapshots_;
   bool snapshots_enabled_;
+  bool gcode_read_failed_;
+  bool stabilized_gcode_failed_;
 };
 #endif
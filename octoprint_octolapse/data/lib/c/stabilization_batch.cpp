@@ -0,0 +1,213 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#include "stabilization_batch.h"
+#include "logging.h"
+#include "gcode_file_reader.h"
+#include <algorithm>
+#include <atomic>
+#include <deque>
+#include <mutex>
+#include <sstream>
+#include <thread>
+
+stabilization_batch_job::stabilization_batch_job()
+{
+  type = stabilization_batch_job_type_smart_layer;
+  get_coordinates = NULL;
+  get_coordinates_context = NULL;
+  progress = NULL;
+  progress_context = NULL;
+}
+
+stabilization_batch_args::stabilization_batch_args()
+{
+  num_threads = 0;
+}
+
+namespace
+{
+  /**
+   * \brief One thread's jobs, largest first.  The owner and any thief both take from the front so that the largest
+   * remaining job is always started next.
+   */
+  struct batch_queue
+  {
+    std::mutex mutex;
+    std::deque<int> jobs;
+  };
+
+  struct batch_state
+  {
+    batch_state(const std::vector<stabilization_batch_job>& batch_jobs, const std::vector<long long>& sizes,
+                const int num_threads) : jobs(batch_jobs), file_sizes(sizes), queues(num_threads)
+    {
+      on_complete = NULL;
+      completion_context = NULL;
+      is_cancelled = false;
+      jobs_processed = 0;
+    }
+
+    const std::vector<stabilization_batch_job>& jobs;
+    const std::vector<long long>& file_sizes;
+    std::vector<batch_queue> queues;
+    stabilizationBatchCompletionCallback on_complete;
+    void* completion_context;
+    std::atomic<bool> is_cancelled;
+    std::atomic<int> jobs_processed;
+  };
+}
+
+static bool pop_front(batch_queue& queue, int& job_index)
+{
+  std::lock_guard<std::mutex> lock(queue.mutex);
+  if (queue.jobs.empty())
+    return false;
+  job_index = queue.jobs.front();
+  queue.jobs.pop_front();
+  return true;
+}
+
+static bool get_next_batch_job(batch_state& state, const int thread_index, int& job_index)
+{
+  if (pop_front(state.queues[thread_index], job_index))
+    return true;
+  // Our queue is empty, so steal the largest job any other thread is holding.
+  while (true)
+  {
+    int victim_index = -1;
+    long long victim_size = -1;
+    for (int index = 0; index < static_cast<int>(state.queues.size()); index++)
+    {
+      if (index == thread_index)
+        continue;
+      std::lock_guard<std::mutex> lock(state.queues[index].mutex);
+      if (!state.queues[index].jobs.empty() && state.file_sizes[state.queues[index].jobs.front()] > victim_size)
+      {
+        victim_index = index;
+        victim_size = state.file_sizes[state.queues[index].jobs.front()];
+      }
+    }
+    if (victim_index < 0)
+      return false;
+    // Another thief may have emptied the queue since we looked, in which case look again.
+    if (pop_front(state.queues[victim_index], job_index))
+      return true;
+  }
+}
+
+static stabilization_results process_batch_job(const stabilization_batch_job& job)
+{
+  if (job.type == stabilization_batch_job_type_smart_gcode)
+  {
+    stabilization_smart_gcode stabilization(
+      job.position_args, job.stab_args, job.gcode_args, job.get_coordinates, job.get_coordinates_context, job.progress,
+      job.progress_context
+    );
+    return stabilization.process_file();
+  }
+  stabilization_smart_layer stabilization(
+    job.position_args, job.stab_args, job.layer_args, job.get_coordinates, job.get_coordinates_context, job.progress,
+    job.progress_context
+  );
+  return stabilization.process_file();
+}
+
+static void process_batch_worker(batch_state* state, const int thread_index)
+{
+  int job_index;
+  while (!state->is_cancelled && get_next_batch_job(*state, thread_index, job_index))
+  {
+    const stabilization_results results = process_batch_job(state->jobs[job_index]);
+    state->jobs_processed++;
+    if (state->on_complete != NULL && !state->on_complete(state->completion_context, job_index, results))
+      state->is_cancelled = true;
+  }
+}
+
+stabilization_batch::stabilization_batch(stabilization_batch_args args)
+{
+  args_ = args;
+}
+
+std::vector<std::vector<int>> stabilization_batch::get_thread_queues(const std::vector<long long>& file_sizes,
+                                                                     const int num_threads)
+{
+  std::vector<int> order(file_sizes.size());
+  for (int index = 0; index < static_cast<int>(order.size()); index++)
+    order[index] = index;
+  std::stable_sort(order.begin(), order.end(), [&file_sizes](const int left, const int right)
+  {
+    return file_sizes[left] > file_sizes[right];
+  });
+  // Dealing the sorted jobs in turn keeps every queue sorted and gives each thread a similar amount of work.
+  std::vector<std::vector<int>> queues(num_threads < 1 ? 1 : num_threads);
+  for (int index = 0; index < static_cast<int>(order.size()); index++)
+    queues[index % queues.size()].push_back(order[index]);
+  return queues;
+}
+
+int stabilization_batch::process(const std::vector<stabilization_batch_job>& jobs,
+                                 const stabilizationBatchCompletionCallback on_complete,
+                                 void* completion_context) const
+{
+  if (jobs.empty())
+    return 0;
+  int num_threads = args_.num_threads;
+  if (num_threads < 1)
+    num_threads = static_cast<int>(std::thread::hardware_concurrency());
+  if (num_threads < 1)
+    num_threads = 1;
+  if (num_threads > static_cast<int>(jobs.size()))
+    num_threads = static_cast<int>(jobs.size());
+
+  std::vector<long long> file_sizes(jobs.size());
+  long long total_size = 0;
+  for (int index = 0; index < static_cast<int>(jobs.size()); index++)
+  {
+    // A missing file sorts last and fails quickly when processed.
+    file_sizes[index] = std::max(0LL, gcode_file_reader::get_file_size(jobs[index].stab_args.file_path));
+    total_size += file_sizes[index];
+  }
+  std::stringstream stream;
+  stream << "Preprocessing " << jobs.size() << " files (" << total_size << " bytes) with " << num_threads
+    << " threads.";
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
+
+  batch_state state(jobs, file_sizes, num_threads);
+  state.on_complete = on_complete;
+  state.completion_context = completion_context;
+  const std::vector<std::vector<int>> thread_queues = get_thread_queues(file_sizes, num_threads);
+  for (int index = 0; index < num_threads; index++)
+    state.queues[index].jobs.assign(thread_queues[index].begin(), thread_queues[index].end());
+
+  std::vector<std::thread> workers;
+  for (int index = 1; index < num_threads; index++)
+    workers.push_back(std::thread(process_batch_worker, &state, index));
+  // The calling thread works too
+  process_batch_worker(&state, 0);
+  for (std::vector<std::thread>::iterator worker = workers.begin(); worker != workers.end(); ++worker)
+    worker->join();
+
+  if (state.is_cancelled)
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "The preprocessing batch was cancelled.");
+  return state.jobs_processed;
+}
@@ -0,0 +1,92 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+
+#ifndef STABILIZATION_BATCH_H
+#define STABILIZATION_BATCH_H
+#include <string>
+#include <vector>
+#include "gcode_position.h"
+#include "stabilization.h"
+#include "stabilization_results.h"
+#include "stabilization_smart_layer.h"
+#include "stabilization_smart_gcode.h"
+
+enum stabilization_batch_job_type
+{
+  stabilization_batch_job_type_smart_layer = 0,
+  stabilization_batch_job_type_smart_gcode = 1
+};
+
+/**
+ * \brief One file to preprocess.  The callbacks and their contexts are passed to the stabilization unchanged, so
+ * they may be called from any of the batch's threads.
+ */
+struct stabilization_batch_job
+{
+  stabilization_batch_job();
+  stabilization_batch_job_type type;
+  gcode_position_args position_args;
+  stabilization_args stab_args;
+  // Only the args that match the job type are used.
+  smart_layer_args layer_args;
+  smart_gcode_args gcode_args;
+  getCoordinatesCallback get_coordinates;
+  void* get_coordinates_context;
+  contextProgressCallback progress;
+  void* progress_context;
+};
+
+struct stabilization_batch_args
+{
+  stabilization_batch_args();
+  // The number of files preprocessed at once, 0 to use every core.
+  int num_threads;
+};
+
+/**
+ * \brief Called from a worker thread each time a job finishes.  Return false to skip the jobs that haven't started.
+ */
+typedef bool (*stabilizationBatchCompletionCallback)(void* completion_context, int job_index,
+                                                     const stabilization_results& results);
+
+/**
+ * \brief Preprocesses many files on a work stealing thread pool.  The largest files are started first so that a
+ * single large file doesn't hold up the end of the batch.
+ */
+class stabilization_batch
+{
+public:
+  stabilization_batch(stabilization_batch_args args);
+  /**
+   * \brief Processes the jobs, blocking until all of them have finished or the batch is cancelled.
+   * \return The number of jobs that were processed.
+   */
+  int process(const std::vector<stabilization_batch_job>& jobs, stabilizationBatchCompletionCallback on_complete,
+              void* completion_context) const;
+  /**
+   * \brief Deals the jobs to each thread's queue, largest first.  Exposed so that the order can be tested.
+   */
+  static std::vector<std::vector<int>> get_thread_queues(const std::vector<long long>& file_sizes, int num_threads);
+private:
+  stabilization_batch_args args_;
+};
+#endif
@@ -0,0 +1,549 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// A command line front end for the native stabilizations, used to profile and benchmark preprocessing without
+// OctoPrint.  It is not part of the python extension and does not need python to build.  Build it from this
+// directory, together with the plugin_core_sources listed in setup.py:
+//
+//   g++ -O3 -std=c++11 -pthread -o octolapse_stabilize stabilization_cli.cpp <sources>
+//
+// No log handler is registered, so logging is disabled and only the native code paths run.
+//
+// Usage: octolapse_stabilize <settings.ini> [options]
+//   --gcode <path>  The gcode file to stabilize, overriding file_path in the settings.
+//   --runs <n>      Process the file n times, reporting the time of each run.
+//   --no-plans      Leave the snapshot plans out of the output.
+//   --trace <path>  Write a chrome trace-event file of the processing phases (requires statistics).
+//
+// The settings file uses the keys of the python argument dicts:
+//
+//   [stabilization]
+//   type = smart_layer          ; or smart_gcode
+//   file_path = /path/to/file.gcode
+//   x_coordinate = 125
+//   y_coordinate = 100
+//   x_stabilization_disabled = false
+//   y_stabilization_disabled = false
+//   height_increment = 0
+//
+//   [smart_layer]
+//   trigger_type = compatibility ; snap_to_print, fast, compatibility or high_quality
+//   snap_to_print_high_quality = false
+//   snap_to_print_smooth = false
+//   arc_chord_tolerance = 0
+//
+//   [smart_gcode]
+//   snapshot_command = @OCTOLAPSE TAKE-SNAPSHOT
+//
+//   [position]
+//   bed_type = rectangular      ; or circular
+//   min_x = 0, max_x, min_y, max_y, min_z, max_z
+//   bounds_min_x, bounds_max_x, ...  ; optional snapshot bounds, all six are required if any are given
+//   home_x, home_y, home_z      ; leave out if unknown
+//   xyz_axis_default_mode = absolute, e_axis_default_mode = absolute, units_default = millimeters
+//   autodetect_position, g90_influences_extruder, priming_height, minimum_layer_height
+//   num_extruders = 1, shared_extruder, zero_based_extruder, default_extruder_index
+//   retraction_lengths = 1.0    ; comma separated, one per extruder
+//   z_lift_heights = 0.5        ; comma separated, one per extruder
+//   location_detection_commands ; comma separated
+//   fixed_point_decimals = 0
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "gcode_file_reader.h"
+#include "gcode_parser.h"
+#include "instrumentation.h"
+#include "stabilization_smart_layer.h"
+#include "stabilization_smart_gcode.h"
+#include "utilities.h"
+
+typedef std::map<std::string, std::map<std::string, std::string> > settings_sections;
+
+#pragma region Settings
+static std::string trim(const std::string& value)
+{
+  const std::string::size_type start = value.find_first_not_of(" \t\r\n");
+  if (start == std::string::npos)
+    return "";
+  const std::string::size_type end = value.find_last_not_of(" \t\r\n");
+  return value.substr(start, end - start + 1);
+}
+
+static bool read_settings(const std::string& file_path, settings_sections& sections)
+{
+  std::ifstream settings_file(file_path.c_str());
+  if (!settings_file.is_open())
+  {
+    std::cerr << "Unable to open the settings file: " << file_path << "\n";
+    return false;
+  }
+  std::string section;
+  std::string line;
+  int line_number = 0;
+  while (std::getline(settings_file, line))
+  {
+    line_number++;
+    // Comments start with ; or #, but a ; inside a value is part of the value (@OCTOLAPSE commands, etc).
+    line = trim(line);
+    if (line.empty() || line[0] == ';' || line[0] == '#')
+      continue;
+    if (line[0] == '[')
+    {
+      const std::string::size_type end = line.find(']');
+      if (end == std::string::npos)
+      {
+        std::cerr << "Invalid section on line " << line_number << " of the settings file.\n";
+        return false;
+      }
+      section = trim(line.substr(1, end - 1));
+      continue;
+    }
+    const std::string::size_type separator = line.find('=');
+    if (separator == std::string::npos)
+    {
+      std::cerr << "Expected key = value on line " << line_number << " of the settings file.\n";
+      return false;
+    }
+    std::string value = trim(line.substr(separator + 1));
+    // Remove trailing comments that are separated from the value by whitespace
+    const std::string::size_type comment = value.find(" ;");
+    if (comment != std::string::npos)
+      value = trim(value.substr(0, comment));
+    sections[section][trim(line.substr(0, separator))] = value;
+  }
+  return true;
+}
+
+class settings_reader
+{
+public:
+  settings_reader(settings_sections& sections, const std::string& section) : values_(sections[section]), section_(section)
+  {
+    is_valid_ = true;
+  }
+
+  bool has(const std::string& key) const
+  {
+    return values_.find(key) != values_.end();
+  }
+
+  std::string get_string(const std::string& key, const std::string& default_value) const
+  {
+    std::map<std::string, std::string>::const_iterator it = values_.find(key);
+    return it == values_.end() ? default_value : it->second;
+  }
+
+  double get_double(const std::string& key, double default_value)
+  {
+    std::map<std::string, std::string>::const_iterator it = values_.find(key);
+    if (it == values_.end())
+      return default_value;
+    char* end;
+    const double value = std::strtod(it->second.c_str(), &end);
+    if (end == it->second.c_str() || *end != '\0')
+      return invalid(key, default_value);
+    return value;
+  }
+
+  int get_int(const std::string& key, int default_value)
+  {
+    std::map<std::string, std::string>::const_iterator it = values_.find(key);
+    if (it == values_.end())
+      return default_value;
+    char* end;
+    const long value = std::strtol(it->second.c_str(), &end, 10);
+    if (end == it->second.c_str() || *end != '\0')
+      return static_cast<int>(invalid(key, default_value));
+    return static_cast<int>(value);
+  }
+
+  bool get_bool(const std::string& key, bool default_value)
+  {
+    std::map<std::string, std::string>::const_iterator it = values_.find(key);
+    if (it == values_.end())
+      return default_value;
+    const std::string value = it->second;
+    if (value == "true" || value == "True" || value == "1")
+      return true;
+    if (value == "false" || value == "False" || value == "0")
+      return false;
+    return invalid(key, default_value) != 0;
+  }
+
+  std::vector<std::string> get_list(const std::string& key) const
+  {
+    std::vector<std::string> items;
+    std::stringstream stream(get_string(key, ""));
+    std::string item;
+    while (std::getline(stream, item, ','))
+    {
+      item = trim(item);
+      if (!item.empty())
+        items.push_back(item);
+    }
+    return items;
+  }
+
+  bool is_valid() const
+  {
+    return is_valid_;
+  }
+
+private:
+  double invalid(const std::string& key, double default_value)
+  {
+    std::cerr << "Invalid value for [" << section_ << "] " << key << ": " << values_[key] << "\n";
+    is_valid_ = false;
+    return default_value;
+  }
+
+  std::map<std::string, std::string>& values_;
+  std::string section_;
+  bool is_valid_;
+};
+
+static bool read_position_args(settings_sections& sections, gcode_position_args& args)
+{
+  settings_reader reader(sections, "position");
+  args.is_circular_bed = reader.get_string("bed_type", "rectangular") == "circular";
+  args.x_min = reader.get_double("min_x", 0);
+  args.x_max = reader.get_double("max_x", 0);
+  args.y_min = reader.get_double("min_y", 0);
+  args.y_max = reader.get_double("max_y", 0);
+  args.z_min = reader.get_double("min_z", 0);
+  args.z_max = reader.get_double("max_z", 0);
+  args.is_bound_ = reader.has("bounds_min_x");
+  if (args.is_bound_)
+  {
+    args.snapshot_x_min = reader.get_double("bounds_min_x", 0);
+    args.snapshot_x_max = reader.get_double("bounds_max_x", 0);
+    args.snapshot_y_min = reader.get_double("bounds_min_y", 0);
+    args.snapshot_y_max = reader.get_double("bounds_max_y", 0);
+    args.snapshot_z_min = reader.get_double("bounds_min_z", 0);
+    args.snapshot_z_max = reader.get_double("bounds_max_z", 0);
+  }
+  else
+  {
+    args.snapshot_x_min = args.x_min;
+    args.snapshot_x_max = args.x_max;
+    args.snapshot_y_min = args.y_min;
+    args.snapshot_y_max = args.y_max;
+    args.snapshot_z_min = args.z_min;
+    args.snapshot_z_max = args.z_max;
+  }
+  args.home_x_none = !reader.has("home_x");
+  args.home_x = reader.get_double("home_x", 0);
+  args.home_y_none = !reader.has("home_y");
+  args.home_y = reader.get_double("home_y", 0);
+  args.home_z_none = !reader.has("home_z");
+  args.home_z = reader.get_double("home_z", 0);
+  args.xyz_axis_default_mode = reader.get_string("xyz_axis_default_mode", "absolute");
+  args.e_axis_default_mode = reader.get_string("e_axis_default_mode", "absolute");
+  args.units_default = reader.get_string("units_default", "millimeters");
+  args.autodetect_position = reader.get_bool("autodetect_position", true);
+  args.g90_influences_extruder = reader.get_bool("g90_influences_extruder", false);
+  args.priming_height = reader.get_double("priming_height", 0);
+  args.minimum_layer_height = reader.get_double("minimum_layer_height", 0);
+  args.fixed_point_decimals = reader.get_int("fixed_point_decimals", 0);
+  args.location_detection_commands = reader.get_list("location_detection_commands");
+
+  const int num_extruders = reader.get_int("num_extruders", 1);
+  if (num_extruders < 1)
+  {
+    std::cerr << "[position] num_extruders must be at least 1.\n";
+    return false;
+  }
+  args.set_num_extruders(num_extruders);
+  args.shared_extruder = reader.get_bool("shared_extruder", true);
+  args.zero_based_extruder = reader.get_bool("zero_based_extruder", true);
+  args.default_extruder = reader.get_int("default_extruder_index", 0);
+  const std::vector<std::string> retraction_lengths = reader.get_list("retraction_lengths");
+  const std::vector<std::string> z_lift_heights = reader.get_list("z_lift_heights");
+  for (int index = 0; index < num_extruders; index++)
+  {
+    // Like the plugin, use the first extruder's settings for any that are missing.
+    if (!retraction_lengths.empty())
+      args.retraction_lengths[index] = std::atof(retraction_lengths[
+        index < static_cast<int>(retraction_lengths.size()) ? index : 0].c_str());
+    if (!z_lift_heights.empty())
+      args.z_lift_heights[index] = std::atof(z_lift_heights[
+        index < static_cast<int>(z_lift_heights.size()) ? index : 0].c_str());
+  }
+  return reader.is_valid();
+}
+
+static bool read_stabilization_args(settings_sections& sections, stabilization_args& args, std::string& type)
+{
+  settings_reader reader(sections, "stabilization");
+  type = reader.get_string("type", SMART_LAYER_STABILIZATION);
+  if (type != SMART_LAYER_STABILIZATION && type != SMART_GCODE_STABILIZATION)
+  {
+    std::cerr << "[stabilization] type must be " << SMART_LAYER_STABILIZATION << " or " << SMART_GCODE_STABILIZATION
+      << ".\n";
+    return false;
+  }
+  args.file_path = reader.get_string("file_path", "");
+  args.x_coordinate = reader.get_double("x_coordinate", 0);
+  args.y_coordinate = reader.get_double("y_coordinate", 0);
+  args.x_stabilization_disabled = reader.get_bool("x_stabilization_disabled", false);
+  args.y_stabilization_disabled = reader.get_bool("y_stabilization_disabled", false);
+  args.height_increment = reader.get_double("height_increment", 0);
+  // Progress is never reported, so don't bother checking the clock.
+  args.notification_period_seconds = 3600;
+  return reader.is_valid();
+}
+
+static bool read_smart_layer_args(settings_sections& sections, smart_layer_args& args)
+{
+  settings_reader reader(sections, "smart_layer");
+  const std::string trigger = reader.get_string("trigger_type", "compatibility");
+  if (trigger == "snap_to_print")
+    args.smart_layer_trigger_type = trigger_type_snap_to_print;
+  else if (trigger == "fast")
+    args.smart_layer_trigger_type = trigger_type_fast;
+  else if (trigger == "compatibility")
+    args.smart_layer_trigger_type = trigger_type_compatibility;
+  else if (trigger == "high_quality")
+    args.smart_layer_trigger_type = trigger_type_high_quality;
+  else
+  {
+    std::cerr << "Unknown [smart_layer] trigger_type: " << trigger << "\n";
+    return false;
+  }
+  args.snap_to_print_high_quality = reader.get_bool("snap_to_print_high_quality", false);
+  args.snap_to_print_smooth = reader.get_bool("snap_to_print_smooth", false);
+  args.arc_chord_tolerance = reader.get_double("arc_chord_tolerance", 0);
+  return reader.is_valid();
+}
+
+static bool read_smart_gcode_args(settings_sections& sections, smart_gcode_args& args)
+{
+  settings_reader reader(sections, "smart_gcode");
+  if (!reader.has("snapshot_command"))
+    return true;
+  args.snapshot_command.clear();
+  args.snapshot_command_text = reader.get_string("snapshot_command", "");
+  gcode_parser parser;
+  parser.try_parse_gcode(args.snapshot_command_text.c_str(), args.snapshot_command);
+  if (args.snapshot_command.gcode.empty())
+  {
+    std::cerr << "Unable to parse the [smart_gcode] snapshot_command: " << args.snapshot_command_text << "\n";
+    return false;
+  }
+  return true;
+}
+#pragma endregion
+
+#pragma region Output
+static std::string to_json_string(const std::string& value)
+{
+  std::string json = "\"";
+  for (std::string::const_iterator it = value.begin(); it != value.end(); ++it)
+  {
+    const unsigned char c = static_cast<unsigned char>(*it);
+    if (c == '"' || c == '\\')
+      json.append(1, '\\').append(1, static_cast<char>(c));
+    else if (c < 0x20)
+    {
+      char escaped[7];
+      std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+      json.append(escaped);
+    }
+    else
+      json.append(1, static_cast<char>(c));
+  }
+  json.append("\"");
+  return json;
+}
+
+static void write_plan(std::ostream& out, const snapshot_plan& plan)
+{
+  out << "{\"file_line\":" << plan.file_line
+    << ",\"file_gcode_number\":" << plan.file_gcode_number
+    << ",\"file_position\":" << plan.file_position
+    << ",\"layer\":" << plan.initial_position.layer
+    << ",\"x\":" << plan.initial_position.x
+    << ",\"y\":" << plan.initial_position.y
+    << ",\"z\":" << plan.initial_position.z
+    << ",\"triggering_command_type\":" << to_json_string(position_type_name[plan.triggering_command_type])
+    << ",\"feature_type\":" << to_json_string(feature_type_name[plan.triggering_command_feature_type])
+    << ",\"distance_from_stabilization_point\":" << plan.distance_from_stabilization_point
+    << ",\"total_travel_distance\":" << plan.total_travel_distance
+    << ",\"gcode\":" << to_json_string(plan.start_command.gcode)
+    << ",\"steps\":" << plan.steps.size()
+    << "}";
+}
+
+static void write_results(std::ostream& out, const stabilization_results& results, bool include_plans)
+{
+  out << "{\"gcodes_processed\":" << results.gcodes_processed
+    << ",\"lines_processed\":" << results.lines_processed
+    << ",\"missed_layer_count\":" << results.missed_layer_count
+    << ",\"snapshot_plan_count\":" << results.snapshot_plans.size()
+    << ",\"quality_issues\":[";
+  for (unsigned int index = 0; index < results.quality_issues.size(); index++)
+    out << (index == 0 ? "" : ",") << to_json_string(results.quality_issues[index].description);
+  out << "],\"processing_issues\":[";
+  for (unsigned int index = 0; index < results.processing_issues.size(); index++)
+    out << (index == 0 ? "" : ",") << to_json_string(results.processing_issues[index].description);
+  out << "]";
+  if (include_plans)
+  {
+    out << ",\"snapshot_plans\":[";
+    for (unsigned int index = 0; index < results.snapshot_plans.size(); index++)
+    {
+      out << (index == 0 ? "\n" : ",\n");
+      write_plan(out, results.snapshot_plans[index]);
+    }
+    out << "\n]";
+  }
+  out << "}";
+}
+#pragma endregion
+
+// The CLI runs to completion, so progress is ignored.
+static bool on_progress(double, double, double, long long, long long)
+{
+  return true;
+}
+
+static stabilization_results run_stabilization(const std::string& type, const gcode_position_args& position_args,
+                                               const stabilization_args& stab_args,
+                                               const smart_layer_args& layer_args,
+                                               const smart_gcode_args& gcode_args)
+{
+  if (type == SMART_GCODE_STABILIZATION)
+  {
+    stabilization_smart_gcode stabilization(position_args, stab_args, gcode_args, on_progress);
+    return stabilization.process_file();
+  }
+  stabilization_smart_layer stabilization(position_args, stab_args, layer_args, on_progress);
+  return stabilization.process_file();
+}
+
+static void print_usage()
+{
+  std::cerr << "Usage: octolapse_stabilize <settings.ini> [--gcode <path>] [--runs <n>] [--no-plans] [--trace <path>]\n";
+}
+
+int main(int argc, char* argv[])
+{
+  if (argc < 2)
+  {
+    print_usage();
+    return 2;
+  }
+  std::string settings_path = argv[1];
+  std::string gcode_path;
+  std::string trace_path;
+  int runs = 1;
+  bool include_plans = true;
+  for (int index = 2; index < argc; index++)
+  {
+    const std::string arg = argv[index];
+    if (arg == "--gcode" && index + 1 < argc)
+      gcode_path = argv[++index];
+    else if (arg == "--runs" && index + 1 < argc)
+      runs = std::atoi(argv[++index]);
+    else if (arg == "--trace" && index + 1 < argc)
+      trace_path = argv[++index];
+    else if (arg == "--no-plans")
+      include_plans = false;
+    else
+    {
+      print_usage();
+      return 2;
+    }
+  }
+  if (runs < 1)
+  {
+    std::cerr << "--runs must be at least 1.\n";
+    return 2;
+  }
+
+  settings_sections sections;
+  gcode_position_args position_args;
+  stabilization_args stab_args;
+  smart_layer_args layer_args;
+  smart_gcode_args gcode_args;
+  std::string type;
+  if (!read_settings(settings_path, sections)
+    || !read_stabilization_args(sections, stab_args, type)
+    || !read_position_args(sections, position_args)
+    || !read_smart_layer_args(sections, layer_args)
+    || !read_smart_gcode_args(sections, gcode_args))
+    return 2;
+  if (!gcode_path.empty())
+    stab_args.file_path = gcode_path;
+  const long long file_size = gcode_file_reader::get_file_size(stab_args.file_path);
+  if (file_size < 0)
+  {
+    std::cerr << "Unable to open the gcode file: " << stab_args.file_path << "\n";
+    return 1;
+  }
+
+  if (!trace_path.empty())
+  {
+#ifndef OCTOLAPSE_DISABLE_STATS
+    octolapse_set_stats_enabled(true);
+    octolapse_reset_stats();
+#else
+    std::cerr << "Statistics were compiled out, no trace will be written.\n";
+#endif
+  }
+
+  std::cout.precision(17);
+  std::cout << "{\"file_path\":" << to_json_string(stab_args.file_path)
+    << ",\"type\":" << to_json_string(type)
+    << ",\"file_size\":" << file_size
+    << ",\"runs\":[";
+  stabilization_results results;
+  double total_seconds = 0;
+  for (int run = 0; run < runs; run++)
+  {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    results = run_stabilization(type, position_args, stab_args, layer_args, gcode_args);
+    const double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    total_seconds += seconds;
+    std::cout << (run == 0 ? "\n" : ",\n")
+      << "{\"seconds\":" << seconds
+      << ",\"lines_per_second\":" << (seconds > 0 ? results.lines_processed / seconds : 0)
+      << ",\"megabytes_per_second\":" << (seconds > 0 ? file_size / seconds / 1000000.0 : 0) << "}";
+  }
+  std::cout << "\n],\"mean_seconds\":" << total_seconds / runs << ",\"results\":";
+  write_results(std::cout, results, include_plans);
+  std::cout << "}\n";
+
+#ifndef OCTOLAPSE_DISABLE_STATS
+  if (!trace_path.empty() && !octolapse_write_stats_trace(trace_path))
+  {
+    std::cerr << "Unable to write the trace file: " << trace_path << "\n";
+    return 1;
+  }
+#endif
+  return 0;
+}
@@ -39,14 +39,15 @@ enum stabilization_processing_issue_type
   stabilization_processing_issue_type_no_definite_position = 3,
   stabilization_processing_issue_type_printer_not_primed = 4,
   stabilization_processing_issue_type_no_metric_units = 5,
-  stabilization_processing_issue_type_no_snapshot_commands_found = 6
+  stabilization_processing_issue_type_no_snapshot_commands_found = 6,
+  stabilization_processing_issue_type_stabilized_gcode_not_written = 7,
+  stabilization_processing_issue_type_gcode_not_read = 8
 };
 
 struct stabilization_quality_issue
 {
   std::string description;
   stabilization_quality_issue_type issue_type;
-  PyObject* to_py_object() const;
 };
 
 struct replacement_token
@@ -60,17 +61,15 @@ struct stabilization_processing_issue
   std::string description;
   stabilization_processing_issue_type issue_type;
   std::vector<replacement_token> replacement_tokens;
-  PyObject* to_py_object() const;
 };
 
 struct stabilization_results
 {
   stabilization_results();
-  PyObject* to_py_object();
   std::vector<snapshot_plan> snapshot_plans;
   double seconds_elapsed;
-  long gcodes_processed;
-  long lines_processed;
+  long long gcodes_processed;
+  long long lines_processed;
   int missed_layer_count;
   std::vector<stabilization_quality_issue> quality_issues;
   std::vector<stabilization_processing_issue> processing_issues;
@@ -27,10 +27,10 @@ stabilization_smart_gcode::stabilization_smart_gcode(gcode_position_args positio
 
 stabilization_smart_gcode::stabilization_smart_gcode(gcode_position_args position_args, stabilization_args stab_args,
                                                      smart_gcode_args mt_args,
-                                                     pythonGetCoordinatesCallback get_coordinates,
-                                                     PyObject* py_get_coordinates_callback,
-                                                     pythonProgressCallback progress, PyObject* py_progress_callback) :
-  stabilization(position_args, stab_args, get_coordinates, py_get_coordinates_callback, progress, py_progress_callback)
+                                                     getCoordinatesCallback get_coordinates,
+                                                     void* get_coordinates_context,
+                                                     contextProgressCallback progress, void* progress_context) :
+  stabilization(position_args, stab_args, get_coordinates, get_coordinates_context, progress, progress_context)
 {
   // Initialize travel args
   smart_gcode_args_ = mt_args;
@@ -28,8 +28,8 @@ public:
   stabilization_smart_gcode(gcode_position_args position_args, stabilization_args stab_args, smart_gcode_args mt_args,
                             progressCallback progress);
   stabilization_smart_gcode(gcode_position_args position_args, stabilization_args stab_args, smart_gcode_args mt_args,
-                            pythonGetCoordinatesCallback get_coordinates, PyObject* py_get_coordinates_callback,
-                            pythonProgressCallback progress, PyObject* py_progress_callback);
+                            getCoordinatesCallback get_coordinates, void* get_coordinates_context,
+                            contextProgressCallback progress, void* progress_context);
   virtual ~stabilization_smart_gcode();
 private:
   static std::string default_snapshot_gcode_;
@@ -48,6 +48,7 @@ stabilization_smart_layer::stabilization_smart_layer(
   default_args.snap_to_print_high_quality = mt_args.snap_to_print_high_quality;
   default_args.x_stabilization_disabled = stab_args.x_stabilization_disabled;
   default_args.y_stabilization_disabled = stab_args.y_stabilization_disabled;
+  default_args.arc_chord_tolerance = mt_args.arc_chord_tolerance;
   closest_positions_.initialize(default_args);
   last_snapshot_initial_position_.is_empty = true;
   update_stabilization_coordinates();
@@ -55,10 +56,9 @@ stabilization_smart_layer::stabilization_smart_layer(
 
 stabilization_smart_layer::stabilization_smart_layer(
   gcode_position_args position_args, stabilization_args stab_args, smart_layer_args mt_args,
-  pythonGetCoordinatesCallback get_coordinates, PyObject* py_get_coordinates_callback, pythonProgressCallback progress,
-  PyObject* py_progress_callback
-) : stabilization(position_args, stab_args, get_coordinates, py_get_coordinates_callback, progress,
-                  py_progress_callback)
+  getCoordinatesCallback get_coordinates, void* get_coordinates_context, contextProgressCallback progress,
+  void* progress_context
+) : stabilization(position_args, stab_args, get_coordinates, get_coordinates_context, progress, progress_context)
 {
   is_layer_change_wait_ = false;
   last_snapshot_layer_ = 0;
@@ -81,6 +81,7 @@ stabilization_smart_layer::stabilization_smart_layer(
   default_args.snap_to_print_high_quality = mt_args.snap_to_print_high_quality;
   default_args.x_stabilization_disabled = stab_args.x_stabilization_disabled;
   default_args.y_stabilization_disabled = stab_args.y_stabilization_disabled;
+  default_args.arc_chord_tolerance = mt_args.arc_chord_tolerance;
   closest_positions_.initialize(default_args);
   last_snapshot_initial_position_.is_empty = true;
   update_stabilization_coordinates();
@@ -201,7 +202,14 @@ void stabilization_smart_layer::add_plan()
     p_plan.triggering_command_feature_type = p_closest.type_feature;
     // create the initial position
     p_plan.triggering_command = p_closest.pos.command;
-    p_plan.start_command = p_closest.pos.command;
+    if (p_closest.is_arc_split)
+    {
+      // The position is within the triggering arc, so split the arc at the position.
+      p_plan.start_command = p_closest.arc_start_command;
+      p_plan.end_command = p_closest.arc_end_command;
+    }
+    else
+      p_plan.start_command = p_closest.pos.command;
     p_plan.initial_position = p_closest.pos;
     p_plan.has_initial_position = true;
     const bool all_stabilizations_disabled = stabilization_args_.x_stabilization_disabled && stabilization_args_.
@@ -3,11 +3,6 @@
 #include "stabilization.h"
 #include "position.h"
 #include "trigger_position.h"
-#ifdef _DEBUG
-#undef _DEBUG
-#include <Python.h>
-#define _DEBUG
-#endif
 static const char* SMART_LAYER_STABILIZATION = "smart_layer";
 
 struct smart_layer_args
@@ -18,12 +13,15 @@ struct smart_layer_args
     speed_threshold = 0;
     snap_to_print_high_quality = false;
     snap_to_print_smooth = false;
+    arc_chord_tolerance = 0;
   }
 
   trigger_type smart_layer_trigger_type;
   double speed_threshold;
   bool snap_to_print_high_quality;
   bool snap_to_print_smooth;
+  // Points within arcs are considered when greater than 0.  See trigger_position_args::arc_chord_tolerance.
+  double arc_chord_tolerance;
 };
 
 class stabilization_smart_layer : public stabilization
@@ -33,8 +31,8 @@ public:
   stabilization_smart_layer(gcode_position_args position_args, stabilization_args stab_args, smart_layer_args mt_args,
                             progressCallback progress);
   stabilization_smart_layer(gcode_position_args position_args, stabilization_args stab_args, smart_layer_args mt_args,
-                            pythonGetCoordinatesCallback get_coordinates, PyObject* py_get_coordinates_callback,
-                            pythonProgressCallback progress, PyObject* py_progress_callback);
+                            getCoordinatesCallback get_coordinates, void* get_coordinates_context,
+                            contextProgressCallback progress, void* progress_context);
   ~stabilization_smart_layer();
 private:
   stabilization_smart_layer(const stabilization_smart_layer& source); // don't copy me
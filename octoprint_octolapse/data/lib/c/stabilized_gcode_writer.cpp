@@ -0,0 +1,591 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Use 64 bit offsets for pread and fstat where long is 32 bits.  This must come before any include.
+#ifndef _FILE_OFFSET_BITS
+#define _FILE_OFFSET_BITS 64
+#endif
+#include "stabilized_gcode_writer.h"
+#include "gcode_file_reader.h"
+#include "gcode_parser.h"
+#include "stabilization.h"
+#include "utilities.h"
+#include "logging.h"
+#include <sstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#ifdef _MSC_VER
+#include <io.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#else
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <cerrno>
+#ifdef __linux__
+#include <sys/sendfile.h>
+#endif
+#endif
+
+// The size of the buffer used when the bytes can't be copied within the kernel
+#define STABILIZED_GCODE_COPY_BUFFER_SIZE 1048576
+// The number of bytes to read backwards when searching for the start of the triggering line
+#define STABILIZED_GCODE_LINE_SEARCH_SIZE 4096
+
+#pragma region Low level file functions
+static int open_source_file(const std::string& path)
+{
+#ifdef _MSC_VER
+  std::wstring wpath = utilities::ToUtf16(path);
+  return _wopen(wpath.c_str(), _O_RDONLY | _O_BINARY);
+#else
+  return open(path.c_str(), O_RDONLY);
+#endif
+}
+
+static int open_target_file(const std::string& path)
+{
+#ifdef _MSC_VER
+  std::wstring wpath = utilities::ToUtf16(path);
+  return _wopen(wpath.c_str(), _O_WRONLY | _O_CREAT | _O_TRUNC | _O_BINARY, _S_IREAD | _S_IWRITE);
+#else
+  return open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+#endif
+}
+
+static void close_file(int fd)
+{
+#ifdef _MSC_VER
+  _close(fd);
+#else
+  close(fd);
+#endif
+}
+
+static long long get_open_file_size(int fd)
+{
+#ifdef _MSC_VER
+  struct _stat64 file_stat;
+  if (_fstat64(fd, &file_stat) != 0)
+    return -1;
+#else
+  struct stat file_stat;
+  if (fstat(fd, &file_stat) != 0)
+    return -1;
+#endif
+  return static_cast<long long>(file_stat.st_size);
+}
+
+static bool read_at(int fd, long long offset, char* buffer, long long length)
+{
+#ifdef _MSC_VER
+  if (_lseeki64(fd, offset, SEEK_SET) < 0)
+    return false;
+  while (length > 0)
+  {
+    const int bytes_read = _read(fd, buffer, static_cast<unsigned int>(length));
+    if (bytes_read <= 0)
+      return false;
+    buffer += bytes_read;
+    length -= bytes_read;
+  }
+#else
+  while (length > 0)
+  {
+    const ssize_t bytes_read = pread(fd, buffer, static_cast<size_t>(length), static_cast<off_t>(offset));
+    if (bytes_read < 0 && errno == EINTR)
+      continue;
+    if (bytes_read <= 0)
+      return false;
+    buffer += bytes_read;
+    offset += bytes_read;
+    length -= bytes_read;
+  }
+#endif
+  return true;
+}
+
+static bool write_all(int fd, const char* buffer, long long length)
+{
+  while (length > 0)
+  {
+#ifdef _MSC_VER
+    const int bytes_written = _write(fd, buffer, static_cast<unsigned int>(length));
+#else
+    const ssize_t bytes_written = write(fd, buffer, static_cast<size_t>(length));
+    if (bytes_written < 0 && errno == EINTR)
+      continue;
+#endif
+    if (bytes_written <= 0)
+      return false;
+    buffer += bytes_written;
+    length -= bytes_written;
+  }
+  return true;
+}
+
+/**
+ * \brief Copies length bytes starting at offset from the source to the current position of the target.
+ * The copy is done within the kernel (copy_file_range, then sendfile) when possible.
+ */
+static bool copy_span(int source_fd, int target_fd, long long offset, long long length)
+{
+#if defined(__linux__)
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || (__GLIBC__ == 2 && __GLIBC_MINOR__ >= 27))
+  while (length > 0)
+  {
+    loff_t source_offset = static_cast<loff_t>(offset);
+    const ssize_t bytes_copied = copy_file_range(source_fd, &source_offset, target_fd, NULL,
+                                                 static_cast<size_t>(length), 0);
+    if (bytes_copied < 0 && errno == EINTR)
+      continue;
+    if (bytes_copied <= 0)
+      break;
+    offset += bytes_copied;
+    length -= bytes_copied;
+  }
+#endif
+  while (length > 0)
+  {
+    off_t source_offset = static_cast<off_t>(offset);
+    const ssize_t bytes_copied = sendfile(target_fd, source_fd, &source_offset, static_cast<size_t>(length));
+    if (bytes_copied < 0 && errno == EINTR)
+      continue;
+    if (bytes_copied <= 0)
+      break;
+    offset += bytes_copied;
+    length -= bytes_copied;
+  }
+#endif
+  if (length <= 0)
+    return true;
+
+  // Fall back to a buffered copy
+  std::vector<char> buffer(static_cast<size_t>(std::min<long long>(length, STABILIZED_GCODE_COPY_BUFFER_SIZE)));
+  while (length > 0)
+  {
+    const long long chunk_size = std::min<long long>(length, static_cast<long long>(buffer.size()));
+    if (!read_at(source_fd, offset, &buffer[0], chunk_size) || !write_all(target_fd, &buffer[0], chunk_size))
+      return false;
+    offset += chunk_size;
+    length -= chunk_size;
+  }
+  return true;
+}
+
+/**
+ * \brief Finds the offset of the first byte of the line that ends at line_end (exclusive).
+ */
+static long long find_line_start(int fd, long long line_end)
+{
+  char buffer[STABILIZED_GCODE_LINE_SEARCH_SIZE];
+  // skip the line ending of the line itself
+  long long search_end = line_end;
+  while (search_end > 0)
+  {
+    char c;
+    if (!read_at(fd, search_end - 1, &c, 1))
+      return -1;
+    if (c != '\n' && c != '\r')
+      break;
+    search_end--;
+  }
+  while (search_end > 0)
+  {
+    const long long chunk_start = std::max<long long>(0, search_end - STABILIZED_GCODE_LINE_SEARCH_SIZE);
+    const long long chunk_size = search_end - chunk_start;
+    if (!read_at(fd, chunk_start, buffer, chunk_size))
+      return -1;
+    for (long long index = chunk_size - 1; index >= 0; index--)
+    {
+      if (buffer[index] == '\n' || buffer[index] == '\r')
+        return chunk_start + index + 1;
+    }
+    search_end = chunk_start;
+  }
+  return 0;
+}
+#pragma endregion Low level file functions
+
+stabilized_gcode_writer::stabilized_gcode_writer(const gcode_position_args& position_args,
+                                                 const stabilized_gcode_args& args)
+{
+  position_args_ = position_args;
+  args_ = args;
+  plans_written_ = 0;
+  bytes_written_ = 0;
+}
+
+stabilized_gcode_writer::~stabilized_gcode_writer()
+{
+}
+
+long long stabilized_gcode_writer::get_plans_written() const
+{
+  return plans_written_;
+}
+
+long long stabilized_gcode_writer::get_bytes_written() const
+{
+  return bytes_written_;
+}
+
+std::string stabilized_gcode_writer::get_snapshot_gcode_text(const snapshot_plan& plan,
+                                                             bool include_initialization_gcode) const
+{
+  const snapshot_gcode& gcode = plan.gcode;
+  std::string text;
+  if (include_initialization_gcode)
+  {
+    for (unsigned int index = 0; index < gcode.initialization_gcode.size(); index++)
+      text.append(gcode.initialization_gcode[index]).append("\n");
+  }
+  for (unsigned int index = 0; index < gcode.start_gcode.size(); index++)
+    text.append(gcode.start_gcode[index]).append("\n");
+
+  for (unsigned int index = 0; index < gcode.snapshot_commands.size(); index++)
+  {
+    const std::string& command = gcode.snapshot_commands[index];
+    // The snapshot command is always the octolapse command, see snapshot_gcode_generator::add_snapshot_action
+    if (command.compare(0, 10, "@OCTOLAPSE") == 0)
+    {
+      if (args_.wait_for_moves)
+        text.append("M400\n");
+      text.append(args_.snapshot_command.empty() ? command : args_.snapshot_command).append("\n");
+    }
+    else
+      text.append(command).append("\n");
+  }
+  for (unsigned int index = 0; index < gcode.return_commands.size(); index++)
+    text.append(gcode.return_commands[index]).append("\n");
+  for (unsigned int index = 0; index < gcode.end_gcode.size(); index++)
+    text.append(gcode.end_gcode[index]).append("\n");
+  return text;
+}
+
+bool stabilized_gcode_writer::write(const std::string& source_file_path, const std::vector<snapshot_plan>& plans)
+{
+  plans_written_ = 0;
+  bytes_written_ = 0;
+  std::stringstream stream;
+  stream << "Writing stabilized gcode to: " << args_.target_file_path;
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
+
+  gcode_file_reader source;
+  if (!source.open(source_file_path))
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "Unable to open the source gcode file while writing the stabilized gcode file.");
+    return false;
+  }
+  const int target_fd = open_target_file(args_.target_file_path);
+  if (target_fd < 0)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "Unable to open the target file while writing the stabilized gcode file.");
+    return false;
+  }
+
+  // The plans are created in file order, but make sure in case this ever changes.
+  std::vector<const snapshot_plan*> sorted_plans;
+  sorted_plans.reserve(plans.size());
+  for (unsigned int index = 0; index < plans.size(); index++)
+    sorted_plans.push_back(&plans[index]);
+  std::stable_sort(sorted_plans.begin(), sorted_plans.end(),
+                   [](const snapshot_plan* lhs, const snapshot_plan* rhs)
+                   {
+                     return lhs->file_position < rhs->file_position;
+                   });
+
+  bool success;
+  if (source.is_compressed())
+  {
+    success = write_lines(source, target_fd, sorted_plans);
+  }
+  else
+  {
+    source.close();
+    success = write_spans(source_file_path, target_fd, sorted_plans);
+  }
+  close_file(target_fd);
+
+  if (!success)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "An error occurred while writing the stabilized gcode file.");
+    return false;
+  }
+  stream.str("");
+  stream << "Stabilized gcode file written.  Snapshots: " << plans_written_ << ", Bytes: " << bytes_written_;
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, stream.str());
+
+  if (args_.verify)
+    return verify(source_file_path);
+  return true;
+}
+
+bool stabilized_gcode_writer::write_spans(const std::string& source_file_path, const int target_fd,
+                                          const std::vector<const snapshot_plan*>& sorted_plans)
+{
+  std::stringstream stream;
+  const int source_fd = open_source_file(source_file_path);
+  if (source_fd < 0)
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "Unable to open the source gcode file while writing the stabilized gcode file.");
+    return false;
+  }
+  const long long file_size = get_open_file_size(source_fd);
+  bool success = file_size >= 0;
+  long long copied_to = 0;
+  for (unsigned int index = 0; success && index < sorted_plans.size(); index++)
+  {
+    const snapshot_plan& plan = *sorted_plans[index];
+    if (plan.gcode.is_empty())
+    {
+      stream.str("");
+      stream << "Snapshot plan at line " << plan.file_line << " has no snapshot gcode, skipping.";
+      octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, stream.str());
+      continue;
+    }
+    // tellg returns -1 for the final line if it has no line ending.
+    long long line_end = plan.file_position < 0 ? file_size : plan.file_position;
+    if (line_end > file_size || line_end < copied_to)
+    {
+      stream.str("");
+      stream << "Snapshot plan at line " << plan.file_line << " has an invalid file position, skipping.";
+      octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, stream.str());
+      continue;
+    }
+    // The triggering command is suppressed while printing and sent again as the start command.  When that is all the
+    // initialization gcode does, keep the original line and insert the snapshot gcode after it, else replace it.
+    const bool keep_triggering_line =
+      !plan.start_command.is_empty && plan.start_command.gcode == plan.triggering_command.gcode &&
+      plan.gcode.initialization_gcode.size() == 1 &&
+      plan.gcode.initialization_gcode[0] == plan.start_command.gcode;
+
+    long long insert_at = line_end;
+    long long resume_at = line_end;
+    if (!keep_triggering_line)
+    {
+      insert_at = find_line_start(source_fd, line_end);
+      if (insert_at < copied_to)
+      {
+        octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING,
+                      "Unable to locate the triggering line for a snapshot plan, skipping.");
+        continue;
+      }
+    }
+    std::string text = get_snapshot_gcode_text(plan, !keep_triggering_line);
+
+    success = copy_span(source_fd, target_fd, copied_to, insert_at - copied_to);
+    bytes_written_ += insert_at - copied_to;
+    if (success && insert_at > 0)
+    {
+      // Make sure the inserted gcode starts on its own line, for example if the last line has no line ending
+      char c;
+      success = read_at(source_fd, insert_at - 1, &c, 1);
+      if (success && c != '\n' && c != '\r')
+        text.insert(0, "\n");
+    }
+    if (success)
+    {
+      success = write_all(target_fd, text.c_str(), static_cast<long long>(text.length()));
+      bytes_written_ += static_cast<long long>(text.length());
+    }
+    copied_to = resume_at;
+    plans_written_++;
+  }
+  if (success)
+  {
+    success = copy_span(source_fd, target_fd, copied_to, file_size - copied_to);
+    bytes_written_ += file_size - copied_to;
+  }
+  close_file(source_fd);
+  return success;
+}
+
+bool stabilized_gcode_writer::write_lines(gcode_file_reader& source, const int target_fd,
+                                          const std::vector<const snapshot_plan*>& sorted_plans)
+{
+  // The source can only be read forwards, so the file is written a line at a time.  A plan's file_position is the
+  // end of its triggering line.
+  std::stringstream stream;
+  std::string line;
+  std::string output;
+  bool success = true;
+  unsigned int plan_index = 0;
+  long long line_start = 0;
+  while (success && source.read_line(line))
+  {
+    const long long line_end = source.get_position();
+    const size_t output_start = output.length();
+    output.append(line);
+    if (line_end - line_start > static_cast<long long>(line.length()))
+      output.append("\n");
+    bool has_inserted_gcode = false;
+    for (; plan_index < sorted_plans.size() && sorted_plans[plan_index]->file_position <= line_end; plan_index++)
+    {
+      const snapshot_plan& plan = *sorted_plans[plan_index];
+      if (plan.gcode.is_empty())
+      {
+        stream.str("");
+        stream << "Snapshot plan at line " << plan.file_line << " has no snapshot gcode, skipping.";
+        octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, stream.str());
+        continue;
+      }
+      if (plan.file_position != line_end)
+      {
+        stream.str("");
+        stream << "Snapshot plan at line " << plan.file_line << " has an invalid file position, skipping.";
+        octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, stream.str());
+        continue;
+      }
+      // See write_spans
+      const bool keep_triggering_line =
+        !plan.start_command.is_empty && plan.start_command.gcode == plan.triggering_command.gcode &&
+        plan.gcode.initialization_gcode.size() == 1 &&
+        plan.gcode.initialization_gcode[0] == plan.start_command.gcode;
+      if (!keep_triggering_line)
+      {
+        if (has_inserted_gcode)
+        {
+          octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING,
+                        "Unable to locate the triggering line for a snapshot plan, skipping.");
+          continue;
+        }
+        output.resize(output_start);
+      }
+      else if (output.length() > 0 && output[output.length() - 1] != '\n' && output[output.length() - 1] != '\r')
+      {
+        output.append("\n");
+      }
+      output.append(get_snapshot_gcode_text(plan, !keep_triggering_line));
+      has_inserted_gcode = true;
+      plans_written_++;
+    }
+    if (output.length() >= STABILIZED_GCODE_COPY_BUFFER_SIZE)
+    {
+      success = write_all(target_fd, output.c_str(), static_cast<long long>(output.length()));
+      bytes_written_ += static_cast<long long>(output.length());
+      output.clear();
+    }
+    line_start = line_end;
+  }
+  if (success && !output.empty())
+  {
+    success = write_all(target_fd, output.c_str(), static_cast<long long>(output.length()));
+    bytes_written_ += static_cast<long long>(output.length());
+  }
+  for (; plan_index < sorted_plans.size(); plan_index++)
+  {
+    stream.str("");
+    stream << "Snapshot plan at line " << sorted_plans[plan_index]->file_line
+      << " has an invalid file position, skipping.";
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::WARNING, stream.str());
+  }
+  return success && !source.has_error();
+}
+
+bool stabilized_gcode_writer::get_final_position(const std::string& file_path, position& final_position,
+                                                 long long& snapshot_count) const
+{
+  snapshot_count = 0;
+  gcode_file_reader gcode_file;
+  if (!gcode_file.open(file_path))
+    return false;
+
+  gcode_parser parser;
+  gcode_position gcode_position(position_args_);
+  parsed_command snapshot_command;
+  parser.try_parse_gcode(
+    args_.snapshot_command.empty() ? "@OCTOLAPSE TAKE-SNAPSHOT" : args_.snapshot_command.c_str(), snapshot_command
+  );
+
+  std::string line;
+  parsed_command cmd;
+  long long lines_processed = 0;
+  long long gcodes_processed = 0;
+  while (gcode_file.read_line(line))
+  {
+    lines_processed++;
+    cmd.clear();
+    parser.try_parse_gcode(line.c_str(), cmd);
+    if (cmd.gcode.length() > 0)
+    {
+      gcodes_processed++;
+      if (cmd.gcode == snapshot_command.gcode)
+        snapshot_count++;
+    }
+    gcode_position.update(cmd, lines_processed, gcodes_processed, -1);
+  }
+  final_position = gcode_position.get_current_position();
+  return !gcode_file.has_error();
+}
+
+bool stabilized_gcode_writer::verify(const std::string& source_file_path) const
+{
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Verifying the stabilized gcode file.");
+  position source_position;
+  position target_position;
+  long long source_snapshot_count;
+  long long target_snapshot_count;
+  if (
+    !get_final_position(source_file_path, source_position, source_snapshot_count) ||
+    !get_final_position(args_.target_file_path, target_position, target_snapshot_count)
+  )
+  {
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR,
+                  "Unable to open the gcode files while verifying the stabilized gcode file.");
+    return false;
+  }
+
+  std::stringstream stream;
+  // Every inserted snapshot sequence must return the printer to the position it started from
+  if (target_snapshot_count - source_snapshot_count != plans_written_)
+  {
+    stream << "Stabilized gcode verification failed.  Expected " << plans_written_ << " snapshot commands, found " <<
+      (target_snapshot_count - source_snapshot_count) << ".";
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, stream.str());
+    return false;
+  }
+  if (
+    !utilities::is_equal(source_position.x, target_position.x) ||
+    !utilities::is_equal(source_position.y, target_position.y) ||
+    !utilities::is_equal(source_position.z, target_position.z) ||
+    !utilities::is_equal(source_position.get_current_extruder().get_offset_e(),
+                         target_position.get_current_extruder().get_offset_e()) ||
+    source_position.is_relative != target_position.is_relative ||
+    source_position.is_extruder_relative != target_position.is_extruder_relative
+  )
+  {
+    stream << "Stabilized gcode verification failed.  The final position of the stabilized file (X:" <<
+      target_position.x << " Y:" << target_position.y << " Z:" << target_position.z <<
+      ") does not match the source file (X:" << source_position.x << " Y:" << source_position.y << " Z:" <<
+      source_position.z << ").";
+    octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::ERROR, stream.str());
+    return false;
+  }
+  octolapse_log(octolapse_log::SNAPSHOT_PLAN, octolapse_log::INFO, "Stabilized gcode file verified.");
+  return true;
+}
@@ -0,0 +1,89 @@
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+// Copyright(C) 2019  Brad Hochgesang
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+// This program is free software : you can redistribute it and/or modify
+// it under the terms of the GNU Affero General Public License as published
+// by the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+//
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.See the
+// GNU Affero General Public License for more details.
+//
+// You should have received a copy of the GNU Affero General Public License
+// along with this program.If not, see the following :
+// https ://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+//
+// You can contact the author either through the git - hub repository, or at the
+// following email address : FormerLurker@pm.me
+////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
+#ifndef STABILIZED_GCODE_WRITER_H
+#define STABILIZED_GCODE_WRITER_H
+#include <string>
+#include <vector>
+#include "gcode_position.h"
+#include "snapshot_plan.h"
+#include "gcode_file_reader.h"
+
+struct stabilized_gcode_args
+{
+  stabilized_gcode_args()
+  {
+    target_file_path = "";
+    snapshot_command = "";
+    wait_for_moves = false;
+    verify = true;
+  }
+
+  /**
+   * \brief The path of the stabilized gcode file.  If empty, no file will be written.
+   */
+  std::string target_file_path;
+  /**
+   * \brief Replaces the @OCTOLAPSE TAKE-SNAPSHOT command (for example with M240).  If empty, it is not replaced.
+   */
+  std::string snapshot_command;
+  /**
+   * \brief If true, an M400 will be inserted before every snapshot command.
+   */
+  bool wait_for_moves;
+  /**
+   * \brief If true, the written file is run back through gcode_position and compared to the source.
+   */
+  bool verify;
+};
+
+/**
+ * \brief Writes a copy of a gcode file with the snapshot gcode of every snapshot plan inlined at the plan's
+ * file_position.  All other bytes are copied through unchanged, using copy_file_range or sendfile when available.
+ * A compressed source is written out decompressed.
+ */
+class stabilized_gcode_writer
+{
+public:
+  stabilized_gcode_writer(const gcode_position_args& position_args, const stabilized_gcode_args& args);
+  ~stabilized_gcode_writer();
+  /**
+   * \brief Writes the stabilized file.  Plans without snapshot gcode are skipped.
+   * \return false if the file could not be written or did not pass verification.
+   */
+  bool write(const std::string& source_file_path, const std::vector<snapshot_plan>& plans);
+  long long get_plans_written() const;
+  long long get_bytes_written() const;
+
+private:
+  stabilized_gcode_writer(const stabilized_gcode_writer& source); // don't copy me!
+  std::string get_snapshot_gcode_text(const snapshot_plan& plan, bool include_initialization_gcode) const;
+  bool write_spans(const std::string& source_file_path, int target_fd,
+                   const std::vector<const snapshot_plan*>& sorted_plans);
+  bool write_lines(gcode_file_reader& source, int target_fd, const std::vector<const snapshot_plan*>& sorted_plans);
+  bool verify(const std::string& source_file_path) const;
+  bool get_final_position(const std::string& file_path, position& final_position, long long& snapshot_count) const;
+  gcode_position_args position_args_;
+  stabilized_gcode_args args_;
+  long long plans_written_;
+  long long bytes_written_;
+};
+#endif
@@ -83,6 +83,9 @@ trigger_positions::trigger_positions()
   slowest_extrusion_speed_ = -1;
   stabilization_x_ = 0;
   stabilization_y_ = 0;
+  p_arc_start_pos_ = NULL;
+  p_arc_end_pos_ = NULL;
+  arc_fraction_ = 0;
 }
 
 trigger_positions::~trigger_positions()
@@ -413,14 +416,15 @@ void trigger_positions::try_add(position* p_current_pos, position* p_previous_po
   }
 
   // add any feature positions if a feature tag exists, and if we are in high quality or compatibility mode
-  if (
+  const bool add_features = (
     p_current_pos->feature_type_tag != feature_type::feature_type_unknown_feature &&
     (
       args_.type == trigger_type_high_quality ||
       args_.type == trigger_type_compatibility ||
       (args_.type == trigger_type_snap_to_print && type == position_type_extrusion && args_.snap_to_print_high_quality)
     )
-  )
+  );
+  if (add_features)
   {
     // only add features if we are extruding.
     if (p_current_pos->get_current_extruder().is_extruding)
@@ -465,6 +469,9 @@ void trigger_positions::try_add(position* p_current_pos, position* p_previous_po
   //std::cout << "Distance:" << distance << "\r\n";
   try_add_internal(p_current_pos, distance, type);
 
+  if (utilities::greater_than(args_.arc_chord_tolerance, 0))
+    try_add_arc_positions(p_current_pos, p_previous_pos, type, add_features);
+
   // If we are using snap to print, and the current position is = is_extruding_start
   if (args_.type == trigger_type_snap_to_print)
   {
@@ -481,6 +488,45 @@ void trigger_positions::try_add(position* p_current_pos, position* p_previous_po
   }
 }
 
+void trigger_positions::try_add_arc_positions(position* p_current_pos, position* p_previous_pos,
+                                              const position_type type, const bool add_features)
+{
+  if (!arc_.try_create(*p_previous_pos, *p_current_pos))
+    return;
+  const unsigned int segments = arc_.get_segment_count(args_.arc_chord_tolerance);
+  if (segments < 2)
+    return;
+
+  // The points inside the arc share the state of the arc's end position, except for their coordinates.
+  arc_pos_ = *p_current_pos;
+  const double start_e = p_previous_pos->get_extruder(p_current_pos->current_tool).e;
+  const double end_e = p_current_pos->get_current_extruder().e;
+  p_arc_start_pos_ = p_previous_pos;
+  p_arc_end_pos_ = p_current_pos;
+  for (unsigned int index = 1; index < segments; index++)
+  {
+    arc_fraction_ = static_cast<double>(index) / segments;
+    arc_.get_point(arc_fraction_, arc_pos_.x, arc_pos_.y, arc_pos_.z);
+    // Don't consider points below the highest extrusion point, just like any other position.
+    if (utilities::less_than(arc_pos_.z, arc_pos_.last_extrusion_height))
+      continue;
+    arc_pos_.get_current_extruder().e = start_e + (end_e - start_e) * arc_fraction_;
+    if (add_features && arc_pos_.get_current_extruder().is_extruding)
+      try_add_feature_position_internal(&arc_pos_);
+    try_add_internal(&arc_pos_, get_stabilization_distance(&arc_pos_), type);
+  }
+  p_arc_start_pos_ = NULL;
+  p_arc_end_pos_ = NULL;
+}
+
+void trigger_positions::set_arc_split(trigger_position& trigger_pos) const
+{
+  trigger_pos.is_arc_split = p_arc_start_pos_ != NULL;
+  if (trigger_pos.is_arc_split)
+    arc_.split(*p_arc_start_pos_, *p_arc_end_pos_, arc_fraction_, trigger_pos.arc_start_command,
+               trigger_pos.arc_end_command);
+}
+
 void trigger_positions::try_add_feature_position_internal(position* p_pos)
 {
   bool add_position = false;
@@ -524,6 +570,7 @@ void trigger_positions::add_feature_position_internal(position* p_pos, double di
   feature_position_list_[p_pos->feature_type_tag].distance = distance;
   feature_position_list_[p_pos->feature_type_tag].type_feature = type;
   feature_position_list_[p_pos->feature_type_tag].is_empty = false;
+  set_arc_split(feature_position_list_[p_pos->feature_type_tag]);
 }
 
 // Adds a position to the internal position list.
@@ -533,6 +580,7 @@ void trigger_positions::add_internal(position* p_pos, double distance, position_
   position_list_[type].distance = distance;
   position_list_[type].type_position = type;
   position_list_[type].is_empty = false;
+  set_arc_split(position_list_[type]);
 }
 
 void trigger_positions::try_add_extrusion_start_positions(position* p_extrusion_start_pos)
@@ -1,5 +1,6 @@
 #pragma once
 #include "position.h"
+#include "gcode_arc.h"
 #include "gcode_comment_processor.h"
 
 /**
@@ -66,6 +67,7 @@ struct trigger_position
     distance = -1;
     is_empty = true;
     type_feature = feature_type_unknown_feature;
+    is_arc_split = false;
   }
 
   trigger_position(position_type type_, double distance_, position pos_)
@@ -75,6 +77,7 @@ struct trigger_position
     pos = pos_;
     is_empty = false;
     type_feature = feature_type_unknown_feature;
+    is_arc_split = false;
   }
 
   trigger_position(feature_type feature_, double distance_, position pos_)
@@ -84,6 +87,7 @@ struct trigger_position
     pos = pos_;
     is_empty = false;
     type_feature = feature_;
+    is_arc_split = false;
   }
 
   static position_type get_type(position* p_pos);
@@ -92,6 +96,11 @@ struct trigger_position
   double distance;
   position pos;
   bool is_empty;
+  // True if the position was sampled from within an arc, in which case the triggering arc must be replaced by
+  // arc_start_command, which ends at the position, and arc_end_command, which completes the original arc.
+  bool is_arc_split;
+  parsed_command arc_start_command;
+  parsed_command arc_end_command;
 };
 
 struct trigger_position_args
@@ -104,6 +113,7 @@ public:
     snap_to_print_high_quality = false;
     x_stabilization_disabled = true;
     y_stabilization_disabled = true;
+    arc_chord_tolerance = 0;
   }
 
   trigger_type type;
@@ -111,6 +121,11 @@ public:
   bool snap_to_print_high_quality;
   bool x_stabilization_disabled;
   bool y_stabilization_disabled;
+  /**
+   * \brief If greater than 0, points along G2/G3 arcs are also considered, spaced so that the arc deviates from a
+   * straight line between them by no more than this distance.
+   */
+  double arc_chord_tolerance;
 };
 
 class trigger_positions
@@ -146,6 +161,8 @@ private:
   void try_add_internal(position* p_pos, double distance, position_type type);
   void try_add_extrusion_start_positions(position* p_extrusion_start_pos);
   void try_add_extrusion_start_position(position* p_extrusion_start_pos, position& saved_pos);
+  void try_add_arc_positions(position* p_current_pos, position* p_previous_pos, position_type type, bool add_features);
+  void set_arc_split(trigger_position& trigger_pos) const;
 
   trigger_position position_list_[trigger_position::num_position_types];
   trigger_position feature_position_list_[NUM_FEATURE_TYPES];
@@ -159,4 +176,10 @@ private:
   position previous_initial_pos_;
   position previous_retracted_pos_;
   position previous_primed_pos_;
+  // Arc sampling variables.  The arc start and end positions are only set while the points along an arc are added.
+  gcode_arc arc_;
+  position arc_pos_;
+  const position* p_arc_start_pos_;
+  const position* p_arc_end_pos_;
+  double arc_fraction_;
 };
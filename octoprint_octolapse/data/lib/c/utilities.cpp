@@ -4,6 +4,8 @@
 #include <iostream>
 #include <cctype>
 #include <cstring>
+#include <cstdio>
+#include <iomanip>
 
 
 #ifdef _MSC_VER
@@ -86,6 +88,20 @@ std::string utilities::to_string(double value)
   return os.str();
 }
 
+// Formats a double with a fixed number of decimals, like python's "{0:.3f}".format(value)
+std::string utilities::to_fixed_string(double value, int precision)
+{
+  char buffer[64];
+  int length = snprintf(buffer, sizeof(buffer), "%.*f", precision, value);
+  if (length < 0 || length >= static_cast<int>(sizeof(buffer)))
+  {
+    std::ostringstream os;
+    os << std::fixed << std::setprecision(precision) << value;
+    return os.str();
+  }
+  return std::string(buffer, length);
+}
+
 std::string utilities::ltrim(const std::string& s)
 {
   size_t start = s.find_first_not_of(WHITESPACE_);
@@ -184,4 +200,30 @@ bool utilities::is_in_caseless_trim(const std::string& lhs, const char** rhs)
   return false;
 }
 
+namespace
+{
+  struct crc32_table
+  {
+    crc32_table()
+    {
+      for (unsigned int index = 0; index < 256; index++)
+      {
+        unsigned int crc = index;
+        for (int bit = 0; bit < 8; bit++)
+          crc = (crc & 1) ? 0xEDB88320 ^ (crc >> 1) : crc >> 1;
+        values[index] = crc;
+      }
+    }
+    unsigned int values[256];
+  };
+}
 
+unsigned int utilities::update_crc32(unsigned int crc, const char* data, const long long length)
+{
+  static const crc32_table table;
+  crc = ~crc;
+  const unsigned char* bytes = reinterpret_cast<const unsigned char*>(data);
+  for (long long index = 0; index < length; index++)
+    crc = table.values[(crc ^ bytes[index]) & 0xFF] ^ (crc >> 8);
+  return ~crc;
+}
@@ -13,11 +13,16 @@ public:
   static bool is_zero(double x);
   static double get_cartesian_distance(double x1, double y1, double x2, double y2);
   static std::string to_string(double value);
+  static std::string to_fixed_string(double value, int precision);
   static std::string ltrim(const std::string& s);
   static std::string rtrim(const std::string& s);
   static std::string trim(const std::string& s);
   static std::istream& safe_get_line(std::istream& is, std::string& t);
   static bool is_in_caseless_trim(const std::string& lhs, const char** rhs);
+  /**
+   * \brief Adds length bytes to a CRC-32 (the zlib/gzip polynomial).  Start with a crc of 0.
+   */
+  static unsigned int update_crc32(unsigned int crc, const char* data, long long length);
 #ifdef _MSC_VER
   static std::wstring ToUtf16(std::string str);
   
@@ -91,6 +91,20 @@ _octolapse_errors = {
                 'is_fatal': True,
                 'description': "No snapshot commands were found.  Current Snapshot Commands: @OCTOLAPSE "
                                "TAKE-SNAPSHOT{snapshot_command_gcode} "
+            },
+            "7": {
+                'name': "Stabilized Gcode Not Written",
+                'help_link': "error_help_preprocessor_stabilized_gcode_not_written.md",
+                'cpp_name': "stabilization_processing_issue_type_stabilized_gcode_not_written",
+                'is_fatal': False,
+                'description': "The stabilized gcode file could not be written or did not pass verification."
+            },
+            "8": {
+                'name': "Gcode Not Read",
+                'help_link': "error_help_preprocessor_gcode_not_read.md",
+                'cpp_name': "stabilization_processing_issue_type_gcode_not_read",
+                'is_fatal': True,
+                'description': "The gcode file could not be read to the end.  It may be truncated or corrupt."
             }
         },
         'preprocessor_errors': {
@@ -305,7 +305,7 @@ class Pos(utility.JsonSerializable):
         target.has_received_home_command = cpp_pos[39] > 0
         # Todo:  figure out how to deal with these things which must be currently ignored
         target.is_in_position = cpp_pos[40] > 0
-        target.in_path_position = cpp_pos[41] > 0
+        target.in_path_position = {'intersection': [cpp_pos[61], cpp_pos[62]]} if cpp_pos[41] > 0 else False
         target.is_in_bounds = cpp_pos[42] > 0
         target.file_line_number = cpp_pos[56]
         target.gcode_number = cpp_pos[57]
@@ -628,8 +628,29 @@ class ParsedCommand(utility.JsonSerializable):
         return self.cmd == "@OCTOLAPSE" and len(self.parameters) == 1
 
 
+class FirmwareResponse(object):
+    # The response types returned by GcodeProcessor.parse_firmware_response, see firmware_response.h
+    IGNORED = 0
+    OK = 1
+    TEMPERATURE = 2
+    POSITION = 3
+    ERROR = 4
+    RESEND = 5
+    BUSY = 6
+
+    @staticmethod
+    def get_type_flags(*response_types):
+        flags = 0
+        for response_type in response_types:
+            flags |= 1 << response_type
+        return flags
+
+
 class GcodeProcessor(object):
     _key = "plugin_octolapse"
+    # FilterQueuedGcode verdict indicating that the line needs no further processing
+    QUEUE_FILTER_PASS_THROUGH = 0
+    _position_response_flags = FirmwareResponse.get_type_flags(FirmwareResponse.POSITION)
 
     @staticmethod
     def initialize_position_processor(position_args, key=_key):
@@ -691,6 +712,97 @@ class GcodeProcessor(object):
         Pos.copy_from_cpp_pos(cpp_pos, position)
         return position
 
+    @staticmethod
+    def initialize_snapshot_plan_cursor(snapshot_plans, key=_key):
+        plan_locations = [(plan.file_gcode_number, plan.file_position) for plan in snapshot_plans]
+        return GcodePositionProcessor.InitializeSnapshotPlanCursor(key, plan_locations)
+
+    @staticmethod
+    def check_snapshot_plan_cursor(file_gcode_number, key=_key):
+        # returns the index of the triggered snapshot plan, or -1
+        return GcodePositionProcessor.CheckSnapshotPlanCursor(key, file_gcode_number)
+
+    @staticmethod
+    def seek_snapshot_plan_cursor(file_position, key=_key):
+        # returns the index of the next snapshot plan, or -1
+        return GcodePositionProcessor.SeekSnapshotPlanCursor(key, file_position)
+
+    @staticmethod
+    def initialize_gcode_queue_filter(
+        snapshot_command, state_message_interval_seconds=1, update_position=False, location_detection_commands=None,
+        key=_key
+    ):
+        # if update_position is True, the filter updates the position and any snapshot trigger with the same key
+        filter_args = {
+            "snapshot_command": snapshot_command,
+            "state_message_interval_seconds": state_message_interval_seconds,
+            "update_position": update_position,
+            "location_detection_commands": [] if location_detection_commands is None else location_detection_commands
+        }
+        return GcodePositionProcessor.InitializeGcodeQueueFilter(key, filter_args)
+
+    @staticmethod
+    def filter_queued_gcode(gcode, tags, update_triggers=False, key=_key):
+        # returns QUEUE_FILTER_PASS_THROUGH if the line needs no further processing
+        return GcodePositionProcessor.FilterQueuedGcode(key, gcode, tags, update_triggers)
+
+    @staticmethod
+    def parse_firmware_response(line, response_type_flags=None):
+        # returns (response_type, has_ok, values), or None if the line is not one of the requested types.  The values
+        # are (x, y, z, e, extruder_e_tuple) for positions, (tool, tool_target, bed, bed_target) for temperatures, and
+        # the line number for resends.
+        if response_type_flags is None:
+            return GcodePositionProcessor.ParseFirmwareResponse(line)
+        return GcodePositionProcessor.ParseFirmwareResponse(line, response_type_flags)
+
+    @staticmethod
+    def parse_position_response(line):
+        # returns the same dict as Response.check_for_position_request, or False if the line is not a position report
+        if 'X:' not in line:
+            # Most lines are temperature reports and oks, which this rejects faster than a call into the extension
+            return False
+        response = GcodePositionProcessor.ParseFirmwareResponse(line, GcodeProcessor._position_response_flags)
+        if response is None:
+            return False
+        x, y, z, e, extruder_e = response[2]
+        return {'x': x, 'y': y, 'z': z, 'e': e}
+
+    @staticmethod
+    def initialize_snapshot_trigger(trigger_args, key=_key):
+        return GcodePositionProcessor.InitializeSnapshotTrigger(key, trigger_args)
+
+    @staticmethod
+    def get_snapshot_trigger_state(key=_key):
+        # returns the native trigger state tuple, see TriggerState.update_from_native
+        return GcodePositionProcessor.GetSnapshotTriggerState(key)
+
+    @staticmethod
+    def pause_snapshot_trigger(key=_key):
+        return GcodePositionProcessor.PauseSnapshotTrigger(key)
+
+    @staticmethod
+    def resume_snapshot_trigger(key=_key):
+        return GcodePositionProcessor.ResumeSnapshotTrigger(key)
+
+    @staticmethod
+    def set_stats_enabled(enabled):
+        # returns False if the statistics were compiled out of the extension
+        return GcodePositionProcessor.SetStatsEnabled(enabled)
+
+    @staticmethod
+    def get_stats():
+        # returns a dict of phase times, counters and call latency histograms, or None if compiled out
+        return GcodePositionProcessor.GetStats()
+
+    @staticmethod
+    def reset_stats():
+        return GcodePositionProcessor.ResetStats()
+
+    @staticmethod
+    def write_stats_trace(file_path):
+        # writes a chrome trace-event file, which can be opened with chrome://tracing
+        return GcodePositionProcessor.WriteStatsTrace(file_path)
+
 
 # class GcodeStabilizationProcessor(object):
 #
@@ -219,3 +219,13 @@ class LoggingConfigurator(object):
             else:
                 current_logger = self._root_logger.getChild(logger_name)
                 current_logger.setLevel(default_log_level)
+        self._refresh_native_log_levels()
+
+    @staticmethod
+    def _refresh_native_log_levels():
+        # The native extension caches the log levels of its loggers, so they must be refreshed after every change.
+        try:
+            import GcodePositionProcessor
+        except ImportError:
+            return
+        GcodePositionProcessor.RefreshLogLevels()
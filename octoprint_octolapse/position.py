@@ -61,16 +61,16 @@ class Position(utility.JsonSerializable):
         #     self._location_detection_commands.append("G162")
         self._gcode_generation_settings = printer_profile.get_current_state_detection_settings()
         cpp_position_args = printer_profile.get_position_args(overridable_printer_profile_settings)
+        cpp_position_args["position_restrictions"] = []
+        if trigger_profile is not None and trigger_profile.position_restrictions_enabled:
+            cpp_position_args["position_restrictions"] = [
+                restriction.to_position_restriction_args() for restriction in trigger_profile.position_restrictions
+            ]
 
         GcodeProcessor.initialize_position_processor(cpp_position_args)
 
         self._auto_detect_position = printer_profile.auto_detect_position
         self._priming_height = printer_profile.priming_height
-        self._position_restrictions = None if trigger_profile is None else trigger_profile.position_restrictions
-
-        self._has_restricted_position = False if trigger_profile is None else (
-            len(trigger_profile.position_restrictions) > 0 and trigger_profile.position_restrictions_enabled
-        )
 
         self._gcode_generation_settings = printer_profile.get_current_state_detection_settings()
         assert (isinstance(self._gcode_generation_settings, OctolapseGcodeSettings))
@@ -97,6 +97,18 @@ class Position(utility.JsonSerializable):
                 return True
         return False
 
+    def get_location_detection_commands(self):
+        if self._auto_detect_position:
+            return list(self._location_detection_commands)
+        return []
+
+    def sync(self):
+        # The gcode queue filter has already updated the native position, so copy it rather than updating it
+        # again.
+        self.undo_pos = self.previous_pos
+        self.previous_pos = GcodeProcessor.get_previous_position()
+        self.current_pos = GcodeProcessor.get_current_position()
+
     def undo_update(self):
         GcodeProcessor.undo()
         # set pos to the previous pos and pop the current position
@@ -128,38 +140,7 @@ class Position(utility.JsonSerializable):
         if file_line_number is not None:
             self.current_pos.file_line_number = file_line_number
 
-        previous = self.previous_pos
-        current = self.current_pos
-
-        # reset the position restriction in_path_position state since it only works
-        # for one gcode at a time.
-        current.in_path_position = False
-        if not self._has_restricted_position:
-            # If we don't have restricted positions, we are always in position!
-            current.is_in_position = True
-        elif current.has_xy_position_changed:
-            # calculate position restrictions
-            if (
-                current.x is None or
-                current.y is None or
-                previous.x is None or
-                previous.y is None
-            ):
-                current.is_in_position = False
-            else:
-                # If we're using restricted positions, calculate intersections and determine if we are in position
-                can_calculate_intersections = current.parsed_command.cmd in ["G0", "G1"]
-                _is_in_position, _intersections = self.calculate_path_intersections(
-                    self._position_restrictions,
-                    current.x,
-                    current.y,
-                    previous.x,
-                    previous.y,
-                    can_calculate_intersections
-                )
-                current.is_in_position = _is_in_position
-                if not _is_in_position:
-                    current.in_path_position = _intersections
+        # is_in_position and in_path_position are calculated natively, including any position restrictions
 
     #def process_g2_g3(self, cmd):
     #    parameters = self.current_pos.parsed_command.parameters
@@ -412,80 +393,6 @@ class Position(utility.JsonSerializable):
     #     self._logger.log_position_command_received(
     #         "Received G162 - ".format(" ".join(home_strings)))
 
-    def calculate_path_intersections(self, restrictions, x, y, previous_x, previous_y, can_calculate_intersections):
-
-        if self.calculate_is_in_position(
-            restrictions,
-            x,
-            y,
-            utility.FLOAT_MATH_EQUALITY_RANGE
-        ):
-            return True, None
-
-        if previous_x is None or previous_y is None:
-            return False, False
-
-        if not can_calculate_intersections:
-            return False, None
-
-        return False, self.calculate_in_position_intersection(
-            restrictions,
-            x,
-            y,
-            previous_x,
-            previous_y,
-            utility.FLOAT_MATH_EQUALITY_RANGE
-        )
-
-    @staticmethod
-    def calculate_in_position_intersection(restrictions, x, y, previous_x, previous_y, tolerance):
-        intersections = []
-        for restriction in restrictions:
-            cur_intersections = restriction.get_intersections(x, y, previous_x, previous_y)
-            if cur_intersections:
-                for cur_intersection in cur_intersections:
-                    intersections.append(cur_intersection)
-
-        if len(intersections) == 0:
-            return False
-
-        for intersection in intersections:
-            if Position.calculate_is_in_position(restrictions, intersection[0], intersection[1], tolerance):
-                return {
-                    'intersection': intersection
-                }
-        return False
-
-    @staticmethod
-    def calculate_is_in_position(restrictions, x, y, tolerance):
-        # we need to know if there is at least one required position
-        has_required_position = False
-        # isInPosition will be used to determine if we return
-        # true where we have at least one required type
-        in_position = False
-
-        # loop through each restriction
-        for restriction in restrictions:
-            if restriction.Type == "required":
-                # we have at least on required position, so at least one point must be in
-                # position for us to return true
-                has_required_position = True
-            if restriction.is_in_position(x, y, tolerance):
-                if restriction.Type == "forbidden":
-                    # if we're in a forbidden position, return false now
-                    return False
-                else:
-                    # we're in position in at least one required position restriction
-                    in_position = True
-
-        if has_required_position:
-            # if at least one position restriction is required
-            return in_position
-
-        # if we're here then we only have forbidden restrictions, but the point
-        # was not within the restricted area(s)
-        return True
-
     @staticmethod
     def _extruder_state_triggered(option, state):
         if option is None:
@@ -0,0 +1,532 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+##################################################################################
+# A preprocessing service shared by every OctoPrint instance on this computer.  Print farms often run one OctoPrint
+# instance per printer and print the same file on each of them.  The service listens on a unix socket, runs the
+# native snapshot plan preprocessors on a pool of worker threads, merges identical requests (same file contents and
+# same arguments) into one job, and keeps a plan cache that all instances share.  Jobs are taken from the clients
+# in turn so that one instance can't starve the others.
+#
+# Start it with:  python -m octoprint_octolapse.preprocessing_service [--socket-path PATH] [--cache-directory DIR]
+#
+# Nothing is sent over the network.  When the service is not running the extension preprocesses in-process.
+from __future__ import unicode_literals
+import argparse
+import collections
+import hashlib
+import json
+import logging
+import os
+import socket
+import threading
+import socketserver
+import GcodePositionProcessor
+from octoprint_octolapse.settings import StabilizationPath
+from octoprint_octolapse.stabilization_gcode import SnapshotPositionGenerator
+import octoprint_octolapse.utility as utility
+# create the module level logger
+from octoprint_octolapse.log import LoggingConfigurator
+logging_configurator = LoggingConfigurator()
+logger = logging_configurator.get_logger(__name__)
+
+TRIGGER_TYPE_SMART_LAYER = "smart_layer"
+TRIGGER_TYPE_SMART_GCODE = "smart_gcode"
+
+MESSAGE_TYPE_PROGRESS = "progress"
+MESSAGE_TYPE_RESULT = "result"
+MESSAGE_TYPE_ERROR = "error"
+
+# Only these stabilization args are sent to the service.  The callbacks are created by the service.
+_stabilization_arg_names = [
+    "file_path",
+    "height_increment",
+    "notification_period_seconds",
+    "snapshot_gcode_args",
+    "x_stabilization_disabled",
+    "y_stabilization_disabled",
+]
+# These stabilization args do not change the snapshot plans, so they are not part of the request key.
+_unkeyed_stabilization_arg_names = ["file_path", "notification_period_seconds"]
+
+# The results returned when the client cancels, in the same shape as the native preprocessors return.
+_cancelled_results = ([], 0, 0, 0, 0, [], [])
+
+
+def _get_snapshot_plans_function(trigger_type):
+    if trigger_type == TRIGGER_TYPE_SMART_LAYER:
+        return GcodePositionProcessor.GetSnapshotPlans_SmartLayer
+    elif trigger_type == TRIGGER_TYPE_SMART_GCODE:
+        return GcodePositionProcessor.GetSnapshotPlans_SmartGcode
+    raise ValueError("Unknown preprocessing trigger type: {0}".format(trigger_type))
+
+
+def create_request(client_id, trigger_type, position_args, stabilization_args, trigger_args, stabilization_paths):
+    return {
+        "client_id": client_id,
+        "trigger_type": trigger_type,
+        "position_args": position_args,
+        "stabilization_args": dict(
+            (name, stabilization_args[name]) for name in _stabilization_arg_names if name in stabilization_args
+        ),
+        "trigger_args": trigger_args,
+        "stabilization_paths": dict((axis, path.to_dict()) for axis, path in stabilization_paths.items()),
+    }
+
+
+def _encode_message(message):
+    return (json.dumps(message) + "\n").encode("utf-8")
+
+
+class PlanCache(object):
+    # Keeps the most recent results in memory and, if a directory is supplied, on disk so that they survive a
+    # restart of the service.
+    def __init__(self, cache_directory=None, max_entries=64):
+        self._cache_directory = cache_directory
+        self._max_entries = max_entries
+        self._entries = collections.OrderedDict()
+        if self._cache_directory is not None and not os.path.isdir(self._cache_directory):
+            os.makedirs(self._cache_directory)
+
+    def _get_path(self, key):
+        return os.path.join(self._cache_directory, "{0}.json".format(key))
+
+    def get(self, key):
+        results = self._entries.get(key)
+        if results is not None:
+            self._entries.move_to_end(key)
+            return results
+        if self._cache_directory is None:
+            return None
+        path = self._get_path(key)
+        try:
+            with open(path, "r") as cache_file:
+                results = json.load(cache_file)
+        except (IOError, OSError, ValueError):
+            return None
+        # touch the file so that it is pruned last
+        os.utime(path, None)
+        self._add_to_memory(key, results)
+        return results
+
+    def put(self, key, results):
+        self._add_to_memory(key, results)
+        if self._cache_directory is None:
+            return
+        path = self._get_path(key)
+        temporary_path = path + ".tmp"
+        try:
+            with open(temporary_path, "w") as cache_file:
+                json.dump(results, cache_file)
+            os.replace(temporary_path, path)
+        except (IOError, OSError):
+            logger.exception("Unable to write the snapshot plans to the plan cache at %s.", path)
+            return
+        self._prune_directory()
+
+    def _add_to_memory(self, key, results):
+        self._entries[key] = results
+        self._entries.move_to_end(key)
+        while len(self._entries) > self._max_entries:
+            self._entries.popitem(last=False)
+
+    def _prune_directory(self):
+        paths = [
+            os.path.join(self._cache_directory, name) for name in os.listdir(self._cache_directory)
+            if name.endswith(".json")
+        ]
+        if len(paths) <= self._max_entries:
+            return
+        paths.sort(key=os.path.getmtime)
+        for path in paths[:len(paths) - self._max_entries]:
+            try:
+                os.remove(path)
+            except OSError:
+                pass
+
+
+class _Subscriber(object):
+    # A client connection waiting for the results of a job
+    def __init__(self, connection):
+        self._connection = connection
+        self._lock = threading.Lock()
+        self.is_connected = True
+
+    def send(self, message):
+        with self._lock:
+            if not self.is_connected:
+                return False
+            try:
+                self._connection.sendall(_encode_message(message))
+            except (socket.error, OSError):
+                self.is_connected = False
+        return self.is_connected
+
+
+class _PreprocessingJob(object):
+    def __init__(self, key, request):
+        self.key = key
+        self.client_id = request["client_id"]
+        self.request = request
+        self.subscribers = []
+        self.is_running = False
+        self.is_complete = False
+        self.is_cancelled = False
+
+
+class _PreprocessingRequestHandler(socketserver.StreamRequestHandler):
+    def handle(self):
+        service = self.server.service
+        line = self.rfile.readline()
+        if not line:
+            return
+        subscriber = _Subscriber(self.connection)
+        try:
+            request = json.loads(line.decode("utf-8"))
+            job = service.submit(request, subscriber)
+        except Exception as e:
+            logger.exception("Unable to start the requested preprocessing job.")
+            subscriber.send({"type": MESSAGE_TYPE_ERROR, "message": "{0}".format(e)})
+            return
+        if job is None:
+            # the results came from the cache
+            return
+        # The client sends nothing else.  It closes the connection once it has the results, or earlier to cancel.
+        try:
+            self.rfile.readline()
+        except (socket.error, OSError):
+            pass
+        service.unsubscribe(job, subscriber)
+
+
+class _PreprocessingServer(socketserver.ThreadingMixIn, socketserver.UnixStreamServer):
+    daemon_threads = True
+
+
+class PreprocessingService(object):
+    def __init__(self, socket_path, cache_directory=None, max_jobs=None, max_cache_entries=64):
+        self.socket_path = socket_path
+        self.max_jobs = max_jobs if max_jobs else max(os.cpu_count() or 1, 1)
+        self._cache = PlanCache(cache_directory, max_cache_entries)
+        self._condition = threading.Condition()
+        # in progress jobs by request key
+        self._jobs = {}
+        # waiting jobs for each client, in the order the clients will be served
+        self._client_queues = collections.OrderedDict()
+        # file hashes by (path, size, modified time)
+        self._file_hashes = {}
+        self._file_hash_lock = threading.Lock()
+        self._is_stopping = False
+        self._server = None
+        self._worker_threads = []
+
+    def start(self):
+        if os.path.exists(self.socket_path):
+            # Remove the socket left behind by a previous service, but don't steal one that is still in use.
+            probe = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+            try:
+                probe.connect(self.socket_path)
+                raise RuntimeError("A preprocessing service is already listening at {0}".format(self.socket_path))
+            except (socket.error, OSError):
+                os.remove(self.socket_path)
+            finally:
+                probe.close()
+        self._server = _PreprocessingServer(self.socket_path, _PreprocessingRequestHandler)
+        self._server.service = self
+        for index in range(self.max_jobs):
+            worker_thread = threading.Thread(target=self._run_jobs, name="preprocessing_worker_{0}".format(index))
+            worker_thread.daemon = True
+            worker_thread.start()
+            self._worker_threads.append(worker_thread)
+        logger.info(
+            "The preprocessing service is listening at %s with %d workers.", self.socket_path, self.max_jobs
+        )
+
+    def serve_forever(self):
+        self._server.serve_forever()
+
+    def stop(self):
+        with self._condition:
+            self._is_stopping = True
+            for job in self._jobs.values():
+                job.is_cancelled = True
+            self._condition.notify_all()
+        if self._server is not None:
+            self._server.shutdown()
+            self._server.server_close()
+            if os.path.exists(self.socket_path):
+                os.remove(self.socket_path)
+        for worker_thread in self._worker_threads:
+            worker_thread.join()
+
+    def get_file_hash(self, file_path):
+        file_stat = os.stat(file_path)
+        file_id = (file_path, file_stat.st_size, file_stat.st_mtime_ns)
+        with self._file_hash_lock:
+            file_hash = self._file_hashes.get(file_id)
+        if file_hash is not None:
+            return file_hash
+        sha256 = hashlib.sha256()
+        with open(file_path, "rb") as gcode_file:
+            for chunk in iter(lambda: gcode_file.read(1024 * 1024), b""):
+                sha256.update(chunk)
+        file_hash = sha256.hexdigest()
+        with self._file_hash_lock:
+            self._file_hashes[file_id] = file_hash
+        return file_hash
+
+    def get_request_key(self, request):
+        stabilization_args = dict(
+            (name, value) for name, value in request["stabilization_args"].items()
+            if name not in _unkeyed_stabilization_arg_names
+        )
+        key_source = json.dumps(
+            [
+                self.get_file_hash(request["stabilization_args"]["file_path"]),
+                request["trigger_type"],
+                request["position_args"],
+                stabilization_args,
+                request["trigger_args"],
+                request["stabilization_paths"],
+            ],
+            sort_keys=True
+        )
+        return hashlib.sha256(key_source.encode("utf-8")).hexdigest()
+
+    def submit(self, request, subscriber):
+        # Returns the job the subscriber is waiting on, or None if the results were sent from the cache.
+        _get_snapshot_plans_function(request["trigger_type"])
+        key = self.get_request_key(request)
+        with self._condition:
+            job = self._jobs.get(key)
+            if job is not None and job.is_cancelled:
+                # The job stops at its next progress callback, and its partial results must not be sent to anyone.
+                # Start over with a new job, which replaces it in _jobs.
+                job = None
+            if job is None:
+                results = self._cache.get(key)
+                if results is not None:
+                    logger.info("Sending cached snapshot plans to client %s.", request["client_id"])
+                    subscriber.send({"type": MESSAGE_TYPE_RESULT, "results": results})
+                    return None
+                job = _PreprocessingJob(key, request)
+                self._jobs[key] = job
+                self._client_queues.setdefault(job.client_id, collections.deque()).append(job)
+                self._condition.notify()
+                logger.info("Queued a preprocessing job for client %s.", job.client_id)
+            else:
+                logger.info(
+                    "Client %s is sharing the preprocessing job started by client %s.",
+                    request["client_id"], job.client_id
+                )
+            job.subscribers.append(subscriber)
+            return job
+
+    def unsubscribe(self, job, subscriber):
+        with self._condition:
+            if subscriber in job.subscribers:
+                job.subscribers.remove(subscriber)
+            if job.subscribers or job.is_complete:
+                return
+            # nobody is waiting for this job any longer
+            job.is_cancelled = True
+            if not job.is_running:
+                self._remove_job(job)
+                queue = self._client_queues.get(job.client_id)
+                if queue is not None and job in queue:
+                    queue.remove(job)
+                    if not queue:
+                        del self._client_queues[job.client_id]
+            logger.info("Cancelled the preprocessing job for client %s.", job.client_id)
+
+    def _remove_job(self, job):
+        if self._jobs.get(job.key) is job:
+            del self._jobs[job.key]
+
+    def _get_next_job(self):
+        # Take the oldest job from the first client, then move that client to the back of the line.
+        with self._condition:
+            while not self._client_queues and not self._is_stopping:
+                self._condition.wait()
+            if self._is_stopping:
+                return None
+            client_id, queue = next(iter(self._client_queues.items()))
+            job = queue.popleft()
+            if queue:
+                self._client_queues.move_to_end(client_id)
+            else:
+                del self._client_queues[client_id]
+            job.is_running = True
+            return job
+
+    def _run_jobs(self):
+        while True:
+            job = self._get_next_job()
+            if job is None:
+                return
+            try:
+                results = self._run_job(job)
+                if job.is_cancelled:
+                    message = {"type": MESSAGE_TYPE_ERROR, "message": "The preprocessing job was cancelled."}
+                else:
+                    message = {"type": MESSAGE_TYPE_RESULT, "results": results}
+            except Exception as e:
+                logger.exception("The preprocessing job for client %s failed.", job.client_id)
+                results = None
+                message = {"type": MESSAGE_TYPE_ERROR, "message": "{0}".format(e)}
+            with self._condition:
+                if results is not None and not job.is_cancelled:
+                    self._cache.put(job.key, results)
+                job.is_complete = True
+                self._remove_job(job)
+                subscribers = list(job.subscribers)
+            for subscriber in subscribers:
+                subscriber.send(message)
+
+    def _run_job(self, job):
+        request = job.request
+        position_args = request["position_args"]
+        stabilization_paths = dict(
+            (axis, StabilizationPath.create_from(path)) for axis, path in request["stabilization_paths"].items()
+        )
+        position_generator = SnapshotPositionGenerator(stabilization_paths, position_args)
+
+        def on_progress_received(*progress):
+            with self._condition:
+                subscribers = list(job.subscribers)
+            for subscriber in subscribers:
+                subscriber.send({"type": MESSAGE_TYPE_PROGRESS, "progress": progress})
+            return not job.is_cancelled
+
+        stabilization_args = dict(request["stabilization_args"])
+        stabilization_args["gcode_generator"] = position_generator
+        stabilization_args["on_progress_received"] = on_progress_received
+        logger.info(
+            "Preprocessing %s for client %s.", stabilization_args["file_path"], job.client_id
+        )
+        get_snapshot_plans = _get_snapshot_plans_function(request["trigger_type"])
+        # round trip through json so that cached and new results look the same to the client
+        return json.loads(json.dumps(
+            list(get_snapshot_plans(position_args, stabilization_args, request["trigger_args"]))
+        ))
+
+
+class PreprocessingServiceClient(object):
+    def __init__(self, socket_path, client_id=None, connect_timeout_seconds=1.0):
+        self.socket_path = socket_path
+        self.client_id = client_id if client_id is not None else "{0}".format(os.getpid())
+        self.connect_timeout_seconds = connect_timeout_seconds
+
+    def is_available(self):
+        return hasattr(socket, "AF_UNIX") and os.path.exists(self.socket_path)
+
+    def get_snapshot_plans(
+        self, trigger_type, position_args, stabilization_args, trigger_args, stabilization_paths
+    ):
+        # Returns the same tuple as the native GetSnapshotPlans functions, or None if the service could not be
+        # used.  Progress is reported through stabilization_args["on_progress_received"], exactly like the native
+        # functions, and returning False from it cancels the request.
+        if not self.is_available():
+            return None
+        on_progress_received = stabilization_args["on_progress_received"]
+        try:
+            request_message = _encode_message(create_request(
+                self.client_id, trigger_type, position_args, stabilization_args, trigger_args, stabilization_paths
+            ))
+        except (TypeError, ValueError):
+            logger.exception("Unable to create the preprocessing service request.")
+            return None
+
+        notification_period_seconds = stabilization_args.get("notification_period_seconds", 1) or 1
+        connection = socket.socket(socket.AF_UNIX, socket.SOCK_STREAM)
+        try:
+            connection.settimeout(self.connect_timeout_seconds)
+            connection.connect(self.socket_path)
+            connection.sendall(request_message)
+            logger.info("Sent the preprocessing request to the preprocessing service at %s.", self.socket_path)
+            # Wake up at least once per notification period so that cancellation is noticed while the job waits
+            # in the service's queue.
+            connection.settimeout(notification_period_seconds)
+            last_progress = [0.0, 0.0, 0.0, 0, 0]
+            buffer = b""
+            while True:
+                try:
+                    data = connection.recv(65536)
+                except socket.timeout:
+                    if not on_progress_received(*last_progress):
+                        return _cancelled_results
+                    continue
+                if not data:
+                    logger.error("The preprocessing service closed the connection before returning any results.")
+                    return None
+                buffer += data
+                while b"\n" in buffer:
+                    line, buffer = buffer.split(b"\n", 1)
+                    message = json.loads(line.decode("utf-8"))
+                    message_type = message["type"]
+                    if message_type == MESSAGE_TYPE_PROGRESS:
+                        last_progress = message["progress"]
+                        if not on_progress_received(*last_progress):
+                            return _cancelled_results
+                    elif message_type == MESSAGE_TYPE_RESULT:
+                        return tuple(message["results"])
+                    else:
+                        logger.error("The preprocessing service returned an error: %s", message.get("message"))
+                        return None
+        except (socket.error, OSError, ValueError, KeyError):
+            logger.exception("Unable to use the preprocessing service at %s.", self.socket_path)
+            return None
+        finally:
+            connection.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(
+        description="Shares Octolapse snapshot plan preprocessing between the OctoPrint instances on this computer."
+    )
+    parser.add_argument(
+        "--socket-path", default=utility.get_default_preprocessing_service_socket_path(),
+        help="The unix socket to listen on."
+    )
+    parser.add_argument(
+        "--cache-directory", default=None,
+        help="Keep the plan cache in this directory so that it survives a restart.  By default it is memory only."
+    )
+    parser.add_argument(
+        "--max-cache-entries", type=int, default=64, help="The number of snapshot plan results to keep."
+    )
+    parser.add_argument(
+        "--jobs", type=int, default=0, help="The number of files to preprocess at once.  0 uses every core."
+    )
+    args = parser.parse_args()
+    logging.basicConfig(level=logging.INFO, format="%(asctime)s - %(name)s - %(levelname)s - %(message)s")
+    service = PreprocessingService(args.socket_path, args.cache_directory, args.jobs, args.max_cache_entries)
+    service.start()
+    try:
+        service.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        service.stop()
+
+
+if __name__ == "__main__":
+    main()
@@ -35,12 +35,15 @@ import time
 import json
 import copy
 import zipfile as zipfile
-from csv import DictReader
+from csv import DictReader, DictWriter
 # sarge was added to the additional requirements for the plugin
 import datetime
 from tempfile import mkdtemp
 import uuid
 from PIL import Image, ImageDraw, ImageFont
+import subprocess
+import psutil
+import GcodePositionProcessor
 
 import octoprint_octolapse.utility as utility
 import octoprint_octolapse.script as script
@@ -354,7 +357,8 @@ class RenderJobInfo(object):
         ffmpeg_directory,
         current_camera_info,
         job_number=0,
-        jobs_remaining=0
+        jobs_remaining=0,
+        thread_count=None
     ):
         self.ffmpeg_directory = ffmpeg_directory
         self.timelapse_job_info = timelapse_job_info
@@ -398,6 +402,8 @@ class RenderJobInfo(object):
         self.snapshot_archive_filename = utility.get_snapshot_archive_filename(self.rendering_filename)
         self.snapshot_archive_path = os.path.join(self.snapshot_archive_directory, self.snapshot_archive_filename)
         self.rendering = rendering_profile
+        # the number of threads assigned to this job by the rendering processor
+        self.thread_count = thread_count if thread_count else rendering_profile.thread_count
         self.archive_snapshots = self.rendering.archive_snapshots or not self.rendering.enabled
         # store any rendering errors
         self.rendering_error = None
@@ -542,6 +548,14 @@ class RenderJobInfo(object):
         output_tokens = RenderJobInfo.get_output_tokens_from_metadata(metadata)
         return RenderJobInfo.get_rendering_name_from_metadata(metadata["output_template"], output_tokens)
 
+def get_rendering_process_priority(is_low_priority):
+    """Returns the psutil priority for a rendering process."""
+    if sys.platform == "win32":
+        return psutil.BELOW_NORMAL_PRIORITY_CLASS if is_low_priority else psutil.NORMAL_PRIORITY_CLASS
+    niceness = psutil.Process().nice()
+    return min(niceness + 10, 19) if is_low_priority else niceness
+
+
 class RenderingProcessor(threading.Thread):
     """Watch for rendering jobs via a rendering queue.  Extract jobs from the queue, and spawn a rendering thread,
        one at a time for each rendering job.  Notify the calling thread of the number of jobs in the queue on demand."""
@@ -549,7 +563,8 @@ class RenderingProcessor(threading.Thread):
     def __init__(
         self, rendering_task_queue, data_directory, plugin_version, git_version, default_settings_folder,
         octoprint_settings, get_current_settings_callback, on_start, on_success, on_render_progress, on_error, on_end,
-        on_unfinished_renderings_changed, on_in_process_renderings_changed, on_unfinished_renderings_loaded
+        on_unfinished_renderings_changed, on_in_process_renderings_changed, on_unfinished_renderings_loaded,
+        is_printing_callback=None
     ):
         super(RenderingProcessor, self).__init__()
         self._plugin_version = plugin_version
@@ -574,11 +589,13 @@ class RenderingProcessor(threading.Thread):
         self._on_unfinished_renderings_changed_callback = on_unfinished_renderings_changed
         self._on_in_process_renderings_changed_callback = on_in_process_renderings_changed
         self._on_unfinished_renderings_loaded_callback = on_unfinished_renderings_loaded
+        self._is_printing_callback = is_printing_callback
         self.job_count = 0
-        self._is_processing = False
         self._idle_sleep_seconds = 5  # wait at most 5 seconds for a rendering job from the queue
-        self._rendering_job_thread = None
-        self._current_rendering_job = None
+        self._running_sleep_seconds = 1  # check running jobs every second
+        # a private dict of running rendering jobs by (job_guid, camera_guid).  Each job holds its thread, its in
+        # process rendering, the cores and memory it was assigned, and its progress state.
+        self._running_jobs = {}
         # a private dict of rendering jobs by print job ID and camera ID
         self._pending_rendering_jobs = {}
         # private vars to hold unfinished and in-process rendering state
@@ -588,7 +605,6 @@ class RenderingProcessor(threading.Thread):
         self._renderings_in_process_size = 0
         self._has_working_directories = False
         self.update_directories()
-        self._last_progress_time_update = 0
 
     def is_processing(self):
         with self.r_lock:
@@ -900,17 +916,13 @@ class RenderingProcessor(threading.Thread):
 
     def _get_renderings_in_process(self):
         pending_jobs = {}
-        current_rendering_job_guid = self._current_rendering_job.get("job_guid", None)
-        current_rendering_camera_guid = self._current_rendering_job.get("camera_id", None)
         with self.r_lock:
             for job_guid in self._pending_rendering_jobs:
                 jobs = {}
                 for camera_guid in self._pending_rendering_jobs[job_guid]:
-                    progress = ""
-                    if job_guid == current_rendering_job_guid and camera_guid == current_rendering_camera_guid:
-                        progress = self._current_rendering_progress
+                    rendering = self._get_in_process_rendering_job(job_guid, camera_guid)
                     jobs[camera_guid] = {
-                        "progress": progress
+                        "progress": rendering["progress"] if rendering else ""
                     }
                 pending_jobs[job_guid] = jobs
         return pending_jobs
@@ -1226,9 +1238,9 @@ class RenderingProcessor(threading.Thread):
         with self.r_lock:
             return len(self._pending_rendering_jobs) > 0
 
-    def _is_thread_running(self):
+    def _is_job_running(self, job_guid, camera_guid):
         with self.r_lock:
-            return self._rendering_job_thread and self._rendering_job_thread.is_alive()
+            return (job_guid, camera_guid) in self._running_jobs
 
     def run(self):
         # initialize
@@ -1240,8 +1252,11 @@ class RenderingProcessor(threading.Thread):
         # loop forever, always watching for new tasks to appear in the queue
         while True:
             try:
-                # see if there are any rendering tasks.
-                rendering_task_info = self.rendering_task_queue.get(True, self._idle_sleep_seconds)
+                # see if there are any rendering tasks.  Don't wait as long while rendering so that finished
+                # jobs are handled promptly.
+                with self.r_lock:
+                    sleep_seconds = self._running_sleep_seconds if self._running_jobs else self._idle_sleep_seconds
+                rendering_task_info = self.rendering_task_queue.get(True, sleep_seconds)
                 if rendering_task_info:
 
                     action = rendering_task_info["action"]
@@ -1278,62 +1293,140 @@ class RenderingProcessor(threading.Thread):
                 logger.exception("An unexpected exception occurred while fetching the next item in the rendering task queue.")
 
             try:
-                # see if we've finished a task, if so, handle it.
-                if not self._is_thread_running() and self._is_processing:
-                    with self.r_lock:
-                        # join the thread and retrieve the finished job
-                        finished_job = self._rendering_job_thread.join()
-                        # we are done with the thread.
-                        self._rendering_job_thread = None
-                        # we don't consider a job to be failed for insufficient images.
-                        # failed jobs get added to the unfinished renderings list.
-                        failed = (
-                            finished_job.rendering_error is not None and not
-                        (
-                            isinstance(finished_job.rendering_error, RenderError)
-                            and finished_job.rendering_error.type == "insufficient-images"
-                        )
-                        )
-                        # remove the job from the _pending_rendering_jobs dict
-                        self._remove_pending_job(
-                            finished_job.job_guid,
-                            finished_job.camera_guid,
-                            failed=failed)
-                        # set our is_processing flag
-                        self._is_processing = False
-                        self._on_render_end(finished_job.temporary_directory, finished_job.camera_guid)
-                        # see if there are any other jobs remaining
-                    if not self._has_pending_jobs():
-                        # no more jobs, signal rendering completion
-                        self._on_all_renderings_ended(finished_job.temporary_directory)
-
-                with self.r_lock:
-                    if not self._has_pending_jobs() or self._is_processing:
-                        continue
+                # handle any finished jobs, then start as many jobs as the budget allows
+                self._end_finished_jobs()
+                self._update_job_priorities()
+                self._start_waiting_jobs()
+            except Exception as e:
+                logger.exception("An unexpected exception occurred while processing a queue item.")
 
-                # see if there are any jobs to process.  If there are, process them
+    def _end_finished_jobs(self):
+        with self.r_lock:
+            finished_jobs = [
+                running_job for running_job in self._running_jobs.values() if not running_job["thread"].is_alive()
+            ]
+            if not finished_jobs:
+                return
+            for running_job in finished_jobs:
+                # join the thread and retrieve the finished job
+                finished_job = running_job["thread"].join()
+                # we are done with the thread.
+                self._running_jobs.pop((finished_job.job_guid, finished_job.camera_guid), None)
+                # we don't consider a job to be failed for insufficient images.
+                # failed jobs get added to the unfinished renderings list.
+                failed = (
+                    finished_job.rendering_error is not None and not
+                    (
+                        isinstance(finished_job.rendering_error, RenderError)
+                        and finished_job.rendering_error.type == "insufficient-images"
+                    )
+                )
+                # remove the job from the _pending_rendering_jobs dict
+                self._remove_pending_job(
+                    finished_job.job_guid,
+                    finished_job.camera_guid,
+                    failed=failed)
+                self._on_render_end(finished_job.temporary_directory, finished_job.camera_guid)
+        # see if there are any other jobs remaining
+        if not self._has_pending_jobs():
+            # no more jobs, signal rendering completion
+            self._on_all_renderings_ended(finished_job.temporary_directory)
+
+    def _start_waiting_jobs(self):
+        """Start waiting jobs until they run out, or until the core or memory budget has been used."""
+        while True:
+            with self.r_lock:
+                # see if there are any jobs to process.
                 job_info = self._get_next_job_info()
                 next_job_job_guid = job_info["job_guid"]
                 next_job_camera_guid = job_info["camera_guid"]
-                rendering_profile = job_info["rendering_profile"]
-                camera_profile = job_info["camera_profile"]
-                temporary_directory = job_info["temporary_directory"]
-
-                if next_job_job_guid and next_job_camera_guid:
-                    if not self._start_job(
-                        next_job_job_guid, next_job_camera_guid, rendering_profile, camera_profile, temporary_directory
-                    ):
-                        # the job never started.  Remove it and send an error message.
-                        with self.r_lock:
-                            self._is_processing = False
-                            self._on_render_error(
-                                None,
-                                "Octolapse was unable to start one of the rendering jobs.  See plugin_octolapse.log for more "
-                                "details."
-                            )
-                            self._remove_pending_job(next_job_job_guid, next_job_camera_guid, failed=True)
+                if not (next_job_job_guid and next_job_camera_guid):
+                    return
+                if self._running_jobs and self._get_free_cores() < 1:
+                    return
+            try:
+                render_job_info = self._get_job_settings(
+                    next_job_job_guid,
+                    next_job_camera_guid,
+                    job_info["rendering_profile"],
+                    job_info["camera_profile"],
+                    job_info["temporary_directory"]
+                )
             except Exception as e:
-                logger.exception("An unexpected exception occurred while processing a queue item.")
+                logger.exception("Could not load rendering job settings, skipping.")
+                # the job never started.  Remove it and send an error message.
+                with self.r_lock:
+                    self._on_render_error(
+                        None,
+                        None,
+                        "Octolapse was unable to start one of the rendering jobs.  See plugin_octolapse.log for more "
+                        "details."
+                    )
+                    self._remove_pending_job(next_job_job_guid, next_job_camera_guid, failed=True)
+                continue
+            if not self._start_job(render_job_info):
+                # wait for a running job to finish
+                return
+
+    def _get_core_budget(self):
+        """Returns the number of cores that may be used by all renderings."""
+        core_budget = self._get_current_settings_callback().main_settings.rendering_core_budget
+        if not core_budget or core_budget < 1:
+            core_budget = psutil.cpu_count() or 1
+        if self._is_printing():
+            # leave a core for OctoPrint while printing
+            core_budget = max(core_budget - 1, 1)
+        return core_budget
+
+    def _get_free_cores(self):
+        with self.r_lock:
+            return self._get_core_budget() - sum(running_job["cores"] for running_job in self._running_jobs.values())
+
+    def _get_free_memory_mb(self):
+        with self.r_lock:
+            memory_budget_mb = self._get_current_settings_callback().main_settings.rendering_memory_budget_mb
+            if not memory_budget_mb or memory_budget_mb < 1:
+                # Use most of the available memory.  The memory used by running jobs is subtracted again, since they
+                # may not have allocated it yet.
+                memory_budget_mb = psutil.virtual_memory().available / (1024.0 * 1024.0) * 0.75
+            return memory_budget_mb - sum(running_job["memory_mb"] for running_job in self._running_jobs.values())
+
+    @staticmethod
+    def _estimate_job_memory_mb(render_job_info, cores):
+        """Roughly estimates the memory needed to render a job from the size of its snapshots.  The frame preparer
+           keeps a few decoded frames per thread, and ffmpeg buffers frames for each thread plus its lookahead.
+        """
+        width, height = 1920, 1080
+        try:
+            for file_name in os.listdir(render_job_info.snapshot_directory):
+                if utility.is_valid_snapshot_extension(utility.get_extension_from_filename(file_name)):
+                    # only the header is read
+                    with Image.open(os.path.join(render_job_info.snapshot_directory, file_name)) as image:
+                        width, height = image.size
+                    break
+        except (IOError, OSError):
+            logger.debug("Unable to read the snapshot size, using the default estimate.", exc_info=True)
+        frame_mb = width * height * 3 / (1024.0 * 1024.0)
+        return frame_mb * (4 * cores + 16)
+
+    def _is_printing(self):
+        if self._is_printing_callback is None:
+            return False
+        try:
+            return self._is_printing_callback()
+        except Exception as e:
+            logger.exception("Unable to determine if a print is running.")
+            return False
+
+    def _update_job_priorities(self):
+        """Renders at a lower priority while printing."""
+        with self.r_lock:
+            if not self._running_jobs:
+                return
+            threads = [running_job["thread"] for running_job in self._running_jobs.values()]
+        is_printing = self._is_printing()
+        for thread in threads:
+            thread.set_low_priority(is_printing)
 
     def _add_job(self, job_guid, camera_guid, rendering_profile, camera_profile, temporary_directory):
         """Returns true if the job was added, false if it does not exist"""
@@ -1409,7 +1502,6 @@ class RenderingProcessor(threading.Thread):
                     if len(camera_jobs) == 0:
                         job = self._pending_rendering_jobs.pop(job_guid, None)
 
-                self._current_rendering_job = None
                 # add job to the unfinished job list
 
                 # see if the job is in the in process job list
@@ -1428,24 +1520,30 @@ class RenderingProcessor(threading.Thread):
             self._on_unfinished_renderings_changed(removed_job, "added")
 
     def _get_next_job_info(self):
-        """Gets the next job in the _pending_rendering_jobs dict, or returns Null if one does not exist"""
+        """Gets the next job in the _pending_rendering_jobs dict that is not running, or returns Null if one does not
+           exist"""
         job_guid = None
         camera_guid = None
         rendering_profile = None
         camera_profile = None
         temporary_directory = None
-        if self._has_pending_jobs():
-            job_guid = next(iter(self._pending_rendering_jobs))
-            camera_jobs = self._pending_rendering_jobs.get(job_guid, None)
-            if camera_jobs:
-                camera_guid = next(iter(camera_jobs))
+        for pending_job_guid in self._pending_rendering_jobs:
+            camera_jobs = self._pending_rendering_jobs.get(pending_job_guid, None)
+            if not camera_jobs:
+                logger.error("Could not find any camera jobs for the print job with guid %s.", pending_job_guid)
+                continue
+            for pending_camera_guid in camera_jobs:
+                if self._is_job_running(pending_job_guid, pending_camera_guid):
+                    continue
+                job_guid = pending_job_guid
+                camera_guid = pending_camera_guid
                 camera_settings = camera_jobs[camera_guid]
                 rendering_profile = camera_settings["rendering_profile"]
                 camera_profile = camera_settings["camera_profile"]
                 temporary_directory = camera_settings["temporary_directory"]
-
-            else:
-                logger.error("Could not find any camera jobs for the print job with guid %s.", job_guid)
+                break
+            if camera_guid:
+                break
         return {
             "job_guid": job_guid,
             "camera_guid": camera_guid,
@@ -1461,6 +1559,9 @@ class RenderingProcessor(threading.Thread):
             job_count += len(self._pending_rendering_jobs[job_guid])
         return job_count
 
+    def _get_waiting_rendering_job_count(self):
+        return self._get_pending_rendering_job_count() - len(self._running_jobs)
+
     def _get_job_settings(self, job_guid, camera_guid, rendering_profile, camera_profile, temporary_directory):
         """Attempt to load all job settings from the snapshot path"""
         settings = OctolapseSettings(self._plugin_version, self._git_version)
@@ -1506,48 +1607,67 @@ class RenderingProcessor(threading.Thread):
 
         )
 
-    def _start_job(self, job_guid, camera_guid, rendering_profile, camera_profile, temporary_directory):
+    def _start_job(self, render_job_info):
+        """Starts the job if there are enough cores and memory, and returns True if it was started."""
         with self.r_lock:
-            self._is_processing = True
-            try:
-                job_info = self._get_job_settings(
-                    job_guid, camera_guid, rendering_profile, camera_profile, temporary_directory
-                )
-            except Exception as e:
-                logger.exception("Could not load rendering job settings, skipping.")
+            # Split the free cores between the waiting jobs, but give each job at least the threads requested by
+            # its rendering profile.
+            free_cores = self._get_free_cores()
+            requested_cores = min(max(render_job_info.rendering.thread_count, 1), self._get_core_budget())
+            cores = max(min(free_cores // max(self._get_waiting_rendering_job_count(), 1), free_cores), 1)
+            cores = max(cores, requested_cores)
+            memory_mb = self._estimate_job_memory_mb(render_job_info, cores)
+            # always start a job if nothing is running, else the budget could prevent rendering forever
+            if self._running_jobs and (cores > free_cores or memory_mb > self._get_free_memory_mb()):
                 return False
-
+            render_job_info.thread_count = cores
             self.job_count += 1
 
+            job_guid = render_job_info.job_guid
+            camera_guid = render_job_info.camera_guid
+            running_job = {
+                "rendering": self._get_in_process_rendering_job(job_guid, camera_guid),
+                "cores": cores,
+                "memory_mb": memory_mb,
+                "last_progress_time": 0,
+                "last_progress": 0
+            }
+            logger.info(
+                "Starting rendering job %s for camera %s with %d threads and an estimated %.0fMB of memory.",
+                job_guid, camera_guid, cores, memory_mb
+            )
             has_started = threading.Event()
-            self._rendering_job_thread = TimelapseRenderJob(
-                job_info,
+            running_job["thread"] = TimelapseRenderJob(
+                render_job_info,
                 has_started,
-                self._on_render_start,
-                self._on_render_error,
-                self._on_render_success,
-                self._on_render_progress,
+                lambda payload: self._on_render_start(running_job, payload),
+                lambda payload, error: self._on_render_error(running_job, payload, error),
+                lambda payload: self._on_render_success(running_job, payload),
+                lambda key, current_step=None, total_steps=None: self._on_render_progress(
+                    running_job, key, current_step, total_steps
+                ),
                 self._delete_snapshots_for_job,
                 self.archive_unfinished_job
             )
-            self._rendering_job_thread.daemon = True
-            self._current_rendering_job = self._get_in_process_rendering_job(job_guid, camera_guid)
-            self._previous_render_progress = 0
-            self._rendering_job_thread.start()
+            running_job["thread"].daemon = True
+            running_job["thread"].set_low_priority(self._is_printing())
+            self._running_jobs[(job_guid, camera_guid)] = running_job
+            running_job["thread"].start()
             has_started.wait()
             return True
 
-    def _on_render_start(self, payload):
+    def _on_render_start(self, running_job, payload):
         logger.info("Sending render start message")
-        self._on_start_callback(payload, copy.copy(self._current_rendering_job))
+        self._on_start_callback(payload, copy.copy(running_job["rendering"]))
 
-    def _on_render_error(self, payload, error):
+    def _on_render_error(self, running_job, payload, error):
         logger.info("Sending render fail message")
         with self.r_lock:
-            job_copy = copy.copy(self._current_rendering_job)
-            if self._current_rendering_job:
-                job_guid = self._current_rendering_job["job_guid"]
-                camera_guid = self._current_rendering_job["camera_guid"]
+            rendering = running_job["rendering"] if running_job else None
+            job_copy = copy.copy(rendering)
+            if rendering:
+                job_guid = rendering["job_guid"]
+                camera_guid = rendering["camera_guid"]
                 self._remove_pending_job(job_guid, camera_guid, failed=True)
                 delete = False
                 if isinstance(error, RenderError):
@@ -1556,12 +1676,13 @@ class RenderingProcessor(threading.Thread):
                         self._remove_unfinished_job(job_guid, camera_guid, delete=False)
         self._on_error_callback(payload, error, job_copy)
 
-    def _on_render_success(self, payload):
+    def _on_render_success(self, running_job, payload):
         logger.info("Sending render complete message")
-        self._on_success_callback(payload, copy.copy(self._current_rendering_job))
+        self._on_success_callback(payload, copy.copy(running_job["rendering"]))
 
-    def _on_render_progress(self, key, current_step=None, total_steps=None):
-        progress_current_key = self._current_rendering_job["progress"]
+    def _on_render_progress(self, running_job, key, current_step=None, total_steps=None):
+        rendering = running_job["rendering"]
+        progress_current_key = rendering["progress"]
         cur_time = time.time()
         if current_step is not None and total_steps:
             progress = round(float(current_step) / total_steps * 100.0, 1)
@@ -1569,15 +1690,15 @@ class RenderingProcessor(threading.Thread):
             progress = None
         if (
             progress_current_key != key or
-            (self._last_progress_time_update + 0.5 < cur_time and progress != self._previous_render_progress)
+            (running_job["last_progress_time"] + 0.5 < cur_time and progress != running_job["last_progress"])
         ):
-            self._current_rendering_job["progress"] = key
+            rendering["progress"] = key
             logger.verbose(
                 "Sending render progress message: %s%s", key, " - {0:.1f}".format(progress) if progress else ""
             )
-            self._on_render_progress_callback(progress, copy.copy(self._current_rendering_job))
-            self._previous_render_progress = progress
-            self._last_progress_time_update = cur_time
+            self._on_render_progress_callback(progress, copy.copy(rendering))
+            running_job["last_progress"] = progress
+            running_job["last_progress_time"] = cur_time
 
     def _on_render_end(self, temporary_directory, camera_guid):
         self._clean_temporary_directory(temporary_directory, current_camera_guid=camera_guid)
@@ -1595,8 +1716,6 @@ class RenderingProcessor(threading.Thread):
 
 
 class TimelapseRenderJob(threading.Thread):
-    # lock
-    render_job_lock = threading.RLock()
     # ffmpeg progress regexes
     _ffmpeg_duration_regex = re.compile(r"Duration: (\d{2}):(\d{2}):(\d{2})\.\d{2}")
     _ffmpeg_current_regex = re.compile(r"time=(\d{2}):(\d{2}):(\d{2})\.\d{2}")
@@ -1622,7 +1741,12 @@ class TimelapseRenderJob(threading.Thread):
         self._image_count = 0
         self._max_image_number = 0
         self._images_removed_count = 0
-        self._threads = render_job_info.rendering.thread_count
+        self._threads = render_job_info.thread_count
+        # the running ffmpeg process, and the priority that has been applied to it
+        self._priority_lock = threading.RLock()
+        self._ffmpeg_process = None
+        self._is_low_priority = False
+        self._applied_priority = None
         self._ffmpeg = render_job_info.ffmpeg_directory
         if self._ffmpeg is not None:
             self._ffmpeg = self._ffmpeg.strip()
@@ -1634,7 +1758,9 @@ class TimelapseRenderJob(threading.Thread):
         self._thread = None
         self._archive_snapshots = render_job_info.archive_snapshots or not render_job_info.rendering.enabled
         # full path of the input
-        self._temp_rendering_dir = utility.get_temporary_rendering_directory(render_job_info.temporary_directory)
+        self._temp_rendering_dir = utility.get_temporary_rendering_job_camera_path(
+            render_job_info.temporary_directory, render_job_info.job_guid, render_job_info.camera_guid
+        )
         self._output_directory = ""
         self._output_filename = ""
         self._output_extension = ""
@@ -1658,6 +1784,50 @@ class TimelapseRenderJob(threading.Thread):
         self._on_start_event.set()
         self._render()
 
+    def set_low_priority(self, is_low_priority):
+        """Lowers the priority of ffmpeg so that it doesn't compete with a running print."""
+        with self._priority_lock:
+            self._is_low_priority = is_low_priority
+            self._update_ffmpeg_priority()
+
+    def _get_ffmpeg_pid(self):
+        process = self._ffmpeg_process
+        if isinstance(process, script.POpenWithTimeoutAsync):
+            # the process is started on another thread, so it may not exist yet
+            process = process.proc
+        if process is None:
+            return None
+        return process.pid
+
+    def _update_ffmpeg_priority(self):
+        with self._priority_lock:
+            pid = self._get_ffmpeg_pid()
+            if pid is None or self._applied_priority == (pid, self._is_low_priority):
+                return
+            # a new ffmpeg process inherits the normal priority, so only changes need to be applied
+            is_new_process = self._applied_priority is None or self._applied_priority[0] != pid
+            self._applied_priority = (pid, self._is_low_priority)
+            if is_new_process and not self._is_low_priority:
+                return
+            try:
+                psutil.Process(pid).nice(get_rendering_process_priority(self._is_low_priority))
+                logger.info(
+                    "The ffmpeg priority was %s.", "lowered while printing" if self._is_low_priority else "restored"
+                )
+            except psutil.NoSuchProcess:
+                # ffmpeg has already exited
+                pass
+            except (psutil.Error, OSError):
+                if self._is_low_priority:
+                    logger.debug("Unable to lower the priority of the ffmpeg process.", exc_info=True)
+                else:
+                    # Raising the priority requires elevated privileges on most systems, so ffmpeg will finish
+                    # this rendering at the lower priority.
+                    logger.info(
+                        "Unable to restore the priority of the ffmpeg process after printing.  It will finish "
+                        "rendering at the lower priority."
+                    )
+
     def _render(self):
         """Process the timelapse render job and report progress"""
         # send render start message
@@ -1689,9 +1859,14 @@ class TimelapseRenderJob(threading.Thread):
                 # phase change, but does not send completed percentage
                 self._pre_render_script()
 
-                # Create and copy images to the temporary rendering directory, converting them to jpg if necessary
-                # this routine reports progress
-                self._convert_and_copy_snapshot_images()
+                # Stream the snapshots straight into ffmpeg when the native frame preparer is available, otherwise
+                # create and copy images to the temporary rendering directory, converting them to jpg if necessary
+                # these routines report progress
+                stream_frames = self._can_stream_frames()
+                if stream_frames:
+                    snapshot_frames = self._collect_snapshot_frames()
+                else:
+                    self._convert_and_copy_snapshot_images()
 
                 # read any metadata produced by the timelapse process
                 # this is used to create text overlays
@@ -1735,46 +1910,11 @@ class TimelapseRenderJob(threading.Thread):
                         watermark_path = watermark_path.replace(
                             "\\", "/").replace(":", "\\\\:")
 
-                # Do image preprocessing.  This relies on the original file name, so no renaming before running
-                # this function
-                self._add_text_overlays()
-
-                # rename the images
-                logger.debug("Renaming images.")
-                self._rename_images()
-
-                # Add pre and post roll.
-                self._apply_pre_post_roll()
-
-                # prepare ffmpeg command
-                command_args = self._create_ffmpeg_command_args(
-                    os.path.join(self._temp_rendering_dir, self._render_job_info.snapshot_filename_format),
-                    temp_filepath,
-                    watermark=watermark_path
-                )
-
-                # Render the timelapse via ffmpeg/avconv
-                logger.info("Running ffmpeg.")
-                with self.render_job_lock:
-                    try:
-                        # create an async thread, along with a callback for processing ffmpeg debug output
-                        # for calculating progress
-                        p = script.POpenWithTimeoutAsync(on_stderr_line_received=self._process_ffmpeg_output)
-                        p.run(command_args)
-                    except Exception as e:
-                        logger.exception("An exception occurred while running the ffmpeg process.")
-                        raise RenderError('rendering-exception', "ffmpeg failed during rendering of movie. "
-                                                                 "Please check plugin_octolapse.log for details.",
-                                          cause=e)
-                    if p.return_code != 0:
-                        return_code = p.return_code
-                        stderr_text = "\n".join(p.stderr_lines)
-                        raise RenderError('return-code', "Could not render movie, got return code %r: %s" % (
-                            return_code, stderr_text))
-                    else:
-                        # only rename the temporary file if the script completed.
-                        # If it did not, we will get a failed return code later.
-                        utility.move(temp_filepath, self._output_filepath)
+                if stream_frames:
+                    # Decode, overlay and pipe the frames to ffmpeg without writing them to disk
+                    self._stream_snapshot_frames(snapshot_frames, temp_filepath, watermark_path)
+                else:
+                    self._render_snapshot_files(temp_filepath, watermark_path)
 
                 # run any post rendering scripts, notifying the client if scripts are running (but no progress)
                 self._post_render_script()
@@ -1873,6 +2013,54 @@ class TimelapseRenderJob(threading.Thread):
             self._render_job_info.rendering_error = r_error
             self.on_render_error(self._create_callback_payload(0, "The render process failed."), r_error)
 
+    def _render_snapshot_files(self, temp_filepath, watermark_path):
+        """Render the snapshots copied to the temporary rendering directory with ffmpeg."""
+        # Do image preprocessing.  This relies on the original file name, so no renaming before running
+        # this function
+        self._add_text_overlays()
+
+        # rename the images
+        logger.debug("Renaming images.")
+        self._rename_images()
+
+        # Add pre and post roll.
+        self._apply_pre_post_roll()
+
+        # prepare ffmpeg command
+        command_args = self._create_ffmpeg_command_args(
+            os.path.join(self._temp_rendering_dir, self._render_job_info.snapshot_filename_format),
+            temp_filepath,
+            watermark=watermark_path
+        )
+
+        # Render the timelapse via ffmpeg/avconv
+        logger.info("Running ffmpeg.")
+        try:
+            # create an async thread, along with a callback for processing ffmpeg debug output
+            # for calculating progress
+            p = script.POpenWithTimeoutAsync(on_stderr_line_received=self._process_ffmpeg_output)
+            # the rendering processor applies the process priority once ffmpeg has started
+            with self._priority_lock:
+                self._ffmpeg_process = p
+            p.run(command_args)
+        except Exception as e:
+            logger.exception("An exception occurred while running the ffmpeg process.")
+            raise RenderError('rendering-exception', "ffmpeg failed during rendering of movie. "
+                                                     "Please check plugin_octolapse.log for details.",
+                              cause=e)
+        finally:
+            with self._priority_lock:
+                self._ffmpeg_process = None
+        if p.return_code != 0:
+            return_code = p.return_code
+            stderr_text = "\n".join(p.stderr_lines)
+            raise RenderError('return-code', "Could not render movie, got return code %r: %s" % (
+                return_code, stderr_text))
+        else:
+            # only rename the temporary file if the script completed.
+            # If it did not, we will get a failed return code later.
+            utility.move(temp_filepath, self._output_filepath)
+
     def _run_prechecks(self):
         """Verify that we have an ffmepg and bitrate.  If not, raise an exception.  More prechecks could be done."""
         if self._ffmpeg is None:
@@ -1987,6 +2175,82 @@ class TimelapseRenderJob(threading.Thread):
 
         self._render_job_info.output_tokens["SNAPSHOTCOUNT"] = "{0}".format(self._image_count)
 
+    def _can_stream_frames(self):
+        """Returns True if the snapshots can be decoded natively and piped into ffmpeg.  The after render script
+           receives the temporary rendering directory, so the frames must be written to disk when one is configured.
+        """
+        return (
+            hasattr(GcodePositionProcessor, "PrepareFrames") and
+            not self._render_job_info.camera.on_after_render_script.strip()
+        )
+
+    def _collect_snapshot_frames(self):
+        """Finds every snapshot that will be rendered, counts images, and finds the maximum snapshot number.  Snapshots
+           the native frame preparer cannot decode are converted to baseline jpegs within the temporary rendering
+           directory.  Returns a sorted list of (path, width, height) tuples.
+        """
+        logger.debug("Collecting snapshot frames for streaming")
+        self._image_count = 0
+        frames = []
+        if not os.path.isdir(self._render_job_info.snapshot_directory):
+            # No snapshots were created.  Return
+            return frames
+
+        snapshot_files = []
+        for name in sorted(os.listdir(self._render_job_info.snapshot_directory)):
+            path = os.path.join(self._render_job_info.snapshot_directory, name)
+            # skip non-files and non jpgs
+            extension = utility.get_extension_from_full_path(path)
+            if not os.path.isfile(path) or not utility.is_valid_snapshot_extension(extension):
+                continue
+            snapshot_files.append(path)
+
+        # clean any existing temporary files, and make sure the temp directory exists for converted images
+        self._clear_temporary_files(delete_folder=False, progress_key='preparing')
+        if not os.path.exists(self._temp_rendering_dir):
+            os.makedirs(self._temp_rendering_dir)
+
+        num_images = len(snapshot_files)
+        for index, path in enumerate(snapshot_files):
+            self.on_render_progress('preparing', index, num_images)
+            size = GcodePositionProcessor.GetJpegSize(path)
+            if size is None:
+                # progressive, png, corrupt, etc.  Let Pillow have a go at it.
+                target = os.path.join(self._temp_rendering_dir, os.path.basename(path))
+                try:
+                    with Image.open(path) as img:
+                        logger.info(
+                            "The image at %s is in %s format.  Attempting to convert to a baseline jpeg.",
+                            path,
+                            img.format
+                        )
+                        with img.convert('RGB') as rgb_img:
+                            rgb_img.save(target, 'JPEG', quality=95)
+                except IOError:
+                    logger.exception("The file at path %s is not a valid image file, could not be converted, "
+                                     "and has been removed.", path)
+                    continue
+                size = GcodePositionProcessor.GetJpegSize(target)
+                if size is None:
+                    logger.error("The converted image at %s could not be read.  Skipping.", target)
+                    continue
+                path = target
+            frames.append((path, size[0], size[1]))
+            self._image_count += 1
+
+            img_num = utility.get_snapshot_number_from_path(path)
+            if img_num > self._max_image_number:
+                self._max_image_number = img_num
+
+        # if we have no camera infos, let's create it now
+        if self._render_job_info.camera_info.is_empty:
+            self._render_job_info.camera_info.snapshot_attempt = self._max_image_number
+            self._render_job_info.camera_info.snapshot_count = self._image_count
+            self._render_job_info.camera_info.errors_count = -1
+
+        self._render_job_info.output_tokens["SNAPSHOTCOUNT"] = "{0}".format(self._image_count)
+        return frames
+
     def _read_snapshot_metadata(self):
         """Read all snapshot metadata (csv) if it exists, which is used to generate overlays."""
         # get the metadata path
@@ -2123,43 +2387,7 @@ class TimelapseRenderJob(threading.Thread):
         num_images = len(self._snapshot_metadata)
         for index, data in enumerate(self._snapshot_metadata):
             self.on_render_progress('adding_overlays', index, num_images)
-            # TODO:  MAKE SURE THIS WORKS IF THERE ARE ANY ERRORS
-            # Variables the user can use in overlay_text_template.format().
-            format_vars = utility.SafeDict()
-
-            # Extra metadata according to SnapshotMetadata.METADATA_FIELDS.
-
-            format_vars['gcode_file'] = (
-                self._render_job_info.timelapse_job_info.PrintFileName + "." +
-                self._render_job_info.timelapse_job_info.PrintFileExtension
-            )
-            format_vars['gcode_file_name'] = self._render_job_info.timelapse_job_info.PrintFileName
-            format_vars['gcode_file_extension'] = self._render_job_info.timelapse_job_info.PrintFileExtension
-            format_vars['print_end_state'] = self._render_job_info.timelapse_job_info.PrintEndState
-
-            format_vars['snapshot_number'] = snapshot_number = int(data['snapshot_number']) + 1
-            format_vars['file_name'] = data['file_name']
-            format_vars['time_taken'] = time_taken = float(data['time_taken'])
-
-            layer = None if "layer" not in data or data["layer"] is None or data["layer"] == "None" else int(data["layer"])
-            height = None if "height" not in data or data["height"] is None or data["height"] == "None" else float(data["height"])
-            x = None if "x" not in data or data["x"] is None or data["x"] == "None" else float(data["x"])
-            y = None if "y" not in data or data["y"] is None or data["y"] == "None" else float(data["y"])
-            z = None if "z" not in data or data["z"] is None or data["z"] == "None" else float(data["z"])
-            e = None if "e" not in data or data["e"] is None or data["e"] == "None" else float(data["e"])
-            f = None if "f" not in data or data["f"] is None or data["f"] == "None" else int(float(data["f"]))
-            x_snapshot = None if "x_snapshot" not in data or data["x_snapshot"] is None or data["x_snapshot"] == "None" else float(data["x_snapshot"])
-            y_snapshot = None if "y_snapshot" not in data or data["y_snapshot"] is None or data["y_snapshot"] == "None" else float(data["y_snapshot"])
-
-            format_vars['layer'] = "None" if layer is None else "{0}".format(layer)
-            format_vars['height'] = "None" if height is None else "{0}".format(height)
-            format_vars['x'] = "None" if x is None else "{0:.3f}".format(x)
-            format_vars['y'] = "None" if y is None else "{0:.3f}".format(y)
-            format_vars['z'] = "None" if z is None else "{0:.3f}".format(z)
-            format_vars['e'] = "None" if e is None else "{0:.5f}".format(e)
-            format_vars['f'] = "None" if f is None else "{0}".format(f)
-            format_vars['x_snapshot'] = "None" if x_snapshot is None else "{0:.3f}".format(x_snapshot)
-            format_vars['y_snapshot'] = "None" if y_snapshot is None else "{0:.3f}".format(y_snapshot)
+            format_vars = self._get_overlay_format_vars(data, first_timestamp)
 
             # Verify that the file actually exists.
             file_path = os.path.join(
@@ -2167,12 +2395,6 @@ class TimelapseRenderJob(threading.Thread):
                 self._render_job_info.get_snapshot_name_from_index(index)
             )
             if os.path.exists(file_path):
-                # Calculate time elapsed since the beginning of the print.
-                format_vars['current_time'] = time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(time_taken))
-                format_vars['time_elapsed'] = time_taken - first_timestamp
-                format_vars['time_elapsed_formatted'] = "{}".format(
-                    datetime.timedelta(seconds=round(time_taken - first_timestamp))
-                )
                 # Open the image in Pillow and do preprocessing operations.
                 with Image.open(file_path) as img:
                     img = self.add_overlay(img,
@@ -2197,19 +2419,58 @@ class TimelapseRenderJob(threading.Thread):
                 logger.error("The snapshot at %s does not exist.  Skipping preprocessing.", file_path)
         logger.info("Finished adding text overlays.")
 
-    @staticmethod
-    def add_overlay(image, text_template, format_vars, font_path, font_size, overlay_location, overlay_text_alignment,
-                    overlay_text_valign, overlay_text_halign, text_color, outline_color, outline_width):
-        """Adds an overlay to an image with the given parameters. The image is not mutated.
-        :param image: A Pillow RGB image.
-        :returns The image with the overlay added."""
+    def _get_overlay_format_vars(self, data, first_timestamp):
+        """Returns the variables the user can use in the overlay text template for a row of snapshot metadata."""
+        # TODO:  MAKE SURE THIS WORKS IF THERE ARE ANY ERRORS
+        # Variables the user can use in overlay_text_template.format().
+        format_vars = utility.SafeDict()
 
-        text_color_tuple = tuple(text_color)
-        outline_color_tuple = tuple(outline_color)
-        # No text to draw.
-        if not text_template:
-            return image
+        # Extra metadata according to SnapshotMetadata.METADATA_FIELDS.
+
+        format_vars['gcode_file'] = (
+            self._render_job_info.timelapse_job_info.PrintFileName + "." +
+            self._render_job_info.timelapse_job_info.PrintFileExtension
+        )
+        format_vars['gcode_file_name'] = self._render_job_info.timelapse_job_info.PrintFileName
+        format_vars['gcode_file_extension'] = self._render_job_info.timelapse_job_info.PrintFileExtension
+        format_vars['print_end_state'] = self._render_job_info.timelapse_job_info.PrintEndState
+
+        format_vars['snapshot_number'] = int(data['snapshot_number']) + 1
+        format_vars['file_name'] = data['file_name']
+        format_vars['time_taken'] = time_taken = float(data['time_taken'])
+
+        layer = None if "layer" not in data or data["layer"] is None or data["layer"] == "None" else int(data["layer"])
+        height = None if "height" not in data or data["height"] is None or data["height"] == "None" else float(data["height"])
+        x = None if "x" not in data or data["x"] is None or data["x"] == "None" else float(data["x"])
+        y = None if "y" not in data or data["y"] is None or data["y"] == "None" else float(data["y"])
+        z = None if "z" not in data or data["z"] is None or data["z"] == "None" else float(data["z"])
+        e = None if "e" not in data or data["e"] is None or data["e"] == "None" else float(data["e"])
+        f = None if "f" not in data or data["f"] is None or data["f"] == "None" else int(float(data["f"]))
+        x_snapshot = None if "x_snapshot" not in data or data["x_snapshot"] is None or data["x_snapshot"] == "None" else float(data["x_snapshot"])
+        y_snapshot = None if "y_snapshot" not in data or data["y_snapshot"] is None or data["y_snapshot"] == "None" else float(data["y_snapshot"])
+
+        format_vars['layer'] = "None" if layer is None else "{0}".format(layer)
+        format_vars['height'] = "None" if height is None else "{0}".format(height)
+        format_vars['x'] = "None" if x is None else "{0:.3f}".format(x)
+        format_vars['y'] = "None" if y is None else "{0:.3f}".format(y)
+        format_vars['z'] = "None" if z is None else "{0:.3f}".format(z)
+        format_vars['e'] = "None" if e is None else "{0:.5f}".format(e)
+        format_vars['f'] = "None" if f is None else "{0}".format(f)
+        format_vars['x_snapshot'] = "None" if x_snapshot is None else "{0:.3f}".format(x_snapshot)
+        format_vars['y_snapshot'] = "None" if y_snapshot is None else "{0:.3f}".format(y_snapshot)
+
+        # Calculate time elapsed since the beginning of the print.
+        format_vars['current_time'] = time.strftime("%Y-%m-%d %H:%M:%S", time.localtime(time_taken))
+        format_vars['time_elapsed'] = time_taken - first_timestamp
+        format_vars['time_elapsed_formatted'] = "{}".format(
+            datetime.timedelta(seconds=round(time_taken - first_timestamp))
+        )
+        return format_vars
 
+    @staticmethod
+    def get_overlay_text(text_template, format_vars):
+        """Formats the overlay text template with the given variables.  The time_elapsed variable is replaced with
+           its formatted value."""
         success, text_template = format_overlay_date_templates(text_template, format_vars["time_taken"])
         if not success:
             # this should not happen, but just in case
@@ -2223,7 +2484,22 @@ class TimelapseRenderJob(threading.Thread):
             # replace time_elapsed with a formatted string, in case format strings are omitted
             format_vars['time_elapsed'] = format_vars['time_elapsed_formatted']
             del format_vars['time_elapsed_formatted']
-            text = text_template.format(**format_vars)
+        return text_template.format(**format_vars)
+
+    @staticmethod
+    def add_overlay(image, text_template, format_vars, font_path, font_size, overlay_location, overlay_text_alignment,
+                    overlay_text_valign, overlay_text_halign, text_color, outline_color, outline_width):
+        """Adds an overlay to an image with the given parameters. The image is not mutated.
+        :param image: A Pillow RGB image.
+        :returns The image with the overlay added."""
+
+        text_color_tuple = tuple(text_color)
+        outline_color_tuple = tuple(outline_color)
+        # No text to draw.
+        if not text_template:
+            return image
+
+        text = TimelapseRenderJob.get_overlay_text(text_template, format_vars)
 
         # No font selected
         if not font_path or not os.path.isfile(font_path):
@@ -2385,6 +2661,220 @@ class TimelapseRenderJob(threading.Thread):
         logger.info("Pre/post roll generated successfully.")
 
 
+    def _get_overlay_placements(self, frames, width, height):
+        """Lays out the overlay text for every frame.  Returns the glyph atlas and a list of glyph placements for
+           each frame, or None if there is nothing to draw.
+        """
+        rendering = self._render_job_info.rendering
+        if not rendering.overlay_text_template:
+            return None, [None] * len(frames)
+
+        if not os.path.isfile(rendering.overlay_font_path):
+            raise RenderError("overlay-font", "The rendering overlay font path does not exist.  Check your rendering settings and select a different font.")
+
+        if self._snapshot_metadata is None:
+            logger.warning("No snapshot metadata was found, cannot add text overlays images.")
+            return None, [None] * len(frames)
+
+        logger.info("Started laying out text overlays.")
+        atlas = OverlayGlyphAtlas(
+            ImageFont.truetype(rendering.overlay_font_path, size=rendering.overlay_font_size),
+            rendering.get_overlay_text_color(),
+            rendering.get_overlay_outline_color(),
+            rendering.overlay_outline_width
+        )
+        # The metadata rows are matched to the snapshots by file name, like _add_text_overlays
+        metadata_by_name = {}
+        for index, data in enumerate(self._snapshot_metadata):
+            metadata_by_name[self._render_job_info.get_snapshot_name_from_index(index)] = data
+        first_timestamp = float(self._snapshot_metadata[0]['time_taken'])
+        placements = []
+        num_frames = len(frames)
+        for index, (path, frame_width, frame_height) in enumerate(frames):
+            self.on_render_progress('adding_overlays', index, num_frames)
+            data = metadata_by_name.get(os.path.basename(path))
+            if data is None:
+                placements.append(None)
+                continue
+            text = self.get_overlay_text(
+                rendering.overlay_text_template, self._get_overlay_format_vars(data, first_timestamp)
+            )
+            placements.append(atlas.layout(
+                text,
+                (width, height),
+                rendering.overlay_text_pos,
+                rendering.overlay_text_alignment,
+                rendering.overlay_text_valign,
+                rendering.overlay_text_halign
+            ))
+        logger.info("Finished laying out text overlays using %d glyphs.", len(atlas.glyphs))
+        return atlas, placements
+
+    def _align_snapshot_frames(self, frames, width, height):
+        """Measures the jitter between consecutive snapshots, and returns the (x, y) offset in output pixels that
+           removes it from each frame, or None if the snapshots could not be aligned.  The offsets are also saved in the
+           snapshot metadata.
+        """
+        logger.info("Aligning %d snapshots.", len(frames))
+
+        def on_progress(frames_analysed, total_frames):
+            self.on_render_progress('aligning', frames_analysed, total_frames)
+            return True
+
+        results = GcodePositionProcessor.RegisterFrames(
+            {"width": width, "height": height, "num_threads": self._threads},
+            [path for path, frame_width, frame_height in frames],
+            on_progress
+        )
+        if not results["success"]:
+            # Alignment is optional, so render without it
+            logger.error("Unable to align the snapshots: %s", results["error"])
+            return None
+        if results["frames_unmatched"] > 0:
+            logger.warning(
+                "%d snapshots could not be matched with the previous snapshot, and were not aligned.",
+                results["frames_unmatched"]
+            )
+        offsets = [(offset_x, offset_y) for offset_x, offset_y, confidence in results["offsets"]]
+        self._write_frame_offsets(frames, offsets)
+        return offsets
+
+    def _write_frame_offsets(self, frames, offsets):
+        """Adds the alignment offsets to the snapshot metadata, and rewrites the metadata file."""
+        if self._snapshot_metadata is None:
+            logger.debug("No snapshot metadata was found, the alignment offsets will not be saved.")
+            return
+        # The metadata rows are matched to the snapshots by file name, like _get_overlay_placements
+        metadata_by_name = {}
+        for index, data in enumerate(self._snapshot_metadata):
+            metadata_by_name[self._render_job_info.get_snapshot_name_from_index(index)] = data
+        for (path, frame_width, frame_height), (offset_x, offset_y) in zip(frames, offsets):
+            data = metadata_by_name.get(os.path.basename(path))
+            if data is not None:
+                data['offset_x'] = "{0:.3f}".format(offset_x)
+                data['offset_y'] = "{0:.3f}".format(offset_y)
+
+        metadata_path = os.path.join(self._render_job_info.snapshot_directory, SnapshotMetadata.METADATA_FILE_NAME)
+        try:
+            with open(metadata_path, 'w') as metadata_file:
+                dictwriter = DictWriter(metadata_file, SnapshotMetadata.METADATA_FIELDS, extrasaction='ignore')
+                dictwriter.writerows(self._snapshot_metadata)
+        except (IOError, OSError):
+            logger.exception("Unable to save the alignment offsets to the snapshot metadata at %s.", metadata_path)
+
+    def _stream_snapshot_frames(self, frames, temp_filepath, watermark_path):
+        """Decodes the snapshots and adds any overlays natively, piping raw frames into ffmpeg.  Nothing is written to
+           the temporary rendering directory except converted images.
+        """
+        # All frames are scaled to the size of the first one, which is what ffmpeg would do
+        width, height = frames[0][1], frames[0][2]
+        # Most encoders require even dimensions, so drop a row or column if necessary
+        width -= width % 2
+        height -= height % 2
+        atlas, placements = self._get_overlay_placements(frames, width, height)
+        offsets = None
+        if (
+            self._render_job_info.rendering.enable_frame_alignment and
+            hasattr(GcodePositionProcessor, "RegisterFrames")
+        ):
+            offsets = self._align_snapshot_frames(frames, width, height)
+
+        # Add pre and post roll by repeating the first and last frames
+        pre_roll_frames = int(self._render_job_info.rendering.pre_roll_seconds * self._fps)
+        post_roll_frames = int(self._render_job_info.rendering.post_roll_seconds * self._fps)
+        frame_sources = []
+        for index, (path, frame_width, frame_height) in enumerate(frames):
+            repeat_count = 1
+            if index == 0:
+                repeat_count += pre_roll_frames
+            if index == len(frames) - 1:
+                repeat_count += post_roll_frames
+            if offsets is None:
+                frame_sources.append((path, repeat_count, placements[index]))
+            else:
+                frame_sources.append((path, repeat_count, placements[index], offsets[index]))
+        # update the image count
+        self._image_count += pre_roll_frames + post_roll_frames
+
+        # prepare ffmpeg command
+        command_args = self._create_ffmpeg_command_args(
+            "-",
+            temp_filepath,
+            watermark=watermark_path,
+            input_args=['-f', 'rawvideo', '-pix_fmt', 'rgb24', '-s', "{0}x{1}".format(width, height)]
+        )
+
+        logger.info("Streaming %d frames into ffmpeg.", len(frames))
+        stderr_lines = []
+
+        def read_stderr_lines(proc):
+            for line in iter(proc.stderr.readline, ''):
+                line = line.rstrip()
+                if line:
+                    logger.info("stderr: %s", line)
+                    stderr_lines.append(line)
+                    self._process_ffmpeg_output(line)
+
+        try:
+            logger.debug("Executing ffmpeg: %s", subprocess.list2cmdline(command_args))
+            proc = subprocess.Popen(
+                command_args, stdin=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True
+            )
+        except (OSError, ValueError) as e:
+            logger.exception("An exception occurred while running the ffmpeg process.")
+            raise RenderError('rendering-exception', "ffmpeg failed during rendering of movie. "
+                                                     "Please check plugin_octolapse.log for details.",
+                              cause=e)
+        with self._priority_lock:
+            self._ffmpeg_process = proc
+            self._update_ffmpeg_priority()
+        stderr_reader = threading.Thread(target=read_stderr_lines, args=[proc])
+        stderr_reader.daemon = True
+        stderr_reader.start()
+
+        output_handle = proc.stdin.fileno()
+        if sys.platform == "win32":
+            import msvcrt
+            output_handle = msvcrt.get_osfhandle(output_handle)
+
+        def on_progress(frames_written, total_frames):
+            # stop preparing frames if ffmpeg has exited
+            return proc.poll() is None
+
+        try:
+            results = GcodePositionProcessor.PrepareFrames(
+                {
+                    "width": width,
+                    "height": height,
+                    "num_threads": self._threads,
+                    "output_handle": output_handle,
+                    "glyphs": [] if atlas is None else atlas.glyphs
+                },
+                frame_sources,
+                on_progress
+            )
+        finally:
+            # closing stdin signals the end of the stream
+            proc.stdin.close()
+            proc.wait()
+            stderr_reader.join()
+            with self._priority_lock:
+                self._ffmpeg_process = None
+
+        if proc.returncode != 0:
+            raise RenderError('return-code', "Could not render movie, got return code %r: %s" % (
+                proc.returncode, "\n".join(stderr_lines)))
+        if not results["success"]:
+            raise RenderError('rendering-exception', "Could not prepare the frames for ffmpeg: {0}".format(
+                results["error"]))
+        if results["frames_failed"] > 0:
+            logger.warning(
+                "%d snapshots could not be decoded and were replaced by the previous frame.",
+                results["frames_failed"]
+            )
+        # only rename the temporary file if the script completed.
+        utility.move(temp_filepath, self._output_filepath)
+
     def _post_render_script(self):
         """Run any post render script that is configured within the camera profile."""
         script_path = self._render_job_info.camera.on_after_render_script.strip()
@@ -2459,21 +2949,27 @@ class TimelapseRenderJob(threading.Thread):
     ## FFMPEG functions
     ###################
 
-    def _create_ffmpeg_command_args(self, input_file_format, output_file, watermark=None, pix_fmt="yuv420p"):
+    def _create_ffmpeg_command_args(
+        self, input_file_format, output_file, watermark=None, pix_fmt="yuv420p", input_args=None
+    ):
         """
         Create ffmpeg command string based on input parameters.
         Arguments:
-            input_file_format (str): Absolute path to input files including file mask
+            input_file_format (str): Absolute path to input files including file mask, or - for stdin
             output_file (str): Absolute path to output file
             watermark (str): Path to watermark to apply to lower left corner.
             pix_fmt (str): Pixel format to use for output. Default of yuv420p should usually fit the bill.
+            input_args (list): Options describing the input, for example the size of raw frames.
         Returns:
             (str): Prepared command string to render `input` to `output` using ffmpeg.
         """
 
         v_codec = RenderJobInfo.get_vcodec_from_output_format(self._render_job_info.rendering.output_format)
 
-        command = [self._ffmpeg, '-framerate', "{}".format(self._fps), '-loglevel', 'info', '-i', input_file_format]
+        command = [self._ffmpeg]
+        if input_args:
+            command.extend(input_args)
+        command.extend(['-framerate', "{}".format(self._fps), '-loglevel', 'info', '-i', input_file_format])
         command.extend([
             '-threads', "{}".format(self._threads),
             '-r', "{}".format(self._fps),
@@ -2578,6 +3074,115 @@ class TimelapseRenderJob(threading.Thread):
         )
 
 
+class OverlayGlyphAtlas(object):
+    """Rasterizes each overlay character once so that the native frame preparer can composite overlay text without
+       drawing it with Pillow for every frame.  The outline of every character is placed before any fill, which is
+       how Pillow draws stroked text.
+    """
+    # Pillow's default multiline spacing
+    line_spacing = 4
+
+    def __init__(self, font, text_color, outline_color, outline_width):
+        self._font = font
+        self._text_color = text_color
+        self._outline_color = outline_color
+        self._outline_width = outline_width
+        # A list of (width, height, (red, green, blue), alpha bytes) tuples in the form PrepareFrames expects
+        self.glyphs = []
+        # (character, is_outline) -> (glyph_index, left, top)
+        self._glyph_info = {}
+        self._advances = {}
+        left, top, right, bottom = self._get_text_bbox("A", outline_width)
+        self._line_height = bottom + outline_width + OverlayGlyphAtlas.line_spacing
+
+    def _get_text_bbox(self, text, stroke_width):
+        if hasattr(self._font, "getbbox"):
+            return self._font.getbbox(text, stroke_width=stroke_width)
+        # Older versions of Pillow draw stroked text offset by the stroke width
+        width, height = self._font.getsize(text, stroke_width=stroke_width)
+        return -stroke_width, -stroke_width, width - stroke_width, height - stroke_width
+
+    def _get_advance(self, character):
+        advance = self._advances.get(character)
+        if advance is None:
+            if hasattr(self._font, "getlength"):
+                advance = self._font.getlength(character)
+            else:
+                advance = self._font.getsize(character)[0]
+            self._advances[character] = advance
+        return advance
+
+    def _get_glyph(self, character, is_outline):
+        key = (character, is_outline)
+        glyph_info = self._glyph_info.get(key)
+        if glyph_info is None:
+            stroke_width = self._outline_width if is_outline else 0
+            color = self._outline_color if is_outline else self._text_color
+            left, top, right, bottom = self._get_text_bbox(character, stroke_width)
+            width = max(int(right - left), 0)
+            height = max(int(bottom - top), 0)
+            mask = Image.new('L', (width, height), 0)
+            if width > 0 and height > 0:
+                ImageDraw.Draw(mask).text(
+                    (-left, -top), character, fill=255, font=self._font, stroke_width=stroke_width, stroke_fill=255
+                )
+                if color[3] < 255:
+                    mask = mask.point(lambda value: value * color[3] // 255)
+            self.glyphs.append((width, height, (color[0], color[1], color[2]), mask.tobytes()))
+            glyph_info = (len(self.glyphs) - 1, int(left), int(top))
+            self._glyph_info[key] = glyph_info
+        return glyph_info
+
+    def layout(self, text, image_size, overlay_location, overlay_text_alignment, overlay_text_valign,
+               overlay_text_halign):
+        """Returns a list of (glyph_index, x, y) placements that draw the text like TimelapseRenderJob.add_overlay."""
+        if isinstance(overlay_location, str):
+            overlay_location = json.loads(overlay_location)
+        x, y = tuple(overlay_location)
+        lines = text.split("\n")
+        line_widths = [sum(self._get_advance(character) for character in line) for line in lines]
+        text_width = max(line_widths)
+        # The outline extends the size of the text block on every side
+        block_width = text_width + 2 * self._outline_width
+        block_height = self._line_height * (len(lines) - 1) + self._get_text_bbox(lines[-1], self._outline_width)[3]
+
+        # valign.
+        if overlay_text_valign == 'middle':
+            y += image_size[1] / 2 - block_height / 2
+        elif overlay_text_valign == 'bottom':
+            y += image_size[1] - block_height
+        elif overlay_text_valign != 'top':
+            raise RenderError('overlay-text-valign',
+                              "An invalid overlay text valign ({0}) was specified.".format(overlay_text_valign))
+        # halign.
+        if overlay_text_halign == 'center':
+            x += image_size[0] / 2 - block_width / 2
+        elif overlay_text_halign == 'right':
+            x += image_size[0] - block_width
+        elif overlay_text_halign != 'left':
+            raise RenderError('overlay-text-halign',
+                              "An invalid overlay text halign ({0}) was specified.".format(overlay_text_halign))
+
+        outlines = []
+        fills = []
+        for line_index, line in enumerate(lines):
+            line_x = x
+            if overlay_text_alignment == 'center':
+                line_x += (text_width - line_widths[line_index]) / 2
+            elif overlay_text_alignment == 'right':
+                line_x += text_width - line_widths[line_index]
+            line_y = int(round(y + line_index * self._line_height))
+            for character in line:
+                if not character.isspace():
+                    if self._outline_width > 0:
+                        glyph_index, left, top = self._get_glyph(character, True)
+                        outlines.append((glyph_index, int(round(line_x)) + left, line_y + top))
+                    glyph_index, left, top = self._get_glyph(character, False)
+                    fills.append((glyph_index, int(round(line_x)) + left, line_y + top))
+                line_x += self._get_advance(character)
+        return outlines + fills
+
+
 class RenderError(Exception):
     def __init__(self, type, message, cause=None):
         super(RenderError, self).__init__()
@@ -491,24 +491,22 @@ class POpenWithTimeoutAsync(object):
 
     def _read_stdout_lines(self, proc):
         try:
-            while proc.returncode is None:
-                line = proc.stdout.readline()
+            # read until the pipe is closed so that no output is lost when the process exits
+            for line in iter(proc.stdout.readline, ''):
                 line = POpenWithTimeoutAsync._read_std_line(line, 'stdout', self.stdout_line_received_callback)
                 if line:
                     self.stdout_lines.append(line)
-                proc.poll()
         except Exception as e:
             logger.exception("An error occurred while reading stdout.")
             raise e
 
     def _read_stderr_lines(self, proc):
         try:
-            while proc.returncode is None:
-                line = proc.stderr.readline()
+            # read until the pipe is closed so that no output is lost when the process exits
+            for line in iter(proc.stderr.readline, ''):
                 line = POpenWithTimeoutAsync._read_std_line(line, 'stderr', self.stderr_line_received_callback)
                 if line:
                     self.stderr_lines.append(line)
-                proc.poll()
         except Exception as e:
             logger.exception("An error occurred while reading stderr.")
             raise e
@@ -538,7 +536,8 @@ class POpenWithTimeoutAsync(object):
         self.timeout_seconds = timeout_seconds
         # Create, start and run the process and fill in stderr and stdout
         def execute_process(args):
-            # get the lock so that we can start the process without encountering a timeout
+            # get the lock so that we can start the process without encountering a timeout.  The lock is only held
+            # while starting the process so that other processes (renderings for example) can run concurrently.
             with self.lock:
                 try:
                     # don't start the process if we've already timed out
@@ -546,16 +545,6 @@ class POpenWithTimeoutAsync(object):
                         self.proc = subprocess.Popen(
                             args, stdout=subprocess.PIPE, stderr=subprocess.PIPE, universal_newlines=True
                         )
-                        # create threads to read stdin and stdout
-                        stdout_reader = threading.Thread(target=self._read_stdout_lines, args=[self.proc])
-                        stdout_reader.daemon = True
-                        stderr_reader = threading.Thread(target=self._read_stderr_lines, args=[self.proc])
-                        stderr_reader.daemon = True
-                        stdout_reader.start()
-                        stderr_reader.start()
-                        self.proc.wait()
-                        stdout_reader.join()
-                        stderr_reader.join()
                     else:
                         logger.error("The '%s' process was completed by the caller before it could be started.", self.name)
                         return
@@ -563,6 +552,16 @@ class POpenWithTimeoutAsync(object):
                     logger.exception("An error occurred while executing '%s'", self.name)
                     self._exception = e
                     return
+            # create threads to read stdin and stdout
+            stdout_reader = threading.Thread(target=self._read_stdout_lines, args=[self.proc])
+            stdout_reader.daemon = True
+            stderr_reader = threading.Thread(target=self._read_stderr_lines, args=[self.proc])
+            stderr_reader.daemon = True
+            stdout_reader.start()
+            stderr_reader.start()
+            self.proc.wait()
+            stdout_reader.join()
+            stderr_reader.join()
 
         thread = threading.Thread(target=execute_process, args=[args])
         thread.daemon = True
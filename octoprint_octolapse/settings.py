@@ -33,7 +33,6 @@ import errno
 from octoprint_octolapse_setuptools import NumberedVersion
 import octoprint_octolapse.utility as utility
 import octoprint_octolapse.log as log
-import math
 # remove python 2 support
 #try:
 #    from collections.abc import Iterable
@@ -790,7 +789,9 @@ class StabilizationPath(Settings):
 
 
 class SnapshotPositionRestrictions(Settings):
-    def __init__(self, restriction_type, shape, x, y, x2=None, y2=None, r=None, calculate_intersections=False):
+    def __init__(
+        self, restriction_type, shape, x, y, x2=None, y2=None, r=None, calculate_intersections=False, points=None
+    ):
 
         self.Type = restriction_type.lower()
         if self.Type not in ["forbidden", "required"]:
@@ -798,9 +799,9 @@ class SnapshotPositionRestrictions(Settings):
 
         self.Shape = shape.lower()
 
-        if self.Shape not in ["rect", "circle"]:
-            raise TypeError("SnapshotPosition shape must be 'rect' or 'circle'")
-        if x is None or y is None:
+        if self.Shape not in ["rect", "circle", "polygon"]:
+            raise TypeError("SnapshotPosition shape must be 'rect', 'circle' or 'polygon'")
+        if self.Shape != 'polygon' and (x is None or y is None):
             raise TypeError(
                 "SnapshotPosition requires that x and y are not None")
         if self.Shape == 'rect' and (x2 is None or y2 is None):
@@ -809,15 +810,19 @@ class SnapshotPositionRestrictions(Settings):
         if self.Shape == 'circle' and r is None:
             raise TypeError(
                 "SnapshotPosition shape=circle requires that r is not None")
+        if self.Shape == 'polygon' and (points is None or len(points) < 3):
+            raise TypeError(
+                "SnapshotPosition shape=polygon requires at least 3 points")
 
         self.type = restriction_type
         self.shape = shape
-        self.x = float(x)
-        self.y = float(y)
-        self.x2 = float(x2)
-        self.y2 = float(y2)
-        self.r = float(r)
+        self.x = None if x is None else float(x)
+        self.y = None if y is None else float(y)
+        self.x2 = None if x2 is None else float(x2)
+        self.y2 = None if y2 is None else float(y2)
+        self.r = None if r is None else float(r)
         self.calculate_intersections = calculate_intersections
+        self.points = None if points is None else [[float(point[0]), float(point[1])] for point in points]
 
     def to_dict(self):
         return {
@@ -828,41 +833,23 @@ class SnapshotPositionRestrictions(Settings):
             'x2': self.x2,
             'y2': self.y2,
             'r': self.r,
-            'calculate_intersections': self.calculate_intersections
+            'calculate_intersections': self.calculate_intersections,
+            'points': self.points
         }
 
-    def get_intersections(self, x, y, previous_x, previous_y):
-        if not self.calculate_intersections:
-            return False
-
-        if x is None or y is None or previous_x is None or previous_y is None:
-            return False
-
-        if self.Shape == 'rect':
-            intersections = utility.get_intersections_rectangle(previous_x, previous_y, x, y, self.x, self.y, self.x2,
-                                                                self.y2)
-        elif self.Shape == 'circle':
-            intersections = utility.get_intersections_circle(previous_x, previous_y, x, y, self.x, self.y, self.r)
-        else:
-            raise TypeError("SnapshotPosition shape must be 'rect' or 'circle'.")
-
-        if not intersections:
-            return False
-
-        return intersections
-
-    def is_in_position(self, x, y, tolerance):
-        if x is None or y is None:
-            return False
-
-        if self.Shape == 'rect':
-            return self.x <= x <= self.x2 and self.y <= y <= self.y2
-        elif self.Shape == 'circle':
-            lsq = math.pow(x - self.x, 2) + math.pow(y - self.y, 2)
-            rsq = math.pow(self.r, 2)
-            return utility.is_close(lsq, rsq, tolerance) or lsq < rsq
-        else:
-            raise TypeError("SnapshotPosition shape must be 'rect' or 'circle'.")
+    def to_position_restriction_args(self):
+        # The native position processor calculates is_in_position and in_path_position from these args
+        return {
+            'type': self.Type,
+            'shape': self.Shape,
+            'x': self.x,
+            'y': self.y,
+            'x2': self.x2,
+            'y2': self.y2,
+            'r': self.r,
+            'calculate_intersections': self.calculate_intersections,
+            'points': self.points
+        }
 
 
 class StabilizationProfile(AutomaticConfigurationProfile):
@@ -1001,6 +988,8 @@ class TriggerProfile(AutomaticConfigurationProfile):
         self.smart_layer_snap_to_print_high_quality = False
         self.smart_layer_snap_to_print_smooth = False
         self.smart_layer_disable_z_lift = True
+        # 0 to disable, else the maximum distance between an arc and the chords between the sampled arc points
+        self.smart_layer_arc_chord_tolerance = 0.0
 
         # Settings that were formerly in the snapshot profile (now removed)
         self.is_default = False
@@ -1117,7 +1106,8 @@ class TriggerProfile(AutomaticConfigurationProfile):
                         restriction["x2"],
                         restriction["y2"],
                         restriction["r"],
-                        restriction["calculate_intersections"]
+                        restriction["calculate_intersections"],
+                        restriction.get("points")
                     )
                 )
             except KeyError as e:
@@ -1171,6 +1161,8 @@ class RenderingProfile(AutomaticConfigurationProfile):
         self.overlay_outline_color = [0, 0, 0, 1.0]
         self.overlay_outline_width = 1
         self.thread_count = 1
+        # Measure and remove the small shifts between snapshots before encoding
+        self.enable_frame_alignment = False
         # Snapshot Cleanup
         self.archive_snapshots = False
 
@@ -1670,6 +1662,14 @@ class MainSettings(Settings):
         self.timelapse_directory = ""
         self.temporary_directory = ""
         self.test_mode_enabled = False
+        # The number of cpu cores shared by all renderings.  0 uses every core.
+        self.rendering_core_budget = 0
+        # The memory in MB shared by all renderings.  0 uses the available memory.
+        self.rendering_memory_budget_mb = 0
+        # Send preprocessing to the shared preprocessing service when it is running on this computer.
+        self.preprocessing_service_enabled = False
+        # The preprocessing service's socket.  Leave empty to use the default socket.
+        self.preprocessing_service_socket_path = ""
 
     def get_snapshot_archive_directory(self, data_folder):
         directory = self.snapshot_archive_directory.strip()
@@ -1689,6 +1689,12 @@ class MainSettings(Settings):
             return self.temporary_directory
         return os.path.join(data_folder, 'tmp')
 
+    def get_preprocessing_service_socket_path(self):
+        socket_path = self.preprocessing_service_socket_path.strip()
+        if len(socket_path) > 0:
+            return socket_path
+        return utility.get_default_preprocessing_service_socket_path()
+
     def test_directories(self, data_folder, octoprint_timelapse_directory):
         errors = []
         snapshot_archive_directory = self.get_snapshot_archive_directory(data_folder)
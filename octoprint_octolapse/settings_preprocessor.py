@@ -27,6 +27,7 @@ import time
 import datetime
 from file_read_backwards import FileReadBackwards
 import re
+import GcodePositionProcessor
 # remove unused usings
 # import six
 # import string
@@ -79,14 +80,17 @@ class GcodeFileProcessor(object):
         if len(filtered_processors) == 0:
             return None
 
-        # create a list of forward, reverse and full processors
-        forward_processors = [x for x in filtered_processors if x.file_process_type in [u'forward', u'both']]
-        reverse_processors = [x for x in filtered_processors if x.file_process_type in [u'reverse', u'both']]
+        complete = self.process_native(filtered_processors, target_file_path)
+        if complete is None:
+            # The native extractor could not read the file, so read it line by line instead.
+            # create a list of forward, reverse and full processors
+            forward_processors = [x for x in filtered_processors if x.file_process_type in [u'forward', u'both']]
+            reverse_processors = [x for x in filtered_processors if x.file_process_type in [u'reverse', u'both']]
 
-        # process any forward items
-        complete = self.process_forwards(forward_processors, target_file_path)
-        if not complete:
-            complete = self.process_reverse(reverse_processors, target_file_path)
+            # process any forward items
+            complete = self.process_forwards(forward_processors, target_file_path)
+            if not complete:
+                complete = self.process_reverse(reverse_processors, target_file_path)
 
         self.end_time = time.time()
         if complete:
@@ -96,6 +100,36 @@ class GcodeFileProcessor(object):
         self.notify_progress(end_progress=True)
         return self.get_processor_results()
 
+    def process_native(self, processors, target_file_path):
+        # Scan the start and end of the file natively, which only reads the search windows.  Returns None if the
+        # file could not be read.
+        settings_formats = [processor.get_native_settings_format() for processor in processors]
+        try:
+            results = GcodePositionProcessor.ExtractSlicerSettings(target_file_path, settings_formats)
+        except Exception as e:
+            logger.exception("Unable to extract the slicer settings natively.")
+            return None
+        if results is None:
+            return None
+        self.current_file_position = self.file_size_bytes
+
+        # Process the other matching lines first, since they are used to detect the slicer type
+        for processor in processors:
+            for line in results[processor.name][u'lines']:
+                processor.process_line(line, 0, u'native')
+        detected_processors = [x for x in processors if x.is_slicer_type_detected]
+        if len(detected_processors) > 0:
+            # ignore the settings matched by the other processors
+            processors = detected_processors[:1]
+
+        for processor in processors:
+            for key, val in results[processor.name][u'settings']:
+                processor.process_setting(key, val)
+        for processor in processors:
+            if processor.is_complete():
+                return True
+        return False
+
     def process_forwards(self, processors, target_file_path):
         # open the file for streaming
         line_number = 0
@@ -240,6 +274,12 @@ class GcodeProcessor(object):
 
 
 class GcodeSettingsProcessor(GcodeProcessor):
+    # The format of the general_setting regex and the prefixes of the lines matched by the other regexes, which
+    # are used by the native settings extractor.  See get_native_settings_format.
+    native_setting_prefix = u'; '
+    native_setting_separator = u' = '
+    native_key_excluded_characters = u','
+    native_line_prefixes = []
 
     def __init__(self, name, file_procdss_type, max_forward_lines_to_process, max_reverse_lines_to_process):
         super(GcodeSettingsProcessor, self).__init__(name, u'settings_processor')
@@ -303,6 +343,22 @@ class GcodeSettingsProcessor(GcodeProcessor):
     def can_process(self):
         return len(self.active_settings_dictionary) > 0
 
+    def get_native_settings_format(self):
+        return {
+            u'name': self.name,
+            u'setting_prefix': self.native_setting_prefix,
+            u'setting_separator': self.native_setting_separator,
+            u'key_excluded_characters': self.native_key_excluded_characters,
+            u'keys': list(self.active_settings_dictionary.keys()),
+            u'line_prefixes': self.native_line_prefixes,
+            u'max_forward_lines': (
+                self.max_forward_lines_to_process if self.file_process_type in [u'forward', u'both'] else 0
+            ),
+            u'max_reverse_lines': (
+                self.max_reverse_lines_to_process if self.file_process_type in [u'reverse', u'both'] else 0
+            ),
+        }
+
     def is_complete(self):
         return (
             len(self.active_settings_dictionary) == 0
@@ -350,6 +406,9 @@ class GcodeSettingsProcessor(GcodeProcessor):
     def default_matching_function(self, matches):
         # get the key value pair
         key, val = matches.group(u"key", u"val")
+        self.process_setting(key, val)
+
+    def process_setting(self, key, val):
         # see if the key matches an active setting
         if key in self.active_settings_dictionary:
             settings_definition = self.active_settings_dictionary[key]
@@ -752,6 +811,8 @@ class RegexDefinition(object):
 # Extends GcodeProcessor
 #############################################
 class Slic3rSettingsProcessor(GcodeSettingsProcessor):
+    native_line_prefixes = [u'; generated by ']
+
     def __init__(self, search_direction=u"both", max_forward_search=50, max_reverse_search=263):
         super(Slic3rSettingsProcessor, self).__init__(u'slic3r-pe', search_direction, max_forward_search, max_reverse_search)
 
@@ -984,6 +1045,15 @@ class Slic3rSettingsProcessor(GcodeSettingsProcessor):
 
 
 class Simplify3dSettingsProcessor(GcodeSettingsProcessor):
+    native_setting_prefix = u';   '
+    native_setting_separator = u','
+    native_key_excluded_characters = u''
+    native_line_prefixes = [
+        u';   printerModelsOverride', u'; G-Code generated by Simplify3D(R) Version ',
+        u'; Jan ', u'; Feb ', u'; Mar ', u'; Apr ', u'; May ', u'; Jun ',
+        u'; Jul ', u'; Aug ', u'; Sep ', u'; Oct ', u'; Nov ', u'; Dec '
+    ]
+
     def __init__(self, search_direction="forward", max_forward_search=295, max_reverse_search=0):
         super(Simplify3dSettingsProcessor, self).__init__(u'simplify-3d', search_direction, max_forward_search, max_reverse_search)
 
@@ -1232,6 +1302,8 @@ class Simplify3dSettingsProcessor(GcodeSettingsProcessor):
 
 
 class CuraSettingsProcessor(GcodeSettingsProcessor):
+    native_line_prefixes = [u';Generated with Cura_SteamEngine ', u';Filament used: ', u';FLAVOR:', u';Layer height: ']
+
     def __init__(self, search_direction="both", max_forward_search=550, max_reverse_search=550):
         super(CuraSettingsProcessor, self).__init__(u'cura', search_direction, max_forward_search, max_reverse_search)
 
@@ -39,6 +39,7 @@ from uuid import uuid4
 from time import time
 from PIL import Image
 import errno
+import GcodePositionProcessor
 # create the module level logger
 import octoprint_octolapse.camera as camera
 import octoprint_octolapse.utility as utility
@@ -54,7 +55,7 @@ class SnapshotMetadata(object):
     METADATA_FILE_NAME = 'metadata.csv'
     METADATA_FIELDS = [
         'snapshot_number', 'file_name', 'time_taken', 'layer', 'height', 'x', 'y', 'z', 'e', 'f',
-        'x_snapshot', 'y_snapshot'
+        'x_snapshot', 'y_snapshot', 'offset_x', 'offset_y'
     ]
 
     @staticmethod
@@ -440,6 +441,13 @@ class ImagePostProcessing(object):
                     transpose_method = Image.TRANSPOSE
 
                 if transpose_method is not None:
+                    # Try to transform the JPEG losslessly without decoding it first.  This fails for some
+                    # transforms when the image size isn't a multiple of the JPEG block size, so fall back to PIL.
+                    if (
+                        hasattr(GcodePositionProcessor, "TransformJpeg") and
+                        GcodePositionProcessor.TransformJpeg(snapshot_full_path, transpose_setting)
+                    ):
+                        return
                     with Image.open(snapshot_full_path) as img:
                         img = img.transpose(transpose_method)
                         img.save(snapshot_full_path)
@@ -469,16 +477,23 @@ class ImagePostProcessing(object):
 
             # create a thumbnail of the image
             basewidth = 500
-            with Image.open(latest_snapshot_path) as img:
+            thumbnail_path = utility.get_latest_snapshot_thumbnail_download_path(
+                self.snapshot_job_info.temporary_directory, self.snapshot_job_info.camera.guid
+            )
+            # Decoding the JPEG at a reduced scale is much faster than decoding it at full size and then resizing.
+            decoded = None
+            if hasattr(GcodePositionProcessor, "DecodeJpegScaled"):
+                decoded = GcodePositionProcessor.DecodeJpegScaled(latest_snapshot_path, basewidth, 1)
+            if decoded is not None:
+                width, height, pixels = decoded
+                img = Image.frombytes("RGB", (width, height), pixels)
+            else:
+                img = Image.open(latest_snapshot_path)
+            with img:
                 wpercent = (basewidth / float(img.size[0]))
                 hsize = int((float(img.size[1]) * float(wpercent)))
                 img.thumbnail([basewidth, hsize], Image.ANTIALIAS)
-                img.save(
-                    utility.get_latest_snapshot_thumbnail_download_path(
-                        self.snapshot_job_info.temporary_directory, self.snapshot_job_info.camera.guid
-                    ),
-                    "JPEG"
-                )
+                img.save(thumbnail_path, "JPEG")
         except Exception as e:
             logger.exception("An unexpected exception occurred while creating a snapshot thumbnail for "
                              "the %s camera.", self.snapshot_job_info.camera.name)
@@ -79,6 +79,16 @@ class SnapshotGcode(object):
     def snapshot_index(self):
         return len(self.InitializationGcode) + len(self.StartGcode) + len(self.snapshot_commands) - 1
 
+    @classmethod
+    def create_from_cpp_snapshot_gcode(cls, cpp_snapshot_gcode):
+        snapshot_gcode = SnapshotGcode()
+        snapshot_gcode.InitializationGcode = list(cpp_snapshot_gcode[0])
+        snapshot_gcode.StartGcode = list(cpp_snapshot_gcode[1])
+        snapshot_gcode.snapshot_commands = list(cpp_snapshot_gcode[2])
+        snapshot_gcode.ReturnCommands = list(cpp_snapshot_gcode[3])
+        snapshot_gcode.EndGcode = list(cpp_snapshot_gcode[4])
+        return snapshot_gcode
+
     def __str__(self):
         gcode_format_string = "{0:14} - {1}"
         gcode_strings = []
@@ -141,7 +151,8 @@ class SnapshotPlan(utility.JsonSerializable):
                  initial_position=None,
                  steps=None,
                  return_position=None,
-                 end_command=None):
+                 end_command=None,
+                 snapshot_gcode=None):
         self.travel_distance = travel_distance
         self.saved_travel_distance = saved_travel_distance
         self.file_line_number = file_line_number
@@ -156,6 +167,8 @@ class SnapshotPlan(utility.JsonSerializable):
             self.steps = []
         self.start_command = start_command
         self.end_command = end_command
+        # The final snapshot gcode, if it was created during preprocessing
+        self.snapshot_gcode = snapshot_gcode
 
     SNAPSHOT_ACTION = "snapshot"
 
@@ -240,6 +253,10 @@ class SnapshotPlan(utility.JsonSerializable):
                     steps.append(SnapshotPlanStep(action, x, y, z, e, f))
                 return_position = None if cpp_plan[9] is None else Pos.create_from_cpp_pos(cpp_plan[9])
                 end_command = None if cpp_plan[10] is None else ParsedCommand.create_from_cpp_parsed_command(cpp_plan[10])
+                snapshot_gcode = (
+                    None if len(cpp_plan) < 12 or cpp_plan[11] is None
+                    else SnapshotGcode.create_from_cpp_snapshot_gcode(cpp_plan[11])
+                )
                 snapshot_plan = SnapshotPlan(
                     file_line_number,
                     file_gcode_number,
@@ -251,7 +268,8 @@ class SnapshotPlan(utility.JsonSerializable):
                     initial_position,
                     steps,
                     return_position,
-                    end_command)
+                    end_command,
+                    snapshot_gcode)
                 snapshot_plans.append(snapshot_plan)
                 logger.verbose("Plan %d: %s", plan_number, snapshot_plan)
                 plan_number += 1
@@ -262,16 +280,141 @@ class SnapshotPlan(utility.JsonSerializable):
 
 
 
-class SnapshotGcodeGenerator(object):
+class SnapshotPositionGenerator(object):
+    # Walks the stabilization paths to find the snapshot position.  This only needs the paths and the printer
+    # volume, so the preprocessing service can create one without the rest of the settings.
+    def __init__(self, stabilization_paths, overridable_printer_profile_settings):
+        self.StabilizationPaths = stabilization_paths
+        self.overridable_printer_profile_settings = overridable_printer_profile_settings
+
+    def get_snapshot_position(self, x_pos, y_pos):
+        x_path = self.StabilizationPaths["x"]
+        x_path.current_position = x_pos
+        y_path = self.StabilizationPaths["y"]
+        y_path.current_position = y_pos
+
+        coordinates = dict(x=self.get_snapshot_coordinate(x_path, "x"),
+                           y=self.get_snapshot_coordinate(y_path, "y"))
+
+        return self.get_nearest_in_bounds_coordinate(coordinates)
+
+    def get_nearest_in_bounds_coordinate(self, coordinates):
+        volume = self.overridable_printer_profile_settings["volume"]
+        x = coordinates["x"]
+        y = coordinates["y"]
+        bed_type = volume["bed_type"]
+        min_x = volume["min_x"]
+        max_x = volume["max_x"]
+        min_y = volume["min_y"]
+        max_y = volume["max_y"]
+        if bed_type == "circular":
+            # get the radius of the bed (either max_x or max_y)
+            r = max_x
+            # calculate the distance from the center of the bed
+            d = math.sqrt(x*x + y*y)
+            # if D is greater than the radius (max_x or max_y), we are outside the circle
+            if utility.greater_than(d, r):
+                x = x / d * r
+                y = y / d * r
+        else:
+            def clamp(v, v_min, v_max):
+                """Limits a value to lie between (or equal to) v_min and v_max."""
+                return None if v is None else min(max(v, v_min), v_max)
+            x = clamp(x, min_x, max_x)
+            y = clamp(y, min_y, max_y)
+
+        coordinates["x"] = x
+        coordinates["y"] = y
+        return coordinates
+
+    def get_snapshot_coordinate(self, path, axis):
+        if path.type == 'disabled':
+            return path.current_position
+
+        # Get the current coordinate from the path
+        coord = path.path[path.index]
+        # move our index forward or backward
+        path.index += path.increment
+
+        if path.index >= len(path.path):
+            if path.loop:
+                if path.invert_loop:
+                    if len(path.path) > 1:
+                        path.index = len(path.path) - 2
+                    else:
+                        path.index = 0
+                    path.increment = -1
+                else:
+                    path.index = 0
+            else:
+                path.index = len(path.path) - 1
+        elif path.index < 0:
+            if path.loop:
+                if path.invert_loop:
+                    if len(path.path) > 1:
+                        path.index = 1
+                    else:
+                        path.index = 0
+                    path.increment = 1
+                else:
+                    path.index = len(path.path) - 1
+            else:
+                path.index = 0
+
+        if path.coordinate_system == "absolute":
+            return coord
+        elif path.coordinate_system == "bed_relative":
+            return self.get_bed_relative_coordinate(axis, coord)
+
+    def get_bed_relative_coordinate(self, axis, coord):
+        rel_coordinate = None
+        volume = self.overridable_printer_profile_settings["volume"]
+        if axis == "x":
+            rel_coordinate = self.get_bed_relative_x(coord, volume)
+        elif axis == "y":
+            rel_coordinate = self.get_bed_relative_y(coord, volume)
+        elif axis == "Z":
+            rel_coordinate = self.get_bed_relative_z(coord, volume)
+
+        return rel_coordinate
+
+    def get_bed_relative_x(self, percent, volume):
+        min_value = volume["min_x"]
+        max_value = volume["max_x"]
+        origin_type = volume["origin_type"]
+        return self.get_relative_coordinate(percent, min_value, max_value, origin_type)
+
+    def get_bed_relative_y(self, percent, volume):
+        min_value = volume["min_y"]
+        max_value = volume["max_y"]
+        origin_type = volume["origin_type"]
+        return self.get_relative_coordinate(percent, min_value, max_value, origin_type)
+
+    def get_bed_relative_z(self, percent, volume):
+        min_value = volume["min_z"]
+        max_value = volume["max_z"]
+        origin_type = volume["origin_type"]
+        return self.get_relative_coordinate(percent, min_value, max_value, origin_type)
+
+    @staticmethod
+    def get_relative_coordinate(percent, min_value, max_value, origin_type):
+        if origin_type == PrinterProfile.origin_type_center:
+            return ((float(max_value) - float(min_value)) * (percent / 100.0)) - \
+                   (float(max_value) - float(min_value))/2.0
+        return ((float(max_value) - float(min_value)) * (percent / 100.0)) + float(min_value)
+
+
+class SnapshotGcodeGenerator(SnapshotPositionGenerator):
     CurrentXPathIndex = 0
     CurrentYPathIndex = 0
 
     def __init__(self, octolapse_settings, overridable_printer_profile_settings):
         self.Settings = octolapse_settings  # type: OctolapseSettings
         self._stabilization = self.Settings.profiles.current_stabilization()
-        self.StabilizationPaths = self._stabilization.get_stabilization_paths()
+        super(SnapshotGcodeGenerator, self).__init__(
+            self._stabilization.get_stabilization_paths(), overridable_printer_profile_settings
+        )
         self.Printer = self.Settings.profiles.current_printer()
-        self.overridable_printer_profile_settings = overridable_printer_profile_settings
         self.gcode_generation_settings = self.Printer.get_current_state_detection_settings()
         # assert(isinstance(self.gcode_generation_settings, OctolapseGcodeSettings))
         # this will be determined by the supplied position object
@@ -317,6 +460,35 @@ class SnapshotGcodeGenerator(object):
         self.last_extrusion_height = None
         self.snapshot_plan = None
 
+    def get_snapshot_gcode_args(self, options=None):
+        # Creates the arguments required to generate snapshot gcode within the GcodePositionProcessor while
+        # preprocessing.  If None is returned, the snapshot gcode will be generated while printing.
+        if self.gcode_generation_settings is None:
+            return None
+        extruders = []
+        for extruder in self.gcode_generation_settings.extruders:
+            extruders.append({
+                "retract_before_move": bool(extruder.retract_before_move),
+                "retraction_length": extruder.retraction_length,
+                "retraction_speed": extruder.retraction_speed,
+                "deretraction_speed": extruder.deretraction_speed,
+                "lift_when_retracted": bool(extruder.lift_when_retracted),
+                "z_lift_height": extruder.z_lift_height,
+                "x_y_travel_speed": extruder.x_y_travel_speed,
+                "z_lift_speed": extruder.z_lift_speed,
+            })
+        return {
+            "axis_mode_compatibility": bool(self.axis_mode_compatibility),
+            "wait_for_moves_to_finish": bool(self._stabilization.wait_for_moves_to_finish),
+            "disable_z_lift": bool(
+                options is not None and "disable_z_lift" in options and options["disable_z_lift"]
+            ),
+            "snapshot_command": "{0} {1}".format(
+                PrinterProfile.OCTOLAPSE_COMMAND, PrinterProfile.DEFAULT_OCTOLAPSE_SNAPSHOT_COMMAND
+            ),
+            "extruders": extruders,
+        }
+
     def initialize_for_snapshot_plan_processing(
         self, snapshot_plan, g90_influences_extruder, options=None
     ):
@@ -394,122 +566,6 @@ class SnapshotGcodeGenerator(object):
 
         return False
 
-    def get_snapshot_position(self, x_pos, y_pos):
-        x_path = self.StabilizationPaths["x"]
-        x_path.current_position = x_pos
-        y_path = self.StabilizationPaths["y"]
-        y_path.current_position = y_pos
-
-        coordinates = dict(x=self.get_snapshot_coordinate(x_path, "x"),
-                           y=self.get_snapshot_coordinate(y_path, "y"))
-
-        return self.get_nearest_in_bounds_coordinate(coordinates)
-
-    def get_nearest_in_bounds_coordinate(self, coordinates):
-        volume = self.overridable_printer_profile_settings["volume"]
-        x = coordinates["x"]
-        y = coordinates["y"]
-        bed_type = volume["bed_type"]
-        min_x = volume["min_x"]
-        max_x = volume["max_x"]
-        min_y = volume["min_y"]
-        max_y = volume["max_y"]
-        if bed_type == "circular":
-            # get the radius of the bed (either max_x or max_y)
-            r = max_x
-            # calculate the distance from the center of the bed
-            d = math.sqrt(x*x + y*y)
-            # if D is greater than the radius (max_x or max_y), we are outside the circle
-            if utility.greater_than(d, r):
-                x = x / d * r
-                y = y / d * r
-        else:
-            def clamp(v, v_min, v_max):
-                """Limits a value to lie between (or equal to) v_min and v_max."""
-                return None if v is None else min(max(v, v_min), v_max)
-            x = clamp(x, min_x, max_x)
-            y = clamp(y, min_y, max_y)
-
-        coordinates["x"] = x
-        coordinates["y"] = y
-        return coordinates
-
-    def get_snapshot_coordinate(self, path, axis):
-        if path.type == 'disabled':
-            return path.current_position
-
-        # Get the current coordinate from the path
-        coord = path.path[path.index]
-        # move our index forward or backward
-        path.index += path.increment
-
-        if path.index >= len(path.path):
-            if path.loop:
-                if path.invert_loop:
-                    if len(path.path) > 1:
-                        path.index = len(path.path) - 2
-                    else:
-                        path.index = 0
-                    path.increment = -1
-                else:
-                    path.index = 0
-            else:
-                path.index = len(path.path) - 1
-        elif path.index < 0:
-            if path.loop:
-                if path.invert_loop:
-                    if len(path.path) > 1:
-                        path.index = 1
-                    else:
-                        path.index = 0
-                    path.increment = 1
-                else:
-                    path.index = len(path.path) - 1
-            else:
-                path.index = 0
-
-        if path.coordinate_system == "absolute":
-            return coord
-        elif path.coordinate_system == "bed_relative":
-            return self.get_bed_relative_coordinate(axis, coord)
-
-    def get_bed_relative_coordinate(self, axis, coord):
-        rel_coordinate = None
-        volume = self.overridable_printer_profile_settings["volume"]
-        if axis == "x":
-            rel_coordinate = self.get_bed_relative_x(coord, volume)
-        elif axis == "y":
-            rel_coordinate = self.get_bed_relative_y(coord, volume)
-        elif axis == "Z":
-            rel_coordinate = self.get_bed_relative_z(coord, volume)
-
-        return rel_coordinate
-
-    def get_bed_relative_x(self, percent, volume):
-        min_value = volume["min_x"]
-        max_value = volume["max_x"]
-        origin_type = volume["origin_type"]
-        return self.get_relative_coordinate(percent, min_value, max_value, origin_type)
-
-    def get_bed_relative_y(self, percent, volume):
-        min_value = volume["min_y"]
-        max_value = volume["max_y"]
-        origin_type = volume["origin_type"]
-        return self.get_relative_coordinate(percent, min_value, max_value, origin_type)
-
-    def get_bed_relative_z(self, percent, volume):
-        min_value = volume["min_z"]
-        max_value = volume["max_z"]
-        origin_type = volume["origin_type"]
-        return self.get_relative_coordinate(percent, min_value, max_value, origin_type)
-
-    @staticmethod
-    def get_relative_coordinate(percent, min_value, max_value, origin_type):
-        if origin_type == PrinterProfile.origin_type_center:
-            return ((float(max_value) - float(min_value)) * (percent / 100.0)) - \
-                   (float(max_value) - float(min_value))/2.0
-        return ((float(max_value) - float(min_value)) * (percent / 100.0)) + float(min_value)
-
     def set_e_to_relative(self, gcode_type):
         if not self.is_extruder_relative_current:
             self.snapshot_gcode.append(
@@ -29,6 +29,7 @@ from octoprint_octolapse.stabilization_gcode import SnapshotPlan, SnapshotGcodeG
 from octoprint_octolapse.settings import PrinterProfile, TriggerProfile, StabilizationProfile
 import GcodePositionProcessor
 import octoprint_octolapse.error_messages as error_messages
+import octoprint_octolapse.preprocessing_service as preprocessing_service
 # create the module level logger
 from octoprint_octolapse.log import LoggingConfigurator
 logging_configurator = LoggingConfigurator()
@@ -86,6 +87,12 @@ class StabilizationPreprocessingThread(Thread):
         self.gcodes_processed = 0
         self.lines_processed = 0
         self.cpp_position_args = printer.get_position_args(timelapse_settings["overridable_printer_profile_settings"])
+        main_settings = timelapse_settings["settings"].main_settings
+        self.preprocessing_service_client = None
+        if main_settings.preprocessing_service_enabled:
+            self.preprocessing_service_client = preprocessing_service.PreprocessingServiceClient(
+                main_settings.get_preprocessing_service_socket_path()
+            )
 
         logger.debug(
             "Pre-Processing thread is constructed."
@@ -206,6 +213,9 @@ class StabilizationPreprocessingThread(Thread):
             'on_progress_received': self.on_progress_received,
             'file_path': self.timelapse_settings["gcode_file_path"],
             'gcode_generator': self.gcode_generator,
+            'snapshot_gcode_args': self.gcode_generator.get_snapshot_gcode_args(
+                self.trigger_profile.get_snapshot_plan_options()
+            ),
             "x_stabilization_disabled": (
                 self.stabilization_profile.x_type == StabilizationProfile.STABILIZATION_AXIS_TYPE_DISABLED
             ),
@@ -252,10 +262,11 @@ class StabilizationPreprocessingThread(Thread):
             smart_layer_args = {
                 'trigger_type': int(self.trigger_profile.smart_layer_trigger_type),
                 'snap_to_print_high_quality': self.trigger_profile.smart_layer_snap_to_print_high_quality,
-                'snap_to_print_smooth': self.trigger_profile.smart_layer_snap_to_print_smooth
+                'snap_to_print_smooth': self.trigger_profile.smart_layer_snap_to_print_smooth,
+                'arc_chord_tolerance': float(self.trigger_profile.smart_layer_arc_chord_tolerance)
             }
-            ret_val = list(GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
-                self.cpp_position_args,
+            ret_val = list(self._get_snapshot_plans(
+                preprocessing_service.TRIGGER_TYPE_SMART_LAYER,
                 stabilization_args,
                 smart_layer_args
             ))
@@ -274,8 +285,8 @@ class StabilizationPreprocessingThread(Thread):
             smart_gcode_args = {
                 'snapshot_command': self.printer_profile.snapshot_command,
             }
-            ret_val = list(GcodePositionProcessor.GetSnapshotPlans_SmartGcode(
-                self.cpp_position_args,
+            ret_val = list(self._get_snapshot_plans(
+                preprocessing_service.TRIGGER_TYPE_SMART_GCODE,
                 stabilization_args,
                 smart_gcode_args
             ))
@@ -308,6 +319,25 @@ class StabilizationPreprocessingThread(Thread):
 
         return results, options
 
+    def _get_snapshot_plans(self, trigger_type, stabilization_args, trigger_args):
+        # Use the shared preprocessing service if it is enabled and running, else preprocess in-process
+        if self.preprocessing_service_client is not None:
+            ret_val = self.preprocessing_service_client.get_snapshot_plans(
+                trigger_type,
+                self.cpp_position_args,
+                stabilization_args,
+                trigger_args,
+                self.gcode_generator.StabilizationPaths
+            )
+            if ret_val is not None:
+                return ret_val
+            logger.info("The preprocessing service is not available, preprocessing in-process.")
+        if trigger_type == preprocessing_service.TRIGGER_TYPE_SMART_LAYER:
+            get_snapshot_plans = GcodePositionProcessor.GetSnapshotPlans_SmartLayer
+        else:
+            get_snapshot_plans = GcodePositionProcessor.GetSnapshotPlans_SmartGcode
+        return get_snapshot_plans(self.cpp_position_args, stabilization_args, trigger_args)
+
     def on_progress_received(self, percent_progress, seconds_elapsed, seconds_to_complete, gcodes_processed,
                              lines_processed):
         try:
@@ -328,3 +358,67 @@ class StabilizationPreprocessingThread(Thread):
 
 
 
+
+
+class BatchPreprocessingJob(object):
+    # One file for StabilizationBatchPreprocessingThread.  The arguments are the same ones GetSnapshotPlans_SmartLayer
+    # and GetSnapshotPlans_SmartGcode take.  on_progress_received may be left out of the stabilization args.
+    def __init__(self, stabilization_type, position_args, stabilization_args, stabilization_type_args, tag=None):
+        self.stabilization_type = stabilization_type
+        self.position_args = position_args
+        self.stabilization_args = stabilization_args
+        self.stabilization_type_args = stabilization_type_args
+        # anything the caller wants back with the results, like a print job id
+        self.tag = tag
+
+
+class StabilizationBatchPreprocessingThread(Thread):
+    # Preprocesses a list of files on the native thread pool, largest first.  As each file finishes a
+    # (job, results) tuple is put on the completion queue, where results are the values returned by
+    # GetSnapshotPlans_*, and None is put on the queue once the batch is done.
+    def __init__(self, jobs, completion_queue, num_threads=0):
+        super(StabilizationBatchPreprocessingThread, self).__init__()
+        self.daemon = True
+        self.jobs = jobs
+        self.completion_queue = completion_queue
+        self.num_threads = num_threads
+        self.jobs_processed = 0
+        self._is_cancelled = False
+
+    def cancel(self):
+        # Files that are being preprocessed stop at their next progress notification.  The rest are skipped.
+        self._is_cancelled = True
+
+    def run(self):
+        batch_jobs = []
+        for job in self.jobs:
+            stabilization_args = dict(job.stabilization_args)
+            on_progress_received = stabilization_args.get("on_progress_received")
+            stabilization_args["on_progress_received"] = self._create_progress_callback(on_progress_received)
+            batch_jobs.append({
+                "stabilization_type": job.stabilization_type,
+                "position_args": job.position_args,
+                "stabilization_args": stabilization_args,
+                "stabilization_type_args": job.stabilization_type_args,
+            })
+        try:
+            logger.info("Preprocessing a batch of %d files.", len(batch_jobs))
+            self.jobs_processed = GcodePositionProcessor.GetSnapshotPlansBatch(
+                batch_jobs, {"num_threads": self.num_threads}, self._on_job_complete
+            )
+            logger.info("Preprocessed %d of %d files in the batch.", self.jobs_processed, len(batch_jobs))
+        except Exception as e:
+            logger.exception("An error occurred while preprocessing a batch of files.")
+        finally:
+            self.completion_queue.put(None)
+
+    def _create_progress_callback(self, on_progress_received):
+        def progress_callback(*progress):
+            if on_progress_received is not None and not on_progress_received(*progress):
+                return False
+            return not self._is_cancelled
+        return progress_callback
+
+    def _on_job_complete(self, job_index, results):
+        self.completion_queue.put((self.jobs[job_index], results))
+        return not self._is_cancelled
@@ -27,6 +27,7 @@ $(function () {
         "preparing": "Preparing",
         "pre_render_script": "Script - Before",
         "adding_overlays": "Adding Overlays",
+        "aligning": "Aligning Frames",
         "rename_images": "Renaming Images",
         'pre_post_roll': "Pre/Post Roll",
         "rendering": "Rendering",
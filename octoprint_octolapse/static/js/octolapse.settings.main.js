@@ -45,6 +45,10 @@ $(function () {
         self.timelapse_directory = ko.observable();
         self.temporary_directory = ko.observable();
         self.test_mode_enabled = ko.observable();
+        self.rendering_core_budget = ko.observable();
+        self.rendering_memory_budget_mb = ko.observable();
+        self.preprocessing_service_enabled = ko.observable();
+        self.preprocessing_service_socket_path = ko.observable();
         // rename this so that it never gets updated when saved
         self.octolapse_version = ko.observable("unknown");
         self.settings_version = ko.observable("unknown");
@@ -92,6 +96,10 @@ $(function () {
             self.temporary_directory(settings.temporary_directory);
             self.settings_version(settings.settings_version);
             self.test_mode_enabled(settings.test_mode_enabled);
+            self.rendering_core_budget(settings.rendering_core_budget);
+            self.rendering_memory_budget_mb(settings.rendering_memory_budget_mb);
+            self.preprocessing_service_enabled(settings.preprocessing_service_enabled);
+            self.preprocessing_service_socket_path(settings.preprocessing_service_socket_path);
             self.octolapse_version(settings.version || settings.octolapse_version || null);
             self.octolapse_git_version(settings.git_version || settings.octolapse_git_version || null);
 
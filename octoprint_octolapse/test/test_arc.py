@@ -0,0 +1,171 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import math
+import os
+import tempfile
+import unittest
+
+import GcodePositionProcessor
+from octoprint_octolapse.gcode_processor import GcodeProcessor, Pos
+from octoprint_octolapse.test.testing_utilities import create_position_args
+
+
+class TestArcPosition(unittest.TestCase):
+    key = "test_arc_position"
+    print_start_gcode = ["G21", "G90", "M83", "G28", "G1 X10 Y10 Z0.2 F600"]
+
+    def setUp(self):
+        position_args = create_position_args(e_axis_default_mode="relative")
+        position_args["volume"]["bounds"] = {
+            "min_x": 0.0, "max_x": 250.0, "min_y": 0.0, "max_y": 200.0, "min_z": 0.0, "max_z": 200.0
+        }
+        GcodeProcessor.initialize_position_processor(position_args, key=self.key)
+        self.update(self.print_start_gcode)
+
+    def update(self, gcodes):
+        position = Pos()
+        for gcode in gcodes:
+            GcodeProcessor.update(gcode, position, key=self.key)
+        return position
+
+    def assert_position(self, position, x, y, z):
+        self.assertAlmostEqual(position.x, x, 5)
+        self.assertAlmostEqual(position.y, y, 5)
+        self.assertAlmostEqual(position.z, z, 5)
+
+    def test_ij_arc(self):
+        position = self.update(["G2 X20 Y10 I5 J0 E1"])
+        self.assert_position(position, 20, 10, 0.2)
+        self.assertTrue(position.is_in_bounds)
+
+    def test_r_arc(self):
+        position = self.update(["G3 X10 Y20 R5 E1"])
+        self.assert_position(position, 10, 20, 0.2)
+
+    def test_helical_arc(self):
+        position = self.update(["G2 X10 Y10 Z0.6 I5 J0"])
+        self.assert_position(position, 10, 10, 0.6)
+
+    def test_relative_arc(self):
+        position = self.update(["G91", "G2 X10 Y0 Z0.2 I5 J0"])
+        self.assert_position(position, 20, 10, 0.4)
+
+    def test_arc_out_of_bounds(self):
+        """The end points are in bounds, but the arc leaves the bed."""
+        # clockwise from (10, 10) to (20, 10) around (15, 10) passes through (15, 15)
+        self.assertTrue(self.update(["G2 X20 Y10 I5 J0 E1"]).is_in_bounds)
+        # counter-clockwise from (20, 3) to (30, 3) around (25, 3) passes through (25, -2)
+        self.assertFalse(self.update(["G1 X20 Y3", "G3 X30 Y3 R5 E1"]).is_in_bounds)
+        # the whole circle leaves the bed
+        self.assertFalse(self.update(["G2 X30 Y3 I0 J-5 E1"]).is_in_bounds)
+
+
+class TestArcSmartLayer(unittest.TestCase):
+    stabilization_x = 130.0
+    stabilization_y = 100.0
+
+    class GcodeGenerator(object):
+        def __init__(self, x, y):
+            self.x = x
+            self.y = y
+
+        def get_snapshot_position(self, x, y):
+            return {"x": self.x, "y": self.y}
+
+    def setUp(self):
+        # Each layer is a single clockwise arc around (100, 100) that starts and ends on the opposite side of the
+        # stabilization point, so only the points within the arc come close.
+        gcode = ["G21", "G90", "M83", "G28", "G1 X80 Y100 F1800"]
+        for layer in range(1, 5):
+            gcode.append("G1 Z{0:.1f}".format(layer * 0.2))
+            gcode.append("G1 X80 Y101 E0.1")
+            gcode.append("G2 X80 Y99 I20 J-1 E5")
+            gcode.append("G1 X80 Y100")
+        handle, self.file_path = tempfile.mkstemp(suffix=".gcode")
+        with os.fdopen(handle, "w") as gcode_file:
+            gcode_file.write("\n".join(gcode) + "\n")
+
+    def tearDown(self):
+        os.remove(self.file_path)
+
+    def get_snapshot_plans(self, arc_chord_tolerance):
+        stabilization_args = {
+            "height_increment": 0,
+            "notification_period_seconds": 100,
+            "on_progress_received": lambda *args: True,
+            "file_path": self.file_path,
+            "gcode_generator": TestArcSmartLayer.GcodeGenerator(self.stabilization_x, self.stabilization_y),
+            "x_stabilization_disabled": False,
+            "y_stabilization_disabled": False
+        }
+        smart_layer_args = {
+            "trigger_type": 1,  # fast
+            "snap_to_print_high_quality": False,
+            "snap_to_print_smooth": False,
+            "arc_chord_tolerance": arc_chord_tolerance
+        }
+        results = GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
+            create_position_args(e_axis_default_mode="relative"), stabilization_args, smart_layer_args
+        )
+        return results[0]
+
+    def test_arc_end_points_only(self):
+        for plan in self.get_snapshot_plans(0):
+            # start_command
+            self.assertEqual(plan[5][2], plan[6][2])
+            # no end command
+            self.assertIsNone(plan[10])
+
+    def test_arc_chord_sampling(self):
+        plans = self.get_snapshot_plans(0.01)
+        self.assertGreater(len(plans), 0)
+        for plan in plans:
+            initial_position = Pos.create_from_cpp_pos(plan[7])
+            distance = math.sqrt(
+                math.pow(initial_position.x - self.stabilization_x, 2) +
+                math.pow(initial_position.y - self.stabilization_y, 2)
+            )
+            # The sampled point must be on the arc, and much closer than either end point
+            self.assertAlmostEqual(
+                math.sqrt(math.pow(initial_position.x - 100, 2) + math.pow(initial_position.y - 100, 2)),
+                math.sqrt(401), 3
+            )
+            self.assertLess(distance, 10.1)
+            # The triggering arc is split into two arcs that meet at the initial position
+            triggering_command = plan[5]
+            start_command = plan[6]
+            end_command = plan[10]
+            self.assertEqual(triggering_command[2], "G2 X80 Y99 I20 J-1 E5")
+            self.assertEqual(start_command[0], "G2")
+            self.assertEqual(end_command[0], "G2")
+            self.assertAlmostEqual(start_command[1]["X"], initial_position.x, 3)
+            self.assertAlmostEqual(start_command[1]["Y"], initial_position.y, 3)
+            self.assertAlmostEqual(end_command[1]["X"], 80, 3)
+            self.assertAlmostEqual(end_command[1]["Y"], 99, 3)
+            self.assertAlmostEqual(start_command[1]["E"] + end_command[1]["E"], 5, 4)
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestArcPosition))
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestArcSmartLayer))
+    unittest.TextTestRunner(verbosity=3).run(suite)
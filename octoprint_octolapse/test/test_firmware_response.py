@@ -0,0 +1,120 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import time
+import unittest
+
+from octoprint_octolapse.gcode_commands import Response
+from octoprint_octolapse.gcode_processor import GcodeProcessor, FirmwareResponse
+
+
+class TestFirmwareResponse(unittest.TestCase):
+    # every received line is checked, so the native check must stay far below the time between lines
+    max_microseconds_per_line = 2.0
+    position_lines = [
+        "ok X:150.0 Y:150.0 Z:0.7 E:0.0",
+        "X:10.00 Y:20.00 Z:0.30 E:5.12345 Count X:800 Y:1600 Z:120",
+        "X:10.00 Y:20.00 Z:0.30 E:5.12345 Count A:800 B:1600 Z:120",
+        "ok X:150.0 Y:150.0 Z:  0.7 E:  0.0",
+        "X:-1.5Y:2.25Z:3E:-0.8",
+        "X:0.000 Y:0.000 Z:0.000 E0:1.500 E1:2.500",
+        "echo: X:1.0 Y:2.0 Z:3.0 E:4.0",
+    ]
+
+    def test_positions_match_the_python_parser(self):
+        for line in self.position_lines:
+            expected = Response.check_for_position_request(line)
+            self.assertEqual(GcodeProcessor.parse_position_response(line), expected, line)
+
+    def test_extruder_positions(self):
+        response_type, has_ok, values = GcodeProcessor.parse_firmware_response(
+            "X:0.000 Y:0.000 Z:0.000 E0:1.500 E2:2.500"
+        )
+        self.assertEqual(response_type, FirmwareResponse.POSITION)
+        self.assertFalse(has_ok)
+        self.assertEqual(values, (0, 0, 0, None, (1.5, 0, 2.5)))
+
+    def test_additional_axes_are_skipped(self):
+        # The python regex doesn't handle the C axis of an E3D tool changer
+        line = ("X:272.500 Y:140.000 Z:15.000 C:4.600 E:0.000 E0:0.0 Count 66000 21200 24000 7360 Machine 272.500 "
+                "140.000 15.000 4.600 Bed comp 0.000")
+        self.assertEqual(GcodeProcessor.parse_position_response(line), {'x': 272.5, 'y': 140, 'z': 15, 'e': 0})
+
+    def test_incomplete_positions_are_not_positions(self):
+        for line in ["X:1.0 Y:2.0 Z:3.0", "X:1.0 Z:3.0 E:1.0", "X: Y:2.0 Z:3.0 E:1.0", "ok", "echo:X:"]:
+            self.assertFalse(GcodeProcessor.parse_position_response(line), line)
+
+    def test_classification(self):
+        lines = {
+            "ok": (FirmwareResponse.OK, True, None),
+            "ok 123": (FirmwareResponse.OK, True, None),
+            " T:210.00 /210.00 B:60.00 /60.00 @:127 B@:0": (
+                FirmwareResponse.TEMPERATURE, False, (210, 210, 60, 60)
+            ),
+            "ok T:209.8 /210.0 B:59.9 /60.0 T0:209.8 /210.0 @:40 B@:0": (
+                FirmwareResponse.TEMPERATURE, True, (209.8, 210, 59.9, 60)
+            ),
+            "T0:25.0 T1:26.0": (FirmwareResponse.TEMPERATURE, False, (25, None, None, None)),
+            "Error:Printer halted. kill() called!": (FirmwareResponse.ERROR, False, None),
+            "!! Printer halted": (FirmwareResponse.ERROR, False, None),
+            "Resend: 1234": (FirmwareResponse.RESEND, False, 1234),
+            "rs 77": (FirmwareResponse.RESEND, False, 77),
+            "echo:busy: processing": (FirmwareResponse.BUSY, False, None),
+            "busy: paused for user": (FirmwareResponse.BUSY, False, None),
+            "ok X:1.0 Y:2.0 Z:3.0 E:4.0": (FirmwareResponse.POSITION, True, (1, 2, 3, 4, ())),
+        }
+        for line, expected in lines.items():
+            self.assertEqual(GcodeProcessor.parse_firmware_response(line), expected, line)
+        for line in ["echo:SD card ok", "wait", "FIRMWARE_NAME:Marlin", "", "Begin file list"]:
+            self.assertIsNone(GcodeProcessor.parse_firmware_response(line), line)
+
+    def test_unrequested_types_are_ignored(self):
+        flags = FirmwareResponse.get_type_flags(FirmwareResponse.POSITION)
+        self.assertIsNone(GcodeProcessor.parse_firmware_response(" T:210.00 /210.00 B:60.00 /60.00", flags))
+        self.assertIsNone(GcodeProcessor.parse_firmware_response("ok", flags))
+        self.assertEqual(
+            GcodeProcessor.parse_firmware_response("ok X:1 Y:2 Z:3 E:4", flags)[0], FirmwareResponse.POSITION
+        )
+
+    def test_throughput(self):
+        """Compare the time taken to check received lines for a position report."""
+        lines = [" T:210.00 /210.00 B:60.00 /60.00 @:127 B@:0", "ok", "echo:busy: processing"] * 10000
+        lines += self.position_lines * 100
+        results = {}
+        for name, check in [
+            ("python", Response.check_for_position_request), ("native", GcodeProcessor.parse_position_response)
+        ]:
+            start_time = time.time()
+            for line in lines:
+                check(line)
+            results[name] = (time.time() - start_time) / len(lines) * 1000000.0
+        print(
+            "\nPosition check - python: {0:.2f} us/line, native: {1:.2f} us/line".format(
+                results["python"], results["native"]
+            )
+        )
+        self.assertLess(results["native"], self.max_microseconds_per_line)
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestFirmwareResponse))
+    unittest.TextTestRunner(verbosity=3).run(suite)
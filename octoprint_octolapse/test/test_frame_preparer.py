@@ -0,0 +1,147 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import os
+import shutil
+import tempfile
+import unittest
+
+from PIL import Image
+
+import GcodePositionProcessor
+
+
+class TestFramePreparer(unittest.TestCase):
+    width = 32
+    height = 24
+
+    def setUp(self):
+        self.temp_directory = tempfile.mkdtemp()
+        self.output_path = os.path.join(self.temp_directory, "frames.raw")
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_directory)
+
+    def create_snapshot(self, name, color, **kwargs):
+        path = os.path.join(self.temp_directory, name)
+        Image.new('RGB', (self.width, self.height), color).save(path, 'JPEG', quality=95, **kwargs)
+        return path
+
+    def prepare_frames(self, frames, glyphs=None, num_threads=0, progress_callback=None):
+        output_file = os.open(self.output_path, os.O_WRONLY | os.O_CREAT | os.O_TRUNC)
+        try:
+            return GcodePositionProcessor.PrepareFrames(
+                {
+                    "width": self.width,
+                    "height": self.height,
+                    "num_threads": num_threads,
+                    "output_handle": output_file,
+                    "glyphs": [] if glyphs is None else glyphs
+                },
+                frames,
+                progress_callback if progress_callback is not None else lambda frames_written, total_frames: True
+            )
+        finally:
+            os.close(output_file)
+
+    def read_frames(self):
+        with open(self.output_path, 'rb') as output_file:
+            data = output_file.read()
+        frame_size = self.width * self.height * 3
+        return [
+            Image.frombytes('RGB', (self.width, self.height), data[index:index + frame_size])
+            for index in range(0, len(data), frame_size)
+        ]
+
+    def assertColorAlmostEqual(self, actual, expected, delta=3):
+        for actual_value, expected_value in zip(actual, expected):
+            self.assertAlmostEqual(actual_value, expected_value, delta=delta)
+
+    def test_get_jpeg_size(self):
+        path = self.create_snapshot("baseline.jpg", (10, 20, 30))
+        self.assertEqual(GcodePositionProcessor.GetJpegSize(path), (self.width, self.height))
+        # progressive jpegs are left to Pillow
+        path = self.create_snapshot("progressive.jpg", (10, 20, 30), progressive=True)
+        self.assertIsNone(GcodePositionProcessor.GetJpegSize(path))
+        self.assertIsNone(GcodePositionProcessor.GetJpegSize(os.path.join(self.temp_directory, "missing.jpg")))
+
+    def test_frames_are_written_in_order_with_repeats(self):
+        colors = [(200, 30, 30), (30, 200, 30), (30, 30, 200)]
+        frames = [
+            (self.create_snapshot("{0}.jpg".format(index), color), 2 if index == 0 else 1, None)
+            for index, color in enumerate(colors)
+        ]
+        progress = []
+        results = self.prepare_frames(
+            frames, num_threads=2,
+            progress_callback=lambda frames_written, total_frames: progress.append((frames_written, total_frames)) or True
+        )
+        self.assertTrue(results["success"])
+        self.assertEqual(results["frames_written"], 4)
+        self.assertEqual(results["frames_failed"], 0)
+        self.assertEqual(progress[-1], (4, 4))
+        written = self.read_frames()
+        self.assertEqual(len(written), 4)
+        for frame, color in zip(written, [colors[0], colors[0], colors[1], colors[2]]):
+            self.assertColorAlmostEqual(frame.getpixel((16, 12)), color)
+
+    def test_failed_frames_repeat_the_previous_frame(self):
+        frames = [
+            (self.create_snapshot("0.jpg", (200, 30, 30)), 1, None),
+            (os.path.join(self.temp_directory, "missing.jpg"), 1, None),
+        ]
+        results = self.prepare_frames(frames)
+        self.assertTrue(results["success"])
+        self.assertEqual(results["frames_failed"], 1)
+        written = self.read_frames()
+        self.assertEqual(len(written), 2)
+        self.assertColorAlmostEqual(written[1].getpixel((16, 12)), (200, 30, 30))
+
+    def test_glyphs_are_blended_and_clipped(self):
+        # a 4x4 glyph, opaque on the left half and half transparent on the right
+        glyph = (4, 4, (255, 255, 0), bytes(bytearray([255, 255, 128, 128] * 4)))
+        frames = [(self.create_snapshot("0.jpg", (0, 0, 0)), 1, [(0, 2, 2), (0, self.width - 2, -2)])]
+        results = self.prepare_frames(frames, glyphs=[glyph])
+        self.assertTrue(results["success"])
+        frame = self.read_frames()[0]
+        self.assertColorAlmostEqual(frame.getpixel((2, 2)), (255, 255, 0))
+        self.assertColorAlmostEqual(frame.getpixel((4, 2)), (128, 128, 0))
+        self.assertColorAlmostEqual(frame.getpixel((self.width - 1, 1)), (255, 255, 0))
+        self.assertColorAlmostEqual(frame.getpixel((16, 12)), (0, 0, 0))
+
+    def test_frames_are_scaled_to_the_output_size(self):
+        path = os.path.join(self.temp_directory, "large.jpg")
+        Image.new('RGB', (self.width * 2, self.height * 2), (30, 200, 30)).save(path, 'JPEG', quality=95)
+        results = self.prepare_frames([(path, 1, None)])
+        self.assertTrue(results["success"])
+        self.assertColorAlmostEqual(self.read_frames()[0].getpixel((16, 12)), (30, 200, 30))
+
+    def test_cancel(self):
+        frames = [(self.create_snapshot("{0}.jpg".format(index), (30, 30, 30)), 1, None) for index in range(4)]
+        results = self.prepare_frames(frames, progress_callback=lambda frames_written, total_frames: False)
+        self.assertFalse(results["success"])
+        self.assertEqual(results["frames_written"], 1)
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestFramePreparer))
+    unittest.TextTestRunner(verbosity=3).run(suite)
@@ -0,0 +1,144 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import os
+import random
+import shutil
+import tempfile
+import unittest
+
+from PIL import Image, ImageFilter
+
+import GcodePositionProcessor
+
+
+class TestFrameRegistration(unittest.TestCase):
+    width = 320
+    height = 180
+
+    def setUp(self):
+        self.temp_directory = tempfile.mkdtemp()
+        random.seed(0)
+        # A textured scene, larger than the frames so that they can be cut from it with a shift
+        self.scene = Image.effect_noise((self.width + 40, self.height + 40), 60).filter(
+            ImageFilter.GaussianBlur(2)
+        ).convert('RGB')
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_directory)
+
+    def create_snapshot(self, index, shift_x, shift_y):
+        """Creates a snapshot whose content has moved right by shift_x and down by shift_y."""
+        path = os.path.join(self.temp_directory, "{0:03d}.jpg".format(index))
+        image = self.scene.transform(
+            (self.width, self.height), Image.AFFINE, (1, 0, 20 - shift_x, 0, 1, 20 - shift_y), resample=Image.BICUBIC
+        )
+        image.save(path, 'JPEG', quality=90)
+        return path
+
+    def register_frames(self, paths, **kwargs):
+        args = {"width": self.width, "height": self.height, "num_threads": 2}
+        args.update(kwargs)
+        return GcodePositionProcessor.RegisterFrames(args, paths, lambda frames_analysed, total_frames: True)
+
+    def test_jitter_is_removed(self):
+        shifts = [(random.uniform(-3, 3), random.uniform(-3, 3)) for index in range(30)]
+        paths = [self.create_snapshot(index, shift_x, shift_y) for index, (shift_x, shift_y) in enumerate(shifts)]
+        results = self.register_frames(paths, smoothing_frames=len(paths) * 2 + 1)
+        self.assertTrue(results["success"])
+        self.assertEqual(results["frames_unmatched"], 0)
+        self.assertEqual(len(results["offsets"]), len(paths))
+        # With a window covering every frame, every frame is moved onto the average position
+        average_x = sum(shift_x for shift_x, shift_y in shifts) / len(shifts)
+        average_y = sum(shift_y for shift_x, shift_y in shifts) / len(shifts)
+        for (offset_x, offset_y, confidence), (shift_x, shift_y) in zip(results["offsets"], shifts):
+            self.assertAlmostEqual(shift_x + offset_x, average_x, delta=0.75)
+            self.assertAlmostEqual(shift_y + offset_y, average_y, delta=0.75)
+
+    def test_slow_drift_is_kept(self):
+        paths = [self.create_snapshot(index, index * 0.5, 0) for index in range(20)]
+        results = self.register_frames(paths, smoothing_frames=5)
+        self.assertTrue(results["success"])
+        # The first frame has no previous frame to match
+        self.assertEqual(results["offsets"][0][2], 0)
+        for offset_x, offset_y, confidence in results["offsets"][2:-2]:
+            self.assertAlmostEqual(offset_x, 0, delta=0.3)
+            self.assertAlmostEqual(offset_y, 0, delta=0.3)
+
+    def test_unrelated_frames_are_not_moved(self):
+        paths = [self.create_snapshot(0, 0, 0)]
+        for index in range(1, 4):
+            path = os.path.join(self.temp_directory, "noise_{0}.jpg".format(index))
+            Image.effect_noise((self.width, self.height), 100).convert('RGB').save(path, 'JPEG')
+            paths.append(path)
+        paths.append(os.path.join(self.temp_directory, "missing.jpg"))
+        results = self.register_frames(paths, min_confidence=0.5)
+        self.assertTrue(results["success"])
+        self.assertEqual(results["frames_unmatched"], 4)
+        for offset_x, offset_y, confidence in results["offsets"]:
+            self.assertEqual((offset_x, offset_y), (0, 0))
+
+    def test_cancel(self):
+        paths = [self.create_snapshot(index, 0, 0) for index in range(5)]
+        results = GcodePositionProcessor.RegisterFrames(
+            {"width": self.width, "height": self.height}, paths, lambda frames_analysed, total_frames: False
+        )
+        self.assertFalse(results["success"])
+
+    def test_offsets_are_applied(self):
+        path = self.create_snapshot(0, 0, 0)
+        output_path = os.path.join(self.temp_directory, "frames.raw")
+        output_file = os.open(output_path, os.O_WRONLY | os.O_CREAT | os.O_TRUNC)
+        try:
+            results = GcodePositionProcessor.PrepareFrames(
+                {
+                    "width": self.width, "height": self.height, "num_threads": 1, "output_handle": output_file,
+                    "glyphs": []
+                },
+                [(path, 1, None), (path, 1, None, (3.0, -2.0)), (path, 1, None, (0.5, 0.0))],
+                lambda frames_written, total_frames: True
+            )
+        finally:
+            os.close(output_file)
+        self.assertTrue(results["success"])
+        with open(output_path, 'rb') as frames_file:
+            data = frames_file.read()
+        frame_size = self.width * self.height * 3
+        frames = [
+            Image.frombytes('RGB', (self.width, self.height), data[index:index + frame_size])
+            for index in range(0, len(data), frame_size)
+        ]
+        original = frames[0].load()
+        shifted = frames[1].load()
+        half_shifted = frames[2].load()
+        for x, y in [(10, 10), (100, 50), (300, 170)]:
+            self.assertEqual(shifted[x, y], original[x - 3, y + 2])
+            for channel in range(3):
+                expected = (original[x, y][channel] + original[x - 1, y][channel]) / 2.0
+                self.assertAlmostEqual(half_shifted[x, y][channel], expected, delta=1)
+        # The edges are repeated
+        self.assertEqual(shifted[0, 0], original[0, 2])
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestFrameRegistration))
+    unittest.TextTestRunner(verbosity=3).run(suite)
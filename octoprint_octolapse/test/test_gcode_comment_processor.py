@@ -0,0 +1,182 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import unittest
+
+import GcodePositionProcessor
+from octoprint_octolapse.gcode_processor import GcodeProcessor, Pos
+from octoprint_octolapse.test.testing_utilities import create_position_args
+
+# The feature types in gcode_comment_processor.h
+UNKNOWN_FEATURE = 0
+BRIDGE_FEATURE = 1
+SUPPORT_FEATURE = 2
+OUTER_PERIMETER_FEATURE = 3
+UNKNOWN_PERIMETER_FEATURE = 4
+INNER_PERIMETER_FEATURE = 5
+SKIRT_FEATURE = 6
+GAP_FILL_FEATURE = 7
+SOLID_INFILL_FEATURE = 8
+OOZE_SHIELD_FEATURE = 9
+INFILL_FEATURE = 10
+PRIME_PILLAR_FEATURE = 11
+
+
+class TestGcodeCommentProcessor(unittest.TestCase):
+    key = "test_gcode_comment_processor"
+    print_start_gcode = ["G21", "G90", "M83", "G28", "G1 X10 Y10 Z0.2 F600"]
+
+    def setUp(self):
+        # Each test starts with a new processor that doesn't know which slicer wrote the file
+        GcodeProcessor.initialize_position_processor(create_position_args(), key=self.key)
+        self.x = 10
+
+    def get_feature_types(self, gcodes):
+        """Returns the feature type of every command after the start gcode."""
+        feature_types = []
+        for gcode in self.print_start_gcode + gcodes:
+            GcodeProcessor.update(gcode, Pos(), key=self.key)
+            if not gcode.lstrip().startswith(";"):
+                feature_types.append(GcodePositionProcessor.GetCurrentPositionDict(self.key)["feature_type_tag"])
+        return feature_types[len(self.print_start_gcode):]
+
+    def extrude(self, comment=None):
+        self.x += 1
+        gcode = "G1 X{0} Y10 E0.1".format(self.x)
+        return gcode if comment is None else "{0} ; {1}".format(gcode, comment)
+
+    def test_slic3r_pe(self):
+        feature_types = self.get_feature_types([
+            ";LAYER_CHANGE", ";Z:0.2", ";HEIGHT:0.2",
+            ";TYPE:Skirt/Brim", self.extrude(),
+            ";TYPE:External perimeter", self.extrude(),
+            ";TYPE:Perimeter", self.extrude(),
+            ";TYPE:Solid infill", self.extrude(),
+            ";WIPE_START", self.extrude(), ";WIPE_END",
+            ";TYPE:Gap fill", self.extrude(),
+            ";TYPE:Bridge infill", self.extrude(),
+            ";TYPE:Wipe tower", self.extrude(),
+        ])
+        self.assertEqual(feature_types, [
+            SKIRT_FEATURE, OUTER_PERIMETER_FEATURE, INNER_PERIMETER_FEATURE, SOLID_INFILL_FEATURE, UNKNOWN_FEATURE,
+            GAP_FILL_FEATURE, BRIDGE_FEATURE, PRIME_PILLAR_FEATURE
+        ])
+
+    def test_slic3r_pe_verbose_comments(self):
+        feature_types = self.get_feature_types([
+            self.extrude("skirt"),
+            "G1 X30 Y30 ; move to first external perimeter point",
+            self.extrude("external perimeter"),
+            self.extrude("perimeter"),
+            self.extrude("infill"),
+            self.extrude("solid infill"),
+            self.extrude("infill(bridge)"),
+            self.extrude("gap fill"),
+            self.extrude("not a feature"),
+        ])
+        self.assertEqual(feature_types, [
+            SKIRT_FEATURE, OUTER_PERIMETER_FEATURE, OUTER_PERIMETER_FEATURE, UNKNOWN_PERIMETER_FEATURE,
+            INFILL_FEATURE, SOLID_INFILL_FEATURE, BRIDGE_FEATURE, GAP_FILL_FEATURE, UNKNOWN_FEATURE
+        ])
+
+    def test_orca_slicer(self):
+        feature_types = self.get_feature_types([
+            ";TYPE:Outer wall", self.extrude(),
+            ";TYPE:Inner wall", self.extrude(),
+            ";TYPE:Overhang wall", self.extrude(),
+            ";TYPE:Sparse infill", self.extrude(),
+            ";TYPE:Top surface", self.extrude(),
+            ";TYPE:Gap infill", self.extrude(),
+            ";TYPE:Prime tower", self.extrude(),
+        ])
+        self.assertEqual(feature_types, [
+            OUTER_PERIMETER_FEATURE, INNER_PERIMETER_FEATURE, BRIDGE_FEATURE, INFILL_FEATURE, SOLID_INFILL_FEATURE,
+            GAP_FILL_FEATURE, PRIME_PILLAR_FEATURE
+        ])
+
+    def test_cura(self):
+        feature_types = self.get_feature_types([
+            ";LAYER:0",
+            ";TYPE:SKIRT", self.extrude(),
+            ";MESH:part.stl",
+            ";TYPE:WALL-OUTER", self.extrude(),
+            ";TYPE:WALL-INNER", self.extrude(),
+            ";TYPE:SKIN", self.extrude(),
+            ";TYPE:FILL", self.extrude(),
+            # a mesh change ends the current section
+            ";MESH:NONMESH", self.extrude(),
+            ";TYPE:SUPPORT-INTERFACE", self.extrude(),
+            ";LAYER:1", self.extrude(),
+            ";TYPE:PRIME-TOWER", self.extrude(),
+        ])
+        self.assertEqual(feature_types, [
+            SKIRT_FEATURE, OUTER_PERIMETER_FEATURE, INNER_PERIMETER_FEATURE, SOLID_INFILL_FEATURE, INFILL_FEATURE,
+            UNKNOWN_FEATURE, SUPPORT_FEATURE, UNKNOWN_FEATURE, PRIME_PILLAR_FEATURE
+        ])
+
+    def test_simplify_3d(self):
+        feature_types = self.get_feature_types([
+            "; layer 1, Z = 0.2",
+            "; feature skirt", self.extrude(),
+            "; feature outer perimeter", self.extrude(),
+            "; feature inner perimeter", self.extrude(),
+            "; feature solid layer", self.extrude(),
+            "; feature infill", self.extrude(),
+            "; feature gap fill", self.extrude(),
+            # older versions leave out 'feature'
+            "; ooze shield", self.extrude(),
+            "; prime pillar", self.extrude(),
+        ])
+        self.assertEqual(feature_types, [
+            SKIRT_FEATURE, OUTER_PERIMETER_FEATURE, INNER_PERIMETER_FEATURE, SOLID_INFILL_FEATURE, INFILL_FEATURE,
+            GAP_FILL_FEATURE, OOZE_SHIELD_FEATURE, PRIME_PILLAR_FEATURE
+        ])
+
+    def test_idea_maker(self):
+        feature_types = self.get_feature_types([
+            ";LAYER:0",
+            ";TYPE:RAFT", self.extrude(),
+            ";TYPE:WALL-OUTER", self.extrude(),
+            ";TYPE:WALL-INNER", self.extrude(),
+            ";TYPE:SOLID-FILL", self.extrude(),
+            ";TYPE:FILL", self.extrude(),
+            # Only Cura writes SKIN, so it's ignored once ideaMaker has been detected
+            ";TYPE:SKIN", self.extrude(),
+        ])
+        self.assertEqual(feature_types, [
+            SUPPORT_FEATURE, OUTER_PERIMETER_FEATURE, INNER_PERIMETER_FEATURE, SOLID_INFILL_FEATURE, INFILL_FEATURE,
+            INFILL_FEATURE
+        ])
+
+    def test_verbose_slic3r_comments_after_a_simplify_3d_section(self):
+        # Once a Simplify3D section has been seen, verbose Slic3r comments and sections are not considered.
+        feature_types = self.get_feature_types([
+            "; feature outer perimeter",
+            self.extrude(),
+            self.extrude("infill"),
+            ";TYPE:Solid infill",
+            self.extrude("gap fill"),
+            "; feature infill",
+            self.extrude("external perimeter"),
+        ])
+        self.assertEqual(feature_types, [
+            OUTER_PERIMETER_FEATURE, OUTER_PERIMETER_FEATURE, OUTER_PERIMETER_FEATURE, INFILL_FEATURE
+        ])
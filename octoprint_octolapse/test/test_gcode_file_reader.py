@@ -0,0 +1,276 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import gzip
+import os
+import shutil
+import struct
+import tempfile
+import unittest
+import zlib
+
+import GcodePositionProcessor
+from octoprint_octolapse.test.testing_utilities import (
+    create_gcode_file, create_position_args, create_smart_layer_args, create_stabilization_args
+)
+
+
+def heatshrink_compress(data, window_bits=12, lookahead_bits=4):
+    # Greedy LZSS in the heatshrink bit format, good enough to produce back references for the decoder to follow.
+    bits = []
+    positions = {}
+    position = 0
+    while position < len(data):
+        length, distance = 0, 0
+        for candidate in reversed(positions.get(data[position:position + 3], [])):
+            if position - candidate > 1 << window_bits:
+                break
+            match = 0
+            while (match < 1 << lookahead_bits and position + match < len(data)
+                   and data[candidate + match] == data[position + match]):
+                match += 1
+            if match > length:
+                length, distance = match, position - candidate
+        if length < 3:
+            length = 1
+            bits.append("1{0:08b}".format(data[position]))
+        else:
+            bits.append("0{0:0{1}b}{2:0{3}b}".format(distance - 1, window_bits, length - 1, lookahead_bits))
+        for index in range(position, position + length):
+            positions.setdefault(data[index:index + 3], []).append(index)
+        position += length
+    bits = "".join(bits)
+    bits += "0" * (-len(bits) % 8)
+    return bytes(int(bits[index:index + 8], 2) for index in range(0, len(bits), 8))
+
+
+def meatpack_encode(text):
+    # Packing and no spaces mode are enabled, so 'E' replaces the space in the packed characters.
+    codes = {c: index for index, c in enumerate("0123456789.E\nGX")}
+    data = bytearray(b"\xff\xff\xfb\xff\xff\xf7")
+    for line in text.splitlines():
+        if line.startswith("G"):
+            line = line.replace(" ", "")
+        line += "\n"
+        for index in range(0, len(line), 2):
+            pair = line[index:index + 2]
+            first = codes.get(pair[0], 15)
+            second = codes.get(pair[1], 15) if len(pair) > 1 else 0
+            data.append(first | second << 4)
+            data.extend(ord(c) for c, code in zip(pair, [first, second]) if code == 15)
+    return bytes(data)
+
+
+def create_bgcode_block(block_type, data, compression=0, parameters=b"\x00\x00", uncompressed_size=None):
+    header = struct.pack("<HHI", block_type, compression, len(data) if uncompressed_size is None else uncompressed_size)
+    if compression != 0:
+        header += struct.pack("<I", len(data))
+    block = header + parameters + data
+    return block + struct.pack("<I", zlib.crc32(block))
+
+
+# The processing issue reported when the gcode file can't be read to the end
+GCODE_NOT_READ = 8
+
+
+class TestGcodeFileReader(unittest.TestCase):
+    """Compressed gcode files are decoded while they are read, and must produce the same plans as plain files."""
+    position_args = create_position_args()
+    smart_layer_args = create_smart_layer_args()
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def create_gcode_file(self, name, num_layers):
+        return create_gcode_file(self.directory, name, num_layers)
+
+    def get_snapshot_plans(self, file_path, write_stabilized_gcode=False):
+        stabilization_args = create_stabilization_args(file_path, self.position_args)
+        stabilization_args["on_progress_received"] = lambda *progress: True
+        if write_stabilized_gcode:
+            stabilization_args["snapshot_gcode_args"] = {
+                "axis_mode_compatibility": False,
+                "wait_for_moves_to_finish": True,
+                "disable_z_lift": False,
+                "snapshot_command": "@OCTOLAPSE TAKE-SNAPSHOT",
+                "extruders": self.position_args["slicer_settings"]["extruders"],
+            }
+            stabilization_args["stabilized_gcode_args"] = {
+                "target_file_path": file_path + ".stabilized.gcode", "verify": False
+            }
+        return GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
+            self.position_args, stabilization_args, self.smart_layer_args
+        )
+
+    def get_processing_issue_types(self, results):
+        return [issue[0] for issue in results[6]]
+
+    def assert_plans_match_plain_file(self, file_path, encoded_file_path, num_plans=10):
+        results = [
+            self.get_snapshot_plans(source_file_path, write_stabilized_gcode=True)
+            for source_file_path in [file_path, encoded_file_path]
+        ]
+        self.assertEqual(len(results[1][0]), num_plans)
+        self.assertEqual(results[1][0], results[0][0])
+        self.assertEqual(results[1][2:4], results[0][2:4])
+        self.assertEqual(self.get_processing_issue_types(results[1]), [])
+        # The stabilized gcode is always written uncompressed
+        with open(file_path + ".stabilized.gcode", "rb") as plain_file:
+            with open(encoded_file_path + ".stabilized.gcode", "rb") as decoded_file:
+                stabilized_gcode = plain_file.read()
+                self.assertEqual(stabilized_gcode.count(b"@OCTOLAPSE TAKE-SNAPSHOT"), num_plans)
+                self.assertEqual(decoded_file.read(), stabilized_gcode)
+
+    def assert_file_is_not_read(self, file_path):
+        results = self.get_snapshot_plans(file_path)
+        self.assertIn(GCODE_NOT_READ, self.get_processing_issue_types(results))
+
+    def create_gzip_file(self, file_path, data):
+        with gzip.open(file_path, "wb") as compressed_file:
+            compressed_file.write(data)
+        return file_path
+
+    def read_file(self, file_path):
+        with open(file_path, "rb") as gcode_file:
+            return gcode_file.read()
+
+    def write_file(self, file_path, data):
+        with open(file_path, "wb") as gcode_file:
+            gcode_file.write(data)
+        return file_path
+
+    def test_gzip_compressed_files_match_plain_files(self):
+        file_path = self.create_gcode_file("plain.gcode", 10)
+        compressed_file_path = self.create_gzip_file(file_path + ".gz", self.read_file(file_path))
+        self.assert_plans_match_plain_file(file_path, compressed_file_path)
+
+    def test_gzip_files_with_several_members_match_plain_files(self):
+        file_path = self.create_gcode_file("plain.gcode", 10)
+        data = self.read_file(file_path)
+        # Concatenated gzip members decompress to the concatenated data.  Split within a line.
+        members = [gzip.compress(data[index:index + 301]) for index in range(0, len(data), 301)]
+        self.assertGreater(len(members), 2)
+        compressed_file_path = self.write_file(file_path + ".gz", b"".join(members))
+        self.assert_plans_match_plain_file(file_path, compressed_file_path)
+
+    def create_large_gcode_file(self, name, num_layers, moves_per_layer):
+        # Layers with many moves, so a file of several decoder blocks still has a plan for every layer.
+        file_path = os.path.join(self.directory, name)
+        e = 0
+        with open(file_path, "w") as gcode_file:
+            gcode_file.write("G21\nG90\nM82\nG28\nG92 E0\n")
+            for layer in range(1, num_layers + 1):
+                gcode_file.write("G1 Z{0:.2f} F600\n".format(layer * 0.2))
+                for index in range(moves_per_layer):
+                    e += 0.05
+                    gcode_file.write("G1 X{0:.3f} Y{1:.3f} E{2:.4f} F1800\n".format(
+                        20 + index % 200 + layer * 0.001, 20 + index // 200, e
+                    ))
+        return file_path
+
+    def test_large_gzip_files_match_plain_files(self):
+        # Several decoder blocks, so back references reach into the history copied from the previous block
+        file_path = self.create_large_gcode_file("plain.gcode", 40, 2500)
+        data = self.read_file(file_path)
+        self.assertGreater(len(data), 2 * 1048576)
+        compressed_file_path = self.write_file(file_path + ".gz", gzip.compress(data, compresslevel=9))
+        self.assert_plans_match_plain_file(file_path, compressed_file_path, num_plans=40)
+
+    def test_large_gzip_files_with_a_stored_member_match_plain_files(self):
+        file_path = self.create_large_gcode_file("plain.gcode", 40, 2500)
+        data = self.read_file(file_path)
+        self.assertGreater(len(data), 2 * 1048576)
+        # A compressed member, then a member of stored blocks that don't end at the decoder's block boundaries
+        split = len(data) // 3
+        members = [gzip.compress(data[:split], compresslevel=6), gzip.compress(data[split:], compresslevel=0)]
+        self.assertGreater(len(members[1]), len(data) - split)
+        compressed_file_path = self.write_file(file_path + ".gz", b"".join(members))
+        self.assert_plans_match_plain_file(file_path, compressed_file_path, num_plans=40)
+
+    def test_gzip_files_with_crlf_line_endings_match_plain_files(self):
+        file_path = self.create_gcode_file("plain.gcode", 10)
+        # Windows line endings, and no line ending after the final line
+        data = self.read_file(file_path).replace(b"\n", b"\r\n")[:-2]
+        self.write_file(file_path, data)
+        compressed_file_path = self.create_gzip_file(file_path + ".gz", data)
+        self.assert_plans_match_plain_file(file_path, compressed_file_path)
+
+    def test_truncated_gzip_files_are_not_read(self):
+        file_path = self.create_gcode_file("plain.gcode", 50)
+        data = gzip.compress(self.read_file(file_path))
+        self.assert_file_is_not_read(self.write_file(file_path + ".gz", data[:len(data) // 2]))
+        # The whole deflate stream, without the trailer
+        self.assert_file_is_not_read(self.write_file(file_path + ".gz", data[:-8]))
+
+    def test_corrupt_gzip_files_are_not_read(self):
+        file_path = self.create_gcode_file("plain.gcode", 50)
+        data = bytearray(gzip.compress(self.read_file(file_path)))
+        # The crc32 of the decompressed data doesn't match the trailer
+        data[-8] ^= 0xff
+        self.assert_file_is_not_read(self.write_file(file_path + ".gz", bytes(data)))
+        # Invalid deflate block type
+        data = bytearray(gzip.compress(self.read_file(file_path)))
+        data[10] |= 0x06
+        self.assert_file_is_not_read(self.write_file(file_path + ".gz", bytes(data)))
+
+    def create_bgcode_file(self, name, gcode_blocks):
+        with open(os.path.join(self.directory, name), "wb") as binary_file:
+            # CRC32 checksums, then metadata and thumbnail blocks that must be skipped
+            binary_file.write(b"GCDE" + struct.pack("<IH", 1, 1))
+            binary_file.write(create_bgcode_block(0, b"Producer=test\n"))
+            binary_file.write(create_bgcode_block(5, b"thumbnail", parameters=struct.pack("<HHH", 0, 16, 16)))
+            settings = b"; layer_height = 0.2\n"
+            binary_file.write(create_bgcode_block(2, zlib.compress(settings), 1, uncompressed_size=len(settings)))
+            for gcode_block in gcode_blocks:
+                binary_file.write(gcode_block)
+            return binary_file.name
+
+    def test_binary_gcode_files_match_plain_files(self):
+        file_path = self.create_gcode_file("plain.gcode", 10)
+        with open(file_path, "r") as gcode_file:
+            lines = gcode_file.readlines()
+        # Heatshrink compressed, MeatPack encoded gcode, split into several blocks
+        gcode_blocks = []
+        for index in range(0, len(lines), 50):
+            data = meatpack_encode("".join(lines[index:index + 50]))
+            gcode_blocks.append(create_bgcode_block(
+                1, heatshrink_compress(data), 3, struct.pack("<H", 2), uncompressed_size=len(data)
+            ))
+        binary_file_path = self.create_bgcode_file("plain.bgcode", gcode_blocks)
+        self.assert_plans_match_plain_file(file_path, binary_file_path)
+
+    def test_binary_gcode_files_with_a_bad_checksum_are_not_read(self):
+        gcode_block = bytearray(create_bgcode_block(1, b"G1 X1 Y1\nG1 X2 Y2\n"))
+        gcode_block[-1] ^= 0xff
+        self.assert_file_is_not_read(self.create_bgcode_file("bad_checksum.bgcode", [bytes(gcode_block)]))
+
+    def test_binary_gcode_files_with_an_unknown_compression_are_not_read(self):
+        data = b"G1 X1 Y1\nG1 X2 Y2\n"
+        gcode_block = create_bgcode_block(1, data, 4, uncompressed_size=len(data))
+        self.assert_file_is_not_read(self.create_bgcode_file("unknown_compression.bgcode", [gcode_block]))
+
+    def test_deflate_compressed_binary_gcode_blocks_are_not_read(self):
+        data = b"G1 X1 Y1\nG1 X2 Y2\n"
+        gcode_block = create_bgcode_block(1, zlib.compress(data), 1, uncompressed_size=len(data))
+        self.assert_file_is_not_read(self.create_bgcode_file("deflate.bgcode", [gcode_block]))
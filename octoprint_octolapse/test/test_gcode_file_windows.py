@@ -0,0 +1,103 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import os
+import shutil
+import tempfile
+import unittest
+
+import GcodePositionProcessor
+
+
+class TestGcodeFileWindows(unittest.TestCase):
+    """Files are read through a window that slides along the file.  Small windows make every line cross a boundary."""
+    window_sizes = [1, 7, 64, 4095, 4096, 4097]
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def write_file(self, name, data):
+        file_path = os.path.join(self.directory, name)
+        with open(file_path, "wb") as gcode_file:
+            gcode_file.write(data)
+        return file_path
+
+    @staticmethod
+    def get_expected_lines(data):
+        # Each line without its line ending, and the offset directly after it
+        expected_lines = []
+        position = 0
+        while position < len(data):
+            line_end = data.find(b"\n", position)
+            if line_end == -1:
+                expected_lines.append((data[position:], len(data)))
+                break
+            expected_lines.append((data[position:line_end], line_end + 1))
+            position = line_end + 1
+        return expected_lines
+
+    def assert_lines_read(self, data):
+        file_path = self.write_file("test.gcode", data)
+        expected_lines = self.get_expected_lines(data)
+        for window_size in self.window_sizes:
+            for map_file in [True, False]:
+                message = "window_size: {0}, map_file: {1}".format(window_size, map_file)
+                lines = GcodePositionProcessor.ReadGcodeFileLines(file_path, window_size, map_file)
+                self.assertIsNotNone(lines, message)
+                for index, (line, expected_line) in enumerate(zip(lines, expected_lines)):
+                    self.assertEqual(line, expected_line, "{0}, line: {1}".format(message, index + 1))
+                self.assertEqual(len(lines), len(expected_lines), message)
+
+    @staticmethod
+    def create_gcode(num_lines):
+        lines = []
+        for index in range(num_lines):
+            # Lines of many lengths, including some that are longer than several windows
+            lines.append("G1 X{0} Y{1} E{2:.5f}".format(index % 250, index % 200, index * 0.01))
+            if index % 50 == 0:
+                lines.append("; " + "comment " * (index % 700))
+            if index % 97 == 0:
+                lines.append("")
+        return "\n".join(lines).encode("ascii")
+
+    def test_lines_cross_window_boundaries(self):
+        self.assert_lines_read(self.create_gcode(2000) + b"\n")
+
+    def test_final_line_without_line_ending(self):
+        self.assert_lines_read(self.create_gcode(2000))
+
+    def test_crlf_line_endings_are_kept(self):
+        # Only the line feed is removed, like std::getline
+        self.assert_lines_read(self.create_gcode(500).replace(b"\n", b"\r\n") + b"\r\n")
+
+    def test_line_ending_at_window_boundary(self):
+        for window_size in [7, 4096]:
+            self.assert_lines_read((b"G1 X1\n" + b"a" * (window_size - 7) + b"\n") * 10)
+
+    def test_empty_file(self):
+        self.assert_lines_read(b"")
+
+    def test_missing_file(self):
+        file_path = os.path.join(self.directory, "missing.gcode")
+        self.assertIsNone(GcodePositionProcessor.ReadGcodeFileLines(file_path, 64, True))
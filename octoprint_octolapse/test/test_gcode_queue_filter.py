@@ -0,0 +1,330 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import time
+import unittest
+
+from octoprint_octolapse.gcode_processor import GcodeProcessor
+from octoprint_octolapse.test.testing_utilities import create_position_args
+
+
+class TestGcodeQueueFilter(unittest.TestCase):
+    key = "test_gcode_queue_filter"
+    # per-line budget for the native filter, including the python call overhead
+    max_microseconds_per_line = 5.0
+
+    def setUp(self):
+        GcodeProcessor.initialize_snapshot_plan_cursor([], key=self.key)
+        GcodeProcessor.initialize_gcode_queue_filter("M240", state_message_interval_seconds=0, key=self.key)
+        self.file_line = 0
+
+    def filter_file_line(self, gcode):
+        self.file_line += 1
+        tags = {"source:file", "filepos:{0}".format(self.file_line * 20), "fileline:{0}".format(self.file_line)}
+        return GcodeProcessor.filter_queued_gcode(gcode, tags, key=self.key)
+
+    def test_pass_through(self):
+        self.assertEqual(self.filter_file_line("G1 X10 Y10 E1.5"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+        self.assertEqual(self.filter_file_line("M106 S255"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+        self.assertEqual(self.filter_file_line("G920"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+
+    def test_requires_processing(self):
+        self.assertNotEqual(self.filter_file_line("@OCTOLAPSE TAKE-SNAPSHOT"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+        self.assertNotEqual(self.filter_file_line("M240"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+        self.assertNotEqual(self.filter_file_line("SNAP"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+        self.assertNotEqual(self.filter_file_line("G92 E0 O"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+        # lines that are not from the file always require processing
+        self.assertNotEqual(
+            GcodeProcessor.filter_queued_gcode("G1 X10", {"trigger:cancel"}, key=self.key),
+            GcodeProcessor.QUEUE_FILTER_PASS_THROUGH
+        )
+        self.assertNotEqual(
+            GcodeProcessor.filter_queued_gcode("G1 X10", {"plugin:octolapse", "snapshot_gcode"}, key=self.key),
+            GcodeProcessor.QUEUE_FILTER_PASS_THROUGH
+        )
+
+    def test_file_line_mismatch(self):
+        self.assertEqual(self.filter_file_line("G1 X10"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+        # skip a line
+        self.file_line += 1
+        self.assertNotEqual(self.filter_file_line("G1 X10"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+
+    def test_snapshot_plan_cursor(self):
+        # plans trigger on file lines 3 and 5
+        GcodeProcessor.initialize_snapshot_plan_cursor(
+            [SnapshotPlanLocation(3, 60), SnapshotPlanLocation(5, 100)], key=self.key
+        )
+        for file_line in range(1, 7):
+            verdict = self.filter_file_line("G1 X10")
+            if verdict != GcodeProcessor.QUEUE_FILTER_PASS_THROUGH:
+                plan_index = GcodeProcessor.check_snapshot_plan_cursor(file_line, key=self.key)
+                self.assertEqual(plan_index, {3: 0, 5: 1}.get(file_line, -1))
+            else:
+                self.assertNotIn(file_line, [3, 5])
+
+    def test_performance(self):
+        gcodes = [
+            "G1 X{0:.3f} Y{1:.3f} E{2:.5f}".format(100 + index % 50, 100 - index % 30, 0.04 * index)
+            for index in range(1000)
+        ]
+        tags = [
+            {"source:file", "filepos:{0}".format(index * 30), "fileline:{0}".format(index + 1)}
+            for index in range(100000)
+        ]
+        start_time = time.perf_counter() if hasattr(time, "perf_counter") else time.time()
+        for index, line_tags in enumerate(tags):
+            GcodeProcessor.filter_queued_gcode(gcodes[index % 1000], line_tags, key=self.key)
+        total_time = (time.perf_counter() if hasattr(time, "perf_counter") else time.time()) - start_time
+        microseconds_per_line = total_time * 1000000.0 / len(tags)
+        print("Gcode queue filter: {0:.3f} microseconds per line.".format(microseconds_per_line))
+        self.assertLess(microseconds_per_line, self.max_microseconds_per_line)
+
+
+class TestNativeSnapshotTrigger(unittest.TestCase):
+    key = "test_native_snapshot_trigger"
+    # the real-time filter parses every line and updates the position and trigger
+    max_microseconds_per_line = 15.0
+    print_start_gcode = ["G21", "G90", "M83", "G28", "G1 Z0.2 F600"]
+
+    def setUp(self):
+        position_args = create_position_args(e_axis_default_mode="relative", location_detection_commands=["G28", "G29"])
+        GcodeProcessor.initialize_position_processor(position_args, key=self.key)
+        self.file_line = 0
+
+    def initialize_trigger(self, trigger_type, height_increment=0, snapshot_command=None):
+        GcodeProcessor.initialize_snapshot_trigger(
+            {
+                "type": trigger_type,
+                "require_zhop": False,
+                "height_increment": height_increment,
+                "interval_seconds": 30,
+                "snapshot_command": snapshot_command,
+                "extruder_triggers": None
+            },
+            key=self.key
+        )
+        GcodeProcessor.initialize_gcode_queue_filter(
+            snapshot_command, state_message_interval_seconds=0, update_position=True,
+            location_detection_commands=["G28", "G29"], key=self.key
+        )
+
+    def filter_file_line(self, gcode, update_triggers=True):
+        self.file_line += 1
+        tags = {"source:file", "fileline:{0}".format(self.file_line)}
+        return GcodeProcessor.filter_queued_gcode(gcode, tags, update_triggers, key=self.key)
+
+    def get_triggered_lines(self, gcodes):
+        triggered_lines = []
+        for gcode in gcodes:
+            if self.filter_file_line(gcode) != GcodeProcessor.QUEUE_FILTER_PASS_THROUGH:
+                if GcodeProcessor.get_snapshot_trigger_state(key=self.key)[0]:
+                    triggered_lines.append(gcode)
+        return triggered_lines
+
+    def test_location_detection(self):
+        self.initialize_trigger(1)
+        self.assertEqual(self.filter_file_line("G21"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+        self.assertEqual(self.filter_file_line("G28"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+        # the command after the home command must be processed
+        self.assertNotEqual(self.filter_file_line("G1 Z0.2"), GcodeProcessor.QUEUE_FILTER_PASS_THROUGH)
+
+    def test_layer_trigger(self):
+        self.initialize_trigger(1)
+        triggered_lines = self.get_triggered_lines(self.print_start_gcode + [
+            "G1 X10 Y10 E1", "G1 X20 Y10 E1", "G1 Z0.4", "G1 X30 E1", "G1 X40 E1", "G1 X50 E1", "G1 Z0.6",
+            "G1 X60 E1", "G1 X70 E1"
+        ])
+        # The trigger position is the previous position, which must be above the last extrusion.  The first layer
+        # has no previous extrusion, so it triggers on the line after the layer change.
+        self.assertEqual(triggered_lines, ["G1 X20 Y10 E1", "G1 X30 E1", "G1 X60 E1"])
+        self.assertEqual(GcodeProcessor.get_snapshot_trigger_state(key=self.key)[10], 3)
+
+    def test_gcode_trigger(self):
+        self.initialize_trigger(0, snapshot_command="M240")
+        triggered_lines = self.get_triggered_lines(self.print_start_gcode + [
+            "G1 X10 Y10 E1", "G1 X20 Y10 E1", "M240", "G1 X30 E1", "@OCTOLAPSE TAKE-SNAPSHOT", "G1 X40 E1"
+        ])
+        self.assertEqual(triggered_lines, ["M240", "@OCTOLAPSE TAKE-SNAPSHOT"])
+
+    def test_snapshots_disabled(self):
+        self.initialize_trigger(0, snapshot_command="M240")
+        triggered_lines = self.get_triggered_lines(self.print_start_gcode + [
+            "G1 X10 Y10 E1", "@OCTOLAPSE STOP-SNAPSHOTS", "G1 X20 Y10 E1", "M240", "G1 X30 E1",
+            "@OCTOLAPSE START-SNAPSHOTS", "M240", "G1 X40 E1"
+        ])
+        self.assertEqual(triggered_lines, ["M240"])
+        self.assertEqual(GcodeProcessor.get_snapshot_trigger_state(key=self.key)[10], 1)
+
+    def test_triggers_not_updated(self):
+        self.initialize_trigger(1)
+        for gcode in self.print_start_gcode + ["G1 X10 Y10 E1", "G1 X20 Y10 E1"]:
+            self.filter_file_line(gcode, update_triggers=False)
+        self.assertEqual(GcodeProcessor.get_snapshot_trigger_state(key=self.key)[10], 0)
+
+    def test_performance(self):
+        self.initialize_trigger(1)
+        for gcode in self.print_start_gcode:
+            self.filter_file_line(gcode)
+        gcodes = [
+            "G1 X{0:.3f} Y{1:.3f} E{2:.5f}".format(100 + index % 50, 100 - index % 30, 0.04)
+            for index in range(1000)
+        ]
+        start_time = time.perf_counter() if hasattr(time, "perf_counter") else time.time()
+        for index in range(100000):
+            self.filter_file_line(gcodes[index % 1000])
+        total_time = (time.perf_counter() if hasattr(time, "perf_counter") else time.time()) - start_time
+        microseconds_per_line = total_time * 1000000.0 / 100000
+        print("Real-time gcode queue filter: {0:.3f} microseconds per line.".format(microseconds_per_line))
+        self.assertLess(microseconds_per_line, self.max_microseconds_per_line)
+
+
+class TestPositionRestrictions(unittest.TestCase):
+    key = "test_position_restrictions"
+    # the native restriction engine should add very little to the real-time filter's per-line cost
+    max_microseconds_per_line = 15.0
+    print_start_gcode = ["G21", "G90", "M83", "G28", "G1 Z0.2 F600"]
+
+    def initialize(self, position_restrictions):
+        position_args = create_position_args(e_axis_default_mode="relative", location_detection_commands=["G28", "G29"])
+        position_args["position_restrictions"] = position_restrictions
+        GcodeProcessor.initialize_position_processor(position_args, key=self.key)
+        GcodeProcessor.initialize_gcode_queue_filter(
+            None, state_message_interval_seconds=0, update_position=True,
+            location_detection_commands=["G28", "G29"], key=self.key
+        )
+        self.file_line = 0
+        self.update(self.print_start_gcode)
+
+    @staticmethod
+    def create_restriction(
+        restriction_type, shape, x=None, y=None, x2=None, y2=None, r=None, calculate_intersections=False,
+        points=None
+    ):
+        return {
+            "type": restriction_type,
+            "shape": shape,
+            "x": x,
+            "y": y,
+            "x2": x2,
+            "y2": y2,
+            "r": r,
+            "calculate_intersections": calculate_intersections,
+            "points": points
+        }
+
+    def update(self, gcodes):
+        for gcode in gcodes:
+            self.file_line += 1
+            tags = {"source:file", "fileline:{0}".format(self.file_line)}
+            GcodeProcessor.filter_queued_gcode(gcode, tags, key=self.key)
+        return GcodeProcessor.get_current_position(key=self.key)
+
+    def test_no_restrictions(self):
+        """Without restrictions every position is in position."""
+        self.initialize([])
+        position = self.update(["G1 X10 Y10"])
+        self.assertTrue(position.is_in_position)
+        self.assertFalse(position.in_path_position)
+
+    def test_required_rect(self):
+        self.initialize([self.create_restriction("required", "rect", 10, 10, 20, 20)])
+        self.assertTrue(self.update(["G1 X15 Y15"]).is_in_position)
+        self.assertTrue(self.update(["G1 X20 Y10"]).is_in_position)
+        self.assertFalse(self.update(["G1 X20.1 Y10"]).is_in_position)
+        self.assertFalse(self.update(["G1 X200 Y150"]).is_in_position)
+
+    def test_forbidden_circle(self):
+        self.initialize([self.create_restriction("forbidden", "circle", 10, 10, r=1)])
+        self.assertTrue(self.update(["G1 X1 Y1"]).is_in_position)
+        self.assertTrue(self.update(["G1 X9 Y9"]).is_in_position)
+        self.assertFalse(self.update(["G1 X10 Y10"]).is_in_position)
+        self.assertFalse(self.update(["G1 X11 Y10"]).is_in_position)
+
+    def test_required_and_forbidden(self):
+        """Forbidden restrictions take priority over required restrictions."""
+        self.initialize([
+            self.create_restriction("required", "rect", 0, 0, 100, 100),
+            self.create_restriction("forbidden", "rect", 40, 40, 60, 60)
+        ])
+        self.assertTrue(self.update(["G1 X10 Y10"]).is_in_position)
+        self.assertFalse(self.update(["G1 X50 Y50"]).is_in_position)
+        self.assertFalse(self.update(["G1 X150 Y50"]).is_in_position)
+
+    def test_required_polygon(self):
+        self.initialize([
+            self.create_restriction("required", "polygon", points=[[0, 0], [20, 0], [0, 20]])
+        ])
+        self.assertTrue(self.update(["G1 X5 Y5"]).is_in_position)
+        self.assertTrue(self.update(["G1 X10 Y10"]).is_in_position)
+        self.assertFalse(self.update(["G1 X15 Y15"]).is_in_position)
+
+    def test_in_path_position(self):
+        self.initialize([self.create_restriction("required", "rect", 10, 10, 20, 20, calculate_intersections=True)])
+        position = self.update(["G1 X0 Y15", "G1 X30 Y15"])
+        self.assertFalse(position.is_in_position)
+        self.assertEqual(position.in_path_position["intersection"], [10.0, 15.0])
+        # moves that never cross the restriction have no in-path position
+        position = self.update(["G1 X30 Y30"])
+        self.assertFalse(position.in_path_position)
+
+    def test_in_path_position_not_calculated(self):
+        self.initialize([self.create_restriction("required", "rect", 10, 10, 20, 20)])
+        position = self.update(["G1 X0 Y15", "G1 X30 Y15"])
+        self.assertFalse(position.is_in_position)
+        self.assertFalse(position.in_path_position)
+
+    def test_performance(self):
+        restrictions = []
+        for index in range(50):
+            restrictions.append(
+                self.create_restriction(
+                    "forbidden", "circle", 5 + index * 4, 5 + index * 3, r=1, calculate_intersections=True
+                )
+            )
+        restrictions.append(self.create_restriction("required", "rect", 0, 0, 250, 200, calculate_intersections=True))
+        self.initialize(restrictions)
+        gcodes = []
+        for index in range(1000):
+            gcodes.append("G1 X{0:.3f} Y{1:.3f} E0.01".format(10 + (index % 200), 10 + (index % 150)))
+        start_time = time.perf_counter() if hasattr(time, "perf_counter") else time.time()
+        for index in range(100000):
+            self.file_line += 1
+            GcodeProcessor.filter_queued_gcode(
+                gcodes[index % 1000], {"source:file", "fileline:{0}".format(self.file_line)}, key=self.key
+            )
+        total_time = (time.perf_counter() if hasattr(time, "perf_counter") else time.time()) - start_time
+        microseconds_per_line = total_time * 1000000.0 / 100000
+        print("Position restrictions: {0:.3f} microseconds per line.".format(microseconds_per_line))
+        self.assertLess(microseconds_per_line, self.max_microseconds_per_line)
+
+
+class SnapshotPlanLocation(object):
+    def __init__(self, file_gcode_number, file_position):
+        self.file_gcode_number = file_gcode_number
+        self.file_position = file_position
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestGcodeQueueFilter))
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestNativeSnapshotTrigger))
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestPositionRestrictions))
+    unittest.TextTestRunner(verbosity=3).run(suite)
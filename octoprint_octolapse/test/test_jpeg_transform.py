@@ -0,0 +1,127 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import os
+import shutil
+import tempfile
+import unittest
+
+from PIL import Image
+
+import GcodePositionProcessor
+
+TRANSFORMS = {
+    "flip_left_right": Image.FLIP_LEFT_RIGHT,
+    "flip_top_bottom": Image.FLIP_TOP_BOTTOM,
+    "rotate_90": Image.ROTATE_90,
+    "rotate_180": Image.ROTATE_180,
+    "rotate_270": Image.ROTATE_270,
+    "transpose": Image.TRANSPOSE,
+}
+
+
+class TestJpegTransform(unittest.TestCase):
+    def setUp(self):
+        self.temp_directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.temp_directory)
+
+    def create_snapshot(self, name, width, height, subsampling=2):
+        image = Image.new('RGB', (width, height))
+        pixels = image.load()
+        for y in range(height):
+            for x in range(width):
+                pixels[x, y] = ((x * 7 + y) % 256, (y * 3 + x // 5) % 256, (x * y) % 256)
+        path = os.path.join(self.temp_directory, name)
+        image.save(path, 'JPEG', quality=90, subsampling=subsampling)
+        return path
+
+    def assertImagesAlmostEqual(self, actual, expected, delta=4):
+        self.assertEqual(actual.size, expected.size)
+        differences = [abs(a - b) for a, b in zip(actual.tobytes(), expected.tobytes())]
+        self.assertLessEqual(max(differences), delta)
+
+    def test_transforms_match_pil(self):
+        for subsampling in [0, 2]:
+            source_path = self.create_snapshot("source.jpg", 64, 48, subsampling)
+            with Image.open(source_path) as source:
+                source.load()
+                for name, method in TRANSFORMS.items():
+                    path = os.path.join(self.temp_directory, name + ".jpg")
+                    shutil.copyfile(source_path, path)
+                    self.assertTrue(GcodePositionProcessor.TransformJpeg(path, name), name)
+                    with Image.open(path) as transformed:
+                        self.assertImagesAlmostEqual(transformed, source.transpose(method))
+
+    def test_transform_is_lossless(self):
+        """Transforming and then undoing the transform gives back the same coefficients."""
+        path = self.create_snapshot("lossless.jpg", 64, 48)
+        with Image.open(path) as original:
+            expected = original.tobytes()
+        for name in ["rotate_90", "rotate_270", "flip_left_right", "flip_left_right"]:
+            self.assertTrue(GcodePositionProcessor.TransformJpeg(path, name))
+        with Image.open(path) as image:
+            self.assertEqual(image.tobytes(), expected)
+
+    def test_partial_mcu_edges_are_not_transformed(self):
+        path = self.create_snapshot("partial.jpg", 60, 44)
+        with open(path, 'rb') as snapshot_file:
+            original = snapshot_file.read()
+        self.assertFalse(GcodePositionProcessor.TransformJpeg(path, "flip_left_right"))
+        self.assertFalse(GcodePositionProcessor.TransformJpeg(path, "rotate_180"))
+        with open(path, 'rb') as snapshot_file:
+            self.assertEqual(snapshot_file.read(), original)
+        # Transposing never mirrors an edge, so it always works
+        self.assertTrue(GcodePositionProcessor.TransformJpeg(path, "transpose"))
+        with Image.open(path) as image:
+            self.assertEqual(image.size, (44, 60))
+
+    def test_unknown_transform(self):
+        path = self.create_snapshot("unknown.jpg", 16, 16)
+        self.assertFalse(GcodePositionProcessor.TransformJpeg(path, "rotate_45"))
+
+    def test_decode_scaled(self):
+        path = os.path.join(self.temp_directory, "scaled.jpg")
+        gradient = Image.linear_gradient('L').resize((640, 480))
+        Image.merge('RGB', [gradient, gradient.transpose(Image.ROTATE_90).resize((640, 480)), gradient]).save(
+            path, 'JPEG', quality=90
+        )
+        self.assertEqual(GcodePositionProcessor.DecodeJpegScaled(path, 500, 1)[0:2], (640, 480))
+        self.assertEqual(GcodePositionProcessor.DecodeJpegScaled(path, 300, 1)[0:2], (320, 240))
+        width, height, pixels = GcodePositionProcessor.DecodeJpegScaled(path, 80, 60)
+        self.assertEqual((width, height), (80, 60))
+        self.assertEqual(len(pixels), 80 * 60 * 3)
+        with Image.open(path) as image:
+            expected = image.convert('RGB').resize((80, 60), Image.BOX)
+        differences = [abs(a - b) for a, b in zip(pixels, expected.tobytes())]
+        self.assertLessEqual(max(differences), 8)
+
+    def test_decode_scaled_unsupported(self):
+        path = os.path.join(self.temp_directory, "progressive.jpg")
+        Image.new('RGB', (32, 32), (1, 2, 3)).save(path, 'JPEG', progressive=True)
+        self.assertIsNone(GcodePositionProcessor.DecodeJpegScaled(path, 8, 8))
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestJpegTransform))
+    unittest.TextTestRunner(verbosity=3).run(suite)
@@ -0,0 +1,89 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import time
+import logging
+import unittest
+
+import GcodePositionProcessor
+from octoprint_octolapse.gcode_processor import GcodeProcessor, Pos
+from octoprint_octolapse.log import LoggingConfigurator, VERBOSE
+from octoprint_octolapse.test.testing_utilities import create_position_args
+
+
+class RecordingHandler(logging.Handler):
+    def __init__(self):
+        super(RecordingHandler, self).__init__(logging.NOTSET)
+        self.records = []
+
+    def emit(self, record):
+        self.records.append(record)
+
+
+class TestNativeLogging(unittest.TestCase):
+    key = "test_native_logging"
+
+    def setUp(self):
+        GcodeProcessor.initialize_position_processor(create_position_args(), key=self.key)
+        self.logger = LoggingConfigurator().get_logger("octoprint_octolapse.gcode_position")
+        self.original_level = self.logger.level
+        self.handler = RecordingHandler()
+        self.logger.addHandler(self.handler)
+
+    def tearDown(self):
+        self.logger.removeHandler(self.handler)
+        self.logger.setLevel(self.original_level)
+        GcodePositionProcessor.RefreshLogLevels()
+
+    def set_level(self, level):
+        self.logger.setLevel(level)
+        GcodePositionProcessor.RefreshLogLevels()
+        GcodePositionProcessor.FlushLog()
+        self.handler.records = []
+
+    def get_messages(self):
+        return [record.getMessage() for record in self.handler.records]
+
+    def test_messages_are_flushed_before_returning(self):
+        self.set_level(VERBOSE)
+        GcodeProcessor.update("G1 X10", Pos(), key=self.key)
+        self.assertIn("Updating current position from gcode.", self.get_messages())
+
+    def test_filtered_messages_are_not_sent(self):
+        self.set_level(logging.ERROR)
+        for _ in range(10):
+            GcodeProcessor.update("G1 X10", Pos(), key=self.key)
+        self.assertEqual(self.get_messages(), [])
+
+    def test_messages_stay_in_order(self):
+        self.set_level(VERBOSE)
+        for gcode in ["G1 X10", "G1 X20"]:
+            GcodeProcessor.update(gcode, Pos(), key=self.key)
+        GcodePositionProcessor.Undo(self.key)
+        messages = self.get_messages()
+        self.assertEqual(messages.count("Updating current position from gcode."), 2)
+        self.assertEqual(messages[-1], "Undoing the last gcode position update.")
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestNativeLogging))
+    unittest.TextTestRunner(verbosity=3).run(suite)
@@ -0,0 +1,98 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import time
+import json
+import os
+import shutil
+import tempfile
+import unittest
+
+from octoprint_octolapse.gcode_processor import GcodeProcessor, Pos
+from octoprint_octolapse.test.testing_utilities import create_position_args, create_sample_print
+
+
+class TestNativeStats(unittest.TestCase):
+    key = "test_native_stats"
+
+    def setUp(self):
+        GcodeProcessor.initialize_position_processor(create_position_args(), key=self.key)
+        self.assertTrue(GcodeProcessor.set_stats_enabled(True))
+        GcodeProcessor.reset_stats()
+        self.temp_directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        GcodeProcessor.set_stats_enabled(False)
+        GcodeProcessor.reset_stats()
+        shutil.rmtree(self.temp_directory)
+
+    def update(self, gcodes):
+        position = Pos()
+        for gcode in gcodes:
+            GcodeProcessor.update(gcode, position, key=self.key)
+
+    def test_update_calls_are_counted(self):
+        gcodes = create_sample_print(num_layers=2, moves_per_layer=10)
+        self.update(gcodes)
+        GcodeProcessor.parse("G1 X10")
+        stats = GcodeProcessor.get_stats()
+        self.assertTrue(stats["enabled"])
+        update_stats = stats["calls"]["update"]
+        self.assertEqual(update_stats["count"], len(gcodes))
+        self.assertEqual(sum(count for _, count in update_stats["histogram"]), len(gcodes))
+        self.assertLessEqual(update_stats["min_seconds"], update_stats["max_seconds"])
+        self.assertGreater(update_stats["seconds"], 0)
+        self.assertEqual(stats["calls"]["parse"]["count"], 1)
+        # Update and Parse both tokenize the gcode, and every update goes through the position
+        self.assertEqual(stats["phases"]["tokenize"]["count"], len(gcodes) + 1)
+        self.assertEqual(stats["phases"]["position_update"]["count"], len(gcodes))
+
+    def test_reset_clears_stats(self):
+        self.update(["G1 X10"])
+        GcodeProcessor.reset_stats()
+        stats = GcodeProcessor.get_stats()
+        self.assertEqual(stats["calls"]["update"]["count"], 0)
+        self.assertEqual(stats["calls"]["update"]["histogram"], [])
+        self.assertEqual(stats["phases"]["position_update"]["count"], 0)
+
+    def test_disabled_stats_are_not_collected(self):
+        GcodeProcessor.set_stats_enabled(False)
+        self.update(["G1 X10"])
+        stats = GcodeProcessor.get_stats()
+        self.assertFalse(stats["enabled"])
+        self.assertEqual(stats["calls"]["update"]["count"], 0)
+
+    def test_write_trace(self):
+        self.update(["G1 X10", "G1 X20"])
+        trace_path = os.path.join(self.temp_directory, "trace.json")
+        self.assertTrue(GcodeProcessor.write_stats_trace(trace_path))
+        with open(trace_path) as trace_file:
+            trace = json.load(trace_file)
+        events = [event for event in trace["traceEvents"] if event["name"] == "update"]
+        self.assertEqual(len(events), 2)
+        self.assertEqual(events[0]["ph"], "X")
+        self.assertLessEqual(events[0]["ts"] + events[0]["dur"], events[1]["ts"])
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestNativeStats))
+    unittest.TextTestRunner(verbosity=3).run(suite)
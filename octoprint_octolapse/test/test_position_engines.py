@@ -0,0 +1,101 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import unittest
+
+from octoprint_octolapse.gcode_processor import GcodeProcessor, Pos
+from octoprint_octolapse.test.testing_utilities import create_position_args, create_sample_print
+
+
+def create_engine_args(num_extruders=1, bed_type="rectangular", bounded=False):
+    position_args = create_position_args()
+    position_args["num_extruders"] = num_extruders
+    position_args["slicer_settings"]["extruders"] = [
+        {"retraction_length": 0.8, "z_lift_height": 0.5} for _ in range(num_extruders)
+    ]
+    position_args["volume"]["bed_type"] = bed_type
+    if bounded:
+        position_args["volume"]["bounds"] = {
+            "min_x": 0.0, "max_x": 50.0, "min_y": 0.0, "max_y": 50.0, "min_z": 0.0, "max_z": 200.0
+        }
+    return position_args
+
+
+class TestPositionEngines(unittest.TestCase):
+    """The specialized position engines must agree with each other for the same print."""
+    reference_key = "test_position_engine_reference"
+
+    def setUp(self):
+        GcodeProcessor.initialize_position_processor(create_engine_args(num_extruders=2), key=self.reference_key)
+
+    def assert_engines_agree(self, key, gcodes):
+        reference_position = Pos()
+        position = Pos()
+        for gcode in gcodes:
+            GcodeProcessor.update(gcode, reference_position, key=self.reference_key)
+            GcodeProcessor.update(gcode, position, key=key)
+            self.assertEqual(reference_position.x, position.x)
+            self.assertEqual(reference_position.y, position.y)
+            self.assertEqual(reference_position.z, position.z)
+            self.assertEqual(reference_position.layer, position.layer)
+            self.assertEqual(reference_position.is_zhop, position.is_zhop)
+            reference_extruder = reference_position.get_current_extruder()
+            extruder = position.get_current_extruder()
+            self.assertEqual(reference_extruder.is_extruding, extruder.is_extruding)
+            self.assertEqual(reference_extruder.is_retracted, extruder.is_retracted)
+            self.assertEqual(reference_extruder.is_deretracted, extruder.is_deretracted)
+            self.assertEqual(reference_extruder.extrusion_length_total, extruder.extrusion_length_total)
+        return position
+
+    def test_single_extruder(self):
+        key = "test_position_engine_single_extruder"
+        GcodeProcessor.initialize_position_processor(create_engine_args(), key=key)
+        position = self.assert_engines_agree(key, create_sample_print(num_layers=5))
+        self.assertEqual(position.layer, 5)
+
+    def test_rectangular_bounds(self):
+        key = "test_position_engine_rectangular_bounds"
+        GcodeProcessor.initialize_position_processor(create_engine_args(bounded=True), key=key)
+        self.assert_engines_agree(key, create_sample_print(num_layers=2))
+        position = Pos()
+        GcodeProcessor.update("G1 X60 Y10", position, key=key)
+        self.assertFalse(position.is_in_bounds)
+        GcodeProcessor.update("G1 X40 Y10", position, key=key)
+        self.assertTrue(position.is_in_bounds)
+
+    def test_circular_bounds(self):
+        key = "test_position_engine_circular_bounds"
+        GcodeProcessor.initialize_position_processor(
+            create_engine_args(bed_type="circular", bounded=True), key=key
+        )
+        position = Pos()
+        for gcode in ["G21", "G90", "M82", "G28", "G1 X30 Y30 Z0.2"]:
+            GcodeProcessor.update(gcode, position, key=key)
+        # 30,30 is inside the radius of 50
+        self.assertTrue(position.is_in_bounds)
+        GcodeProcessor.update("G1 X40 Y40", position, key=key)
+        self.assertFalse(position.is_in_bounds)
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestPositionEngines))
+    unittest.TextTestRunner(verbosity=3).run(suite)
@@ -0,0 +1,111 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import time
+import unittest
+
+from octoprint_octolapse.gcode_processor import GcodeProcessor, Pos
+from octoprint_octolapse.test.testing_utilities import create_position_args, create_sample_print
+
+
+class TestFixedPointPosition(unittest.TestCase):
+    double_key = "test_position_double"
+    fixed_key = "test_position_fixed_point"
+    # each update goes through the python wrapper, which copies the position back into a Pos
+    max_microseconds_per_line = 40.0
+
+    def setUp(self):
+        GcodeProcessor.initialize_position_processor(create_position_args(), key=self.double_key)
+        GcodeProcessor.initialize_position_processor(create_position_args(fixed_point_decimals=6), key=self.fixed_key)
+
+    @staticmethod
+    def update(gcodes, key):
+        position = Pos()
+        for gcode in gcodes:
+            GcodeProcessor.update(gcode, position, key=key)
+        return position
+
+    def test_relative_moves_do_not_drift(self):
+        """Many small relative moves return exactly to the start in fixed point mode."""
+        gcodes = ["G21", "G90", "M83", "G28", "G1 X10 Y10 Z0.2", "G91"]
+        gcodes += ["G1 X0.1 Y0.1 E0.01"] * 1000
+        gcodes += ["G1 X-0.1 Y-0.1 E-0.01"] * 1000
+        position = self.update(gcodes, self.fixed_key)
+        self.assertEqual(position.x, 10)
+        self.assertEqual(position.y, 10)
+        self.assertEqual(position.get_current_extruder().extrusion_length_total, 0)
+        # The double mode accumulates rounding error
+        position = self.update(gcodes, self.double_key)
+        self.assertNotEqual(position.x, 10)
+        self.assertNotEqual(position.y, 10)
+        self.assertAlmostEqual(position.x, 10, 6)
+        self.assertAlmostEqual(position.y, 10, 6)
+
+    def test_parameters_are_rounded_to_units(self):
+        self.update(["G21", "G90", "M82", "G28"], self.fixed_key)
+        position = self.update(["G1 X1.2345675 Y-1.2345675 Z0.0000004"], self.fixed_key)
+        self.assertEqual(position.x, 1.234568)
+        self.assertEqual(position.y, -1.234568)
+        self.assertEqual(position.z, 0)
+
+    def test_tiny_moves_below_the_unit_are_ignored(self):
+        self.update(["G21", "G91", "M82", "G28"], self.fixed_key)
+        position = self.update(["G1 X0.0000001"], self.fixed_key)
+        self.assertFalse(position.has_position_changed)
+
+    def test_modes_agree(self):
+        gcodes = create_sample_print(num_layers=5)
+        double_position = Pos()
+        fixed_position = Pos()
+        for gcode in gcodes:
+            GcodeProcessor.update(gcode, double_position, key=self.double_key)
+            GcodeProcessor.update(gcode, fixed_position, key=self.fixed_key)
+            self.assertAlmostEqual(double_position.x, fixed_position.x, 6)
+            self.assertAlmostEqual(double_position.y, fixed_position.y, 6)
+            self.assertAlmostEqual(double_position.z, fixed_position.z, 6)
+            self.assertEqual(double_position.layer, fixed_position.layer)
+            self.assertEqual(double_position.is_layer_change, fixed_position.is_layer_change)
+            self.assertEqual(
+                double_position.get_current_extruder().is_extruding,
+                fixed_position.get_current_extruder().is_extruding
+            )
+            self.assertEqual(
+                double_position.get_current_extruder().is_retracted,
+                fixed_position.get_current_extruder().is_retracted
+            )
+        self.assertEqual(fixed_position.layer, 5)
+
+    def test_throughput(self):
+        """Both modes must update the position within the per line time budget."""
+        gcodes = create_sample_print()
+        for key in [self.double_key, self.fixed_key]:
+            start_time = time.perf_counter() if hasattr(time, "perf_counter") else time.time()
+            self.update(gcodes, key)
+            total_time = (time.perf_counter() if hasattr(time, "perf_counter") else time.time()) - start_time
+            microseconds_per_line = total_time * 1000000.0 / len(gcodes)
+            print("Position update ({0}): {1:.3f} microseconds per line.".format(key, microseconds_per_line))
+            self.assertLess(microseconds_per_line, self.max_microseconds_per_line)
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestFixedPointPosition))
+    unittest.TextTestRunner(verbosity=3).run(suite)
@@ -0,0 +1,205 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import json
+import os
+import shutil
+import tempfile
+import threading
+import unittest
+
+import GcodePositionProcessor
+import octoprint_octolapse.preprocessing_service as preprocessing_service
+from octoprint_octolapse.preprocessing_service import PlanCache, PreprocessingService, PreprocessingServiceClient
+from octoprint_octolapse.settings import StabilizationProfile
+from octoprint_octolapse.test.testing_utilities import (
+    create_gcode_file, create_position_args, create_smart_layer_args, create_stabilization_args
+)
+
+
+class FakeConnection(object):
+    def __init__(self):
+        self.messages = []
+
+    def sendall(self, data):
+        self.messages.append(json.loads(data.decode("utf-8")))
+
+
+class TestPreprocessingService(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+        self.service = PreprocessingService(os.path.join(self.directory, "service.sock"), max_jobs=1)
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def create_request(self, client_id, file_name, height_increment=0.2):
+        file_path = os.path.join(self.directory, file_name)
+        if not os.path.exists(file_path):
+            with open(file_path, "w") as gcode_file:
+                gcode_file.write("; {0}\nG1 X10 Y10 Z0.2 E1\n".format(file_name))
+        stabilization_args = {
+            "file_path": file_path,
+            "height_increment": height_increment,
+            "notification_period_seconds": 1,
+            "on_progress_received": None,
+            "gcode_generator": None,
+        }
+        return json.loads(json.dumps(preprocessing_service.create_request(
+            client_id, preprocessing_service.TRIGGER_TYPE_SMART_LAYER, {"volume": {}}, stabilization_args, {},
+            StabilizationProfile().get_stabilization_paths()
+        )))
+
+    def submit(self, request):
+        subscriber = preprocessing_service._Subscriber(FakeConnection())
+        return self.service.submit(request, subscriber), subscriber
+
+    def test_identical_requests_share_a_job(self):
+        job_1, _ = self.submit(self.create_request("a", "one.gcode"))
+        job_2, _ = self.submit(self.create_request("b", "one.gcode"))
+        self.assertIs(job_1, job_2)
+        self.assertEqual(len(job_1.subscribers), 2)
+        # copies of the same file with the same arguments are the same request
+        shutil.copy(os.path.join(self.directory, "one.gcode"), os.path.join(self.directory, "copy.gcode"))
+        job_3, _ = self.submit(self.create_request("c", "copy.gcode"))
+        self.assertIs(job_1, job_3)
+        # different arguments are not
+        job_4, _ = self.submit(self.create_request("a", "one.gcode", height_increment=0.4))
+        self.assertIsNot(job_1, job_4)
+
+    def test_clients_are_served_in_turn(self):
+        a_jobs = [self.submit(self.create_request("a", "a{0}.gcode".format(index)))[0] for index in range(3)]
+        b_jobs = [self.submit(self.create_request("b", "b{0}.gcode".format(index)))[0] for index in range(2)]
+        order = [self.service._get_next_job() for _ in range(5)]
+        self.assertEqual(order, [a_jobs[0], b_jobs[0], a_jobs[1], b_jobs[1], a_jobs[2]])
+
+    def test_unsubscribing_cancels_a_waiting_job(self):
+        job, subscriber_1 = self.submit(self.create_request("a", "one.gcode"))
+        _, subscriber_2 = self.submit(self.create_request("b", "one.gcode"))
+        self.service.unsubscribe(job, subscriber_1)
+        self.assertFalse(job.is_cancelled)
+        self.service.unsubscribe(job, subscriber_2)
+        self.assertTrue(job.is_cancelled)
+        self.assertEqual(self.service._jobs, {})
+        self.assertEqual(len(self.service._client_queues), 0)
+
+    def test_cancelled_jobs_are_not_shared(self):
+        request = self.create_request("a", "one.gcode")
+        job, subscriber = self.submit(request)
+        self.assertIs(self.service._get_next_job(), job)
+        # The last client leaves while the job is running, so it stays in _jobs until the native code stops
+        self.service.unsubscribe(job, subscriber)
+        self.assertTrue(job.is_cancelled)
+        new_job, _ = self.submit(self.create_request("b", "one.gcode"))
+        self.assertIsNot(new_job, job)
+        self.assertFalse(new_job.is_cancelled)
+        key = self.service.get_request_key(request)
+        self.assertIs(self.service._jobs[key], new_job)
+        # When the cancelled job finishes, it doesn't remove the new one
+        self.service._remove_job(job)
+        self.assertIs(self.service._jobs[key], new_job)
+
+    def test_cached_results_are_sent_immediately(self):
+        request = self.create_request("a", "one.gcode")
+        self.service._cache.put(self.service.get_request_key(request), [[], 1.0, 2, 3, 0, [], []])
+        job, subscriber = self.submit(request)
+        self.assertIsNone(job)
+        self.assertEqual(subscriber._connection.messages, [
+            {"type": preprocessing_service.MESSAGE_TYPE_RESULT, "results": [[], 1.0, 2, 3, 0, [], []]}
+        ])
+
+    def test_plan_cache(self):
+        cache_directory = os.path.join(self.directory, "cache")
+        cache = PlanCache(cache_directory, max_entries=2)
+        for index in range(3):
+            cache.put("key{0}".format(index), [index])
+        self.assertIsNone(cache.get("key0"))
+        self.assertEqual(cache.get("key2"), [2])
+        self.assertEqual(len(os.listdir(cache_directory)), 2)
+        # a new cache reads the results written by the last one
+        self.assertEqual(PlanCache(cache_directory).get("key2"), [2])
+
+    def test_client_falls_back_without_a_service(self):
+        client = PreprocessingServiceClient(os.path.join(self.directory, "missing.sock"))
+        self.assertFalse(client.is_available())
+        self.assertIsNone(client.get_snapshot_plans(
+            preprocessing_service.TRIGGER_TYPE_SMART_LAYER, {}, {"on_progress_received": None}, {}, {}
+        ))
+
+
+
+class TestPreprocessingServiceSocket(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+        self.socket_path = os.path.join(self.directory, "service.sock")
+        self.service = PreprocessingService(self.socket_path, max_jobs=1)
+        self.service.start()
+        self.server_thread = threading.Thread(target=self.service.serve_forever)
+        self.server_thread.daemon = True
+        self.server_thread.start()
+        self.position_args = create_position_args()
+        self.smart_layer_args = create_smart_layer_args()
+        self.stabilization_paths = StabilizationProfile().get_stabilization_paths()
+
+    def tearDown(self):
+        self.service.stop()
+        self.server_thread.join()
+        shutil.rmtree(self.directory)
+
+    def get_snapshot_plans(self, client_id, file_path, on_progress_received=None):
+        stabilization_args = create_stabilization_args(file_path, self.position_args)
+        stabilization_args["notification_period_seconds"] = 0.01
+        stabilization_args["on_progress_received"] = on_progress_received or (lambda *progress: True)
+        return PreprocessingServiceClient(self.socket_path, client_id).get_snapshot_plans(
+            preprocessing_service.TRIGGER_TYPE_SMART_LAYER, self.position_args, stabilization_args,
+            self.smart_layer_args, self.stabilization_paths
+        )
+
+    def get_expected_plans(self, file_path):
+        stabilization_args = create_stabilization_args(file_path, self.position_args)
+        stabilization_args["on_progress_received"] = lambda *progress: True
+        results = GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
+            self.position_args, stabilization_args, self.smart_layer_args
+        )
+        return tuple(json.loads(json.dumps(list(results))))
+
+    def test_results_match_in_process_preprocessing(self):
+        file_path = create_gcode_file(self.directory, "print.gcode", 50)
+        expected = self.get_expected_plans(file_path)
+        self.assertEqual(len(expected[0]), 50)
+        results = self.get_snapshot_plans("a", file_path)
+        # everything but the processing time
+        self.assertEqual(results[0], expected[0])
+        self.assertEqual(results[2:], expected[2:])
+        # the second request is answered from the plan cache
+        self.assertEqual(self.get_snapshot_plans("b", file_path), results)
+
+    def test_cancelled_job_results_are_not_sent_to_new_clients(self):
+        file_path = create_gcode_file(self.directory, "print.gcode", 4000)
+        cancelled = self.get_snapshot_plans("a", file_path, lambda *progress: False)
+        self.assertEqual(cancelled, preprocessing_service._cancelled_results)
+        # An identical request sent right away must not receive the plans of the cancelled job
+        results = self.get_snapshot_plans("b", file_path)
+        self.assertEqual(len(results[0]), 4000)
+
+
+if __name__ == '__main__':
+    unittest.main()
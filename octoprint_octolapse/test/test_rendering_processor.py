@@ -0,0 +1,217 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import unittest
+from unittest.mock import Mock, patch
+
+import octoprint_octolapse.render as render
+from octoprint_octolapse.render import RenderingProcessor
+
+# the memory estimate for a job that has no snapshots, which assumes 1080p frames
+FRAME_MB = 1920 * 1080 * 3 / (1024.0 * 1024.0)
+
+
+def estimate_memory_mb(cores):
+    return FRAME_MB * (4 * cores + 16)
+
+
+class FakeRenderJob(object):
+    """Replaces TimelapseRenderJob so that rendering jobs can be started and finished without ffmpeg."""
+    started_jobs = []
+
+    def __init__(
+        self, render_job_info, on_start_event, on_render_start, on_render_error, on_render_success,
+        on_render_progress, delete_snapshots_callback, archive_snapshots_callback
+    ):
+        self.render_job_info = render_job_info
+        self.on_start_event = on_start_event
+        self.daemon = False
+        self.is_low_priority = None
+        self.is_finished = False
+        self.rendering_error = None
+        FakeRenderJob.started_jobs.append(self)
+
+    def start(self):
+        self.on_start_event.set()
+
+    def is_alive(self):
+        return not self.is_finished
+
+    def join(self):
+        self.render_job_info.rendering_error = self.rendering_error
+        return self.render_job_info
+
+    def set_low_priority(self, is_low_priority):
+        self.is_low_priority = is_low_priority
+
+
+class FakeRenderJobInfo(object):
+    def __init__(self, job_guid, camera_guid, thread_count):
+        self.job_guid = job_guid
+        self.camera_guid = camera_guid
+        self.rendering = Mock(thread_count=thread_count)
+        self.thread_count = thread_count
+        # the snapshot directory doesn't exist, so the default frame size is used to estimate memory
+        self.snapshot_directory = "/nonexistent/octolapse/snapshots"
+        self.temporary_directory = "/nonexistent/octolapse"
+        self.rendering_error = None
+
+
+class TestRenderingProcessor(unittest.TestCase):
+    def setUp(self):
+        FakeRenderJob.started_jobs = []
+        self.job_patcher = patch.object(render, "TimelapseRenderJob", FakeRenderJob)
+        self.job_patcher.start()
+        self.main_settings = Mock(rendering_core_budget=8, rendering_memory_budget_mb=10000)
+        # don't look for unfinished renderings
+        self.main_settings.test_directories.return_value = (False, {})
+        self.is_printing = False
+        self.thread_counts = {}
+        self.on_end = Mock()
+        self.processor = RenderingProcessor(
+            None, "/nonexistent/octolapse", "0.0.0", None, None, Mock(),
+            lambda: Mock(main_settings=self.main_settings), Mock(), Mock(), Mock(), Mock(), self.on_end, Mock(),
+            Mock(), Mock(), is_printing_callback=lambda: self.is_printing
+        )
+        self.processor._get_metadata_for_rendering_files = lambda job_guid, camera_guid, temporary_directory: {
+            "job_guid": job_guid, "camera_guid": camera_guid, "file_size": 1
+        }
+        self.processor._get_job_settings = (
+            lambda job_guid, camera_guid, rendering_profile, camera_profile, temporary_directory:
+            FakeRenderJobInfo(job_guid, camera_guid, self.thread_counts.get(camera_guid, 1))
+        )
+        self.processor._clean_temporary_directory = Mock()
+
+    def tearDown(self):
+        self.job_patcher.stop()
+
+    def add_jobs(self, camera_guids, job_guid="job"):
+        for camera_guid in camera_guids:
+            self.assertTrue(self.processor._add_job(job_guid, camera_guid, None, None, "/nonexistent/octolapse"))
+
+    def get_running_cores(self):
+        return dict(
+            (camera_guid, running_job["cores"])
+            for (job_guid, camera_guid), running_job in self.processor._running_jobs.items()
+        )
+
+    def test_cores_are_split_between_waiting_jobs(self):
+        """The free cores are split evenly between the waiting jobs, and the remainder goes to the last job."""
+        self.main_settings.rendering_core_budget = 7
+        self.add_jobs(["a", "b", "c"])
+        self.processor._start_waiting_jobs()
+        self.assertEqual({"a": 2, "b": 2, "c": 3}, self.get_running_cores())
+        for job in FakeRenderJob.started_jobs:
+            # the cores are passed on to ffmpeg
+            self.assertEqual(
+                self.get_running_cores()[job.render_job_info.camera_guid], job.render_job_info.thread_count
+            )
+            self.assertTrue(job.daemon)
+            self.assertFalse(job.is_low_priority)
+
+    def test_requested_threads_are_given_to_each_job(self):
+        """A job gets the threads requested by its rendering profile, even if that is more than its share."""
+        self.thread_counts = {"a": 6}
+        self.add_jobs(["a", "b"])
+        self.processor._start_waiting_jobs()
+        self.assertEqual({"a": 6, "b": 2}, self.get_running_cores())
+
+    def test_a_core_is_kept_free_while_printing(self):
+        self.is_printing = True
+        self.main_settings.rendering_core_budget = 4
+        self.add_jobs(["a", "b", "c"])
+        self.processor._start_waiting_jobs()
+        self.assertEqual({"a": 1, "b": 1, "c": 1}, self.get_running_cores())
+        for job in FakeRenderJob.started_jobs:
+            self.assertTrue(job.is_low_priority)
+
+    def test_always_start_one_job(self):
+        """The first job is started even if it exceeds the core and memory budgets."""
+        self.main_settings.rendering_core_budget = 2
+        self.main_settings.rendering_memory_budget_mb = 1
+        self.thread_counts = {"a": 4, "b": 1}
+        self.add_jobs(["a", "b"])
+        self.processor._start_waiting_jobs()
+        # the requested threads are limited to the core budget
+        self.assertEqual({"a": 2}, self.get_running_cores())
+
+    def test_jobs_wait_when_the_core_budget_is_used(self):
+        self.main_settings.rendering_core_budget = 4
+        self.thread_counts = {"a": 3, "b": 2}
+        self.add_jobs(["a", "b", "c"])
+        self.processor._start_waiting_jobs()
+        # b requests more than the single free core, so b and c wait
+        self.assertEqual({"a": 3}, self.get_running_cores())
+        self.assertEqual(2, self.processor._get_waiting_rendering_job_count())
+
+    def test_jobs_wait_when_the_memory_budget_is_used(self):
+        self.main_settings.rendering_memory_budget_mb = estimate_memory_mb(4) + estimate_memory_mb(2) - 1
+        self.add_jobs(["a", "b"])
+        self.processor._start_waiting_jobs()
+        # a gets half of the cores, and b would get the rest, but there isn't enough memory left for it
+        self.assertEqual({"a": 4}, self.get_running_cores())
+        self.assertEqual(estimate_memory_mb(4), self.processor._running_jobs[("job", "a")]["memory_mb"])
+        self.main_settings.rendering_memory_budget_mb += estimate_memory_mb(4)
+        self.processor._start_waiting_jobs()
+        self.assertEqual({"a": 4, "b": 4}, self.get_running_cores())
+
+    def test_finished_jobs_are_reaped(self):
+        self.main_settings.rendering_core_budget = 2
+        self.thread_counts = {"a": 2}
+        self.add_jobs(["a", "b"])
+        self.add_jobs(["c"], job_guid="job2")
+        self.processor._start_waiting_jobs()
+        self.assertEqual({"a": 2}, self.get_running_cores())
+
+        # nothing is reaped while the job is running
+        self.processor._end_finished_jobs()
+        self.assertEqual(1, len(self.processor._running_jobs))
+        self.assertEqual(3, self.processor._get_pending_rendering_job_count())
+
+        # a finished job is removed from the running and pending jobs, and the freed cores are used
+        FakeRenderJob.started_jobs[0].is_finished = True
+        self.processor._end_finished_jobs()
+        self.assertEqual({}, self.get_running_cores())
+        self.assertEqual({"job": ["b"], "job2": ["c"]}, dict(
+            (job_guid, list(camera_jobs)) for job_guid, camera_jobs in self.processor._pending_rendering_jobs.items()
+        ))
+        self.assertEqual(["b", "c"], [rendering["camera_guid"] for rendering in self.processor._renderings_in_process])
+        self.assertEqual([], self.processor._unfinished_renderings)
+        self.processor._start_waiting_jobs()
+        self.assertEqual({"b": 1, "c": 1}, self.get_running_cores())
+
+        # failed jobs are moved to the unfinished renderings
+        FakeRenderJob.started_jobs[1].is_finished = True
+        FakeRenderJob.started_jobs[1].rendering_error = "error"
+        self.processor._end_finished_jobs()
+        self.assertEqual({"job2": {"c"}}, dict(
+            (job_guid, set(camera_jobs)) for job_guid, camera_jobs in self.processor._pending_rendering_jobs.items()
+        ))
+        self.assertEqual(["b"], [rendering["camera_guid"] for rendering in self.processor._unfinished_renderings])
+        self.on_end.assert_not_called()
+
+        # the end callback is called once all of the jobs have finished
+        FakeRenderJob.started_jobs[2].is_finished = True
+        self.processor._end_finished_jobs()
+        self.assertEqual({}, self.processor._running_jobs)
+        self.assertEqual({}, self.processor._pending_rendering_jobs)
+        self.assertEqual([], self.processor._renderings_in_process)
+        self.on_end.assert_called_once_with()
@@ -0,0 +1,146 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import os
+import shutil
+import tempfile
+import unittest
+
+from octoprint_octolapse.settings_preprocessor import (
+    GcodeFileProcessor, Simplify3dSettingsProcessor, Slic3rSettingsProcessor, CuraSettingsProcessor
+)
+
+
+class PythonGcodeFileProcessor(GcodeFileProcessor):
+    """Reads the file line by line in python, like it was done before the native extractor existed."""
+    def process_native(self, processors, target_file_path):
+        return None
+
+
+SLIC3R_HEADER = [
+    "; generated by PrusaSlicer 2.3.0+linux-x64 on 2021-01-01 at 10:00:00",
+    "",
+    "; external perimeters extrusion width = 0.45mm",
+]
+SLIC3R_FOOTER = [
+    "; filament used [mm] = 1000.0",
+    "; layer_height = 0.15",
+    "; retract_length = 0.8,0.8",
+    "; retract_lift = 0.6,0.6",
+    "; retract_speed = 35,35",
+    "; travel_speed = 180",
+    "; wipe = 0,0",
+]
+SIMPLIFY_3D_HEADER = [
+    "; G-Code generated by Simplify3D(R) Version 4.1.2",
+    "; Jan 2, 2021 at 10:21:02 AM",
+    "; Settings Summary",
+    ";   processName,Process1",
+    ";   layerHeight,0.2",
+    ";   extruderRetractionDistance,1.5",
+    ";   extruderRetractionZLift,0.4",
+    ";   extruderRetractionSpeed,1800",
+    ";   rapidXYspeed,4800",
+    ";   printerModelsOverride",
+]
+
+
+def create_gcode_file(directory, name, header, footer, num_gcode_lines):
+    path = os.path.join(directory, name)
+    with open(path, 'w') as f:
+        for line in header:
+            f.write(line + "\n")
+        f.write("G21\nG90\nM82\nG28\n")
+        for index in range(num_gcode_lines):
+            f.write("G1 X{0:.3f} Y{1:.3f} E{2:.5f}\n".format(index % 200, (index * 7) % 200, index * 0.01))
+        for line in footer:
+            f.write(line + "\n")
+    return path
+
+
+def get_settings(processor_type, path):
+    processors = [
+        Simplify3dSettingsProcessor(search_direction="both", max_forward_search=1000, max_reverse_search=1000),
+        Slic3rSettingsProcessor(search_direction="both", max_forward_search=1000, max_reverse_search=1000),
+        CuraSettingsProcessor(search_direction="both", max_forward_search=1000, max_reverse_search=1000),
+    ]
+    file_processor = processor_type(processors, 1, None)
+    return file_processor.process_file(path, filter_tags=['octolapse_setting'])
+
+
+class TestNativeSettingsExtraction(unittest.TestCase):
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def assert_same_settings(self, path):
+        native_results = get_settings(GcodeFileProcessor, path)
+        python_results = get_settings(PythonGcodeFileProcessor, path)
+        self.assertEqual(native_results, python_results)
+        return native_results
+
+    def test_slic3r(self):
+        path = create_gcode_file(self.directory, "slic3r.gcode", SLIC3R_HEADER, SLIC3R_FOOTER, 5000)
+        results = self.assert_same_settings(path)
+        settings = results["settings"]["slic3r-pe"]
+        self.assertEqual(settings["layer_height"], 0.15)
+        self.assertEqual(settings["retract_length"], [0.8, 0.8])
+        self.assertEqual(settings["retract_lift"], [0.6, 0.6])
+        self.assertEqual(settings["version"]["version"], "PrusaSlicer 2.3.0+linux-x64")
+
+    def test_simplify_3d(self):
+        path = create_gcode_file(self.directory, "simplify.gcode", SIMPLIFY_3D_HEADER, [], 5000)
+        results = self.assert_same_settings(path)
+        settings = results["settings"]["simplify-3d"]
+        self.assertEqual(settings["layer_height"], 0.2)
+        self.assertEqual(settings["extruder_retraction_distance"], [1.5])
+        self.assertEqual(settings["extruder_retraction_z_lift"], [0.4])
+
+    def test_short_file(self):
+        # The header and tail windows overlap
+        path = create_gcode_file(self.directory, "short.gcode", SLIC3R_HEADER, SLIC3R_FOOTER, 10)
+        self.assert_same_settings(path)
+
+    def test_empty_file(self):
+        path = create_gcode_file(self.directory, "empty.gcode", [], [], 0)
+        with open(path, 'w'):
+            pass
+        self.assert_same_settings(path)
+
+    def test_large_file(self):
+        # Only the windows at the start and end of the file are read
+        path = create_gcode_file(self.directory, "large.gcode", SLIC3R_HEADER, SLIC3R_FOOTER, 500000)
+        results = get_settings(GcodeFileProcessor, path)
+        self.assertEqual(results["settings"]["slic3r-pe"]["retract_length"], [0.8, 0.8])
+
+    def test_missing_file(self):
+        # The native extractor can't map the file, and the python fallback raises just like it always has
+        path = os.path.join(self.directory, "missing.gcode")
+        with self.assertRaises(Exception):
+            get_settings(GcodeFileProcessor, path)
+
+
+if __name__ == '__main__':
+    suite = unittest.TestSuite()
+    suite.addTests(unittest.TestLoader().loadTestsFromTestCase(TestNativeSettingsExtraction))
+    unittest.TextTestRunner(verbosity=3).run(suite)
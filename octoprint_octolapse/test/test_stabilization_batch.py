@@ -0,0 +1,127 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import os
+import queue
+import shutil
+import tempfile
+import unittest
+
+import GcodePositionProcessor
+from octoprint_octolapse.stabilization_preprocessing import (
+    BatchPreprocessingJob, StabilizationBatchPreprocessingThread
+)
+from octoprint_octolapse.test.testing_utilities import (
+    create_gcode_file, create_position_args, create_smart_layer_args, create_stabilization_args
+)
+
+
+class TestStabilizationBatch(unittest.TestCase):
+    position_args = create_position_args()
+    smart_layer_args = create_smart_layer_args()
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def create_gcode_file(self, name, num_layers):
+        return create_gcode_file(self.directory, name, num_layers)
+
+    def create_stabilization_args(self, file_path):
+        return create_stabilization_args(file_path, self.position_args)
+
+    def create_job(self, file_path):
+        return BatchPreprocessingJob(
+            "smart_layer", self.position_args, self.create_stabilization_args(file_path), self.smart_layer_args,
+            tag=os.path.basename(file_path)
+        )
+
+    def run_batch(self, jobs, num_threads):
+        completion_queue = queue.Queue()
+        thread = StabilizationBatchPreprocessingThread(jobs, completion_queue, num_threads=num_threads)
+        thread.start()
+        completed = []
+        while True:
+            item = completion_queue.get(timeout=60)
+            if item is None:
+                break
+            completed.append(item)
+        thread.join()
+        return thread, completed
+
+    def test_largest_files_are_processed_first(self):
+        jobs = [
+            self.create_job(self.create_gcode_file("small.gcode", 5)),
+            self.create_job(self.create_gcode_file("large.gcode", 50)),
+            self.create_job(self.create_gcode_file("medium.gcode", 20)),
+        ]
+        thread, completed = self.run_batch(jobs, num_threads=1)
+        self.assertEqual(thread.jobs_processed, 3)
+        self.assertEqual([job.tag for job, results in completed], ["large.gcode", "medium.gcode", "small.gcode"])
+        self.assertEqual([len(results[0]) for job, results in completed], [50, 20, 5])
+
+    def test_results_match_single_file_preprocessing(self):
+        file_paths = [self.create_gcode_file("{0}.gcode".format(index), 10 + index) for index in range(6)]
+        thread, completed = self.run_batch([self.create_job(file_path) for file_path in file_paths], num_threads=3)
+        self.assertEqual(len(completed), 6)
+        for job, results in completed:
+            stabilization_args = self.create_stabilization_args(job.stabilization_args["file_path"])
+            stabilization_args["on_progress_received"] = lambda *progress: True
+            expected = GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
+                self.position_args, stabilization_args, self.smart_layer_args
+            )
+            self.assertEqual(results[0], expected[0], job.tag)
+
+    def test_plan_positions_are_byte_offsets(self):
+        file_path = self.create_gcode_file("crlf.gcode", 10)
+        with open(file_path, "rb") as gcode_file:
+            data = gcode_file.read()
+        # Windows line endings, and no line ending after the final line
+        data = data.replace(b"\n", b"\r\n")[:-2]
+        with open(file_path, "wb") as gcode_file:
+            gcode_file.write(data)
+        stabilization_args = self.create_stabilization_args(file_path)
+        stabilization_args["on_progress_received"] = lambda *progress: True
+        results = GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
+            self.position_args, stabilization_args, self.smart_layer_args
+        )
+        self.assertEqual(len(results[0]), 10)
+        self.assertEqual(results[3], data.count(b"\n") + 1)
+        for plan in results[0]:
+            file_line, file_gcode_number, file_position = plan[0:3]
+            # The position is directly after the triggering line, which may be the final line
+            self.assertTrue(file_position == len(data) or data[file_position - 1:file_position] == b"\n")
+            self.assertEqual(len(data[:file_position].splitlines()), file_line)
+
+    def test_cancelling_skips_the_remaining_files(self):
+        jobs = [self.create_job(self.create_gcode_file("{0}.gcode".format(index), 5)) for index in range(4)]
+        completion_queue = queue.Queue()
+        thread = StabilizationBatchPreprocessingThread(jobs, completion_queue, num_threads=1)
+        thread._on_job_complete = lambda job_index, results: False
+        thread.start()
+        thread.join()
+        self.assertEqual(thread.jobs_processed, 1)
+
+
+if __name__ == '__main__':
+    unittest.main()
@@ -0,0 +1,188 @@
+# coding=utf-8
+##################################################################################
+# Octolapse - A plugin for OctoPrint used for making stabilized timelapse videos.
+# Copyright (C) 2023  Brad Hochgesang
+##################################################################################
+# This program is free software: you can redistribute it and/or modify
+# it under the terms of the GNU Affero General Public License as published
+# by the Free Software Foundation, either version 3 of the License, or
+# (at your option) any later version.
+#
+# This program is distributed in the hope that it will be useful,
+# but WITHOUT ANY WARRANTY; without even the implied warranty of
+# MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+# GNU Affero General Public License for more details.
+#
+# You should have received a copy of the GNU Affero General Public License
+# along with this program.  If not, see the following:
+# https://github.com/FormerLurker/Octolapse/blob/master/LICENSE
+#
+# You can contact the author either through the git-hub repository, or at the
+# following email address: FormerLurker@pm.me
+import os
+import shutil
+import tempfile
+import unittest
+
+import GcodePositionProcessor
+from octoprint_octolapse.test.testing_utilities import (
+    create_gcode_file, create_position_args, create_smart_layer_args, create_stabilization_args
+)
+
+# The processing issue reported when the stabilized gcode file can't be written or doesn't pass verification
+STABILIZED_GCODE_NOT_WRITTEN = 7
+
+
+class TestStabilizedGcodeWriter(unittest.TestCase):
+    position_args = create_position_args()
+    smart_layer_args = create_smart_layer_args()
+
+    def setUp(self):
+        self.directory = tempfile.mkdtemp()
+
+    def tearDown(self):
+        shutil.rmtree(self.directory)
+
+    def read_file(self, file_path):
+        with open(file_path, "rb") as gcode_file:
+            return gcode_file.read()
+
+    def write_file(self, name, data):
+        file_path = os.path.join(self.directory, name)
+        with open(file_path, "wb") as gcode_file:
+            gcode_file.write(data)
+        return file_path
+
+    def get_snapshot_plans(self, file_path, on_progress_received=None, smart_layer_args=None):
+        stabilization_args = create_stabilization_args(file_path, self.position_args)
+        if on_progress_received is not None:
+            stabilization_args["notification_period_seconds"] = 0
+        stabilization_args["on_progress_received"] = on_progress_received or (lambda *progress: True)
+        stabilization_args["snapshot_gcode_args"] = {
+            "axis_mode_compatibility": False,
+            "wait_for_moves_to_finish": True,
+            "disable_z_lift": False,
+            "snapshot_command": "@OCTOLAPSE TAKE-SNAPSHOT",
+            "extruders": self.position_args["slicer_settings"]["extruders"],
+        }
+        stabilization_args["stabilized_gcode_args"] = {
+            "target_file_path": file_path + ".stabilized.gcode",
+            "snapshot_command": "M240",
+            "wait_for_moves": True,
+            "verify": True,
+        }
+        return GcodePositionProcessor.GetSnapshotPlans_SmartLayer(
+            self.position_args, stabilization_args, smart_layer_args or self.smart_layer_args
+        )
+
+    def get_processing_issue_types(self, results):
+        return [issue[0] for issue in results[6]]
+
+    @staticmethod
+    def is_triggering_line_kept(plan):
+        # The triggering line is kept when the snapshot gcode only sends it again, else the snapshot gcode replaces it
+        triggering_command, start_command, snapshot_gcode = plan[5], plan[6], plan[11]
+        return (
+            start_command is not None and start_command[2] == triggering_command[2] and
+            list(snapshot_gcode[0]) == [start_command[2]]
+        )
+
+    @staticmethod
+    def get_snapshot_gcode_text(plan, include_initialization_gcode):
+        initialization_gcode, start_gcode, snapshot_commands, return_commands, end_gcode = plan[11]
+        lines = list(initialization_gcode) if include_initialization_gcode else []
+        lines.extend(start_gcode)
+        for command in snapshot_commands:
+            if command.startswith("@OCTOLAPSE"):
+                lines.extend(["M400", "M240"])
+            else:
+                lines.append(command)
+        lines.extend(return_commands)
+        lines.extend(end_gcode)
+        return "".join(line + "\n" for line in lines).encode()
+
+    def get_expected_gcode(self, data, plans):
+        expected = b""
+        copied_to = 0
+        for plan in plans:
+            line_end = plan[2]
+            keep_triggering_line = self.is_triggering_line_kept(plan)
+            insert_at = line_end
+            if not keep_triggering_line:
+                insert_at = data.rfind(b"\n", 0, line_end - 1 if data[line_end - 1:line_end] == b"\n" else line_end) + 1
+            text = self.get_snapshot_gcode_text(plan, not keep_triggering_line)
+            if insert_at > 0 and data[insert_at - 1:insert_at] not in (b"\n", b"\r"):
+                text = b"\n" + text
+            expected += data[copied_to:insert_at] + text
+            copied_to = line_end
+        return expected + data[copied_to:]
+
+    def assert_stabilized_gcode_is_written(self, file_path, results, num_plans):
+        plans = results[0]
+        self.assertEqual(len(plans), num_plans)
+        self.assertNotIn(STABILIZED_GCODE_NOT_WRITTEN, self.get_processing_issue_types(results))
+        stabilized_gcode = self.read_file(file_path + ".stabilized.gcode")
+        self.assertEqual(stabilized_gcode, self.get_expected_gcode(self.read_file(file_path), plans))
+        # The snapshot command is replaced, and the printer waits for moves to finish before each snapshot
+        lines = stabilized_gcode.decode().splitlines()
+        self.assertNotIn("@OCTOLAPSE TAKE-SNAPSHOT", lines)
+        snapshot_line_numbers = [index for index, line in enumerate(lines) if line == "M240"]
+        self.assertEqual(len(snapshot_line_numbers), num_plans)
+        for line_number in snapshot_line_numbers:
+            self.assertEqual(lines[line_number - 1], "M400")
+        return stabilized_gcode
+
+    def test_snapshot_gcode_is_inserted_after_the_triggering_lines(self):
+        file_path = create_gcode_file(self.directory, "layers.gcode", 10)
+        results = self.get_snapshot_plans(file_path)
+        for plan in results[0]:
+            self.assertTrue(self.is_triggering_line_kept(plan))
+        stabilized_gcode = self.assert_stabilized_gcode_is_written(file_path, results, 10)
+        # only lines are added
+        source_lines = self.read_file(file_path).decode().splitlines()
+        stabilized_lines = stabilized_gcode.decode().splitlines()
+        self.assertEqual([line for line in stabilized_lines if line in source_lines], source_lines)
+
+    def test_split_arcs_replace_the_triggering_line(self):
+        # Each layer is a single arc around (100, 100) that passes closest to the stabilization point in the middle
+        gcode = ["G21", "G90", "M83", "G28", "G1 X80 Y100 F1800"]
+        for layer in range(1, 5):
+            gcode.append("G1 Z{0:.1f}".format(layer * 0.2))
+            gcode.append("G1 X80 Y101 E0.1")
+            gcode.append("G2 X80 Y99 I20 J-1 E5")
+            gcode.append("G1 X80 Y100")
+        file_path = self.write_file("arcs.gcode", ("\n".join(gcode) + "\n").encode())
+        smart_layer_args = dict(self.smart_layer_args, arc_chord_tolerance=0.01)
+        results = self.get_snapshot_plans(file_path, smart_layer_args=smart_layer_args)
+        for plan in results[0]:
+            self.assertFalse(self.is_triggering_line_kept(plan))
+        stabilized_gcode = self.assert_stabilized_gcode_is_written(file_path, results, 4)
+        self.assertNotIn("G2 X80 Y99 I20 J-1 E5", stabilized_gcode.decode().splitlines())
+
+    def test_final_line_without_a_line_ending(self):
+        file_path = create_gcode_file(self.directory, "no_final_line_ending.gcode", 10)
+        # The final layer is a single line, which triggers the final plan
+        data = self.read_file(file_path) + b"G1 Z2.20 F600\nG1 X20 Y20 E10.0500 F1800"
+        file_path = self.write_file("no_final_line_ending.gcode", data)
+        results = self.get_snapshot_plans(file_path)
+        self.assertEqual(results[0][-1][2], len(data))
+        stabilized_gcode = self.assert_stabilized_gcode_is_written(file_path, results, 11)
+        self.assertIn(b"G1 X20 Y20 E10.0500 F1800\n", stabilized_gcode)
+
+    def test_verification_fails_when_the_source_changes(self):
+        file_path = create_gcode_file(self.directory, "changed.gcode", 200)
+        data = self.read_file(file_path)
+        progress_received = []
+
+        def on_progress_received(*progress):
+            # Switch to relative extrusion after the line has been read, so the plans no longer match the file
+            progress_received.append(progress)
+            with open(file_path, "r+b") as gcode_file:
+                gcode_file.seek(data.index(b"M82\n"))
+                gcode_file.write(b"M83\n")
+            return True
+
+        results = self.get_snapshot_plans(file_path, on_progress_received=on_progress_received)
+        self.assertGreater(len(progress_received), 0)
+        self.assertEqual(len(results[0]), 200)
+        self.assertIn(STABILIZED_GCODE_NOT_WRITTEN, self.get_processing_issue_types(results))
@@ -19,6 +19,10 @@
 # You can contact the author either through the git-hub repository, or at the
 # following email address: FormerLurker@pm.me
 ##################################################################################
+import os
+
+from octoprint_octolapse.settings import StabilizationProfile
+from octoprint_octolapse.stabilization_gcode import SnapshotPositionGenerator
 
 
 def get_printer_profile():
@@ -55,3 +59,93 @@ def get_printer_profile():
           "home_z": 0
     }
 
+
+def create_position_args(
+    fixed_point_decimals=0, e_axis_default_mode="absolute", location_detection_commands=None, z_lift_height=0.5
+):
+    return {
+        "location_detection_commands": location_detection_commands or [],
+        "xyz_axis_default_mode": "absolute",
+        "e_axis_default_mode": e_axis_default_mode,
+        "units_default": "millimeters",
+        "autodetect_position": True,
+        "slicer_settings": {
+            "vase_mode": False,
+            "layer_height": 0.2,
+            "extruders": [{
+                "retract_before_move": True,
+                "retraction_length": 1.0,
+                "retraction_speed": 2400,
+                "deretraction_speed": 2400,
+                "lift_when_retracted": False,
+                "z_lift_height": z_lift_height,
+                "x_y_travel_speed": 9000,
+                "first_layer_travel_speed": 9000,
+                "z_lift_speed": 600,
+            }],
+        },
+        "zero_based_extruder": True,
+        "priming_height": 0.75,
+        "minimum_layer_height": 0.05,
+        "num_extruders": 1,
+        "shared_extruder": True,
+        "default_extruder_index": 0,
+        "extruder_offsets": [],
+        "home_position": {"home_x": 0.0, "home_y": 0.0, "home_z": 0.0},
+        "g90_influences_extruder": False,
+        "volume": {
+            "bed_type": "rectangular", "min_x": 0.0, "max_x": 250.0, "min_y": 0.0, "max_y": 200.0,
+            "min_z": 0.0, "max_z": 200.0, "origin_type": "lowerleft", "bounds": None
+        },
+        "fixed_point_decimals": fixed_point_decimals
+    }
+
+
+def create_smart_layer_args():
+    return {
+        "trigger_type": 0,
+        "snap_to_print_high_quality": False,
+        "snap_to_print_smooth": False,
+        "arc_chord_tolerance": 0.05,
+    }
+
+
+def create_stabilization_args(file_path, position_args):
+    return {
+        "height_increment": 0,
+        "notification_period_seconds": 1,
+        "file_path": file_path,
+        "gcode_generator": SnapshotPositionGenerator(StabilizationProfile().get_stabilization_paths(), position_args),
+        "snapshot_gcode_args": None,
+        "x_stabilization_disabled": False,
+        "y_stabilization_disabled": False,
+    }
+
+
+def create_gcode_file(directory, name, num_layers):
+    # One snapshot plan per layer
+    file_path = os.path.join(directory, name)
+    e = 0
+    with open(file_path, "w") as gcode_file:
+        gcode_file.write("G21\nG90\nM82\nG28\nG92 E0\n")
+        for layer in range(1, num_layers + 1):
+            gcode_file.write("G1 Z{0:.2f} F600\n".format(layer * 0.2))
+            for index in range(20):
+                e += 0.05
+                gcode_file.write("G1 X{0} Y{1} E{2:.4f} F1800\n".format(20 + index, 20 + layer % 5, e))
+    return file_path
+
+
+def create_sample_print(num_layers=20, moves_per_layer=100):
+    gcodes = ["G21", "G90", "M82", "G28", "G92 E0"]
+    e = 0.0
+    for layer in range(1, num_layers + 1):
+        gcodes.append("G1 E{0:.5f} F2400".format(e - 0.8))
+        gcodes.append("G1 Z{0:.3f} F600".format(layer * 0.2))
+        gcodes.append("G1 E{0:.5f}".format(e))
+        for move in range(moves_per_layer):
+            e += 0.03317
+            gcodes.append("G1 X{0:.3f} Y{1:.3f} E{2:.5f} F1800".format(
+                20 + (move % 10) * 3.33, 20 + (move // 10) * 1.17, e
+            ))
+    return gcodes
@@ -32,7 +32,7 @@ import queue as queue
 import os
 import octoprint_octolapse.utility as utility
 from octoprint_octolapse.stabilization_gcode import SnapshotGcodeGenerator, SnapshotGcode
-from octoprint_octolapse.gcode_commands import Commands, Response
+from octoprint_octolapse.gcode_commands import Commands
 from octoprint_octolapse.gcode_processor import ParsedCommand
 from octoprint_octolapse.position import Position
 from octoprint_octolapse.settings import PrinterProfile, OctolapseSettings
@@ -130,6 +130,7 @@ class Timelapse(object):
 
         self._current_profiles = {}
         self._current_file_line = 0
+        self._use_queue_filter = False
 
         self.snapshot_plans = None  # type: [preprocessing.SnapshotPlan]
         self.current_snapshot_plan_index = 0
@@ -183,6 +184,9 @@ class Timelapse(object):
         # set the current snapshot plan if we have any
         if self.snapshot_plans is not None and len(self.snapshot_plans) > 0:
             self.current_snapshot_plan = self.snapshot_plans[self.current_snapshot_plan_index]
+        if self.snapshot_plans is not None:
+            # the cursor lets us find the triggering plan (if any) for each line with a single compare
+            GcodeProcessor.initialize_snapshot_plan_cursor(self.snapshot_plans)
         # if we have at least one snapshot plan, we must have preprocessed, so set is_realtime to false.
         self.is_realtime = self.snapshot_plans is None
         assert (isinstance(self._printer, PrinterProfile))
@@ -221,6 +225,16 @@ class Timelapse(object):
         self._test_mode_enabled = self._settings.main_settings.test_mode_enabled
         self._triggers = Triggers(self._settings)
         self._triggers.create()
+        # Preprocessed prints only need the full queuing handler for a few lines, so let the native filter
+        # decide when to run it.  Real-time prints can do the same if the trigger runs natively, in which case the
+        # filter also updates the position and the trigger.  Test mode alters every line, so it can't use the filter.
+        self._use_queue_filter = (not self.is_realtime or self._triggers.is_native) and not self._test_mode_enabled
+        if self._use_queue_filter:
+            GcodeProcessor.initialize_gcode_queue_filter(
+                self._printer.get_snapshot_command_gcode(),
+                update_position=self.is_realtime,
+                location_detection_commands=self._position.get_location_detection_commands()
+            )
 
         # take a snapshot of the current settings for use in the Octolapse Tab
         self._current_profiles = self._settings.profiles.get_profiles_dict()
@@ -418,11 +432,15 @@ class Timelapse(object):
         }
         try:
             has_error = False
-            # create the GCode for the timelapse and store it
-            snapshot_gcode = self._gcode.create_gcode_for_snapshot_plan(
-                self.current_snapshot_plan, self._position.g90_influences_extruder,
-                self._trigger_profile.get_snapshot_plan_options()
-            )
+            # use the gcode created while preprocessing if we have it, else create the GCode for the timelapse
+            snapshot_gcode = self.current_snapshot_plan.snapshot_gcode
+            if snapshot_gcode is not None:
+                logger.info("Using precalculated snapshot gcode:\r\n%s", snapshot_gcode)
+            else:
+                snapshot_gcode = self._gcode.create_gcode_for_snapshot_plan(
+                    self.current_snapshot_plan, self._position.g90_influences_extruder,
+                    self._trigger_profile.get_snapshot_plan_options()
+                )
             # save the gcode fo the payload
             timelapse_snapshot_payload["snapshot_gcode"] = snapshot_gcode
 
@@ -680,6 +698,17 @@ class Timelapse(object):
         self._print_start_failed_callback(message)
 
     def on_gcode_queuing(self, command_string, cmd_type, gcode, tags):
+        if (
+            self._use_queue_filter and
+            GcodeProcessor.filter_queued_gcode(
+                command_string, tags, self._state == TimelapseState.WaitingForTrigger
+            ) == GcodeProcessor.QUEUE_FILTER_PASS_THROUGH and
+            self._state == TimelapseState.WaitingForTrigger
+        ):
+            # The filter only passes file lines with the expected line number, so keep our count in sync
+            self._current_file_line += 1
+            return None
+
         if self.detect_timelapse_start(command_string, tags) == (None,):
             # suppress command if the timelapse start detection routine tells us to
             # this is because preprocessing happens on a thread, and will send any detected commands after completion.
@@ -755,21 +784,19 @@ class Timelapse(object):
 
     def process_pre_calculated_gcode(self, parsed_command, tags):
         if not {'plugin:octolapse', 'snapshot_gcode'}.issubset(tags) and 'source:file' in tags:
-            if self.current_snapshot_plan is None:
-                return None
             current_file_line = self.get_current_file_line(tags)
-            # skip plans if we need to in case any were missed.
-            if self.current_snapshot_plan.file_gcode_number < current_file_line:
-                while (
-                    self.current_snapshot_plan.file_gcode_number < current_file_line and
-                    len(self.snapshot_plans) > self.current_snapshot_plan_index
-                ):
-                    self.set_next_snapshot_plan()
+            if current_file_line is None:
+                return None
+            # the cursor skips any missed plans and handles seeks, so we only need to look at the plan it returns
+            plan_index = GcodeProcessor.check_snapshot_plan_cursor(current_file_line)
+            if plan_index < 0:
+                return None
+            self.current_snapshot_plan_index = plan_index
+            self.current_snapshot_plan = self.snapshot_plans[plan_index]
 
             if (
                 self._state == TimelapseState.WaitingForTrigger
                 and self._octoprint_printer.is_printing()
-                and self.current_snapshot_plan.file_gcode_number == current_file_line
             ):
                 # time to take a snapshot!
                 if self.current_snapshot_plan.triggering_command.gcode != parsed_command.gcode:
@@ -814,8 +841,12 @@ class Timelapse(object):
         try:
             # get the position state in case it has changed
             # if there has been a position or extruder state change, inform any listener
-            file_line_number = self.get_current_file_line(tags)
-            self._position.update(gcode, file_line_number=file_line_number)
+            if self._use_queue_filter:
+                # the gcode queue filter has already updated the position
+                self._position.sync()
+            else:
+                file_line_number = self.get_current_file_line(tags)
+                self._position.update(gcode, file_line_number=file_line_number)
             parsed_command = self._position.current_pos.parsed_command
 
             # if this code is snapshot gcode, simply return it to the printer.
@@ -1167,7 +1198,7 @@ class Timelapse(object):
 
     def on_gcode_received(self, line):
         if self._position_request_sent:
-            payload = Response.check_for_position_request(line)
+            payload = GcodeProcessor.parse_position_response(line)
             if payload:
                 self.on_position_received(payload)
         elif self._state != TimelapseState.Idle:
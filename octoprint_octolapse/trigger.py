@@ -24,6 +24,7 @@ from __future__ import unicode_literals
 import time
 from octoprint_octolapse.position import ExtruderTriggers
 from octoprint_octolapse.settings import *
+from octoprint_octolapse.gcode_processor import GcodeProcessor
 
 # create the module level logger
 from octoprint_octolapse.log import LoggingConfigurator
@@ -34,9 +35,16 @@ logger = logging_configurator.get_logger(__name__)
 class Triggers(object):
     TRIGGER_TYPE_DEFAULT = 'default'
     TRIGGER_TYPE_IN_PATH = 'in-path'
+    # These must match snapshot_trigger_type in snapshot_trigger.h
+    NATIVE_TRIGGER_TYPES = {
+        TriggerProfile.GCODE_TRIGGER_TYPE: 0,
+        TriggerProfile.LAYER_TRIGGER_TYPE: 1,
+        TriggerProfile.TIMER_TRIGGER_TYPE: 2
+    }
 
     def __init__(self, settings):
         self._triggers = []
+        self.is_native = False
         self.reset()
         self._settings = settings
         self.name = "Unknown"
@@ -46,11 +54,20 @@ class Triggers(object):
 
     def reset(self):
         self._triggers = []
+        self.is_native = False
 
     def create(self):
         self.reset()
         trigger_profile = self._settings.profiles.current_trigger()
         self.name = trigger_profile.name
+        # The native trigger is updated by the gcode queue filter, so python only needs to look at the trigger state
+        # when it changes.
+        self.is_native = (
+            trigger_profile.trigger_subtype in Triggers.NATIVE_TRIGGER_TYPES and
+            GcodeProcessor.initialize_snapshot_trigger(
+                Triggers.get_native_trigger_args(trigger_profile, self._settings.profiles.current_printer())
+            )
+        )
         # create the triggers
         # If the gcode trigger is enabled, add it
         if trigger_profile.trigger_subtype == TriggerProfile.GCODE_TRIGGER_TYPE:
@@ -63,15 +80,42 @@ class Triggers(object):
         elif trigger_profile.trigger_subtype == TriggerProfile.TIMER_TRIGGER_TYPE:
             self._triggers.append(TimerTrigger(self._settings))
 
+    @staticmethod
+    def get_native_trigger_args(trigger_profile, printer):
+        extruder_triggers = None
+        if trigger_profile.extruder_state_requirements_enabled:
+            extruder_triggers = {}
+            for option in [
+                "on_extruding_start", "on_extruding", "on_primed", "on_retracting_start", "on_retracting",
+                "on_partially_retracted", "on_retracted", "on_deretracting_start", "on_deretracting", "on_deretracted"
+            ]:
+                extruder_triggers[option] = TriggerProfile.get_extruder_trigger_value(
+                    getattr(trigger_profile, "trigger_" + option)
+                )
+        return {
+            "type": Triggers.NATIVE_TRIGGER_TYPES[trigger_profile.trigger_subtype],
+            "require_zhop": trigger_profile.require_zhop,
+            "height_increment": trigger_profile.layer_trigger_height,
+            "interval_seconds": trigger_profile.timer_trigger_seconds,
+            "snapshot_command": printer.get_snapshot_command_gcode(),
+            "extruder_triggers": extruder_triggers
+        }
+
     def resume(self):
         for trigger in self._triggers:
             if type(trigger) == TimerTrigger:
-                trigger.resume()
+                if self.is_native:
+                    GcodeProcessor.resume_snapshot_trigger()
+                else:
+                    trigger.resume()
 
     def pause(self):
         for trigger in self._triggers:
             if type(trigger) == TimerTrigger:
-                trigger.pause()
+                if self.is_native:
+                    GcodeProcessor.pause_snapshot_trigger()
+                else:
+                    trigger.pause()
 
     def update(self, position):
         # the previous command (not just the current) MUST have homed positions else
@@ -80,6 +124,12 @@ class Triggers(object):
         #    return
         ## Note:  I think we need to add waits to handle the above
         """Update all triggers and return any that are triggering"""
+        if self.is_native:
+            # the native trigger has already been updated by the gcode queue filter
+            native_state = GcodeProcessor.get_snapshot_trigger_state()
+            for current_trigger in self._triggers:
+                current_trigger.update_from_native(native_state)
+            return None
         try:
             # Loop through all of the active current_triggers
             for current_trigger in self._triggers:
@@ -142,6 +192,9 @@ class Triggers(object):
 
 
 class TriggerState(object):
+    # indexed by snapshot_trigger_position_type in snapshot_trigger.h
+    NATIVE_TRIGGER_TYPES = [None, Triggers.TRIGGER_TYPE_DEFAULT, Triggers.TRIGGER_TYPE_IN_PATH]
+
     def __init__(self, state=None):
         self.is_triggered = False if state is None else state.is_triggered
         self.trigger_type = None if state is None else state.trigger_type
@@ -177,6 +230,19 @@ class TriggerState(object):
         self.trigger_type = None
         self.has_changed = False
 
+    def update_from_native(self, native_state):
+        # see snapshot_trigger_state::to_py_tuple
+        self.is_triggered = native_state[0] > 0
+        self.trigger_type = TriggerState.NATIVE_TRIGGER_TYPES[native_state[1]]
+        self.is_in_position = native_state[2] > 0
+        self.in_path_position = native_state[3] > 0
+        self.is_waiting = native_state[4] > 0
+        self.is_home_position_wait = native_state[5] > 0
+        self.is_waiting_on_zhop = native_state[6] > 0
+        self.is_waiting_on_extruder = native_state[7] > 0
+        self.has_changed = native_state[8] > 0
+        self.has_definite_position = native_state[9] > 0
+
     def is_equal(self, state):
         if (state is not None
                 and self.is_triggered == state.is_triggered
@@ -216,6 +282,16 @@ class Trigger(object):
     def name(self):
         return self.trigger_profile.name + " Trigger"
 
+    def create_state(self):
+        return TriggerState()
+
+    def update_from_native(self, native_state):
+        state = self.create_state()
+        state.update_from_native(native_state)
+        self.trigger_count = native_state[10]
+        self.snapshots_enabled = native_state[11] > 0
+        self.add_state(state)
+
     def add_state(self, state):
         self._state_history.insert(0, state)
         while len(self._state_history) > self._max_states:
@@ -330,6 +406,9 @@ class GcodeTrigger(Trigger):
         # add an initial state
         self.add_state(GcodeTriggerState())
 
+    def create_state(self):
+        return GcodeTriggerState()
+
     def update(self, position):
         super(GcodeTrigger, self).update(position)
         parsed_command = position.current_pos.parsed_command
@@ -456,6 +535,14 @@ class LayerTriggerState(TriggerState):
         self.is_height_change = False
         self.is_layer_change = False
 
+    def update_from_native(self, native_state):
+        super(LayerTriggerState, self).update_from_native(native_state)
+        self.current_increment = native_state[12]
+        self.is_layer_change_wait = native_state[13] > 0
+        self.is_height_change = native_state[14] > 0
+        self.is_height_change_wait = native_state[15] > 0
+        self.layer = native_state[16]
+
     def is_equal(self, state):
         if (super(LayerTriggerState, self).is_equal(state)
                 and self.is_home_position_wait == state.is_home_position_wait
@@ -522,6 +609,9 @@ class LayerTrigger(Trigger):
         )
         self.add_state(LayerTriggerState())
 
+    def create_state(self):
+        return LayerTriggerState()
+
     def update(self, position):
         """Updates the layer monitor position.  x, y and z may be absolute, but e must always be relative"""
         super(LayerTrigger, self).update(position)
@@ -697,6 +787,12 @@ class TimerTriggerState(TriggerState):
         current_dict.update(super_dict)
         return current_dict
 
+    def update_from_native(self, native_state):
+        super(TimerTriggerState, self).update_from_native(native_state)
+        self.seconds_to_trigger = None if native_state[18] > 0 else native_state[17]
+        self.trigger_start_time = None if native_state[20] > 0 else native_state[19]
+        self.pause_time = None if native_state[22] > 0 else native_state[21]
+
     def is_equal(self, state):
         if (super(TimerTriggerState, self).is_equal(state)
                 and self.seconds_to_trigger == state.seconds_to_trigger
@@ -762,6 +858,9 @@ class TimerTrigger(Trigger):
         initial_state = TimerTriggerState()
         self.add_state(initial_state)
 
+    def create_state(self):
+        return TimerTriggerState()
+
     def pause(self):
         state = self.get_state(0)
         if state is None:
@@ -35,6 +35,7 @@ import threading
 import json
 import shutil
 import errno
+import tempfile
 import requests
 from requests.adapters import HTTPAdapter
 from requests.packages.urllib3.util.retry import Retry
@@ -262,6 +263,14 @@ def get_default_snapshot_archive_directory_name():
     return _snapshot_archive_default_directory
 
 
+_preprocessing_service_socket_file_name = "octolapse_preprocessing.sock"
+
+
+def get_default_preprocessing_service_socket_path():
+    # Every OctoPrint instance on this computer uses the same socket unless it is changed in the main settings.
+    return os.path.join(tempfile.gettempdir(), _preprocessing_service_socket_file_name)
+
+
 _temporary_snapshot_subdirectory = "octolapse_snapshots_tmp"
 
 
@@ -288,6 +297,13 @@ def get_temporary_rendering_directory(temporary_directory):
     return os.path.join(temporary_directory, _temporary_rendering_subdirectory)
 
 
+def get_temporary_rendering_job_camera_path(temporary_directory, job_guid, camera_guid):
+    # each rendering gets its own folder so that renderings can run concurrently
+    return os.path.join(
+            get_temporary_rendering_directory(temporary_directory),
+            "{0}_{1}".format(job_guid, camera_guid))
+
+
 _temporary_archive_subdirectory = "octolapse_archive_tmp"
 def get_temporary_archive_directory(temporary_directory):
     return os.path.join(temporary_directory, _temporary_archive_subdirectory)
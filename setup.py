@@ -1,6 +1,7 @@
 # coding=utf-8
 from setuptools import setup, Extension
 from distutils.command.build_ext import build_ext
+from setuptools.command.build_clib import build_clib
 from distutils.ccompiler import CCompiler
 from distutils.unixccompiler import UnixCCompiler
 from distutils.msvccompiler import MSVCCompiler
@@ -95,6 +96,8 @@ plugin_ignored_packages = []
 # C++ Extension compiler options
 # Set debug mode
 DEBUG = False
+# Set to True to compile out the native processing statistics (GcodePositionProcessor.GetStats)
+DISABLE_STATS = False
 # define compiler flags
 compiler_opts = {
     CCompiler.compiler_type: {
@@ -153,12 +156,43 @@ if DEBUG:
         }
     }
 
+# The frame preparer decodes snapshots on worker threads (std::thread)
+for compiler_type in [CCompiler.compiler_type, UnixCCompiler.compiler_type, CygwinCCompiler.compiler_type]:
+    compiler_opts[compiler_type]['extra_compile_args'].append('-pthread')
+    compiler_opts[compiler_type]['extra_link_args'].append('-pthread')
+
+if DISABLE_STATS:
+    for opts in compiler_opts.values():
+        opts['define_macros'].append(('OCTOLAPSE_DISABLE_STATS', '1'))
+
+def get_compiler_opts(compiler):
+    return [v for k, v in compiler_opts.items() if compiler.compiler_type == k]
+
+
+class build_clib_subclass(build_clib):
+    def build_libraries(self, libraries):
+        print("Compiling Octolapse Gcode Engine with {0}.".format(self.compiler))
+        for lib_name, build_info in libraries:
+            for o in get_compiler_opts(self.compiler):
+                build_info.setdefault('cflags', []).extend(o['extra_compile_args'])
+                # The engine doesn't depend on python
+                build_info.setdefault('macros', []).extend(
+                    m for m in o['define_macros'] if m[0] != 'IS_PYTHON_EXTENSION'
+                )
+        build_clib.build_libraries(self, libraries)
+
+
 class build_ext_subclass(build_ext):
+    def run(self):
+        # The extension links the gcode engine library, which isn't built first when build_ext is run on its own.
+        if self.distribution.has_c_libraries():
+            self.run_command('build_clib')
+        build_ext.run(self)
+
     def build_extensions(self):
         print("Compiling Octolapse Parser Extension with {0}.".format(self.compiler))
 
-        c = self.compiler
-        opts = [v for k, v in compiler_opts.items() if c.compiler_type == k]
+        opts = get_compiler_opts(self.compiler)
         for e in self.extensions:
             for o in opts:
                 for attrib, value in o.items():
@@ -172,26 +206,52 @@ class build_ext_subclass(build_ext):
 
 
 ## Build our c++ parser extension
-plugin_ext_sources = [
-    'octoprint_octolapse/data/lib/c/gcode_position_processor.cpp',
+# The gcode engine has no python dependency, and is built as a static library that the extension links.  This lets
+# it be compiled, tested and profiled on its own (see stabilization_cli.cpp).
+plugin_core_sources = [
     'octoprint_octolapse/data/lib/c/gcode_parser.cpp',
+    'octoprint_octolapse/data/lib/c/gcode_file_reader.cpp',
+    'octoprint_octolapse/data/lib/c/gzip_decoder.cpp',
+    'octoprint_octolapse/data/lib/c/bgcode_decoder.cpp',
     'octoprint_octolapse/data/lib/c/gcode_position.cpp',
+    'octoprint_octolapse/data/lib/c/position_restrictions.cpp',
+    'octoprint_octolapse/data/lib/c/gcode_arc.cpp',
+    'octoprint_octolapse/data/lib/c/slicer_settings_extractor.cpp',
     'octoprint_octolapse/data/lib/c/parsed_command.cpp',
     'octoprint_octolapse/data/lib/c/parsed_command_parameter.cpp',
     'octoprint_octolapse/data/lib/c/position.cpp',
-    'octoprint_octolapse/data/lib/c/python_helpers.cpp',
     'octoprint_octolapse/data/lib/c/snapshot_plan.cpp',
     'octoprint_octolapse/data/lib/c/snapshot_plan_step.cpp',
+    'octoprint_octolapse/data/lib/c/snapshot_gcode.cpp',
+    'octoprint_octolapse/data/lib/c/snapshot_gcode_generator.cpp',
+    'octoprint_octolapse/data/lib/c/stabilized_gcode_writer.cpp',
+    'octoprint_octolapse/data/lib/c/snapshot_plan_cursor.cpp',
+    'octoprint_octolapse/data/lib/c/gcode_queue_filter.cpp',
+    'octoprint_octolapse/data/lib/c/firmware_response.cpp',
+    'octoprint_octolapse/data/lib/c/snapshot_trigger.cpp',
     'octoprint_octolapse/data/lib/c/stabilization.cpp',
     'octoprint_octolapse/data/lib/c/stabilization_results.cpp',
     'octoprint_octolapse/data/lib/c/stabilization_smart_layer.cpp',
     'octoprint_octolapse/data/lib/c/stabilization_smart_gcode.cpp',
+    'octoprint_octolapse/data/lib/c/stabilization_batch.cpp',
     'octoprint_octolapse/data/lib/c/logging.cpp',
+    'octoprint_octolapse/data/lib/c/instrumentation.cpp',
     'octoprint_octolapse/data/lib/c/utilities.cpp',
     'octoprint_octolapse/data/lib/c/trigger_position.cpp',
     'octoprint_octolapse/data/lib/c/gcode_comment_processor.cpp',
-    'octoprint_octolapse/data/lib/c/extruder.cpp'
+    'octoprint_octolapse/data/lib/c/extruder.cpp',
+    'octoprint_octolapse/data/lib/c/jpeg_image.cpp',
+    'octoprint_octolapse/data/lib/c/frame_preparer.cpp',
+    'octoprint_octolapse/data/lib/c/frame_registration.cpp'
+]
+# The python bindings, which own all conversion between python objects and the engine's types.
+plugin_ext_sources = [
+    'octoprint_octolapse/data/lib/c/gcode_position_processor.cpp',
+    'octoprint_octolapse/data/lib/c/python_helpers.cpp',
+    'octoprint_octolapse/data/lib/c/python_bindings.cpp',
+    'octoprint_octolapse/data/lib/c/python_logging.cpp'
 ]
+octolapse_core = ('octolapse_core', {'sources': plugin_core_sources})
 cpp_gcode_parser = Extension(
     'GcodePositionProcessor',
     sources=plugin_ext_sources,
@@ -200,8 +260,9 @@ cpp_gcode_parser = Extension(
 
 
 additional_setup_parameters = {
+    "libraries": [octolapse_core],
     "ext_modules": [cpp_gcode_parser],
-    "cmdclass": {"build_ext": build_ext_subclass}
+    "cmdclass": {"build_ext": build_ext_subclass, "build_clib": build_clib_subclass}
 }
 
 ########################################################################################################################